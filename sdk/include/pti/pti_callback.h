@@ -0,0 +1,123 @@
+//==============================================================
+// Copyright (C) Intel Corporation
+//
+// SPDX-License-Identifier: MIT
+// =============================================================
+#ifndef INCLUDE_PTI_CALLBACK_H_
+#define INCLUDE_PTI_CALLBACK_H_
+
+#include "pti/pti_view.h"
+
+/* clang-format off */
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * @brief Group of APIs a subscriber is called for
+ */
+typedef enum _pti_callback_domain {
+  PTI_CB_DOMAIN_INVALID = 0,
+  PTI_CB_DOMAIN_DRIVER_API = 1,           //!< Level-Zero API calls
+} pti_callback_domain;
+
+/**
+ * @brief Point of an API call a subscriber is called at
+ */
+typedef enum _pti_callback_phase {
+  PTI_CB_PHASE_API_ENTER = 0,             //!< Before the API call
+  PTI_CB_PHASE_API_EXIT = 1,              //!< After the API call
+} pti_callback_phase;
+
+/**
+ * @brief Data passed to a subscriber on every call of an enabled API
+ */
+typedef struct pti_callback_api_data {
+  pti_callback_domain _domain;            //!< Domain of the API
+  pti_callback_phase _phase;              //!< Enter or exit of the API call
+  uint32_t _api_id;                       //!< API ID, see ptiCallbackGetApiId
+  const char* _api_name;                  //!< API name, e.g. "zeCommandListAppendLaunchKernel"
+  void* _api_params;                      //!< Pointer to the Level-Zero tracing parameters of the
+                                          //!< API, e.g. ze_command_list_append_launch_kernel_params_t
+  ze_result_t _api_result;                //!< Result of the API call, valid at exit only
+  uint32_t _correlation_id;               //!< ID of the API call, the same at enter and exit
+  uint32_t _thread_id;                    //!< Thread ID the API called from
+} pti_callback_api_data;
+
+/**
+ * @brief Subscriber callback.
+ *        Called synchronously in the thread calling the API. APIs called from within a callback
+ *        are not reported, and the subscription functions below fail with PTI_ERROR_BAD_ARGUMENT
+ *        when called from within a callback.
+ */
+typedef void (*pti_callback_function)(void* user_data, const pti_callback_api_data* cb_data);
+
+typedef struct _pti_callback_subscriber* pti_callback_subscriber_handle;
+
+/**
+ * @brief Registers a subscriber. No API is enabled for a new subscriber.
+ *
+ * @param subscriber returned subscriber handle
+ * @param callback function called on enter and exit of enabled APIs
+ * @param user_data passed to the callback as is
+ * @return pti_result
+ */
+pti_result PTI_EXPORT
+ptiCallbackSubscribe(pti_callback_subscriber_handle* subscriber, pti_callback_function callback,
+                     void* user_data);
+
+/**
+ * @brief Unregisters a subscriber, the handle becomes invalid
+ *
+ * @return pti_result
+ */
+pti_result PTI_EXPORT
+ptiCallbackUnsubscribe(pti_callback_subscriber_handle subscriber);
+
+/**
+ * @brief Enables all APIs of the domain for the subscriber
+ *
+ * @return pti_result
+ */
+pti_result PTI_EXPORT
+ptiCallbackEnableDomain(pti_callback_subscriber_handle subscriber, pti_callback_domain domain);
+
+/**
+ * @brief Disables all APIs of the domain for the subscriber
+ *
+ * @return pti_result
+ */
+pti_result PTI_EXPORT
+ptiCallbackDisableDomain(pti_callback_subscriber_handle subscriber, pti_callback_domain domain);
+
+/**
+ * @brief Enables one API of the domain for the subscriber
+ *
+ * @return pti_result
+ */
+pti_result PTI_EXPORT
+ptiCallbackEnableApi(pti_callback_subscriber_handle subscriber, pti_callback_domain domain,
+                     uint32_t api_id);
+
+/**
+ * @brief Disables one API of the domain for the subscriber
+ *
+ * @return pti_result
+ */
+pti_result PTI_EXPORT
+ptiCallbackDisableApi(pti_callback_subscriber_handle subscriber, pti_callback_domain domain,
+                      uint32_t api_id);
+
+/**
+ * @brief Returns ID of the API by its name. IDs are stable within one build of the library.
+ *
+ * @return pti_result, PTI_ERROR_BAD_ARGUMENT if the API is unknown
+ */
+pti_result PTI_EXPORT
+ptiCallbackGetApiId(pti_callback_domain domain, const char* api_name, uint32_t* api_id);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif  // INCLUDE_PTI_CALLBACK_H_
@@ -23,6 +23,9 @@ extern "C" {
  */
 #define PTI_MAX_DEVICE_UUID_SIZE 16                         //!< Size of uuid array.
 #define PTI_MAX_PCI_ADDRESS_SIZE 16                         //!< Size of pci address array.
+#define PTI_MAX_HOST_SYNC_CORRELATION_IDS 8                 //!< Size of host sync correlation ids array.
+#define PTI_MAX_MODULE_UUID_SIZE 16                         //!< Size of module uuid array.
+#define PTI_MAX_KERNEL_METRIC_VALUES 64                     //!< Size of kernel metric values array.
 #define PTI_INVALID_QUEUE_ID 0xFFFFFFFFFFFFFFFF-1           //!< For oneAPI versions earlier than 2024.1.1 -- UINT64_MAX-1
 
 /**
@@ -63,6 +66,13 @@ typedef enum _pti_view_kind {
   PTI_VIEW_DEVICE_GPU_MEM_COPY = 8,       //!< Memory copies between Host and Device
   PTI_VIEW_DEVICE_GPU_MEM_FILL = 9,       //!< Device memory fills
   PTI_VIEW_DEVICE_GPU_MEM_COPY_P2P = 10,  //!< Peer to Peer Memory copies between Devices.
+  PTI_VIEW_HOST_SYNC = 11,                //!< Host waits for device work
+  PTI_VIEW_KERNEL_INFO = 12,              //!< Static properties of device kernels
+  PTI_VIEW_DEVICE_GPU_KERNEL_METRICS = 13,  //!< Hardware metrics of device kernels
+  PTI_VIEW_DEVICE_GPU_KERNEL_METRICS_SCHEMA = 14,  //!< Names and types of the kernel metrics,
+                                          //!< delivered with PTI_VIEW_DEVICE_GPU_KERNEL_METRICS,
+                                          //!< can not be enabled on its own
+  PTI_VIEW_KERNEL_ARGS = 15,              //!< Argument values of device kernel launches
 } pti_view_kind;
 
 /**
@@ -125,6 +135,16 @@ typedef enum _pti_view_overhead_kind {
   PTI_VIEW_OVERHEAD_KIND_TIME = 5,           //!< overhead due to L0 api processing time
 } pti_view_overhead_kind;
 
+/**
+ *  @brief Object a host synchronization call waits on
+ */
+typedef enum _pti_view_host_sync_type {
+  PTI_VIEW_HOST_SYNC_TYPE_INVALID = 0,        //!< Invalid host sync type
+  PTI_VIEW_HOST_SYNC_TYPE_EVENT = 1,          //!< zeEventHostSynchronize
+  PTI_VIEW_HOST_SYNC_TYPE_FENCE = 2,          //!< zeFenceHostSynchronize
+  PTI_VIEW_HOST_SYNC_TYPE_COMMAND_QUEUE = 3,  //!< zeCommandQueueSynchronize
+} pti_view_host_sync_type;
+
 /**
  * @brief Base View record type
  */
@@ -163,6 +183,16 @@ typedef struct pti_view_record_kernel {
   uint64_t _sycl_node_id;
   uint64_t _sycl_queue_id;                               //!< Device front-end queue id
   uint32_t _sycl_invocation_id;
+  uint64_t _kernel_info_id;                         //!< ID of the PTI_VIEW_KERNEL_INFO record of
+                                                    //!< the kernel, 0 if no information
+  uint32_t _replay_index;                           //!< Execution of the closed command list
+                                                    //!< (e.g., SYCL graph) the kernel was
+                                                    //!< appended to, 0 for the first one; records
+                                                    //!< of a node share _correlation_id;
+                                                    //!< not reported once mutable commands of
+                                                    //!< the list are updated
+  uint64_t _kernel_args_id;                         //!< ID of the PTI_VIEW_KERNEL_ARGS record of
+                                                    //!< the launch arguments, 0 if not collected
 } pti_view_record_kernel;
 
 /**
@@ -292,6 +322,144 @@ typedef struct pti_view_record_overhead {
   pti_view_overhead_kind  _overhead_kind;   //!< Type of overhead
 } pti_view_record_overhead;
 
+/**
+ * @brief Host Synchronization View record type
+ */
+typedef struct pti_view_record_host_sync {
+  pti_view_record_base _view_kind;                  //!< Base record
+  pti_view_host_sync_type _sync_type;               //!< Type of the object waited on
+  void* _sync_object_handle;                        //!< Handle of the waited event, fence or
+                                                    //!< command queue
+  uint64_t _start_timestamp;                        //!< Timestamp of the wait start on host, ns
+  uint64_t _end_timestamp;                          //!< Timestamp of the wait end on host, ns
+  uint32_t _thread_id;                              //!< Thread ID that waited
+  uint32_t _process_id;                             //!< Process ID that waited
+  uint32_t _correlation_id;                         //!< ID of the device operation completed
+                                                    //!< last during the wait, 0 if none
+  uint32_t _completed_count;                        //!< Number of device operations completed
+                                                    //!< during the wait
+  uint32_t _completed_correlation_ids[PTI_MAX_HOST_SYNC_CORRELATION_IDS];
+                                                    //!< IDs of the device operations completed
+                                                    //!< during the wait in completion order,
+                                                    //!< first PTI_MAX_HOST_SYNC_CORRELATION_IDS
+} pti_view_record_host_sync;
+
+/**
+ * @brief Kernel Info View record type, emitted once per kernel before its first launch record
+ */
+typedef struct pti_view_record_kernel_info {
+  pti_view_record_base _view_kind;                  //!< Base record
+  uint64_t _kernel_info_id;                         //!< Kernel ID, unique among all kernels,
+                                                    //!< launch records refer to it
+  const char* _name;                                //!< Kernel name
+  uint8_t _device_uuid[PTI_MAX_DEVICE_UUID_SIZE];   //!< Device uuid
+  uint8_t _module_uuid[PTI_MAX_MODULE_UUID_SIZE];   //!< Uuid of the module the kernel belongs to
+  uint64_t _binary_size;                            //!< Size of the native binary of the module,
+                                                    //!< bytes, 0 if no information
+  uint32_t _simd_width;                             //!< Maximum sub-group size
+  uint32_t _num_kernel_args;                        //!< Number of kernel arguments
+  uint32_t _private_mem_size;                       //!< Private memory per work-item, bytes
+  uint32_t _local_mem_size;                         //!< Shared local memory per work-group, bytes
+  uint32_t _spill_mem_size;                         //!< Register spill memory per work-item, bytes
+  uint32_t _required_group_size[3];                 //!< Required work-group size (x, y, z),
+                                                    //!< zeros if not required
+} pti_view_record_kernel_info;
+
+/**
+ * @brief Type of a metric value, the same as zet_value_type_t
+ */
+typedef enum _pti_metric_value_type {
+  PTI_METRIC_VALUE_TYPE_UINT32 = 0,       //!< 32-bit unsigned-integer
+  PTI_METRIC_VALUE_TYPE_UINT64 = 1,       //!< 64-bit unsigned-integer
+  PTI_METRIC_VALUE_TYPE_FLOAT32 = 2,      //!< 32-bit floating-point
+  PTI_METRIC_VALUE_TYPE_FLOAT64 = 3,      //!< 64-bit floating-point
+  PTI_METRIC_VALUE_TYPE_BOOL8 = 4,        //!< 8-bit boolean
+} pti_metric_value_type;
+
+/**
+ * @brief Metric value, its type is given by the schema
+ */
+typedef union _pti_metric_value {
+  uint32_t _ui32;
+  uint64_t _ui64;
+  float _fp32;
+  double _fp64;
+  uint8_t _b8;
+} pti_metric_value;
+
+/**
+ * @brief Schema of kernel metric records: names, units and types of the values.
+ *        Reported once, before the first metric record referring to it.
+ */
+typedef struct pti_view_record_kernel_metrics_schema {
+  pti_view_record_base _view_kind;                  //!< Base record
+  uint32_t _schema_id;                              //!< Schema ID, metric records refer to it
+  uint32_t _metric_count;                           //!< Number of metrics
+  const char* _metric_group_name;                   //!< Metric group, see
+                                                    //!< ptiViewSetKernelMetricGroup
+  const char* const* _metric_names;                 //!< Names of the metrics
+  const char* const* _metric_units;                 //!< Units of the metrics
+  const pti_metric_value_type* _metric_value_types; //!< Types of the metric values
+  uint8_t _device_uuid[PTI_MAX_DEVICE_UUID_SIZE];   //!< Device uuid
+} pti_view_record_kernel_metrics_schema;
+
+/**
+ * @brief Hardware metrics of one kernel launch
+ */
+typedef struct pti_view_record_kernel_metrics {
+  pti_view_record_base _view_kind;                  //!< Base record
+  uint32_t _correlation_id;                         //!< ID that correlates this record with records
+                                                    //!< of other Views
+  uint64_t _kernel_id;                              //!< Kernel ID, the same as in
+                                                    //!< pti_view_record_kernel
+  uint32_t _schema_id;                              //!< ID of the schema of the values
+  uint32_t _value_count;                            //!< Number of values, metrics of the schema
+                                                    //!< beyond PTI_MAX_KERNEL_METRIC_VALUES are
+                                                    //!< not reported
+  pti_metric_value _values[PTI_MAX_KERNEL_METRIC_VALUES];  //!< Values in the schema order
+} pti_view_record_kernel_metrics;
+
+/**
+ * @brief Kind of a kernel argument value
+ */
+typedef enum _pti_kernel_arg_type {
+  PTI_KERNEL_ARG_TYPE_NOT_SET = 0,        //!< Not set while PTI_VIEW_KERNEL_ARGS was enabled
+  PTI_KERNEL_ARG_TYPE_VALUE = 1,          //!< Value passed by copy
+  PTI_KERNEL_ARG_TYPE_POINTER = 2,        //!< Address of a USM allocation
+  PTI_KERNEL_ARG_TYPE_LOCAL = 3,          //!< Shared local memory of _size bytes, or a null
+                                          //!< pointer, set without a value
+} pti_kernel_arg_type;
+
+/**
+ * @brief Argument of a kernel launch
+ */
+typedef struct pti_kernel_arg {
+  uint32_t _index;                                  //!< Argument index
+  uint32_t _size;                                   //!< Size of the value, bytes
+  pti_kernel_arg_type _type;                        //!< Kind of the value
+  pti_view_memory_type _memory_type;                //!< Memory the pointer points to,
+                                                    //!< PTI_VIEW_MEMORY_TYPE_MEMORY otherwise
+  uint64_t _value;                                  //!< Value of up to 8 bytes zero extended,
+                                                    //!< the address of a pointer
+  const uint8_t* _data;                             //!< Bytes of a value larger than 8 bytes,
+                                                    //!< nullptr otherwise
+} pti_kernel_arg;
+
+/**
+ * @brief Argument values of kernel launches, emitted once per kernel and distinct argument set,
+ *        before the first launch record referring to it
+ */
+typedef struct pti_view_record_kernel_args {
+  pti_view_record_base _view_kind;                  //!< Base record
+  uint64_t _kernel_args_id;                         //!< Argument set ID, launch records refer to it
+  uint64_t _kernel_info_id;                         //!< ID of the PTI_VIEW_KERNEL_INFO record of
+                                                    //!< the kernel
+  uint32_t _arg_count;                              //!< Number of arguments
+  const pti_kernel_arg* _args;                      //!< Arguments in index order, valid until
+                                                    //!< the buffer completed callback of the
+                                                    //!< buffer holding the record returns
+} pti_view_record_kernel_args;
+
 typedef void (*pti_fptr_buffer_completed)(unsigned char* buffer,
                                              size_t buffer_size_in_bytes,
                                              size_t used_bytes);
@@ -326,6 +494,64 @@ pti_result PTI_EXPORT ptiViewEnable(pti_view_kind view_kind);
  */
 pti_result PTI_EXPORT ptiViewDisable(pti_view_kind view_kind);
 
+/**
+ * @brief Restricts collection of GPU operations to the queue.
+ *        Once a queue is added, operations submitted to other queues are not reported.
+ *        Queue of an immediate command list is the command list handle, the same as
+ *        _queue_handle of the records, and operations appended to immediate command lists of
+ *        other queues are not instrumented. The queue of a regular command list is not known
+ *        until the list is executed: operations appended to regular command lists are
+ *        instrumented with the profiling events whatever queue they end up on, and only their
+ *        records are dropped, after execution, if they ran on other queues. The overhead of
+ *        the events is not saved for regular command lists.
+ *
+ * @param queue back-end queue handle, e.g. the native handle of a SYCL queue
+ * @return pti_result
+ */
+pti_result PTI_EXPORT ptiViewEnableForQueue(ze_command_queue_handle_t queue);
+
+/**
+ * @brief Restricts collection of GPU operations to the ones submitted from the thread.
+ *        Once a thread is added, operations submitted from other threads are not instrumented
+ *        and not reported. The thread checked is the one appending the operation to a command
+ *        list: operations appended to a regular command list by the thread are reported
+ *        whichever thread executes the list, the ones appended by other threads are not.
+ *        Combined with ptiViewEnableForQueue, both must match.
+ *
+ * @param thread_id thread ID, the same as _thread_id of the records
+ * @return pti_result
+ */
+pti_result PTI_EXPORT ptiViewEnableForThread(uint32_t thread_id);
+
+/**
+ * @brief Removes the queues and threads added by ptiViewEnableForQueue/ptiViewEnableForThread,
+ *        GPU operations of all queues and threads are collected again
+ *
+ * @return pti_result
+ */
+pti_result PTI_EXPORT ptiViewResetScope();
+
+/**
+ * @brief Sets the metric group sampled around kernels for PTI_VIEW_DEVICE_GPU_KERNEL_METRICS,
+ *        "ComputeBasic" by default. Can not be changed while the view is enabled.
+ *        Metrics require ZET_ENABLE_METRICS=1 set before Level-Zero initialization.
+ *
+ * @param metric_group_name name of an event based metric group of the device
+ * @return pti_result
+ */
+pti_result PTI_EXPORT ptiViewSetKernelMetricGroup(const char* metric_group_name);
+
+/**
+ * @brief Sets when buffers are delivered before they are full: a buffer holding a record for
+ *        max_latency_ms milliseconds is delivered if it holds at least min_fill bytes of records.
+ *        Applies to the buffers of all threads and clients. Disabled by default.
+ *
+ * @param max_latency_ms maximum time a record waits in a buffer, 0 disables the policy
+ * @param min_fill minimum bytes of records in a buffer delivered early, 0 for any record
+ * @return pti_result
+ */
+pti_result PTI_EXPORT ptiViewSetFlushPolicy(uint32_t max_latency_ms, size_t min_fill);
+
 /**
  * @brief Returns if GPU Local view is supported by the installed driver
  *
@@ -340,6 +566,60 @@ pti_result PTI_EXPORT ptiViewGPULocalAvailable();
  */
 pti_result PTI_EXPORT ptiFlushAllViews();
 
+/**
+ * @brief Handle of a client: an independent consumer of view records with its own buffer
+ *        callbacks and enabled view kinds. Clients let several tools in one process collect
+ *        views without replacing each other's callbacks; ptiView* functions above work with
+ *        the default client.
+ */
+typedef struct _pti_client* pti_client_handle;
+
+/**
+ * @brief Creates a client. No view kind is enabled for a new client.
+ *
+ * @param client returned client handle
+ * @return pti_result
+ */
+pti_result PTI_EXPORT ptiClientCreate(pti_client_handle* client);
+
+/**
+ * @brief Disables all views of the client, delivers its buffers by calling its bufferCompleted
+ *        callback and destroys the client
+ *
+ * @return pti_result
+ */
+pti_result PTI_EXPORT ptiClientDestroy(pti_client_handle client);
+
+/**
+ * @brief Sets the buffer management callbacks of the client, see ptiViewSetCallbacks
+ *
+ * @return pti_result
+ */
+pti_result PTI_EXPORT
+ptiClientSetCallbacks(pti_client_handle client, pti_fptr_buffer_requested fptr_bufferRequested,
+                      pti_fptr_buffer_completed fptr_bufferCompleted);
+
+/**
+ * @brief Enables View of specific group of operations for the client
+ *
+ * @return pti_result
+ */
+pti_result PTI_EXPORT ptiClientEnable(pti_client_handle client, pti_view_kind view_kind);
+
+/**
+ * @brief Disables View of specific group of operations for the client
+ *
+ * @return pti_result
+ */
+pti_result PTI_EXPORT ptiClientDisable(pti_client_handle client, pti_view_kind view_kind);
+
+/**
+ * @brief Flushes all view records of the client by calling its bufferCompleted callback
+ *
+ * @return pti_result
+ */
+pti_result PTI_EXPORT ptiClientFlushViews(pti_client_handle client);
+
 /**
  * @brief Gets next view record in buffer.
  *
@@ -393,6 +673,14 @@ ptiViewMemoryTypeToString( pti_view_memory_type type );
 PTI_EXPORT const char*
 ptiViewMemcpyTypeToString( pti_view_memcpy_type type );
 
+/**
+ * @brief Helper function to return stringified enum types for pti_view_host_sync_type.
+ *
+ * @return const char*
+ */
+PTI_EXPORT const char*
+ptiViewHostSyncTypeToString( pti_view_host_sync_type type );
+
 /**
  * @brief Returns current pti host timestamp in nanoseconds. The timestamp is in the same domain as view records timestamps.  
  *
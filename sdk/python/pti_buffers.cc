@@ -0,0 +1,634 @@
+//==============================================================
+// Copyright (C) Intel Corporation
+//
+// SPDX-License-Identifier: MIT
+// =============================================================
+
+// pti_buffers: Python module turning PTI view buffers into NumPy structured arrays, one per view
+// kind, in a single pass in C++ instead of a Python loop over ptiViewGetNextRecord.
+//
+// Records are copied as is into arrays of the dtype of their kind, the dtype mirrors the layout of
+// the record struct and its fields are named after the struct members without the leading
+// underscore. String fields hold ids into Decoder.strings instead of pointers, 0 for null; the
+// metric names, units and value types of the schema records and the arguments of the kernel
+// argument records are ids of tuples in the same table.
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "pti/pti_view.h"
+#include "view_record_info.h"
+
+namespace {
+
+enum class FieldType {
+  kValue,       // copied as is
+  kString,      // const char*, replaced with the id of the string
+  kStringList,  // const char* const* of count strings, replaced with the id of a tuple
+  kTypeList,    // const pti_metric_value_type* of count types, the same
+  kArgList,     // const pti_kernel_arg* of count arguments, the same, tuple of argument tuples
+};
+
+struct Field {
+  const char* name;
+  const char* format;  // NumPy format of the field
+  size_t offset;
+  FieldType type;
+  size_t count_offset = 0;  // lists only, offset of the uint32_t item count
+};
+
+struct RecordLayout {
+  pti_view_kind kind;
+  const char* name;
+  std::vector<Field> fields;
+};
+
+#define PTI_FIELD(record, member, format) {#member + 1, format, offsetof(record, member), \
+                                           FieldType::kValue}
+#define PTI_STRING_FIELD(record, member, type) {#member + 1, "u8", offsetof(record, member), type}
+#define PTI_LIST_FIELD(record, member, count, type) {#member + 1, "u8", offsetof(record, member), \
+                                                     type, offsetof(record, count)}
+
+// clang-format off
+const std::vector<RecordLayout> kRecordLayouts = {
+    {PTI_VIEW_DEVICE_GPU_KERNEL, "DEVICE_GPU_KERNEL", {
+        PTI_FIELD(pti_view_record_kernel, _view_kind, "u4"),
+        PTI_FIELD(pti_view_record_kernel, _queue_handle, "u8"),
+        PTI_FIELD(pti_view_record_kernel, _context_handle, "u8"),
+        PTI_STRING_FIELD(pti_view_record_kernel, _name, FieldType::kString),
+        PTI_STRING_FIELD(pti_view_record_kernel, _source_file_name, FieldType::kString),
+        PTI_FIELD(pti_view_record_kernel, _source_line_number, "u8"),
+        PTI_FIELD(pti_view_record_kernel, _kernel_id, "u8"),
+        PTI_FIELD(pti_view_record_kernel, _correlation_id, "u4"),
+        PTI_FIELD(pti_view_record_kernel, _thread_id, "u4"),
+        PTI_FIELD(pti_view_record_kernel, _pci_address, "S16"),
+        PTI_FIELD(pti_view_record_kernel, _device_uuid, "(16,)u1"),
+        PTI_FIELD(pti_view_record_kernel, _append_timestamp, "u8"),
+        PTI_FIELD(pti_view_record_kernel, _start_timestamp, "u8"),
+        PTI_FIELD(pti_view_record_kernel, _end_timestamp, "u8"),
+        PTI_FIELD(pti_view_record_kernel, _submit_timestamp, "u8"),
+        PTI_FIELD(pti_view_record_kernel, _sycl_task_begin_timestamp, "u8"),
+        PTI_FIELD(pti_view_record_kernel, _sycl_enqk_begin_timestamp, "u8"),
+        PTI_FIELD(pti_view_record_kernel, _sycl_node_id, "u8"),
+        PTI_FIELD(pti_view_record_kernel, _sycl_queue_id, "u8"),
+        PTI_FIELD(pti_view_record_kernel, _sycl_invocation_id, "u4"),
+        PTI_FIELD(pti_view_record_kernel, _kernel_info_id, "u8"),
+        PTI_FIELD(pti_view_record_kernel, _replay_index, "u4"),
+        PTI_FIELD(pti_view_record_kernel, _kernel_args_id, "u8")}},
+    {PTI_VIEW_COLLECTION_OVERHEAD, "COLLECTION_OVERHEAD", {
+        PTI_FIELD(pti_view_record_overhead, _view_kind, "u4"),
+        PTI_FIELD(pti_view_record_overhead, _overhead_start_timestamp_ns, "u8"),
+        PTI_FIELD(pti_view_record_overhead, _overhead_end_timestamp_ns, "u8"),
+        PTI_FIELD(pti_view_record_overhead, _overhead_thread_id, "u8"),
+        PTI_FIELD(pti_view_record_overhead, _overhead_count, "u8"),
+        PTI_FIELD(pti_view_record_overhead, _overhead_duration_ns, "u8"),
+        PTI_FIELD(pti_view_record_overhead, _overhead_kind, "u4")}},
+    {PTI_VIEW_SYCL_RUNTIME_CALLS, "SYCL_RUNTIME_CALLS", {
+        PTI_FIELD(pti_view_record_sycl_runtime, _view_kind, "u4"),
+        PTI_STRING_FIELD(pti_view_record_sycl_runtime, _name, FieldType::kString),
+        PTI_FIELD(pti_view_record_sycl_runtime, _start_timestamp, "u8"),
+        PTI_FIELD(pti_view_record_sycl_runtime, _end_timestamp, "u8"),
+        PTI_FIELD(pti_view_record_sycl_runtime, _process_id, "u4"),
+        PTI_FIELD(pti_view_record_sycl_runtime, _thread_id, "u4"),
+        PTI_FIELD(pti_view_record_sycl_runtime, _correlation_id, "u4")}},
+    {PTI_VIEW_EXTERNAL_CORRELATION, "EXTERNAL_CORRELATION", {
+        PTI_FIELD(pti_view_record_external_correlation, _view_kind, "u4"),
+        PTI_FIELD(pti_view_record_external_correlation, _correlation_id, "u4"),
+        PTI_FIELD(pti_view_record_external_correlation, _external_id, "u8"),
+        PTI_FIELD(pti_view_record_external_correlation, _external_kind, "u4")}},
+    {PTI_VIEW_DEVICE_GPU_MEM_COPY, "DEVICE_GPU_MEM_COPY", {
+        PTI_FIELD(pti_view_record_memory_copy, _view_kind, "u4"),
+        PTI_FIELD(pti_view_record_memory_copy, _memcpy_type, "u4"),
+        PTI_FIELD(pti_view_record_memory_copy, _mem_src, "u4"),
+        PTI_FIELD(pti_view_record_memory_copy, _mem_dst, "u4"),
+        PTI_FIELD(pti_view_record_memory_copy, _queue_handle, "u8"),
+        PTI_FIELD(pti_view_record_memory_copy, _context_handle, "u8"),
+        PTI_STRING_FIELD(pti_view_record_memory_copy, _name, FieldType::kString),
+        PTI_FIELD(pti_view_record_memory_copy, _pci_address, "S16"),
+        PTI_FIELD(pti_view_record_memory_copy, _device_uuid, "(16,)u1"),
+        PTI_FIELD(pti_view_record_memory_copy, _mem_op_id, "u8"),
+        PTI_FIELD(pti_view_record_memory_copy, _correlation_id, "u4"),
+        PTI_FIELD(pti_view_record_memory_copy, _thread_id, "u4"),
+        PTI_FIELD(pti_view_record_memory_copy, _append_timestamp, "u8"),
+        PTI_FIELD(pti_view_record_memory_copy, _start_timestamp, "u8"),
+        PTI_FIELD(pti_view_record_memory_copy, _end_timestamp, "u8"),
+        PTI_FIELD(pti_view_record_memory_copy, _submit_timestamp, "u8"),
+        PTI_FIELD(pti_view_record_memory_copy, _bytes, "u8"),
+        PTI_FIELD(pti_view_record_memory_copy, _sycl_queue_id, "u8")}},
+    {PTI_VIEW_DEVICE_GPU_MEM_FILL, "DEVICE_GPU_MEM_FILL", {
+        PTI_FIELD(pti_view_record_memory_fill, _view_kind, "u4"),
+        PTI_FIELD(pti_view_record_memory_fill, _mem_type, "u4"),
+        PTI_FIELD(pti_view_record_memory_fill, _queue_handle, "u8"),
+        PTI_FIELD(pti_view_record_memory_fill, _context_handle, "u8"),
+        PTI_STRING_FIELD(pti_view_record_memory_fill, _name, FieldType::kString),
+        PTI_FIELD(pti_view_record_memory_fill, _pci_address, "S16"),
+        PTI_FIELD(pti_view_record_memory_fill, _device_uuid, "(16,)u1"),
+        PTI_FIELD(pti_view_record_memory_fill, _mem_op_id, "u8"),
+        PTI_FIELD(pti_view_record_memory_fill, _correlation_id, "u4"),
+        PTI_FIELD(pti_view_record_memory_fill, _thread_id, "u4"),
+        PTI_FIELD(pti_view_record_memory_fill, _append_timestamp, "u8"),
+        PTI_FIELD(pti_view_record_memory_fill, _start_timestamp, "u8"),
+        PTI_FIELD(pti_view_record_memory_fill, _end_timestamp, "u8"),
+        PTI_FIELD(pti_view_record_memory_fill, _submit_timestamp, "u8"),
+        PTI_FIELD(pti_view_record_memory_fill, _bytes, "u8"),
+        PTI_FIELD(pti_view_record_memory_fill, _value_for_set, "u8"),
+        PTI_FIELD(pti_view_record_memory_fill, _sycl_queue_id, "u8")}},
+    {PTI_VIEW_DEVICE_GPU_MEM_COPY_P2P, "DEVICE_GPU_MEM_COPY_P2P", {
+        PTI_FIELD(pti_view_record_memory_copy_p2p, _view_kind, "u4"),
+        PTI_FIELD(pti_view_record_memory_copy_p2p, _memcpy_type, "u4"),
+        PTI_FIELD(pti_view_record_memory_copy_p2p, _mem_src, "u4"),
+        PTI_FIELD(pti_view_record_memory_copy_p2p, _mem_dst, "u4"),
+        PTI_FIELD(pti_view_record_memory_copy_p2p, _queue_handle, "u8"),
+        PTI_FIELD(pti_view_record_memory_copy_p2p, _context_handle, "u8"),
+        PTI_STRING_FIELD(pti_view_record_memory_copy_p2p, _name, FieldType::kString),
+        PTI_FIELD(pti_view_record_memory_copy_p2p, _src_pci_address, "S16"),
+        PTI_FIELD(pti_view_record_memory_copy_p2p, _dst_pci_address, "S16"),
+        PTI_FIELD(pti_view_record_memory_copy_p2p, _src_uuid, "(16,)u1"),
+        PTI_FIELD(pti_view_record_memory_copy_p2p, _dst_uuid, "(16,)u1"),
+        PTI_FIELD(pti_view_record_memory_copy_p2p, _mem_op_id, "u8"),
+        PTI_FIELD(pti_view_record_memory_copy_p2p, _correlation_id, "u4"),
+        PTI_FIELD(pti_view_record_memory_copy_p2p, _thread_id, "u4"),
+        PTI_FIELD(pti_view_record_memory_copy_p2p, _append_timestamp, "u8"),
+        PTI_FIELD(pti_view_record_memory_copy_p2p, _start_timestamp, "u8"),
+        PTI_FIELD(pti_view_record_memory_copy_p2p, _end_timestamp, "u8"),
+        PTI_FIELD(pti_view_record_memory_copy_p2p, _submit_timestamp, "u8"),
+        PTI_FIELD(pti_view_record_memory_copy_p2p, _bytes, "u8"),
+        PTI_FIELD(pti_view_record_memory_copy_p2p, _sycl_queue_id, "u8")}},
+    {PTI_VIEW_HOST_SYNC, "HOST_SYNC", {
+        PTI_FIELD(pti_view_record_host_sync, _view_kind, "u4"),
+        PTI_FIELD(pti_view_record_host_sync, _sync_type, "u4"),
+        PTI_FIELD(pti_view_record_host_sync, _sync_object_handle, "u8"),
+        PTI_FIELD(pti_view_record_host_sync, _start_timestamp, "u8"),
+        PTI_FIELD(pti_view_record_host_sync, _end_timestamp, "u8"),
+        PTI_FIELD(pti_view_record_host_sync, _thread_id, "u4"),
+        PTI_FIELD(pti_view_record_host_sync, _process_id, "u4"),
+        PTI_FIELD(pti_view_record_host_sync, _correlation_id, "u4"),
+        PTI_FIELD(pti_view_record_host_sync, _completed_count, "u4"),
+        PTI_FIELD(pti_view_record_host_sync, _completed_correlation_ids, "(8,)u4")}},
+    {PTI_VIEW_KERNEL_INFO, "KERNEL_INFO", {
+        PTI_FIELD(pti_view_record_kernel_info, _view_kind, "u4"),
+        PTI_FIELD(pti_view_record_kernel_info, _kernel_info_id, "u8"),
+        PTI_STRING_FIELD(pti_view_record_kernel_info, _name, FieldType::kString),
+        PTI_FIELD(pti_view_record_kernel_info, _device_uuid, "(16,)u1"),
+        PTI_FIELD(pti_view_record_kernel_info, _module_uuid, "(16,)u1"),
+        PTI_FIELD(pti_view_record_kernel_info, _binary_size, "u8"),
+        PTI_FIELD(pti_view_record_kernel_info, _simd_width, "u4"),
+        PTI_FIELD(pti_view_record_kernel_info, _num_kernel_args, "u4"),
+        PTI_FIELD(pti_view_record_kernel_info, _private_mem_size, "u4"),
+        PTI_FIELD(pti_view_record_kernel_info, _local_mem_size, "u4"),
+        PTI_FIELD(pti_view_record_kernel_info, _spill_mem_size, "u4"),
+        PTI_FIELD(pti_view_record_kernel_info, _required_group_size, "(3,)u4")}},
+    // values are raw 8 bytes, to be viewed with the types of the schema
+    {PTI_VIEW_DEVICE_GPU_KERNEL_METRICS, "DEVICE_GPU_KERNEL_METRICS", {
+        PTI_FIELD(pti_view_record_kernel_metrics, _view_kind, "u4"),
+        PTI_FIELD(pti_view_record_kernel_metrics, _correlation_id, "u4"),
+        PTI_FIELD(pti_view_record_kernel_metrics, _kernel_id, "u8"),
+        PTI_FIELD(pti_view_record_kernel_metrics, _schema_id, "u4"),
+        PTI_FIELD(pti_view_record_kernel_metrics, _value_count, "u4"),
+        PTI_FIELD(pti_view_record_kernel_metrics, _values, "(64,)u8")}},
+    {PTI_VIEW_DEVICE_GPU_KERNEL_METRICS_SCHEMA, "DEVICE_GPU_KERNEL_METRICS_SCHEMA", {
+        PTI_FIELD(pti_view_record_kernel_metrics_schema, _view_kind, "u4"),
+        PTI_FIELD(pti_view_record_kernel_metrics_schema, _schema_id, "u4"),
+        PTI_FIELD(pti_view_record_kernel_metrics_schema, _metric_count, "u4"),
+        PTI_STRING_FIELD(pti_view_record_kernel_metrics_schema, _metric_group_name,
+                         FieldType::kString),
+        PTI_LIST_FIELD(pti_view_record_kernel_metrics_schema, _metric_names, _metric_count,
+                       FieldType::kStringList),
+        PTI_LIST_FIELD(pti_view_record_kernel_metrics_schema, _metric_units, _metric_count,
+                       FieldType::kStringList),
+        PTI_LIST_FIELD(pti_view_record_kernel_metrics_schema, _metric_value_types, _metric_count,
+                       FieldType::kTypeList),
+        PTI_FIELD(pti_view_record_kernel_metrics_schema, _device_uuid, "(16,)u1")}},
+    // arguments are (index, size, type, memory_type, value, data) tuples, data is bytes of values
+    // larger than 8 bytes or None
+    {PTI_VIEW_KERNEL_ARGS, "KERNEL_ARGS", {
+        PTI_FIELD(pti_view_record_kernel_args, _view_kind, "u4"),
+        PTI_FIELD(pti_view_record_kernel_args, _kernel_args_id, "u8"),
+        PTI_FIELD(pti_view_record_kernel_args, _kernel_info_id, "u8"),
+        PTI_FIELD(pti_view_record_kernel_args, _arg_count, "u4"),
+        PTI_LIST_FIELD(pti_view_record_kernel_args, _args, _arg_count, FieldType::kArgList)}},
+};
+// clang-format on
+
+#undef PTI_FIELD
+#undef PTI_STRING_FIELD
+#undef PTI_LIST_FIELD
+
+static_assert(sizeof(uint64_t) == sizeof(const char*), "String ids replace pointers in place");
+static_assert(PTI_MAX_KERNEL_METRIC_VALUES == 64, "Metric values format is (64,)u8");
+static_assert(PTI_MAX_HOST_SYNC_CORRELATION_IDS == 8, "Completed ids format is (8,)u4");
+
+const RecordLayout* GetLayout(uint32_t kind) {
+  for (const auto& layout : kRecordLayouts) {
+    if (static_cast<uint32_t>(layout.kind) == kind) {
+      return &layout;
+    }
+  }
+  return nullptr;
+}
+
+// numpy.dtype of each kind, created at the module initialization
+std::map<uint32_t, PyObject*> dtypes;
+PyObject* numpy_empty = nullptr;
+
+PyObject* CreateDtype(PyObject* numpy_dtype, const RecordLayout& layout) {
+  PyObject* names = PyList_New(0);
+  PyObject* formats = PyList_New(0);
+  PyObject* offsets = PyList_New(0);
+  PyObject* spec = PyDict_New();
+  PyObject* dtype = nullptr;
+  if (names != nullptr && formats != nullptr && offsets != nullptr && spec != nullptr) {
+    bool ok = true;
+    for (const auto& field : layout.fields) {
+      PyObject* name = PyUnicode_FromString(field.name);
+      PyObject* format = PyUnicode_FromString(field.format);
+      PyObject* offset = PyLong_FromSize_t(field.offset);
+      ok = ok && name != nullptr && format != nullptr && offset != nullptr &&
+           PyList_Append(names, name) == 0 && PyList_Append(formats, format) == 0 &&
+           PyList_Append(offsets, offset) == 0;
+      Py_XDECREF(name);
+      Py_XDECREF(format);
+      Py_XDECREF(offset);
+    }
+    PyObject* itemsize = PyLong_FromSize_t(GetViewSize(layout.kind));
+    ok = ok && itemsize != nullptr && PyDict_SetItemString(spec, "names", names) == 0 &&
+         PyDict_SetItemString(spec, "formats", formats) == 0 &&
+         PyDict_SetItemString(spec, "offsets", offsets) == 0 &&
+         PyDict_SetItemString(spec, "itemsize", itemsize) == 0;
+    Py_XDECREF(itemsize);
+    if (ok) {
+      dtype = PyObject_CallOneArg(numpy_dtype, spec);
+    }
+  }
+  Py_XDECREF(names);
+  Py_XDECREF(formats);
+  Py_XDECREF(offsets);
+  Py_XDECREF(spec);
+  return dtype;
+}
+
+//
+// Decoder
+//
+
+struct Decoder {
+  PyObject_HEAD
+  PyObject* strings;  // list, strings[0] is None for null
+  std::unordered_map<std::string, uint64_t>* string_ids;
+  std::unordered_map<std::string, uint64_t>* list_ids;
+};
+
+// Returns the id of the string in decoder->strings, adding it if it is new; 0 on error
+uint64_t InternString(Decoder* decoder, const char* str) {
+  if (str == nullptr) {
+    return 0;
+  }
+  std::string key(str);
+  auto it = decoder->string_ids->find(key);
+  if (it != decoder->string_ids->end()) {
+    return it->second;
+  }
+  PyObject* value = PyUnicode_DecodeUTF8(key.data(), key.size(), "replace");
+  if (value == nullptr || PyList_Append(decoder->strings, value) != 0) {
+    Py_XDECREF(value);
+    return 0;
+  }
+  Py_DECREF(value);
+  uint64_t id = PyList_GET_SIZE(decoder->strings) - 1;
+  decoder->string_ids->emplace(std::move(key), id);
+  return id;
+}
+
+// Returns the id of the tuple of count items of the list in decoder->strings; 0 on error
+uint64_t InternList(Decoder* decoder, const void* list, uint32_t count, FieldType type) {
+  if (list == nullptr) {
+    return 0;
+  }
+  char kind = 't';
+  if (type == FieldType::kStringList) {
+    kind = 's';
+  } else if (type == FieldType::kArgList) {
+    kind = 'a';
+  }
+  std::string key(1, kind);
+  if (type == FieldType::kStringList) {
+    const auto* strings = static_cast<const char* const*>(list);
+    for (uint32_t i = 0; i < count; ++i) {
+      key.append(strings[i] != nullptr ? strings[i] : "").push_back('\0');
+    }
+  } else if (type == FieldType::kArgList) {
+    const auto* kernel_args = static_cast<const pti_kernel_arg*>(list);
+    for (uint32_t i = 0; i < count; ++i) {
+      const pti_kernel_arg& arg = kernel_args[i];
+      key.append(reinterpret_cast<const char*>(&arg), offsetof(pti_kernel_arg, _data));
+      if (arg._data != nullptr) {
+        key.append(reinterpret_cast<const char*>(arg._data), arg._size);
+      }
+    }
+  } else {
+    key.append(static_cast<const char*>(list), count * sizeof(pti_metric_value_type));
+  }
+  auto it = decoder->list_ids->find(key);
+  if (it != decoder->list_ids->end()) {
+    return it->second;
+  }
+
+  PyObject* value = PyTuple_New(count);
+  if (value == nullptr) {
+    return 0;
+  }
+  for (uint32_t i = 0; i < count; ++i) {
+    PyObject* item = nullptr;
+    if (type == FieldType::kStringList) {
+      const char* str = static_cast<const char* const*>(list)[i];
+      item = PyUnicode_DecodeUTF8(str != nullptr ? str : "", str != nullptr ? strlen(str) : 0,
+                                  "replace");
+    } else if (type == FieldType::kArgList) {
+      const pti_kernel_arg& arg = static_cast<const pti_kernel_arg*>(list)[i];
+      PyObject* data = Py_None;
+      Py_INCREF(data);
+      if (arg._data != nullptr) {
+        Py_DECREF(data);
+        data = PyBytes_FromStringAndSize(reinterpret_cast<const char*>(arg._data), arg._size);
+      }
+      if (data != nullptr) {
+        item = Py_BuildValue("(IIiiKN)", arg._index, arg._size, static_cast<int>(arg._type),
+                             static_cast<int>(arg._memory_type),
+                             static_cast<unsigned long long>(arg._value), data);
+      }
+    } else {
+      item = PyLong_FromLong(static_cast<const pti_metric_value_type*>(list)[i]);
+    }
+    if (item == nullptr) {
+      Py_DECREF(value);
+      return 0;
+    }
+    PyTuple_SET_ITEM(value, i, item);
+  }
+  if (PyList_Append(decoder->strings, value) != 0) {
+    Py_DECREF(value);
+    return 0;
+  }
+  Py_DECREF(value);
+  uint64_t id = PyList_GET_SIZE(decoder->strings) - 1;
+  decoder->list_ids->emplace(std::move(key), id);
+  return id;
+}
+
+// Replaces the pointers of the string fields of the record copy with ids, false on error
+bool InternFields(Decoder* decoder, const RecordLayout& layout, const uint8_t* record,
+                  uint8_t* copy) {
+  for (const auto& field : layout.fields) {
+    if (field.type == FieldType::kValue) {
+      continue;
+    }
+    const void* ptr = nullptr;
+    std::memcpy(&ptr, record + field.offset, sizeof(ptr));
+    uint64_t id = 0;
+    if (field.type == FieldType::kString) {
+      id = InternString(decoder, static_cast<const char*>(ptr));
+    } else {
+      uint32_t count = 0;
+      std::memcpy(&count, record + field.count_offset, sizeof(count));
+      id = InternList(decoder, ptr, count, field.type);
+    }
+    if (id == 0 && ptr != nullptr) {
+      return false;
+    }
+    std::memcpy(copy + field.offset, &id, sizeof(id));
+  }
+  return true;
+}
+
+PyObject* DecoderNew(PyTypeObject* type, PyObject* /*args*/, PyObject* /*kwds*/) {
+  auto* decoder = reinterpret_cast<Decoder*>(type->tp_alloc(type, 0));
+  if (decoder == nullptr) {
+    return nullptr;
+  }
+  decoder->strings = PyList_New(0);
+  if (decoder->strings == nullptr || PyList_Append(decoder->strings, Py_None) != 0) {
+    Py_DECREF(decoder);
+    return nullptr;
+  }
+  decoder->string_ids = new std::unordered_map<std::string, uint64_t>();
+  decoder->list_ids = new std::unordered_map<std::string, uint64_t>();
+  return reinterpret_cast<PyObject*>(decoder);
+}
+
+void DecoderDealloc(Decoder* decoder) {
+  Py_XDECREF(decoder->strings);
+  delete decoder->string_ids;
+  delete decoder->list_ids;
+  PyTypeObject* type = Py_TYPE(decoder);
+  type->tp_free(reinterpret_cast<PyObject*>(decoder));
+  Py_DECREF(type);
+}
+
+// Returns the records grouped by kind; on error sets the Python exception and returns nullptr
+PyObject* Decode(Decoder* decoder, const uint8_t* data, size_t size) {
+  std::map<uint32_t, std::vector<const uint8_t*>> records;
+  size_t offset = 0;
+  const char* error = nullptr;
+  Py_BEGIN_ALLOW_THREADS;
+  while (offset < size) {
+    uint32_t kind = 0;
+    if (size - offset < sizeof(kind)) {
+      error = "Truncated record";
+      break;
+    }
+    std::memcpy(&kind, data + offset, sizeof(kind));
+    size_t record_size = GetViewSize(static_cast<pti_view_kind>(kind));
+    if (record_size == SIZE_MAX || GetLayout(kind) == nullptr) {
+      error = "Unknown record kind";
+      break;
+    }
+    if (size - offset < record_size) {
+      error = "Truncated record";
+      break;
+    }
+    records[kind].push_back(data + offset);
+    offset += record_size;
+  }
+  Py_END_ALLOW_THREADS;
+  if (error != nullptr) {
+    PyErr_Format(PyExc_ValueError, "%s at offset %zu", error, offset);
+    return nullptr;
+  }
+
+  PyObject* result = PyDict_New();
+  if (result == nullptr) {
+    return nullptr;
+  }
+  for (const auto& [kind, kind_records] : records) {
+    const RecordLayout& layout = *GetLayout(kind);
+    size_t record_size = GetViewSize(layout.kind);
+    PyObject* array = PyObject_CallFunction(numpy_empty, "nO",
+                                            static_cast<Py_ssize_t>(kind_records.size()),
+                                            dtypes.at(kind));
+    if (array == nullptr) {
+      Py_DECREF(result);
+      return nullptr;
+    }
+    Py_buffer view;
+    if (PyObject_GetBuffer(array, &view, PyBUF_WRITABLE | PyBUF_C_CONTIGUOUS) != 0) {
+      Py_DECREF(array);
+      Py_DECREF(result);
+      return nullptr;
+    }
+    auto* copy = static_cast<uint8_t*>(view.buf);
+    bool ok = true;
+    for (const uint8_t* record : kind_records) {
+      std::memcpy(copy, record, record_size);
+      if (!InternFields(decoder, layout, record, copy)) {
+        ok = false;
+        break;
+      }
+      copy += record_size;
+    }
+    PyBuffer_Release(&view);
+    PyObject* key = PyLong_FromUnsignedLong(kind);
+    if (!ok || key == nullptr || PyDict_SetItem(result, key, array) != 0) {
+      Py_XDECREF(key);
+      Py_DECREF(array);
+      Py_DECREF(result);
+      return nullptr;
+    }
+    Py_DECREF(key);
+    Py_DECREF(array);
+  }
+  return result;
+}
+
+PyObject* DecoderDecode(Decoder* decoder, PyObject* args, PyObject* kwds) {
+  static const char* kKeywords[] = {"buffer", "used_bytes", nullptr};
+  Py_buffer buffer;
+  Py_ssize_t used_bytes = -1;
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "y*|n", const_cast<char**>(kKeywords), &buffer,
+                                   &used_bytes)) {
+    return nullptr;
+  }
+  if (used_bytes > buffer.len) {
+    PyBuffer_Release(&buffer);
+    PyErr_SetString(PyExc_ValueError, "used_bytes exceeds the buffer size");
+    return nullptr;
+  }
+  size_t size = static_cast<size_t>(used_bytes < 0 ? buffer.len : used_bytes);
+  PyObject* result = Decode(decoder, static_cast<const uint8_t*>(buffer.buf), size);
+  PyBuffer_Release(&buffer);
+  return result;
+}
+
+PyObject* DecoderGetStrings(Decoder* decoder, void* /*closure*/) {
+  Py_INCREF(decoder->strings);
+  return decoder->strings;
+}
+
+PyMethodDef decoder_methods[] = {
+    {"decode", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)()>(DecoderDecode)),
+     METH_VARARGS | METH_KEYWORDS,
+     "decode(buffer, used_bytes=-1) -> dict\n\n"
+     "Groups the records of a PTI view buffer by kind: {kind: numpy structured array}.\n"
+     "buffer is any object supporting the buffer protocol, e.g. a ctypes array over the buffer\n"
+     "given to the buffer completed callback; it is read during the call only. String fields\n"
+     "of the arrays are ids into strings."},
+    {nullptr, nullptr, 0, nullptr}};
+
+PyGetSetDef decoder_getset[] = {
+    {"strings", reinterpret_cast<getter>(DecoderGetStrings), nullptr,
+     "Strings the string fields refer to, shared by all buffers decoded; strings[0] is None",
+     nullptr},
+    {nullptr, nullptr, nullptr, nullptr, nullptr}};
+
+PyType_Slot decoder_slots[] = {
+    {Py_tp_doc, const_cast<char*>(
+                    "Decoder of PTI view buffers keeping the strings of all decoded buffers")},
+    {Py_tp_new, reinterpret_cast<void*>(DecoderNew)},
+    {Py_tp_dealloc, reinterpret_cast<void*>(DecoderDealloc)},
+    {Py_tp_methods, decoder_methods},
+    {Py_tp_getset, decoder_getset},
+    {0, nullptr}};
+
+PyType_Spec decoder_spec = {"pti_buffers.Decoder", sizeof(Decoder), 0, Py_TPFLAGS_DEFAULT,
+                            decoder_slots};
+
+//
+// Module
+//
+
+PyObject* ModuleDtype(PyObject* /*module*/, PyObject* arg) {
+  uint32_t kind = PyLong_AsUnsignedLong(arg);
+  if (PyErr_Occurred()) {
+    return nullptr;
+  }
+  auto it = dtypes.find(kind);
+  if (it == dtypes.end()) {
+    PyErr_Format(PyExc_ValueError, "Unknown record kind %u", kind);
+    return nullptr;
+  }
+  Py_INCREF(it->second);
+  return it->second;
+}
+
+PyMethodDef module_methods[] = {
+    {"dtype", ModuleDtype, METH_O,
+     "dtype(kind) -> numpy.dtype\n\nStructured dtype of the records of the view kind."},
+    {nullptr, nullptr, 0, nullptr}};
+
+PyModuleDef module_def = {PyModuleDef_HEAD_INIT,
+                          "pti_buffers",
+                          "NumPy structured arrays over PTI view buffers",
+                          -1,
+                          module_methods,
+                          nullptr,
+                          nullptr,
+                          nullptr,
+                          nullptr};
+
+}  // namespace
+
+PyMODINIT_FUNC PyInit_pti_buffers() {
+  PyObject* numpy = PyImport_ImportModule("numpy");
+  if (numpy == nullptr) {
+    return nullptr;
+  }
+  PyObject* numpy_dtype = PyObject_GetAttrString(numpy, "dtype");
+  numpy_empty = PyObject_GetAttrString(numpy, "empty");
+  Py_DECREF(numpy);
+  if (numpy_dtype == nullptr || numpy_empty == nullptr) {
+    Py_XDECREF(numpy_dtype);
+    return nullptr;
+  }
+
+  PyObject* module = PyModule_Create(&module_def);
+  if (module == nullptr) {
+    Py_DECREF(numpy_dtype);
+    return nullptr;
+  }
+  for (const auto& layout : kRecordLayouts) {
+    PyObject* dtype = CreateDtype(numpy_dtype, layout);
+    if (dtype == nullptr || PyModule_AddIntConstant(module, layout.name, layout.kind) != 0) {
+      Py_XDECREF(dtype);
+      Py_DECREF(numpy_dtype);
+      Py_DECREF(module);
+      return nullptr;
+    }
+    dtypes[layout.kind] = dtype;
+  }
+  Py_DECREF(numpy_dtype);
+
+  PyObject* decoder_type = PyType_FromSpec(&decoder_spec);
+  if (decoder_type == nullptr || PyModule_AddObject(module, "Decoder", decoder_type) != 0) {
+    Py_XDECREF(decoder_type);
+    Py_DECREF(module);
+    return nullptr;
+  }
+  return module;
+}
@@ -0,0 +1,191 @@
+# ==============================================================
+# Copyright (C) Intel Corporation
+#
+# SPDX-License-Identifier: MIT
+# =============================================================
+
+"""Tests of pti_buffers on synthetic PTI view buffers, no device needed."""
+
+import ctypes
+import unittest
+
+import numpy as np
+
+import pti_buffers
+
+
+class KernelArg(ctypes.Structure):
+  """pti_kernel_arg"""
+  _fields_ = [('index', ctypes.c_uint32), ('size', ctypes.c_uint32), ('type', ctypes.c_int),
+              ('memory_type', ctypes.c_int), ('value', ctypes.c_uint64),
+              ('data', ctypes.c_void_p)]
+
+
+class SyntheticBuffer:
+  """Builds a PTI view buffer from records given field by field.
+
+  String fields are given as bytes and stored as pointers, kept alive with the buffer.
+  """
+
+  def __init__(self):
+    self.chunks = []
+    self.keep_alive = []
+
+  def pointer(self, value):
+    if value is None:
+      return 0
+    if isinstance(value, (list, tuple)):
+      if value and isinstance(value[0], int):
+        array = (ctypes.c_uint32 * len(value))(*value)
+      else:
+        array = (ctypes.c_char_p * len(value))(*value)
+    else:
+      array = ctypes.create_string_buffer(value)
+    self.keep_alive.append(array)
+    return ctypes.addressof(array)
+
+  def add(self, kind, string_fields=(), **fields):
+    record = np.zeros(1, dtype=pti_buffers.dtype(kind))
+    record['view_kind'] = kind
+    for name, value in fields.items():
+      record[name] = self.pointer(value) if name in string_fields else value
+    self.chunks.append(record.tobytes())
+
+  def kernel(self, name, kernel_id, start, end, source_file_name=None):
+    self.add(pti_buffers.DEVICE_GPU_KERNEL, ('name', 'source_file_name'), name=name,
+             source_file_name=source_file_name, kernel_id=kernel_id, start_timestamp=start,
+             end_timestamp=end, device_uuid=np.arange(16, dtype=np.uint8))
+
+  def memory_copy(self, name, mem_op_id, size):
+    self.add(pti_buffers.DEVICE_GPU_MEM_COPY, ('name',), name=name, mem_op_id=mem_op_id,
+             bytes=size, pci_address=b'0:3a:0.0')
+
+  def bytes(self):
+    return b''.join(self.chunks)
+
+
+class DecoderTest(unittest.TestCase):
+
+  def setUp(self):
+    self.decoder = pti_buffers.Decoder()
+
+  def test_dtype_of_kind(self):
+    dtype = pti_buffers.dtype(pti_buffers.DEVICE_GPU_KERNEL_METRICS)
+    self.assertEqual(dtype.itemsize, 536)  # sizeof(pti_view_record_kernel_metrics)
+    self.assertEqual(dtype.fields['values'][1], 24)
+    with self.assertRaises(ValueError):
+      pti_buffers.dtype(0)
+
+  def test_empty_buffer(self):
+    self.assertEqual(self.decoder.decode(b''), {})
+    self.assertEqual(self.decoder.strings, [None])
+
+  def test_records_grouped_by_kind(self):
+    buffer = SyntheticBuffer()
+    for i in range(100):
+      buffer.kernel(b'gemm', i, start=1000 * i, end=1000 * i + 10)
+      if i % 10 == 0:
+        buffer.memory_copy(b'zeCommandListAppendMemoryCopy', i, size=4096)
+
+    records = self.decoder.decode(buffer.bytes())
+
+    self.assertEqual(set(records), {pti_buffers.DEVICE_GPU_KERNEL,
+                                    pti_buffers.DEVICE_GPU_MEM_COPY})
+    kernels = records[pti_buffers.DEVICE_GPU_KERNEL]
+    copies = records[pti_buffers.DEVICE_GPU_MEM_COPY]
+    self.assertEqual(len(kernels), 100)
+    self.assertEqual(len(copies), 10)
+    np.testing.assert_array_equal(kernels['kernel_id'], np.arange(100))
+    np.testing.assert_array_equal(kernels['end_timestamp'] - kernels['start_timestamp'],
+                                  np.full(100, 10))
+    np.testing.assert_array_equal(kernels['device_uuid'][7], np.arange(16))
+    np.testing.assert_array_equal(copies['mem_op_id'], np.arange(0, 100, 10))
+    self.assertTrue(np.all(copies['bytes'] == 4096))
+    self.assertEqual(copies['pci_address'][0], b'0:3a:0.0')
+
+  def test_strings_are_interned(self):
+    buffer = SyntheticBuffer()
+    buffer.kernel(b'gemm', 1, 0, 1, source_file_name=b'gemm.cpp')
+    buffer.kernel(b'gemm', 2, 0, 1)  # same name, another pointer
+    buffer.kernel(b'reduce', 3, 0, 1)
+    kernels = self.decoder.decode(buffer.bytes())[pti_buffers.DEVICE_GPU_KERNEL]
+
+    strings = self.decoder.strings
+    self.assertEqual(kernels['name'][0], kernels['name'][1])
+    self.assertEqual([strings[i] for i in kernels['name']], ['gemm', 'gemm', 'reduce'])
+    self.assertEqual([strings[i] for i in kernels['source_file_name']], ['gemm.cpp', None, None])
+
+    # ids are kept across buffers
+    other = SyntheticBuffer()
+    other.kernel(b'reduce', 4, 0, 1)
+    again = self.decoder.decode(other.bytes())[pti_buffers.DEVICE_GPU_KERNEL]
+    self.assertEqual(again['name'][0], kernels['name'][2])
+    self.assertEqual(len(self.decoder.strings), 4)
+
+  def test_metric_schema_lists(self):
+    buffer = SyntheticBuffer()
+    buffer.add(pti_buffers.DEVICE_GPU_KERNEL_METRICS_SCHEMA,
+               ('metric_group_name', 'metric_names', 'metric_units', 'metric_value_types'),
+               schema_id=1, metric_count=2, metric_group_name=b'ComputeBasic',
+               metric_names=[b'GpuTime', b'EuActive'], metric_units=[b'ns', b'percent'],
+               metric_value_types=[1, 2])
+    values = np.zeros(64, dtype=np.uint64)
+    values[0] = 12345
+    values[1:2].view(np.float32)[0] = 87.5
+    buffer.add(pti_buffers.DEVICE_GPU_KERNEL_METRICS, schema_id=1, value_count=2,
+               values=values)
+    records = self.decoder.decode(buffer.bytes())
+
+    schema = records[pti_buffers.DEVICE_GPU_KERNEL_METRICS_SCHEMA][0]
+    strings = self.decoder.strings
+    self.assertEqual(strings[schema['metric_group_name']], 'ComputeBasic')
+    self.assertEqual(strings[schema['metric_names']], ('GpuTime', 'EuActive'))
+    self.assertEqual(strings[schema['metric_units']], ('ns', 'percent'))
+    self.assertEqual(strings[schema['metric_value_types']], (1, 2))
+    metrics = records[pti_buffers.DEVICE_GPU_KERNEL_METRICS][0]
+    self.assertEqual(metrics['values'][0], 12345)
+    self.assertEqual(metrics['values'][1:2].view(np.float32)[0], 87.5)
+
+  def test_kernel_args_lists(self):
+    payload = ctypes.create_string_buffer(b'0123456789abcdef', 16)
+    args = (KernelArg * 3)(KernelArg(0, 8, 2, 2, 0xff0000, None),
+                           KernelArg(1, 4, 1, 0, 1024, None),
+                           KernelArg(2, 16, 1, 0, 0, ctypes.addressof(payload)))
+    buffer = SyntheticBuffer()
+    buffer.keep_alive += [payload, args]
+    for kernel_args_id in (7, 8):  # the same values in two argument sets
+      buffer.add(pti_buffers.KERNEL_ARGS, kernel_args_id=kernel_args_id, kernel_info_id=3,
+                 arg_count=3, args=ctypes.addressof(args))
+    buffer.kernel(b'gemm', 1, 0, 1)
+    records = self.decoder.decode(buffer.bytes())
+
+    kernel_args = records[pti_buffers.KERNEL_ARGS]
+    np.testing.assert_array_equal(kernel_args['kernel_args_id'], [7, 8])
+    self.assertEqual(kernel_args['args'][0], kernel_args['args'][1])
+    self.assertEqual(self.decoder.strings[kernel_args['args'][0]],
+                     ((0, 8, 2, 2, 0xff0000, None), (1, 4, 1, 0, 1024, None),
+                      (2, 16, 1, 0, 0, b'0123456789abcdef')))
+    self.assertEqual(records[pti_buffers.DEVICE_GPU_KERNEL]['kernel_args_id'][0], 0)
+
+  def test_used_bytes(self):
+    buffer = SyntheticBuffer()
+    buffer.kernel(b'gemm', 1, 0, 1)
+    buffer.kernel(b'gemm', 2, 0, 1)
+    data = bytearray(buffer.bytes() + bytes(1024))  # unused tail of the buffer
+    size = len(buffer.bytes()) // 2
+    records = self.decoder.decode(memoryview(data), size)
+    self.assertEqual(len(records[pti_buffers.DEVICE_GPU_KERNEL]), 1)
+    with self.assertRaises(ValueError):
+      self.decoder.decode(data, len(data) + 1)
+
+  def test_malformed_buffer(self):
+    buffer = SyntheticBuffer()
+    buffer.kernel(b'gemm', 1, 0, 1)
+    with self.assertRaises(ValueError):
+      self.decoder.decode(buffer.bytes()[:-8])
+    with self.assertRaises(ValueError):
+      self.decoder.decode(np.full(4, 255, dtype=np.uint8))
+
+
+if __name__ == '__main__':
+  unittest.main()
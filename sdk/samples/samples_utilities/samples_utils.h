@@ -122,6 +122,7 @@ void dump_record(pti_view_record_kernel* record) {
   print_uuid(record->_device_uuid, "Kernel Device UUID: ");
   std::cout << "Kernel NodeID:InvocationID " << record->_sycl_node_id << ':'
             << record->_sycl_invocation_id << '\n';
+  std::cout << "Kernel Replay Index: " << record->_replay_index << '\n';
 }
 
 void dump_record(pti_view_record_memory_copy* record) {
@@ -23,6 +23,8 @@
 #include <spdlog/spdlog.h>
 
 #include <atomic>
+#include <chrono>
+#include <functional>
 #include <future>
 #include <memory>
 #include <thread>
@@ -116,6 +118,22 @@ class BufferConsumer {
 #endif
   }
 
+  /**
+   * \internal
+   * Run a callable periodically on the consumer thread, between the callbacks in the queue.
+   * Replaces the previous one.
+   *
+   * \param period (zero to stop the timer)
+   * \param on_timer (callable object: functor, lambda, function)
+   */
+  inline void SetTimer(std::chrono::milliseconds period, std::function<void()> on_timer) {
+    PushAndForget([this, period, on_timer = std::move(on_timer)]() mutable {
+      timer_period_ = period;
+      on_timer_ = std::move(on_timer);
+      next_timer_ = std::chrono::steady_clock::now() + timer_period_;
+    });
+  }
+
   /**
    * \internal
    * Signal to the consumer thread to stop
@@ -135,12 +153,28 @@ class BufferConsumer {
  private:
   void Run() {
     while (!stop_thread_) {
-      auto delivery = queue_.Pop();
-      delivery();
+      if (timer_period_.count() == 0 || !on_timer_) {
+        auto delivery = queue_.Pop();
+        delivery();
+        continue;
+      }
+      auto delivery = queue_.PopUntil(next_timer_);
+      if (delivery) {
+        (*delivery)();
+      }
+      auto now = std::chrono::steady_clock::now();
+      if (now >= next_timer_ && timer_period_.count() != 0 && on_timer_) {
+        on_timer_();
+        next_timer_ = now + timer_period_;
+      }
     }
   }
 
   std::atomic<bool> stop_thread_ = false;
+  // Owned by the consumer thread
+  std::chrono::milliseconds timer_period_{0};
+  std::function<void()> on_timer_;
+  std::chrono::steady_clock::time_point next_timer_;
   utilities::ViewRecordBufferQueue<TaskType> queue_{kDefaultBufferQueueDepth};
   std::thread consumer_;
 };
@@ -73,8 +73,9 @@ def gen_api(
         )
     f.write("  }\n")
 
+    # APIs out of kfunc_list are registered too, their callbacks only notify subscribers
     f.write("  else if (options_.kernel_tracing) {\n")
-    for func in kfunc_list:
+    for func in func_list:
         if func not in exclude_from_prologue_list:
             f.write(
                 "    zelTracer"
@@ -157,10 +158,32 @@ def get_kernel_tracing_callback(func):
         return cb
 
 
+# Generates the names of all APIs, index in the table is the API id used by subscribers
+def gen_api_names(f, func_list):
+    f.write("static constexpr uint32_t kZeApiCount = " + str(len(func_list)) + ";\n")
+    f.write("static constexpr std::array<const char*, kZeApiCount> kZeApiNames = {\n")
+    for func in func_list:
+        f.write('    "' + func + '",\n')
+    f.write("};\n")
+    f.write("\n")
+
+
+# Generate the call to API subscribers, costs a single branch if the API is not subscribed
+def gen_subscribers_callback(f, api_id, phase, indent="  "):
+    f.write(indent + "if (collector->api_subscribers_.IsEnabled(" + str(api_id) + ")) {\n")
+    f.write(
+        indent
+        + "  collector->api_subscribers_.Notify("
+        + str(api_id)
+        + ", "
+        + phase
+        + ", params, result);\n"
+    )
+    f.write(indent + "}\n")
+
+
 # Generate the OnEnter stub and issue forwarding call if cb exists in ze_collector.h
 def gen_enter_callback(f, func, synchronize_func_list_on_enter, hybrid_mode_func_list):
-    f.write("  [[maybe_unused]] ZeCollector* collector =\n")
-    f.write("    static_cast<ZeCollector*>(global_data);\n")
     if func not in hybrid_mode_func_list:
         f.write("  if (collector->options_.hybrid_mode) return;\n")
 
@@ -194,19 +217,23 @@ def gen_enter_callback(f, func, synchronize_func_list_on_enter, hybrid_mode_func
     f.write("  ze_instance_data.start_time_host = start_time_host;\n")
 
 
-# Generate the OnExit stub and issue forwarding call if cb exists in ze_collector.h
+# Generate the OnExit stub and issue forwarding call if cb exists in ze_collector.h.
+# Subscribers are notified once the collector is done with the call: params it replaced on enter,
+# e.g. the command lists of an execute, are the application's ones again
 def gen_exit_callback(
     f,
+    api_id,
     func,
     submission_func_list,
     synchronize_func_list_on_enter,
     synchronize_func_list_on_exit,
     hybrid_mode_func_list,
 ):
-    f.write("  [[maybe_unused]] ZeCollector* collector =\n")
-    f.write("    static_cast<ZeCollector*>(global_data);\n")
     if func not in hybrid_mode_func_list:
-        f.write("  if (collector->options_.hybrid_mode) return;\n")
+        f.write("  if (collector->options_.hybrid_mode) {\n")
+        gen_subscribers_callback(f, api_id, "PTI_CB_PHASE_API_EXIT", "    ")
+        f.write("    return;\n")
+        f.write("  }\n")
 
     f.write("  [[maybe_unused]] uint64_t end_time_host = 0;\n")
     f.write("  end_time_host = utils::GetTime();\n")
@@ -243,8 +270,11 @@ def gen_exit_callback(
 
         f.write("\n")
 
+    gen_subscribers_callback(f, api_id, "PTI_CB_PHASE_API_EXIT")
     f.write("\n")
     f.write("  uint64_t start_time_host = ze_instance_data.start_time_host;\n")
+    # an exit whose enter ran before tracing was enabled must not see the start of an earlier call
+    f.write("  ze_instance_data.start_time_host = 0;\n")
     f.write("\n")
     f.write("  if (start_time_host == 0) {\n")
     f.write("    return;\n")
@@ -253,24 +283,30 @@ def gen_exit_callback(
 
 
 # Generate OnEnter and OnExit callbacks.
+# Callbacks of APIs out of kfunc_list only notify subscribers.
 def gen_callbacks(
     f,
     func_param_dict,
+    kfunc_list,
     submission_func_list,
     synchronize_func_list_on_enter,
     synchronize_func_list_on_exit,
     hybrid_mode_func_list,
 ):
-    for func in func_param_dict.keys():
+    for api_id, func in enumerate(func_param_dict.keys()):
         # print ("+++ Function : ", func)
         f.write("static void " + func + "OnEnter(\n")
         f.write("    [[maybe_unused]]" + func_param_dict[func] + "\n")
         f.write("    [[maybe_unused]]ze_result_t result,\n")
         f.write("    [[maybe_unused]]void* global_data,\n")
         f.write("    [[maybe_unused]]void** instance_user_data) {\n")
-        gen_enter_callback(
-            f, func, synchronize_func_list_on_enter, hybrid_mode_func_list
-        )
+        f.write("  [[maybe_unused]] ZeCollector* collector =\n")
+        f.write("    static_cast<ZeCollector*>(global_data);\n")
+        gen_subscribers_callback(f, api_id, "PTI_CB_PHASE_API_ENTER")
+        if func in kfunc_list:
+            gen_enter_callback(
+                f, func, synchronize_func_list_on_enter, hybrid_mode_func_list
+            )
         f.write("}\n")
         f.write("\n")
         f.write("static void " + func + "OnExit(\n")
@@ -278,14 +314,20 @@ def gen_callbacks(
         f.write("    [[maybe_unused]]ze_result_t result,\n")
         f.write("    [[maybe_unused]]void* global_data,\n")
         f.write("    [[maybe_unused]]void** instance_user_data) {\n")
-        gen_exit_callback(
-            f,
-            func,
-            submission_func_list,
-            synchronize_func_list_on_enter,
-            synchronize_func_list_on_exit,
-            hybrid_mode_func_list,
-        )
+        f.write("  [[maybe_unused]] ZeCollector* collector =\n")
+        f.write("    static_cast<ZeCollector*>(global_data);\n")
+        if func in kfunc_list:
+            gen_exit_callback(
+                f,
+                api_id,
+                func,
+                submission_func_list,
+                synchronize_func_list_on_enter,
+                synchronize_func_list_on_exit,
+                hybrid_mode_func_list,
+            )
+        else:
+            gen_subscribers_callback(f, api_id, "PTI_CB_PHASE_API_EXIT")
         f.write("}\n")
         f.write("\n")
 
@@ -341,6 +383,7 @@ def main():
         "zeCommandQueueExecuteCommandLists",
         "zeCommandListCreate",
         "zeCommandListCreateImmediate",
+        "zeCommandListClose",
         "zeCommandListDestroy",
         "zeCommandListReset",
         "zeCommandQueueCreate",
@@ -348,13 +391,20 @@ def main():
         "zeCommandQueueDestroy",
         "zeImageCreate",
         "zeImageDestroy",
+        "zeKernelCreate",
         "zeKernelSetGroupSize",
+        "zeKernelSetArgumentValue",
         "zeKernelDestroy",
         "zeEventHostSynchronize",
         "zeFenceHostSynchronize",
         "zeEventQueryStatus",
         "zeCommandListHostSynchronize",
+        "zeContextCreate",
         "zeContextDestroy",
+        "zeMemAllocHost",
+        "zeMemAllocDevice",
+        "zeMemAllocShared",
+        "zeMemFree",
     ]
 
     hybrid_mode_func_list = ["zeEventPoolCreate"]
@@ -390,9 +440,11 @@ def main():
 
     exclude_from_prologue_list = ["zeCommandListHostSynchronize"]
 
+    gen_api_names(dst_file, func_list)
     gen_callbacks(
         dst_file,
         func_param_dictionary,
+        kfunc_list,
         submission_func_list,
         synchronize_func_list_on_enter,
         synchronize_func_list_on_exit,
@@ -0,0 +1,226 @@
+//==============================================================
+// Copyright (C) Intel Corporation
+//
+// SPDX-License-Identifier: MIT
+// =============================================================
+
+#ifndef SRC_LEVELZERO_ZE_API_SUBSCRIBERS_H_
+#define SRC_LEVELZERO_ZE_API_SUBSCRIBERS_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+
+#include "pti/pti_callback.h"
+#include "unikernel.h"
+#include "utils.h"
+
+struct _pti_callback_subscriber {
+  pti_callback_function callback = nullptr;
+  void* user_data = nullptr;
+  std::vector<bool> apis;
+};
+
+/**
+ * \internal
+ * Subscribers of the synchronous API callbacks.
+ * The generated tracing callbacks check IsEnabled() for their API id, so an API no subscriber
+ * asked for costs one relaxed load and a branch. Notify() runs the subscribers under a shared
+ * lock; the subscription changes take it exclusively.
+ */
+class ZeApiSubscribers {
+ public:
+  ZeApiSubscribers(const char* const* api_names, uint32_t api_count)
+      : api_names_(api_names),
+        api_count_(api_count),
+        enabled_(std::make_unique<std::atomic<uint32_t>[]>(api_count)) {}
+
+  ZeApiSubscribers(const ZeApiSubscribers&) = delete;
+  ZeApiSubscribers& operator=(const ZeApiSubscribers&) = delete;
+  ZeApiSubscribers(ZeApiSubscribers&&) = delete;
+  ZeApiSubscribers& operator=(ZeApiSubscribers&&) = delete;
+
+  inline bool IsEnabled(uint32_t api_id) const {
+    return enabled_[api_id].load(std::memory_order_relaxed) != 0;
+  }
+
+  // true if any API is enabled by any subscriber, i.e. the tracing layer has to be on
+  inline bool IsActive() const { return enabled_total_.load(std::memory_order_relaxed) != 0; }
+
+  uint32_t GetApiCount() const { return api_count_; }
+
+  // true in a thread running subscriber callbacks
+  static bool InCallback() { return in_callback_; }
+
+  pti_result GetApiId(const char* api_name, uint32_t* api_id) const {
+    if (api_name == nullptr || api_id == nullptr) {
+      return pti_result::PTI_ERROR_BAD_ARGUMENT;
+    }
+    for (uint32_t id = 0; id < api_count_; ++id) {
+      if (std::strcmp(api_names_[id], api_name) == 0) {
+        *api_id = id;
+        return pti_result::PTI_SUCCESS;
+      }
+    }
+    return pti_result::PTI_ERROR_BAD_ARGUMENT;
+  }
+
+  pti_result Subscribe(pti_callback_subscriber_handle* subscriber, pti_callback_function callback,
+                       void* user_data) {
+    if (subscriber == nullptr || callback == nullptr || in_callback_) {
+      return pti_result::PTI_ERROR_BAD_ARGUMENT;
+    }
+    auto new_subscriber = std::make_unique<_pti_callback_subscriber>();
+    new_subscriber->callback = callback;
+    new_subscriber->user_data = user_data;
+    new_subscriber->apis.resize(api_count_, false);
+
+    const std::unique_lock lock(mutex_);
+    *subscriber = new_subscriber.get();
+    subscribers_.push_back(std::move(new_subscriber));
+    return pti_result::PTI_SUCCESS;
+  }
+
+  pti_result Unsubscribe(pti_callback_subscriber_handle subscriber) {
+    if (in_callback_) {
+      return pti_result::PTI_ERROR_BAD_ARGUMENT;
+    }
+    const std::unique_lock lock(mutex_);
+    auto it = Find(subscriber);
+    if (it == subscribers_.end()) {
+      return pti_result::PTI_ERROR_BAD_ARGUMENT;
+    }
+    for (uint32_t id = 0; id < api_count_; ++id) {
+      SetEnabled(**it, id, false);
+    }
+    subscribers_.erase(it);
+    return pti_result::PTI_SUCCESS;
+  }
+
+  pti_result Enable(pti_callback_subscriber_handle subscriber, uint32_t api_id, bool enable) {
+    if (in_callback_ || api_id >= api_count_) {
+      return pti_result::PTI_ERROR_BAD_ARGUMENT;
+    }
+    const std::unique_lock lock(mutex_);
+    auto it = Find(subscriber);
+    if (it == subscribers_.end()) {
+      return pti_result::PTI_ERROR_BAD_ARGUMENT;
+    }
+    SetEnabled(**it, api_id, enable);
+    return pti_result::PTI_SUCCESS;
+  }
+
+  pti_result EnableAll(pti_callback_subscriber_handle subscriber, bool enable) {
+    if (in_callback_) {
+      return pti_result::PTI_ERROR_BAD_ARGUMENT;
+    }
+    const std::unique_lock lock(mutex_);
+    auto it = Find(subscriber);
+    if (it == subscribers_.end()) {
+      return pti_result::PTI_ERROR_BAD_ARGUMENT;
+    }
+    for (uint32_t id = 0; id < api_count_; ++id) {
+      SetEnabled(**it, id, enable);
+    }
+    return pti_result::PTI_SUCCESS;
+  }
+
+  // Called from the tracing callbacks once IsEnabled(api_id) returned true.
+  // The per call user data of the tracing layer belongs to the collector, so the correlation id
+  // of a call is kept on a thread local stack of the calls in progress instead. The params of a
+  // call are the same at its enter and exit, and differ from the ones of calls nested in it.
+  void Notify(uint32_t api_id, pti_callback_phase phase, void* params, ze_result_t result) {
+    if (in_callback_) {
+      return;
+    }
+
+    uint32_t correlation_id = 0;
+    if (phase == PTI_CB_PHASE_API_ENTER) {
+      correlation_id = UniCorrId::GetUniCorrId();
+      if (calls_.size() == kMaxCallsInProgress) {
+        // exits not reported, as the API was disabled while the calls were in progress
+        calls_.erase(calls_.begin());
+      }
+      calls_.push_back({api_id, params, correlation_id});
+    } else {
+      for (auto it = calls_.rbegin(); it != calls_.rend(); ++it) {
+        if (it->api_id == api_id && it->params == params) {
+          correlation_id = it->correlation_id;
+          // the call and the ones nested in it which exits were not reported
+          calls_.erase(std::prev(it.base()), calls_.end());
+          break;
+        }
+      }
+      if (correlation_id == 0) {
+        // exit of a call which enter was not reported
+        correlation_id = UniCorrId::GetUniCorrId();
+      }
+    }
+
+    pti_callback_api_data data = {};
+    data._domain = PTI_CB_DOMAIN_DRIVER_API;
+    data._phase = phase;
+    data._api_id = api_id;
+    data._api_name = api_names_[api_id];
+    data._api_params = params;
+    data._api_result = result;
+    data._correlation_id = correlation_id;
+    data._thread_id = utils::GetTid();
+
+    const std::shared_lock lock(mutex_);
+    in_callback_ = true;
+    for (const auto& subscriber : subscribers_) {
+      if (subscriber->apis[api_id]) {
+        subscriber->callback(subscriber->user_data, &data);
+      }
+    }
+    in_callback_ = false;
+  }
+
+ private:
+  std::vector<std::unique_ptr<_pti_callback_subscriber>>::iterator Find(
+      pti_callback_subscriber_handle subscriber) {
+    return std::find_if(subscribers_.begin(), subscribers_.end(),
+                        [subscriber](const auto& item) { return item.get() == subscriber; });
+  }
+
+  // mutex_ is held exclusively by the caller
+  void SetEnabled(_pti_callback_subscriber& subscriber, uint32_t api_id, bool enable) {
+    if (subscriber.apis[api_id] == enable) {
+      return;
+    }
+    subscriber.apis[api_id] = enable;
+    if (enable) {
+      enabled_[api_id].fetch_add(1, std::memory_order_relaxed);
+      enabled_total_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+      enabled_[api_id].fetch_sub(1, std::memory_order_relaxed);
+      enabled_total_.fetch_sub(1, std::memory_order_relaxed);
+    }
+  }
+
+  const char* const* api_names_;
+  uint32_t api_count_;
+  // number of subscribers that enabled the API
+  std::unique_ptr<std::atomic<uint32_t>[]> enabled_;
+  std::atomic<uint64_t> enabled_total_ = 0;
+  std::shared_mutex mutex_;
+  std::vector<std::unique_ptr<_pti_callback_subscriber>> subscribers_;
+  inline static thread_local bool in_callback_ = false;
+
+  struct ApiCall {
+    uint32_t api_id;
+    const void* params;
+    uint32_t correlation_id;
+  };
+  static constexpr size_t kMaxCallsInProgress = 64;
+  inline static thread_local std::vector<ApiCall> calls_;
+};
+
+#endif  // SRC_LEVELZERO_ZE_API_SUBSCRIBERS_H_
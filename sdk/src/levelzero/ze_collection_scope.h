@@ -0,0 +1,83 @@
+//==============================================================
+// Copyright (C) Intel Corporation
+//
+// SPDX-License-Identifier: MIT
+// =============================================================
+
+#ifndef SRC_LEVELZERO_ZE_COLLECTION_SCOPE_H_
+#define SRC_LEVELZERO_ZE_COLLECTION_SCOPE_H_
+
+#include <level_zero/ze_api.h>
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_set>
+
+/**
+ * \internal
+ * Queues and threads the GPU operations are collected for.
+ * Empty set of queues (threads) selects all queues (threads). Operation is selected if both its
+ * queue and the thread appending it are selected. Queue of an immediate command list is the
+ * command list itself, the same as _queue_handle of the view records.
+ * IsSelected() is called on every append, with no scope set it costs one relaxed load.
+ */
+class ZeCollectionScope {
+ public:
+  ZeCollectionScope() = default;
+  ZeCollectionScope(const ZeCollectionScope&) = delete;
+  ZeCollectionScope& operator=(const ZeCollectionScope&) = delete;
+  ZeCollectionScope(ZeCollectionScope&&) = delete;
+  ZeCollectionScope& operator=(ZeCollectionScope&&) = delete;
+
+  inline bool IsSet() const { return is_set_.load(std::memory_order_relaxed); }
+
+  void AddQueue(ze_command_queue_handle_t queue) {
+    const std::unique_lock lock(mutex_);
+    queues_.insert(queue);
+    is_set_ = true;
+  }
+
+  void AddThread(uint32_t thread_id) {
+    const std::unique_lock lock(mutex_);
+    threads_.insert(thread_id);
+    is_set_ = true;
+  }
+
+  void Reset() {
+    const std::unique_lock lock(mutex_);
+    queues_.clear();
+    threads_.clear();
+    is_set_ = false;
+  }
+
+  // queue is nullptr if it is not known yet, i.e. at append to a regular command list:
+  // the queue is checked then at execute with IsQueueSelected()
+  bool IsSelected(ze_command_queue_handle_t queue, uint32_t thread_id) const {
+    if (!IsSet()) {
+      return true;
+    }
+    const std::shared_lock lock(mutex_);
+    if (!threads_.empty() && threads_.count(thread_id) == 0) {
+      return false;
+    }
+    return queue == nullptr || queues_.empty() || queues_.count(queue) != 0;
+  }
+
+  bool IsQueueSelected(ze_command_queue_handle_t queue) const {
+    if (!IsSet()) {
+      return true;
+    }
+    const std::shared_lock lock(mutex_);
+    return queues_.empty() || queues_.count(queue) != 0;
+  }
+
+ private:
+  std::atomic<bool> is_set_ = false;
+  mutable std::shared_mutex mutex_;
+  std::unordered_set<ze_command_queue_handle_t> queues_;
+  std::unordered_set<uint32_t> threads_;
+};
+
+#endif  // SRC_LEVELZERO_ZE_COLLECTION_SCOPE_H_
@@ -28,6 +28,7 @@
 #include <map>
 #include <memory>
 #include <mutex>
+#include <set>
 #include <shared_mutex>
 #include <string>
 #include <unordered_set>
@@ -38,7 +39,12 @@
 #include "pti/pti_view.h"
 #include "unikernel.h"
 #include "utils.h"
+#include "ze_api_subscribers.h"
+#include "ze_collection_scope.h"
+#include "ze_command_list_replays.h"
 #include "ze_event_cache.h"
+#include "ze_kernel_args.h"
+#include "ze_kernel_metrics.h"
 #include "ze_local_collection_helpers.h"
 #include "ze_utils.h"
 #include "ze_wrappers.h"
@@ -83,6 +89,8 @@ struct ZeKernelCommandProps {
   ze_device_handle_t dst_device = nullptr;  // Device for p2p memcpy, destination of copy data
   void* dst = nullptr;                      // Addressess for MemorCopy or Fill
   void* src = nullptr;
+  std::shared_ptr<const ZeKernelInfo> kernel_info;  // kernels only
+  std::shared_ptr<const ZeKernelArgSet> kernel_args;  // kernels only, if arguments are collected
 };
 
 struct ZeKernelCommand {
@@ -111,6 +119,9 @@ struct ZeKernelCommand {
   std::string source_file_name_;
   uint32_t source_line_number_ = 0;
   uint32_t corr_id_ = 0;
+  // kernels only -- metric query around the kernel, if kernel metrics are sampled
+  std::shared_ptr<ZeKernelMetricSample> metric_sample;
+  uint32_t replay_index = 0;  // execution of the closed command list
 };
 
 struct ZeCommandQueue {
@@ -121,14 +132,43 @@ struct ZeCommandQueue {
   uint32_t engine_index_;
 };
 
+// Regular command list closed with device operations appended: the operations are the templates
+// of the records of every execution of the list
+struct ZeRecordedCommandList {
+  ze_context_handle_t context = nullptr;
+  std::vector<std::unique_ptr<ZeKernelCommand>> commands;
+  std::vector<uint64_t> append_kernel_ids;  // kernel ids of the first execution
+  std::unique_ptr<ZeCommandListReplays> replays;
+  // closed again without a reset, after zeCommandListUpdateMutableCommandsExp: the templates no
+  // longer match the list, its executions are not reported until it is reset
+  bool updated = false;
+};
+
 struct ZeCommandListInfo {
   std::vector<std::unique_ptr<ZeKernelCommand>> kernel_commands;
   ze_context_handle_t context;
   ze_device_handle_t device;
   bool immediate;
-  std::pair<uint32_t, uint32_t> oi_pair;
+  std::pair<uint32_t, uint32_t> oi_pair;  // only ordinal is known for a regular command list
+  std::shared_ptr<ZeRecordedCommandList> recorded;
+};
+
+struct ZeReplayInFlight {
+  std::shared_ptr<ZeRecordedCommandList> list;
+  ZeReplay* replay;
+};
+
+// Command lists of an execute with the harvest lists of the replays inserted, kept from the
+// enter to the exit callback
+struct ZeExecuteReplays {
+  ze_command_list_handle_t* command_lists = nullptr;  // given by the application
+  uint32_t command_list_count = 0;
+  std::vector<ze_command_list_handle_t> executed_lists;
+  std::vector<ZeReplayInFlight> replays;
 };
 
+inline thread_local ZeExecuteReplays ze_execute_replays;
+
 struct ZeDeviceDescriptor {
   uint64_t host_time_origin = 0;
   uint64_t device_time_origin = 0;
@@ -141,6 +181,13 @@ struct ZeDeviceDescriptor {
 };
 
 using ZeKernelGroupSizeMap = std::map<ze_kernel_handle_t, ZeKernelGroupSize>;
+struct ZeKernelInfoEntry {
+  std::shared_ptr<const ZeKernelInfo> info;
+  uint64_t tracing_generation = 0;  // tracing window the info was checked in
+};
+
+using ZeKernelInfoMap = std::map<ze_kernel_handle_t, ZeKernelInfoEntry>;
+using ZeKernelModuleMap = std::map<ze_kernel_handle_t, ze_module_handle_t>;
 using ZeCommandListMap = std::map<ze_command_list_handle_t, ZeCommandListInfo>;
 using ZeImageSizeMap = std::map<ze_image_handle_t, size_t>;
 using ZeDeviceMap = std::map<ze_device_handle_t, std::vector<ze_device_handle_t>>;
@@ -233,6 +280,11 @@ class ZeCollector {
       PTI_ASSERT(status == ZE_RESULT_SUCCESS);
     }
 #endif
+    // replays return their events to the event cache
+    replays_in_flight_.clear();
+    for (auto& [command_list, info] : command_list_map_) {
+      info.recorded.reset();
+    }
   }
   enum class ZeCollectionMode { Full = 0, Hybrid = 1, Local = 2 };
   enum class ZeCollectionState { Normal = 0, Abnormal = 1 };
@@ -305,6 +357,37 @@ class ZeCollector {
 
   bool IsDynamicTracingCapable() { return loader_dynamic_tracing_capable_; }
 
+  ZeApiSubscribers& GetApiSubscribers() { return api_subscribers_; }
+
+  ZeCollectionScope& GetCollectionScope() { return collection_scope_; }
+
+  // Kernels are sampled with the metric group while PTI_VIEW_DEVICE_GPU_KERNEL_METRICS is
+  // enabled. Samplers of the groups used stay alive as samples being calculated refer to them
+  void EnableKernelMetrics(const std::string& group_name) {
+    const std::lock_guard<std::mutex> lock(lock_);
+    auto& kernel_metrics = kernel_metrics_by_group_[group_name];
+    if (kernel_metrics == nullptr) {
+      kernel_metrics = std::make_unique<ZeKernelMetrics>(
+          group_name, [this](ze_event_handle_t event) { event_cache_.ReleaseEvent(event); });
+    } else if (kernel_metrics.get() != last_kernel_metrics_) {
+      // another group could be activated since
+      kernel_metrics->ResetActivation();
+    }
+    last_kernel_metrics_ = kernel_metrics.get();
+    kernel_metrics_ = kernel_metrics.get();
+  }
+
+  void DisableKernelMetrics() { kernel_metrics_ = nullptr; }
+
+  // Argument values of kernels are snapshot at launch while PTI_VIEW_KERNEL_ARGS is enabled
+  void EnableKernelArgs() { kernel_args_enabled_ = true; }
+
+  void DisableKernelArgs() {
+    kernel_args_enabled_ = false;
+    const std::lock_guard<std::mutex> lock(lock_);
+    kernel_args_.Clear();
+  }
+
   // We get here on StartTracing/enable of L0 related view kinds.
   // The caller needs to ensure duplicated enable of view_kinds do not happen on a per thread basis.
   void EnableTracing() {
@@ -424,17 +507,48 @@ class ZeCollector {
       const auto devices = utils::ze::GetDeviceList(driver);
       for (auto* const device : devices) {
         device_descriptors_[device] = GetZeDeviceDescriptor(device);
+        device_descriptors_[device].driver = driver;
         SPDLOG_DEBUG("\tdevice: {}", (void*)device);
         const auto sub_devices = utils::ze::GetSubDeviceList(device);
         device_map_[device] = sub_devices;
         for (auto* const sub_device : sub_devices) {
           SPDLOG_DEBUG("\tsub-device: {}", (void*)sub_device);
           device_descriptors_[sub_device] = GetZeDeviceDescriptor(sub_device);
+          device_descriptors_[sub_device].driver = driver;
         }
       }
     }
   }
 
+  // devices and sub-devices of the driver, command lists can be created on either
+  std::vector<ze_device_handle_t> GetDriverDevices(ze_driver_handle_t driver) const {
+    std::vector<ze_device_handle_t> devices;
+    for (const auto& [device, sub_devices] : device_map_) {
+      auto it = device_descriptors_.find(device);
+      if (it != device_descriptors_.end() && it->second.driver == driver) {
+        devices.push_back(device);
+        devices.insert(devices.end(), sub_devices.begin(), sub_devices.end());
+      }
+    }
+    return devices;
+  }
+
+  // Contexts created before collection is enabled are not seen, and the ones seen before may be
+  // destroyed while it was disabled. So the devices are warmed up instead: the native binaries
+  // built for them let the first bridge in any context load the kernel rather than compile it
+  void WarmupBridgeKernels() {
+    if (ZeCollectionMode::Local != collection_mode_) {
+      return;
+    }
+    std::set<ze_driver_handle_t> drivers;
+    for (const auto& [device, desc] : device_descriptors_) {
+      drivers.insert(desc.driver);
+    }
+    for (auto driver : drivers) {
+      bridge_kernel_pool_.WarmupDevices(driver, GetDriverDevices(driver));
+    }
+  }
+
   void MarkIntrospection() {
     const auto drivers = utils::ze::GetDriverList();
     for (auto const driver : drivers) {
@@ -667,6 +781,8 @@ class ZeCollector {
         break;
       }
     }
+
+    ProcessReplays(kids, kcexecrec);
   }
 
   void ProcessCallFence(ze_fence_handle_t fence, std::vector<uint64_t>* kids,
@@ -713,6 +829,8 @@ class ZeCollector {
         break;
       }
     }
+
+    ProcessReplays(kids, kcexecrec);
   }
 
   constexpr uint64_t ComputeDuration(uint64_t start, uint64_t end, uint64_t freq, uint64_t mask) {
@@ -784,7 +902,9 @@ class ZeCollector {
 
     PTI_ASSERT(!name.empty());
 
-    if (kcexecrec && acallback_) {
+    // regular command lists are instrumented at append, before their queue is known: operations
+    // executed on queues out of the collection scope are not reported
+    if (kcexecrec && acallback_ && collection_scope_.IsQueueSelected(command->queue)) {
       ZeKernelCommandExecutionRecord rec = {};
 
       rec.kid_ = command->kernel_id;
@@ -855,6 +975,14 @@ class ZeCollector {
 
         rec.source_file_name_ = command->source_file_name_;
         rec.source_line_number_ = command->source_line_number_;
+        rec.kernel_info_ = command->props.kernel_info;
+        rec.kernel_args_ = command->props.kernel_args;
+        // one query measures the kernel on all tiles, its values are of the first execution
+        if (tile <= 0 && command->replay_index == 0 && command->metric_sample != nullptr &&
+            command->metric_sample->IsComplete()) {
+          rec.metric_sample_ = command->metric_sample;
+        }
+        rec.replay_index_ = command->replay_index;
         if (command->device != nullptr) {
           CopyDeviceUUIDTo(command->device, static_cast<uint8_t*>(rec.src_device_uuid));
         }
@@ -939,6 +1067,91 @@ class ZeCollector {
         it = kernel_command_list_.erase(it);
       }
     }
+
+    ProcessReplays(kids, kcexecrec);
+  }
+
+  // Executions of closed command lists: the timestamps of all the operations of an execution are
+  // in the buffer of its replay, no event is queried per operation
+  void ProcessReplays(std::vector<uint64_t>* kids,
+                      std::vector<ZeKernelCommandExecutionRecord>* kcexecrec) {
+    // lock is acquired in the caller
+    auto it = replays_in_flight_.begin();
+    while (it != replays_in_flight_.end()) {
+      ZeCommandListReplays& replays = *(it->list->replays);
+      if (!replays.IsComplete(it->replay)) {
+        ++it;
+        continue;
+      }
+      ProcessReplay(*(it->list), *(it->replay), kids, kcexecrec);
+      replays.End(it->replay);
+      it = replays_in_flight_.erase(it);
+    }
+  }
+
+  void ProcessReplay(ZeRecordedCommandList& list, const ZeReplay& replay,
+                     std::vector<uint64_t>* kids,
+                     std::vector<ZeKernelCommandExecutionRecord>* kcexecrec) {
+    SPDLOG_TRACE("In {} replay: {}", __FUNCTION__, replay.index);
+    for (size_t i = 0; i < list.commands.size(); ++i) {
+      ZeKernelCommand* command = list.commands[i].get();
+      command->kernel_id =
+          (replay.index == 0) ? list.append_kernel_ids[i] : UniKernelId::GetKernelId();
+      command->replay_index = replay.index;
+      command->queue = replay.queue;
+      command->fence = replay.fence;
+      command->submit_time = replay.submit_time;
+      command->submit_time_device_ = replay.submit_time_device;
+      if (kids) {
+        kids->push_back(command->kernel_id);
+      }
+      ProcessCallTimestamp(command, replay.timestamps[i], -1, true, kcexecrec);
+    }
+  }
+
+  // Appends the record of a host synchronization call to the records of the device operations
+  // processed on its exit. For a command queue only operations of that queue are linked to the
+  // wait, as ProcessCalls() picks up everything completed so far.
+  void AppendHostSyncRecord(pti_view_host_sync_type sync_type, void* sync_object,
+                            uint64_t start_time, uint64_t end_time,
+                            std::vector<ZeKernelCommandExecutionRecord>* kcexecrec) {
+    if (start_time > end_time) {
+      return;
+    }
+
+    std::vector<const ZeKernelCommandExecutionRecord*> completed;
+    for (const auto& rec : *kcexecrec) {
+      if (sync_type == PTI_VIEW_HOST_SYNC_TYPE_COMMAND_QUEUE &&
+          rec.queue_ != static_cast<ze_command_queue_handle_t>(sync_object)) {
+        continue;
+      }
+      // with implicit scaling one operation produces adjacent records, one per tile
+      if (!completed.empty() && completed.back()->cid_ == rec.cid_) {
+        if (completed.back()->end_time_ < rec.end_time_) {
+          completed.back() = &rec;
+        }
+        continue;
+      }
+      completed.push_back(&rec);
+    }
+    std::stable_sort(completed.begin(), completed.end(),
+                     [](const ZeKernelCommandExecutionRecord* left,
+                        const ZeKernelCommandExecutionRecord* right) {
+                       return left->end_time_ < right->end_time_;
+                     });
+
+    ZeKernelCommandExecutionRecord rec = {};
+    rec.sync_type_ = sync_type;
+    rec.sync_object_ = sync_object;
+    rec.start_time_ = start_time;
+    rec.end_time_ = end_time;
+    rec.tid_ = utils::GetTid();
+    rec.pid_ = utils::GetPid();
+    rec.sync_cids_.reserve(completed.size());
+    for (const auto* op : completed) {
+      rec.sync_cids_.push_back(op->cid_);
+    }
+    kcexecrec->push_back(std::move(rec));
   }
 
   void CreateCommandListInfo(ze_command_list_handle_t command_list, ze_context_handle_t context,
@@ -960,7 +1173,7 @@ class ZeCollector {
     PTI_ASSERT(device_descriptors_.count(device) != 0);
 
     command_list_map_[command_list] = {std::vector<std::unique_ptr<ZeKernelCommand>>(), context,
-                                       device, immediate, oi_pair};
+                                       device, immediate, oi_pair, nullptr};
     command_list_map_mutex_.unlock();
 
     if (immediate) {
@@ -992,11 +1205,14 @@ class ZeCollector {
        &device_time_sync); PTI_ASSERT(status == ZE_RESULT_SUCCESS);
     */
 
+    ze_execute_replays.executed_lists.clear();
+    ze_execute_replays.replays.clear();
     for (uint32_t i = 0; i < command_list_count; ++i) {
       ze_command_list_handle_t clist = command_lists[i];
       PTI_ASSERT(clist != nullptr);
 
       const ZeCommandListInfo& info = GetCommandListInfoConst(clist);
+      ze_execute_replays.executed_lists.push_back(clist);
 
       // as all command lists submitted to the execution into queue - they are not immediate
       PTI_ASSERT(!info.immediate);
@@ -1017,6 +1233,18 @@ class ZeCollector {
         queue_ordinal_index_map_[queue] = std::make_pair(q_ordinal, q_index);
       }
 
+      if (info.recorded != nullptr && !info.recorded->updated) {
+        ZeReplay* replay = info.recorded->replays->Begin();
+        if (replay != nullptr) {
+          replay->queue = queue;
+          replay->fence = fence;
+          replay->submit_time = host_time_sync;
+          replay->submit_time_device = device_time_sync;
+          ze_execute_replays.executed_lists.push_back(replay->harvest_list);
+          ze_execute_replays.replays.push_back({info.recorded, replay});
+        }
+      }
+
       for (auto it = info.kernel_commands.begin(); it != info.kernel_commands.end(); it++) {
         ZeKernelCommand* command = (*it).get();
         if (!command->tid) {
@@ -1053,6 +1281,86 @@ class ZeCollector {
     }
   }
 
+  // Replays of the execute are in flight once the execute succeeded
+  void PostSubmitReplays(bool submitted) {
+    const std::lock_guard<std::mutex> lock(lock_);
+    for (auto& in_flight : ze_execute_replays.replays) {
+      if (submitted) {
+        replays_in_flight_.push_back(std::move(in_flight));
+      } else {
+        in_flight.list->replays->End(in_flight.replay);
+      }
+    }
+    ze_execute_replays.replays.clear();
+  }
+
+  // Operations appended to a regular command list become the templates of the records of its
+  // executions, a SYCL graph is finalized into such command list
+  void RecordCommandList(ze_command_list_handle_t command_list) {
+    const std::lock_guard<std::mutex> lock(lock_);
+    if (!CommandListInfoExists(command_list)) {
+      return;
+    }
+    ZeCommandListInfo& info = GetCommandListInfo(command_list);
+    if (info.recorded != nullptr) {
+      // only a mutable command list is closed again, once its commands are updated. Its events
+      // owned by the collector stay with the recorded list as they are still in the list
+      info.recorded->updated = true;
+      return;
+    }
+    if (info.immediate || info.kernel_commands.empty()) {
+      return;
+    }
+
+    auto recorded = std::make_shared<ZeRecordedCommandList>();
+    recorded->context = info.context;
+    std::vector<ZeReplayNode> nodes;
+    for (auto& command : info.kernel_commands) {
+      if (command->event_self == nullptr) {
+        continue;
+      }
+      ZeReplayNode node;
+      node.timestamp_event = command->event_self;
+      if (ZeCollectionMode::Local == collection_mode_ && command->event_swap != nullptr) {
+        node.timestamp_event = command->event_swap;
+      }
+      node.completion_event = command->event_self;
+      node.owned = event_cache_.QueryEvent(command->event_self);
+      nodes.push_back(node);
+      recorded->append_kernel_ids.push_back(command->kernel_id);
+      recorded->commands.push_back(std::move(command));
+    }
+    info.kernel_commands.clear();
+
+    ze_context_handle_t context = info.context;
+    recorded->replays = std::make_unique<ZeCommandListReplays>(
+        context, info.device, info.oi_pair.first, std::move(nodes),
+        [this, context]() { return event_cache_.GetEvent(context); },
+        [this](ze_event_handle_t event) { event_cache_.ReleaseEvent(event); });
+    info.recorded = std::move(recorded);
+  }
+
+  // lock is acquired in the caller
+  void ResetCommandList(ze_command_list_handle_t command_list) {
+    if (CommandListInfoExists(command_list)) {
+      GetCommandListInfo(command_list).recorded.reset();
+    }
+  }
+
+  // Replays of the context are dropped before its harvest lists and events are gone
+  void ReleaseRecordedCommandLists(ze_context_handle_t context) {
+    // lock is acquired in the caller
+    replays_in_flight_.remove_if([context](const ZeReplayInFlight& in_flight) {
+      return in_flight.list->context == context;
+    });
+    std::shared_lock lock(command_list_map_mutex_);
+    for (auto& [command_list, info] : command_list_map_) {
+      if (info.recorded != nullptr && info.recorded->context == context) {
+        info.recorded.reset();
+      }
+    }
+  }
+
   ze_context_handle_t GetCommandListContext(ze_command_list_handle_t command_list) {
     PTI_ASSERT(command_list != nullptr);
     const ZeCommandListInfo& command_list_info = GetCommandListInfoConst(command_list);
@@ -1070,6 +1378,18 @@ class ZeCollector {
     return command_list_info.immediate;
   }
 
+  // Queue of a regular command list is not known at append, it is checked at execute
+  bool IsInCollectionScope(ze_command_list_handle_t command_list) {
+    if (!collection_scope_.IsSet()) {
+      return true;
+    }
+    ze_command_queue_handle_t queue = nullptr;
+    if (IsCommandListImmediate(command_list)) {
+      queue = reinterpret_cast<ze_command_queue_handle_t>(command_list);
+    }
+    return collection_scope_.IsSelected(queue, utils::GetTid());
+  }
+
   void AddImage(ze_image_handle_t image, size_t size) {
     // PTI_ASSERT(image != nullptr);
     const std::lock_guard<std::mutex> lock(lock_);
@@ -1105,6 +1425,95 @@ class ZeCollector {
     kernel_group_size_map_.erase(kernel);
   }
 
+  void AddKernelModule(ze_kernel_handle_t kernel, ze_module_handle_t module) {
+    const std::lock_guard<std::mutex> lock(lock_);
+    kernel_module_map_[kernel] = module;
+    // the handle of a kernel destroyed while tracing was off
+    kernel_info_map_.erase(kernel);
+  }
+
+  // Launches already appended keep their kernel info alive,
+  // a new kernel reusing the handle gets a new kernel info
+  void RemoveKernelInfo(ze_kernel_handle_t kernel) {
+    const std::lock_guard<std::mutex> lock(lock_);
+    kernel_info_map_.erase(kernel);
+    kernel_module_map_.erase(kernel);
+    kernel_args_.RemoveKernel(kernel);
+  }
+
+  // lock_ is held by the caller
+  // Kernels may be destroyed and their handles reused while tracing is off (Local and Hybrid
+  // modes), so info cached in an earlier tracing window is checked against the kernel once
+  std::shared_ptr<const ZeKernelInfo> GetKernelInfo(ze_kernel_handle_t kernel) {
+    const uint64_t generation = tracing_generation_.load(std::memory_order_relaxed);
+    auto it = kernel_info_map_.find(kernel);
+    if (it != kernel_info_map_.end() && it->second.tracing_generation == generation) {
+      return it->second.info;
+    }
+
+    auto info = QueryKernelInfo(kernel);
+    if (it != kernel_info_map_.end()) {
+      if (IsSameKernel(*it->second.info, *info)) {
+        it->second.tracing_generation = generation;
+        return it->second.info;
+      }
+      // module of the destroyed kernel
+      kernel_module_map_.erase(kernel);
+    }
+
+    info->id_ = UniKernelInfoId::GetKernelInfoId();
+    // module is known for kernels created while tracing
+    auto module_it = kernel_module_map_.find(kernel);
+    if (module_it != kernel_module_map_.end()) {
+      size_t binary_size = 0;
+      overhead::Init();
+      ze_result_t status = zeModuleGetNativeBinary(module_it->second, &binary_size, nullptr);
+      overhead_fini("zeModuleGetNativeBinary");
+      if (status == ZE_RESULT_SUCCESS) {
+        info->binary_size_ = binary_size;
+      }
+    }
+
+    SPDLOG_TRACE("\tnew kernel info: {}, id: {}", info->name_, info->id_);
+    kernel_info_map_[kernel] = {info, generation};
+    return info;
+  }
+
+  // name and properties of the kernel, without the id and the binary size
+  std::shared_ptr<ZeKernelInfo> QueryKernelInfo(ze_kernel_handle_t kernel) {
+    auto info = std::make_shared<ZeKernelInfo>();
+    info->name_ = utils::ze::GetKernelName(kernel, options_.demangle);
+
+    ze_kernel_properties_t props{ZE_STRUCTURE_TYPE_KERNEL_PROPERTIES, nullptr};
+    overhead::Init();
+    ze_result_t status = zeKernelGetProperties(kernel, &props);
+    overhead_fini("zeKernelGetProperties");
+    PTI_ASSERT(status == ZE_RESULT_SUCCESS);
+    info->simd_width_ = props.maxSubgroupSize;
+    info->num_kernel_args_ = props.numKernelArgs;
+    info->private_mem_size_ = props.privateMemSize;
+    info->local_mem_size_ = props.localMemSize;
+    info->spill_mem_size_ = props.spillMemSize;
+    info->required_group_size_[0] = props.requiredGroupSizeX;
+    info->required_group_size_[1] = props.requiredGroupSizeY;
+    info->required_group_size_[2] = props.requiredGroupSizeZ;
+    std::copy_n(props.uuid.mid, PTI_MAX_MODULE_UUID_SIZE, info->module_uuid_);
+    return info;
+  }
+
+  static bool IsSameKernel(const ZeKernelInfo& left, const ZeKernelInfo& right) {
+    return left.name_ == right.name_ &&
+           std::equal(left.module_uuid_, left.module_uuid_ + PTI_MAX_MODULE_UUID_SIZE,
+                      right.module_uuid_) &&
+           left.simd_width_ == right.simd_width_ &&
+           left.num_kernel_args_ == right.num_kernel_args_ &&
+           left.private_mem_size_ == right.private_mem_size_ &&
+           left.local_mem_size_ == right.local_mem_size_ &&
+           left.spill_mem_size_ == right.spill_mem_size_ &&
+           std::equal(left.required_group_size_, left.required_group_size_ + 3,
+                      right.required_group_size_);
+  }
+
   ZeKernelGroupSize GetKernelGroupSize(ze_kernel_handle_t kernel) {
     // PTI_ASSERT(kernel != nullptr);
     const std::lock_guard<std::mutex> lock(lock_);
@@ -1166,13 +1575,13 @@ class ZeCollector {
       if (ZeCollectionMode::Local == collector->collection_mode_) {
         const std::lock_guard<std::mutex> lock(collector->lock_);
         collector->destroyed_events_.insert(*(params->phEvent));
+        collector->timestamp_event_cache_.Forget(*(params->phEvent));
       }
     }
   }
 
   static void OnEnterEventHostReset(ze_event_host_reset_params_t* params, void* global_data,
-                                    void** /*instance_data*/,
-                                    [[maybe_unused]] std::vector<uint64_t>* kids) {
+                                    void** /*instance_data*/, std::vector<uint64_t>* kids) {
     SPDLOG_TRACE("In {} event: {}", __FUNCTION__, (void*)*(params->phEvent));
     if (*(params->phEvent) != nullptr) {
       ZeCollector* collector = static_cast<ZeCollector*>(global_data);
@@ -1192,6 +1601,15 @@ class ZeCollector {
           if (status != ZE_RESULT_SUCCESS) {
             SPDLOG_WARN("\tIn {} zeEventHostReset returned: {}, ", __FUNCTION__, (uint32_t)status);
           }
+        } else if (collector->timestamp_event_cache_.IsAppTimestampEvent(*(params->phEvent))) {
+          // timestamps are in the application event itself - take them before they are reset
+          {
+            const std::lock_guard<std::mutex> lock(collector->lock_);
+            collector->ProcessCallEvent(*(params->phEvent), kids, &kcexec);
+          }
+          if (collector->cb_enabled_.acallback && collector->acallback_ != nullptr) {
+            collector->acallback_(collector->callback_data_, kcexec);
+          }
         }
       }
     }
@@ -1201,6 +1619,9 @@ class ZeCollector {
                                          ze_result_t result, void* global_data,
                                          void** /*instance_data*/, std::vector<uint64_t>* kids) {
     SPDLOG_TRACE("In {} event: {}", __FUNCTION__, (void*)*(params->phEvent));
+    // 0 if the wait started before the tracing was enabled, the wait is not recorded then
+    uint64_t sync_start_time = ze_instance_data.start_time_host;
+    uint64_t sync_end_time = utils::GetTime();
     if (result == ZE_RESULT_SUCCESS) {
       ZeCollector* collector = static_cast<ZeCollector*>(global_data);
       std::vector<ZeKernelCommandExecutionRecord> kcexec;
@@ -1209,6 +1630,10 @@ class ZeCollector {
         collector->ProcessCallEvent(*(params->phEvent), kids, &kcexec);
       }
       if (collector->cb_enabled_.acallback && collector->acallback_ != nullptr) {
+        if (sync_start_time != 0) {
+          collector->AppendHostSyncRecord(PTI_VIEW_HOST_SYNC_TYPE_EVENT, *(params->phEvent),
+                                          sync_start_time, sync_end_time, &kcexec);
+        }
         collector->acallback_(collector->callback_data_, kcexec);
       }
     }
@@ -1245,6 +1670,8 @@ class ZeCollector {
                                          ze_result_t result, void* global_data,
                                          void** /*instance_data*/, std::vector<uint64_t>* kids) {
     SPDLOG_TRACE("In {}, result {} ", __FUNCTION__, static_cast<uint32_t>(result));
+    uint64_t sync_start_time = ze_instance_data.start_time_host;
+    uint64_t sync_end_time = utils::GetTime();
     if (result == ZE_RESULT_SUCCESS) {
       PTI_ASSERT(*(params->phFence) != nullptr);
       ZeCollector* collector = static_cast<ZeCollector*>(global_data);
@@ -1255,6 +1682,10 @@ class ZeCollector {
       }
 
       if (collector->cb_enabled_.acallback && collector->acallback_ != nullptr) {
+        if (sync_start_time != 0) {
+          collector->AppendHostSyncRecord(PTI_VIEW_HOST_SYNC_TYPE_FENCE, *(params->phFence),
+                                          sync_start_time, sync_end_time, &kcexec);
+        }
         collector->acallback_(collector->callback_data_, kcexec);
       }
     }
@@ -1319,6 +1750,7 @@ class ZeCollector {
     SPDLOG_TRACE("In {} Collection mode: {}, Cmdl: {}, signal_event: {}, kernel_type: {}",
                  __FUNCTION__, (uint32_t)collector->collection_mode_, (void*)command_list,
                  (void*)signal_event, (uint32_t)kernel_type);
+    *instance_data = nullptr;
 
     if (!collector->CommandListInfoExists(command_list)) {
       ze_result_t res = collector->ReBuildCommandListInfo(command_list);
@@ -1327,6 +1759,11 @@ class ZeCollector {
         return;
       }
     }
+    if (!collector->IsInCollectionScope(command_list)) {
+      // no event injected and no command kept for operations out of the collection scope
+      SPDLOG_TRACE("\tCmdl: {} is out of the collection scope", (void*)command_list);
+      return;
+    }
     const std::lock_guard<std::mutex> lock(collector->lock_);
     ze_context_handle_t context = collector->GetCommandListContext(command_list);
     ze_device_handle_t device = collector->GetCommandListDevice(command_list);
@@ -1357,7 +1794,14 @@ class ZeCollector {
       // Swapping the events:
       // Target kernel will signal the new ("swap") event with Timestamp enabled
       // Bridge Kernel will signal the Target Kernel initial event
-      if (signal_event != nullptr) {
+      // No Bridge needed if the application event could carry the timestamps itself
+      A2TimestampRoute route =
+          collector->timestamp_event_cache_.GetRoute(collector->l0_wrapper_, signal_event);
+      if (A2TimestampRoute::kAppEvent == route) {
+        SPDLOG_TRACE("\t\tTimestamps will be queried directly from app event: {}",
+                     static_cast<const void*>(signal_event));
+        command->event_self = signal_event;
+      } else if (A2TimestampRoute::kBridge == route) {
         ze_event_handle_t swap_event =
             collector->swap_event_pool_.GetSwapEventFromShadowCache(signal_event);
         SPDLOG_TRACE("\t\tContext: {}, Device: {}, self_event: {}, swap_event: {}", (void*)context,
@@ -1388,6 +1832,11 @@ class ZeCollector {
       }
     }
 
+    ZeKernelMetrics* kernel_metrics = collector->kernel_metrics_;
+    if (kernel_type == KernelCommandType::kKernel && kernel_metrics != nullptr) {
+      command->metric_sample = kernel_metrics->Begin(command_list, context, device);
+    }
+
     uint64_t host_timestamp = 0;
     uint64_t device_timestamp = 0;  // in ticks
 
@@ -1480,11 +1929,19 @@ class ZeCollector {
       SPDLOG_DEBUG("\t\t Will be appending Bridge command!");
       bool append_res = true;
       if (command->props.type == KernelCommandType::kKernel) {
+        auto dev_it = device_descriptors_.find(command->device);
+        ze_driver_handle_t driver =
+            (dev_it != device_descriptors_.end()) ? dev_it->second.driver : nullptr;
         ze_kernel_handle_t kernel =
-            bridge_kernel_pool_.GetMarkKernel(command->context, command->device);
-        PTI_ASSERT(kernel != nullptr);
-        append_res = A2AppendBridgeKernel(kernel, command->command_list, command->event_self,
-                                          command->event_swap);
+            bridge_kernel_pool_.GetMarkKernel(command->context, command->device, driver);
+        if (kernel != nullptr) {
+          append_res = A2AppendBridgeKernel(kernel, command->command_list, command->event_self,
+                                            command->event_swap);
+        } else {
+          // no bridge kernel could be built for the device, a barrier does the same
+          append_res = A2AppendBridgeBarrier(command->command_list, command->event_self,
+                                             command->event_swap);
+        }
       } else if (command->props.type == KernelCommandType::kMemory) {
         SPDLOG_TRACE("\t\tDevices in Memory command: src: {}, dst {}",
                      (void*)command->props.src_device, (void*)command->props.dst_device);
@@ -1507,6 +1964,9 @@ class ZeCollector {
                         const ze_group_count_t* group_count, ze_event_handle_t& signal_event,
                         ze_command_list_handle_t command_list, void** instance_data,
                         std::vector<uint64_t>* kids) {
+    if (*instance_data == nullptr) {
+      return;  // out of the collection scope
+    }
     PTI_ASSERT(command_list != nullptr);
     PTI_ASSERT(kernel != nullptr);
     const std::lock_guard<std::mutex> lock(lock_);
@@ -1514,10 +1974,16 @@ class ZeCollector {
 
     ZeKernelCommandProps props{};
 
-    props.name = utils::ze::GetKernelName(kernel, options_.demangle);
+    // name and properties of a kernel are queried once, at its first launch
+    props.kernel_info = GetKernelInfo(kernel);
+    props.name = props.kernel_info->name_;
     props.type = KernelCommandType::kKernel;
-    props.simd_width = utils::ze::GetKernelMaxSubgroupSize(kernel);
+    props.simd_width = props.kernel_info->simd_width_;
     props.bytes_transferred = 0;
+    if (kernel_args_enabled_) {
+      props.kernel_args = kernel_args_.GetArgSet(kernel, props.kernel_info->id_,
+                                                 props.kernel_info->num_kernel_args_);
+    }
 
     ZeKernelGroupSize group_size{};
     if (kernel_group_size_map_.count(kernel) == 0) {
@@ -1538,8 +2004,16 @@ class ZeCollector {
 
     ZeCommandListInfo& command_list_info = GetCommandListInfo(command_list);
 
-    PostAppendKernelCommandCommon(collector, (ZeKernelCommand*)*instance_data, props, signal_event,
-                                  command_list_info, kids);
+    auto* command = static_cast<ZeKernelCommand*>(*instance_data);
+    if (command->metric_sample != nullptr) {
+      ze_event_handle_t metric_event = event_cache_.GetEvent(command->context);
+      if (!command->metric_sample->End(command_list, metric_event)) {
+        command->metric_sample.reset();
+      }
+    }
+
+    PostAppendKernelCommandCommon(collector, command, props, signal_event, command_list_info,
+                                  kids);
   }
 
   void PostAppendMemoryCommand(ZeCollector* collector, std::string command_name,
@@ -1552,6 +2026,9 @@ class ZeCollector {
                  bytes_transferred: {}, pattern_size: {}",
         __FUNCTION__, (void*)command_list, (void*)signal_event, dst, src, bytes_transferred,
         pattern_size);
+    if (*instance_data == nullptr) {
+      return;  // out of the collection scope
+    }
     if (ZeCollectionState::Abnormal == collection_state_) {
       return;
     }
@@ -1584,6 +2061,9 @@ class ZeCollector {
                                   ze_command_list_handle_t command_list, void** instance_data,
                                   std::vector<uint64_t>* kids) {
     SPDLOG_TRACE("In {}", __FUNCTION__);
+    if (*instance_data == nullptr) {
+      return;  // out of the collection scope
+    }
     PTI_ASSERT(command_list != nullptr);
     ZeCommandListInfo& command_list_info = GetCommandListInfo(command_list);
 
@@ -1604,6 +2084,9 @@ class ZeCollector {
                                     ze_command_list_handle_t command_list, void** instance_data,
                                     std::vector<uint64_t>* kids) {
     SPDLOG_TRACE("In {}", __FUNCTION__);
+    if (*instance_data == nullptr) {
+      return;  // out of the collection scope
+    }
     PTI_ASSERT(command_list != nullptr);
 
     ZeCommandListInfo& command_list_info = GetCommandListInfo(command_list);
@@ -1629,6 +2112,9 @@ class ZeCollector {
                          ze_event_handle_t& signal_event, ze_command_list_handle_t command_list,
                          void** instance_data, std::vector<uint64_t>* kids) {
     SPDLOG_TRACE("In {}", __FUNCTION__);
+    if (*instance_data == nullptr) {
+      return;  // out of the collection scope
+    }
     if (ZeCollectionState::Abnormal == collection_state_) {
       return;
     }
@@ -2095,8 +2581,12 @@ class ZeCollector {
       PTI_ASSERT(**params->pphCommandList != nullptr);
       ZeCollector* collector = static_cast<ZeCollector*>(global_data);
 
-      // dummy pair
+      // queue index is known at execute only, ordinal is for the harvest lists of the replays
       std::pair<uint32_t, uint32_t> oi(-1, -1);
+      const ze_command_list_desc_t* desc = *(params->pdesc);
+      if (desc != nullptr) {
+        oi.first = desc->commandQueueGroupOrdinal;
+      }
       collector->CreateCommandListInfo(**(params->pphCommandList), *(params->phContext),
                                        *(params->phDevice), oi, false);
     }
@@ -2141,6 +2631,7 @@ class ZeCollector {
 
       collector->lock_.lock();
       collector->ProcessCalls(nullptr, &kcexec);
+      collector->ResetCommandList(*params->phCommandList);
       collector->lock_.unlock();
 
       if (collector->cb_enabled_.acallback && collector->acallback_ != nullptr) {
@@ -2158,7 +2649,7 @@ class ZeCollector {
       std::vector<ZeKernelCommandExecutionRecord> kcexec;
       collector->lock_.lock();
       collector->ProcessCalls(nullptr, &kcexec);
-      // collector->ResetCommandList(*params->phCommandList);
+      collector->ResetCommandList(*params->phCommandList);
       collector->lock_.unlock();
 
       if (collector->cb_enabled_.acallback && collector->acallback_ != nullptr) {
@@ -2167,6 +2658,16 @@ class ZeCollector {
     }
   }
 
+  static void OnExitCommandListClose(ze_command_list_close_params_t* params, ze_result_t result,
+                                     void* global_data, void** /*instance_data*/) {
+    SPDLOG_TRACE("In {}, result: {}", __FUNCTION__, static_cast<uint32_t>(result));
+    if (result == ZE_RESULT_SUCCESS) {
+      PTI_ASSERT(*params->phCommandList != nullptr);
+      ZeCollector* collector = static_cast<ZeCollector*>(global_data);
+      collector->RecordCommandList(*params->phCommandList);
+    }
+  }
+
   static void OnEnterCommandQueueExecuteCommandLists(
       ze_command_queue_execute_command_lists_params_t* params, void* global_data,
       void** /*instance_data*/) {
@@ -2185,14 +2686,28 @@ class ZeCollector {
 
     collector->PrepareToExecuteCommandLists(command_lists, command_list_count,
                                             *(params->phCommandQueue), *(params->phFence));
+
+    if (!ze_execute_replays.replays.empty()) {
+      // harvest list of a replay is executed right after its command list
+      ze_execute_replays.command_lists = command_lists;
+      ze_execute_replays.command_list_count = command_list_count;
+      *(params->pphCommandLists) = ze_execute_replays.executed_lists.data();
+      *(params->pnumCommandLists) =
+          static_cast<uint32_t>(ze_execute_replays.executed_lists.size());
+    }
   }
 
   static void OnExitCommandQueueExecuteCommandLists(
       ze_command_queue_execute_command_lists_params_t* params, ze_result_t result,
       void* global_data, void** /*instance_data*/, std::vector<uint64_t>* kids) {
     SPDLOG_TRACE("In {}, result: {}", __FUNCTION__, static_cast<uint32_t>(result));
+    ZeCollector* collector = static_cast<ZeCollector*>(global_data);
+    if (!ze_execute_replays.replays.empty()) {
+      *(params->pphCommandLists) = ze_execute_replays.command_lists;
+      *(params->pnumCommandLists) = ze_execute_replays.command_list_count;
+      collector->PostSubmitReplays(result == ZE_RESULT_SUCCESS);
+    }
     if (result == ZE_RESULT_SUCCESS) {
-      ZeCollector* collector = static_cast<ZeCollector*>(global_data);
       uint32_t command_list_count = *params->pnumCommandLists;
       if (command_list_count == 0) {
         return;
@@ -2207,10 +2722,12 @@ class ZeCollector {
     }
   }
 
-  static void OnExitCommandQueueSynchronize(ze_command_queue_synchronize_params_t* /*params*/,
+  static void OnExitCommandQueueSynchronize(ze_command_queue_synchronize_params_t* params,
                                             ze_result_t result, void* global_data,
                                             void** /*instance_data*/, std::vector<uint64_t>* kids) {
     SPDLOG_TRACE("In {}, result: {}", __FUNCTION__, static_cast<uint32_t>(result));
+    uint64_t sync_start_time = ze_instance_data.start_time_host;
+    uint64_t sync_end_time = utils::GetTime();
     if (result == ZE_RESULT_SUCCESS) {
       ZeCollector* collector = static_cast<ZeCollector*>(global_data);
       {
@@ -2219,6 +2736,11 @@ class ZeCollector {
         collector->ProcessCalls(kids, &kcexec);
 
         if (collector->cb_enabled_.acallback && collector->acallback_ != nullptr) {
+          if (sync_start_time != 0) {
+            collector->AppendHostSyncRecord(PTI_VIEW_HOST_SYNC_TYPE_COMMAND_QUEUE,
+                                            *(params->phCommandQueue), sync_start_time,
+                                            sync_end_time, &kcexec);
+          }
           collector->acallback_(collector->callback_data_, kcexec);
         }
       }
@@ -2297,9 +2819,107 @@ class ZeCollector {
     if (result == ZE_RESULT_SUCCESS) {
       ZeCollector* collector = static_cast<ZeCollector*>(global_data);
       collector->RemoveKernelGroupSize(*(params->phKernel));
+      collector->RemoveKernelInfo(*(params->phKernel));
     }
   }
 
+  static void OnExitKernelSetArgumentValue(ze_kernel_set_argument_value_params_t* params,
+                                           ze_result_t result, void* global_data,
+                                           void** /*instance_data*/) {
+    SPDLOG_TRACE("In {}, result: {}", __FUNCTION__, static_cast<uint32_t>(result));
+    ZeCollector* collector = static_cast<ZeCollector*>(global_data);
+    if (result == ZE_RESULT_SUCCESS && collector->kernel_args_enabled_) {
+      const std::lock_guard<std::mutex> lock(collector->lock_);
+      collector->kernel_args_.SetArgument(*(params->phKernel), *(params->pargIndex),
+                                          *(params->pargSize), *(params->ppArgValue));
+    }
+  }
+
+  // Allocations are followed for PTI_VIEW_KERNEL_ARGS only
+  void AddUsmAllocation(ze_context_handle_t context, const void* ptr, size_t size,
+                        pti_view_memory_type type) {
+    if (!kernel_args_enabled_) {
+      return;
+    }
+    const std::lock_guard<std::mutex> lock(lock_);
+    kernel_args_.GetUsmAllocations().Add(context, ptr, size, type);
+  }
+
+  static void OnExitMemAllocHost(ze_mem_alloc_host_params_t* params, ze_result_t result,
+                                 void* global_data, void** /*instance_data*/) {
+    SPDLOG_TRACE("In {}, result: {}", __FUNCTION__, static_cast<uint32_t>(result));
+    if (result == ZE_RESULT_SUCCESS) {
+      ZeCollector* collector = static_cast<ZeCollector*>(global_data);
+      collector->AddUsmAllocation(*(params->phContext), **(params->ppptr), *(params->psize),
+                                  pti_view_memory_type::PTI_VIEW_MEMORY_TYPE_HOST);
+    }
+  }
+
+  static void OnExitMemAllocDevice(ze_mem_alloc_device_params_t* params, ze_result_t result,
+                                   void* global_data, void** /*instance_data*/) {
+    SPDLOG_TRACE("In {}, result: {}", __FUNCTION__, static_cast<uint32_t>(result));
+    if (result == ZE_RESULT_SUCCESS) {
+      ZeCollector* collector = static_cast<ZeCollector*>(global_data);
+      collector->AddUsmAllocation(*(params->phContext), **(params->ppptr), *(params->psize),
+                                  pti_view_memory_type::PTI_VIEW_MEMORY_TYPE_DEVICE);
+    }
+  }
+
+  static void OnExitMemAllocShared(ze_mem_alloc_shared_params_t* params, ze_result_t result,
+                                   void* global_data, void** /*instance_data*/) {
+    SPDLOG_TRACE("In {}, result: {}", __FUNCTION__, static_cast<uint32_t>(result));
+    if (result == ZE_RESULT_SUCCESS) {
+      ZeCollector* collector = static_cast<ZeCollector*>(global_data);
+      collector->AddUsmAllocation(*(params->phContext), **(params->ppptr), *(params->psize),
+                                  pti_view_memory_type::PTI_VIEW_MEMORY_TYPE_SHARED);
+    }
+  }
+
+  static void OnExitMemFree(ze_mem_free_params_t* params, ze_result_t result, void* global_data,
+                            void** /*instance_data*/) {
+    SPDLOG_TRACE("In {}, result: {}", __FUNCTION__, static_cast<uint32_t>(result));
+    ZeCollector* collector = static_cast<ZeCollector*>(global_data);
+    if (result == ZE_RESULT_SUCCESS && collector->kernel_args_enabled_) {
+      const std::lock_guard<std::mutex> lock(collector->lock_);
+      collector->kernel_args_.GetUsmAllocations().Remove(*(params->pptr));
+    }
+  }
+
+  static void OnExitKernelCreate(ze_kernel_create_params_t* params, ze_result_t result,
+                                 void* global_data, void** /*instance_data*/) {
+    SPDLOG_TRACE("In {}, result: {}", __FUNCTION__, static_cast<uint32_t>(result));
+    if (result == ZE_RESULT_SUCCESS) {
+      ZeCollector* collector = static_cast<ZeCollector*>(global_data);
+      collector->AddKernelModule(**(params->pphKernel), *(params->phModule));
+    }
+  }
+
+  static void OnExitContextCreate(ze_context_create_params_t* params, ze_result_t result,
+                                  void* global_data, void** /*instance_data*/) {
+    SPDLOG_TRACE("In {}, result: {}", __FUNCTION__, static_cast<uint32_t>(result));
+    if (result == ZE_RESULT_SUCCESS) {
+      ZeCollector* collector = static_cast<ZeCollector*>(global_data);
+      if (collector->collection_mode_ == ZeCollectionMode::Local) {
+        // build bridge kernels now rather than on the first command appended to the context
+        collector->bridge_kernel_pool_.Warmup(**(params->pphContext), *(params->phDriver),
+                                              collector->GetDriverDevices(*(params->phDriver)));
+      }
+    }
+  }
+
+  static void OnEnterContextDestroy(ze_context_destroy_params_t* params, void* global_data,
+                                    void** /*instance_data*/) {
+    SPDLOG_TRACE("In {}", __FUNCTION__);
+    ZeCollector* collector = static_cast<ZeCollector*>(global_data);
+    collector->bridge_kernel_pool_.Clean(*(params->phContext));
+    const std::lock_guard<std::mutex> lock(collector->lock_);
+    for (auto& [group_name, kernel_metrics] : collector->kernel_metrics_by_group_) {
+      kernel_metrics->ReleaseContext(*(params->phContext));
+    }
+    collector->ReleaseRecordedCommandLists(*(params->phContext));
+    collector->kernel_args_.GetUsmAllocations().RemoveContext(*(params->phContext));
+  }
+
   static void OnExitContextDestroy(ze_context_destroy_params_t* params, ze_result_t result,
                                    void* global_data, void** /*instance_data*/) {
     SPDLOG_TRACE("In {}, result: {}", __FUNCTION__, static_cast<uint32_t>(result));
@@ -2315,6 +2935,11 @@ class ZeCollector {
 
 #include <tracing.gen>  // Auto-generated callbacks
 
+  // subscribers of the synchronous API callbacks, indexed by the generated API ids
+  ZeApiSubscribers api_subscribers_{kZeApiNames.data(), kZeApiCount};
+  // queues and threads the operations are collected for
+  ZeCollectionScope collection_scope_;
+
   zel_tracer_handle_t tracer_ = nullptr;
   CollectorOptions options_ = {};
   bool driver_introspection_capable_ = false;
@@ -2336,17 +2961,33 @@ class ZeCollector {
   ZeCommandListMap command_list_map_;
   ZeImageSizeMap image_size_map_;
   ZeKernelGroupSizeMap kernel_group_size_map_;
+  ZeKernelInfoMap kernel_info_map_;
+  std::atomic<uint64_t> tracing_generation_ = 0;  // number of times tracing was started
+  ZeKernelModuleMap kernel_module_map_;
   ZeDeviceMap device_map_;
   std::map<ze_device_handle_t, ZeDeviceDescriptor> device_descriptors_;
 
   ZeEventCache event_cache_;
 
+  // executions of closed command lists not processed yet
+  std::list<ZeReplayInFlight> replays_in_flight_;
+
+  // samplers of kernel metrics by metric group, kernel_metrics_ is the one in use or nullptr
+  std::map<std::string, std::unique_ptr<ZeKernelMetrics>> kernel_metrics_by_group_;
+  ZeKernelMetrics* last_kernel_metrics_ = nullptr;
+  std::atomic<ZeKernelMetrics*> kernel_metrics_ = nullptr;
+
+  // arguments set on kernels and USM allocations, guarded by lock_
+  ZeKernelArgs kernel_args_;
+  std::atomic<bool> kernel_args_enabled_ = false;
+
   std::map<ze_command_queue_handle_t, std::pair<uint32_t, uint32_t>> queue_ordinal_index_map_;
 
   std::map<ze_command_queue_handle_t, ZeCommandQueue> command_queues_;
 
   A2BridgeKernelPool bridge_kernel_pool_;
   A2EventPool swap_event_pool_;
+  A2TimestampEventCache timestamp_event_cache_;
 
   Level0Wrapper l0_wrapper_;
 
@@ -2385,6 +3026,10 @@ class ZeCollector {
         ref_count++;
         return ref_count;
       }
+      // built before the tracing layer is enabled, so the collector does not trace itself
+      parent_collector_->WarmupBridgeKernels();
+      // kernels cached so far are checked again at their first launch in this window
+      parent_collector_->tracing_generation_.fetch_add(1, std::memory_order_relaxed);
       if (parent_collector_->options_.disabled_mode) {
         ze_result_t status = parent_collector_->l0_wrapper_.w_zelEnableTracingLayer();
         if (ZE_RESULT_SUCCESS == status) {
@@ -0,0 +1,241 @@
+//==============================================================
+// Copyright (C) Intel Corporation
+//
+// SPDX-License-Identifier: MIT
+// =============================================================
+
+#ifndef SRC_LEVELZERO_ZE_COMMAND_LIST_REPLAYS_H_
+#define SRC_LEVELZERO_ZE_COMMAND_LIST_REPLAYS_H_
+
+#include <level_zero/ze_api.h>
+#include <spdlog/spdlog.h>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+/**
+ * \internal
+ * Level-Zero APIs used to collect the timestamps of the replays, replaceable by tests
+ */
+struct ZeReplayApi {
+  decltype(&zeMemAllocHost) mem_alloc_host = zeMemAllocHost;
+  decltype(&zeMemFree) mem_free = zeMemFree;
+  decltype(&zeCommandListCreate) command_list_create = zeCommandListCreate;
+  decltype(&zeCommandListClose) command_list_close = zeCommandListClose;
+  decltype(&zeCommandListDestroy) command_list_destroy = zeCommandListDestroy;
+  decltype(&zeCommandListAppendQueryKernelTimestamps) command_list_append_query_kernel_timestamps =
+      zeCommandListAppendQueryKernelTimestamps;
+  decltype(&zeCommandListAppendBarrier) command_list_append_barrier = zeCommandListAppendBarrier;
+  decltype(&zeCommandListAppendEventReset) command_list_append_event_reset =
+      zeCommandListAppendEventReset;
+  decltype(&zeCommandListAppendSignalEvent) command_list_append_signal_event =
+      zeCommandListAppendSignalEvent;
+  decltype(&zeEventQueryStatus) event_query_status = zeEventQueryStatus;
+  decltype(&zeEventHostReset) event_host_reset = zeEventHostReset;
+};
+
+/**
+ * \internal
+ * Device operation appended to a closed command list
+ */
+struct ZeReplayNode {
+  ze_event_handle_t timestamp_event = nullptr;   // holds the timestamps of the operation
+  ze_event_handle_t completion_event = nullptr;  // signaled last for the operation
+  bool owned = false;  // completion event belongs to the collector, reset after every replay
+};
+
+/**
+ * \internal
+ * One execution of a closed command list in flight
+ */
+struct ZeReplay {
+  uint32_t index = 0;  // 0 for the first execution of the command list
+  uint64_t submit_time = 0;         // in ns
+  uint64_t submit_time_device = 0;  // in ticks
+  ze_command_queue_handle_t queue = nullptr;
+  ze_fence_handle_t fence = nullptr;
+  ze_command_list_handle_t harvest_list = nullptr;
+  ze_event_handle_t done_event = nullptr;
+  ze_kernel_timestamp_result_t* timestamps = nullptr;  // one per node, in host memory
+};
+
+/**
+ * \internal
+ * Timestamps of the executions of a closed command list, e.g., a finalized SYCL graph.
+ *
+ * The events of the nodes are signaled again on every execution, so their timestamps are copied
+ * by a harvest command list executed right after the command list: it waits for the nodes,
+ * copies their timestamps into the host buffer of the replay, resets the events owned by the
+ * collector and signals the done event. Harvest lists are built once and reused as replays
+ * complete, so an execution costs no host calls per node. Not thread-safe, the collector lock
+ * guards it.
+ */
+class ZeCommandListReplays {
+ public:
+  ZeCommandListReplays(ze_context_handle_t context, ze_device_handle_t device, uint32_t ordinal,
+                       std::vector<ZeReplayNode> nodes,
+                       std::function<ze_event_handle_t()> get_event,
+                       std::function<void(ze_event_handle_t)> release_event, ZeReplayApi api = {})
+      : context_(context),
+        device_(device),
+        ordinal_(ordinal),
+        nodes_(std::move(nodes)),
+        get_event_(std::move(get_event)),
+        release_event_(std::move(release_event)),
+        api_(api) {}
+
+  ZeCommandListReplays(const ZeCommandListReplays&) = delete;
+  ZeCommandListReplays& operator=(const ZeCommandListReplays&) = delete;
+  ZeCommandListReplays(ZeCommandListReplays&&) = delete;
+  ZeCommandListReplays& operator=(ZeCommandListReplays&&) = delete;
+
+  ~ZeCommandListReplays() {
+    for (auto& replay : replays_) {
+      DestroyReplay(*replay);
+    }
+    for (const auto& node : nodes_) {
+      if (node.owned) {
+        release_event_(node.completion_event);
+      }
+    }
+  }
+
+  size_t GetNodeCount() const { return nodes_.size(); }
+
+  uint32_t GetReplayCount() const { return replay_count_; }
+
+  // Replays created so far, bounded by the number of executions in flight at once
+  size_t GetReplaySlotCount() const { return replays_.size(); }
+
+  // Replay for the next execution, its harvest list goes right after the command list.
+  // nullptr if the harvest list cannot be built
+  ZeReplay* Begin() {
+    ZeReplay* replay = nullptr;
+    if (free_replays_.empty()) {
+      replay = CreateReplay();
+      if (replay == nullptr) {
+        return nullptr;
+      }
+    } else {
+      replay = free_replays_.back();
+      free_replays_.pop_back();
+    }
+    replay->index = replay_count_++;
+    return replay;
+  }
+
+  bool IsComplete(const ZeReplay* replay) const {
+    return api_.event_query_status(replay->done_event) == ZE_RESULT_SUCCESS;
+  }
+
+  // Returns the replay once its timestamps are processed or its execution failed
+  void End(ZeReplay* replay) {
+    ze_result_t status = api_.event_host_reset(replay->done_event);
+    if (status != ZE_RESULT_SUCCESS) {
+      SPDLOG_WARN("zeEventHostReset returned: {}, replay dropped", static_cast<uint32_t>(status));
+      return;
+    }
+    replay->queue = nullptr;
+    replay->fence = nullptr;
+    free_replays_.push_back(replay);
+  }
+
+ private:
+  ZeReplay* CreateReplay() {
+    auto replay = std::make_unique<ZeReplay>();
+    replay->done_event = get_event_();
+    if (replay->done_event == nullptr) {
+      return nullptr;
+    }
+    if (!BuildHarvestList(*replay)) {
+      DestroyReplay(*replay);
+      return nullptr;
+    }
+    replays_.push_back(std::move(replay));
+    return replays_.back().get();
+  }
+
+  void DestroyReplay(ZeReplay& replay) {
+    if (replay.harvest_list != nullptr) {
+      api_.command_list_destroy(replay.harvest_list);
+    }
+    if (replay.timestamps != nullptr) {
+      api_.mem_free(context_, replay.timestamps);
+    }
+    release_event_(replay.done_event);
+  }
+
+  bool BuildHarvestList(ZeReplay& replay) {
+    ze_host_mem_alloc_desc_t alloc_desc = {ZE_STRUCTURE_TYPE_HOST_MEM_ALLOC_DESC, nullptr, 0};
+    void* buffer = nullptr;
+    ze_result_t status =
+        api_.mem_alloc_host(context_, &alloc_desc, nodes_.size() * sizeof(*replay.timestamps),
+                            alignof(ze_kernel_timestamp_result_t), &buffer);
+    if (status != ZE_RESULT_SUCCESS) {
+      SPDLOG_WARN("zeMemAllocHost returned: {}", static_cast<uint32_t>(status));
+      return false;
+    }
+    replay.timestamps = static_cast<ze_kernel_timestamp_result_t*>(buffer);
+
+    ze_command_list_desc_t list_desc = {ZE_STRUCTURE_TYPE_COMMAND_LIST_DESC, nullptr, ordinal_, 0};
+    status = api_.command_list_create(context_, device_, &list_desc, &replay.harvest_list);
+    if (status != ZE_RESULT_SUCCESS) {
+      SPDLOG_WARN("zeCommandListCreate returned: {}", static_cast<uint32_t>(status));
+      replay.harvest_list = nullptr;
+      return false;
+    }
+
+    std::vector<ze_event_handle_t> timestamp_events;
+    std::vector<ze_event_handle_t> wait_events;
+    timestamp_events.reserve(nodes_.size());
+    for (const auto& node : nodes_) {
+      timestamp_events.push_back(node.timestamp_event);
+      wait_events.push_back(node.timestamp_event);
+      if (node.completion_event != node.timestamp_event) {
+        wait_events.push_back(node.completion_event);
+      }
+    }
+
+    ze_command_list_handle_t list = replay.harvest_list;
+    status = api_.command_list_append_query_kernel_timestamps(
+        list, static_cast<uint32_t>(timestamp_events.size()), timestamp_events.data(),
+        replay.timestamps, nullptr, nullptr, static_cast<uint32_t>(wait_events.size()),
+        wait_events.data());
+    // the events are reset once their timestamps are copied
+    if (status == ZE_RESULT_SUCCESS) {
+      status = api_.command_list_append_barrier(list, nullptr, 0, nullptr);
+    }
+    for (const auto& node : nodes_) {
+      if (status == ZE_RESULT_SUCCESS && node.owned) {
+        status = api_.command_list_append_event_reset(list, node.completion_event);
+      }
+    }
+    if (status == ZE_RESULT_SUCCESS) {
+      status = api_.command_list_append_signal_event(list, replay.done_event);
+    }
+    if (status == ZE_RESULT_SUCCESS) {
+      status = api_.command_list_close(list);
+    }
+    if (status != ZE_RESULT_SUCCESS) {
+      SPDLOG_WARN("Harvest command list is not built: {}", static_cast<uint32_t>(status));
+      return false;
+    }
+    return true;
+  }
+
+  ze_context_handle_t context_;
+  ze_device_handle_t device_;
+  uint32_t ordinal_;
+  std::vector<ZeReplayNode> nodes_;
+  std::function<ze_event_handle_t()> get_event_;
+  std::function<void(ze_event_handle_t)> release_event_;
+  ZeReplayApi api_;
+  std::vector<std::unique_ptr<ZeReplay>> replays_;
+  std::vector<ZeReplay*> free_replays_;
+  uint32_t replay_count_ = 0;
+};
+
+#endif  // SRC_LEVELZERO_ZE_COMMAND_LIST_REPLAYS_H_
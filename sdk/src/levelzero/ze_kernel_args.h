@@ -0,0 +1,273 @@
+//==============================================================
+// Copyright (C) Intel Corporation
+//
+// SPDX-License-Identifier: MIT
+// =============================================================
+
+#ifndef SRC_LEVELZERO_ZE_KERNEL_ARGS_H_
+#define SRC_LEVELZERO_ZE_KERNEL_ARGS_H_
+
+#include <level_zero/ze_api.h>
+
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "pti/pti_view.h"
+
+/**
+ * \internal
+ * Argument values of kernel launches, reported once as the PTI_VIEW_KERNEL_ARGS record.
+ * Pointers given to the record point into the set.
+ */
+struct ZeKernelArgSet {
+  ZeKernelArgSet() = default;
+  ZeKernelArgSet(const ZeKernelArgSet&) = delete;
+  ZeKernelArgSet& operator=(const ZeKernelArgSet&) = delete;
+  ZeKernelArgSet(ZeKernelArgSet&&) = delete;
+  ZeKernelArgSet& operator=(ZeKernelArgSet&&) = delete;
+
+  uint64_t id_ = 0;
+  uint64_t kernel_info_id_ = 0;
+  std::vector<pti_kernel_arg> args_;
+  std::vector<uint8_t> data_;  // values larger than 8 bytes, args_ point into it
+};
+
+/**
+ * \internal
+ * USM allocations made while tracing, they tell pointer arguments from values
+ */
+class ZeUsmAllocations {
+ public:
+  void Add(ze_context_handle_t context, const void* ptr, size_t size, pti_view_memory_type type) {
+    if (ptr == nullptr) {
+      return;
+    }
+    allocations_[reinterpret_cast<uint64_t>(ptr)] = {context, size, type};
+  }
+
+  void Remove(const void* ptr) { allocations_.erase(reinterpret_cast<uint64_t>(ptr)); }
+
+  // Allocations of the context are freed with it
+  void RemoveContext(ze_context_handle_t context) {
+    for (auto it = allocations_.begin(); it != allocations_.end();) {
+      it = (it->second.context == context) ? allocations_.erase(it) : std::next(it);
+    }
+  }
+
+  // false if the address is not in an allocation
+  bool Find(uint64_t address, pti_view_memory_type& type) const {
+    auto it = allocations_.upper_bound(address);
+    if (it == allocations_.begin()) {
+      return false;
+    }
+    --it;
+    if (address - it->first >= it->second.size) {
+      return false;
+    }
+    type = it->second.type;
+    return true;
+  }
+
+  size_t GetCount() const { return allocations_.size(); }
+
+ private:
+  struct Allocation {
+    ze_context_handle_t context = nullptr;
+    size_t size = 0;
+    pti_view_memory_type type = PTI_VIEW_MEMORY_TYPE_MEMORY;
+  };
+
+  std::map<uint64_t, Allocation> allocations_;  // by base address
+};
+
+/**
+ * \internal
+ * Arguments set on kernels and their distinct argument sets.
+ *
+ * A launch takes the set of the current arguments of the kernel: the one of the previous launch
+ * if no argument changed since, else the set with the same values found by hash, so the cost is
+ * per distinct argument set rather than per launch. At most kMaxArgSetsPerKernel sets of a kernel
+ * are kept for that, a kernel launched with ever new arguments starts over with new sets then.
+ * Not thread-safe, the collector lock guards it.
+ */
+class ZeKernelArgs {
+ public:
+  static constexpr size_t kMaxArgSetsPerKernel = 256;
+
+  ZeUsmAllocations& GetUsmAllocations() { return usm_allocations_; }
+
+  // Snapshot of the value of zeKernelSetArgumentValue
+  void SetArgument(ze_kernel_handle_t kernel, uint32_t index, size_t size, const void* value) {
+    ArgValue arg;
+    arg.size = static_cast<uint32_t>(size);
+    if (value == nullptr) {
+      arg.type = PTI_KERNEL_ARG_TYPE_LOCAL;
+    } else if (size <= sizeof(arg.value)) {
+      arg.type = PTI_KERNEL_ARG_TYPE_VALUE;
+      std::memcpy(&arg.value, value, size);
+      if (size == sizeof(void*) && usm_allocations_.Find(arg.value, arg.memory_type)) {
+        arg.type = PTI_KERNEL_ARG_TYPE_POINTER;
+      }
+    } else {
+      arg.type = PTI_KERNEL_ARG_TYPE_VALUE;
+      const auto* bytes = static_cast<const uint8_t*>(value);
+      arg.data.assign(bytes, bytes + size);
+    }
+
+    KernelArgs& kernel_args = kernels_[kernel];
+    if (kernel_args.values.size() <= index) {
+      kernel_args.values.resize(index + 1);
+    }
+    if (kernel_args.values[index] == arg) {
+      // e.g., the same arguments set again before every launch
+      return;
+    }
+    kernel_args.values[index] = std::move(arg);
+    kernel_args.current.reset();
+  }
+
+  // Argument set of a launch of the kernel with arg_count arguments
+  std::shared_ptr<const ZeKernelArgSet> GetArgSet(ze_kernel_handle_t kernel,
+                                                  uint64_t kernel_info_id, uint32_t arg_count) {
+    KernelArgs& kernel_args = kernels_[kernel];
+    if (kernel_args.values.size() < arg_count) {
+      kernel_args.values.resize(arg_count);
+      kernel_args.current.reset();
+    }
+    if (kernel_args.current != nullptr) {
+      return kernel_args.current;
+    }
+
+    uint64_t hash = Hash(kernel_args.values);
+    auto range = kernel_args.sets.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+      if (Matches(*it->second, kernel_args.values)) {
+        kernel_args.current = it->second;
+        return kernel_args.current;
+      }
+    }
+
+    auto arg_set = CreateArgSet(kernel_info_id, kernel_args.values);
+    if (kernel_args.sets.size() >= kMaxArgSetsPerKernel) {
+      kernel_args.sets.clear();
+    }
+    kernel_args.sets.emplace(hash, arg_set);
+    kernel_args.current = arg_set;
+    return arg_set;
+  }
+
+  // Launches already appended keep their argument sets alive
+  void RemoveKernel(ze_kernel_handle_t kernel) { kernels_.erase(kernel); }
+
+  // Arguments and allocations are not followed while the view is disabled, they are forgotten
+  void Clear() {
+    kernels_.clear();
+    usm_allocations_ = ZeUsmAllocations();
+  }
+
+  size_t GetArgSetCount(ze_kernel_handle_t kernel) const {
+    auto it = kernels_.find(kernel);
+    return it == kernels_.end() ? 0 : it->second.sets.size();
+  }
+
+ private:
+  struct ArgValue {
+    pti_kernel_arg_type type = PTI_KERNEL_ARG_TYPE_NOT_SET;
+    pti_view_memory_type memory_type = PTI_VIEW_MEMORY_TYPE_MEMORY;
+    uint32_t size = 0;
+    uint64_t value = 0;         // values of up to 8 bytes
+    std::vector<uint8_t> data;  // larger values
+
+    bool operator==(const ArgValue& other) const {
+      return type == other.type && memory_type == other.memory_type && size == other.size &&
+             value == other.value && data == other.data;
+    }
+  };
+
+  struct KernelArgs {
+    std::vector<ArgValue> values;  // by index
+    std::shared_ptr<const ZeKernelArgSet> current;  // set of the values, nullptr once changed
+    std::unordered_multimap<uint64_t, std::shared_ptr<const ZeKernelArgSet>> sets;  // by hash
+  };
+
+  // FNV-1a
+  static void HashBytes(uint64_t& hash, const void* bytes, size_t size) {
+    constexpr uint64_t kPrime = 0x100000001b3ULL;
+    const auto* data = static_cast<const uint8_t*>(bytes);
+    for (size_t i = 0; i < size; ++i) {
+      hash = (hash ^ data[i]) * kPrime;
+    }
+  }
+
+  static uint64_t Hash(const std::vector<ArgValue>& values) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (const auto& arg : values) {
+      HashBytes(hash, &arg.type, sizeof(arg.type));
+      HashBytes(hash, &arg.memory_type, sizeof(arg.memory_type));
+      HashBytes(hash, &arg.size, sizeof(arg.size));
+      HashBytes(hash, &arg.value, sizeof(arg.value));
+      HashBytes(hash, arg.data.data(), arg.data.size());
+    }
+    return hash;
+  }
+
+  static bool Matches(const ZeKernelArgSet& arg_set, const std::vector<ArgValue>& values) {
+    if (arg_set.args_.size() != values.size()) {
+      return false;
+    }
+    for (size_t i = 0; i < values.size(); ++i) {
+      const pti_kernel_arg& arg = arg_set.args_[i];
+      const ArgValue& value = values[i];
+      if (arg._type != value.type || arg._memory_type != value.memory_type ||
+          arg._size != value.size || arg._value != value.value) {
+        return false;
+      }
+      if (!value.data.empty() &&
+          std::memcmp(arg._data, value.data.data(), value.data.size()) != 0) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  std::shared_ptr<const ZeKernelArgSet> CreateArgSet(uint64_t kernel_info_id,
+                                                     const std::vector<ArgValue>& values) {
+    auto arg_set = std::make_shared<ZeKernelArgSet>();
+    arg_set->id_ = next_arg_set_id_++;
+    arg_set->kernel_info_id_ = kernel_info_id;
+    arg_set->args_.reserve(values.size());
+    std::vector<size_t> data_offsets;
+    data_offsets.reserve(values.size());
+    for (size_t i = 0; i < values.size(); ++i) {
+      const ArgValue& value = values[i];
+      pti_kernel_arg arg{};
+      arg._index = static_cast<uint32_t>(i);
+      arg._size = value.size;
+      arg._type = value.type;
+      arg._memory_type = value.memory_type;
+      arg._value = value.value;
+      arg._data = nullptr;
+      arg_set->args_.push_back(arg);
+      data_offsets.push_back(arg_set->data_.size());
+      arg_set->data_.insert(arg_set->data_.end(), value.data.begin(), value.data.end());
+    }
+    // the data does not move anymore
+    for (size_t i = 0; i < values.size(); ++i) {
+      if (!values[i].data.empty()) {
+        arg_set->args_[i]._data = arg_set->data_.data() + data_offsets[i];
+      }
+    }
+    return arg_set;
+  }
+
+  std::map<ze_kernel_handle_t, KernelArgs> kernels_;
+  ZeUsmAllocations usm_allocations_;
+  uint64_t next_arg_set_id_ = 1;
+};
+
+#endif  // SRC_LEVELZERO_ZE_KERNEL_ARGS_H_
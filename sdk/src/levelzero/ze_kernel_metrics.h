@@ -0,0 +1,464 @@
+//==============================================================
+// Copyright (C) Intel Corporation
+//
+// SPDX-License-Identifier: MIT
+// =============================================================
+
+#ifndef SRC_LEVELZERO_ZE_KERNEL_METRICS_H_
+#define SRC_LEVELZERO_ZE_KERNEL_METRICS_H_
+
+#include <level_zero/ze_api.h>
+#include <level_zero/zet_api.h>
+#include <spdlog/spdlog.h>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "pti/pti_view.h"
+
+/**
+ * \internal
+ * Level-Zero metric APIs used for the kernel metrics, replaceable by tests
+ */
+struct ZeMetricApi {
+  decltype(&zetMetricGroupGet) metric_group_get = zetMetricGroupGet;
+  decltype(&zetMetricGroupGetProperties) metric_group_get_properties =
+      zetMetricGroupGetProperties;
+  decltype(&zetMetricGet) metric_get = zetMetricGet;
+  decltype(&zetMetricGetProperties) metric_get_properties = zetMetricGetProperties;
+  decltype(&zetContextActivateMetricGroups) context_activate_metric_groups =
+      zetContextActivateMetricGroups;
+  decltype(&zetMetricQueryPoolCreate) metric_query_pool_create = zetMetricQueryPoolCreate;
+  decltype(&zetMetricQueryPoolDestroy) metric_query_pool_destroy = zetMetricQueryPoolDestroy;
+  decltype(&zetMetricQueryCreate) metric_query_create = zetMetricQueryCreate;
+  decltype(&zetMetricQueryDestroy) metric_query_destroy = zetMetricQueryDestroy;
+  decltype(&zetMetricQueryReset) metric_query_reset = zetMetricQueryReset;
+  decltype(&zetMetricQueryGetData) metric_query_get_data = zetMetricQueryGetData;
+  decltype(&zetMetricGroupCalculateMetricValues) metric_group_calculate_metric_values =
+      zetMetricGroupCalculateMetricValues;
+  decltype(&zetCommandListAppendMetricQueryBegin) command_list_append_metric_query_begin =
+      zetCommandListAppendMetricQueryBegin;
+  decltype(&zetCommandListAppendMetricQueryEnd) command_list_append_metric_query_end =
+      zetCommandListAppendMetricQueryEnd;
+  decltype(&zeEventHostSynchronize) event_host_synchronize = zeEventHostSynchronize;
+};
+
+/**
+ * \internal
+ * Metrics of the metric group of one device, reported once per client as the
+ * PTI_VIEW_DEVICE_GPU_KERNEL_METRICS_SCHEMA record. Pointers given to the record stay valid for
+ * the lifetime of the collector.
+ */
+struct ZeKernelMetricSchema {
+  uint32_t id_ = 0;
+  ze_device_handle_t device_ = nullptr;
+  zet_metric_group_handle_t group_ = nullptr;
+  std::string group_name_;
+  std::vector<std::string> names_;
+  std::vector<std::string> units_;
+  std::vector<const char*> name_ptrs_;
+  std::vector<const char*> unit_ptrs_;
+  std::vector<pti_metric_value_type> value_types_;
+};
+
+inline pti_metric_value ToPtiMetricValue(const zet_typed_value_t& value) {
+  pti_metric_value result = {};
+  switch (value.type) {
+    case ZET_VALUE_TYPE_UINT32:
+      result._ui32 = value.value.ui32;
+      break;
+    case ZET_VALUE_TYPE_UINT64:
+      result._ui64 = value.value.ui64;
+      break;
+    case ZET_VALUE_TYPE_FLOAT32:
+      result._fp32 = value.value.fp32;
+      break;
+    case ZET_VALUE_TYPE_FLOAT64:
+      result._fp64 = value.value.fp64;
+      break;
+    case ZET_VALUE_TYPE_BOOL8:
+      result._b8 = value.value.b8;
+      break;
+    default:
+      break;
+  }
+  return result;
+}
+
+class ZeKernelMetrics;
+
+/**
+ * \internal
+ * Metric query around one kernel launch. Its values are calculated on the consumer thread once the
+ * end of the query is signaled, polled with IsEnded() rather than waited for; the query and its
+ * event go back to the pools when the sample is destroyed.
+ */
+class ZeKernelMetricSample {
+ public:
+  ZeKernelMetricSample(ZeKernelMetrics* metrics, const ZeKernelMetricSchema* schema,
+                       ze_context_handle_t context, zet_metric_query_handle_t query)
+      : metrics_(metrics), schema_(schema), context_(context), query_(query) {}
+
+  ZeKernelMetricSample(const ZeKernelMetricSample&) = delete;
+  ZeKernelMetricSample& operator=(const ZeKernelMetricSample&) = delete;
+  ZeKernelMetricSample(ZeKernelMetricSample&&) = delete;
+  ZeKernelMetricSample& operator=(ZeKernelMetricSample&&) = delete;
+
+  inline ~ZeKernelMetricSample();
+
+  // true once the end of the query is appended after the kernel
+  bool IsComplete() const { return event_ != nullptr; }
+
+  const ZeKernelMetricSchema* GetSchema() const { return schema_; }
+
+  // Appends the end of the query, signaling the event, right after the kernel
+  inline bool End(ze_command_list_handle_t command_list, ze_event_handle_t event);
+
+  // true once the end of the query is signaled, does not wait for it
+  inline bool IsEnded() const;
+
+  // Calculates the values of the query, false if it has not ended yet
+  inline bool Calculate(std::vector<zet_typed_value_t>& values) const;
+
+ private:
+  friend class ZeKernelMetrics;
+
+  ZeKernelMetrics* metrics_;
+  const ZeKernelMetricSchema* schema_;
+  ze_context_handle_t context_;
+  zet_metric_query_handle_t query_;
+  ze_event_handle_t event_ = nullptr;
+};
+
+/**
+ * \internal
+ * Collection of the hardware metrics of kernels with metric queries.
+ * The metric group is looked up by name on every device the kernels run on and activated on every
+ * context used with the device. Queries come from pools per context and device, created
+ * kQueriesPerPool at a time, and are reset and reused after their values are calculated.
+ * Requires ZET_ENABLE_METRICS=1 set before the Level-Zero initialization; on a device without the
+ * metric group kernels are collected without metrics.
+ */
+class ZeKernelMetrics {
+ public:
+  static constexpr uint32_t kQueriesPerPool = 64;
+  // a sample whose query has not ended this long after its kernel completed is dropped
+  static constexpr uint64_t kQueryTimeoutNs = 1'000'000'000;  // 1 second
+
+  ZeKernelMetrics(std::string group_name, std::function<void(ze_event_handle_t)> release_event,
+                  ZeMetricApi api = {})
+      : group_name_(std::move(group_name)),
+        release_event_(std::move(release_event)),
+        api_(api) {}
+
+  ZeKernelMetrics(const ZeKernelMetrics&) = delete;
+  ZeKernelMetrics& operator=(const ZeKernelMetrics&) = delete;
+  ZeKernelMetrics(ZeKernelMetrics&&) = delete;
+  ZeKernelMetrics& operator=(ZeKernelMetrics&&) = delete;
+
+  ~ZeKernelMetrics() {
+    const std::lock_guard<std::mutex> lock(lock_);
+    for (auto& [key, pools] : pools_) {
+      DestroyPools(pools);
+    }
+  }
+
+  const std::string& GetGroupName() const { return group_name_; }
+
+  // Appends the begin of a metric query, to be called right before the kernel is appended.
+  // nullptr if the device has no such metric group
+  std::shared_ptr<ZeKernelMetricSample> Begin(ze_command_list_handle_t command_list,
+                                              ze_context_handle_t context,
+                                              ze_device_handle_t device) {
+    const ZeKernelMetricSchema* schema = nullptr;
+    zet_metric_query_handle_t query = nullptr;
+    {
+      const std::lock_guard<std::mutex> lock(lock_);
+      schema = GetSchema(device);
+      if (schema == nullptr || !Activate(context, device, schema->group_)) {
+        return nullptr;
+      }
+      query = GetQuery(context, device, schema->group_);
+      if (query == nullptr) {
+        return nullptr;
+      }
+    }
+    auto sample = std::make_shared<ZeKernelMetricSample>(this, schema, context, query);
+    ze_result_t status = api_.command_list_append_metric_query_begin(command_list, query);
+    if (status != ZE_RESULT_SUCCESS) {
+      SPDLOG_DEBUG("\tzetCommandListAppendMetricQueryBegin returned: {}",
+                   static_cast<uint32_t>(status));
+      return nullptr;
+    }
+    return sample;
+  }
+
+  // Appends the end of the metric query, signaling the event
+  bool End(ze_command_list_handle_t command_list, ZeKernelMetricSample& sample,
+           ze_event_handle_t event) {
+    ze_result_t status =
+        api_.command_list_append_metric_query_end(command_list, sample.query_, event, 0, nullptr);
+    if (status != ZE_RESULT_SUCCESS) {
+      SPDLOG_DEBUG("\tzetCommandListAppendMetricQueryEnd returned: {}",
+                   static_cast<uint32_t>(status));
+      release_event_(event);
+      return false;
+    }
+    sample.event_ = event;
+    return true;
+  }
+
+  // The metric group is activated again on the next Begin, another one could be activated since
+  void ResetActivation() {
+    const std::lock_guard<std::mutex> lock(lock_);
+    activated_.clear();
+  }
+
+  // Destroys the query pools of the context, it is being destroyed
+  void ReleaseContext(ze_context_handle_t context) {
+    const std::lock_guard<std::mutex> lock(lock_);
+    for (auto it = pools_.begin(); it != pools_.end();) {
+      if (it->first.first == context) {
+        DestroyPools(it->second);
+        it = pools_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    for (auto it = activated_.begin(); it != activated_.end();) {
+      if (it->first == context) {
+        it = activated_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+ private:
+  friend class ZeKernelMetricSample;
+
+  struct QueryPools {
+    std::vector<zet_metric_query_pool_handle_t> pools;
+    std::vector<zet_metric_query_handle_t> queries;
+    std::vector<zet_metric_query_handle_t> free_queries;
+  };
+
+  using ContextDevice = std::pair<ze_context_handle_t, ze_device_handle_t>;
+
+  // lock_ is held by the caller
+  const ZeKernelMetricSchema* GetSchema(ze_device_handle_t device) {
+    auto it = schemas_.find(device);
+    if (it != schemas_.end()) {
+      return it->second.get();
+    }
+    auto schema = CreateSchema(device);
+    if (schema == nullptr) {
+      SPDLOG_WARN("Metric group {} is not available on device {}, kernels are not sampled",
+                  group_name_, static_cast<const void*>(device));
+    }
+    return schemas_.emplace(device, std::move(schema)).first->second.get();
+  }
+
+  std::unique_ptr<ZeKernelMetricSchema> CreateSchema(ze_device_handle_t device) {
+    uint32_t group_count = 0;
+    ze_result_t status = api_.metric_group_get(device, &group_count, nullptr);
+    if (status != ZE_RESULT_SUCCESS || group_count == 0) {
+      return nullptr;
+    }
+    std::vector<zet_metric_group_handle_t> groups(group_count, nullptr);
+    status = api_.metric_group_get(device, &group_count, groups.data());
+    if (status != ZE_RESULT_SUCCESS) {
+      return nullptr;
+    }
+
+    for (auto group : groups) {
+      zet_metric_group_properties_t group_props{};
+      group_props.stype = ZET_STRUCTURE_TYPE_METRIC_GROUP_PROPERTIES;
+      status = api_.metric_group_get_properties(group, &group_props);
+      if (status != ZE_RESULT_SUCCESS || group_name_ != group_props.name ||
+          (group_props.samplingType & ZET_METRIC_GROUP_SAMPLING_TYPE_FLAG_EVENT_BASED) == 0) {
+        continue;
+      }
+
+      uint32_t metric_count = group_props.metricCount;
+      std::vector<zet_metric_handle_t> metrics(metric_count, nullptr);
+      status = api_.metric_get(group, &metric_count, metrics.data());
+      if (status != ZE_RESULT_SUCCESS) {
+        return nullptr;
+      }
+
+      auto schema = std::make_unique<ZeKernelMetricSchema>();
+      schema->id_ = next_schema_id_++;
+      schema->device_ = device;
+      schema->group_ = group;
+      schema->group_name_ = group_name_;
+      for (uint32_t i = 0; i < metric_count; ++i) {
+        zet_metric_properties_t metric_props{};
+        metric_props.stype = ZET_STRUCTURE_TYPE_METRIC_PROPERTIES;
+        status = api_.metric_get_properties(metrics[i], &metric_props);
+        if (status != ZE_RESULT_SUCCESS) {
+          return nullptr;
+        }
+        schema->names_.emplace_back(metric_props.name);
+        schema->units_.emplace_back(metric_props.resultUnits);
+        schema->value_types_.push_back(static_cast<pti_metric_value_type>(metric_props.resultType));
+      }
+      for (uint32_t i = 0; i < metric_count; ++i) {
+        schema->name_ptrs_.push_back(schema->names_[i].c_str());
+        schema->unit_ptrs_.push_back(schema->units_[i].c_str());
+      }
+      return schema;
+    }
+    return nullptr;
+  }
+
+  // lock_ is held by the caller
+  bool Activate(ze_context_handle_t context, ze_device_handle_t device,
+                zet_metric_group_handle_t group) {
+    ContextDevice key{context, device};
+    if (activated_.count(key) != 0) {
+      return true;
+    }
+    ze_result_t status = api_.context_activate_metric_groups(context, device, 1, &group);
+    if (status != ZE_RESULT_SUCCESS) {
+      SPDLOG_WARN("Metric group {} activation failed: {}", group_name_,
+                  static_cast<uint32_t>(status));
+      return false;
+    }
+    activated_.insert(key);
+    return true;
+  }
+
+  // lock_ is held by the caller
+  zet_metric_query_handle_t GetQuery(ze_context_handle_t context, ze_device_handle_t device,
+                                     zet_metric_group_handle_t group) {
+    QueryPools& pools = pools_[ContextDevice{context, device}];
+    if (pools.free_queries.empty()) {
+      zet_metric_query_pool_desc_t pool_desc{};
+      pool_desc.stype = ZET_STRUCTURE_TYPE_METRIC_QUERY_POOL_DESC;
+      pool_desc.type = ZET_METRIC_QUERY_POOL_TYPE_PERFORMANCE;
+      pool_desc.count = kQueriesPerPool;
+      zet_metric_query_pool_handle_t pool = nullptr;
+      ze_result_t status = api_.metric_query_pool_create(context, device, group, &pool_desc, &pool);
+      if (status != ZE_RESULT_SUCCESS) {
+        SPDLOG_DEBUG("\tzetMetricQueryPoolCreate returned: {}", static_cast<uint32_t>(status));
+        return nullptr;
+      }
+      pools.pools.push_back(pool);
+      for (uint32_t i = kQueriesPerPool; i > 0; --i) {
+        zet_metric_query_handle_t query = nullptr;
+        status = api_.metric_query_create(pool, i - 1, &query);
+        if (status == ZE_RESULT_SUCCESS) {
+          pools.queries.push_back(query);
+          pools.free_queries.push_back(query);
+        }
+      }
+      if (pools.free_queries.empty()) {
+        return nullptr;
+      }
+    }
+    zet_metric_query_handle_t query = pools.free_queries.back();
+    pools.free_queries.pop_back();
+    return query;
+  }
+
+  void ReleaseQuery(ze_context_handle_t context, const ZeKernelMetricSchema* schema,
+                    zet_metric_query_handle_t query) {
+    const std::lock_guard<std::mutex> lock(lock_);
+    auto it = pools_.find(ContextDevice{context, schema->device_});
+    if (it == pools_.end()) {
+      return;  // context destroyed
+    }
+    api_.metric_query_reset(query);
+    it->second.free_queries.push_back(query);
+  }
+
+  bool IsEnded(const ZeKernelMetricSample& sample) {
+    return api_.event_host_synchronize(sample.event_, 0) == ZE_RESULT_SUCCESS;
+  }
+
+  bool Calculate(const ZeKernelMetricSample& sample, std::vector<zet_typed_value_t>& values) {
+    size_t size = 0;
+    ze_result_t status = api_.metric_query_get_data(sample.query_, &size, nullptr);
+    if (status != ZE_RESULT_SUCCESS || size == 0) {
+      return false;
+    }
+    std::vector<uint8_t> data(size);
+    status = api_.metric_query_get_data(sample.query_, &size, data.data());
+    if (status != ZE_RESULT_SUCCESS) {
+      return false;
+    }
+
+    uint32_t value_count = 0;
+    status = api_.metric_group_calculate_metric_values(
+        sample.schema_->group_, ZET_METRIC_GROUP_CALCULATION_TYPE_METRIC_VALUES, size, data.data(),
+        &value_count, nullptr);
+    if (status != ZE_RESULT_SUCCESS || value_count == 0) {
+      return false;
+    }
+    values.resize(value_count);
+    status = api_.metric_group_calculate_metric_values(
+        sample.schema_->group_, ZET_METRIC_GROUP_CALCULATION_TYPE_METRIC_VALUES, size, data.data(),
+        &value_count, values.data());
+    if (status != ZE_RESULT_SUCCESS) {
+      return false;
+    }
+    values.resize(value_count);
+    return true;
+  }
+
+  // lock_ is held by the caller
+  void DestroyPools(QueryPools& pools) {
+    for (auto query : pools.queries) {
+      api_.metric_query_destroy(query);
+    }
+    for (auto pool : pools.pools) {
+      api_.metric_query_pool_destroy(pool);
+    }
+    pools.queries.clear();
+    pools.free_queries.clear();
+    pools.pools.clear();
+  }
+
+  std::string group_name_;
+  std::function<void(ze_event_handle_t)> release_event_;
+  ZeMetricApi api_;
+  std::mutex lock_;
+  uint32_t next_schema_id_ = 1;
+  std::map<ze_device_handle_t, std::unique_ptr<ZeKernelMetricSchema>> schemas_;
+  std::map<ContextDevice, QueryPools> pools_;
+  std::set<ContextDevice> activated_;
+};
+
+inline ZeKernelMetricSample::~ZeKernelMetricSample() {
+  if (event_ != nullptr) {
+    metrics_->release_event_(event_);
+  }
+  metrics_->ReleaseQuery(context_, schema_, query_);
+}
+
+inline bool ZeKernelMetricSample::End(ze_command_list_handle_t command_list,
+                                      ze_event_handle_t event) {
+  return metrics_->End(command_list, *this, event);
+}
+
+inline bool ZeKernelMetricSample::IsEnded() const {
+  return IsComplete() && metrics_->IsEnded(*this);
+}
+
+inline bool ZeKernelMetricSample::Calculate(std::vector<zet_typed_value_t>& values) const {
+  if (!IsEnded()) {
+    return false;
+  }
+  return metrics_->Calculate(*this, values);
+}
+
+#endif  // SRC_LEVELZERO_ZE_KERNEL_METRICS_H_
@@ -11,12 +11,21 @@
 #include <level_zero/ze_api.h>
 #include <spdlog/spdlog.h>
 
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <map>
 #include <mutex>
 #include <shared_mutex>
+#include <sstream>
+#include <string>
+#include <system_error>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include "utils.h"
+#include "ze_wrappers.h"
 
 /*
  * Misc classes and functions enabling so called "local" collection of GPU device kernels
@@ -26,6 +35,91 @@
  * As of April 11'24 - it is the first implementation - so issues are possible
  */
 
+/*
+ * How GPU timestamps of a command appended while in local collection are obtained.
+ * Bridges are the last resort: they add GPU work, an event and a dependency to the
+ * application command list, so used only when the application signal event
+ * can not carry timestamps by itself
+ */
+enum class A2TimestampRoute {
+  kCollectorEvent = 0,  // no application signal event - command signals collector own event
+  kAppEvent = 1,        // application event is from timestamp, host visible pool - queried directly
+  kBridge = 2,          // command signals collector event, bridge command signals application one
+};
+
+inline bool A2IsTimestampEventPool(ze_event_pool_flags_t flags) {
+  // mapped timestamps are in a different format, so not taken
+  return (flags & ZE_EVENT_POOL_FLAG_KERNEL_TIMESTAMP) && (flags & ZE_EVENT_POOL_FLAG_HOST_VISIBLE);
+}
+
+inline A2TimestampRoute A2SelectTimestampRoute(bool has_signal_event, bool pool_flags_known,
+                                               ze_event_pool_flags_t pool_flags) {
+  if (!has_signal_event) {
+    return A2TimestampRoute::kCollectorEvent;
+  }
+  if (pool_flags_known && A2IsTimestampEventPool(pool_flags)) {
+    return A2TimestampRoute::kAppEvent;
+  }
+  return A2TimestampRoute::kBridge;
+}
+
+/*
+ * Remembers whether application events could be queried for timestamps directly,
+ * so the event pool flags are asked from the driver once per event
+ */
+class A2TimestampEventCache {
+ public:
+  A2TimestampEventCache(const A2TimestampEventCache&) = delete;
+  A2TimestampEventCache& operator=(const A2TimestampEventCache&) = delete;
+  A2TimestampEventCache(A2TimestampEventCache&&) = delete;
+  A2TimestampEventCache& operator=(A2TimestampEventCache&&) = delete;
+  A2TimestampEventCache() = default;
+  ~A2TimestampEventCache() = default;
+
+  A2TimestampRoute GetRoute(const Level0Wrapper& l0_wrapper, ze_event_handle_t event) {
+    if (event == nullptr) {
+      return A2TimestampRoute::kCollectorEvent;
+    }
+    {
+      std::shared_lock lock(mutex_);
+      auto it = capable_map_.find(event);
+      if (it != capable_map_.end()) {
+        return it->second ? A2TimestampRoute::kAppEvent : A2TimestampRoute::kBridge;
+      }
+    }
+
+    ze_event_pool_handle_t event_pool = nullptr;
+    ze_event_pool_flags_t flags = 0;
+    ze_result_t status = l0_wrapper.w_zeEventGetEventPool(event, &event_pool);
+    if (status == ZE_RESULT_SUCCESS && event_pool != nullptr) {
+      status = l0_wrapper.w_zeEventPoolGetFlags(event_pool, &flags);
+    }
+    A2TimestampRoute route =
+        A2SelectTimestampRoute(true, (status == ZE_RESULT_SUCCESS && event_pool != nullptr), flags);
+    SPDLOG_TRACE("In {}, event: {}, pool: {}, flags: {}, route: {}", __FUNCTION__, (void*)event,
+                 (void*)event_pool, (uint32_t)flags, (uint32_t)route);
+
+    std::unique_lock lock(mutex_);
+    capable_map_[event] = (route == A2TimestampRoute::kAppEvent);
+    return route;
+  }
+
+  bool IsAppTimestampEvent(ze_event_handle_t event) {
+    std::shared_lock lock(mutex_);
+    auto it = capable_map_.find(event);
+    return (it != capable_map_.end()) && it->second;
+  }
+
+  void Forget(ze_event_handle_t event) {
+    std::unique_lock lock(mutex_);
+    capable_map_.erase(event);
+  }
+
+ private:
+  std::shared_mutex mutex_;
+  std::unordered_map<ze_event_handle_t, bool> capable_map_;
+};
+
 bool A2AppendBridgeKernel(ze_kernel_handle_t kernel, ze_command_list_handle_t command_list,
                           ze_event_handle_t signal_event, ze_event_handle_t wait_event) {
   PTI_ASSERT(command_list != nullptr);
@@ -349,46 +443,355 @@ class A2EventPool {
   std::unordered_map<ze_event_handle_t, ze_event_handle_t> shadow_map_;
 };
 
+/*
+ * Name of the on-disk native binary of the bridge kernel.
+ * Native binaries are only valid for the device and the driver they were built by,
+ * and for the SPIR-V they were built from
+ */
+inline std::string A2BridgeKernelCacheKey(const ze_device_uuid_t& device_uuid,
+                                          uint32_t driver_version,
+                                          const std::vector<uint16_t>& spirv) {
+  // FNV-1a, stable across processes and builds unlike std::hash
+  uint64_t hash = 14695981039346656037ULL;
+  for (auto word : spirv) {
+    hash = (hash ^ (word & 0xFF)) * 1099511628211ULL;
+    hash = (hash ^ (word >> 8)) * 1099511628211ULL;
+  }
+
+  std::stringstream stream;
+  stream << "pti_bridge_" << std::hex << std::setfill('0');
+  for (uint32_t i = 0; i < ZE_MAX_DEVICE_UUID_SIZE; ++i) {
+    stream << std::setw(2) << static_cast<uint32_t>(device_uuid.id[i]);
+  }
+  stream << "_" << std::setw(8) << driver_version << "_" << std::setw(16) << hash << ".bin";
+  return stream.str();
+}
+
+/*
+ * Persistent, cross-process cache of native binaries of the bridge kernel.
+ * Binaries are written to a temporary file first and renamed into place,
+ * so concurrent processes never read partially written files
+ */
+class A2NativeBinaryCache {
+ public:
+  explicit A2NativeBinaryCache(std::string directory) : directory_(std::move(directory)) {}
+
+  // PTI_BRIDGE_KERNEL_CACHE_DIR, or the user cache directory.
+  // Empty if none is available - caching is disabled then
+  static std::string GetDefaultDirectory() {
+    std::string directory = utils::GetEnv("PTI_BRIDGE_KERNEL_CACHE_DIR");
+    if (!directory.empty()) {
+      return directory;
+    }
+#if defined(_WIN32)
+    std::string base = utils::GetEnv("LOCALAPPDATA");
+    if (base.empty()) {
+      return std::string();
+    }
+    return (std::filesystem::path(base) / "pti" / "cache").string();
+#else
+    std::string base = utils::GetEnv("XDG_CACHE_HOME");
+    if (!base.empty()) {
+      return (std::filesystem::path(base) / "pti").string();
+    }
+    base = utils::GetEnv("HOME");
+    if (base.empty()) {
+      return std::string();
+    }
+    return (std::filesystem::path(base) / ".cache" / "pti").string();
+#endif
+  }
+
+  bool IsEnabled() const { return !directory_.empty(); }
+
+  std::vector<uint8_t> Load(const std::string& key) const {
+    if (!IsEnabled()) {
+      return {};
+    }
+    std::ifstream file(std::filesystem::path(directory_) / key, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+      return {};
+    }
+    std::streamsize size = file.tellg();
+    if (size <= 0) {
+      return {};
+    }
+    std::vector<uint8_t> binary(static_cast<size_t>(size));
+    file.seekg(0, std::ios::beg);
+    if (!file.read(reinterpret_cast<char*>(binary.data()), size)) {
+      return {};
+    }
+    return binary;
+  }
+
+  bool Store(const std::string& key, const std::vector<uint8_t>& binary) const {
+    if (!IsEnabled() || binary.empty()) {
+      return false;
+    }
+    std::error_code error;
+    std::filesystem::create_directories(directory_, error);
+    if (error) {
+      SPDLOG_DEBUG("\tIn {} can not create cache directory {}: {}", __FUNCTION__, directory_,
+                   error.message());
+      return false;
+    }
+
+    std::filesystem::path target = std::filesystem::path(directory_) / key;
+    std::filesystem::path temp = target;
+    temp += "." + std::to_string(utils::GetPid()) + "." + std::to_string(utils::GetTid()) + ".tmp";
+    {
+      std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+      if (!file.is_open()) {
+        return false;
+      }
+      file.write(reinterpret_cast<const char*>(binary.data()),
+                 static_cast<std::streamsize>(binary.size()));
+      if (!file) {
+        file.close();
+        std::filesystem::remove(temp, error);
+        return false;
+      }
+    }
+    std::filesystem::rename(temp, target, error);
+    if (error) {
+      std::filesystem::remove(temp, error);
+      return false;
+    }
+    return true;
+  }
+
+ private:
+  std::string directory_;
+};
+
+/*
+ * Level Zero APIs used to build the bridge kernel.
+ * Replaceable, so the pool can be exercised without a driver
+ */
+struct A2ModuleApi {
+  decltype(&zeContextCreate) context_create = &zeContextCreate;
+  decltype(&zeContextDestroy) context_destroy = &zeContextDestroy;
+  decltype(&zeModuleCreate) module_create = &zeModuleCreate;
+  decltype(&zeModuleDestroy) module_destroy = &zeModuleDestroy;
+  decltype(&zeModuleGetNativeBinary) module_get_native_binary = &zeModuleGetNativeBinary;
+  decltype(&zeKernelCreate) kernel_create = &zeKernelCreate;
+  decltype(&zeKernelDestroy) kernel_destroy = &zeKernelDestroy;
+  decltype(&zeDeviceGetProperties) device_get_properties = &zeDeviceGetProperties;
+  decltype(&zeDriverGetProperties) driver_get_properties = &zeDriverGetProperties;
+};
+
 class A2BridgeKernelPool {
  public:
-  A2BridgeKernelPool() {}
+  A2BridgeKernelPool() : cache_(A2NativeBinaryCache::GetDefaultDirectory()) {}
+  A2BridgeKernelPool(const A2ModuleApi& api, const std::string& cache_directory)
+      : api_(api), cache_(cache_directory) {}
   ~A2BridgeKernelPool() {}
 
-  ze_kernel_handle_t GetMarkKernel(ze_context_handle_t context, ze_device_handle_t device) {
+  ze_kernel_handle_t GetMarkKernel(ze_context_handle_t context, ze_device_handle_t device,
+                                   ze_driver_handle_t driver) {
     PTI_ASSERT(context != nullptr);
     PTI_ASSERT(device != nullptr);
 
+    // kernels are created once per (context, device), look up under shared lock first
+    {
+      std::shared_lock lock(kernel_map_mutex_);
+      auto it = kernel_map_.find(std::pair(context, device));
+      if (it != kernel_map_.end()) {
+        return it->second.kernel;
+      }
+    }
+
     std::unique_lock lock(kernel_map_mutex_);
+    auto it = kernel_map_.find(std::pair(context, device));
+    if (it != kernel_map_.end()) {
+      return it->second.kernel;
+    }
+
+    // a cached native binary the driver rejects, or whose kernel cannot be created, is rebuilt
+    // from SPIR-V. A failure is remembered too, the caller falls back to a bridge barrier
+    std::string key = GetCacheKey(device, driver);
+    A2BridgeKernel bridge;
+    if (!CreateMarkKernel(LoadMarkModule(context, device, key), bridge)) {
+      CreateMarkKernel(BuildMarkModule(context, device, key), bridge);
+    }
+    kernel_map_.insert({std::pair(context, device), bridge});
+    SPDLOG_TRACE("Probe Kernel {} Created in {} for context: {}, device: {}",
+                 (void*)bridge.kernel, __FUNCTION__, (void*)context, (void*)device);
+    return bridge.kernel;
+  }
 
-    // if kernel not exists - create it and store in the map
-    if (kernel_map_.find(std::pair(context, device)) == kernel_map_.end()) {
-      ze_kernel_handle_t kernel = nullptr;
+  // Builds bridge kernels ahead of their first use, e.g. on context creation
+  void Warmup(ze_context_handle_t context, ze_driver_handle_t driver,
+              const std::vector<ze_device_handle_t>& devices) {
+    for (auto device : devices) {
+      GetMarkKernel(context, device, driver);
+    }
+  }
 
-      ze_module_desc_t module_desc = {ZE_STRUCTURE_TYPE_MODULE_DESC,
-                                      nullptr,
-                                      ZE_MODULE_FORMAT_IL_SPIRV,
-                                      static_cast<uint32_t>(kernel_binary_.size() * 2),
-                                      (uint8_t*)(kernel_binary_.data()),
-                                      nullptr,
-                                      nullptr};
-      ze_module_handle_t module = nullptr;
-      ze_result_t status = zeModuleCreate(context, device, &module_desc, &module, nullptr);
-      PTI_ASSERT(status == ZE_RESULT_SUCCESS && module != nullptr);
+  // Builds native binaries of bridge kernels for the devices in a context of its own. The first
+  // bridge in any context of the devices then loads the binary rather than compiling SPIR-V
+  void WarmupDevices(ze_driver_handle_t driver, const std::vector<ze_device_handle_t>& devices) {
+    std::unique_lock lock(kernel_map_mutex_);
+    ze_context_handle_t context = nullptr;
+    for (auto device : devices) {
+      if (native_binaries_.count(device) != 0) {
+        continue;
+      }
+      if (context == nullptr) {
+        ze_context_desc_t context_desc = {ZE_STRUCTURE_TYPE_CONTEXT_DESC, nullptr, 0};
+        ze_result_t status = api_.context_create(driver, &context_desc, &context);
+        if (status != ZE_RESULT_SUCCESS || context == nullptr) {
+          SPDLOG_DEBUG("\tIn {} no context for warmup: {}", __FUNCTION__,
+                       static_cast<uint32_t>(status));
+          return;
+        }
+      }
+      std::string key = GetCacheKey(device, driver);
+      A2BridgeKernel bridge;
+      if (CreateMarkKernel(LoadMarkModule(context, device, key), bridge) ||
+          CreateMarkKernel(BuildMarkModule(context, device, key), bridge)) {
+        api_.kernel_destroy(bridge.kernel);
+        api_.module_destroy(bridge.module);
+      }
+    }
+    if (context != nullptr) {
+      api_.context_destroy(context);
+    }
+  }
 
-      ze_kernel_desc_t kernel_desc = {ZE_STRUCTURE_TYPE_KERNEL_DESC, nullptr, 0, "empty"};
-      status = zeKernelCreate(module, &kernel_desc, &kernel);
-      PTI_ASSERT(status == ZE_RESULT_SUCCESS && kernel != nullptr);
-      kernel_map_.insert({std::pair(context, device), kernel});
-      SPDLOG_TRACE("Probe Kernel Created in {} for context: {}, device: {}", __FUNCTION__,
-                   (void*)context, (void*)device);
+  // Releases kernels and modules of the context, must be called before the context is destroyed
+  void Clean(ze_context_handle_t context) {
+    std::unique_lock lock(kernel_map_mutex_);
+    for (auto it = kernel_map_.begin(); it != kernel_map_.end();) {
+      if (it->first.first == context) {
+        if (it->second.kernel != nullptr) {
+          api_.kernel_destroy(it->second.kernel);
+          api_.module_destroy(it->second.module);
+        }
+        it = kernel_map_.erase(it);
+      } else {
+        ++it;
+      }
     }
-    return kernel_map_[std::pair(context, device)];
   }
 
  private:
+  struct A2BridgeKernel {
+    ze_module_handle_t module = nullptr;
+    ze_kernel_handle_t kernel = nullptr;
+  };
+
+  std::string GetCacheKey(ze_device_handle_t device, ze_driver_handle_t driver) {
+    if (!cache_.IsEnabled() || driver == nullptr) {
+      return std::string();
+    }
+    ze_device_properties_t device_properties = {};
+    device_properties.stype = ZE_STRUCTURE_TYPE_DEVICE_PROPERTIES;
+    if (api_.device_get_properties(device, &device_properties) != ZE_RESULT_SUCCESS) {
+      return std::string();
+    }
+    ze_driver_properties_t driver_properties = {};
+    driver_properties.stype = ZE_STRUCTURE_TYPE_DRIVER_PROPERTIES;
+    if (api_.driver_get_properties(driver, &driver_properties) != ZE_RESULT_SUCCESS) {
+      return std::string();
+    }
+    return A2BridgeKernelCacheKey(device_properties.uuid, driver_properties.driverVersion,
+                                  kernel_binary_);
+  }
+
+  // the module is destroyed if the kernel cannot be created in it
+  bool CreateMarkKernel(ze_module_handle_t module, A2BridgeKernel& bridge) {
+    if (module == nullptr) {
+      return false;
+    }
+    ze_kernel_desc_t kernel_desc = {ZE_STRUCTURE_TYPE_KERNEL_DESC, nullptr, 0, "empty"};
+    ze_kernel_handle_t kernel = nullptr;
+    ze_result_t status = api_.kernel_create(module, &kernel_desc, &kernel);
+    if (status != ZE_RESULT_SUCCESS || kernel == nullptr) {
+      SPDLOG_DEBUG("\tIn {} bridge kernel not created: {}", __FUNCTION__,
+                   static_cast<uint32_t>(status));
+      api_.module_destroy(module);
+      return false;
+    }
+    bridge.module = module;
+    bridge.kernel = kernel;
+    return true;
+  }
+
+  // from the binary built for the device in this process, or from the cache on disk
+  ze_module_handle_t LoadMarkModule(ze_context_handle_t context, ze_device_handle_t device,
+                                    const std::string& key) {
+    auto it = native_binaries_.find(device);
+    if (it == native_binaries_.end()) {
+      if (key.empty()) {
+        return nullptr;
+      }
+      std::vector<uint8_t> cached = cache_.Load(key);
+      if (cached.empty()) {
+        return nullptr;
+      }
+      it = native_binaries_.emplace(device, std::move(cached)).first;
+    }
+    const std::vector<uint8_t>& native_binary = it->second;
+    ze_module_desc_t module_desc = {ZE_STRUCTURE_TYPE_MODULE_DESC,
+                                    nullptr,
+                                    ZE_MODULE_FORMAT_NATIVE,
+                                    native_binary.size(),
+                                    native_binary.data(),
+                                    nullptr,
+                                    nullptr};
+    ze_module_handle_t module = nullptr;
+    ze_result_t status = api_.module_create(context, device, &module_desc, &module, nullptr);
+    if (status != ZE_RESULT_SUCCESS || module == nullptr) {
+      // stale or corrupted binary, it is rebuilt from SPIR-V and overwritten
+      SPDLOG_DEBUG("\tIn {} cached bridge kernel module {} rejected: {}", __FUNCTION__, key,
+                   static_cast<uint32_t>(status));
+      native_binaries_.erase(it);
+      return nullptr;
+    }
+    SPDLOG_DEBUG("\tIn {} bridge kernel module loaded from cache: {}", __FUNCTION__, key);
+    return module;
+  }
+
+  ze_module_handle_t BuildMarkModule(ze_context_handle_t context, ze_device_handle_t device,
+                                     const std::string& key) {
+    ze_module_desc_t module_desc = {ZE_STRUCTURE_TYPE_MODULE_DESC,
+                                    nullptr,
+                                    ZE_MODULE_FORMAT_IL_SPIRV,
+                                    static_cast<uint32_t>(kernel_binary_.size() * 2),
+                                    (uint8_t*)(kernel_binary_.data()),
+                                    nullptr,
+                                    nullptr};
+    ze_module_handle_t module = nullptr;
+    ze_result_t status = api_.module_create(context, device, &module_desc, &module, nullptr);
+    if (status != ZE_RESULT_SUCCESS || module == nullptr) {
+      SPDLOG_WARN("\tIn {} bridge kernel module not built: {}", __FUNCTION__,
+                  static_cast<uint32_t>(status));
+      return nullptr;
+    }
+
+    size_t size = 0;
+    status = api_.module_get_native_binary(module, &size, nullptr);
+    if (status == ZE_RESULT_SUCCESS && size > 0) {
+      std::vector<uint8_t> native_binary(size);
+      status = api_.module_get_native_binary(module, &size, native_binary.data());
+      if (status == ZE_RESULT_SUCCESS) {
+        native_binary.resize(size);
+        if (!key.empty()) {
+          cache_.Store(key, native_binary);
+        }
+        native_binaries_[device] = std::move(native_binary);
+      }
+    }
+    return module;
+  }
+
   static std::vector<uint16_t> kernel_binary_;
-  std::mutex kernel_map_mutex_;
-  std::map<std::pair<ze_context_handle_t, ze_device_handle_t>, ze_kernel_handle_t> kernel_map_;
+  A2ModuleApi api_;
+  A2NativeBinaryCache cache_;
+  std::shared_mutex kernel_map_mutex_;
+  std::map<std::pair<ze_context_handle_t, ze_device_handle_t>, A2BridgeKernel> kernel_map_;
+  std::map<ze_device_handle_t, std::vector<uint8_t>> native_binaries_;  // under exclusive lock
 };
 
 // Commands to get spv of the kernel at empty.cl
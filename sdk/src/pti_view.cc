@@ -9,8 +9,10 @@
 #include <spdlog/spdlog.h>
 
 #include <iostream>
+#include <utility>
 
 #include "internal_helper.h"
+#include "pti/pti_callback.h"
 #include "view_handler.h"
 
 namespace {
@@ -18,6 +20,45 @@ namespace {
 void LogException([[maybe_unused]] const std::exception& excep) {
   SPDLOG_ERROR("Caught exception before return: {}", excep.what());
 }
+
+template <typename Change>
+pti_result ChangeApiSubscription(pti_callback_domain domain, Change&& change) {
+  try {
+    pti_result pti_state = Instance().GetState();
+    if (pti_state != pti_result::PTI_SUCCESS) {
+      return pti_state;
+    }
+    if (domain != pti_callback_domain::PTI_CB_DOMAIN_DRIVER_API) {
+      return pti_result::PTI_ERROR_BAD_ARGUMENT;
+    }
+    return Instance().ChangeApiSubscription(std::forward<Change>(change));
+  } catch (const std::exception& e) {
+    LogException(e);
+    return pti_result::PTI_ERROR_INTERNAL;
+  } catch (...) {
+    return pti_result::PTI_ERROR_INTERNAL;
+  }
+}
+
+template <typename Action>
+pti_result WithClient(pti_client_handle client, Action&& action) {
+  try {
+    pti_result pti_state = Instance().GetState();
+    if (pti_state != pti_result::PTI_SUCCESS) {
+      return pti_state;
+    }
+    auto found_client = Instance().FindClient(client);
+    if (found_client == nullptr) {
+      return pti_result::PTI_ERROR_BAD_ARGUMENT;
+    }
+    return std::forward<Action>(action)(*found_client);
+  } catch (const std::exception& e) {
+    LogException(e);
+    return pti_result::PTI_ERROR_INTERNAL;
+  } catch (...) {
+    return pti_result::PTI_ERROR_INTERNAL;
+  }
+}
 }  // namespace
 
 //
@@ -78,6 +119,91 @@ pti_result ptiViewDisable(pti_view_kind view_kind) {
   }
 }
 
+pti_result ptiViewEnableForQueue(ze_command_queue_handle_t queue) {
+  SPDLOG_DEBUG("In {}", __FUNCTION__);
+  try {
+    pti_result pti_state = Instance().GetState();
+    if (pti_state != pti_result::PTI_SUCCESS) {
+      return pti_state;
+    }
+    if (queue == nullptr) {
+      return pti_result::PTI_ERROR_BAD_ARGUMENT;
+    }
+    return Instance().ChangeCollectionScope(
+        [queue](ZeCollectionScope& scope) { scope.AddQueue(queue); });
+  } catch (const std::exception& e) {
+    LogException(e);
+    return pti_result::PTI_ERROR_INTERNAL;
+  } catch (...) {
+    return pti_result::PTI_ERROR_INTERNAL;
+  }
+}
+
+pti_result ptiViewEnableForThread(uint32_t thread_id) {
+  SPDLOG_DEBUG("In {}", __FUNCTION__);
+  try {
+    pti_result pti_state = Instance().GetState();
+    if (pti_state != pti_result::PTI_SUCCESS) {
+      return pti_state;
+    }
+    return Instance().ChangeCollectionScope(
+        [thread_id](ZeCollectionScope& scope) { scope.AddThread(thread_id); });
+  } catch (const std::exception& e) {
+    LogException(e);
+    return pti_result::PTI_ERROR_INTERNAL;
+  } catch (...) {
+    return pti_result::PTI_ERROR_INTERNAL;
+  }
+}
+
+pti_result ptiViewResetScope() {
+  SPDLOG_DEBUG("In {}", __FUNCTION__);
+  try {
+    pti_result pti_state = Instance().GetState();
+    if (pti_state != pti_result::PTI_SUCCESS) {
+      return pti_state;
+    }
+    return Instance().ChangeCollectionScope([](ZeCollectionScope& scope) { scope.Reset(); });
+  } catch (const std::exception& e) {
+    LogException(e);
+    return pti_result::PTI_ERROR_INTERNAL;
+  } catch (...) {
+    return pti_result::PTI_ERROR_INTERNAL;
+  }
+}
+
+pti_result ptiViewSetKernelMetricGroup(const char* metric_group_name) {
+  SPDLOG_DEBUG("In {}", __FUNCTION__);
+  try {
+    pti_result pti_state = Instance().GetState();
+    if (pti_state != pti_result::PTI_SUCCESS) {
+      return pti_state;
+    }
+    return Instance().SetKernelMetricGroup(metric_group_name);
+  } catch (const std::exception& e) {
+    LogException(e);
+    return pti_result::PTI_ERROR_INTERNAL;
+  } catch (...) {
+    return pti_result::PTI_ERROR_INTERNAL;
+  }
+}
+
+pti_result ptiViewSetFlushPolicy(uint32_t max_latency_ms, size_t min_fill) {
+  SPDLOG_DEBUG("In {}", __FUNCTION__);
+  try {
+    pti_result pti_state = Instance().GetState();
+    if (pti_state != pti_result::PTI_SUCCESS) {
+      return pti_state;
+    }
+    return Instance().SetFlushPolicy(max_latency_ms, min_fill);
+  } catch (const std::exception& e) {
+    LogException(e);
+    return pti_result::PTI_ERROR_INTERNAL;
+  } catch (...) {
+    return pti_result::PTI_ERROR_INTERNAL;
+  }
+}
+
 pti_result ptiViewGPULocalAvailable() {
   try {
     return Instance().GPULocalAvailable();
@@ -203,6 +329,123 @@ pti_result ptiViewPopExternalCorrelationId(pti_view_external_kind external_kind,
   }
 }
 
+pti_result ptiClientCreate(pti_client_handle* client) {
+  SPDLOG_DEBUG("In {}", __FUNCTION__);
+  try {
+    pti_result pti_state = Instance().GetState();
+    if (pti_state != pti_result::PTI_SUCCESS) {
+      return pti_state;
+    }
+    return Instance().CreateClient(client);
+  } catch (const std::exception& e) {
+    LogException(e);
+    return pti_result::PTI_ERROR_INTERNAL;
+  } catch (...) {
+    return pti_result::PTI_ERROR_INTERNAL;
+  }
+}
+
+pti_result ptiClientDestroy(pti_client_handle client) {
+  SPDLOG_DEBUG("In {}", __FUNCTION__);
+  try {
+    return Instance().DestroyClient(client);
+  } catch (const std::exception& e) {
+    LogException(e);
+    return pti_result::PTI_ERROR_INTERNAL;
+  } catch (...) {
+    return pti_result::PTI_ERROR_INTERNAL;
+  }
+}
+
+pti_result ptiClientSetCallbacks(pti_client_handle client,
+                                 pti_fptr_buffer_requested fptr_bufferRequested,
+                                 pti_fptr_buffer_completed fptr_bufferCompleted) {
+  return WithClient(client, [&](_pti_client& found_client) {
+    return Instance().RegisterBufferCallbacks(found_client, fptr_bufferRequested,
+                                              fptr_bufferCompleted);
+  });
+}
+
+pti_result ptiClientEnable(pti_client_handle client, pti_view_kind view_kind) {
+  SPDLOG_DEBUG("In {}, view_kind:  {}", __FUNCTION__, static_cast<uint32_t>(view_kind));
+  if (!(IsPtiViewKindEnum(view_kind))) {
+    return pti_result::PTI_ERROR_BAD_ARGUMENT;
+  }
+  return WithClient(client, [&](_pti_client& found_client) {
+    return Instance().Enable(found_client, view_kind);
+  });
+}
+
+pti_result ptiClientDisable(pti_client_handle client, pti_view_kind view_kind) {
+  SPDLOG_DEBUG("In {}, view_kind:  {}", __FUNCTION__, static_cast<uint32_t>(view_kind));
+  if (!(IsPtiViewKindEnum(view_kind))) {
+    return pti_result::PTI_ERROR_BAD_ARGUMENT;
+  }
+  return WithClient(client, [&](_pti_client& found_client) {
+    return Instance().Disable(found_client, view_kind);
+  });
+}
+
+pti_result ptiClientFlushViews(pti_client_handle client) {
+  return WithClient(client,
+                    [&](_pti_client& found_client) { return Instance().FlushBuffers(found_client); });
+}
+
+pti_result ptiCallbackSubscribe(pti_callback_subscriber_handle* subscriber,
+                                pti_callback_function callback, void* user_data) {
+  SPDLOG_DEBUG("In {}", __FUNCTION__);
+  return ChangeApiSubscription(
+      pti_callback_domain::PTI_CB_DOMAIN_DRIVER_API, [&](ZeApiSubscribers& subscribers) {
+        return subscribers.Subscribe(subscriber, callback, user_data);
+      });
+}
+
+pti_result ptiCallbackUnsubscribe(pti_callback_subscriber_handle subscriber) {
+  SPDLOG_DEBUG("In {}", __FUNCTION__);
+  return ChangeApiSubscription(
+      pti_callback_domain::PTI_CB_DOMAIN_DRIVER_API,
+      [&](ZeApiSubscribers& subscribers) { return subscribers.Unsubscribe(subscriber); });
+}
+
+pti_result ptiCallbackEnableDomain(pti_callback_subscriber_handle subscriber,
+                                   pti_callback_domain domain) {
+  SPDLOG_DEBUG("In {}, domain: {}", __FUNCTION__, static_cast<uint32_t>(domain));
+  return ChangeApiSubscription(domain, [&](ZeApiSubscribers& subscribers) {
+    return subscribers.EnableAll(subscriber, true);
+  });
+}
+
+pti_result ptiCallbackDisableDomain(pti_callback_subscriber_handle subscriber,
+                                    pti_callback_domain domain) {
+  SPDLOG_DEBUG("In {}, domain: {}", __FUNCTION__, static_cast<uint32_t>(domain));
+  return ChangeApiSubscription(domain, [&](ZeApiSubscribers& subscribers) {
+    return subscribers.EnableAll(subscriber, false);
+  });
+}
+
+pti_result ptiCallbackEnableApi(pti_callback_subscriber_handle subscriber,
+                                pti_callback_domain domain, uint32_t api_id) {
+  SPDLOG_DEBUG("In {}, api_id: {}", __FUNCTION__, api_id);
+  return ChangeApiSubscription(domain, [&](ZeApiSubscribers& subscribers) {
+    return subscribers.Enable(subscriber, api_id, true);
+  });
+}
+
+pti_result ptiCallbackDisableApi(pti_callback_subscriber_handle subscriber,
+                                 pti_callback_domain domain, uint32_t api_id) {
+  SPDLOG_DEBUG("In {}, api_id: {}", __FUNCTION__, api_id);
+  return ChangeApiSubscription(domain, [&](ZeApiSubscribers& subscribers) {
+    return subscribers.Enable(subscriber, api_id, false);
+  });
+}
+
+pti_result ptiCallbackGetApiId(pti_callback_domain domain, const char* api_name,
+                               uint32_t* api_id) {
+  return ChangeApiSubscription(domain, [&](ZeApiSubscribers& subscribers) {
+    return subscribers.GetApiId(api_name, api_id);
+  });
+}
+
 // Capture all overhead_kind types and associate strings to static storage
 //
 inline constexpr static std::array<const char* const, 6> kOverheadKindType = {
@@ -292,6 +535,26 @@ const char* ptiViewMemcpyTypeToString(pti_view_memcpy_type type) {
   return kMemcpyType[0];
 }
 
+// Capture all host sync types and associate strings to static storage
+//
+inline constexpr static std::array<const char* const, 4> kHostSyncType = {
+    "INVALID", "EVENT", "FENCE", "COMMAND_QUEUE"};
+
+// Returns the stringified version of host sync type back.
+const char* ptiViewHostSyncTypeToString(pti_view_host_sync_type type) {
+  switch (type) {
+    case PTI_VIEW_HOST_SYNC_TYPE_INVALID:
+      return kHostSyncType[0];
+    case PTI_VIEW_HOST_SYNC_TYPE_EVENT:
+      return kHostSyncType[1];
+    case PTI_VIEW_HOST_SYNC_TYPE_FENCE:
+      return kHostSyncType[2];
+    case PTI_VIEW_HOST_SYNC_TYPE_COMMAND_QUEUE:
+      return kHostSyncType[3];
+  }
+  return kHostSyncType[0];
+}
+
 // Capture monotonic_raw which is not subject to jumps and adjustments; convert to real time and
 // return.
 uint64_t ptiViewGetTimestamp() {
@@ -12,8 +12,10 @@
 #include <atomic>
 #include <cstring>
 #include <map>
+#include <memory>
 #include <stack>
 #include <string>
+#include <vector>
 
 #include "pti/pti_view.h"
 
@@ -37,6 +39,16 @@ class UniKernelId {
   inline static std::atomic<uint64_t> kernel_id_ = 1;  // start with 1
 };
 
+class UniKernelInfoId {
+ public:
+  static uint64_t GetKernelInfoId(void) {
+    return kernel_info_id_.fetch_add(1, std::memory_order::memory_order_relaxed);
+  }
+
+ private:
+  inline static std::atomic<uint64_t> kernel_info_id_ = 1;  // start with 1
+};
+
 #define GET_MEMCPY_TYPE(SRC_TYPE, DST_TYPE, RESULT_TYPE)                   \
   if (src_type == pti_view_memory_type::PTI_VIEW_MEMORY_TYPE_##SRC_TYPE && \
       dst_type == pti_view_memory_type::PTI_VIEW_MEMORY_TYPE_##DST_TYPE) { \
@@ -96,6 +108,26 @@ struct ZeMemoryCommandRoute {
   }
 };
 
+/**
+ * \internal
+ * Static properties of a kernel, collected once at its first launch and shared by all its launches
+ */
+struct ZeKernelInfo {
+  uint64_t id_ = 0;
+  std::string name_;
+  uint8_t module_uuid_[PTI_MAX_MODULE_UUID_SIZE] = {};
+  uint64_t binary_size_ = 0;
+  uint32_t simd_width_ = 0;
+  uint32_t num_kernel_args_ = 0;
+  uint32_t private_mem_size_ = 0;
+  uint32_t local_mem_size_ = 0;
+  uint32_t spill_mem_size_ = 0;
+  uint32_t required_group_size_[3] = {};
+};
+
+class ZeKernelMetricSample;
+struct ZeKernelArgSet;
+
 struct ZeKernelCommandExecutionRecord {
   uint64_t sycl_node_id_;
   uint64_t sycl_queue_id_ = PTI_INVALID_QUEUE_ID;
@@ -135,6 +167,19 @@ struct ZeKernelCommandExecutionRecord {
   const char* sycl_func_name_;
   size_t bytes_xfered_;
   size_t value_set_;
+  // host synchronization calls only -- waited object and correlation ids of the device operations
+  // completed during the wait, in completion order
+  pti_view_host_sync_type sync_type_ = PTI_VIEW_HOST_SYNC_TYPE_INVALID;
+  void* sync_object_;
+  std::vector<uint32_t> sync_cids_;
+  // kernels only -- static properties of the kernel
+  std::shared_ptr<const ZeKernelInfo> kernel_info_;
+  // kernels only -- metric query around the kernel, if PTI_VIEW_DEVICE_GPU_KERNEL_METRICS enabled
+  std::shared_ptr<ZeKernelMetricSample> metric_sample_;
+  // kernels only -- argument values of the launch, if PTI_VIEW_KERNEL_ARGS enabled
+  std::shared_ptr<const ZeKernelArgSet> kernel_args_;
+  // execution of the closed command list the operation belongs to
+  uint32_t replay_index_ = 0;
 };
 
 //
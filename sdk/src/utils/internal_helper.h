@@ -30,13 +30,18 @@ bool IsValid(IntType val, EnumVal V, Next... oth) {
 
 ///////////////////////////////////////////////////////////////////////////////
 /// @brief Checks is the provided value v belongs to pti_view_kind enums
+/// that can be enabled. PTI_VIEW_DEVICE_GPU_KERNEL_METRICS_SCHEMA is left out, its records come
+/// with PTI_VIEW_DEVICE_GPU_KERNEL_METRICS only
 bool IsPtiViewKindEnum(int v) {
   return IsValid<int, pti_view_kind, pti_view_kind, pti_view_kind, pti_view_kind, pti_view_kind,
-                 pti_view_kind, pti_view_kind, pti_view_kind, pti_view_kind, pti_view_kind>(
+                 pti_view_kind, pti_view_kind, pti_view_kind, pti_view_kind, pti_view_kind,
+                 pti_view_kind, pti_view_kind, pti_view_kind, pti_view_kind>(
       v, pti_view_kind::PTI_VIEW_DEVICE_GPU_KERNEL, pti_view_kind::PTI_VIEW_DEVICE_CPU_KERNEL,
       pti_view_kind::PTI_VIEW_LEVEL_ZERO_CALLS, pti_view_kind::PTI_VIEW_OPENCL_CALLS,
       pti_view_kind::PTI_VIEW_COLLECTION_OVERHEAD, pti_view_kind::PTI_VIEW_SYCL_RUNTIME_CALLS,
       pti_view_kind::PTI_VIEW_EXTERNAL_CORRELATION, pti_view_kind::PTI_VIEW_DEVICE_GPU_MEM_COPY,
-      pti_view_kind::PTI_VIEW_DEVICE_GPU_MEM_FILL, pti_view_kind::PTI_VIEW_DEVICE_GPU_MEM_COPY_P2P);
+      pti_view_kind::PTI_VIEW_DEVICE_GPU_MEM_FILL, pti_view_kind::PTI_VIEW_DEVICE_GPU_MEM_COPY_P2P,
+      pti_view_kind::PTI_VIEW_HOST_SYNC, pti_view_kind::PTI_VIEW_KERNEL_INFO,
+      pti_view_kind::PTI_VIEW_DEVICE_GPU_KERNEL_METRICS, pti_view_kind::PTI_VIEW_KERNEL_ARGS);
 }
 #endif  // INTERNAL_HELPER_H_
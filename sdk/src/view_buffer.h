@@ -11,11 +11,15 @@
 #include <assert.h>
 
 #include <array>
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <cstdint>
 #include <cstring>
 #include <mutex>
 #include <optional>
 #include <queue>
+#include <thread>
 #include <type_traits>
 #include <unordered_map>
 #include <utility>
@@ -174,6 +178,22 @@ struct ViewRecordBufferQueue {
     return buffer;
   }
 
+  // As Pop, but gives up at the deadline
+  template <typename Clock, typename Duration>
+  inline std::optional<T> PopUntil(const std::chrono::time_point<Clock, Duration>& deadline) {
+    std::unique_lock<std::mutex> buffer_lock(buffer_queue_mtx_);
+    if (!buffer_available_.wait_until(buffer_lock, deadline,
+                                      [this] { return !buffer_queue_.empty(); })) {
+      return std::nullopt;
+    }
+    std::optional<T> buffer = std::move(buffer_queue_.front());
+    buffer_queue_.pop();
+    buffer_lock.unlock();
+    buffer_available_.notify_all();
+
+    return buffer;
+  }
+
   template <typename Condition>
   inline void WaitUntilEmptyOr(const Condition& cond) {
     std::unique_lock<std::mutex> buffer_lock(buffer_queue_mtx_);
@@ -204,6 +224,118 @@ struct ViewRecordBufferQueue {
   std::optional<std::size_t> buffer_depth_;
 };
 
+/**
+ * \internal
+ * \brief Buffer of one producer thread, handed off to the consumer thread without a lock.
+ *
+ * The producer and the consumer take the slot with a compare-and-swap from kFree and give it back
+ * with a store. The producer holds it around an insert only and retries while the consumer moves
+ * the buffer out; the consumer skips a slot held by the producer unless it flushes everything.
+ */
+template <typename U = unsigned char>
+struct ViewRecordBufferSlot {
+ public:
+  enum State : uint32_t { kFree = 0, kProducer = 1, kConsumer = 2 };
+
+  ViewRecordBufferSlot() = default;
+  ViewRecordBufferSlot& operator=(const ViewRecordBufferSlot&) = delete;
+  ViewRecordBufferSlot& operator=(ViewRecordBufferSlot&& other) = delete;
+  ViewRecordBufferSlot(const ViewRecordBufferSlot&) = delete;
+  ViewRecordBufferSlot(ViewRecordBufferSlot&& other) = delete;
+  ~ViewRecordBufferSlot() = default;
+
+  inline void Acquire(State owner) {
+    uint32_t expected = kFree;
+    while (!state_.compare_exchange_weak(expected, owner, std::memory_order_acquire,
+                                         std::memory_order_relaxed)) {
+      expected = kFree;
+      std::this_thread::yield();
+    }
+  }
+
+  inline bool TryAcquire(State owner) {
+    uint32_t expected = kFree;
+    return state_.compare_exchange_strong(expected, owner, std::memory_order_acquire,
+                                          std::memory_order_relaxed);
+  }
+
+  inline void Release() { state_.store(kFree, std::memory_order_release); }
+
+  /**
+   * \internal
+   * Consumer side: takes the buffer away, waiting for the producer to finish its insert.
+   *
+   * \return buffer, null if the slot has none
+   */
+  inline ViewRecordBuffer<U> Take() {
+    Acquire(kConsumer);
+    auto taken = TakeBuffer();
+    Release();
+    return taken;
+  }
+
+  /**
+   * \internal
+   * Consumer side: takes the buffer away if it holds at least min_fill bytes of records and its
+   * first record was inserted not after the given time. Skips the slot held by the producer.
+   *
+   * \return buffer, null if the buffer is not due
+   */
+  inline ViewRecordBuffer<U> TakeIfDue(uint64_t not_after, std::size_t min_fill) {
+    if (!TryAcquire(kConsumer)) {
+      return {};
+    }
+    ViewRecordBuffer<U> taken;
+    if (first_record_time != 0 && first_record_time <= not_after &&
+        buffer.GetValidBytes() >= min_fill) {
+      taken = TakeBuffer();
+    }
+    Release();
+    return taken;
+  }
+
+  /**
+   * \internal
+   * Producer side, with the slot held: inserts a record into a buffer with room for it, noting
+   * the time of the first record of the buffer for TakeIfDue.
+   */
+  template <typename T>
+  inline void Insert(const T& record, uint64_t now) {
+    if (buffer.GetValidBytes() == 0) {
+      first_record_time = now;
+    }
+    buffer.Insert(record);
+  }
+
+  // By the holder of the slot only
+  inline ViewRecordBuffer<U> TakeBuffer() {
+    ViewRecordBuffer<U> taken(std::move(buffer));
+    first_record_time = 0;
+    return taken;
+  }
+
+  // Accessed by the holder of the slot only
+  ViewRecordBuffer<U> buffer;
+  uint64_t first_record_time = 0;  // 0 while the buffer holds no record
+
+ private:
+  std::atomic<uint32_t> state_ = kFree;
+};
+
+/**
+ * \internal
+ * Time of the first record of the buffers a flush check at now delivers, so that none of them
+ * waits longer than max_latency with checks every period.
+ *
+ * \return 0 if no buffer is due yet
+ */
+inline uint64_t FlushDueNotAfter(uint64_t now, uint64_t period, uint64_t max_latency) {
+  if (now + period <= max_latency) {
+    return 0;
+  }
+  return now + period - max_latency;
+}
+
 /**
  * \internal
  * \brief An hash map class with a mutex. Thread safety not guarenteed.
@@ -343,8 +475,9 @@ struct GuardedUnorderedMap {
 
 using ViewBuffer = ViewRecordBuffer<unsigned char>;
 using ViewBufferQueue = ViewRecordBufferQueue<ViewBuffer>;
+using ViewBufferSlot = ViewRecordBufferSlot<unsigned char>;
 template <typename KeyT>
-using ViewBufferTable = GuardedUnorderedMap<KeyT, ViewBuffer>;
+using ViewBufferTable = GuardedUnorderedMap<KeyT, ViewBufferSlot>;
 
 }  // namespace utilities
 }  // namespace view
@@ -9,16 +9,24 @@
 #include <spdlog/cfg/env.h>
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
+#include <array>
 #include <atomic>
+#include <chrono>
 #include <cstddef>
 #include <cstdio>
+#include <deque>
 #include <functional>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <shared_mutex>
 #include <stdexcept>
 #include <string>
 #include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include "consumer_thread.h"
 #include "default_buffer_callbacks.h"
@@ -51,6 +59,14 @@ inline void SyclRuntimeEvent(void* data, const ZeKernelCommandExecutionRecord& r
 
 inline void OverheadCollectionEvent(void* data, const ZeKernelCommandExecutionRecord& rec);
 
+inline void HostSyncEvent(void* data, const ZeKernelCommandExecutionRecord& rec);
+
+inline void KernelInfoEvent(void* data, const ZeKernelCommandExecutionRecord& rec);
+
+inline void KernelArgsEvent(void* data, const ZeKernelCommandExecutionRecord& rec);
+
+inline void KernelMetricsEvent(void* data, const ZeKernelCommandExecutionRecord& rec);
+
 inline void ZeChromeKernelStagesCallback(void* data,
                                          std::vector<ZeKernelCommandExecutionRecord>& kcexecrec);
 
@@ -96,6 +112,26 @@ inline const std::vector<ViewData>& GetViewNameAndCallback(pti_view_kind view) {
             ViewData{"zeCommandListAppendMemoryCopyP2P", MemCopyP2PEvent},
           }
         },
+        {PTI_VIEW_HOST_SYNC,
+          {
+            ViewData{"HostSyncEvent", HostSyncEvent}
+          }
+        },
+        {PTI_VIEW_KERNEL_INFO,
+          {
+            ViewData{"KernelInfoEvent", KernelInfoEvent}
+          }
+        },
+        {PTI_VIEW_DEVICE_GPU_KERNEL_METRICS,
+          {
+            ViewData{"KernelMetricsEvent", KernelMetricsEvent}
+          }
+        },
+        {PTI_VIEW_KERNEL_ARGS,
+          {
+            ViewData{"KernelArgsEvent", KernelArgsEvent}
+          }
+        },
       };
   // clang-format on
   const auto result = view_data_map.find(view);
@@ -107,19 +143,52 @@ inline const std::vector<ViewData>& GetViewNameAndCallback(pti_view_kind view) {
 
 inline static std::atomic<bool> external_collection_enabled = false;
 
+static_assert(kSizeOfViewRecordTable <= 64, "View kinds do not fit the client view kind mask");
+
+/**
+ * \internal
+ * Consumer of view records: its buffer callbacks, its per thread buffers and the view kinds it
+ * enabled. ptiView* functions work with the default client, ptiClient* functions with the clients
+ * created by ptiClientCreate. Records are made once and copied to every client that enabled their
+ * view kind.
+ */
+struct _pti_client {
+  using ViewBufferTable = pti::view::utilities::ViewBufferTable<std::thread::id>;
+
+  static constexpr uint64_t KindMask(pti_view_kind type) { return uint64_t{1} << type; }
+
+  inline bool IsEnabled(pti_view_kind type) const {
+    return (enabled_kinds.load(std::memory_order_relaxed) & KindMask(type)) != 0;
+  }
+
+  // true the first time it is called for the id of the record kind, for records reported once
+  inline bool TakeRecordOnce(pti_view_kind type, uint64_t id) {
+    const std::lock_guard<std::mutex> lock(reported_records_mtx);
+    return reported_records[type].insert(id).second;
+  }
+
+  AskForBufferEvent get_new_buffer = pti::view::defaults::DefaultBufferAllocation;
+  ReturnBufferEvent deliver_buffer = pti::view::defaults::DefaultRecordParser;
+  std::mutex get_new_buffer_mtx;
+  std::mutex deliver_buffer_mtx;
+  ViewBufferTable view_buffers;
+  std::atomic<bool> callbacks_set = false;
+  std::atomic<uint64_t> enabled_kinds = 0;  // bit per pti_view_kind
+  std::mutex reported_records_mtx;
+  std::map<pti_view_kind, std::unordered_set<uint64_t>> reported_records;
+  bool destroyed = false;  // set by DestroyClient under enable_mtx_ of the handler, no enables after
+};
+
 struct PtiViewRecordHandler {
  public:
   using ViewBuffer = pti::view::utilities::ViewBuffer;
   using ViewBufferQueue = pti::view::utilities::ViewBufferQueue;
-  using ViewBufferTable = pti::view::utilities::ViewBufferTable<std::thread::id>;
+  using ViewBufferSlot = pti::view::utilities::ViewBufferSlot;
   using ViewEventTable = pti::view::utilities::GuardedUnorderedMap<std::string, ViewInsert>;
   using KernelNameStorageQueue =
       pti::view::utilities::ViewRecordBufferQueue<std::unique_ptr<std::string>>;
 
-  PtiViewRecordHandler()
-      : get_new_buffer_(pti::view::defaults::DefaultBufferAllocation),
-        deliver_buffer_(pti::view::defaults::DefaultRecordParser),
-        user_provided_ts_func_ptr_(utils::GetRealTime) {
+  PtiViewRecordHandler() : user_provided_ts_func_ptr_(utils::GetRealTime) {
     // initially set logging level to warn
     // need to use warnings very carefully, only when absolutely necessary
     // as on Windows encountered it is INFO (taken from compiler define) by default (?)
@@ -164,13 +233,21 @@ struct PtiViewRecordHandler {
     }
   }
 
-  inline pti_result FlushBuffers() {
-    auto result = consumer_.Push([this]() mutable {
-      view_buffers_.ForEach([this](const auto&, auto&& buffer) {
+  inline pti_result FlushBuffers() { return FlushBuffers(default_client_); }
+
+  inline pti_result FlushBuffers(_pti_client& client) {
+    auto result = consumer_.Push([this, &client]() mutable {
+      InsertEndedKernelMetrics();
+      std::vector<ViewBuffer> buffers;
+      client.view_buffers.ForEach([&buffers](const auto&, auto& slot) {
+        auto buffer = slot.Take();
         if (!buffer.IsNull()) {
-          DeliverBuffer(std::move(buffer));
+          buffers.push_back(std::move(buffer));
         }
       });
+      for (auto& buffer : buffers) {
+        DeliverBuffer(client, std::move(buffer));
+      }
     });
 
     result.wait();
@@ -178,30 +255,97 @@ struct PtiViewRecordHandler {
     return PTI_SUCCESS;
   }
 
+  // Buffers holding a record for max_latency_ms are delivered, if filled with min_fill bytes.
+  // Checked by the consumer thread every quarter of the latency. 0 turns it off
+  inline pti_result SetFlushPolicy(uint32_t max_latency_ms, std::size_t min_fill) {
+    const std::lock_guard<std::mutex> lock(flush_policy_mtx_);
+    if (max_latency_ms == 0) {
+      consumer_.SetTimer(std::chrono::milliseconds{0}, nullptr);
+      return pti_result::PTI_SUCCESS;
+    }
+    const auto period = std::chrono::milliseconds{std::max<uint32_t>(1, max_latency_ms / 4)};
+    const uint64_t max_latency = static_cast<uint64_t>(max_latency_ms) * NSEC_IN_MSEC;
+    const uint64_t period_ns = static_cast<uint64_t>(period.count()) * NSEC_IN_MSEC;
+    consumer_.SetTimer(period, [this, max_latency, period_ns, min_fill]() {
+      InsertEndedKernelMetrics();
+      // a record due before the next check is delivered now
+      const uint64_t not_after =
+          pti::view::utilities::FlushDueNotAfter(utils::GetTime(), period_ns, max_latency);
+      if (not_after == 0) {
+        return;
+      }
+      FlushDueBuffers(default_client_, not_after, min_fill);
+      if (client_count_.load(std::memory_order_relaxed) == 0) {
+        return;
+      }
+      const std::shared_lock clients_lock(clients_mtx_);
+      for (const auto& client : clients_) {
+        FlushDueBuffers(*client, not_after, min_fill);
+      }
+    });
+    return pti_result::PTI_SUCCESS;
+  }
+
   template <typename T>
   inline void InsertRecord(const T& view_record) {
-    static_assert(std::is_trivially_copyable<T>::value,
-                  "One can only insert trivially copyable types into the "
-                  "ViewBuffer (view records)");
-    auto& buffer = view_buffers_[std::this_thread::get_id()];
+    ForEachClient(view_record._view_kind._view_kind,
+                  [this, &view_record](_pti_client& client) { InsertRecord(client, view_record); });
+  }
 
-    if (buffer.IsNull()) {
-      RequestNewBuffer(buffer);
-    }
+  // Kernel info record goes once to each client
+  inline void InsertKernelInfoRecord(const pti_view_record_kernel_info& view_record) {
+    ForEachClient(PTI_VIEW_KERNEL_INFO, [this, &view_record](_pti_client& client) {
+      if (client.TakeRecordOnce(PTI_VIEW_KERNEL_INFO, view_record._kernel_info_id)) {
+        InsertRecord(client, view_record);
+      }
+    });
+  }
 
-    buffer.Insert(view_record);
-    static_assert(SizeOfLargestViewRecord() != 0, "Largest record not avaiable on compile time");
-    if (buffer.FreeBytes() >= SizeOfLargestViewRecord()) {
-      // There's space to insert more records. No need for swap.
-      return;
-    }
-    consumer_.PushAndForget([this, buffer = std::move(buffer)]() mutable {
-      if (!buffer.IsNull()) {
-        DeliverBuffer(std::move(buffer));
+  // Argument set record goes once to each client. The record points into the set, which stays
+  // alive until the buffers holding the record are delivered
+  inline void InsertKernelArgsRecord(const pti_view_record_kernel_args& view_record,
+                                     const std::shared_ptr<const ZeKernelArgSet>& arg_set) {
+    ForEachClient(PTI_VIEW_KERNEL_ARGS, [this, &view_record, &arg_set](_pti_client& client) {
+      if (client.TakeRecordOnce(PTI_VIEW_KERNEL_ARGS, view_record._kernel_args_id)) {
+        {
+          const std::lock_guard<std::mutex> lock(kernel_info_mtx_);
+          auto& buffered_set = kernel_arg_sets_[arg_set->id_];
+          buffered_set.arg_set = arg_set;
+          ++buffered_set.records;
+          buffered_arg_set_records_.fetch_add(1, std::memory_order_relaxed);
+        }
+        InsertRecord(client, view_record);
       }
     });
   }
 
+  // Metric values are calculated on the consumer thread, once the end of the query is signaled,
+  // and the records are inserted to the buffers of that thread. The consumer does not wait for
+  // the end: samples not ended yet are polled again with the next sample, on the flush policy
+  // timer and on flush
+  inline void InsertKernelMetricsRecord(const pti_view_record_kernel_metrics& view_record,
+                                        const pti_view_record_kernel_metrics_schema& schema_record,
+                                        std::shared_ptr<ZeKernelMetricSample> sample) {
+    consumer_.PushAndForget([this, view_record, schema_record,
+                             sample = std::move(sample)]() mutable {
+      pending_kernel_metrics_.push_back({view_record, schema_record, std::move(sample),
+                                         utils::GetTime() + ZeKernelMetrics::kQueryTimeoutNs});
+      InsertEndedKernelMetrics();
+    });
+  }
+
+  inline pti_result SetKernelMetricGroup(const char* metric_group_name) {
+    if (metric_group_name == nullptr || *metric_group_name == '\0') {
+      return pti_result::PTI_ERROR_BAD_ARGUMENT;
+    }
+    const std::lock_guard<std::mutex> lock(enable_mtx_);
+    if (kind_clients_[PTI_VIEW_DEVICE_GPU_KERNEL_METRICS] != 0) {
+      return pti_result::PTI_ERROR_BAD_ARGUMENT;
+    }
+    kernel_metric_group_ = metric_group_name;
+    return pti_result::PTI_SUCCESS;
+  }
+
   inline pti_result RegisterTimestampCallback(pti_fptr_get_timestamp get_timestamp) {
     if (!get_timestamp) return pti_result::PTI_ERROR_BAD_ARGUMENT;
     const std::lock_guard<std::mutex> lock(timestamp_api_mtx_);
@@ -213,6 +357,12 @@ struct PtiViewRecordHandler {
 
   inline pti_result RegisterBufferCallbacks(AskForBufferEvent&& get_new_buf,
                                             ReturnBufferEvent&& return_new_buf) {
+    return RegisterBufferCallbacks(default_client_, std::move(get_new_buf),
+                                   std::move(return_new_buf));
+  }
+
+  inline pti_result RegisterBufferCallbacks(_pti_client& client, AskForBufferEvent&& get_new_buf,
+                                            ReturnBufferEvent&& return_new_buf) {
     pti_result result = pti_result::PTI_ERROR_BAD_ARGUMENT;
     auto get_new_buffer = std::move(get_new_buf);
     auto deliver_buffer = std::move(return_new_buf);
@@ -236,38 +386,132 @@ struct PtiViewRecordHandler {
     if (result == pti_result::PTI_SUCCESS) {
       // Use user-defined callbacks
       {
-        std::lock_guard<std::mutex> cb_lock(get_new_buffer_mtx_);
-        get_new_buffer_ = std::move(get_new_buffer);
+        std::lock_guard<std::mutex> cb_lock(client.get_new_buffer_mtx);
+        client.get_new_buffer = std::move(get_new_buffer);
       }
       {
-        std::lock_guard<std::mutex> cb_lock(deliver_buffer_mtx_);
-        deliver_buffer_ = std::move(deliver_buffer);
+        std::lock_guard<std::mutex> cb_lock(client.deliver_buffer_mtx);
+        client.deliver_buffer = std::move(deliver_buffer);
       }
     } else {
-      get_new_buffer_(&raw_buffer, &raw_buffer_size);
+      std::lock_guard<std::mutex> cb_lock(client.get_new_buffer_mtx);
+      client.get_new_buffer(&raw_buffer, &raw_buffer_size);
     }
-    auto buffer_to_replace = view_buffers_.TryTakeElement(std::this_thread::get_id());
+    auto& slot = client.view_buffers[std::this_thread::get_id()];
+    auto buffer_to_replace = slot.Take();
 
-    if (buffer_to_replace) {
-      DeliverBuffer(std::move(*buffer_to_replace));
+    if (!buffer_to_replace.IsNull()) {
+      DeliverBuffer(client, std::move(buffer_to_replace));
     }
 
-    view_buffers_[std::this_thread::get_id()].Refresh(raw_buffer, raw_buffer_size);
-    callbacks_set_ = true;
+    slot.Acquire(ViewBufferSlot::kProducer);
+    slot.buffer.Refresh(raw_buffer, raw_buffer_size);
+    slot.Release();
+    client.callbacks_set = true;
 
     return result;
   }
 
-  inline pti_result Enable(pti_view_kind type) {
-    if (!callbacks_set_) {
+  inline pti_result Enable(pti_view_kind type) { return Enable(default_client_, type); }
+
+  // A view kind is collected while at least one client has it enabled
+  inline pti_result Enable(_pti_client& client, pti_view_kind type) {
+    if (!client.callbacks_set) {
       return pti_result::PTI_ERROR_NO_CALLBACKS_SET;
     }
+    const std::lock_guard<std::mutex> lock(enable_mtx_);
+    if (client.destroyed) {
+      return pti_result::PTI_ERROR_BAD_ARGUMENT;
+    }
+    if (client.IsEnabled(type)) {
+      return pti_result::PTI_SUCCESS;
+    }
+    if (kind_clients_[type] == 0) {
+      auto result = EnableKind(type);
+      if (result != pti_result::PTI_SUCCESS) {
+        return result;
+      }
+    }
+    ++kind_clients_[type];
+    client.enabled_kinds.fetch_or(_pti_client::KindMask(type));
+    return pti_result::PTI_SUCCESS;
+  }
+
+  inline pti_result Disable(pti_view_kind type) { return Disable(default_client_, type); }
+
+  inline pti_result Disable(_pti_client& client, pti_view_kind type) {
+    if (type == pti_view_kind::PTI_VIEW_INVALID) {
+      return pti_result::PTI_ERROR_BAD_ARGUMENT;
+    }
+    const std::lock_guard<std::mutex> lock(enable_mtx_);
+    if (!client.IsEnabled(type)) {
+      return pti_result::PTI_SUCCESS;
+    }
+    client.enabled_kinds.fetch_and(~_pti_client::KindMask(type));
+    if (--kind_clients_[type] == 0) {
+      return DisableKind(type);
+    }
+    return pti_result::PTI_SUCCESS;
+  }
+
+  inline pti_result CreateClient(pti_client_handle* client) {
+    if (client == nullptr) {
+      return pti_result::PTI_ERROR_BAD_ARGUMENT;
+    }
+    auto new_client = std::make_shared<_pti_client>();
+    const std::unique_lock lock(clients_mtx_);
+    *client = new_client.get();
+    clients_.push_back(std::move(new_client));
+    client_count_ = clients_.size();
+    return pti_result::PTI_SUCCESS;
+  }
+
+  // Disables the views of the client and delivers its buffers. Calls on the client running
+  // concurrently keep it alive until they return, enables of them fail from here on.
+  inline pti_result DestroyClient(pti_client_handle client) {
+    std::shared_ptr<_pti_client> destroyed_client;
+    {
+      const std::unique_lock lock(clients_mtx_);
+      auto it = std::find_if(clients_.begin(), clients_.end(),
+                             [client](const auto& item) { return item.get() == client; });
+      if (it == clients_.end()) {
+        return pti_result::PTI_ERROR_BAD_ARGUMENT;
+      }
+      destroyed_client = std::move(*it);
+      clients_.erase(it);
+      client_count_ = clients_.size();
+    }
+    {
+      const std::lock_guard<std::mutex> lock(enable_mtx_);
+      destroyed_client->destroyed = true;
+    }
+    for (uint32_t type = 1; type < kSizeOfViewRecordTable; ++type) {
+      Disable(*destroyed_client, static_cast<pti_view_kind>(type));
+    }
+    // deliveries of the client pushed to the consumer earlier are done once this one is
+    return FlushBuffers(*destroyed_client);
+  }
+
+  // nullptr if the handle is not of an existing client, the client stays valid while it is held
+  inline std::shared_ptr<_pti_client> FindClient(pti_client_handle client) {
+    const std::shared_lock lock(clients_mtx_);
+    auto it = std::find_if(clients_.begin(), clients_.end(),
+                           [client](const auto& item) { return item.get() == client; });
+    return it == clients_.end() ? nullptr : *it;
+  }
+
+ private:
+  inline pti_result EnableKind(pti_view_kind type) {
     auto result = pti_result::PTI_SUCCESS;
     bool collection_enabled = collection_enabled_;
     bool l0_collection_type = ((type == pti_view_kind::PTI_VIEW_DEVICE_GPU_KERNEL) ||
                                (type == pti_view_kind::PTI_VIEW_DEVICE_GPU_MEM_FILL) ||
                                (type == pti_view_kind::PTI_VIEW_DEVICE_GPU_MEM_COPY) ||
-                               (type == pti_view_kind::PTI_VIEW_DEVICE_GPU_MEM_COPY_P2P));
+                               (type == pti_view_kind::PTI_VIEW_DEVICE_GPU_MEM_COPY_P2P) ||
+                               (type == pti_view_kind::PTI_VIEW_HOST_SYNC) ||
+                               (type == pti_view_kind::PTI_VIEW_KERNEL_INFO) ||
+                               (type == pti_view_kind::PTI_VIEW_DEVICE_GPU_KERNEL_METRICS) ||
+                               (type == pti_view_kind::PTI_VIEW_KERNEL_ARGS));
 
     //
     // TBD --- implement and remove the checks for below pti_view_kinds
@@ -310,6 +554,12 @@ struct PtiViewRecordHandler {
           collector_->EnableTracing();
         }
       }
+      if (type == pti_view_kind::PTI_VIEW_DEVICE_GPU_KERNEL_METRICS) {
+        collector_->EnableKernelMetrics(kernel_metric_group_);
+      }
+      if (type == pti_view_kind::PTI_VIEW_KERNEL_ARGS) {
+        collector_->EnableKernelArgs();
+      }
     }
 
     collection_enabled_ = collection_enabled;
@@ -330,12 +580,16 @@ struct PtiViewRecordHandler {
     return result;
   }
 
-  inline pti_result Disable(pti_view_kind type) {
+  inline pti_result DisableKind(pti_view_kind type) {
     pti_result result = pti_result::PTI_SUCCESS;
     bool l0_collection_type = ((type == pti_view_kind::PTI_VIEW_DEVICE_GPU_KERNEL) ||
                                (type == pti_view_kind::PTI_VIEW_DEVICE_GPU_MEM_FILL) ||
                                (type == pti_view_kind::PTI_VIEW_DEVICE_GPU_MEM_COPY) ||
-                               (type == pti_view_kind::PTI_VIEW_DEVICE_GPU_MEM_COPY_P2P));
+                               (type == pti_view_kind::PTI_VIEW_DEVICE_GPU_MEM_COPY_P2P) ||
+                               (type == pti_view_kind::PTI_VIEW_HOST_SYNC) ||
+                               (type == pti_view_kind::PTI_VIEW_KERNEL_INFO) ||
+                               (type == pti_view_kind::PTI_VIEW_DEVICE_GPU_KERNEL_METRICS) ||
+                               (type == pti_view_kind::PTI_VIEW_KERNEL_ARGS));
 
     if (type == pti_view_kind::PTI_VIEW_COLLECTION_OVERHEAD) {
       overhead::overhead_collection_enabled = false;
@@ -348,9 +602,6 @@ struct PtiViewRecordHandler {
       SyclCollector::Instance().DisableTracing();
 #endif
     }
-    if (type == pti_view_kind::PTI_VIEW_INVALID) {
-      return pti_result::PTI_ERROR_BAD_ARGUMENT;
-    }
     if (collector_) {
       if (l0_collection_type) {
         auto it = map_view_kind_enabled.find(type);
@@ -359,6 +610,12 @@ struct PtiViewRecordHandler {
           collector_->DisableTracing();
         }
       }
+      if (type == pti_view_kind::PTI_VIEW_DEVICE_GPU_KERNEL_METRICS) {
+        collector_->DisableKernelMetrics();
+      }
+      if (type == pti_view_kind::PTI_VIEW_KERNEL_ARGS) {
+        collector_->DisableKernelArgs();
+      }
     }
 
     try {
@@ -376,6 +633,7 @@ struct PtiViewRecordHandler {
     return result;
   }
 
+ public:
   inline pti_result PushExternalKindId(pti_view_external_kind external_kind, uint64_t external_id) {
     pti_result result = pti_result::PTI_SUCCESS;
     SPDLOG_TRACE("In {}, ext_id: {}, ext_kind: {}", __FUNCTION__, external_id,
@@ -431,6 +689,18 @@ struct PtiViewRecordHandler {
     return kernel_name_str;
   }
 
+  // Kernel name stored once per kernel info, rather than once per launch
+  inline const char* InsertKernel(const ZeKernelInfo& info) {
+    const std::lock_guard<std::mutex> lock(kernel_info_mtx_);
+    auto it = kernel_info_names_.find(info.id_);
+    if (it != kernel_info_names_.end()) {
+      return it->second;
+    }
+    const char* name = InsertKernel(info.name_);
+    kernel_info_names_.emplace(info.id_, name);
+    return name;
+  }
+
   inline pti_result GetState() { return state_; }
   inline void SetState(pti_result new_state) { state_ = new_state; }
 
@@ -446,6 +716,39 @@ struct PtiViewRecordHandler {
   }
   inline uint64_t GetUserTimestamp() { return (*user_provided_ts_func_ptr_.load())(); }
 
+  // Applies a change to the API subscribers. The tracing layer is on while any API is enabled by
+  // any subscriber, the same way as while any L0 view kind is enabled.
+  template <typename Change>
+  inline pti_result ChangeApiSubscription(Change&& change) {
+    if (!collector_) {
+      return pti_result::PTI_ERROR_INTERNAL;
+    }
+    if (ZeApiSubscribers::InCallback()) {
+      return pti_result::PTI_ERROR_BAD_ARGUMENT;
+    }
+    const std::lock_guard<std::mutex> lock(api_subscribers_mtx_);
+    auto& subscribers = collector_->GetApiSubscribers();
+    bool was_active = subscribers.IsActive();
+    pti_result result = change(subscribers);
+    bool active = subscribers.IsActive();
+    if (!was_active && active) {
+      collector_->EnableTracing();
+    } else if (was_active && !active) {
+      collector_->DisableTracing();
+    }
+    return result;
+  }
+
+  // Applies a change to the queues and threads the GPU operations are collected for
+  template <typename Change>
+  inline pti_result ChangeCollectionScope(Change&& change) {
+    if (!collector_) {
+      return pti_result::PTI_ERROR_INTERNAL;
+    }
+    change(collector_->GetCollectionScope());
+    return pti_result::PTI_SUCCESS;
+  }
+
   inline int64_t GetTimeShift() {
     const std::lock_guard<std::mutex> lock(timestamp_api_mtx_);
 
@@ -459,23 +762,189 @@ struct PtiViewRecordHandler {
   }
 
  private:
-  inline void RequestNewBuffer(pti::view::utilities::ViewBuffer& buffer) {
+  // Calls func for the default client and every client created, if it has the view kind enabled
+  template <typename Func>
+  inline void ForEachClient(pti_view_kind type, Func&& func) {
+    if (default_client_.IsEnabled(type)) {
+      func(default_client_);
+    }
+    if (client_count_.load(std::memory_order_relaxed) == 0) {
+      return;
+    }
+    const std::shared_lock lock(clients_mtx_);
+    for (const auto& client : clients_) {
+      if (client->IsEnabled(type)) {
+        func(*client);
+      }
+    }
+  }
+
+  template <typename T>
+  inline void InsertRecord(_pti_client& client, const T& view_record) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "One can only insert trivially copyable types into the "
+                  "ViewBuffer (view records)");
+    auto& slot = client.view_buffers[std::this_thread::get_id()];
+    slot.Acquire(ViewBufferSlot::kProducer);
+
+    InsertIntoSlot(client, slot, view_record);
+    static_assert(SizeOfLargestViewRecord() != 0, "Largest record not avaiable on compile time");
+    if (slot.buffer.FreeBytes() >= SizeOfLargestViewRecord()) {
+      // There's space to insert more records. No need for swap.
+      slot.Release();
+      return;
+    }
+    auto full_buffer = slot.TakeBuffer();
+    // released before the push, the consumer may wait for the slot while the queue is full
+    slot.Release();
+    consumer_.PushAndForget([this, &client, buffer = std::move(full_buffer)]() mutable {
+      if (!buffer.IsNull()) {
+        DeliverBuffer(client, std::move(buffer));
+      }
+    });
+  }
+
+  // On the consumer thread: inserts the records of the samples whose query ended, the ones not
+  // ended by their deadline are dropped
+  inline void InsertEndedKernelMetrics() {
+    const uint64_t now = utils::GetTime();
+    for (auto it = pending_kernel_metrics_.begin(); it != pending_kernel_metrics_.end();) {
+      if (!it->sample->IsEnded()) {
+        if (now < it->deadline) {
+          ++it;
+          continue;
+        }
+        SPDLOG_DEBUG("\tMetric query end is not signaled, kernel {} is not sampled",
+                     it->record._kernel_id);
+        it = pending_kernel_metrics_.erase(it);
+        continue;
+      }
+      std::vector<zet_typed_value_t> values;
+      bool calculated = it->sample->Calculate(values);
+      auto record = it->record;
+      const auto schema_record = it->schema_record;
+      it = pending_kernel_metrics_.erase(it);  // query goes back to the pool
+      if (!calculated) {
+        continue;
+      }
+      record._value_count =
+          static_cast<uint32_t>(std::min<std::size_t>(values.size(), PTI_MAX_KERNEL_METRIC_VALUES));
+      for (uint32_t i = 0; i < record._value_count; ++i) {
+        record._values[i] = ToPtiMetricValue(values[i]);
+      }
+      ForEachClient(PTI_VIEW_DEVICE_GPU_KERNEL_METRICS, [&](_pti_client& client) {
+        if (client.TakeRecordOnce(PTI_VIEW_DEVICE_GPU_KERNEL_METRICS_SCHEMA,
+                                  schema_record._schema_id)) {
+          InsertRecordOnConsumer(client, schema_record);
+        }
+        InsertRecordOnConsumer(client, record);
+      });
+    }
+  }
+
+  // The same as InsertRecord on the consumer thread itself: full buffer is delivered right away
+  template <typename T>
+  inline void InsertRecordOnConsumer(_pti_client& client, const T& view_record) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "One can only insert trivially copyable types into the "
+                  "ViewBuffer (view records)");
+    auto& slot = client.view_buffers[std::this_thread::get_id()];
+    slot.Acquire(ViewBufferSlot::kProducer);
+
+    InsertIntoSlot(client, slot, view_record);
+    ViewBuffer full_buffer;
+    if (slot.buffer.FreeBytes() < SizeOfLargestViewRecord()) {
+      full_buffer = slot.TakeBuffer();
+    }
+    slot.Release();
+    if (!full_buffer.IsNull()) {
+      DeliverBuffer(client, std::move(full_buffer));
+    }
+  }
+
+  // The slot is held by the caller
+  template <typename T>
+  inline void InsertIntoSlot(_pti_client& client, ViewBufferSlot& slot, const T& view_record) {
+    if (slot.buffer.IsNull()) {
+      RequestNewBuffer(client, slot.buffer);
+    }
+    slot.Insert(view_record, utils::GetTime());
+  }
+
+  // On the consumer thread
+  inline void FlushDueBuffers(_pti_client& client, uint64_t not_after, std::size_t min_fill) {
+    std::vector<ViewBuffer> buffers;
+    client.view_buffers.ForEach([&buffers, not_after, min_fill](const auto&, auto& slot) {
+      auto buffer = slot.TakeIfDue(not_after, min_fill);
+      if (!buffer.IsNull()) {
+        buffers.push_back(std::move(buffer));
+      }
+    });
+    for (auto& buffer : buffers) {
+      DeliverBuffer(client, std::move(buffer));
+    }
+  }
+
+  inline void RequestNewBuffer(_pti_client& client, pti::view::utilities::ViewBuffer& buffer) {
     unsigned char* raw_buffer = nullptr;
     std::size_t buffer_size = 0;
     {
-      std::lock_guard<std::mutex> cb_lock(get_new_buffer_mtx_);
-      get_new_buffer_(&raw_buffer, &buffer_size);
+      std::lock_guard<std::mutex> cb_lock(client.get_new_buffer_mtx);
+      client.get_new_buffer(&raw_buffer, &buffer_size);
     }
     buffer.Refresh(raw_buffer, buffer_size);
   }
 
-  inline void DeliverBuffer(pti::view::utilities::ViewBuffer&& buffer) {
+  inline void DeliverBuffer(_pti_client& client, pti::view::utilities::ViewBuffer&& buffer) {
     auto buffer_to_deliver = std::move(buffer);
+    // read before the user takes the buffer back
+    std::vector<uint64_t> arg_set_ids;
+    if (buffered_arg_set_records_.load(std::memory_order_relaxed) != 0) {
+      arg_set_ids = GetKernelArgSetIds(buffer_to_deliver);
+    }
     {
-      std::lock_guard<std::mutex> cb_lock(deliver_buffer_mtx_);
+      std::lock_guard<std::mutex> cb_lock(client.deliver_buffer_mtx);
       if (buffer_to_deliver.GetBuffer()) {
-        deliver_buffer_(buffer_to_deliver.GetBuffer(), buffer_to_deliver.GetBufferSize(),
-                        buffer_to_deliver.GetValidBytes());
+        client.deliver_buffer(buffer_to_deliver.GetBuffer(), buffer_to_deliver.GetBufferSize(),
+                              buffer_to_deliver.GetValidBytes());
+      }
+    }
+    if (!arg_set_ids.empty()) {
+      ReleaseKernelArgSets(arg_set_ids);
+    }
+  }
+
+  // Argument sets the PTI_VIEW_KERNEL_ARGS records of the buffer point into
+  static std::vector<uint64_t> GetKernelArgSetIds(const ViewBuffer& buffer) {
+    std::vector<uint64_t> arg_set_ids;
+    if (buffer.IsNull()) {
+      return arg_set_ids;
+    }
+    auto* record = buffer.Peek<pti_view_record_base>();
+    while (record != nullptr) {
+      if (record->_view_kind == PTI_VIEW_KERNEL_ARGS) {
+        arg_set_ids.push_back(
+            reinterpret_cast<const pti_view_record_kernel_args*>(record)->_kernel_args_id);
+      }
+      const auto record_size = GetViewSize(record->_view_kind);
+      if (record_size == SIZE_MAX) {
+        break;
+      }
+      record = buffer.Peek(record, record_size);
+    }
+    return arg_set_ids;
+  }
+
+  inline void ReleaseKernelArgSets(const std::vector<uint64_t>& arg_set_ids) {
+    const std::lock_guard<std::mutex> lock(kernel_info_mtx_);
+    for (auto id : arg_set_ids) {
+      auto it = kernel_arg_sets_.find(id);
+      if (it == kernel_arg_sets_.end()) {
+        continue;
+      }
+      buffered_arg_set_records_.fetch_sub(1, std::memory_order_relaxed);
+      if (--it->second.records == 0) {
+        kernel_arg_sets_.erase(it);
       }
     }
   }
@@ -494,15 +963,36 @@ struct PtiViewRecordHandler {
   // Internal PTI state.
   // If abnornal situation happens - this variable will be set the corresponding value
   std::atomic<pti_result> state_ = pti_result::PTI_SUCCESS;
-  std::atomic<bool> callbacks_set_ = false;
-  AskForBufferEvent get_new_buffer_;
-  ReturnBufferEvent deliver_buffer_;
-  mutable std::mutex get_new_buffer_mtx_;
-  mutable std::mutex deliver_buffer_mtx_;
+  _pti_client default_client_;
+  mutable std::shared_mutex clients_mtx_;
+  std::vector<std::shared_ptr<_pti_client>> clients_;
+  std::atomic<std::size_t> client_count_ = 0;
+  // number of clients that enabled the view kind
+  std::array<uint32_t, kSizeOfViewRecordTable> kind_clients_ = {};
+  mutable std::mutex enable_mtx_;
+  std::string kernel_metric_group_ = "ComputeBasic";  // guarded by enable_mtx_
+  mutable std::mutex flush_policy_mtx_;
   mutable std::mutex timestamp_api_mtx_;
+  mutable std::mutex api_subscribers_mtx_;
+  mutable std::mutex kernel_info_mtx_;
   ViewEventTable view_event_map_;
   KernelNameStorageQueue kernel_name_storage_;
-  ViewBufferTable view_buffers_;
+  std::unordered_map<uint64_t, const char*> kernel_info_names_;
+  // argument sets with records in buffers not delivered yet, by id
+  struct BufferedKernelArgSet {
+    std::shared_ptr<const ZeKernelArgSet> arg_set;
+    uint32_t records = 0;
+  };
+  std::unordered_map<uint64_t, BufferedKernelArgSet> kernel_arg_sets_;
+  std::atomic<uint64_t> buffered_arg_set_records_ = 0;
+  // kernel metrics waiting for the end of their query, owned by the consumer thread
+  struct PendingKernelMetrics {
+    pti_view_record_kernel_metrics record;
+    pti_view_record_kernel_metrics_schema schema_record;
+    std::shared_ptr<ZeKernelMetricSample> sample;
+    uint64_t deadline;
+  };
+  std::deque<PendingKernelMetrics> pending_kernel_metrics_;
   pti::view::BufferConsumer consumer_ = {};  // Starts thread
   std::atomic<pti_fptr_get_timestamp> user_provided_ts_func_ptr_ = nullptr;
   int64_t ts_shift_ = 0;  // conversion factor for switching from default clock to user provided
@@ -763,7 +1253,13 @@ inline void KernelEvent(void* /*data*/, const ZeKernelCommandExecutionRecord& re
   std::copy_n(rec.src_device_uuid, PTI_MAX_DEVICE_UUID_SIZE, record._device_uuid);
 
   // We're storing it in a kernel map so this shouldn't go out of scope
-  record._name = Instance().InsertKernel(rec.name_);
+  if (rec.kernel_info_) {
+    record._name = Instance().InsertKernel(*rec.kernel_info_);
+    record._kernel_info_id = rec.kernel_info_->id_;
+  } else {
+    record._name = Instance().InsertKernel(rec.name_);
+    record._kernel_info_id = 0;
+  }
   record._thread_id = rec.tid_;
   record._kernel_id = rec.kid_;
   record._correlation_id = rec.cid_;
@@ -775,10 +1271,85 @@ inline void KernelEvent(void* /*data*/, const ZeKernelCommandExecutionRecord& re
   record._sycl_invocation_id = rec.sycl_invocation_id_;
   record._sycl_enqk_begin_timestamp = ApplyTimeShift(rec.sycl_enqk_begin_time_, ts_shift);
   record._sycl_task_begin_timestamp = ApplyTimeShift(rec.sycl_task_begin_time_, ts_shift);
+  record._replay_index = rec.replay_index_;
+  record._kernel_args_id = rec.kernel_args_ ? rec.kernel_args_->id_ : 0;
 
   Instance().InsertRecord(record);
 }
 
+inline void HostSyncEvent(void* /*data*/, const ZeKernelCommandExecutionRecord& rec) {
+  pti_view_record_host_sync record;
+  record._view_kind._view_kind = pti_view_kind::PTI_VIEW_HOST_SYNC;
+
+  int64_t ts_shift = Instance().GetTimeShift();
+
+  record._sync_type = rec.sync_type_;
+  record._sync_object_handle = rec.sync_object_;
+  record._start_timestamp = ApplyTimeShift(rec.start_time_, ts_shift);
+  record._end_timestamp = ApplyTimeShift(rec.end_time_, ts_shift);
+  record._thread_id = rec.tid_;
+  record._process_id = rec.pid_;
+  record._correlation_id = rec.sync_cids_.empty() ? 0 : rec.sync_cids_.back();
+  record._completed_count = static_cast<uint32_t>(rec.sync_cids_.size());
+  std::fill_n(record._completed_correlation_ids, PTI_MAX_HOST_SYNC_CORRELATION_IDS, 0);
+  std::copy_n(rec.sync_cids_.begin(),
+              std::min<size_t>(rec.sync_cids_.size(), PTI_MAX_HOST_SYNC_CORRELATION_IDS),
+              record._completed_correlation_ids);
+  Instance().InsertRecord(record);
+}
+
+inline void KernelInfoEvent(void* /*data*/, const ZeKernelCommandExecutionRecord& rec) {
+  pti_view_record_kernel_info record;
+  record._view_kind._view_kind = pti_view_kind::PTI_VIEW_KERNEL_INFO;
+
+  const ZeKernelInfo& info = *rec.kernel_info_;
+  record._kernel_info_id = info.id_;
+  record._name = Instance().InsertKernel(info);
+  std::copy_n(rec.src_device_uuid, PTI_MAX_DEVICE_UUID_SIZE, record._device_uuid);
+  std::copy_n(info.module_uuid_, PTI_MAX_MODULE_UUID_SIZE, record._module_uuid);
+  record._binary_size = info.binary_size_;
+  record._simd_width = info.simd_width_;
+  record._num_kernel_args = info.num_kernel_args_;
+  record._private_mem_size = info.private_mem_size_;
+  record._local_mem_size = info.local_mem_size_;
+  record._spill_mem_size = info.spill_mem_size_;
+  std::copy_n(info.required_group_size_, 3, record._required_group_size);
+  Instance().InsertKernelInfoRecord(record);
+}
+
+inline void KernelArgsEvent(void* /*data*/, const ZeKernelCommandExecutionRecord& rec) {
+  pti_view_record_kernel_args record;
+  record._view_kind._view_kind = pti_view_kind::PTI_VIEW_KERNEL_ARGS;
+
+  const ZeKernelArgSet& arg_set = *rec.kernel_args_;
+  record._kernel_args_id = arg_set.id_;
+  record._kernel_info_id = arg_set.kernel_info_id_;
+  record._arg_count = static_cast<uint32_t>(arg_set.args_.size());
+  record._args = arg_set.args_.data();
+  Instance().InsertKernelArgsRecord(record, rec.kernel_args_);
+}
+
+inline void KernelMetricsEvent(void* /*data*/, const ZeKernelCommandExecutionRecord& rec) {
+  const ZeKernelMetricSchema& schema = *rec.metric_sample_->GetSchema();
+
+  pti_view_record_kernel_metrics_schema schema_record = {};
+  schema_record._view_kind._view_kind = pti_view_kind::PTI_VIEW_DEVICE_GPU_KERNEL_METRICS_SCHEMA;
+  schema_record._schema_id = schema.id_;
+  schema_record._metric_count = static_cast<uint32_t>(schema.names_.size());
+  schema_record._metric_group_name = schema.group_name_.c_str();
+  schema_record._metric_names = schema.name_ptrs_.data();
+  schema_record._metric_units = schema.unit_ptrs_.data();
+  schema_record._metric_value_types = schema.value_types_.data();
+  std::copy_n(rec.src_device_uuid, PTI_MAX_DEVICE_UUID_SIZE, schema_record._device_uuid);
+
+  pti_view_record_kernel_metrics record = {};
+  record._view_kind._view_kind = pti_view_kind::PTI_VIEW_DEVICE_GPU_KERNEL_METRICS;
+  record._correlation_id = rec.cid_;
+  record._kernel_id = rec.kid_;
+  record._schema_id = schema.id_;
+  Instance().InsertKernelMetricsRecord(record, schema_record, rec.metric_sample_);
+}
+
 inline void SyclRuntimeViewCallback(void* data, ZeKernelCommandExecutionRecord& rec) {
   Instance()("SyclRuntimeEvent", data, rec);
 }
@@ -790,7 +1361,9 @@ inline void OverheadCollectionCallback(void* data, ZeKernelCommandExecutionRecor
 inline void ZeChromeKernelStagesCallback(void* data,
                                          std::vector<ZeKernelCommandExecutionRecord>& kcexecrec) {
   for (const auto& rec : kcexecrec) {
-    if ((rec.name_.find("P2P)") != std::string::npos) &&
+    if (rec.sync_type_ != PTI_VIEW_HOST_SYNC_TYPE_INVALID) {
+      Instance()("HostSyncEvent", data, rec);
+    } else if ((rec.name_.find("P2P)") != std::string::npos) &&
         (rec.name_.find("zeCommandListAppendMemoryCopy") != std::string::npos)) {
       Instance()("zeCommandListAppendMemoryCopyP2P", data, rec);
     } else if (rec.name_.find("zeCommandListAppendMemoryCopy") != std::string::npos) {
@@ -800,7 +1373,16 @@ inline void ZeChromeKernelStagesCallback(void* data,
     } else if (rec.name_.find("zeCommandListAppendBarrier") != std::string::npos) {
       // no-op for now
     } else {
+      if (rec.kernel_info_) {
+        Instance()("KernelInfoEvent", data, rec);
+      }
+      if (rec.kernel_args_) {
+        Instance()("KernelArgsEvent", data, rec);
+      }
       Instance()("KernelEvent", data, rec);
+      if (rec.metric_sample_) {
+        Instance()("KernelMetricsEvent", data, rec);
+      }
     }
   }
 }
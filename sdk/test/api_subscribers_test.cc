@@ -0,0 +1,342 @@
+#include <gtest/gtest.h>
+#include <level_zero/ze_api.h>
+
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <new>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "pti/pti_callback.h"
+#include "pti/pti_view.h"
+#include "utils/mock_ze_fixture.h"
+
+// Calls the application APIs through the loader and the generated tracing callbacks to the mock
+// driver, with the collector tracing kernels, and checks what the subscribers are called with
+
+namespace {
+
+constexpr uint32_t kLaunches = 3;
+
+struct RecordedCall {
+  pti_callback_phase phase;
+  uint32_t api_id;
+  std::string api_name;
+  void* api_params;
+  ze_result_t api_result;
+  uint32_t correlation_id;
+};
+
+std::vector<pti_view_record_kernel> kernel_records;
+
+void BufferRequested(unsigned char** buf, size_t* buf_size) {
+  *buf_size = 1024 * sizeof(pti_view_record_kernel);
+  *buf = static_cast<unsigned char*>(::operator new(*buf_size, std::align_val_t(8)));
+}
+
+void BufferCompleted(unsigned char* buf, size_t buf_size, size_t used_bytes) {
+  if (buf != nullptr && used_bytes != 0 && buf_size != 0) {
+    pti_view_record_base* ptr = nullptr;
+    while (ptiViewGetNextRecord(buf, used_bytes, &ptr) == pti_result::PTI_SUCCESS) {
+      if (ptr->_view_kind == PTI_VIEW_DEVICE_GPU_KERNEL) {
+        kernel_records.push_back(*reinterpret_cast<pti_view_record_kernel*>(ptr));
+      }
+    }
+  }
+  ::operator delete(buf, std::align_val_t(8));
+}
+
+void RecordCall(void* user_data, const pti_callback_api_data* cb_data) {
+  ASSERT_NE(cb_data, nullptr);
+  EXPECT_EQ(cb_data->_domain, PTI_CB_DOMAIN_DRIVER_API);
+  static_cast<std::vector<RecordedCall>*>(user_data)->push_back(
+      {cb_data->_phase, cb_data->_api_id, cb_data->_api_name, cb_data->_api_params,
+       cb_data->_api_result, cb_data->_correlation_id});
+}
+
+uint32_t GetApiId(const char* api_name) {
+  uint32_t api_id = 0;
+  EXPECT_EQ(ptiCallbackGetApiId(PTI_CB_DOMAIN_DRIVER_API, api_name, &api_id), PTI_SUCCESS);
+  return api_id;
+}
+
+}  // namespace
+
+class ApiSubscribersTest : public pti::test::utils::level_zero::MockZeDriverTest {
+ protected:
+  void SetUp() override {
+    kernel_records.clear();
+    ASSERT_EQ(ptiViewSetCallbacks(BufferRequested, BufferCompleted), pti_result::PTI_SUCCESS);
+    // the collector is created by the call above, it initialized Level Zero
+    if (!MockZeDriver::Instance().IsLoaded()) {
+      GTEST_SKIP() << "Mock Level Zero driver not loaded, set ZE_ENABLE_ALT_DRIVERS to it";
+    }
+
+    ASSERT_NO_FATAL_FAILURE(CreateAppObjects());
+
+    ASSERT_EQ(ptiViewEnable(PTI_VIEW_DEVICE_GPU_KERNEL), pti_result::PTI_SUCCESS);
+    enabled_ = true;
+  }
+
+  void TearDown() override {
+    if (subscriber_ != nullptr) {
+      EXPECT_EQ(ptiCallbackUnsubscribe(subscriber_), PTI_SUCCESS);
+    }
+    if (enabled_) {
+      EXPECT_EQ(ptiViewDisable(PTI_VIEW_DEVICE_GPU_KERNEL), pti_result::PTI_SUCCESS);
+      EXPECT_EQ(ptiFlushAllViews(), pti_result::PTI_SUCCESS);
+    }
+    DestroyAppObjects();
+  }
+
+  // creates a timestamp event, launches the kernel kLaunches times signaling it and waits for it
+  void RunKernels() {
+    ze_event_pool_desc_t pool_desc = {
+        ZE_STRUCTURE_TYPE_EVENT_POOL_DESC, nullptr,
+        ZE_EVENT_POOL_FLAG_KERNEL_TIMESTAMP | ZE_EVENT_POOL_FLAG_HOST_VISIBLE, 1};
+    ze_event_pool_handle_t event_pool = nullptr;
+    ASSERT_EQ(zeEventPoolCreate(context_, &pool_desc, 1, &device_, &event_pool),
+              ZE_RESULT_SUCCESS);
+    ze_event_desc_t event_desc = {ZE_STRUCTURE_TYPE_EVENT_DESC, nullptr, 0,
+                                  ZE_EVENT_SCOPE_FLAG_HOST, ZE_EVENT_SCOPE_FLAG_HOST};
+    ze_event_handle_t event = nullptr;
+    ASSERT_EQ(zeEventCreate(event_pool, &event_desc, &event), ZE_RESULT_SUCCESS);
+
+    ze_group_count_t group_count = {1, 1, 1};
+    for (uint32_t i = 0; i < kLaunches; ++i) {
+      ASSERT_EQ(zeEventHostReset(event), ZE_RESULT_SUCCESS);
+      ASSERT_EQ(zeCommandListAppendLaunchKernel(command_list_, kernel_, &group_count, event, 0,
+                                                nullptr),
+                ZE_RESULT_SUCCESS);
+      ASSERT_EQ(zeEventHostSynchronize(event, UINT64_MAX), ZE_RESULT_SUCCESS);
+    }
+
+    ASSERT_EQ(zeEventDestroy(event), ZE_RESULT_SUCCESS);
+    ASSERT_EQ(zeEventPoolDestroy(event_pool), ZE_RESULT_SUCCESS);
+  }
+
+  // kernel records are delivered on flush
+  size_t FlushKernelRecords() {
+    EXPECT_EQ(ptiFlushAllViews(), pti_result::PTI_SUCCESS);
+    return kernel_records.size();
+  }
+
+  bool enabled_ = false;
+  pti_callback_subscriber_handle subscriber_ = nullptr;
+  std::vector<RecordedCall> calls_;
+};
+
+// the collector keeps its own data of a call in the per call user data of the tracing layer
+// for some of these APIs, the subscribers must neither overwrite nor read it
+TEST_F(ApiSubscribersTest, EnterAndExitOfEveryCallWithCollectorActive) {
+  ASSERT_EQ(ptiCallbackSubscribe(&subscriber_, RecordCall, &calls_), PTI_SUCCESS);
+  ASSERT_EQ(ptiCallbackEnableDomain(subscriber_, PTI_CB_DOMAIN_DRIVER_API), PTI_SUCCESS);
+
+  RunKernels();
+
+  ASSERT_EQ(ptiCallbackDisableDomain(subscriber_, PTI_CB_DOMAIN_DRIVER_API), PTI_SUCCESS);
+  EXPECT_EQ(FlushKernelRecords(), kLaunches);
+
+  // every call is reported at enter, then at exit with the same id, params and name
+  std::map<uint32_t, RecordedCall> entered;
+  std::map<std::string, uint32_t> exits;
+  std::set<uint32_t> correlation_ids;
+  for (const auto& call : calls_) {
+    if (call.phase == PTI_CB_PHASE_API_ENTER) {
+      EXPECT_NE(call.correlation_id, 0u);
+      EXPECT_TRUE(correlation_ids.insert(call.correlation_id).second) << call.api_name;
+      entered.insert({call.correlation_id, call});
+      continue;
+    }
+    auto it = entered.find(call.correlation_id);
+    ASSERT_NE(it, entered.end()) << call.api_name;
+    EXPECT_EQ(it->second.api_id, call.api_id);
+    EXPECT_EQ(it->second.api_name, call.api_name);
+    EXPECT_EQ(it->second.api_params, call.api_params);
+    EXPECT_EQ(call.api_result, ZE_RESULT_SUCCESS) << call.api_name;
+    entered.erase(it);
+    exits[call.api_name]++;
+  }
+  EXPECT_TRUE(entered.empty());
+
+  EXPECT_EQ(exits["zeEventPoolCreate"], 1u);
+  EXPECT_EQ(exits["zeEventCreate"], 1u);
+  EXPECT_EQ(exits["zeCommandListAppendLaunchKernel"], kLaunches);
+  EXPECT_EQ(exits["zeEventHostSynchronize"], kLaunches);
+  EXPECT_EQ(exits["zeEventPoolDestroy"], 1u);
+
+  for (const auto& call : calls_) {
+    if (call.api_name == "zeCommandListAppendLaunchKernel") {
+      EXPECT_EQ(call.api_id, GetApiId("zeCommandListAppendLaunchKernel"));
+    }
+  }
+}
+
+TEST_F(ApiSubscribersTest, OnlyEnabledApisOfEachSubscriber) {
+  std::vector<RecordedCall> other_calls;
+  pti_callback_subscriber_handle other_subscriber = nullptr;
+  ASSERT_EQ(ptiCallbackSubscribe(&subscriber_, RecordCall, &calls_), PTI_SUCCESS);
+  ASSERT_EQ(ptiCallbackSubscribe(&other_subscriber, RecordCall, &other_calls), PTI_SUCCESS);
+  const uint32_t launch_id = GetApiId("zeCommandListAppendLaunchKernel");
+  ASSERT_EQ(ptiCallbackEnableApi(subscriber_, PTI_CB_DOMAIN_DRIVER_API, launch_id), PTI_SUCCESS);
+
+  RunKernels();
+  EXPECT_EQ(calls_.size(), 2 * kLaunches);
+  for (const auto& call : calls_) {
+    EXPECT_EQ(call.api_id, launch_id);
+  }
+  EXPECT_TRUE(other_calls.empty());
+
+  ASSERT_EQ(ptiCallbackDisableApi(subscriber_, PTI_CB_DOMAIN_DRIVER_API, launch_id), PTI_SUCCESS);
+  ASSERT_EQ(ptiCallbackEnableApi(other_subscriber, PTI_CB_DOMAIN_DRIVER_API, launch_id),
+            PTI_SUCCESS);
+  RunKernels();
+  EXPECT_EQ(calls_.size(), 2 * kLaunches);
+  EXPECT_EQ(other_calls.size(), 2 * kLaunches);
+
+  ASSERT_EQ(ptiCallbackUnsubscribe(other_subscriber), PTI_SUCCESS);
+  EXPECT_EQ(ptiCallbackUnsubscribe(other_subscriber), PTI_ERROR_BAD_ARGUMENT);
+  RunKernels();
+  EXPECT_EQ(other_calls.size(), 2 * kLaunches);
+
+  // the collector kept tracing the kernels throughout
+  EXPECT_EQ(FlushKernelRecords(), 3 * kLaunches);
+}
+
+TEST_F(ApiSubscribersTest, BadArguments) {
+  EXPECT_EQ(ptiCallbackSubscribe(nullptr, RecordCall, &calls_), PTI_ERROR_BAD_ARGUMENT);
+  EXPECT_EQ(ptiCallbackSubscribe(&subscriber_, nullptr, &calls_), PTI_ERROR_BAD_ARGUMENT);
+  ASSERT_EQ(ptiCallbackSubscribe(&subscriber_, RecordCall, &calls_), PTI_SUCCESS);
+  EXPECT_EQ(ptiCallbackEnableApi(subscriber_, PTI_CB_DOMAIN_DRIVER_API, UINT32_MAX),
+            PTI_ERROR_BAD_ARGUMENT);
+  EXPECT_EQ(ptiCallbackEnableApi(nullptr, PTI_CB_DOMAIN_DRIVER_API, 0), PTI_ERROR_BAD_ARGUMENT);
+  EXPECT_EQ(ptiCallbackEnableDomain(subscriber_, PTI_CB_DOMAIN_INVALID), PTI_ERROR_BAD_ARGUMENT);
+  EXPECT_EQ(ptiCallbackEnableDomain(nullptr, PTI_CB_DOMAIN_DRIVER_API), PTI_ERROR_BAD_ARGUMENT);
+
+  uint32_t api_id = 0;
+  EXPECT_EQ(ptiCallbackGetApiId(PTI_CB_DOMAIN_DRIVER_API, "zeUnknownApi", &api_id),
+            PTI_ERROR_BAD_ARGUMENT);
+  EXPECT_EQ(ptiCallbackGetApiId(PTI_CB_DOMAIN_DRIVER_API, nullptr, &api_id),
+            PTI_ERROR_BAD_ARGUMENT);
+  EXPECT_EQ(ptiCallbackGetApiId(PTI_CB_DOMAIN_DRIVER_API, "zeMemAllocDevice", nullptr),
+            PTI_ERROR_BAD_ARGUMENT);
+}
+
+namespace {
+
+struct ReentrantState {
+  pti_callback_subscriber_handle subscriber = nullptr;
+  ze_event_handle_t event = nullptr;
+  std::vector<std::string> calls;
+  pti_result enable_result = PTI_SUCCESS;
+  pti_result unsubscribe_result = PTI_SUCCESS;
+  ze_result_t nested_result = ZE_RESULT_ERROR_UNINITIALIZED;
+};
+
+void ReentrantCall(void* user_data, const pti_callback_api_data* cb_data) {
+  auto* state = static_cast<ReentrantState*>(user_data);
+  state->calls.push_back(cb_data->_api_name);
+  if (cb_data->_phase == PTI_CB_PHASE_API_ENTER &&
+      std::strcmp(cb_data->_api_name, "zeCommandListAppendLaunchKernel") == 0) {
+    state->enable_result =
+        ptiCallbackDisableDomain(state->subscriber, PTI_CB_DOMAIN_DRIVER_API);
+    state->unsubscribe_result = ptiCallbackUnsubscribe(state->subscriber);
+    // API called from within a callback is not reported
+    state->nested_result = zeEventQueryStatus(state->event);
+  }
+}
+
+}  // namespace
+
+TEST_F(ApiSubscribersTest, CallsFromWithinCallback) {
+  ze_event_pool_desc_t pool_desc = {ZE_STRUCTURE_TYPE_EVENT_POOL_DESC, nullptr,
+                                    ZE_EVENT_POOL_FLAG_HOST_VISIBLE, 1};
+  ze_event_pool_handle_t event_pool = nullptr;
+  ASSERT_EQ(zeEventPoolCreate(context_, &pool_desc, 1, &device_, &event_pool), ZE_RESULT_SUCCESS);
+  ze_event_desc_t event_desc = {ZE_STRUCTURE_TYPE_EVENT_DESC, nullptr, 0,
+                                ZE_EVENT_SCOPE_FLAG_HOST, ZE_EVENT_SCOPE_FLAG_HOST};
+  ReentrantState state;
+  ASSERT_EQ(zeEventCreate(event_pool, &event_desc, &state.event), ZE_RESULT_SUCCESS);
+
+  ASSERT_EQ(ptiCallbackSubscribe(&state.subscriber, ReentrantCall, &state), PTI_SUCCESS);
+  ASSERT_EQ(ptiCallbackEnableDomain(state.subscriber, PTI_CB_DOMAIN_DRIVER_API), PTI_SUCCESS);
+
+  ze_group_count_t group_count = {1, 1, 1};
+  ASSERT_EQ(
+      zeCommandListAppendLaunchKernel(command_list_, kernel_, &group_count, nullptr, 0, nullptr),
+      ZE_RESULT_SUCCESS);
+  ASSERT_EQ(ptiCallbackDisableDomain(state.subscriber, PTI_CB_DOMAIN_DRIVER_API), PTI_SUCCESS);
+
+  EXPECT_EQ(state.calls, std::vector<std::string>({"zeCommandListAppendLaunchKernel",
+                                                   "zeCommandListAppendLaunchKernel"}));
+  EXPECT_EQ(state.enable_result, PTI_ERROR_BAD_ARGUMENT);
+  EXPECT_EQ(state.unsubscribe_result, PTI_ERROR_BAD_ARGUMENT);
+  EXPECT_EQ(state.nested_result, ZE_RESULT_SUCCESS);
+  EXPECT_EQ(ptiCallbackUnsubscribe(state.subscriber), PTI_SUCCESS);
+
+  EXPECT_EQ(zeEventDestroy(state.event), ZE_RESULT_SUCCESS);
+  EXPECT_EQ(zeEventPoolDestroy(event_pool), ZE_RESULT_SUCCESS);
+}
+
+namespace {
+
+struct ExecutedLists {
+  std::vector<std::vector<ze_command_list_handle_t>> at_enter;
+  std::vector<std::vector<ze_command_list_handle_t>> at_exit;
+};
+
+void RecordExecutedLists(void* user_data, const pti_callback_api_data* cb_data) {
+  if (std::strcmp(cb_data->_api_name, "zeCommandQueueExecuteCommandLists") != 0) {
+    return;
+  }
+  auto* executed = static_cast<ExecutedLists*>(user_data);
+  const auto* params =
+      static_cast<const ze_command_queue_execute_command_lists_params_t*>(cb_data->_api_params);
+  std::vector<ze_command_list_handle_t> lists(
+      *params->pphCommandLists, *params->pphCommandLists + *params->pnumCommandLists);
+  (cb_data->_phase == PTI_CB_PHASE_API_ENTER ? executed->at_enter : executed->at_exit)
+      .push_back(std::move(lists));
+}
+
+}  // namespace
+
+// the collector executes the harvest command list of a replay after each recorded command list,
+// subscribers see only the command lists of the application
+TEST_F(ApiSubscribersTest, ExecuteOfRecordedCommandListSeenAsApplicationMadeIt) {
+  ze_command_queue_handle_t queue = nullptr;
+  ASSERT_EQ(zeCommandQueueCreate(context_, device_, &kQueueDesc, &queue), ZE_RESULT_SUCCESS);
+  ze_command_list_desc_t list_desc = {ZE_STRUCTURE_TYPE_COMMAND_LIST_DESC, nullptr, 0, 0};
+  ze_command_list_handle_t command_list = nullptr;
+  ASSERT_EQ(zeCommandListCreate(context_, device_, &list_desc, &command_list), ZE_RESULT_SUCCESS);
+  ze_group_count_t group_count = {1, 1, 1};
+  ASSERT_EQ(
+      zeCommandListAppendLaunchKernel(command_list, kernel_, &group_count, nullptr, 0, nullptr),
+      ZE_RESULT_SUCCESS);
+  ASSERT_EQ(zeCommandListClose(command_list), ZE_RESULT_SUCCESS);
+
+  ExecutedLists executed;
+  ASSERT_EQ(ptiCallbackSubscribe(&subscriber_, RecordExecutedLists, &executed), PTI_SUCCESS);
+  ASSERT_EQ(ptiCallbackEnableApi(subscriber_, PTI_CB_DOMAIN_DRIVER_API,
+                                 GetApiId("zeCommandQueueExecuteCommandLists")),
+            PTI_SUCCESS);
+  for (uint32_t i = 0; i < kLaunches; ++i) {
+    ASSERT_EQ(zeCommandQueueExecuteCommandLists(queue, 1, &command_list, nullptr),
+              ZE_RESULT_SUCCESS);
+    ASSERT_EQ(zeCommandQueueSynchronize(queue, UINT64_MAX), ZE_RESULT_SUCCESS);
+  }
+
+  const std::vector<ze_command_list_handle_t> app_lists = {command_list};
+  ASSERT_EQ(executed.at_enter.size(), kLaunches);
+  ASSERT_EQ(executed.at_exit.size(), kLaunches);
+  for (uint32_t i = 0; i < kLaunches; ++i) {
+    EXPECT_EQ(executed.at_enter[i], app_lists);
+    EXPECT_EQ(executed.at_exit[i], app_lists);
+  }
+  // every execution is still reported
+  EXPECT_EQ(FlushKernelRecords(), kLaunches);
+
+  EXPECT_EQ(zeCommandListDestroy(command_list), ZE_RESULT_SUCCESS);
+  EXPECT_EQ(zeCommandQueueDestroy(queue), ZE_RESULT_SUCCESS);
+}
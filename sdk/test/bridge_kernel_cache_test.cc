@@ -0,0 +1,304 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "ze_local_collection_helpers.h"
+
+namespace {
+
+const std::vector<uint8_t> kNativeBinary = {0x7f, 'E', 'L', 'F', 0x02, 0x01, 0x01, 0x00};
+constexpr uint32_t kDriverVersion = 0x01030000;
+
+int module_create_calls = 0;
+int native_module_create_calls = 0;
+int kernel_create_calls = 0;
+int kernel_destroy_calls = 0;
+int module_destroy_calls = 0;
+int context_create_calls = 0;
+int context_destroy_calls = 0;
+bool reject_native_binary = false;
+bool fail_spirv_build = false;
+bool fail_kernel_in_native_module = false;
+
+constexpr uintptr_t kNativeModuleBase = 0x3000;
+
+ze_result_t ZE_APICALL MockContextCreate(ze_driver_handle_t /*driver*/,
+                                         const ze_context_desc_t* /*desc*/,
+                                         ze_context_handle_t* context) {
+  ++context_create_calls;
+  *context = reinterpret_cast<ze_context_handle_t>(0x4000 + context_create_calls);
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t ZE_APICALL MockContextDestroy(ze_context_handle_t /*context*/) {
+  ++context_destroy_calls;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t ZE_APICALL MockModuleCreate(ze_context_handle_t /*context*/,
+                                        ze_device_handle_t /*device*/,
+                                        const ze_module_desc_t* desc, ze_module_handle_t* module,
+                                        ze_module_build_log_handle_t* /*build_log*/) {
+  ++module_create_calls;
+  if (desc->format == ZE_MODULE_FORMAT_NATIVE) {
+    ++native_module_create_calls;
+    if (reject_native_binary) {
+      return ZE_RESULT_ERROR_INVALID_NATIVE_BINARY;
+    }
+    EXPECT_EQ(std::vector<uint8_t>(desc->pInputModule, desc->pInputModule + desc->inputSize),
+              kNativeBinary);
+    *module = reinterpret_cast<ze_module_handle_t>(kNativeModuleBase + module_create_calls);
+    return ZE_RESULT_SUCCESS;
+  }
+  if (fail_spirv_build) {
+    return ZE_RESULT_ERROR_MODULE_BUILD_FAILURE;
+  }
+  *module = reinterpret_cast<ze_module_handle_t>(0x1000 + module_create_calls);
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t ZE_APICALL MockModuleDestroy(ze_module_handle_t /*module*/) {
+  ++module_destroy_calls;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t ZE_APICALL MockModuleGetNativeBinary(ze_module_handle_t /*module*/, size_t* size,
+                                                 uint8_t* binary) {
+  if (binary != nullptr) {
+    std::copy_n(kNativeBinary.begin(), std::min(*size, kNativeBinary.size()), binary);
+  }
+  *size = kNativeBinary.size();
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t ZE_APICALL MockKernelCreate(ze_module_handle_t module, const ze_kernel_desc_t* desc,
+                                        ze_kernel_handle_t* kernel) {
+  ++kernel_create_calls;
+  EXPECT_STREQ(desc->pKernelName, "empty");
+  if (fail_kernel_in_native_module &&
+      reinterpret_cast<uintptr_t>(module) >= kNativeModuleBase) {
+    return ZE_RESULT_ERROR_INVALID_KERNEL_NAME;
+  }
+  *kernel = reinterpret_cast<ze_kernel_handle_t>(0x2000 + kernel_create_calls);
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t ZE_APICALL MockKernelDestroy(ze_kernel_handle_t /*kernel*/) {
+  ++kernel_destroy_calls;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t ZE_APICALL MockDeviceGetProperties(ze_device_handle_t device,
+                                               ze_device_properties_t* properties) {
+  // uuid derived from the handle, so that different devices get different binaries
+  auto id = reinterpret_cast<uintptr_t>(device);
+  for (uint32_t i = 0; i < ZE_MAX_DEVICE_UUID_SIZE; ++i) {
+    properties->uuid.id[i] = static_cast<uint8_t>(id >> (8 * (i % sizeof(id))));
+  }
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t ZE_APICALL MockDriverGetProperties(ze_driver_handle_t /*driver*/,
+                                               ze_driver_properties_t* properties) {
+  properties->driverVersion = kDriverVersion;
+  return ZE_RESULT_SUCCESS;
+}
+
+A2ModuleApi MockModuleApi() {
+  A2ModuleApi api;
+  api.context_create = &MockContextCreate;
+  api.context_destroy = &MockContextDestroy;
+  api.module_create = &MockModuleCreate;
+  api.module_destroy = &MockModuleDestroy;
+  api.module_get_native_binary = &MockModuleGetNativeBinary;
+  api.kernel_create = &MockKernelCreate;
+  api.kernel_destroy = &MockKernelDestroy;
+  api.device_get_properties = &MockDeviceGetProperties;
+  api.driver_get_properties = &MockDriverGetProperties;
+  return api;
+}
+
+const auto kContext = reinterpret_cast<ze_context_handle_t>(0x10);
+const auto kOtherContext = reinterpret_cast<ze_context_handle_t>(0x20);
+const auto kDevice = reinterpret_cast<ze_device_handle_t>(0x30);
+const auto kOtherDevice = reinterpret_cast<ze_device_handle_t>(0x40);
+const auto kDriver = reinterpret_cast<ze_driver_handle_t>(0x50);
+
+}  // namespace
+
+class BridgeKernelCacheTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    module_create_calls = 0;
+    native_module_create_calls = 0;
+    kernel_create_calls = 0;
+    kernel_destroy_calls = 0;
+    module_destroy_calls = 0;
+    context_create_calls = 0;
+    context_destroy_calls = 0;
+    reject_native_binary = false;
+    fail_spirv_build = false;
+    fail_kernel_in_native_module = false;
+
+    cache_dir_ = std::filesystem::temp_directory_path() /
+                 ("pti_bridge_kernel_cache_test_" + std::to_string(utils::GetPid()));
+    std::filesystem::remove_all(cache_dir_);
+  }
+
+  void TearDown() override { std::filesystem::remove_all(cache_dir_); }
+
+  size_t CachedFileCount() const {
+    if (!std::filesystem::exists(cache_dir_)) {
+      return 0;
+    }
+    return std::distance(std::filesystem::directory_iterator(cache_dir_),
+                         std::filesystem::directory_iterator{});
+  }
+
+  std::filesystem::path cache_dir_;
+};
+
+TEST_F(BridgeKernelCacheTest, CacheKeyDependsOnDeviceDriverAndBinary) {
+  ze_device_uuid_t uuid = {};
+  ze_device_uuid_t other_uuid = {};
+  other_uuid.id[0] = 1;
+  std::vector<uint16_t> spirv = {0x0203, 0x0723};
+  std::vector<uint16_t> other_spirv = {0x0203, 0x0724};
+
+  std::string key = A2BridgeKernelCacheKey(uuid, kDriverVersion, spirv);
+  EXPECT_EQ(key, A2BridgeKernelCacheKey(uuid, kDriverVersion, spirv));
+  EXPECT_NE(key, A2BridgeKernelCacheKey(other_uuid, kDriverVersion, spirv));
+  EXPECT_NE(key, A2BridgeKernelCacheKey(uuid, kDriverVersion + 1, spirv));
+  EXPECT_NE(key, A2BridgeKernelCacheKey(uuid, kDriverVersion, other_spirv));
+  EXPECT_EQ(key.find('/'), std::string::npos);
+}
+
+TEST_F(BridgeKernelCacheTest, StoredBinaryIsLoadedBack) {
+  A2NativeBinaryCache cache(cache_dir_.string());
+  EXPECT_TRUE(cache.Load("missing.bin").empty());
+  EXPECT_TRUE(cache.Store("native.bin", kNativeBinary));
+  EXPECT_EQ(cache.Load("native.bin"), kNativeBinary);
+  // no temporary files are left behind
+  EXPECT_EQ(CachedFileCount(), 1u);
+}
+
+TEST_F(BridgeKernelCacheTest, CacheWithoutDirectoryIsDisabled) {
+  A2NativeBinaryCache cache("");
+  EXPECT_FALSE(cache.IsEnabled());
+  EXPECT_FALSE(cache.Store("native.bin", kNativeBinary));
+  EXPECT_TRUE(cache.Load("native.bin").empty());
+}
+
+TEST_F(BridgeKernelCacheTest, FirstBuildCompilesSpirvAndStoresNativeBinary) {
+  A2BridgeKernelPool pool(MockModuleApi(), cache_dir_.string());
+  EXPECT_NE(pool.GetMarkKernel(kContext, kDevice, kDriver), nullptr);
+  EXPECT_EQ(module_create_calls, 1);
+  EXPECT_EQ(native_module_create_calls, 0);
+  EXPECT_EQ(CachedFileCount(), 1u);
+}
+
+TEST_F(BridgeKernelCacheTest, NextProcessLoadsNativeBinary) {
+  {
+    A2BridgeKernelPool pool(MockModuleApi(), cache_dir_.string());
+    pool.GetMarkKernel(kContext, kDevice, kDriver);
+  }
+  A2BridgeKernelPool pool(MockModuleApi(), cache_dir_.string());
+  EXPECT_NE(pool.GetMarkKernel(kContext, kDevice, kDriver), nullptr);
+  EXPECT_EQ(module_create_calls, 2);
+  EXPECT_EQ(native_module_create_calls, 1);
+}
+
+TEST_F(BridgeKernelCacheTest, RejectedNativeBinaryFallsBackToSpirv) {
+  {
+    A2BridgeKernelPool pool(MockModuleApi(), cache_dir_.string());
+    pool.GetMarkKernel(kContext, kDevice, kDriver);
+  }
+  reject_native_binary = true;
+  A2BridgeKernelPool pool(MockModuleApi(), cache_dir_.string());
+  EXPECT_NE(pool.GetMarkKernel(kContext, kDevice, kDriver), nullptr);
+  EXPECT_EQ(native_module_create_calls, 1);
+  EXPECT_EQ(module_create_calls, 3);
+}
+
+TEST_F(BridgeKernelCacheTest, KernelIsCreatedOncePerContextAndDevice) {
+  A2BridgeKernelPool pool(MockModuleApi(), cache_dir_.string());
+  pool.Warmup(kContext, kDriver, {kDevice, kOtherDevice});
+  EXPECT_EQ(kernel_create_calls, 2);
+  EXPECT_EQ(CachedFileCount(), 2u);
+
+  ze_kernel_handle_t kernel = pool.GetMarkKernel(kContext, kDevice, kDriver);
+  EXPECT_EQ(pool.GetMarkKernel(kContext, kDevice, kDriver), kernel);
+  EXPECT_EQ(kernel_create_calls, 2);
+
+  EXPECT_NE(pool.GetMarkKernel(kOtherContext, kDevice, kDriver), kernel);
+  EXPECT_EQ(kernel_create_calls, 3);
+}
+
+TEST_F(BridgeKernelCacheTest, CleanReleasesKernelsOfContextOnly) {
+  A2BridgeKernelPool pool(MockModuleApi(), cache_dir_.string());
+  pool.Warmup(kContext, kDriver, {kDevice, kOtherDevice});
+  ze_kernel_handle_t kernel = pool.GetMarkKernel(kOtherContext, kDevice, kDriver);
+
+  pool.Clean(kContext);
+  EXPECT_EQ(kernel_destroy_calls, 2);
+  EXPECT_EQ(module_destroy_calls, 2);
+  EXPECT_EQ(pool.GetMarkKernel(kOtherContext, kDevice, kDriver), kernel);
+}
+
+TEST_F(BridgeKernelCacheTest, NoDriverSkipsCache) {
+  A2BridgeKernelPool pool(MockModuleApi(), cache_dir_.string());
+  EXPECT_NE(pool.GetMarkKernel(kContext, kDevice, nullptr), nullptr);
+  EXPECT_EQ(CachedFileCount(), 0u);
+}
+
+TEST_F(BridgeKernelCacheTest, KernelFailureInNativeModuleFallsBackToSpirv) {
+  {
+    A2BridgeKernelPool pool(MockModuleApi(), cache_dir_.string());
+    pool.GetMarkKernel(kContext, kDevice, kDriver);
+  }
+  fail_kernel_in_native_module = true;
+  A2BridgeKernelPool pool(MockModuleApi(), cache_dir_.string());
+  EXPECT_NE(pool.GetMarkKernel(kContext, kDevice, kDriver), nullptr);
+  EXPECT_EQ(native_module_create_calls, 1);
+  EXPECT_EQ(module_create_calls, 3);
+  // the module of the failed kernel is released
+  EXPECT_EQ(module_destroy_calls, 1);
+}
+
+TEST_F(BridgeKernelCacheTest, BuildFailureIsReportedOnce) {
+  fail_spirv_build = true;
+  A2BridgeKernelPool pool(MockModuleApi(), cache_dir_.string());
+  EXPECT_EQ(pool.GetMarkKernel(kContext, kDevice, kDriver), nullptr);
+  EXPECT_EQ(pool.GetMarkKernel(kContext, kDevice, kDriver), nullptr);
+  EXPECT_EQ(module_create_calls, 1);
+  EXPECT_EQ(kernel_create_calls, 0);
+
+  pool.Clean(kContext);
+  EXPECT_EQ(kernel_destroy_calls, 0);
+  EXPECT_EQ(module_destroy_calls, 0);
+}
+
+TEST_F(BridgeKernelCacheTest, WarmedUpDevicesLoadNativeBinaryInAnyContext) {
+  // no cache on disk, the binaries are kept in the pool
+  A2BridgeKernelPool pool(MockModuleApi(), "");
+  pool.WarmupDevices(kDriver, {kDevice, kOtherDevice});
+  EXPECT_EQ(context_create_calls, 1);
+  EXPECT_EQ(context_destroy_calls, 1);
+  EXPECT_EQ(module_create_calls, 2);
+  EXPECT_EQ(native_module_create_calls, 0);
+  EXPECT_EQ(kernel_destroy_calls, 2);
+  EXPECT_EQ(module_destroy_calls, 2);
+
+  EXPECT_NE(pool.GetMarkKernel(kContext, kDevice, kDriver), nullptr);
+  EXPECT_NE(pool.GetMarkKernel(kOtherContext, kOtherDevice, kDriver), nullptr);
+  EXPECT_EQ(module_create_calls, 4);
+  EXPECT_EQ(native_module_create_calls, 2);
+
+  // devices warmed up already are skipped
+  pool.WarmupDevices(kDriver, {kDevice, kOtherDevice});
+  EXPECT_EQ(context_create_calls, 1);
+  EXPECT_EQ(module_create_calls, 4);
+}
@@ -0,0 +1,206 @@
+#include <gtest/gtest.h>
+#include <level_zero/ze_api.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include "pti/pti_view.h"
+#include "utils/mock_ze_fixture.h"
+
+// Appends kernels through the loader and the collector to the mock driver with a collection
+// scope set, and checks which launches got an event injected by the collector and which were
+// reported
+
+namespace {
+
+std::vector<pti_view_record_kernel> kernel_records;
+
+void BufferRequested(unsigned char** buf, size_t* buf_size) {
+  *buf_size = 1024 * sizeof(pti_view_record_kernel);
+  *buf = static_cast<unsigned char*>(::operator new(*buf_size, std::align_val_t(8)));
+}
+
+void BufferCompleted(unsigned char* buf, size_t buf_size, size_t used_bytes) {
+  if (buf != nullptr && used_bytes != 0 && buf_size != 0) {
+    pti_view_record_base* ptr = nullptr;
+    while (ptiViewGetNextRecord(buf, used_bytes, &ptr) == pti_result::PTI_SUCCESS) {
+      if (ptr->_view_kind == PTI_VIEW_DEVICE_GPU_KERNEL) {
+        kernel_records.push_back(*reinterpret_cast<pti_view_record_kernel*>(ptr));
+      }
+    }
+  }
+  ::operator delete(buf, std::align_val_t(8));
+}
+
+uint32_t ThisThreadId() { return static_cast<uint32_t>(syscall(SYS_gettid)); }
+
+ze_command_queue_handle_t AsQueue(ze_command_list_handle_t immediate_command_list) {
+  return reinterpret_cast<ze_command_queue_handle_t>(immediate_command_list);
+}
+
+}  // namespace
+
+class CollectionScopeTest : public pti::test::utils::level_zero::MockZeDriverTest {
+ protected:
+  void SetUp() override {
+    kernel_records.clear();
+    ASSERT_EQ(ptiViewSetCallbacks(BufferRequested, BufferCompleted), pti_result::PTI_SUCCESS);
+    // the collector is created by the call above, it initialized Level Zero
+    if (!MockZeDriver::Instance().IsLoaded()) {
+      GTEST_SKIP() << "Mock Level Zero driver not loaded, set ZE_ENABLE_ALT_DRIVERS to it";
+    }
+
+    ASSERT_NO_FATAL_FAILURE(CreateAppObjects());
+    selected_list_ = command_list_;
+    other_list_ = CreateImmediateCommandList();
+    ASSERT_NE(other_list_, nullptr);
+
+    ASSERT_EQ(ptiViewEnable(PTI_VIEW_DEVICE_GPU_KERNEL), pti_result::PTI_SUCCESS);
+    enabled_ = true;
+  }
+
+  void TearDown() override {
+    EXPECT_EQ(ptiViewResetScope(), pti_result::PTI_SUCCESS);
+    if (enabled_) {
+      EXPECT_EQ(ptiViewDisable(PTI_VIEW_DEVICE_GPU_KERNEL), pti_result::PTI_SUCCESS);
+      EXPECT_EQ(ptiFlushAllViews(), pti_result::PTI_SUCCESS);
+    }
+    DestroyAppObjects();
+  }
+
+  bool LaunchInjectsEventFromOtherThread(ze_command_list_handle_t command_list) {
+    bool injected = false;
+    std::thread other([&]() { injected = LaunchInjectsEvent(command_list); });
+    other.join();
+    return injected;
+  }
+
+  uint32_t KernelRecordsOf(ze_command_queue_handle_t queue) const {
+    uint32_t count = 0;
+    for (const auto& record : kernel_records) {
+      count += (record._queue_handle == queue) ? 1 : 0;
+    }
+    return count;
+  }
+
+  ze_command_list_handle_t selected_list_ = nullptr;
+  ze_command_list_handle_t other_list_ = nullptr;
+  bool enabled_ = false;
+};
+
+TEST_F(CollectionScopeTest, EverythingInstrumentedWithoutScope) {
+  EXPECT_TRUE(LaunchInjectsEvent(selected_list_));
+  EXPECT_TRUE(LaunchInjectsEvent(other_list_));
+  EXPECT_TRUE(LaunchInjectsEventFromOtherThread(other_list_));
+}
+
+TEST_F(CollectionScopeTest, UnselectedQueueGetsNoEvents) {
+  ASSERT_EQ(ptiViewEnableForQueue(AsQueue(selected_list_)), pti_result::PTI_SUCCESS);
+
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_FALSE(LaunchInjectsEvent(other_list_));
+  }
+  EXPECT_TRUE(LaunchInjectsEvent(selected_list_));
+  EXPECT_TRUE(LaunchInjectsEventFromOtherThread(selected_list_));
+
+  ASSERT_EQ(zeCommandListHostSynchronize(selected_list_, UINT64_MAX), ZE_RESULT_SUCCESS);
+  EXPECT_EQ(ptiFlushAllViews(), pti_result::PTI_SUCCESS);
+  EXPECT_EQ(KernelRecordsOf(AsQueue(selected_list_)), 2U);
+  EXPECT_EQ(KernelRecordsOf(AsQueue(other_list_)), 0U);
+}
+
+TEST_F(CollectionScopeTest, UnselectedThreadGetsNoEvents) {
+  ASSERT_EQ(ptiViewEnableForThread(ThisThreadId()), pti_result::PTI_SUCCESS);
+
+  EXPECT_FALSE(LaunchInjectsEventFromOtherThread(selected_list_));
+  EXPECT_FALSE(LaunchInjectsEventFromOtherThread(other_list_));
+  EXPECT_TRUE(LaunchInjectsEvent(other_list_));
+}
+
+TEST_F(CollectionScopeTest, QueueAndThreadBothMatch) {
+  ASSERT_EQ(ptiViewEnableForQueue(AsQueue(selected_list_)), pti_result::PTI_SUCCESS);
+  ASSERT_EQ(ptiViewEnableForThread(ThisThreadId()), pti_result::PTI_SUCCESS);
+
+  EXPECT_FALSE(LaunchInjectsEventFromOtherThread(selected_list_));
+  EXPECT_FALSE(LaunchInjectsEvent(other_list_));
+  EXPECT_TRUE(LaunchInjectsEvent(selected_list_));
+}
+
+TEST_F(CollectionScopeTest, RegularCommandListDroppedAtExecuteOnUnselectedQueue) {
+  ASSERT_EQ(ptiViewEnableForQueue(AsQueue(selected_list_)), pti_result::PTI_SUCCESS);
+
+  ze_command_queue_handle_t queue = nullptr;
+  ASSERT_EQ(zeCommandQueueCreate(context_, device_, &kQueueDesc, &queue), ZE_RESULT_SUCCESS);
+  ze_command_list_desc_t list_desc = {ZE_STRUCTURE_TYPE_COMMAND_LIST_DESC, nullptr, 0, 0};
+  ze_command_list_handle_t command_list = nullptr;
+  ASSERT_EQ(zeCommandListCreate(context_, device_, &list_desc, &command_list), ZE_RESULT_SUCCESS);
+
+  // the queue is not known at append, the launch is instrumented
+  EXPECT_TRUE(LaunchInjectsEvent(command_list));
+  ASSERT_EQ(zeCommandListClose(command_list), ZE_RESULT_SUCCESS);
+  ASSERT_EQ(zeCommandQueueExecuteCommandLists(queue, 1, &command_list, nullptr),
+            ZE_RESULT_SUCCESS);
+  ASSERT_EQ(zeCommandQueueSynchronize(queue, UINT64_MAX), ZE_RESULT_SUCCESS);
+  EXPECT_TRUE(LaunchInjectsEvent(selected_list_));
+
+  ASSERT_EQ(zeCommandListHostSynchronize(selected_list_, UINT64_MAX), ZE_RESULT_SUCCESS);
+  EXPECT_EQ(ptiFlushAllViews(), pti_result::PTI_SUCCESS);
+  EXPECT_EQ(KernelRecordsOf(queue), 0U);
+  EXPECT_EQ(KernelRecordsOf(AsQueue(selected_list_)), 1U);
+
+  EXPECT_EQ(zeCommandListDestroy(command_list), ZE_RESULT_SUCCESS);
+  EXPECT_EQ(zeCommandQueueDestroy(queue), ZE_RESULT_SUCCESS);
+}
+
+TEST_F(CollectionScopeTest, RegularCommandListSelectedByThreadOfAppend) {
+  ASSERT_EQ(ptiViewEnableForThread(ThisThreadId()), pti_result::PTI_SUCCESS);
+
+  ze_command_queue_handle_t queue = nullptr;
+  ASSERT_EQ(zeCommandQueueCreate(context_, device_, &kQueueDesc, &queue), ZE_RESULT_SUCCESS);
+  ze_command_list_desc_t list_desc = {ZE_STRUCTURE_TYPE_COMMAND_LIST_DESC, nullptr, 0, 0};
+  ze_command_list_handle_t command_lists[2] = {nullptr, nullptr};
+  for (auto& command_list : command_lists) {
+    ASSERT_EQ(zeCommandListCreate(context_, device_, &list_desc, &command_list),
+              ZE_RESULT_SUCCESS);
+  }
+
+  EXPECT_TRUE(LaunchInjectsEvent(command_lists[0]));
+  EXPECT_FALSE(LaunchInjectsEventFromOtherThread(command_lists[1]));
+  for (auto command_list : command_lists) {
+    ASSERT_EQ(zeCommandListClose(command_list), ZE_RESULT_SUCCESS);
+  }
+
+  // the thread executing the lists is not the one checked
+  std::thread other([&]() {
+    EXPECT_EQ(zeCommandQueueExecuteCommandLists(queue, 2, command_lists, nullptr),
+              ZE_RESULT_SUCCESS);
+    EXPECT_EQ(zeCommandQueueSynchronize(queue, UINT64_MAX), ZE_RESULT_SUCCESS);
+  });
+  other.join();
+
+  EXPECT_EQ(ptiFlushAllViews(), pti_result::PTI_SUCCESS);
+  EXPECT_EQ(kernel_records.size(), 1U);
+
+  for (auto command_list : command_lists) {
+    EXPECT_EQ(zeCommandListDestroy(command_list), ZE_RESULT_SUCCESS);
+  }
+  EXPECT_EQ(zeCommandQueueDestroy(queue), ZE_RESULT_SUCCESS);
+}
+
+TEST_F(CollectionScopeTest, ResetInstrumentsEverything) {
+  ASSERT_EQ(ptiViewEnableForQueue(AsQueue(selected_list_)), pti_result::PTI_SUCCESS);
+  ASSERT_EQ(ptiViewEnableForThread(ThisThreadId()), pti_result::PTI_SUCCESS);
+  EXPECT_FALSE(LaunchInjectsEventFromOtherThread(other_list_));
+
+  ASSERT_EQ(ptiViewResetScope(), pti_result::PTI_SUCCESS);
+  EXPECT_TRUE(LaunchInjectsEventFromOtherThread(other_list_));
+}
+
+TEST_F(CollectionScopeTest, NullQueueRejected) {
+  EXPECT_EQ(ptiViewEnableForQueue(nullptr), pti_result::PTI_ERROR_BAD_ARGUMENT);
+  EXPECT_TRUE(LaunchInjectsEvent(other_list_));
+}
@@ -0,0 +1,357 @@
+#include <gtest/gtest.h>
+
+#include <map>
+#include <memory>
+#include <set>
+#include <vector>
+
+#include "ze_command_list_replays.h"
+
+namespace {
+
+constexpr uint32_t kOrdinal = 2;
+
+template <typename T>
+T Handle(uintptr_t value) {
+  return reinterpret_cast<T>(value);
+}
+
+struct MockEvent {
+  bool signaled = false;
+  ze_kernel_timestamp_result_t timestamp = {};
+};
+
+struct MockCommand {
+  enum class Type { kQueryTimestamps, kBarrier, kReset, kSignal } type;
+  std::vector<ze_event_handle_t> events;
+  std::vector<ze_event_handle_t> wait_events;
+  void* dst = nullptr;
+};
+
+struct MockCommandList {
+  uint32_t ordinal = 0;
+  bool closed = false;
+  std::vector<MockCommand> commands;
+};
+
+// State of the mock driver: command lists record their commands, events and host memory live in
+// maps, Execute() runs a closed command list
+struct MockDriver {
+  ze_context_handle_t context = Handle<ze_context_handle_t>(0x10);
+  ze_device_handle_t device = Handle<ze_device_handle_t>(0x20);
+  std::map<ze_command_list_handle_t, MockCommandList> command_lists;
+  std::map<ze_event_handle_t, MockEvent> events;
+  std::map<void*, std::unique_ptr<char[]>> allocations;
+  uintptr_t next_handle = 0x1000;
+  ze_result_t command_list_create_status = ZE_RESULT_SUCCESS;
+  uint32_t host_calls = 0;
+  uint32_t event_queries = 0;
+  uint32_t event_host_resets = 0;
+  std::vector<ze_event_handle_t> released_events;
+
+  ze_event_handle_t CreateEvent() {
+    auto event = Handle<ze_event_handle_t>(next_handle++);
+    events[event] = {};
+    return event;
+  }
+
+  // Device signals the event of an operation of the recorded command list
+  void Signal(ze_event_handle_t event, uint64_t start, uint64_t end) {
+    auto& mock_event = events.at(event);
+    mock_event.signaled = true;
+    mock_event.timestamp.global = {start, end};
+    mock_event.timestamp.context = {start, end};
+  }
+
+  void Execute(ze_command_list_handle_t command_list) {
+    const auto& list = command_lists.at(command_list);
+    ASSERT_TRUE(list.closed);
+    for (const auto& command : list.commands) {
+      for (auto* event : command.wait_events) {
+        ASSERT_TRUE(events.at(event).signaled);
+      }
+      switch (command.type) {
+        case MockCommand::Type::kQueryTimestamps: {
+          auto* dst = static_cast<ze_kernel_timestamp_result_t*>(command.dst);
+          for (size_t i = 0; i < command.events.size(); ++i) {
+            dst[i] = events.at(command.events[i]).timestamp;
+          }
+          break;
+        }
+        case MockCommand::Type::kReset:
+          events.at(command.events[0]).signaled = false;
+          break;
+        case MockCommand::Type::kSignal:
+          events.at(command.events[0]).signaled = true;
+          break;
+        case MockCommand::Type::kBarrier:
+          break;
+      }
+    }
+  }
+};
+
+MockDriver* mock = nullptr;
+
+ze_result_t MockMemAllocHost(ze_context_handle_t context, const ze_host_mem_alloc_desc_t* desc,
+                             size_t size, size_t /*alignment*/, void** ptr) {
+  EXPECT_EQ(context, mock->context);
+  EXPECT_EQ(desc->stype, ZE_STRUCTURE_TYPE_HOST_MEM_ALLOC_DESC);
+  ++mock->host_calls;
+  auto buffer = std::make_unique<char[]>(size);
+  *ptr = buffer.get();
+  mock->allocations[*ptr] = std::move(buffer);
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t MockMemFree(ze_context_handle_t /*context*/, void* ptr) {
+  ++mock->host_calls;
+  EXPECT_EQ(mock->allocations.erase(ptr), 1u);
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t MockCommandListCreate(ze_context_handle_t context, ze_device_handle_t device,
+                                  const ze_command_list_desc_t* desc,
+                                  ze_command_list_handle_t* command_list) {
+  EXPECT_EQ(context, mock->context);
+  EXPECT_EQ(device, mock->device);
+  ++mock->host_calls;
+  if (mock->command_list_create_status != ZE_RESULT_SUCCESS) {
+    return mock->command_list_create_status;
+  }
+  *command_list = Handle<ze_command_list_handle_t>(mock->next_handle++);
+  mock->command_lists[*command_list].ordinal = desc->commandQueueGroupOrdinal;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t MockCommandListClose(ze_command_list_handle_t command_list) {
+  ++mock->host_calls;
+  mock->command_lists.at(command_list).closed = true;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t MockCommandListDestroy(ze_command_list_handle_t command_list) {
+  ++mock->host_calls;
+  EXPECT_EQ(mock->command_lists.erase(command_list), 1u);
+  return ZE_RESULT_SUCCESS;
+}
+
+void Append(ze_command_list_handle_t command_list, MockCommand command) {
+  ++mock->host_calls;
+  auto& list = mock->command_lists.at(command_list);
+  EXPECT_FALSE(list.closed);
+  list.commands.push_back(std::move(command));
+}
+
+ze_result_t MockCommandListAppendQueryKernelTimestamps(
+    ze_command_list_handle_t command_list, uint32_t num_events, ze_event_handle_t* events,
+    void* dst, const size_t* offsets, ze_event_handle_t signal_event, uint32_t num_wait_events,
+    ze_event_handle_t* wait_events) {
+  EXPECT_EQ(offsets, nullptr);
+  EXPECT_EQ(signal_event, nullptr);
+  Append(command_list, {MockCommand::Type::kQueryTimestamps,
+                        std::vector<ze_event_handle_t>(events, events + num_events),
+                        std::vector<ze_event_handle_t>(wait_events, wait_events + num_wait_events),
+                        dst});
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t MockCommandListAppendBarrier(ze_command_list_handle_t command_list,
+                                         ze_event_handle_t signal_event, uint32_t num_wait_events,
+                                         ze_event_handle_t* /*wait_events*/) {
+  EXPECT_EQ(signal_event, nullptr);
+  EXPECT_EQ(num_wait_events, 0u);
+  Append(command_list, {MockCommand::Type::kBarrier, {}, {}, nullptr});
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t MockCommandListAppendEventReset(ze_command_list_handle_t command_list,
+                                            ze_event_handle_t event) {
+  Append(command_list, {MockCommand::Type::kReset, {event}, {}, nullptr});
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t MockCommandListAppendSignalEvent(ze_command_list_handle_t command_list,
+                                             ze_event_handle_t event) {
+  Append(command_list, {MockCommand::Type::kSignal, {event}, {}, nullptr});
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t MockEventQueryStatus(ze_event_handle_t event) {
+  ++mock->event_queries;
+  return mock->events.at(event).signaled ? ZE_RESULT_SUCCESS : ZE_RESULT_NOT_READY;
+}
+
+ze_result_t MockEventHostReset(ze_event_handle_t event) {
+  ++mock->event_host_resets;
+  mock->events.at(event).signaled = false;
+  return ZE_RESULT_SUCCESS;
+}
+
+ZeReplayApi MockReplayApi() {
+  ZeReplayApi api;
+  api.mem_alloc_host = MockMemAllocHost;
+  api.mem_free = MockMemFree;
+  api.command_list_create = MockCommandListCreate;
+  api.command_list_close = MockCommandListClose;
+  api.command_list_destroy = MockCommandListDestroy;
+  api.command_list_append_query_kernel_timestamps = MockCommandListAppendQueryKernelTimestamps;
+  api.command_list_append_barrier = MockCommandListAppendBarrier;
+  api.command_list_append_event_reset = MockCommandListAppendEventReset;
+  api.command_list_append_signal_event = MockCommandListAppendSignalEvent;
+  api.event_query_status = MockEventQueryStatus;
+  api.event_host_reset = MockEventHostReset;
+  return api;
+}
+
+}  // namespace
+
+// Graph of three nodes: a kernel with an event of the collector, a kernel with an event of the
+// application and a kernel whose timestamps are in a swap event, as in the Local collection mode
+class CommandListReplayTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    mock = &driver_;
+    for (int i = 0; i < 3; ++i) {
+      node_events_.push_back(driver_.CreateEvent());
+    }
+    swap_event_ = driver_.CreateEvent();
+    nodes_ = {{node_events_[0], node_events_[0], true},
+              {node_events_[1], node_events_[1], false},
+              {swap_event_, node_events_[2], false}};
+  }
+
+  void TearDown() override { mock = nullptr; }
+
+  std::unique_ptr<ZeCommandListReplays> Record() {
+    return std::make_unique<ZeCommandListReplays>(
+        driver_.context, driver_.device, kOrdinal, nodes_,
+        [this]() { return driver_.CreateEvent(); },
+        [this](ze_event_handle_t event) { driver_.released_events.push_back(event); },
+        MockReplayApi());
+  }
+
+  // Device runs the recorded command list, the application resets its own event in between
+  void RunGraph(uint64_t base) {
+    driver_.events.at(node_events_[1]).signaled = false;
+    driver_.Signal(node_events_[0], base, base + 10);
+    driver_.Signal(node_events_[1], base + 20, base + 30);
+    driver_.Signal(swap_event_, base + 40, base + 50);
+    driver_.Signal(node_events_[2], base + 55, base + 55);
+  }
+
+  MockDriver driver_;
+  std::vector<ze_event_handle_t> node_events_;
+  ze_event_handle_t swap_event_ = nullptr;
+  std::vector<ZeReplayNode> nodes_;
+};
+
+TEST_F(CommandListReplayTest, HarvestListQueriesAllNodesAndResetsOwnedEvents) {
+  auto replays = Record();
+  ZeReplay* replay = replays->Begin();
+  ASSERT_NE(replay, nullptr);
+  EXPECT_EQ(replay->index, 0u);
+
+  const auto& list = driver_.command_lists.at(replay->harvest_list);
+  EXPECT_TRUE(list.closed);
+  EXPECT_EQ(list.ordinal, kOrdinal);
+  ASSERT_EQ(list.commands.size(), 4u);
+
+  const auto& query = list.commands[0];
+  EXPECT_EQ(query.type, MockCommand::Type::kQueryTimestamps);
+  EXPECT_EQ(query.events,
+            (std::vector<ze_event_handle_t>{node_events_[0], node_events_[1], swap_event_}));
+  // swap event and the event signaled after it are both waited for
+  EXPECT_EQ(std::set<ze_event_handle_t>(query.wait_events.begin(), query.wait_events.end()),
+            (std::set<ze_event_handle_t>{node_events_[0], node_events_[1], node_events_[2],
+                                         swap_event_}));
+  EXPECT_EQ(query.dst, replay->timestamps);
+  EXPECT_EQ(list.commands[1].type, MockCommand::Type::kBarrier);
+  // only the event of the collector is reset
+  EXPECT_EQ(list.commands[2].type, MockCommand::Type::kReset);
+  EXPECT_EQ(list.commands[2].events[0], node_events_[0]);
+  EXPECT_EQ(list.commands[3].type, MockCommand::Type::kSignal);
+  EXPECT_EQ(list.commands[3].events[0], replay->done_event);
+}
+
+TEST_F(CommandListReplayTest, ManyReplaysAttributedWithoutPerNodeHostWork) {
+  constexpr uint32_t kReplays = 1000;
+  constexpr uint32_t kInFlight = 3;
+  auto replays = Record();
+
+  uint32_t next = 0;
+  while (next < kReplays) {
+    std::vector<ZeReplay*> in_flight;
+    for (uint32_t i = 0; i < kInFlight && next < kReplays; ++i, ++next) {
+      ZeReplay* replay = replays->Begin();
+      ASSERT_NE(replay, nullptr);
+      EXPECT_EQ(replay->index, next);
+      EXPECT_FALSE(replays->IsComplete(replay));
+      // queue executes the recorded list and the harvest list right after it
+      RunGraph(1000 * next);
+      driver_.Execute(replay->harvest_list);
+      in_flight.push_back(replay);
+    }
+    for (ZeReplay* replay : in_flight) {
+      ASSERT_TRUE(replays->IsComplete(replay));
+      uint64_t base = 1000 * replay->index;
+      EXPECT_EQ(replay->timestamps[0].global.kernelStart, base);
+      EXPECT_EQ(replay->timestamps[1].global.kernelStart, base + 20);
+      EXPECT_EQ(replay->timestamps[2].global.kernelStart, base + 40);
+      EXPECT_EQ(replay->timestamps[2].global.kernelEnd, base + 50);
+      replays->End(replay);
+    }
+    // owned event is ready for the next replay
+    EXPECT_FALSE(driver_.events.at(node_events_[0]).signaled);
+  }
+
+  EXPECT_EQ(replays->GetReplayCount(), kReplays);
+  EXPECT_EQ(replays->GetReplaySlotCount(), kInFlight);
+  // harvest lists are built once per slot, a replay costs a query and a reset of its done event
+  uint32_t build_calls = 7;  // alloc, create, query, barrier, reset, signal, close
+  EXPECT_EQ(driver_.host_calls, build_calls * kInFlight);
+  EXPECT_EQ(driver_.event_host_resets, kReplays);
+  EXPECT_EQ(driver_.event_queries, 2 * kReplays);
+}
+
+TEST_F(CommandListReplayTest, NoReplayIfHarvestListNotBuilt) {
+  driver_.command_list_create_status = ZE_RESULT_ERROR_OUT_OF_HOST_MEMORY;
+  auto replays = Record();
+  EXPECT_EQ(replays->Begin(), nullptr);
+  EXPECT_EQ(replays->GetReplaySlotCount(), 0u);
+  EXPECT_EQ(replays->GetReplayCount(), 0u);
+  EXPECT_TRUE(driver_.allocations.empty());
+  EXPECT_EQ(driver_.released_events.size(), 1u);
+
+  driver_.command_list_create_status = ZE_RESULT_SUCCESS;
+  ZeReplay* replay = replays->Begin();
+  ASSERT_NE(replay, nullptr);
+  EXPECT_EQ(replay->index, 0u);
+}
+
+TEST_F(CommandListReplayTest, FailedExecuteReturnsReplay) {
+  auto replays = Record();
+  ZeReplay* replay = replays->Begin();
+  ASSERT_NE(replay, nullptr);
+  replays->End(replay);
+  EXPECT_EQ(replays->Begin(), replay);
+  EXPECT_EQ(replay->index, 1u);
+  EXPECT_EQ(replays->GetReplaySlotCount(), 1u);
+}
+
+TEST_F(CommandListReplayTest, DestructionReleasesSlotsAndOwnedEvents) {
+  auto replays = Record();
+  ZeReplay* first = replays->Begin();
+  ZeReplay* second = replays->Begin();
+  ASSERT_NE(first, nullptr);
+  ASSERT_NE(second, nullptr);
+  std::set<ze_event_handle_t> expected = {first->done_event, second->done_event, node_events_[0]};
+
+  replays.reset();
+  EXPECT_TRUE(driver_.command_lists.empty());
+  EXPECT_TRUE(driver_.allocations.empty());
+  EXPECT_EQ(std::set<ze_event_handle_t>(driver_.released_events.begin(),
+                                        driver_.released_events.end()),
+            expected);
+  EXPECT_EQ(driver_.released_events.size(), expected.size());
+}
@@ -0,0 +1,173 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+#include "ze_kernel_args.h"
+
+namespace {
+
+template <typename T>
+T Handle(uintptr_t value) {
+  return reinterpret_cast<T>(value);
+}
+
+struct LargeValue {
+  uint64_t x;
+  uint64_t y;
+};
+
+}  // namespace
+
+class ZeKernelArgsTest : public ::testing::Test {
+ protected:
+  void SetArgument(uint32_t index, uint32_t value) {
+    kernel_args_.SetArgument(kernel_, index, sizeof(value), &value);
+  }
+
+  std::shared_ptr<const ZeKernelArgSet> GetArgSet(uint32_t arg_count = 2) {
+    return kernel_args_.GetArgSet(kernel_, kKernelInfoId, arg_count);
+  }
+
+  static constexpr uint64_t kKernelInfoId = 5;
+  ze_context_handle_t context_ = Handle<ze_context_handle_t>(0x10);
+  ze_kernel_handle_t kernel_ = Handle<ze_kernel_handle_t>(0x20);
+  ZeKernelArgs kernel_args_;
+};
+
+TEST_F(ZeKernelArgsTest, LaunchesWithTheSameArgumentsShareTheSet) {
+  SetArgument(0, 1);
+  SetArgument(1, 2);
+  auto first = GetArgSet();
+  ASSERT_NE(first, nullptr);
+  EXPECT_NE(first->id_, 0u);
+  EXPECT_EQ(first->kernel_info_id_, kKernelInfoId);
+  ASSERT_EQ(first->args_.size(), 2u);
+  EXPECT_EQ(first->args_[1]._index, 1u);
+  EXPECT_EQ(first->args_[1]._type, PTI_KERNEL_ARG_TYPE_VALUE);
+  EXPECT_EQ(first->args_[1]._size, sizeof(uint32_t));
+  EXPECT_EQ(first->args_[1]._value, 2u);
+
+  EXPECT_EQ(GetArgSet(), first);
+  // set again to the same values before the next launch
+  SetArgument(0, 1);
+  SetArgument(1, 2);
+  EXPECT_EQ(GetArgSet(), first);
+  EXPECT_EQ(kernel_args_.GetArgSetCount(kernel_), 1u);
+}
+
+TEST_F(ZeKernelArgsTest, ArgumentSetsAreDeduplicated) {
+  SetArgument(0, 1);
+  SetArgument(1, 2);
+  auto first = GetArgSet();
+  SetArgument(1, 3);
+  auto second = GetArgSet();
+  EXPECT_NE(second, first);
+  EXPECT_NE(second->id_, first->id_);
+  EXPECT_EQ(second->args_[1]._value, 3u);
+
+  // back to the first values, found by hash
+  SetArgument(1, 2);
+  EXPECT_EQ(GetArgSet(), first);
+  SetArgument(1, 3);
+  EXPECT_EQ(GetArgSet(), second);
+  EXPECT_EQ(kernel_args_.GetArgSetCount(kernel_), 2u);
+}
+
+TEST_F(ZeKernelArgsTest, PointersAreResolvedFromUsmAllocations) {
+  auto& allocations = kernel_args_.GetUsmAllocations();
+  allocations.Add(context_, Handle<void*>(0x10000), 0x1000, PTI_VIEW_MEMORY_TYPE_DEVICE);
+  allocations.Add(context_, Handle<void*>(0x20000), 0x1000, PTI_VIEW_MEMORY_TYPE_SHARED);
+
+  void* inside = Handle<void*>(0x10800);
+  void* past_end = Handle<void*>(0x11000);
+  kernel_args_.SetArgument(kernel_, 0, sizeof(inside), &inside);
+  kernel_args_.SetArgument(kernel_, 1, sizeof(past_end), &past_end);
+  auto arg_set = GetArgSet();
+  EXPECT_EQ(arg_set->args_[0]._type, PTI_KERNEL_ARG_TYPE_POINTER);
+  EXPECT_EQ(arg_set->args_[0]._memory_type, PTI_VIEW_MEMORY_TYPE_DEVICE);
+  EXPECT_EQ(arg_set->args_[0]._value, 0x10800u);
+  EXPECT_EQ(arg_set->args_[1]._type, PTI_KERNEL_ARG_TYPE_VALUE);
+  EXPECT_EQ(arg_set->args_[1]._memory_type, PTI_VIEW_MEMORY_TYPE_MEMORY);
+
+  // freed memory is not a pointer anymore
+  allocations.Remove(Handle<void*>(0x10000));
+  kernel_args_.SetArgument(kernel_, 0, sizeof(inside), &inside);
+  EXPECT_EQ(GetArgSet()->args_[0]._type, PTI_KERNEL_ARG_TYPE_VALUE);
+
+  allocations.RemoveContext(context_);
+  EXPECT_EQ(allocations.GetCount(), 0u);
+}
+
+TEST_F(ZeKernelArgsTest, LargeLocalAndUnsetArguments) {
+  LargeValue large{0x1122334455667788ULL, 42};
+  kernel_args_.SetArgument(kernel_, 0, sizeof(large), &large);
+  kernel_args_.SetArgument(kernel_, 1, 256, nullptr);
+  auto arg_set = GetArgSet(3);
+  ASSERT_EQ(arg_set->args_.size(), 3u);
+
+  EXPECT_EQ(arg_set->args_[0]._type, PTI_KERNEL_ARG_TYPE_VALUE);
+  EXPECT_EQ(arg_set->args_[0]._size, sizeof(large));
+  ASSERT_NE(arg_set->args_[0]._data, nullptr);
+  EXPECT_EQ(std::memcmp(arg_set->args_[0]._data, &large, sizeof(large)), 0);
+  EXPECT_EQ(arg_set->args_[1]._type, PTI_KERNEL_ARG_TYPE_LOCAL);
+  EXPECT_EQ(arg_set->args_[1]._size, 256u);
+  EXPECT_EQ(arg_set->args_[1]._data, nullptr);
+  EXPECT_EQ(arg_set->args_[2]._type, PTI_KERNEL_ARG_TYPE_NOT_SET);
+
+  // large values are compared by content
+  large.y = 43;
+  kernel_args_.SetArgument(kernel_, 0, sizeof(large), &large);
+  auto changed = GetArgSet(3);
+  EXPECT_NE(changed, arg_set);
+  large.y = 42;
+  kernel_args_.SetArgument(kernel_, 0, sizeof(large), &large);
+  EXPECT_EQ(GetArgSet(3), arg_set);
+}
+
+TEST_F(ZeKernelArgsTest, SetsBelongToTheirKernel) {
+  auto other_kernel = Handle<ze_kernel_handle_t>(0x30);
+  SetArgument(0, 1);
+  uint32_t value = 1;
+  kernel_args_.SetArgument(other_kernel, 0, sizeof(value), &value);
+  auto arg_set = GetArgSet(1);
+  auto other_set = kernel_args_.GetArgSet(other_kernel, kKernelInfoId + 1, 1);
+  EXPECT_NE(arg_set->id_, other_set->id_);
+  EXPECT_EQ(other_set->kernel_info_id_, kKernelInfoId + 1);
+
+  // launches appended keep the set alive
+  kernel_args_.RemoveKernel(kernel_);
+  EXPECT_EQ(kernel_args_.GetArgSetCount(kernel_), 0u);
+  EXPECT_EQ(arg_set->args_[0]._value, 1u);
+}
+
+TEST_F(ZeKernelArgsTest, ArgumentSetsOfAKernelAreCapped) {
+  for (uint32_t i = 0; i < ZeKernelArgs::kMaxArgSetsPerKernel; ++i) {
+    SetArgument(0, i);
+    GetArgSet(1);
+  }
+  EXPECT_EQ(kernel_args_.GetArgSetCount(kernel_), ZeKernelArgs::kMaxArgSetsPerKernel);
+
+  SetArgument(0, ZeKernelArgs::kMaxArgSetsPerKernel);
+  auto arg_set = GetArgSet(1);
+  EXPECT_EQ(kernel_args_.GetArgSetCount(kernel_), 1u);
+  EXPECT_EQ(GetArgSet(1), arg_set);
+
+  // a set dropped from the cache is recorded again with a new id
+  SetArgument(0, 0);
+  EXPECT_EQ(GetArgSet(1)->id_, ZeKernelArgs::kMaxArgSetsPerKernel + 2);
+}
+
+TEST_F(ZeKernelArgsTest, ClearForgetsArgumentsAndAllocations) {
+  auto& allocations = kernel_args_.GetUsmAllocations();
+  allocations.Add(nullptr, reinterpret_cast<void*>(0x1000), 0x100, PTI_VIEW_MEMORY_TYPE_DEVICE);
+  SetArgument(0, 1);
+  auto arg_set = GetArgSet(1);
+
+  kernel_args_.Clear();
+  EXPECT_EQ(kernel_args_.GetArgSetCount(kernel_), 0u);
+  EXPECT_EQ(kernel_args_.GetUsmAllocations().GetCount(), 0u);
+  EXPECT_EQ(GetArgSet(1)->args_[0]._type, PTI_KERNEL_ARG_TYPE_NOT_SET);
+  EXPECT_EQ(arg_set->args_[0]._value, 1u);
+}
@@ -0,0 +1,347 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "ze_kernel_metrics.h"
+
+namespace {
+
+constexpr const char* kGroupName = "ComputeBasic";
+constexpr uint32_t kMetricCount = 3;
+constexpr uint32_t kRawDataSize = 16;
+
+template <typename T>
+T Handle(uintptr_t value) {
+  return reinterpret_cast<T>(value);
+}
+
+// State of the mock metrics layer: one device with two metric groups, the second one is sampled
+struct MockMetrics {
+  ze_device_handle_t device = Handle<ze_device_handle_t>(0x10);
+  std::vector<zet_metric_group_handle_t> groups = {Handle<zet_metric_group_handle_t>(0x20),
+                                                   Handle<zet_metric_group_handle_t>(0x21)};
+  std::vector<zet_metric_handle_t> metrics = {Handle<zet_metric_handle_t>(0x30),
+                                              Handle<zet_metric_handle_t>(0x31),
+                                              Handle<zet_metric_handle_t>(0x32)};
+  uint32_t activations = 0;
+  uint32_t pools_created = 0;
+  uint32_t pools_destroyed = 0;
+  uint32_t queries_created = 0;
+  uint32_t queries_destroyed = 0;
+  uint32_t queries_reset = 0;
+  uint32_t query_begins = 0;
+  uint32_t query_ends = 0;
+  uintptr_t next_handle = 0x1000;
+  ze_result_t event_status = ZE_RESULT_SUCCESS;
+  std::vector<uint64_t> event_timeouts;
+  std::vector<ze_event_handle_t> released_events;
+};
+
+MockMetrics* mock = nullptr;
+
+ze_result_t MockMetricGroupGet(ze_device_handle_t device, uint32_t* count,
+                               zet_metric_group_handle_t* groups) {
+  if (device != mock->device) {
+    *count = 0;
+    return ZE_RESULT_SUCCESS;
+  }
+  if (groups != nullptr) {
+    std::copy_n(mock->groups.begin(), *count, groups);
+  }
+  *count = static_cast<uint32_t>(mock->groups.size());
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t MockMetricGroupGetProperties(zet_metric_group_handle_t group,
+                                         zet_metric_group_properties_t* props) {
+  bool sampled = (group == mock->groups[1]);
+  std::strcpy(props->name, sampled ? kGroupName : "MemoryProfile");
+  props->samplingType = ZET_METRIC_GROUP_SAMPLING_TYPE_FLAG_EVENT_BASED;
+  props->metricCount = sampled ? kMetricCount : 1;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t MockMetricGet(zet_metric_group_handle_t /*group*/, uint32_t* count,
+                          zet_metric_handle_t* metrics) {
+  std::copy_n(mock->metrics.begin(), *count, metrics);
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t MockMetricGetProperties(zet_metric_handle_t metric, zet_metric_properties_t* props) {
+  static const std::map<uintptr_t, std::pair<const char*, zet_value_type_t>> kMetrics = {
+      {0x30, {"GpuTime", ZET_VALUE_TYPE_UINT64}},
+      {0x31, {"EuActive", ZET_VALUE_TYPE_FLOAT32}},
+      {0x32, {"GpuBusy", ZET_VALUE_TYPE_BOOL8}}};
+  const auto& [name, type] = kMetrics.at(reinterpret_cast<uintptr_t>(metric));
+  std::strcpy(props->name, name);
+  std::strcpy(props->resultUnits, type == ZET_VALUE_TYPE_UINT64 ? "ns" : "percent");
+  props->resultType = type;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t MockContextActivateMetricGroups(ze_context_handle_t /*context*/,
+                                            ze_device_handle_t /*device*/, uint32_t count,
+                                            zet_metric_group_handle_t* groups) {
+  EXPECT_EQ(count, 1u);
+  EXPECT_EQ(groups[0], mock->groups[1]);
+  ++mock->activations;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t MockMetricQueryPoolCreate(ze_context_handle_t /*context*/,
+                                      ze_device_handle_t /*device*/,
+                                      zet_metric_group_handle_t /*group*/,
+                                      const zet_metric_query_pool_desc_t* desc,
+                                      zet_metric_query_pool_handle_t* pool) {
+  EXPECT_EQ(desc->type, ZET_METRIC_QUERY_POOL_TYPE_PERFORMANCE);
+  EXPECT_EQ(desc->count, ZeKernelMetrics::kQueriesPerPool);
+  ++mock->pools_created;
+  *pool = Handle<zet_metric_query_pool_handle_t>(mock->next_handle++);
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t MockMetricQueryPoolDestroy(zet_metric_query_pool_handle_t /*pool*/) {
+  ++mock->pools_destroyed;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t MockMetricQueryCreate(zet_metric_query_pool_handle_t /*pool*/, uint32_t /*index*/,
+                                  zet_metric_query_handle_t* query) {
+  ++mock->queries_created;
+  *query = Handle<zet_metric_query_handle_t>(mock->next_handle++);
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t MockMetricQueryDestroy(zet_metric_query_handle_t /*query*/) {
+  ++mock->queries_destroyed;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t MockMetricQueryReset(zet_metric_query_handle_t /*query*/) {
+  ++mock->queries_reset;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t MockMetricQueryGetData(zet_metric_query_handle_t /*query*/, size_t* size,
+                                   uint8_t* data) {
+  if (data == nullptr) {
+    *size = kRawDataSize;
+  } else {
+    std::fill_n(data, *size, uint8_t{0xA5});
+  }
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t MockMetricGroupCalculateMetricValues(zet_metric_group_handle_t /*group*/,
+                                                 zet_metric_group_calculation_type_t type,
+                                                 size_t raw_data_size, const uint8_t* raw_data,
+                                                 uint32_t* count, zet_typed_value_t* values) {
+  EXPECT_EQ(type, ZET_METRIC_GROUP_CALCULATION_TYPE_METRIC_VALUES);
+  EXPECT_EQ(raw_data_size, kRawDataSize);
+  EXPECT_EQ(raw_data[0], 0xA5);
+  if (values != nullptr) {
+    values[0].type = ZET_VALUE_TYPE_UINT64;
+    values[0].value.ui64 = 12345;
+    values[1].type = ZET_VALUE_TYPE_FLOAT32;
+    values[1].value.fp32 = 87.5f;
+    values[2].type = ZET_VALUE_TYPE_BOOL8;
+    values[2].value.b8 = 1;
+  }
+  *count = kMetricCount;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t MockCommandListAppendMetricQueryBegin(zet_command_list_handle_t /*command_list*/,
+                                                  zet_metric_query_handle_t /*query*/) {
+  ++mock->query_begins;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t MockCommandListAppendMetricQueryEnd(zet_command_list_handle_t /*command_list*/,
+                                                zet_metric_query_handle_t /*query*/,
+                                                ze_event_handle_t /*event*/,
+                                                uint32_t /*num_wait_events*/,
+                                                ze_event_handle_t* /*wait_events*/) {
+  ++mock->query_ends;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t MockEventHostSynchronize(ze_event_handle_t /*event*/, uint64_t timeout) {
+  mock->event_timeouts.push_back(timeout);
+  return mock->event_status;
+}
+
+ZeMetricApi MockMetricApi() {
+  ZeMetricApi api;
+  api.metric_group_get = MockMetricGroupGet;
+  api.metric_group_get_properties = MockMetricGroupGetProperties;
+  api.metric_get = MockMetricGet;
+  api.metric_get_properties = MockMetricGetProperties;
+  api.context_activate_metric_groups = MockContextActivateMetricGroups;
+  api.metric_query_pool_create = MockMetricQueryPoolCreate;
+  api.metric_query_pool_destroy = MockMetricQueryPoolDestroy;
+  api.metric_query_create = MockMetricQueryCreate;
+  api.metric_query_destroy = MockMetricQueryDestroy;
+  api.metric_query_reset = MockMetricQueryReset;
+  api.metric_query_get_data = MockMetricQueryGetData;
+  api.metric_group_calculate_metric_values = MockMetricGroupCalculateMetricValues;
+  api.command_list_append_metric_query_begin = MockCommandListAppendMetricQueryBegin;
+  api.command_list_append_metric_query_end = MockCommandListAppendMetricQueryEnd;
+  api.event_host_synchronize = MockEventHostSynchronize;
+  return api;
+}
+
+class KernelMetricsTest : public ::testing::Test {
+ protected:
+  void SetUp() override { mock = &mock_metrics_; }
+
+  void TearDown() override {
+    kernel_metrics_.reset();
+    mock = nullptr;
+  }
+
+  std::unique_ptr<ZeKernelMetrics> CreateKernelMetrics(const std::string& group_name) {
+    return std::make_unique<ZeKernelMetrics>(
+        group_name, [](ze_event_handle_t event) { mock->released_events.push_back(event); },
+        MockMetricApi());
+  }
+
+  MockMetrics mock_metrics_;
+  std::unique_ptr<ZeKernelMetrics> kernel_metrics_ = CreateKernelMetrics(kGroupName);
+  const ze_command_list_handle_t command_list_ = Handle<ze_command_list_handle_t>(0x40);
+  const ze_context_handle_t context_ = Handle<ze_context_handle_t>(0x50);
+  const ze_event_handle_t event_ = Handle<ze_event_handle_t>(0x60);
+};
+
+}  // namespace
+
+TEST_F(KernelMetricsTest, SchemaOfNamedMetricGroup) {
+  auto sample = kernel_metrics_->Begin(command_list_, context_, mock->device);
+  ASSERT_NE(sample, nullptr);
+  EXPECT_EQ(mock->query_begins, 1u);
+  EXPECT_FALSE(sample->IsComplete());
+
+  const ZeKernelMetricSchema* schema = sample->GetSchema();
+  ASSERT_NE(schema, nullptr);
+  EXPECT_EQ(schema->id_, 1u);
+  EXPECT_EQ(schema->group_, mock->groups[1]);
+  EXPECT_EQ(schema->group_name_, kGroupName);
+  ASSERT_EQ(schema->name_ptrs_.size(), kMetricCount);
+  EXPECT_STREQ(schema->name_ptrs_[0], "GpuTime");
+  EXPECT_STREQ(schema->unit_ptrs_[0], "ns");
+  EXPECT_STREQ(schema->name_ptrs_[1], "EuActive");
+  EXPECT_EQ(schema->value_types_[0], PTI_METRIC_VALUE_TYPE_UINT64);
+  EXPECT_EQ(schema->value_types_[1], PTI_METRIC_VALUE_TYPE_FLOAT32);
+  EXPECT_EQ(schema->value_types_[2], PTI_METRIC_VALUE_TYPE_BOOL8);
+
+  auto other_sample = kernel_metrics_->Begin(command_list_, context_, mock->device);
+  ASSERT_NE(other_sample, nullptr);
+  EXPECT_EQ(other_sample->GetSchema(), schema);
+  EXPECT_EQ(mock->activations, 1u);
+}
+
+TEST_F(KernelMetricsTest, NoSampleWithoutMetricGroup) {
+  kernel_metrics_ = CreateKernelMetrics("NoSuchGroup");
+  EXPECT_EQ(kernel_metrics_->Begin(command_list_, context_, mock->device), nullptr);
+  EXPECT_EQ(kernel_metrics_->Begin(command_list_, context_, Handle<ze_device_handle_t>(0x11)),
+            nullptr);
+  EXPECT_EQ(mock->query_begins, 0u);
+  EXPECT_EQ(mock->pools_created, 0u);
+  EXPECT_EQ(mock->activations, 0u);
+}
+
+TEST_F(KernelMetricsTest, QueriesArePooledAndReused) {
+  constexpr uint32_t kSampleCount = ZeKernelMetrics::kQueriesPerPool + 1;
+  std::vector<std::shared_ptr<ZeKernelMetricSample>> samples;
+  for (uint32_t i = 0; i < kSampleCount; ++i) {
+    samples.push_back(kernel_metrics_->Begin(command_list_, context_, mock->device));
+    ASSERT_NE(samples.back(), nullptr);
+  }
+  EXPECT_EQ(mock->pools_created, 2u);
+  EXPECT_EQ(mock->queries_created, 2 * ZeKernelMetrics::kQueriesPerPool);
+
+  samples.clear();
+  EXPECT_EQ(mock->queries_reset, kSampleCount);
+  for (uint32_t i = 0; i < kSampleCount; ++i) {
+    samples.push_back(kernel_metrics_->Begin(command_list_, context_, mock->device));
+  }
+  EXPECT_EQ(mock->pools_created, 2u);
+
+  samples.clear();
+  kernel_metrics_.reset();
+  EXPECT_EQ(mock->pools_destroyed, 2u);
+  EXPECT_EQ(mock->queries_destroyed, mock->queries_created);
+}
+
+TEST_F(KernelMetricsTest, ValuesCalculatedOnceQueryEnded) {
+  auto sample = kernel_metrics_->Begin(command_list_, context_, mock->device);
+  ASSERT_NE(sample, nullptr);
+  std::vector<zet_typed_value_t> values;
+  EXPECT_FALSE(sample->Calculate(values));
+
+  ASSERT_TRUE(sample->End(command_list_, event_));
+  EXPECT_EQ(mock->query_ends, 1u);
+  EXPECT_TRUE(sample->IsComplete());
+  ASSERT_TRUE(sample->Calculate(values));
+  ASSERT_EQ(values.size(), kMetricCount);
+
+  EXPECT_EQ(ToPtiMetricValue(values[0])._ui64, 12345u);
+  EXPECT_FLOAT_EQ(ToPtiMetricValue(values[1])._fp32, 87.5f);
+  EXPECT_EQ(ToPtiMetricValue(values[2])._b8, 1u);
+
+  sample.reset();
+  ASSERT_EQ(mock->released_events.size(), 1u);
+  EXPECT_EQ(mock->released_events[0], event_);
+  EXPECT_EQ(mock->queries_reset, 1u);
+}
+
+TEST_F(KernelMetricsTest, NoValuesIfQueryEndNotSignaled) {
+  auto sample = kernel_metrics_->Begin(command_list_, context_, mock->device);
+  ASSERT_NE(sample, nullptr);
+  ASSERT_TRUE(sample->End(command_list_, event_));
+  mock->event_status = ZE_RESULT_NOT_READY;
+  std::vector<zet_typed_value_t> values;
+  EXPECT_FALSE(sample->Calculate(values));
+}
+
+TEST_F(KernelMetricsTest, QueryEndPolledWithoutWaiting) {
+  auto sample = kernel_metrics_->Begin(command_list_, context_, mock->device);
+  ASSERT_NE(sample, nullptr);
+  EXPECT_FALSE(sample->IsEnded());
+  ASSERT_TRUE(sample->End(command_list_, event_));
+
+  mock->event_status = ZE_RESULT_NOT_READY;
+  EXPECT_FALSE(sample->IsEnded());
+  mock->event_status = ZE_RESULT_SUCCESS;
+  EXPECT_TRUE(sample->IsEnded());
+  std::vector<zet_typed_value_t> values;
+  EXPECT_TRUE(sample->Calculate(values));
+
+  // the consumer thread is never blocked on the query
+  ASSERT_FALSE(mock->event_timeouts.empty());
+  for (auto timeout : mock->event_timeouts) {
+    EXPECT_EQ(timeout, 0u);
+  }
+}
+
+TEST_F(KernelMetricsTest, ContextReleaseDestroysItsPools) {
+  auto sample = kernel_metrics_->Begin(command_list_, context_, mock->device);
+  ASSERT_NE(sample, nullptr);
+  kernel_metrics_->ReleaseContext(context_);
+  EXPECT_EQ(mock->pools_destroyed, 1u);
+  EXPECT_EQ(mock->queries_destroyed, ZeKernelMetrics::kQueriesPerPool);
+
+  // query of the destroyed pool is not reused
+  sample.reset();
+  EXPECT_EQ(mock->queries_reset, 0u);
+
+  sample = kernel_metrics_->Begin(command_list_, context_, mock->device);
+  ASSERT_NE(sample, nullptr);
+  EXPECT_EQ(mock->pools_created, 2u);
+  EXPECT_EQ(mock->activations, 2u);
+}
@@ -0,0 +1,212 @@
+#include <gtest/gtest.h>
+#include <level_zero/ze_api.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#include "pti/pti_view.h"
+#include "utils/mock_ze_fixture.h"
+
+// Runs the application commands through the loader and the collector in Local collection mode to
+// the mock driver, and counts the bridge commands the collector appends for each kind of the
+// application signal event
+
+namespace {
+
+constexpr uint32_t kCommands = 8;
+constexpr ze_event_pool_flags_t kTimestampHostVisible =
+    ZE_EVENT_POOL_FLAG_KERNEL_TIMESTAMP | ZE_EVENT_POOL_FLAG_HOST_VISIBLE;
+
+void BufferRequested(unsigned char** buf, size_t* buf_size) {
+  *buf_size = 1024 * sizeof(pti_view_record_kernel);
+  *buf = static_cast<unsigned char*>(::operator new(*buf_size, std::align_val_t(8)));
+}
+
+void BufferCompleted(unsigned char* buf, size_t /*buf_size*/, size_t /*used_bytes*/) {
+  ::operator delete(buf, std::align_val_t(8));
+}
+
+}  // namespace
+
+class LocalCollectionBridgeTest : public pti::test::utils::level_zero::MockZeDriverTest {
+ protected:
+  void SetUp() override {
+    // read once, when the first call below creates the collector
+    setenv("PTI_COLLECTION_MODE", "2", 0);
+    // no bridge kernel cache on disk, the binaries come from the warmup on enable only
+    setenv("PTI_BRIDGE_KERNEL_CACHE_DIR", "/dev/null/pti", 0);
+    ASSERT_EQ(ptiViewSetCallbacks(BufferRequested, BufferCompleted), pti_result::PTI_SUCCESS);
+    // the collector is created by the call above, it initialized Level Zero
+    if (!MockZeDriver::Instance().IsLoaded()) {
+      GTEST_SKIP() << "Mock Level Zero driver not loaded, set ZE_ENABLE_ALT_DRIVERS to it";
+    }
+    if (ptiViewGPULocalAvailable() != pti_result::PTI_SUCCESS) {
+      GTEST_SKIP() << "Loader without dynamic tracing";
+    }
+
+    ASSERT_NO_FATAL_FAILURE(CreateAppObjects());
+
+    ASSERT_EQ(ptiViewEnable(PTI_VIEW_DEVICE_GPU_KERNEL), pti_result::PTI_SUCCESS);
+    enabled_ = true;
+  }
+
+  void TearDown() override {
+    if (enabled_) {
+      EXPECT_EQ(ptiViewDisable(PTI_VIEW_DEVICE_GPU_KERNEL), pti_result::PTI_SUCCESS);
+      EXPECT_EQ(ptiFlushAllViews(), pti_result::PTI_SUCCESS);
+    }
+    for (auto event : events_) {
+      zeEventDestroy(event);
+    }
+    for (auto event_pool : event_pools_) {
+      zeEventPoolDestroy(event_pool);
+    }
+    DestroyAppObjects();
+  }
+
+  // kCommands events of a new pool, none signaled
+  std::vector<ze_event_handle_t> CreateEvents(ze_event_pool_flags_t flags) {
+    ze_event_pool_desc_t pool_desc = {ZE_STRUCTURE_TYPE_EVENT_POOL_DESC, nullptr, flags,
+                                      kCommands};
+    ze_event_pool_handle_t event_pool = nullptr;
+    EXPECT_EQ(zeEventPoolCreate(context_, &pool_desc, 1, &device_, &event_pool),
+              ZE_RESULT_SUCCESS);
+    event_pools_.push_back(event_pool);
+
+    std::vector<ze_event_handle_t> events;
+    for (uint32_t i = 0; i < kCommands; ++i) {
+      ze_event_desc_t event_desc = {ZE_STRUCTURE_TYPE_EVENT_DESC, nullptr, i,
+                                    ZE_EVENT_SCOPE_FLAG_HOST, ZE_EVENT_SCOPE_FLAG_HOST};
+      ze_event_handle_t event = nullptr;
+      EXPECT_EQ(zeEventCreate(event_pool, &event_desc, &event), ZE_RESULT_SUCCESS);
+      events.push_back(event);
+      events_.push_back(event);
+    }
+    return events;
+  }
+
+  // commands the driver received other than the ones the application appended
+  static uint32_t CountBridges(const std::vector<MockZeAppendedCommand>& commands,
+                               MockZeCommand app_command, ze_kernel_handle_t app_kernel) {
+    uint32_t count = 0;
+    for (const auto& command : commands) {
+      if (command.command != app_command || command.kernel != app_kernel) {
+        ++count;
+      }
+    }
+    return count;
+  }
+
+  uint32_t LaunchKernels(const std::vector<ze_event_handle_t>& events,
+                         ze_command_list_handle_t command_list = nullptr) {
+    MockZeDriver::Instance().Reset();
+    ze_group_count_t group_count = {1, 1, 1};
+    for (uint32_t i = 0; i < kCommands; ++i) {
+      ze_event_handle_t event = events.empty() ? nullptr : events[i];
+      EXPECT_EQ(zeCommandListAppendLaunchKernel(command_list ? command_list : command_list_, kernel_,
+                                                &group_count, event, 0, nullptr),
+                ZE_RESULT_SUCCESS);
+    }
+    auto commands = MockZeDriver::Instance().AppendedCommands();
+    return CountBridges(commands, MockZeCommand::kLaunchKernel, kernel_);
+  }
+
+  uint32_t AppendBarriers(const std::vector<ze_event_handle_t>& events) {
+    MockZeDriver::Instance().Reset();
+    for (uint32_t i = 0; i < kCommands; ++i) {
+      EXPECT_EQ(zeCommandListAppendBarrier(command_list_, events[i], 0, nullptr),
+                ZE_RESULT_SUCCESS);
+    }
+    // a bridge of a barrier is a barrier too, it is the one waiting on the collector event
+    uint32_t count = 0;
+    for (const auto& command : MockZeDriver::Instance().AppendedCommands()) {
+      if (command.command != MockZeCommand::kBarrier || command.num_wait_events != 0) {
+        ++count;
+      }
+    }
+    return count;
+  }
+
+  std::vector<ze_event_pool_handle_t> event_pools_;
+  std::vector<ze_event_handle_t> events_;
+  bool enabled_ = false;
+};
+
+TEST_F(LocalCollectionBridgeTest, NoBridgeWithoutSignalEvent) {
+  EXPECT_EQ(LaunchKernels({}), 0U);
+}
+
+TEST_F(LocalCollectionBridgeTest, NoBridgeForTimestampEvent) {
+  auto events = CreateEvents(kTimestampHostVisible);
+  EXPECT_EQ(LaunchKernels(events), 0U);
+  for (auto event : events) {
+    EXPECT_EQ(zeEventQueryStatus(event), ZE_RESULT_SUCCESS);
+  }
+}
+
+TEST_F(LocalCollectionBridgeTest, OneBridgePerNonTimestampEvent) {
+  auto events = CreateEvents(ZE_EVENT_POOL_FLAG_HOST_VISIBLE);
+  EXPECT_EQ(LaunchKernels(events), kCommands);
+
+  // the bridge kernels signal the application events in place of the kernels
+  const auto commands = MockZeDriver::Instance().AppendedCommands();
+  uint32_t bridges_signaling_app_events = 0;
+  for (const auto& command : commands) {
+    if (command.kernel != kernel_) {
+      EXPECT_EQ(command.num_wait_events, 1U);
+      for (auto event : events) {
+        bridges_signaling_app_events += (command.signal_event == event) ? 1 : 0;
+      }
+    } else {
+      for (auto event : events) {
+        EXPECT_NE(command.signal_event, event);
+      }
+    }
+  }
+  EXPECT_EQ(bridges_signaling_app_events, kCommands);
+  for (auto event : events) {
+    EXPECT_EQ(zeEventQueryStatus(event), ZE_RESULT_SUCCESS);
+  }
+}
+
+TEST_F(LocalCollectionBridgeTest, BridgeBarrierForNonTimestampEvent) {
+  EXPECT_EQ(AppendBarriers(CreateEvents(ZE_EVENT_POOL_FLAG_HOST_VISIBLE)), kCommands);
+  EXPECT_EQ(AppendBarriers(CreateEvents(kTimestampHostVisible)), 0U);
+}
+
+TEST_F(LocalCollectionBridgeTest, MixedEventsBridgeOnlyNonTimestampOnes) {
+  auto timestamp_events = CreateEvents(kTimestampHostVisible);
+  auto plain_events = CreateEvents(0);
+  std::vector<ze_event_handle_t> mixed;
+  for (uint32_t i = 0; i < kCommands; ++i) {
+    mixed.push_back((i % 2 == 0) ? timestamp_events[i] : plain_events[i]);
+  }
+  EXPECT_EQ(LaunchKernels(mixed), kCommands / 2);
+}
+
+// native binaries of the bridge kernel are built for the device and its sub-devices on enable,
+// so a bridge needed later in a context of the application is loaded, not compiled
+TEST_F(LocalCollectionBridgeTest, BridgeKernelsLoadedFromBinariesBuiltOnEnable) {
+  EXPECT_EQ(LaunchKernels(CreateEvents(ZE_EVENT_POOL_FLAG_HOST_VISIBLE)), kCommands);
+  MockZeDriverStats stats = MockZeDriver::Instance().Stats();
+  EXPECT_EQ(stats.modules_created, stats.native_modules_created);
+
+  uint32_t count = 0;
+  ASSERT_EQ(zeDeviceGetSubDevices(device_, &count, nullptr), ZE_RESULT_SUCCESS);
+  ASSERT_GT(count, 0U);
+  std::vector<ze_device_handle_t> sub_devices(count);
+  ASSERT_EQ(zeDeviceGetSubDevices(device_, &count, sub_devices.data()), ZE_RESULT_SUCCESS);
+
+  ze_command_list_handle_t sub_device_list = nullptr;
+  ASSERT_EQ(zeCommandListCreateImmediate(context_, sub_devices.back(), &kQueueDesc,
+                                         &sub_device_list),
+            ZE_RESULT_SUCCESS);
+  EXPECT_EQ(LaunchKernels(CreateEvents(ZE_EVENT_POOL_FLAG_HOST_VISIBLE), sub_device_list),
+            kCommands);
+  stats = MockZeDriver::Instance().Stats();
+  EXPECT_EQ(stats.modules_created, stats.native_modules_created);
+  EXPECT_GT(stats.modules_created, 0U);
+  EXPECT_EQ(zeCommandListDestroy(sub_device_list), ZE_RESULT_SUCCESS);
+}
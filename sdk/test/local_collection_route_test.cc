@@ -0,0 +1,51 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "ze_local_collection_helpers.h"
+
+namespace {
+
+constexpr ze_event_pool_flags_t kTimestampHostVisible =
+    ZE_EVENT_POOL_FLAG_KERNEL_TIMESTAMP | ZE_EVENT_POOL_FLAG_HOST_VISIBLE;
+
+}  // namespace
+
+class LocalCollectionRouteTest : public ::testing::Test {
+ protected:
+  void SetUp() override {}
+
+  void TearDown() override {}
+};
+
+TEST_F(LocalCollectionRouteTest, TimestampEventPoolRequiresTimestampAndHostVisible) {
+  EXPECT_TRUE(A2IsTimestampEventPool(kTimestampHostVisible));
+  EXPECT_TRUE(A2IsTimestampEventPool(kTimestampHostVisible | ZE_EVENT_POOL_FLAG_IPC));
+  EXPECT_FALSE(A2IsTimestampEventPool(ZE_EVENT_POOL_FLAG_KERNEL_TIMESTAMP));
+  EXPECT_FALSE(A2IsTimestampEventPool(ZE_EVENT_POOL_FLAG_HOST_VISIBLE));
+  EXPECT_FALSE(A2IsTimestampEventPool(0));
+}
+
+TEST_F(LocalCollectionRouteTest, NoSignalEventUsesCollectorEvent) {
+  EXPECT_EQ(A2SelectTimestampRoute(false, true, kTimestampHostVisible),
+            A2TimestampRoute::kCollectorEvent);
+  EXPECT_EQ(A2SelectTimestampRoute(false, false, 0), A2TimestampRoute::kCollectorEvent);
+}
+
+TEST_F(LocalCollectionRouteTest, TimestampAppEventIsQueriedDirectly) {
+  EXPECT_EQ(A2SelectTimestampRoute(true, true, kTimestampHostVisible),
+            A2TimestampRoute::kAppEvent);
+}
+
+TEST_F(LocalCollectionRouteTest, NonTimestampAppEventNeedsBridge) {
+  EXPECT_EQ(A2SelectTimestampRoute(true, true, 0), A2TimestampRoute::kBridge);
+  EXPECT_EQ(A2SelectTimestampRoute(true, true, ZE_EVENT_POOL_FLAG_HOST_VISIBLE),
+            A2TimestampRoute::kBridge);
+  EXPECT_EQ(A2SelectTimestampRoute(true, true, ZE_EVENT_POOL_FLAG_KERNEL_TIMESTAMP),
+            A2TimestampRoute::kBridge);
+}
+
+TEST_F(LocalCollectionRouteTest, UnknownPoolFlagsFallBackToBridge) {
+  // e.g. zeEventGetEventPool not available in the loader
+  EXPECT_EQ(A2SelectTimestampRoute(true, false, kTimestampHostVisible), A2TimestampRoute::kBridge);
+}
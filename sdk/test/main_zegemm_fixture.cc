@@ -10,6 +10,8 @@
 #include <math.h>
 #include <string.h>
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cstdlib>
 #include <iostream>
@@ -42,6 +44,45 @@ bool ze_tracing_enabled_env = true;
 bool capture_records = false;
 std::vector<pti_view_record_memory_copy> copy_records;
 std::vector<pti_view_record_kernel> kernel_records;
+std::vector<pti_view_record_host_sync> host_sync_records;
+std::vector<pti_view_record_kernel_info> kernel_info_records;
+std::vector<pti_view_record_kernel_args> kernel_args_records;
+
+// view records delivered to a client created by ptiClientCreate
+struct ClientRecordCounts {
+  std::atomic<size_t> kernel = 0;
+  std::atomic<size_t> memory_copy = 0;
+  std::atomic<size_t> other = 0;
+};
+ClientRecordCounts kernel_client_counts;
+ClientRecordCounts copy_client_counts;
+
+void ClientBufferRequested(unsigned char** buf, size_t* buf_size) {
+  *buf_size = 16 * sizeof(pti_view_record_kernel);
+  *buf = static_cast<unsigned char*>(::operator new(*buf_size));
+}
+
+void CountClientRecords(ClientRecordCounts& counts, unsigned char* buf, size_t used_bytes) {
+  pti_view_record_base* ptr = nullptr;
+  while (ptiViewGetNextRecord(buf, used_bytes, &ptr) == pti_result::PTI_SUCCESS) {
+    if (ptr->_view_kind == PTI_VIEW_DEVICE_GPU_KERNEL) {
+      counts.kernel++;
+    } else if (ptr->_view_kind == PTI_VIEW_DEVICE_GPU_MEM_COPY) {
+      counts.memory_copy++;
+    } else {
+      counts.other++;
+    }
+  }
+  ::operator delete(buf);
+}
+
+void KernelClientBufferCompleted(unsigned char* buf, size_t /*buf_size*/, size_t used_bytes) {
+  CountClientRecords(kernel_client_counts, buf, used_bytes);
+}
+
+void CopyClientBufferCompleted(unsigned char* buf, size_t /*buf_size*/, size_t used_bytes) {
+  CountClientRecords(copy_client_counts, buf, used_bytes);
+}
 
 float Check(const std::vector<float>& a, float value) {
   PTI_ASSERT(value > MAX_EPS);
@@ -481,6 +522,9 @@ class MainZeFixtureTest : public ::testing::Test {
     capture_records = false;
     copy_records.clear();
     kernel_records.clear();
+    host_sync_records.clear();
+    kernel_info_records.clear();
+    kernel_args_records.clear();
   }
 
   void TearDown() override {
@@ -552,6 +596,26 @@ class MainZeFixtureTest : public ::testing::Test {
           }
           break;
         }
+        case pti_view_kind::PTI_VIEW_HOST_SYNC: {
+          if (capture_records) {
+            host_sync_records.push_back(*reinterpret_cast<pti_view_record_host_sync*>(ptr));
+          }
+          break;
+        }
+        case pti_view_kind::PTI_VIEW_KERNEL_INFO: {
+          if (capture_records) {
+            // launch records refer to the kernel info record seen before them
+            EXPECT_EQ(kernel_records.size(), 0u);
+            kernel_info_records.push_back(*reinterpret_cast<pti_view_record_kernel_info*>(ptr));
+          }
+          break;
+        }
+        case pti_view_kind::PTI_VIEW_KERNEL_ARGS: {
+          if (capture_records) {
+            kernel_args_records.push_back(*reinterpret_cast<pti_view_record_kernel_args*>(ptr));
+          }
+          break;
+        }
         default: {
           std::cerr << "This shouldn't happen" << '\n';
           break;
@@ -738,6 +802,126 @@ TEST_F(MainZeFixtureTest, NumberOfExpectedKernelRecords) {
   EXPECT_EQ(kernel_view_record_count, 1 * repeat_count);
 }
 
+TEST_F(MainZeFixtureTest, HostSyncRecordLinkedToKernel) {
+  EXPECT_EQ(ptiViewSetCallbacks(BufferRequested, BufferCompleted), pti_result::PTI_SUCCESS);
+  capture_records = true;
+  ASSERT_EQ(ptiViewEnable(PTI_VIEW_HOST_SYNC), pti_result::PTI_SUCCESS);
+  RunGemm();
+  EXPECT_EQ(ptiViewDisable(PTI_VIEW_HOST_SYNC), pti_result::PTI_SUCCESS);
+  ASSERT_EQ(kernel_records.size(), 1 * repeat_count);
+
+  // Compute() waits on the queue the kernel and the memory copies were submitted to
+  bool kernel_found = false;
+  for (const auto& rec : host_sync_records) {
+    EXPECT_LE(rec._start_timestamp, rec._end_timestamp);
+    if (rec._sync_type != PTI_VIEW_HOST_SYNC_TYPE_COMMAND_QUEUE) {
+      continue;
+    }
+    EXPECT_GE(rec._completed_count, 4u);
+    EXPECT_NE(rec._correlation_id, 0u);
+    const auto* ids_end =
+        rec._completed_correlation_ids +
+        std::min<uint32_t>(rec._completed_count, PTI_MAX_HOST_SYNC_CORRELATION_IDS);
+    kernel_found = kernel_found || std::find(rec._completed_correlation_ids, ids_end,
+                                             kernel_records[0]._correlation_id) != ids_end;
+  }
+  EXPECT_EQ(kernel_found, true);
+}
+
+TEST_F(MainZeFixtureTest, KernelInfoRecordReferencedByLaunches) {
+  EXPECT_EQ(ptiViewSetCallbacks(BufferRequested, BufferCompleted), pti_result::PTI_SUCCESS);
+  capture_records = true;
+  ASSERT_EQ(ptiViewEnable(PTI_VIEW_KERNEL_INFO), pti_result::PTI_SUCCESS);
+  RunGemm();
+  EXPECT_EQ(ptiViewDisable(PTI_VIEW_KERNEL_INFO), pti_result::PTI_SUCCESS);
+  ASSERT_EQ(kernel_records.size(), 1 * repeat_count);
+
+  ASSERT_EQ(kernel_info_records.size(), 1u);
+  const auto& info = kernel_info_records[0];
+  EXPECT_NE(info._kernel_info_id, 0u);
+  EXPECT_STREQ(info._name, "GEMM");
+  EXPECT_GT(info._simd_width, 0u);
+  EXPECT_EQ(info._num_kernel_args, 4u);
+  for (const auto& rec : kernel_records) {
+    EXPECT_EQ(rec._kernel_info_id, info._kernel_info_id);
+    EXPECT_EQ(rec._name, info._name);
+    EXPECT_EQ(memcmp(rec._device_uuid, info._device_uuid, PTI_MAX_DEVICE_UUID_SIZE), 0);
+  }
+}
+
+TEST_F(MainZeFixtureTest, KernelArgsRecordReferencedByLaunches) {
+  EXPECT_EQ(ptiViewSetCallbacks(BufferRequested, BufferCompleted), pti_result::PTI_SUCCESS);
+  capture_records = true;
+  repeat_count = 3;
+  ASSERT_EQ(ptiViewEnable(PTI_VIEW_KERNEL_ARGS), pti_result::PTI_SUCCESS);
+  RunGemm();
+  EXPECT_EQ(ptiViewDisable(PTI_VIEW_KERNEL_ARGS), pti_result::PTI_SUCCESS);
+  ASSERT_EQ(kernel_records.size(), 1 * repeat_count);
+
+  // buffers are allocated again for every repeat, their addresses may be reused
+  ASSERT_GE(kernel_args_records.size(), 1u);
+  ASSERT_LE(kernel_args_records.size(), repeat_count);
+  for (const auto& args : kernel_args_records) {
+    EXPECT_NE(args._kernel_args_id, 0u);
+    ASSERT_EQ(args._arg_count, 4u);
+    for (uint32_t i = 0; i < 3; ++i) {
+      EXPECT_EQ(args._args[i]._index, i);
+      EXPECT_EQ(args._args[i]._type, PTI_KERNEL_ARG_TYPE_POINTER);
+      EXPECT_EQ(args._args[i]._memory_type, PTI_VIEW_MEMORY_TYPE_DEVICE);
+      EXPECT_NE(args._args[i]._value, 0u);
+    }
+    EXPECT_EQ(args._args[3]._type, PTI_KERNEL_ARG_TYPE_VALUE);
+    EXPECT_EQ(args._args[3]._size, sizeof(size));
+    EXPECT_EQ(args._args[3]._value, size);
+  }
+  for (const auto& rec : kernel_records) {
+    auto it = std::find_if(kernel_args_records.begin(), kernel_args_records.end(),
+                           [&rec](const auto& args) {
+                             return args._kernel_args_id == rec._kernel_args_id;
+                           });
+    EXPECT_NE(it, kernel_args_records.end());
+    EXPECT_EQ(it->_kernel_info_id, rec._kernel_info_id);
+  }
+}
+
+TEST_F(MainZeFixtureTest, ClientsGetTheirEnabledViewKinds) {
+  EXPECT_EQ(ptiViewSetCallbacks(BufferRequested, BufferCompleted), pti_result::PTI_SUCCESS);
+  capture_records = true;
+  kernel_client_counts.kernel = kernel_client_counts.memory_copy = kernel_client_counts.other = 0;
+  copy_client_counts.kernel = copy_client_counts.memory_copy = copy_client_counts.other = 0;
+
+  pti_client_handle kernel_client = nullptr;
+  pti_client_handle copy_client = nullptr;
+  ASSERT_EQ(ptiClientCreate(&kernel_client), pti_result::PTI_SUCCESS);
+  ASSERT_EQ(ptiClientCreate(&copy_client), pti_result::PTI_SUCCESS);
+  EXPECT_EQ(ptiClientEnable(kernel_client, PTI_VIEW_DEVICE_GPU_KERNEL),
+            pti_result::PTI_ERROR_NO_CALLBACKS_SET);
+  ASSERT_EQ(ptiClientSetCallbacks(kernel_client, ClientBufferRequested,
+                                  KernelClientBufferCompleted),
+            pti_result::PTI_SUCCESS);
+  ASSERT_EQ(ptiClientSetCallbacks(copy_client, ClientBufferRequested, CopyClientBufferCompleted),
+            pti_result::PTI_SUCCESS);
+  ASSERT_EQ(ptiClientEnable(kernel_client, PTI_VIEW_DEVICE_GPU_KERNEL), pti_result::PTI_SUCCESS);
+  ASSERT_EQ(ptiClientEnable(copy_client, PTI_VIEW_DEVICE_GPU_MEM_COPY), pti_result::PTI_SUCCESS);
+
+  RunGemm();
+
+  EXPECT_EQ(ptiClientFlushViews(kernel_client), pti_result::PTI_SUCCESS);
+  EXPECT_EQ(ptiClientDestroy(copy_client), pti_result::PTI_SUCCESS);
+  EXPECT_EQ(ptiClientEnable(copy_client, PTI_VIEW_DEVICE_GPU_KERNEL),
+            pti_result::PTI_ERROR_BAD_ARGUMENT);
+  EXPECT_EQ(ptiClientDestroy(kernel_client), pti_result::PTI_SUCCESS);
+
+  // the default client keeps getting all kinds it enabled
+  ASSERT_EQ(kernel_records.size(), 1 * repeat_count);
+  EXPECT_EQ(kernel_client_counts.kernel, kernel_records.size());
+  EXPECT_EQ(kernel_client_counts.memory_copy, 0u);
+  EXPECT_EQ(kernel_client_counts.other, 0u);
+  EXPECT_EQ(copy_client_counts.kernel, 0u);
+  EXPECT_EQ(copy_client_counts.memory_copy, copy_records.size());
+  EXPECT_EQ(copy_client_counts.other, 0u);
+}
+
 TEST_F(MainZeFixtureTest, RequestedAndCompletedBuffers) {
   EXPECT_EQ(ptiViewSetCallbacks(BufferRequested, BufferCompleted), pti_result::PTI_SUCCESS);
   RunGemm();
@@ -760,14 +944,18 @@ class GetNextRecordTestSuite : public ::testing::Test {
   static constexpr std::size_t kNumExtRecs = 100;
   static constexpr std::size_t kNumKernelRecs = 3;
   static constexpr std::size_t kNumOhRecs = 1;
-  static constexpr std::size_t kTotalRecs =
-      2 * kNumOhRecs + 2 * kNumMemRecs + kNumKernelRecs + kNumExtRecs;
+  static constexpr std::size_t kNumSyncRecs = 4;
+  static constexpr std::size_t kNumKernelInfoRecs = 2;
+  static constexpr std::size_t kTotalRecs = 2 * kNumOhRecs + 2 * kNumMemRecs + kNumKernelRecs +
+                                            kNumExtRecs + kNumSyncRecs + kNumKernelInfoRecs;
   GetNextRecordTestSuite()
       : test_buf_(CreateFullBuffer<RecordInserts<pti_view_record_overhead, kNumOhRecs>,
                                    RecordInserts<pti_view_record_memory_copy, kNumMemRecs>,
                                    RecordInserts<pti_view_record_memory_fill, kNumMemRecs>,
                                    RecordInserts<pti_view_record_external_correlation, kNumExtRecs>,
                                    RecordInserts<pti_view_record_kernel, kNumKernelRecs>,
+                                   RecordInserts<pti_view_record_host_sync, kNumSyncRecs>,
+                                   RecordInserts<pti_view_record_kernel_info, kNumKernelInfoRecs>,
                                    RecordInserts<pti_view_record_overhead, kNumOhRecs> >()) {}
   std::vector<unsigned char> test_buf_;
 };
@@ -818,6 +1006,8 @@ TEST_F(GetNextRecordTestSuite, RegularParseRecordsTest) {
   std::size_t number_of_memory_copies = 0;
   std::size_t number_of_kernel = 0;
   std::size_t number_of_overhead = 0;
+  std::size_t number_of_host_sync = 0;
+  std::size_t number_of_kernel_info = 0;
   while (true) {
     auto result = ptiViewGetNextRecord(test_buf_.data(), test_buf_.size(), &current_record);
     if (result == pti_result::PTI_STATUS_END_OF_BUFFER) {
@@ -839,10 +1029,18 @@ TEST_F(GetNextRecordTestSuite, RegularParseRecordsTest) {
     if (current_record->_view_kind == PTI_VIEW_COLLECTION_OVERHEAD) {
       number_of_overhead++;
     }
+    if (current_record->_view_kind == PTI_VIEW_HOST_SYNC) {
+      number_of_host_sync++;
+    }
+    if (current_record->_view_kind == PTI_VIEW_KERNEL_INFO) {
+      number_of_kernel_info++;
+    }
   }
   EXPECT_EQ(number_of_memory_copies, kNumMemRecs);
   EXPECT_EQ(number_of_overhead, 2 * kNumOhRecs);
   EXPECT_EQ(number_of_kernel, kNumKernelRecs);
+  EXPECT_EQ(number_of_host_sync, kNumSyncRecs);
+  EXPECT_EQ(number_of_kernel_info, kNumKernelInfoRecs);
   ASSERT_EQ(total_records, kTotalRecs);
 }
 
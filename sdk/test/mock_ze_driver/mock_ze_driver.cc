@@ -0,0 +1,1035 @@
+//==============================================================
+// Copyright (C) Intel Corporation
+//
+// SPDX-License-Identifier: MIT
+// =============================================================
+
+#include "mock_ze_driver.h"
+
+#include <level_zero/ze_ddi.h>
+
+#include <time.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr uint32_t kSubDeviceCount = 2;
+constexpr uint64_t kTimerFrequency = 1'000'000'000;  // device ticks are ns
+constexpr uint64_t kCommandDuration = 1000;          // in ticks
+constexpr size_t kMaxAppendedCommands = 4096;
+constexpr std::array<uint8_t, 8> kNativeBinary = {'M', 'O', 'C', 'K', 'Z', 'E', 0, 1};
+
+struct MockDevice {
+  uint32_t sub_device_id = 0;
+  bool is_sub_device = false;
+};
+
+struct MockContext {};
+
+struct MockEventPool {
+  ze_context_handle_t context = nullptr;
+  ze_event_pool_flags_t flags = 0;
+};
+
+struct MockEvent {
+  ze_event_pool_handle_t pool = nullptr;
+  bool signaled = false;
+  ze_kernel_timestamp_result_t timestamp = {};
+};
+
+struct MockCommand {
+  MockZeCommand command;
+  ze_event_handle_t signal_event;
+  std::vector<ze_event_handle_t> events;  // reset or queried by the command
+  void* destination;
+};
+
+struct MockCommandList {
+  ze_context_handle_t context = nullptr;
+  ze_device_handle_t device = nullptr;
+  bool immediate = false;
+  uint32_t ordinal = 0;
+  uint32_t index = 0;
+  std::vector<MockCommand> commands;  // regular command lists only
+};
+
+struct MockCommandQueue {
+  ze_device_handle_t device = nullptr;
+  uint32_t ordinal = 0;
+  uint32_t index = 0;
+};
+
+struct MockModule {};
+
+struct MockKernel {
+  std::string name;
+};
+
+struct MockAllocation {
+  ze_memory_type_t type;
+  ze_device_handle_t device;
+  uint64_t id;
+};
+
+struct MockDriverState {
+  std::mutex mutex;
+  MockDevice root_device;
+  std::array<MockDevice, kSubDeviceCount> sub_devices;
+  MockZeDriverStats stats = {};
+  std::deque<MockZeAppendedCommand> appended;
+  std::map<const void*, MockAllocation> allocations;
+  uint64_t next_allocation_id = 1;
+
+  MockDriverState() {
+    for (uint32_t i = 0; i < kSubDeviceCount; ++i) {
+      sub_devices[i].sub_device_id = i;
+      sub_devices[i].is_sub_device = true;
+    }
+  }
+};
+
+MockDriverState& State() {
+  static MockDriverState* state = new MockDriverState;  // outlives the loader teardown
+  return *state;
+}
+
+template <typename Handle, typename Object>
+Handle ToHandle(Object* object) {
+  return reinterpret_cast<Handle>(object);
+}
+
+template <typename Object, typename Handle>
+Object* FromHandle(Handle handle) {
+  return reinterpret_cast<Object*>(handle);
+}
+
+ze_driver_handle_t DriverHandle() {
+  static int driver = 0;
+  return reinterpret_cast<ze_driver_handle_t>(&driver);
+}
+
+ze_device_handle_t RootDeviceHandle() {
+  return ToHandle<ze_device_handle_t>(&State().root_device);
+}
+
+// device ticks are of the host clock the collector converts them to
+uint64_t Now() {
+  timespec ts = {};
+  clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * kTimerFrequency + ts.tv_nsec;
+}
+
+// caller holds the state mutex
+void Signal(ze_event_handle_t event) {
+  if (event == nullptr) {
+    return;
+  }
+  auto* mock_event = FromHandle<MockEvent>(event);
+  uint64_t start = Now();
+  mock_event->signaled = true;
+  mock_event->timestamp.global = {start, start + kCommandDuration};
+  mock_event->timestamp.context = {start, start + kCommandDuration};
+}
+
+// caller holds the state mutex
+void Execute(const MockCommand& command) {
+  switch (command.command) {
+    case MockZeCommand::kEventReset:
+      for (auto* event : command.events) {
+        FromHandle<MockEvent>(event)->signaled = false;
+      }
+      break;
+    case MockZeCommand::kQueryKernelTimestamps: {
+      auto* destination = static_cast<ze_kernel_timestamp_result_t*>(command.destination);
+      for (size_t i = 0; i < command.events.size(); ++i) {
+        destination[i] = FromHandle<MockEvent>(command.events[i])->timestamp;
+      }
+      break;
+    }
+    default:
+      break;
+  }
+  Signal(command.signal_event);
+}
+
+ze_result_t Append(ze_command_list_handle_t command_list, MockCommand command,
+                   ze_kernel_handle_t kernel, uint32_t num_wait_events) {
+  if (command_list == nullptr) {
+    return ZE_RESULT_ERROR_INVALID_NULL_HANDLE;
+  }
+  auto& state = State();
+  const std::lock_guard<std::mutex> lock(state.mutex);
+  state.appended.push_back(
+      {command.command, command_list, kernel, command.signal_event, num_wait_events});
+  if (state.appended.size() > kMaxAppendedCommands) {
+    state.appended.pop_front();
+  }
+  ++state.stats.commands_appended;
+
+  auto* mock_command_list = FromHandle<MockCommandList>(command_list);
+  if (mock_command_list->immediate) {
+    Execute(command);
+  } else {
+    mock_command_list->commands.push_back(std::move(command));
+  }
+  return ZE_RESULT_SUCCESS;
+}
+
+// Global
+
+ze_result_t ZE_APICALL MockInit(ze_init_flags_t flags) {
+  if (flags != 0 && !(flags & ZE_INIT_FLAG_GPU_ONLY)) {
+    return ZE_RESULT_ERROR_UNINITIALIZED;
+  }
+  return ZE_RESULT_SUCCESS;
+}
+
+// Driver
+
+ze_result_t ZE_APICALL MockDriverGet(uint32_t* count, ze_driver_handle_t* drivers) {
+  if (count == nullptr) {
+    return ZE_RESULT_ERROR_INVALID_NULL_POINTER;
+  }
+  if (drivers != nullptr && *count > 0) {
+    drivers[0] = DriverHandle();
+  }
+  *count = 1;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t ZE_APICALL MockDriverGetApiVersion(ze_driver_handle_t /*driver*/,
+                                               ze_api_version_t* version) {
+  *version = ZE_API_VERSION_CURRENT;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t ZE_APICALL MockDriverGetProperties(ze_driver_handle_t /*driver*/,
+                                               ze_driver_properties_t* properties) {
+  std::memset(properties->uuid.id, 0, ZE_MAX_DRIVER_UUID_SIZE);
+  properties->uuid.id[0] = 0x4d;
+  properties->driverVersion = 0x01030000;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t ZE_APICALL MockDriverGetIpcProperties(ze_driver_handle_t /*driver*/,
+                                                  ze_driver_ipc_properties_t* properties) {
+  properties->flags = 0;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t ZE_APICALL
+MockDriverGetExtensionProperties(ze_driver_handle_t /*driver*/, uint32_t* count,
+                                 ze_driver_extension_properties_t* /*properties*/) {
+  *count = 0;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t ZE_APICALL MockDriverGetExtensionFunctionAddress(ze_driver_handle_t /*driver*/,
+                                                             const char* /*name*/,
+                                                             void** function) {
+  *function = nullptr;
+  return ZE_RESULT_ERROR_INVALID_ARGUMENT;
+}
+
+// Device
+
+ze_result_t ZE_APICALL MockDeviceGet(ze_driver_handle_t /*driver*/, uint32_t* count,
+                                     ze_device_handle_t* devices) {
+  if (devices != nullptr && *count > 0) {
+    devices[0] = RootDeviceHandle();
+  }
+  *count = 1;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t ZE_APICALL MockDeviceGetSubDevices(ze_device_handle_t device, uint32_t* count,
+                                               ze_device_handle_t* sub_devices) {
+  auto& state = State();
+  if (FromHandle<MockDevice>(device)->is_sub_device) {
+    *count = 0;
+    return ZE_RESULT_SUCCESS;
+  }
+  if (sub_devices != nullptr) {
+    *count = std::min(*count, kSubDeviceCount);
+    for (uint32_t i = 0; i < *count; ++i) {
+      sub_devices[i] = ToHandle<ze_device_handle_t>(&state.sub_devices[i]);
+    }
+    return ZE_RESULT_SUCCESS;
+  }
+  *count = kSubDeviceCount;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t ZE_APICALL MockDeviceGetProperties(ze_device_handle_t device,
+                                               ze_device_properties_t* properties) {
+  auto* mock_device = FromHandle<MockDevice>(device);
+  properties->type = ZE_DEVICE_TYPE_GPU;
+  properties->vendorId = 0x8086;
+  properties->deviceId = 0x0bd5;
+  properties->flags = ZE_DEVICE_PROPERTY_FLAG_INTEGRATED;
+  if (mock_device->is_sub_device) {
+    properties->flags |= ZE_DEVICE_PROPERTY_FLAG_SUBDEVICE;
+  }
+  properties->subdeviceId = mock_device->sub_device_id;
+  properties->coreClockRate = 1600;
+  properties->maxMemAllocSize = 1ULL << 32;
+  properties->maxHardwareContexts = 1024;
+  properties->maxCommandQueuePriority = 0;
+  properties->numThreadsPerEU = 8;
+  properties->physicalEUSimdWidth = 16;
+  properties->numEUsPerSubslice = 8;
+  properties->numSubslicesPerSlice = 8;
+  properties->numSlices = 1;
+  // ticks per second with the 1.2 properties, ns per tick before
+  properties->timerResolution =
+      (properties->stype == ZE_STRUCTURE_TYPE_DEVICE_PROPERTIES_1_2) ? kTimerFrequency : 1;
+  properties->timestampValidBits = 64;
+  properties->kernelTimestampValidBits = 64;
+  std::memset(properties->uuid.id, 0, ZE_MAX_DEVICE_UUID_SIZE);
+  properties->uuid.id[0] = 0x4d;
+  properties->uuid.id[1] = static_cast<uint8_t>(mock_device->is_sub_device ? 1 : 0);
+  properties->uuid.id[2] = static_cast<uint8_t>(mock_device->sub_device_id);
+  std::snprintf(properties->name, ZE_MAX_DEVICE_NAME, "Mock GPU%s",
+                mock_device->is_sub_device ? " Tile" : "");
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t ZE_APICALL MockDeviceGetCommandQueueGroupProperties(
+    ze_device_handle_t /*device*/, uint32_t* count,
+    ze_command_queue_group_properties_t* properties) {
+  if (properties != nullptr && *count > 0) {
+    properties[0].flags = ZE_COMMAND_QUEUE_GROUP_PROPERTY_FLAG_COMPUTE |
+                          ZE_COMMAND_QUEUE_GROUP_PROPERTY_FLAG_COPY;
+    properties[0].maxMemoryFillPatternSize = 128;
+    properties[0].numQueues = 4;
+  }
+  *count = 1;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t ZE_APICALL MockDeviceCanAccessPeer(ze_device_handle_t /*device*/,
+                                               ze_device_handle_t /*peer_device*/,
+                                               ze_bool_t* value) {
+  *value = true;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t ZE_APICALL MockDeviceGetGlobalTimestamps(ze_device_handle_t /*device*/,
+                                                     uint64_t* host_timestamp,
+                                                     uint64_t* device_timestamp) {
+  *host_timestamp = Now();
+  *device_timestamp = *host_timestamp;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t ZE_APICALL MockDevicePciGetPropertiesExt(ze_device_handle_t /*device*/,
+                                                     ze_pci_ext_properties_t* properties) {
+  properties->address = {0, 3, 0, 0};
+  properties->maxSpeed = {-1, -1, -1};
+  return ZE_RESULT_SUCCESS;
+}
+
+// Context
+
+ze_result_t ZE_APICALL MockContextCreate(ze_driver_handle_t /*driver*/,
+                                         const ze_context_desc_t* /*desc*/,
+                                         ze_context_handle_t* context) {
+  *context = ToHandle<ze_context_handle_t>(new MockContext);
+  auto& state = State();
+  const std::lock_guard<std::mutex> lock(state.mutex);
+  ++state.stats.contexts_created;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t ZE_APICALL MockContextDestroy(ze_context_handle_t context) {
+  delete FromHandle<MockContext>(context);
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t ZE_APICALL MockContextGetStatus(ze_context_handle_t /*context*/) {
+  return ZE_RESULT_SUCCESS;
+}
+
+// Command queue
+
+ze_result_t ZE_APICALL MockCommandQueueCreate(ze_context_handle_t /*context*/,
+                                              ze_device_handle_t device,
+                                              const ze_command_queue_desc_t* desc,
+                                              ze_command_queue_handle_t* command_queue) {
+  *command_queue = ToHandle<ze_command_queue_handle_t>(
+      new MockCommandQueue{device, desc->ordinal, desc->index});
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t ZE_APICALL MockCommandQueueDestroy(ze_command_queue_handle_t command_queue) {
+  delete FromHandle<MockCommandQueue>(command_queue);
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t ZE_APICALL MockCommandQueueExecuteCommandLists(
+    ze_command_queue_handle_t /*command_queue*/, uint32_t num_command_lists,
+    ze_command_list_handle_t* command_lists, ze_fence_handle_t /*fence*/) {
+  auto& state = State();
+  const std::lock_guard<std::mutex> lock(state.mutex);
+  for (uint32_t i = 0; i < num_command_lists; ++i) {
+    for (const auto& command : FromHandle<MockCommandList>(command_lists[i])->commands) {
+      Execute(command);
+    }
+  }
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t ZE_APICALL MockCommandQueueSynchronize(ze_command_queue_handle_t /*command_queue*/,
+                                                   uint64_t /*timeout*/) {
+  return ZE_RESULT_SUCCESS;
+}
+
+// Command list
+
+ze_result_t ZE_APICALL MockCommandListCreate(ze_context_handle_t context,
+                                             ze_device_handle_t device,
+                                             const ze_command_list_desc_t* desc,
+                                             ze_command_list_handle_t* command_list) {
+  auto* mock_command_list = new MockCommandList;
+  mock_command_list->context = context;
+  mock_command_list->device = device;
+  mock_command_list->ordinal = desc->commandQueueGroupOrdinal;
+  *command_list = ToHandle<ze_command_list_handle_t>(mock_command_list);
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t ZE_APICALL MockCommandListCreateImmediate(ze_context_handle_t context,
+                                                      ze_device_handle_t device,
+                                                      const ze_command_queue_desc_t* desc,
+                                                      ze_command_list_handle_t* command_list) {
+  auto* mock_command_list = new MockCommandList;
+  mock_command_list->context = context;
+  mock_command_list->device = device;
+  mock_command_list->immediate = true;
+  mock_command_list->ordinal = desc->ordinal;
+  mock_command_list->index = desc->index;
+  *command_list = ToHandle<ze_command_list_handle_t>(mock_command_list);
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t ZE_APICALL MockCommandListDestroy(ze_command_list_handle_t command_list) {
+  delete FromHandle<MockCommandList>(command_list);
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t ZE_APICALL MockCommandListClose(ze_command_list_handle_t /*command_list*/) {
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t ZE_APICALL MockCommandListReset(ze_command_list_handle_t command_list) {
+  auto& state = State();
+  const std::lock_guard<std::mutex> lock(state.mutex);
+  FromHandle<MockCommandList>(command_list)->commands.clear();
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t ZE_APICALL MockCommandListAppendBarrier(ze_command_list_handle_t command_list,
+                                                    ze_event_handle_t signal_event,
+                                                    uint32_t num_wait_events,
+                                                    ze_event_handle_t* /*wait_events*/) {
+  return Append(command_list, {MockZeCommand::kBarrier, signal_event, {}, nullptr}, nullptr,
+                num_wait_events);
+}
+
+ze_result_t ZE_APICALL MockCommandListAppendMemoryCopy(ze_command_list_handle_t command_list,
+                                                       void* destination, const void* source,
+                                                       size_t size,
+                                                       ze_event_handle_t signal_event,
+                                                       uint32_t num_wait_events,
+                                                       ze_event_handle_t* /*wait_events*/) {
+  // all allocations of the mock are host memory
+  if (destination != nullptr && source != nullptr && size > 0) {
+    std::memmove(destination, source, size);
+  }
+  return Append(command_list, {MockZeCommand::kMemoryCopy, signal_event, {}, nullptr}, nullptr,
+                num_wait_events);
+}
+
+ze_result_t ZE_APICALL MockCommandListAppendMemoryFill(ze_command_list_handle_t command_list,
+                                                       void* /*ptr*/, const void* /*pattern*/,
+                                                       size_t /*pattern_size*/, size_t /*size*/,
+                                                       ze_event_handle_t signal_event,
+                                                       uint32_t num_wait_events,
+                                                       ze_event_handle_t* /*wait_events*/) {
+  return Append(command_list, {MockZeCommand::kMemoryFill, signal_event, {}, nullptr}, nullptr,
+                num_wait_events);
+}
+
+ze_result_t ZE_APICALL MockCommandListAppendSignalEvent(ze_command_list_handle_t command_list,
+                                                        ze_event_handle_t event) {
+  return Append(command_list, {MockZeCommand::kSignalEvent, event, {}, nullptr}, nullptr, 0);
+}
+
+ze_result_t ZE_APICALL MockCommandListAppendWaitOnEvents(ze_command_list_handle_t command_list,
+                                                         uint32_t num_events,
+                                                         ze_event_handle_t* /*events*/) {
+  return Append(command_list, {MockZeCommand::kWaitOnEvents, nullptr, {}, nullptr}, nullptr,
+                num_events);
+}
+
+ze_result_t ZE_APICALL MockCommandListAppendEventReset(ze_command_list_handle_t command_list,
+                                                       ze_event_handle_t event) {
+  return Append(command_list, {MockZeCommand::kEventReset, nullptr, {event}, nullptr}, nullptr,
+                0);
+}
+
+ze_result_t ZE_APICALL MockCommandListAppendQueryKernelTimestamps(
+    ze_command_list_handle_t command_list, uint32_t num_events, ze_event_handle_t* events,
+    void* destination, const size_t* /*offsets*/, ze_event_handle_t signal_event,
+    uint32_t num_wait_events, ze_event_handle_t* /*wait_events*/) {
+  return Append(command_list,
+                {MockZeCommand::kQueryKernelTimestamps, signal_event,
+                 std::vector<ze_event_handle_t>(events, events + num_events), destination},
+                nullptr, num_wait_events);
+}
+
+ze_result_t ZE_APICALL MockCommandListAppendLaunchKernel(ze_command_list_handle_t command_list,
+                                                         ze_kernel_handle_t kernel,
+                                                         const ze_group_count_t* /*group_count*/,
+                                                         ze_event_handle_t signal_event,
+                                                         uint32_t num_wait_events,
+                                                         ze_event_handle_t* /*wait_events*/) {
+  return Append(command_list, {MockZeCommand::kLaunchKernel, signal_event, {}, nullptr}, kernel,
+                num_wait_events);
+}
+
+ze_result_t ZE_APICALL MockCommandListHostSynchronize(ze_command_list_handle_t /*command_list*/,
+                                                      uint64_t /*timeout*/) {
+  return ZE_RESULT_SUCCESS;
+}
+
+// Event pool and event
+
+ze_result_t ZE_APICALL MockEventPoolCreate(ze_context_handle_t context,
+                                           const ze_event_pool_desc_t* desc,
+                                           uint32_t /*num_devices*/,
+                                           ze_device_handle_t* /*devices*/,
+                                           ze_event_pool_handle_t* event_pool) {
+  *event_pool = ToHandle<ze_event_pool_handle_t>(new MockEventPool{context, desc->flags});
+  auto& state = State();
+  const std::lock_guard<std::mutex> lock(state.mutex);
+  ++state.stats.event_pools_created;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t ZE_APICALL MockEventPoolDestroy(ze_event_pool_handle_t event_pool) {
+  delete FromHandle<MockEventPool>(event_pool);
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t ZE_APICALL MockEventCreate(ze_event_pool_handle_t event_pool,
+                                       const ze_event_desc_t* /*desc*/,
+                                       ze_event_handle_t* event) {
+  auto* mock_event = new MockEvent;
+  mock_event->pool = event_pool;
+  *event = ToHandle<ze_event_handle_t>(mock_event);
+  auto& state = State();
+  const std::lock_guard<std::mutex> lock(state.mutex);
+  ++state.stats.events_created;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t ZE_APICALL MockEventDestroy(ze_event_handle_t event) {
+  delete FromHandle<MockEvent>(event);
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t ZE_APICALL MockEventHostSignal(ze_event_handle_t event) {
+  auto& state = State();
+  const std::lock_guard<std::mutex> lock(state.mutex);
+  Signal(event);
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t ZE_APICALL MockEventQueryStatus(ze_event_handle_t event) {
+  auto& state = State();
+  const std::lock_guard<std::mutex> lock(state.mutex);
+  return FromHandle<MockEvent>(event)->signaled ? ZE_RESULT_SUCCESS : ZE_RESULT_NOT_READY;
+}
+
+ze_result_t ZE_APICALL MockEventHostSynchronize(ze_event_handle_t event, uint64_t /*timeout*/) {
+  // commands complete at append or execute, so an event not signaled by then never is
+  return MockEventQueryStatus(event);
+}
+
+ze_result_t ZE_APICALL MockEventHostReset(ze_event_handle_t event) {
+  auto& state = State();
+  const std::lock_guard<std::mutex> lock(state.mutex);
+  FromHandle<MockEvent>(event)->signaled = false;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t ZE_APICALL MockEventQueryKernelTimestamp(ze_event_handle_t event,
+                                                     ze_kernel_timestamp_result_t* timestamp) {
+  auto& state = State();
+  const std::lock_guard<std::mutex> lock(state.mutex);
+  auto* mock_event = FromHandle<MockEvent>(event);
+  if (!mock_event->signaled) {
+    return ZE_RESULT_NOT_READY;
+  }
+  *timestamp = mock_event->timestamp;
+  return ZE_RESULT_SUCCESS;
+}
+
+// Fence
+
+ze_result_t ZE_APICALL MockFenceCreate(ze_command_queue_handle_t /*command_queue*/,
+                                       const ze_fence_desc_t* /*desc*/, ze_fence_handle_t* fence) {
+  static int fences = 0;
+  *fence = reinterpret_cast<ze_fence_handle_t>(&fences);
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t ZE_APICALL MockFenceDestroy(ze_fence_handle_t /*fence*/) { return ZE_RESULT_SUCCESS; }
+
+ze_result_t ZE_APICALL MockFenceHostSynchronize(ze_fence_handle_t /*fence*/,
+                                                uint64_t /*timeout*/) {
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t ZE_APICALL MockFenceQueryStatus(ze_fence_handle_t /*fence*/) {
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t ZE_APICALL MockFenceReset(ze_fence_handle_t /*fence*/) { return ZE_RESULT_SUCCESS; }
+
+// Module and kernel
+
+ze_result_t ZE_APICALL MockModuleCreate(ze_context_handle_t /*context*/,
+                                        ze_device_handle_t /*device*/,
+                                        const ze_module_desc_t* desc, ze_module_handle_t* module,
+                                        ze_module_build_log_handle_t* build_log) {
+  if (build_log != nullptr) {
+    *build_log = nullptr;
+  }
+  if (desc->format == ZE_MODULE_FORMAT_NATIVE &&
+      (desc->inputSize != kNativeBinary.size() ||
+       std::memcmp(desc->pInputModule, kNativeBinary.data(), kNativeBinary.size()) != 0)) {
+    return ZE_RESULT_ERROR_INVALID_NATIVE_BINARY;
+  }
+  *module = ToHandle<ze_module_handle_t>(new MockModule);
+  auto& state = State();
+  const std::lock_guard<std::mutex> lock(state.mutex);
+  ++state.stats.modules_created;
+  if (desc->format == ZE_MODULE_FORMAT_NATIVE) {
+    ++state.stats.native_modules_created;
+  }
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t ZE_APICALL MockModuleDestroy(ze_module_handle_t module) {
+  delete FromHandle<MockModule>(module);
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t ZE_APICALL MockModuleGetNativeBinary(ze_module_handle_t /*module*/, size_t* size,
+                                                 uint8_t* native_binary) {
+  if (native_binary != nullptr) {
+    std::copy_n(kNativeBinary.begin(), std::min(*size, kNativeBinary.size()), native_binary);
+  }
+  *size = kNativeBinary.size();
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t ZE_APICALL MockKernelCreate(ze_module_handle_t /*module*/,
+                                        const ze_kernel_desc_t* desc, ze_kernel_handle_t* kernel) {
+  *kernel = ToHandle<ze_kernel_handle_t>(new MockKernel{desc->pKernelName});
+  auto& state = State();
+  const std::lock_guard<std::mutex> lock(state.mutex);
+  ++state.stats.kernels_created;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t ZE_APICALL MockKernelDestroy(ze_kernel_handle_t kernel) {
+  delete FromHandle<MockKernel>(kernel);
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t ZE_APICALL MockKernelSetGroupSize(ze_kernel_handle_t /*kernel*/, uint32_t /*x*/,
+                                              uint32_t /*y*/, uint32_t /*z*/) {
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t ZE_APICALL MockKernelSuggestGroupSize(ze_kernel_handle_t /*kernel*/,
+                                                  uint32_t /*global_x*/, uint32_t /*global_y*/,
+                                                  uint32_t /*global_z*/, uint32_t* x, uint32_t* y,
+                                                  uint32_t* z) {
+  *x = 1;
+  *y = 1;
+  *z = 1;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t ZE_APICALL MockKernelSetArgumentValue(ze_kernel_handle_t /*kernel*/,
+                                                  uint32_t /*index*/, size_t /*size*/,
+                                                  const void* /*value*/) {
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t ZE_APICALL MockKernelGetProperties(ze_kernel_handle_t /*kernel*/,
+                                               ze_kernel_properties_t* properties) {
+  properties->numKernelArgs = 0;
+  properties->requiredGroupSizeX = 0;
+  properties->requiredGroupSizeY = 0;
+  properties->requiredGroupSizeZ = 0;
+  properties->requiredNumSubGroups = 0;
+  properties->requiredSubgroupSize = 0;
+  properties->maxSubgroupSize = 16;
+  properties->maxNumSubgroups = 64;
+  properties->localMemSize = 0;
+  properties->privateMemSize = 0;
+  properties->spillMemSize = 0;
+  std::memset(&properties->uuid, 0, sizeof(properties->uuid));
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t ZE_APICALL MockKernelGetName(ze_kernel_handle_t kernel, size_t* size, char* name) {
+  const std::string& kernel_name = FromHandle<MockKernel>(kernel)->name;
+  if (name != nullptr) {
+    size_t length = std::min(*size, kernel_name.size() + 1);
+    std::copy_n(kernel_name.c_str(), length, name);
+  }
+  *size = kernel_name.size() + 1;
+  return ZE_RESULT_SUCCESS;
+}
+
+// Memory
+
+ze_result_t AllocateMemory(size_t size, size_t alignment, ze_memory_type_t type,
+                           ze_device_handle_t device, void** ptr) {
+  alignment = std::max<size_t>(alignment, 64);
+  size = (size + alignment - 1) / alignment * alignment;
+  *ptr = std::aligned_alloc(alignment, size);
+  if (*ptr == nullptr) {
+    return ZE_RESULT_ERROR_OUT_OF_HOST_MEMORY;
+  }
+  auto& state = State();
+  const std::lock_guard<std::mutex> lock(state.mutex);
+  state.allocations[*ptr] = {type, device, state.next_allocation_id++};
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t ZE_APICALL MockMemAllocShared(ze_context_handle_t /*context*/,
+                                          const ze_device_mem_alloc_desc_t* /*device_desc*/,
+                                          const ze_host_mem_alloc_desc_t* /*host_desc*/,
+                                          size_t size, size_t alignment, ze_device_handle_t device,
+                                          void** ptr) {
+  return AllocateMemory(size, alignment, ZE_MEMORY_TYPE_SHARED, device, ptr);
+}
+
+ze_result_t ZE_APICALL MockMemAllocDevice(ze_context_handle_t /*context*/,
+                                          const ze_device_mem_alloc_desc_t* /*device_desc*/,
+                                          size_t size, size_t alignment, ze_device_handle_t device,
+                                          void** ptr) {
+  return AllocateMemory(size, alignment, ZE_MEMORY_TYPE_DEVICE, device, ptr);
+}
+
+ze_result_t ZE_APICALL MockMemAllocHost(ze_context_handle_t /*context*/,
+                                        const ze_host_mem_alloc_desc_t* /*host_desc*/, size_t size,
+                                        size_t alignment, void** ptr) {
+  return AllocateMemory(size, alignment, ZE_MEMORY_TYPE_HOST, nullptr, ptr);
+}
+
+ze_result_t ZE_APICALL MockMemFree(ze_context_handle_t /*context*/, void* ptr) {
+  auto& state = State();
+  const std::lock_guard<std::mutex> lock(state.mutex);
+  if (state.allocations.erase(ptr) == 0) {
+    return ZE_RESULT_ERROR_INVALID_ARGUMENT;
+  }
+  std::free(ptr);
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t ZE_APICALL MockMemGetAllocProperties(ze_context_handle_t /*context*/, const void* ptr,
+                                                 ze_memory_allocation_properties_t* properties,
+                                                 ze_device_handle_t* device) {
+  auto& state = State();
+  const std::lock_guard<std::mutex> lock(state.mutex);
+  auto it = state.allocations.find(ptr);
+  if (it == state.allocations.end()) {
+    properties->type = ZE_MEMORY_TYPE_UNKNOWN;
+    properties->id = 0;
+    properties->pageSize = 0;
+    if (device != nullptr) {
+      *device = nullptr;
+    }
+    return ZE_RESULT_SUCCESS;
+  }
+  properties->type = it->second.type;
+  properties->id = it->second.id;
+  properties->pageSize = 4096;
+  if (device != nullptr) {
+    *device = it->second.device;
+  }
+  return ZE_RESULT_SUCCESS;
+}
+
+bool IsSupportedVersion(ze_api_version_t version) {
+  return ZE_MAJOR_VERSION(version) == ZE_MAJOR_VERSION(ZE_API_VERSION_CURRENT);
+}
+
+}  // namespace
+
+// Tables the loader takes the driver entry points from, entries left null are unsupported
+
+extern "C" {
+
+ZE_DLLEXPORT ze_result_t ZE_APICALL zeGetGlobalProcAddrTable(ze_api_version_t version,
+                                                             ze_global_dditable_t* table) {
+  if (!IsSupportedVersion(version)) {
+    return ZE_RESULT_ERROR_UNSUPPORTED_VERSION;
+  }
+  table->pfnInit = MockInit;
+  return ZE_RESULT_SUCCESS;
+}
+
+ZE_DLLEXPORT ze_result_t ZE_APICALL zeGetDriverProcAddrTable(ze_api_version_t version,
+                                                             ze_driver_dditable_t* table) {
+  if (!IsSupportedVersion(version)) {
+    return ZE_RESULT_ERROR_UNSUPPORTED_VERSION;
+  }
+  table->pfnGet = MockDriverGet;
+  table->pfnGetApiVersion = MockDriverGetApiVersion;
+  table->pfnGetProperties = MockDriverGetProperties;
+  table->pfnGetIpcProperties = MockDriverGetIpcProperties;
+  table->pfnGetExtensionProperties = MockDriverGetExtensionProperties;
+  table->pfnGetExtensionFunctionAddress = MockDriverGetExtensionFunctionAddress;
+  return ZE_RESULT_SUCCESS;
+}
+
+ZE_DLLEXPORT ze_result_t ZE_APICALL zeGetDeviceProcAddrTable(ze_api_version_t version,
+                                                             ze_device_dditable_t* table) {
+  if (!IsSupportedVersion(version)) {
+    return ZE_RESULT_ERROR_UNSUPPORTED_VERSION;
+  }
+  table->pfnGet = MockDeviceGet;
+  table->pfnGetSubDevices = MockDeviceGetSubDevices;
+  table->pfnGetProperties = MockDeviceGetProperties;
+  table->pfnGetCommandQueueGroupProperties = MockDeviceGetCommandQueueGroupProperties;
+  table->pfnCanAccessPeer = MockDeviceCanAccessPeer;
+  table->pfnGetGlobalTimestamps = MockDeviceGetGlobalTimestamps;
+  table->pfnPciGetPropertiesExt = MockDevicePciGetPropertiesExt;
+  return ZE_RESULT_SUCCESS;
+}
+
+ZE_DLLEXPORT ze_result_t ZE_APICALL zeGetContextProcAddrTable(ze_api_version_t version,
+                                                              ze_context_dditable_t* table) {
+  if (!IsSupportedVersion(version)) {
+    return ZE_RESULT_ERROR_UNSUPPORTED_VERSION;
+  }
+  table->pfnCreate = MockContextCreate;
+  table->pfnDestroy = MockContextDestroy;
+  table->pfnGetStatus = MockContextGetStatus;
+  return ZE_RESULT_SUCCESS;
+}
+
+ZE_DLLEXPORT ze_result_t ZE_APICALL
+zeGetCommandQueueProcAddrTable(ze_api_version_t version, ze_command_queue_dditable_t* table) {
+  if (!IsSupportedVersion(version)) {
+    return ZE_RESULT_ERROR_UNSUPPORTED_VERSION;
+  }
+  table->pfnCreate = MockCommandQueueCreate;
+  table->pfnDestroy = MockCommandQueueDestroy;
+  table->pfnExecuteCommandLists = MockCommandQueueExecuteCommandLists;
+  table->pfnSynchronize = MockCommandQueueSynchronize;
+  return ZE_RESULT_SUCCESS;
+}
+
+ZE_DLLEXPORT ze_result_t ZE_APICALL
+zeGetCommandListProcAddrTable(ze_api_version_t version, ze_command_list_dditable_t* table) {
+  if (!IsSupportedVersion(version)) {
+    return ZE_RESULT_ERROR_UNSUPPORTED_VERSION;
+  }
+  table->pfnCreate = MockCommandListCreate;
+  table->pfnCreateImmediate = MockCommandListCreateImmediate;
+  table->pfnDestroy = MockCommandListDestroy;
+  table->pfnClose = MockCommandListClose;
+  table->pfnReset = MockCommandListReset;
+  table->pfnAppendBarrier = MockCommandListAppendBarrier;
+  table->pfnAppendMemoryCopy = MockCommandListAppendMemoryCopy;
+  table->pfnAppendMemoryFill = MockCommandListAppendMemoryFill;
+  table->pfnAppendSignalEvent = MockCommandListAppendSignalEvent;
+  table->pfnAppendWaitOnEvents = MockCommandListAppendWaitOnEvents;
+  table->pfnAppendEventReset = MockCommandListAppendEventReset;
+  table->pfnAppendQueryKernelTimestamps = MockCommandListAppendQueryKernelTimestamps;
+  table->pfnAppendLaunchKernel = MockCommandListAppendLaunchKernel;
+  table->pfnHostSynchronize = MockCommandListHostSynchronize;
+  return ZE_RESULT_SUCCESS;
+}
+
+ZE_DLLEXPORT ze_result_t ZE_APICALL zeGetEventPoolProcAddrTable(ze_api_version_t version,
+                                                                ze_event_pool_dditable_t* table) {
+  if (!IsSupportedVersion(version)) {
+    return ZE_RESULT_ERROR_UNSUPPORTED_VERSION;
+  }
+  table->pfnCreate = MockEventPoolCreate;
+  table->pfnDestroy = MockEventPoolDestroy;
+  return ZE_RESULT_SUCCESS;
+}
+
+ZE_DLLEXPORT ze_result_t ZE_APICALL zeGetEventProcAddrTable(ze_api_version_t version,
+                                                            ze_event_dditable_t* table) {
+  if (!IsSupportedVersion(version)) {
+    return ZE_RESULT_ERROR_UNSUPPORTED_VERSION;
+  }
+  table->pfnCreate = MockEventCreate;
+  table->pfnDestroy = MockEventDestroy;
+  table->pfnHostSignal = MockEventHostSignal;
+  table->pfnHostSynchronize = MockEventHostSynchronize;
+  table->pfnQueryStatus = MockEventQueryStatus;
+  table->pfnHostReset = MockEventHostReset;
+  table->pfnQueryKernelTimestamp = MockEventQueryKernelTimestamp;
+  return ZE_RESULT_SUCCESS;
+}
+
+ZE_DLLEXPORT ze_result_t ZE_APICALL zeGetFenceProcAddrTable(ze_api_version_t version,
+                                                            ze_fence_dditable_t* table) {
+  if (!IsSupportedVersion(version)) {
+    return ZE_RESULT_ERROR_UNSUPPORTED_VERSION;
+  }
+  table->pfnCreate = MockFenceCreate;
+  table->pfnDestroy = MockFenceDestroy;
+  table->pfnHostSynchronize = MockFenceHostSynchronize;
+  table->pfnQueryStatus = MockFenceQueryStatus;
+  table->pfnReset = MockFenceReset;
+  return ZE_RESULT_SUCCESS;
+}
+
+ZE_DLLEXPORT ze_result_t ZE_APICALL zeGetModuleProcAddrTable(ze_api_version_t version,
+                                                             ze_module_dditable_t* table) {
+  if (!IsSupportedVersion(version)) {
+    return ZE_RESULT_ERROR_UNSUPPORTED_VERSION;
+  }
+  table->pfnCreate = MockModuleCreate;
+  table->pfnDestroy = MockModuleDestroy;
+  table->pfnGetNativeBinary = MockModuleGetNativeBinary;
+  return ZE_RESULT_SUCCESS;
+}
+
+ZE_DLLEXPORT ze_result_t ZE_APICALL zeGetKernelProcAddrTable(ze_api_version_t version,
+                                                             ze_kernel_dditable_t* table) {
+  if (!IsSupportedVersion(version)) {
+    return ZE_RESULT_ERROR_UNSUPPORTED_VERSION;
+  }
+  table->pfnCreate = MockKernelCreate;
+  table->pfnDestroy = MockKernelDestroy;
+  table->pfnSetGroupSize = MockKernelSetGroupSize;
+  table->pfnSuggestGroupSize = MockKernelSuggestGroupSize;
+  table->pfnSetArgumentValue = MockKernelSetArgumentValue;
+  table->pfnGetProperties = MockKernelGetProperties;
+  table->pfnGetName = MockKernelGetName;
+  return ZE_RESULT_SUCCESS;
+}
+
+ZE_DLLEXPORT ze_result_t ZE_APICALL zeGetMemProcAddrTable(ze_api_version_t version,
+                                                          ze_mem_dditable_t* table) {
+  if (!IsSupportedVersion(version)) {
+    return ZE_RESULT_ERROR_UNSUPPORTED_VERSION;
+  }
+  table->pfnAllocShared = MockMemAllocShared;
+  table->pfnAllocDevice = MockMemAllocDevice;
+  table->pfnAllocHost = MockMemAllocHost;
+  table->pfnFree = MockMemFree;
+  table->pfnGetAllocProperties = MockMemGetAllocProperties;
+  return ZE_RESULT_SUCCESS;
+}
+
+// Introspection APIs, the collector takes them from the driver library with dlsym
+
+ZE_APIEXPORT ze_result_t ZE_APICALL zeEventPoolGetFlags(ze_event_pool_handle_t event_pool,
+                                                        ze_event_pool_flags_t* flags) {
+  *flags = FromHandle<MockEventPool>(event_pool)->flags;
+  return ZE_RESULT_SUCCESS;
+}
+
+ZE_APIEXPORT ze_result_t ZE_APICALL zeEventGetEventPool(ze_event_handle_t event,
+                                                        ze_event_pool_handle_t* event_pool) {
+  *event_pool = FromHandle<MockEvent>(event)->pool;
+  return ZE_RESULT_SUCCESS;
+}
+
+ZE_APIEXPORT ze_result_t ZE_APICALL zeCommandListGetDeviceHandle(
+    ze_command_list_handle_t command_list, ze_device_handle_t* device) {
+  *device = FromHandle<MockCommandList>(command_list)->device;
+  return ZE_RESULT_SUCCESS;
+}
+
+ZE_APIEXPORT ze_result_t ZE_APICALL zeCommandListGetContextHandle(
+    ze_command_list_handle_t command_list, ze_context_handle_t* context) {
+  *context = FromHandle<MockCommandList>(command_list)->context;
+  return ZE_RESULT_SUCCESS;
+}
+
+ZE_APIEXPORT ze_result_t ZE_APICALL zeCommandListGetOrdinal(ze_command_list_handle_t command_list,
+                                                            uint32_t* ordinal) {
+  *ordinal = FromHandle<MockCommandList>(command_list)->ordinal;
+  return ZE_RESULT_SUCCESS;
+}
+
+ZE_APIEXPORT ze_result_t ZE_APICALL
+zeCommandListImmediateGetIndex(ze_command_list_handle_t command_list, uint32_t* index) {
+  auto* mock_command_list = FromHandle<MockCommandList>(command_list);
+  if (!mock_command_list->immediate) {
+    return ZE_RESULT_ERROR_INVALID_ARGUMENT;
+  }
+  *index = mock_command_list->index;
+  return ZE_RESULT_SUCCESS;
+}
+
+ZE_APIEXPORT ze_result_t ZE_APICALL zeCommandListIsImmediate(ze_command_list_handle_t command_list,
+                                                             ze_bool_t* immediate) {
+  *immediate = FromHandle<MockCommandList>(command_list)->immediate;
+  return ZE_RESULT_SUCCESS;
+}
+
+ZE_APIEXPORT ze_result_t ZE_APICALL zeCommandQueueGetOrdinal(
+    ze_command_queue_handle_t command_queue, uint32_t* ordinal) {
+  *ordinal = FromHandle<MockCommandQueue>(command_queue)->ordinal;
+  return ZE_RESULT_SUCCESS;
+}
+
+ZE_APIEXPORT ze_result_t ZE_APICALL zeCommandQueueGetIndex(ze_command_queue_handle_t command_queue,
+                                                           uint32_t* index) {
+  *index = FromHandle<MockCommandQueue>(command_queue)->index;
+  return ZE_RESULT_SUCCESS;
+}
+
+// Test access
+
+MOCK_ZE_DRIVER_EXPORT void mockZeDriverGetAppendedCommands(MockZeAppendedCommand* commands,
+                                                           uint32_t* count) {
+  auto& state = State();
+  const std::lock_guard<std::mutex> lock(state.mutex);
+  *count = std::min<uint32_t>(*count, static_cast<uint32_t>(state.appended.size()));
+  std::copy_n(state.appended.end() - *count, *count, commands);
+}
+
+MOCK_ZE_DRIVER_EXPORT void mockZeDriverGetStats(MockZeDriverStats* stats) {
+  auto& state = State();
+  const std::lock_guard<std::mutex> lock(state.mutex);
+  *stats = state.stats;
+}
+
+MOCK_ZE_DRIVER_EXPORT void mockZeDriverReset() {
+  auto& state = State();
+  const std::lock_guard<std::mutex> lock(state.mutex);
+  state.appended.clear();
+  state.stats = {};
+}
+
+}  // extern "C"
@@ -0,0 +1,128 @@
+//==============================================================
+// Copyright (C) Intel Corporation
+//
+// SPDX-License-Identifier: MIT
+// =============================================================
+
+#ifndef PTI_TEST_MOCK_ZE_DRIVER_H_
+#define PTI_TEST_MOCK_ZE_DRIVER_H_
+
+/*
+ * Mock Level Zero driver for tests of the collector without a GPU.
+ *
+ * The library is built as libze_intel_gpu.so.1 and loaded by the real loader when
+ * ZE_ENABLE_ALT_DRIVERS points to it, so calls of a test go through the loader and the
+ * tracing layer to the driver as they do with a real GPU. The driver has one GPU device with
+ * two sub-devices, executes immediate command lists at append and regular ones at execute,
+ * and exports the introspection APIs the collector looks up in libze_intel_gpu.so.1.
+ *
+ * Tests read what reached the driver with the functions below, resolved with dlsym as the
+ * driver is loaded by the loader, not linked to the test.
+ */
+
+#include <level_zero/ze_api.h>
+
+#include <cstdint>
+
+#if defined(_WIN32)
+#define MOCK_ZE_DRIVER_EXPORT __declspec(dllexport)
+#else
+#include <dlfcn.h>
+#define MOCK_ZE_DRIVER_EXPORT __attribute__((visibility("default")))
+#endif
+
+enum class MockZeCommand : uint32_t {
+  kLaunchKernel = 0,
+  kBarrier = 1,
+  kMemoryCopy = 2,
+  kMemoryFill = 3,
+  kSignalEvent = 4,
+  kWaitOnEvents = 5,
+  kEventReset = 6,
+  kQueryKernelTimestamps = 7,
+};
+
+// A command appended to a command list as the driver received it
+struct MockZeAppendedCommand {
+  MockZeCommand command;
+  ze_command_list_handle_t command_list;
+  ze_kernel_handle_t kernel;  // nullptr for commands other than kernel launches
+  ze_event_handle_t signal_event;
+  uint32_t num_wait_events;
+};
+
+struct MockZeDriverStats {
+  uint32_t contexts_created;
+  uint32_t event_pools_created;
+  uint32_t events_created;
+  uint32_t modules_created;
+  uint32_t native_modules_created;  // of the modules created, the ones from native binaries
+  uint32_t kernels_created;
+  uint32_t commands_appended;
+};
+
+extern "C" {
+// Copies up to *count last appended commands, *count is set to the number copied
+MOCK_ZE_DRIVER_EXPORT void mockZeDriverGetAppendedCommands(MockZeAppendedCommand* commands,
+                                                           uint32_t* count);
+MOCK_ZE_DRIVER_EXPORT void mockZeDriverGetStats(MockZeDriverStats* stats);
+// Forgets appended commands and zeroes the stats, objects created stay valid
+MOCK_ZE_DRIVER_EXPORT void mockZeDriverReset();
+}
+
+#if !defined(_WIN32)
+
+#include <vector>
+
+// Access to the mock driver from a test, valid once the loader loaded the driver (zeInit)
+class MockZeDriver {
+ public:
+  static MockZeDriver& Instance() {
+    static MockZeDriver driver;
+    return driver;
+  }
+
+  bool IsLoaded() const { return get_commands_ != nullptr; }
+
+  std::vector<MockZeAppendedCommand> AppendedCommands() const {
+    uint32_t count = kMaxCommands;
+    std::vector<MockZeAppendedCommand> commands(count);
+    get_commands_(commands.data(), &count);
+    commands.resize(count);
+    return commands;
+  }
+
+  MockZeDriverStats Stats() const {
+    MockZeDriverStats stats = {};
+    get_stats_(&stats);
+    return stats;
+  }
+
+  void Reset() const { reset_(); }
+
+ private:
+  static constexpr uint32_t kMaxCommands = 4096;
+
+  MockZeDriver() {
+    // the loader opened the driver already, so it is found by its soname
+    void* handle = dlopen("libze_intel_gpu.so.1", RTLD_NOW | RTLD_NOLOAD);
+    if (handle == nullptr) {
+      return;
+    }
+    get_commands_ = reinterpret_cast<decltype(get_commands_)>(
+        dlsym(handle, "mockZeDriverGetAppendedCommands"));
+    get_stats_ = reinterpret_cast<decltype(get_stats_)>(dlsym(handle, "mockZeDriverGetStats"));
+    reset_ = reinterpret_cast<decltype(reset_)>(dlsym(handle, "mockZeDriverReset"));
+    if (get_stats_ == nullptr || reset_ == nullptr) {
+      get_commands_ = nullptr;  // a real driver, not the mock
+    }
+  }
+
+  void (*get_commands_)(MockZeAppendedCommand*, uint32_t*) = nullptr;
+  void (*get_stats_)(MockZeDriverStats*) = nullptr;
+  void (*reset_)() = nullptr;
+};
+
+#endif
+
+#endif  // PTI_TEST_MOCK_ZE_DRIVER_H_
@@ -0,0 +1,217 @@
+#include <gtest/gtest.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "utils.h"
+
+namespace {
+
+constexpr uint64_t kMaxDriftNs = 2000;
+constexpr int kBenchmarkIterations = 1000000;
+
+// Distance of the clock from CLOCK_MONOTONIC_RAW, 0 if within the two raw readings around it
+int64_t GetDrift(utils::TscClock& clock) {
+  uint64_t before = utils::TscClock::GetRawTime();
+  uint64_t time = clock.GetTime();
+  uint64_t after = utils::TscClock::GetRawTime();
+  if (time < before) {
+    return -static_cast<int64_t>(before - time);
+  }
+  if (time > after) {
+    return static_cast<int64_t>(time - after);
+  }
+  return 0;
+}
+
+template <typename F>
+double GetNsPerCall(F&& func) {
+  uint64_t sum = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < kBenchmarkIterations; ++i) {
+    sum += func();
+  }
+  auto end = std::chrono::steady_clock::now();
+  EXPECT_NE(sum, 0ULL);
+  return std::chrono::duration<double, std::nano>(end - start).count() / kBenchmarkIterations;
+}
+
+}  // namespace
+
+TEST(TscClockTest, FollowsMonotonicRawClock) {
+  utils::TscClock& clock = utils::TscClock::Instance();
+  std::cout << "TSC is " << (clock.IsTscUsed() ? "used" : "not used") << std::endl;
+
+  int64_t max_drift = 0;
+  for (int i = 0; i < 100; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    int64_t drift = GetDrift(clock);
+    if (std::abs(drift) > std::abs(max_drift)) {
+      max_drift = drift;
+    }
+  }
+  std::cout << "Max drift: " << max_drift << " ns" << std::endl;
+  EXPECT_LE(static_cast<uint64_t>(std::abs(max_drift)), kMaxDriftNs);
+}
+
+TEST(TscClockTest, NeverGoesBackInThread) {
+  utils::TscClock& clock = utils::TscClock::Instance();
+  uint64_t end = utils::TscClock::GetRawTime() + 300 * NSEC_IN_MSEC;
+  uint64_t previous = clock.GetTime();
+  uint64_t now = previous;
+  while (now < end) {
+    now = clock.GetTime();
+    ASSERT_GE(now, previous);
+    previous = now;
+  }
+}
+
+TEST(TscClockTest, NeverGoesBackInThreads) {
+  constexpr int kThreadCount = 4;
+  std::vector<bool> monotonic(kThreadCount, false);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kThreadCount; ++i) {
+    threads.emplace_back([&monotonic, i]() {
+      uint64_t end = utils::TscClock::GetRawTime() + 200 * NSEC_IN_MSEC;
+      uint64_t previous = utils::GetTime();
+      uint64_t now = previous;
+      while (now < end) {
+        now = utils::GetTime();
+        if (now < previous) {
+          return;
+        }
+        previous = now;
+      }
+      monotonic[i] = true;
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (int i = 0; i < kThreadCount; ++i) {
+    EXPECT_TRUE(monotonic[i]) << "thread " << i;
+  }
+}
+
+// a reading that happens after a reading of another thread is not below it
+TEST(TscClockTest, NeverGoesBackAcrossThreads) {
+  constexpr int kThreadCount = 4;
+  std::atomic<uint64_t> latest{0};
+  std::vector<bool> monotonic(kThreadCount, false);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kThreadCount; ++i) {
+    threads.emplace_back([&latest, &monotonic, i]() {
+      uint64_t end = utils::TscClock::GetRawTime() + 200 * NSEC_IN_MSEC;
+      uint64_t now = 0;
+      while (now < end) {
+        uint64_t seen = latest.load(std::memory_order_acquire);
+        now = utils::GetTime();
+        if (now < seen) {
+          return;
+        }
+        latest.store(now, std::memory_order_release);
+      }
+      monotonic[i] = true;
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (int i = 0; i < kThreadCount; ++i) {
+    EXPECT_TRUE(monotonic[i]) << "thread " << i;
+  }
+}
+
+// forked while other threads refresh the anchor, the child keeps refreshing it
+TEST(TscClockTest, FollowsMonotonicRawClockInForkedChild) {
+  utils::TscClock& clock = utils::TscClock::Instance();
+  std::atomic<bool> stop{false};
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([&clock, &stop]() {
+      while (!stop.load(std::memory_order_relaxed)) {
+        clock.GetTime();
+      }
+    });
+  }
+
+  std::vector<pid_t> children;
+  for (int i = 0; i < 10; ++i) {
+    pid_t pid = fork();
+    if (pid == 0) {
+      // longer than the longest window, the anchor is refreshed at least once
+      uint64_t end = utils::TscClock::GetRawTime() + 250 * NSEC_IN_MSEC;
+      uint64_t previous = clock.GetTime();
+      while (previous < end) {
+        uint64_t now = clock.GetTime();
+        if (now < previous) {
+          _exit(1);
+        }
+        previous = now;
+      }
+      _exit(std::abs(GetDrift(clock)) <= static_cast<int64_t>(kMaxDriftNs) ? 0 : 2);
+    }
+    if (pid != -1) {
+      children.push_back(pid);
+    }
+  }
+  stop = true;
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_EQ(children.size(), 10U);
+  for (pid_t pid : children) {
+    int status = 0;
+    ASSERT_EQ(waitpid(pid, &status, 0), pid);
+    ASSERT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(WEXITSTATUS(status), 0);
+  }
+}
+
+TEST(TscClockTest, CachedTidMatchesThread) {
+  uint32_t main_tid = utils::GetTid();
+  EXPECT_EQ(main_tid, static_cast<uint32_t>(syscall(SYS_gettid)));
+  EXPECT_EQ(main_tid, utils::GetTid());
+
+  uint32_t thread_tid = 0;
+  std::thread thread([&thread_tid]() { thread_tid = utils::GetTid(); });
+  thread.join();
+  EXPECT_NE(thread_tid, 0U);
+  EXPECT_NE(thread_tid, main_tid);
+}
+
+TEST(TscClockTest, CachedTidIsResetInForkedChild) {
+  uint32_t parent_tid = utils::GetTid();
+  pid_t pid = fork();
+  ASSERT_NE(pid, -1);
+  if (pid == 0) {
+    bool reset = utils::GetTid() == static_cast<uint32_t>(syscall(SYS_gettid)) &&
+                 utils::GetTid() != parent_tid;
+    _exit(reset ? 0 : 1);
+  }
+  int status = 0;
+  ASSERT_EQ(waitpid(pid, &status, 0), pid);
+  ASSERT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(WEXITSTATUS(status), 0);
+}
+
+TEST(TscClockTest, Benchmark) {
+  utils::TscClock& clock = utils::TscClock::Instance();
+  double tsc_ns = GetNsPerCall([&clock]() { return clock.GetTime(); });
+  double raw_ns = GetNsPerCall([]() { return utils::TscClock::GetRawTime(); });
+  double tid_ns = GetNsPerCall([]() { return utils::GetTid(); });
+  double gettid_ns = GetNsPerCall([]() { return static_cast<uint32_t>(syscall(SYS_gettid)); });
+  std::cout << "TscClock::GetTime: " << tsc_ns << " ns, CLOCK_MONOTONIC_RAW: " << raw_ns
+            << " ns" << std::endl;
+  std::cout << "GetTid: " << tid_ns << " ns, SYS_gettid: " << gettid_ns << " ns" << std::endl;
+  EXPECT_LT(tid_ns, gettid_ns);
+}
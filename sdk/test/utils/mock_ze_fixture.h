@@ -0,0 +1,120 @@
+#ifndef TEST_UTILS_MOCK_ZE_FIXTURE_H_
+#define TEST_UTILS_MOCK_ZE_FIXTURE_H_
+
+#include <gtest/gtest.h>
+#include <level_zero/ze_api.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "mock_ze_driver.h"
+
+namespace pti::test::utils::level_zero {
+
+// Fixture of the tests running on the mock driver (see mock_ze_driver.h). It holds the objects
+// of the application: the driver and its device, a context, an immediate command list and the
+// kernel "app_kernel" of a module. A test sets up the collector first, as that initializes Level
+// Zero, skips if the mock driver is not loaded, then creates the objects with CreateAppObjects.
+class MockZeDriverTest : public ::testing::Test {
+ protected:
+  static constexpr ze_command_queue_desc_t kQueueDesc = {ZE_STRUCTURE_TYPE_COMMAND_QUEUE_DESC,
+                                                         nullptr,
+                                                         0,
+                                                         0,
+                                                         0,
+                                                         ZE_COMMAND_QUEUE_MODE_ASYNCHRONOUS,
+                                                         ZE_COMMAND_QUEUE_PRIORITY_NORMAL};
+
+  // call with ASSERT_NO_FATAL_FAILURE
+  void CreateAppObjects() {
+    uint32_t count = 1;
+    ASSERT_EQ(zeDriverGet(&count, &driver_), ZE_RESULT_SUCCESS);
+    count = 1;
+    ASSERT_EQ(zeDeviceGet(driver_, &count, &device_), ZE_RESULT_SUCCESS);
+
+    ze_context_desc_t context_desc = {ZE_STRUCTURE_TYPE_CONTEXT_DESC, nullptr, 0};
+    ASSERT_EQ(zeContextCreate(driver_, &context_desc, &context_), ZE_RESULT_SUCCESS);
+
+    ASSERT_EQ(zeCommandListCreateImmediate(context_, device_, &kQueueDesc, &command_list_),
+              ZE_RESULT_SUCCESS);
+
+    const uint8_t il[] = {0x03, 0x02, 0x23, 0x07};
+    ze_module_desc_t module_desc = {ZE_STRUCTURE_TYPE_MODULE_DESC,
+                                    nullptr,
+                                    ZE_MODULE_FORMAT_IL_SPIRV,
+                                    sizeof(il),
+                                    il,
+                                    nullptr,
+                                    nullptr};
+    ASSERT_EQ(zeModuleCreate(context_, device_, &module_desc, &module_, nullptr),
+              ZE_RESULT_SUCCESS);
+    ze_kernel_desc_t kernel_desc = {ZE_STRUCTURE_TYPE_KERNEL_DESC, nullptr, 0, "app_kernel"};
+    ASSERT_EQ(zeKernelCreate(module_, &kernel_desc, &kernel_), ZE_RESULT_SUCCESS);
+  }
+
+  // destroys whatever CreateAppObjects and CreateImmediateCommandList created
+  void DestroyAppObjects() {
+    if (kernel_ != nullptr) {
+      zeKernelDestroy(kernel_);
+    }
+    if (module_ != nullptr) {
+      zeModuleDestroy(module_);
+    }
+    for (auto command_list : other_command_lists_) {
+      zeCommandListDestroy(command_list);
+    }
+    if (command_list_ != nullptr) {
+      zeCommandListDestroy(command_list_);
+    }
+    if (context_ != nullptr) {
+      zeContextDestroy(context_);
+    }
+  }
+
+  // another immediate command list of the context, destroyed with the application objects
+  ze_command_list_handle_t CreateImmediateCommandList() {
+    ze_command_list_handle_t command_list = nullptr;
+    EXPECT_EQ(zeCommandListCreateImmediate(context_, device_, &kQueueDesc, &command_list),
+              ZE_RESULT_SUCCESS);
+    if (command_list != nullptr) {
+      other_command_lists_.push_back(command_list);
+    }
+    return command_list;
+  }
+
+  // true if the collector replaced the missing signal event of a launch of the kernel with its
+  // own, nothing but the launch itself reaches the driver otherwise
+  bool LaunchInjectsEvent(ze_command_list_handle_t command_list) {
+    MockZeDriver::Instance().Reset();
+    ze_group_count_t group_count = {1, 1, 1};
+    EXPECT_EQ(zeCommandListAppendLaunchKernel(command_list, kernel_, &group_count, nullptr, 0,
+                                              nullptr),
+              ZE_RESULT_SUCCESS);
+    const auto commands = MockZeDriver::Instance().AppendedCommands();
+    for (const auto& command : commands) {
+      if (command.command == MockZeCommand::kLaunchKernel && command.kernel == kernel_) {
+        bool injected = (command.signal_event != nullptr);
+        if (!injected) {
+          EXPECT_EQ(commands.size(), 1U);
+        }
+        return injected;
+      }
+    }
+    ADD_FAILURE() << "Kernel launch did not reach the driver";
+    return false;
+  }
+
+  ze_driver_handle_t driver_ = nullptr;
+  ze_device_handle_t device_ = nullptr;
+  ze_context_handle_t context_ = nullptr;
+  ze_command_list_handle_t command_list_ = nullptr;
+  ze_module_handle_t module_ = nullptr;
+  ze_kernel_handle_t kernel_ = nullptr;
+
+ private:
+  std::vector<ze_command_list_handle_t> other_command_lists_;
+};
+
+}  // namespace pti::test::utils::level_zero
+
+#endif  // TEST_UTILS_MOCK_ZE_FIXTURE_H_
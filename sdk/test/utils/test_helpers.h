@@ -86,6 +86,16 @@ inline pti_view_record_external_correlation CreateRecord() {
                       pti_view_kind::PTI_VIEW_EXTERNAL_CORRELATION>();
 }
 
+template <>
+inline pti_view_record_host_sync CreateRecord() {
+  return CreateRecord<pti_view_record_host_sync, pti_view_kind::PTI_VIEW_HOST_SYNC>();
+}
+
+template <>
+inline pti_view_record_kernel_info CreateRecord() {
+  return CreateRecord<pti_view_record_kernel_info, pti_view_kind::PTI_VIEW_KERNEL_INFO>();
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 /// @brief Helper functions for creating buffers based on view record type.
 template <typename T, std::size_t N>
@@ -2,8 +2,13 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <array>
+#include <chrono>
 #include <cstring>
+#include <functional>
+#include <memory>
+#include <numeric>
 #include <thread>
 #include <vector>
 
@@ -228,3 +233,235 @@ TEST(GuardedUnorderedMapTest, ForEach) {
   ASSERT_EQ(table[101], ",");
   ASSERT_EQ(table[102], "hello");
 }
+
+namespace {
+
+using TimedBufferSlot = pti::view::utilities::ViewBufferSlot;
+using pti::view::utilities::FlushDueNotAfter;
+
+uint64_t NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Delivered records, on the consumer thread only
+struct TimedRecordSink {
+  void Deliver(pti::view::utilities::ViewBuffer&& buffer) {
+    const auto* records = reinterpret_cast<const uint64_t*>(buffer.GetBuffer());
+    for (std::size_t i = 0; i < buffer.GetValidBytes() / sizeof(uint64_t); ++i) {
+      sum += records[i];
+      ++count;
+    }
+    delete[] buffer.GetBuffer();
+  }
+
+  uint64_t sum = 0;
+  std::size_t count = 0;
+};
+
+// Producer of a thread: records are insertion times, full buffers go to the consumer thread
+struct TimedRecordProducer {
+  static constexpr std::size_t kRecordsInBuffer = 64;
+
+  // Returns the inserted record
+  uint64_t Insert(pti::view::BufferConsumer& consumer, TimedRecordSink& sink) {
+    slot.Acquire(TimedBufferSlot::kProducer);
+    if (slot.buffer.IsNull()) {
+      slot.buffer.Refresh(new unsigned char[kRecordsInBuffer * sizeof(uint64_t)],
+                          kRecordsInBuffer * sizeof(uint64_t));
+    }
+    const uint64_t now = NowNs();
+    slot.Insert(now, now);
+    if (slot.buffer.FreeBytes() >= sizeof(uint64_t)) {
+      slot.Release();
+      return now;
+    }
+    auto full_buffer = slot.TakeBuffer();
+    slot.Release();
+    consumer.PushAndForget([&sink, buffer = std::move(full_buffer)]() mutable {
+      sink.Deliver(std::move(buffer));
+    });
+    return now;
+  }
+
+  TimedBufferSlot slot;
+};
+
+// As the flush policy timer of the record handler
+void SetFlushTimer(pti::view::BufferConsumer& consumer,
+                   std::vector<std::unique_ptr<TimedRecordProducer>>& producers,
+                   TimedRecordSink& sink, std::chrono::milliseconds max_latency,
+                   std::chrono::milliseconds period, std::size_t min_fill) {
+  const uint64_t max_latency_ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(max_latency).count();
+  const uint64_t period_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(period).count();
+  consumer.SetTimer(period, [&producers, &sink, max_latency_ns, period_ns, min_fill]() {
+    const uint64_t not_after = FlushDueNotAfter(NowNs(), period_ns, max_latency_ns);
+    for (auto& producer : producers) {
+      auto buffer = producer->slot.TakeIfDue(not_after, min_fill);
+      if (!buffer.IsNull()) {
+        sink.Deliver(std::move(buffer));
+      }
+    }
+  });
+}
+
+void FlushAll(pti::view::BufferConsumer& consumer,
+              std::vector<std::unique_ptr<TimedRecordProducer>>& producers,
+              TimedRecordSink& sink) {
+  consumer.SetTimer(std::chrono::milliseconds{0}, nullptr);
+  consumer
+      .Push([&producers, &sink]() {
+        for (auto& producer : producers) {
+          auto buffer = producer->slot.Take();
+          if (!buffer.IsNull()) {
+            sink.Deliver(std::move(buffer));
+          }
+        }
+      })
+      .wait();
+}
+
+}  // namespace
+
+TEST(ViewBufferSlotTest, InsertNotesFirstRecordTime) {
+  std::array<unsigned char, 4 * sizeof(uint64_t)> storage = {};
+  TimedBufferSlot slot;
+  slot.buffer.Refresh(storage.data(), storage.size());
+
+  slot.Insert(uint64_t{1}, 100);
+  slot.Insert(uint64_t{2}, 200);
+  EXPECT_EQ(slot.first_record_time, 100ULL);
+  EXPECT_EQ(slot.buffer.GetValidBytes(), 2 * sizeof(uint64_t));
+
+  auto taken = slot.TakeBuffer();
+  EXPECT_EQ(taken.GetValidBytes(), 2 * sizeof(uint64_t));
+  EXPECT_EQ(slot.first_record_time, 0ULL);
+  slot.buffer.Refresh(storage.data(), storage.size());
+  slot.Insert(uint64_t{3}, 300);
+  EXPECT_EQ(slot.first_record_time, 300ULL);
+}
+
+TEST(ViewBufferSlotTest, TakeIfDue) {
+  std::array<unsigned char, 4 * sizeof(uint64_t)> storage = {};
+  TimedBufferSlot slot;
+  slot.buffer.Refresh(storage.data(), storage.size());
+
+  // no record
+  EXPECT_TRUE(slot.TakeIfDue(UINT64_MAX, 0).IsNull());
+
+  slot.Acquire(TimedBufferSlot::kProducer);
+  slot.Insert(uint64_t{1}, 100);
+  // held by the producer
+  EXPECT_TRUE(slot.TakeIfDue(UINT64_MAX, 0).IsNull());
+  slot.Release();
+
+  // too recent, too small
+  EXPECT_TRUE(slot.TakeIfDue(99, 0).IsNull());
+  EXPECT_TRUE(slot.TakeIfDue(100, 2 * sizeof(uint64_t)).IsNull());
+
+  auto taken = slot.TakeIfDue(100, sizeof(uint64_t));
+  ASSERT_FALSE(taken.IsNull());
+  EXPECT_EQ(taken.GetBuffer(), storage.data());
+  EXPECT_EQ(taken.GetValidBytes(), sizeof(uint64_t));
+  EXPECT_TRUE(slot.buffer.IsNull());
+  EXPECT_EQ(slot.first_record_time, 0ULL);
+  EXPECT_TRUE(slot.Take().IsNull());
+}
+
+TEST(ViewBufferSlotTest, FlushDueNotAfterNothingDueAtStart) {
+  EXPECT_EQ(FlushDueNotAfter(0, 5, 20), 0ULL);
+  EXPECT_EQ(FlushDueNotAfter(15, 5, 20), 0ULL);
+  EXPECT_EQ(FlushDueNotAfter(16, 5, 20), 1ULL);
+}
+
+TEST(ViewBufferSlotTest, FlushChecksTakeBufferWithinLatency) {
+  constexpr uint64_t kMaxLatency = 20000;
+  constexpr uint64_t kPeriod = kMaxLatency / 4;
+  constexpr uint64_t kFirstRecord = 1000003;
+
+  std::array<unsigned char, 4 * sizeof(uint64_t)> storage = {};
+  TimedBufferSlot slot;
+  slot.buffer.Refresh(storage.data(), storage.size());
+  slot.Insert(uint64_t{1}, kFirstRecord);
+  slot.Insert(uint64_t{2}, kFirstRecord + kMaxLatency / 2);
+
+  // checks every period from before the first record on, wherever the record falls between them
+  uint64_t check = kFirstRecord - kFirstRecord % kPeriod;
+  for (; check < kFirstRecord + kMaxLatency; check += kPeriod) {
+    auto taken = slot.TakeIfDue(FlushDueNotAfter(check, kPeriod, kMaxLatency), 0);
+    if (!taken.IsNull()) {
+      break;
+    }
+    // kept while the next check is still within the latency
+    EXPECT_LE(check + kPeriod, kFirstRecord + kMaxLatency);
+    EXPECT_EQ(slot.first_record_time, kFirstRecord);
+    EXPECT_EQ(slot.buffer.GetValidBytes(), 2 * sizeof(uint64_t));
+  }
+  EXPECT_LE(check, kFirstRecord + kMaxLatency);
+  EXPECT_GT(check + kPeriod, kFirstRecord + kMaxLatency);
+  EXPECT_TRUE(slot.buffer.IsNull());
+  EXPECT_EQ(slot.first_record_time, 0ULL);
+}
+
+TEST(ViewBufferSlotTest, FlushTimerTakesDueBuffers) {
+  constexpr auto kMaxLatency = std::chrono::milliseconds{20};
+  constexpr std::size_t kRecordCount = 10;
+
+  pti::view::BufferConsumer consumer;
+  TimedRecordSink sink;
+  std::vector<std::unique_ptr<TimedRecordProducer>> producers;
+  producers.push_back(std::make_unique<TimedRecordProducer>());
+  for (std::size_t i = 0; i < kRecordCount; ++i) {
+    producers[0]->Insert(consumer, sink);
+  }
+  ASSERT_FALSE(producers[0]->slot.buffer.IsNull());
+  SetFlushTimer(consumer, producers, sink, kMaxLatency, kMaxLatency / 4, 0);
+
+  // the buffer is left to the timer, however long it takes to get due on a loaded machine
+  std::size_t records_delivered = 0;
+  for (int i = 0; i < 1000 && records_delivered == 0; ++i) {
+    std::this_thread::sleep_for(kMaxLatency / 4);
+    consumer.Push([&sink, &records_delivered] { records_delivered = sink.count; }).wait();
+  }
+  EXPECT_EQ(records_delivered, kRecordCount);
+  consumer.Push([&producers] {
+            EXPECT_TRUE(producers[0]->slot.buffer.IsNull());
+            EXPECT_EQ(producers[0]->slot.first_record_time, 0ULL);
+          })
+      .wait();
+  FlushAll(consumer, producers, sink);
+  EXPECT_EQ(sink.count, kRecordCount);
+}
+
+TEST(ViewBufferSlotTest, FlushTimerUnderLoadDeliversEveryRecordOnce) {
+  constexpr std::size_t kProducerCount = 4;
+  constexpr std::size_t kRecordsPerProducer = 200000;
+
+  pti::view::BufferConsumer consumer;
+  TimedRecordSink sink;
+  std::vector<std::unique_ptr<TimedRecordProducer>> producers;
+  for (std::size_t i = 0; i < kProducerCount; ++i) {
+    producers.push_back(std::make_unique<TimedRecordProducer>());
+  }
+  SetFlushTimer(consumer, producers, sink, std::chrono::milliseconds{1},
+                std::chrono::milliseconds{1}, 0);
+
+  std::vector<uint64_t> inserted_sums(kProducerCount, 0);
+  std::vector<std::thread> threads;
+  for (std::size_t i = 0; i < kProducerCount; ++i) {
+    threads.emplace_back([&, i] {
+      for (std::size_t j = 0; j < kRecordsPerProducer; ++j) {
+        inserted_sums[i] += producers[i]->Insert(consumer, sink);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  FlushAll(consumer, producers, sink);
+
+  EXPECT_EQ(sink.count, kProducerCount * kRecordsPerProducer);
+  EXPECT_EQ(sink.sum, std::accumulate(inserted_sums.begin(), inserted_sums.end(), uint64_t{0}));
+}
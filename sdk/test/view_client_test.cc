@@ -0,0 +1,188 @@
+#include <gtest/gtest.h>
+#include <level_zero/ze_api.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <iterator>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include "pti/pti_view.h"
+#include "utils/mock_ze_fixture.h"
+
+// Creates, enables and destroys clients from several threads at once in Local collection mode,
+// then checks on the commands the mock driver receives that the collector stopped tracing once
+// the last client is gone
+
+namespace {
+
+constexpr uint32_t kThreads = 4;
+constexpr uint32_t kClientsPerThread = 64;
+constexpr pti_view_kind kClientKinds[] = {PTI_VIEW_DEVICE_GPU_KERNEL,
+                                          PTI_VIEW_DEVICE_GPU_MEM_COPY, PTI_VIEW_LEVEL_ZERO_CALLS};
+
+void BufferRequested(unsigned char** buf, size_t* buf_size) {
+  *buf_size = 1024 * sizeof(pti_view_record_kernel);
+  *buf = static_cast<unsigned char*>(::operator new(*buf_size, std::align_val_t(8)));
+}
+
+void BufferCompleted(unsigned char* buf, size_t /*buf_size*/, size_t /*used_bytes*/) {
+  ::operator delete(buf, std::align_val_t(8));
+}
+
+// Clients created and not yet destroyed, shared by the threads of a test
+class LiveClients {
+ public:
+  void Add(pti_client_handle client) {
+    const std::lock_guard<std::mutex> lock(mtx_);
+    clients_.push_back(client);
+  }
+
+  // any client, possibly destroyed by another thread in the meantime
+  pti_client_handle Any(uint32_t seed) {
+    const std::lock_guard<std::mutex> lock(mtx_);
+    return clients_.empty() ? nullptr : clients_[seed % clients_.size()];
+  }
+
+  pti_client_handle Take() {
+    const std::lock_guard<std::mutex> lock(mtx_);
+    if (clients_.empty()) {
+      return nullptr;
+    }
+    auto client = clients_.back();
+    clients_.pop_back();
+    return client;
+  }
+
+ private:
+  std::mutex mtx_;
+  std::vector<pti_client_handle> clients_;
+};
+
+}  // namespace
+
+class ViewClientTest : public pti::test::utils::level_zero::MockZeDriverTest {
+ protected:
+  void SetUp() override {
+    // read once, when the first call below creates the collector
+    setenv("PTI_COLLECTION_MODE", "2", 0);
+    ASSERT_EQ(ptiViewSetCallbacks(BufferRequested, BufferCompleted), pti_result::PTI_SUCCESS);
+    // the collector is created by the call above, it initialized Level Zero
+    if (!MockZeDriver::Instance().IsLoaded()) {
+      GTEST_SKIP() << "Mock Level Zero driver not loaded, set ZE_ENABLE_ALT_DRIVERS to it";
+    }
+    if (ptiViewGPULocalAvailable() != pti_result::PTI_SUCCESS) {
+      GTEST_SKIP() << "Loader without dynamic tracing";
+    }
+
+    ASSERT_NO_FATAL_FAILURE(CreateAppObjects());
+  }
+
+  void TearDown() override {
+    DestroyAppObjects();
+  }
+};
+
+TEST_F(ViewClientTest, KernelLaunchTracedWhileClientHasKernelsEnabled) {
+  EXPECT_FALSE(LaunchInjectsEvent(command_list_));
+
+  pti_client_handle client = nullptr;
+  ASSERT_EQ(ptiClientCreate(&client), pti_result::PTI_SUCCESS);
+  ASSERT_EQ(ptiClientSetCallbacks(client, BufferRequested, BufferCompleted),
+            pti_result::PTI_SUCCESS);
+  ASSERT_EQ(ptiClientEnable(client, PTI_VIEW_DEVICE_GPU_KERNEL), pti_result::PTI_SUCCESS);
+  EXPECT_TRUE(LaunchInjectsEvent(command_list_));
+  EXPECT_EQ(ptiClientDestroy(client), pti_result::PTI_SUCCESS);
+
+  EXPECT_FALSE(LaunchInjectsEvent(command_list_));
+  EXPECT_EQ(ptiClientEnable(client, PTI_VIEW_DEVICE_GPU_KERNEL),
+            pti_result::PTI_ERROR_BAD_ARGUMENT);
+}
+
+TEST_F(ViewClientTest, ConcurrentCreateEnableDestroyLeavesNothingEnabled) {
+  LiveClients live_clients;
+  std::atomic<uint32_t> unexpected_results = 0;
+  auto expect_result = [&unexpected_results](pti_result result) {
+    // a client found by one thread may be destroyed by another before the call is done with it
+    if (result != pti_result::PTI_SUCCESS && result != pti_result::PTI_ERROR_BAD_ARGUMENT) {
+      ++unexpected_results;
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (uint32_t t = 0; t < kThreads; ++t) {
+    // creating threads
+    threads.emplace_back([&, t]() {
+      for (uint32_t i = 0; i < kClientsPerThread; ++i) {
+        pti_client_handle client = nullptr;
+        if (ptiClientCreate(&client) != pti_result::PTI_SUCCESS) {
+          ++unexpected_results;
+          continue;
+        }
+        expect_result(ptiClientSetCallbacks(client, BufferRequested, BufferCompleted));
+        expect_result(ptiClientEnable(client, kClientKinds[(t + i) % std::size(kClientKinds)]));
+        live_clients.Add(client);
+      }
+    });
+    // enabling threads, on clients of other threads
+    threads.emplace_back([&, t]() {
+      for (uint32_t i = 0; i < kClientsPerThread; ++i) {
+        auto client = live_clients.Any(t * kClientsPerThread + i);
+        if (client == nullptr) {
+          std::this_thread::yield();
+          continue;
+        }
+        for (auto kind : kClientKinds) {
+          expect_result(ptiClientEnable(client, kind));
+        }
+        expect_result(ptiClientFlushViews(client));
+        expect_result(ptiClientDisable(client, kClientKinds[i % std::size(kClientKinds)]));
+      }
+    });
+    // destroying threads
+    threads.emplace_back([&]() {
+      for (uint32_t i = 0; i < kClientsPerThread; ++i) {
+        auto client = live_clients.Take();
+        if (client == nullptr) {
+          std::this_thread::yield();
+          continue;
+        }
+        EXPECT_EQ(ptiClientDestroy(client), pti_result::PTI_SUCCESS);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  while (auto client = live_clients.Take()) {
+    EXPECT_EQ(ptiClientDestroy(client), pti_result::PTI_SUCCESS);
+  }
+  EXPECT_EQ(unexpected_results, 0U);
+
+  // no client count of a view kind is left behind, the collector traces again only with a new
+  // enable and stops with its disable
+  EXPECT_FALSE(LaunchInjectsEvent(command_list_));
+  ASSERT_EQ(ptiViewEnable(PTI_VIEW_DEVICE_GPU_KERNEL), pti_result::PTI_SUCCESS);
+  EXPECT_TRUE(LaunchInjectsEvent(command_list_));
+  ASSERT_EQ(ptiViewDisable(PTI_VIEW_DEVICE_GPU_KERNEL), pti_result::PTI_SUCCESS);
+  EXPECT_FALSE(LaunchInjectsEvent(command_list_));
+  EXPECT_EQ(ptiFlushAllViews(), pti_result::PTI_SUCCESS);
+}
+
+TEST_F(ViewClientTest, KernelMetricsSchemaCannotBeEnabledOnItsOwn) {
+  EXPECT_EQ(ptiViewEnable(PTI_VIEW_DEVICE_GPU_KERNEL_METRICS_SCHEMA),
+            pti_result::PTI_ERROR_BAD_ARGUMENT);
+  EXPECT_EQ(ptiViewDisable(PTI_VIEW_DEVICE_GPU_KERNEL_METRICS_SCHEMA),
+            pti_result::PTI_ERROR_BAD_ARGUMENT);
+
+  pti_client_handle client = nullptr;
+  ASSERT_EQ(ptiClientCreate(&client), pti_result::PTI_SUCCESS);
+  ASSERT_EQ(ptiClientSetCallbacks(client, BufferRequested, BufferCompleted),
+            pti_result::PTI_SUCCESS);
+  EXPECT_EQ(ptiClientEnable(client, PTI_VIEW_DEVICE_GPU_KERNEL_METRICS_SCHEMA),
+            pti_result::PTI_ERROR_BAD_ARGUMENT);
+  EXPECT_EQ(ptiClientDestroy(client), pti_result::PTI_SUCCESS);
+}
@@ -0,0 +1,230 @@
+//==============================================================
+// Copyright (C) Intel Corporation
+//
+// SPDX-License-Identifier: MIT
+// =============================================================
+
+#ifndef PTI_TOOLS_CL_TRACER_CL_DEPENDENCIES_H_
+#define PTI_TOOLS_CL_TRACER_CL_DEPENDENCIES_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <CL/cl.h>
+
+#include "pti_assert.h"
+
+// Properties that never change for a kernel on a device (or a transfer command),
+// shared by all of its instances
+struct ClKernelMetadata {
+  std::string name;
+  size_t simd_width;
+};
+
+struct ClKernelProps {
+  std::shared_ptr<const ClKernelMetadata> metadata;
+  size_t bytes_transferred;
+  size_t global_size[3];
+  size_t local_size[3];
+};
+
+// Completed kernel or transfer with the commands it waited on,
+// host timestamps in ns. Names are formatted when reported only
+struct ClDependencyRecord {
+  uint64_t kernel_id;
+  ClKernelProps props;
+  cl_command_queue queue;
+  bool out_of_order;
+  uint64_t queued;
+  uint64_t started;
+  uint64_t ended;
+  std::vector<uint64_t> wait_kernel_ids;
+};
+
+struct ClQueueDependencyStats {
+  bool out_of_order = false;
+  uint64_t command_count = 0;
+  uint64_t busy_time = 0;        // time at least one command is executed
+  uint64_t execute_time = 0;     // sum of command execution times
+  uint64_t max_concurrency = 0;
+  uint64_t serialization_count = 0;
+  uint64_t dependency_idle_time = 0;
+};
+
+struct ClKernelDependencyStats {
+  uint64_t call_count = 0;
+  uint64_t dependency_wait_time = 0;
+  uint64_t serialization_count = 0;
+};
+
+using ClQueueDependencyStatsMap =
+  std::map<cl_command_queue, ClQueueDependencyStats>;
+using ClKernelDependencyStatsMap =
+  std::map<std::string, ClKernelDependencyStats>;
+
+// Producer and consumer indices in the record list
+using ClDependencyEdgeList = std::vector<std::pair<size_t, size_t> >;
+
+namespace cl_dependencies {
+
+using IntervalList = std::vector<std::pair<uint64_t, uint64_t> >;
+
+inline IntervalList Merge(IntervalList intervals) {
+  std::sort(intervals.begin(), intervals.end());
+  IntervalList merged;
+  for (auto& interval : intervals) {
+    if (interval.first >= interval.second) {
+      continue;
+    }
+    if (!merged.empty() && interval.first <= merged.back().second) {
+      merged.back().second = (std::max)(merged.back().second, interval.second);
+    } else {
+      merged.push_back(interval);
+    }
+  }
+  return merged;
+}
+
+inline uint64_t GetLength(const IntervalList& merged) {
+  uint64_t length = 0;
+  for (auto& interval : merged) {
+    length += interval.second - interval.first;
+  }
+  return length;
+}
+
+inline uint64_t GetOverlap(const IntervalList& a, const IntervalList& b) {
+  uint64_t overlap = 0;
+  size_t i = 0, j = 0;
+  while (i < a.size() && j < b.size()) {
+    uint64_t start = (std::max)(a[i].first, b[j].first);
+    uint64_t end = (std::min)(a[i].second, b[j].second);
+    if (start < end) {
+      overlap += end - start;
+    }
+    if (a[i].second < b[j].second) {
+      ++i;
+    } else {
+      ++j;
+    }
+  }
+  return overlap;
+}
+
+} // namespace cl_dependencies
+
+// Waits on commands that are not traced, e.g., user events
+// or commands of the other backend, have no edge
+inline ClDependencyEdgeList GetDependencyEdges(
+    const std::vector<ClDependencyRecord>& records) {
+  std::unordered_map<uint64_t, size_t> index_map;
+  for (size_t i = 0; i < records.size(); ++i) {
+    index_map[records[i].kernel_id] = i;
+  }
+
+  ClDependencyEdgeList edges;
+  for (size_t i = 0; i < records.size(); ++i) {
+    for (uint64_t kernel_id : records[i].wait_kernel_ids) {
+      auto it = index_map.find(kernel_id);
+      if (it != index_map.end()) {
+        edges.push_back(std::make_pair(it->second, i));
+      }
+    }
+  }
+  return edges;
+}
+
+// A command waits on dependencies from the time it is queued until the last
+// command it waits on ends, or until it starts if that is earlier. Dependency
+// idle time is the part of these waits when the queue executes nothing.
+// A serialization point is a command of an out-of-order queue that is queued
+// while earlier commands of the queue are not complete, but starts only after
+// all of them end. Kernel statistics are gathered by the names get_name gives
+// to the records.
+template <typename GetName>
+inline void AnalyzeDependencies(
+    const std::vector<ClDependencyRecord>& records,
+    ClQueueDependencyStatsMap& queue_stats,
+    ClKernelDependencyStatsMap& kernel_stats,
+    GetName get_name) {
+  std::vector<uint64_t> ready(records.size(), 0);
+  for (auto& edge : GetDependencyEdges(records)) {
+    ready[edge.second] =
+      (std::max)(ready[edge.second], records[edge.first].ended);
+  }
+
+  std::map<cl_command_queue, std::vector<size_t> > queue_map;
+  for (size_t i = 0; i < records.size(); ++i) {
+    queue_map[records[i].queue].push_back(i);
+  }
+
+  for (auto& queue : queue_map) {
+    std::vector<size_t>& commands = queue.second;
+    PTI_ASSERT(!commands.empty());
+    ClQueueDependencyStats& stats = queue_stats[queue.first];
+    stats.out_of_order = records[commands.front()].out_of_order;
+
+    cl_dependencies::IntervalList busy;
+    cl_dependencies::IntervalList waits;
+    std::vector<std::pair<uint64_t, int> > transitions;
+    for (size_t i : commands) {
+      const ClDependencyRecord& record = records[i];
+      busy.push_back(std::make_pair(record.started, record.ended));
+      transitions.push_back(std::make_pair(record.started, 1));
+      transitions.push_back(std::make_pair(record.ended, -1));
+
+      uint64_t wait_end = (std::min)(ready[i], record.started);
+      uint64_t wait_time = 0;
+      if (wait_end > record.queued) {
+        waits.push_back(std::make_pair(record.queued, wait_end));
+        wait_time = wait_end - record.queued;
+      }
+
+      ClKernelDependencyStats& kernel = kernel_stats[get_name(record)];
+      kernel.call_count += 1;
+      kernel.dependency_wait_time += wait_time;
+
+      stats.command_count += 1;
+      stats.execute_time += record.ended - record.started;
+    }
+
+    // ends go before starts at the same time
+    std::sort(transitions.begin(), transitions.end());
+    int64_t concurrency = 0;
+    for (auto& transition : transitions) {
+      concurrency += transition.second;
+      stats.max_concurrency = (std::max)(
+          stats.max_concurrency, static_cast<uint64_t>(concurrency));
+    }
+
+    busy = cl_dependencies::Merge(busy);
+    waits = cl_dependencies::Merge(waits);
+    stats.busy_time = cl_dependencies::GetLength(busy);
+    stats.dependency_idle_time = cl_dependencies::GetLength(waits) -
+      cl_dependencies::GetOverlap(waits, busy);
+
+    if (stats.out_of_order) {
+      std::sort(commands.begin(), commands.end(),
+                [&records](size_t a, size_t b) {
+        return records[a].queued < records[b].queued;
+      });
+      uint64_t previous_end = 0;  // of the commands queued earlier
+      for (size_t i : commands) {
+        const ClDependencyRecord& record = records[i];
+        if (previous_end > record.queued && record.started >= previous_end) {
+          stats.serialization_count += 1;
+          kernel_stats[get_name(record)].serialization_count += 1;
+        }
+        previous_end = (std::max)(previous_end, record.ended);
+      }
+    }
+  }
+}
+
+#endif // PTI_TOOLS_CL_TRACER_CL_DEPENDENCIES_H_
@@ -12,12 +12,16 @@
 #include <iostream>
 #include <list>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <set>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "cl_api_tracer.h"
+#include "cl_dependencies.h"
+#include "cl_kernel_metadata.h"
 #include "cl_utils.h"
 #include "correlator.h"
 #include "trace_guard.h"
@@ -37,14 +41,8 @@ struct ClEnqueueData {
   cl_event event;
   cl_ulong host_sync;
   cl_ulong device_sync;
-};
-
-struct ClKernelProps {
-  std::string name;
-  size_t simd_width;
-  size_t bytes_transferred;
-  size_t global_size[3];
-  size_t local_size[3];
+  bool out_of_order = false;
+  std::vector<uint64_t> wait_kernel_ids;
 };
 
 struct ClKernelInstance {
@@ -54,6 +52,9 @@ struct ClKernelInstance {
   cl_ulong host_sync = 0;
   cl_ulong device_sync = 0;
   bool need_to_process = true;
+  bool user_event = true;  // false if the event is created for the tracer only
+  bool out_of_order = false;
+  std::vector<uint64_t> wait_kernel_ids;
 };
 
 struct ClKernelInfo {
@@ -168,6 +169,10 @@ class ClKernelCollector {
   }
 #endif // PTI_KERNEL_INTERVALS
 
+  const std::vector<ClDependencyRecord>& GetDependencyRecords() const {
+    return dependency_record_list_;
+  }
+
   ClKernelCollector(const ClKernelCollector& copy) = delete;
   ClKernelCollector& operator=(const ClKernelCollector& copy) = delete;
 
@@ -281,6 +286,89 @@ class ClKernelCollector {
     correlator_->Log(stream.str());
   }
 
+  // Name of the command as in the kernel table and the device timeline
+  std::string GetName(const ClKernelProps& props) const {
+    PTI_ASSERT(props.metadata != nullptr);
+    if (options_.verbose) {
+      return GetVerboseName(&props);
+    }
+    return props.metadata->name;
+  }
+
+  void PrintDependencyTable() const {
+    ClQueueDependencyStatsMap queue_stats;
+    ClKernelDependencyStatsMap kernel_stats;
+    AnalyzeDependencies(
+        dependency_record_list_, queue_stats, kernel_stats,
+        [this](const ClDependencyRecord& record) {
+          return GetName(record.props);
+        });
+    if (queue_stats.empty()) {
+      return;
+    }
+
+    std::map<cl_command_queue, std::string> queue_names;
+    size_t max_queue_length = kKernelLength;
+    for (auto& value : queue_stats) {
+      std::stringstream name;
+      name << std::hex << value.first;
+      queue_names[value.first] = name.str();
+      if (name.str().size() > max_queue_length) {
+        max_queue_length = name.str().size();
+      }
+    }
+
+    std::stringstream stream;
+    stream << std::setw(max_queue_length) << "Queue" << "," <<
+      std::setw(kCallsLength) << "Out-Of-Order" << "," <<
+      std::setw(kCallsLength) << "Commands" << "," <<
+      std::setw(kTimeLength) << "Busy (ns)" << "," <<
+      std::setw(kPercentLength) << "Concurrency" << "," <<
+      std::setw(kPercentLength) << "Max Concur." << "," <<
+      std::setw(kCallsLength) << "Serialized" << "," <<
+      std::setw(kTimeLength) << "Dependency Idle (ns)" << std::endl;
+
+    for (auto& value : queue_stats) {
+      const ClQueueDependencyStats& stats = value.second;
+      float concurrency = (stats.busy_time == 0) ? 0.0f :
+        static_cast<float>(stats.execute_time) / stats.busy_time;
+      stream << std::setw(max_queue_length) << queue_names[value.first] <<
+        "," <<
+        std::setw(kCallsLength) << (stats.out_of_order ? "yes" : "no") << "," <<
+        std::setw(kCallsLength) << stats.command_count << "," <<
+        std::setw(kTimeLength) << stats.busy_time << "," <<
+        std::setw(kPercentLength) << std::setprecision(2) <<
+          std::fixed << concurrency << "," <<
+        std::setw(kPercentLength) << stats.max_concurrency << "," <<
+        std::setw(kCallsLength) << stats.serialization_count << "," <<
+        std::setw(kTimeLength) << stats.dependency_idle_time << std::endl;
+    }
+
+    size_t max_name_length = kKernelLength;
+    for (auto& value : kernel_stats) {
+      if (value.first.size() > max_name_length) {
+        max_name_length = value.first.size();
+      }
+    }
+
+    stream << std::endl;
+    stream << std::setw(max_name_length) << "Kernel" << "," <<
+      std::setw(kCallsLength) << "Calls" << "," <<
+      std::setw(kTimeLength) << "Dependency Wait (ns)" << "," <<
+      std::setw(kCallsLength) << "Serialized" << std::endl;
+
+    for (auto& value : kernel_stats) {
+      stream << std::setw(max_name_length) << value.first << "," <<
+        std::setw(kCallsLength) << value.second.call_count << "," <<
+        std::setw(kTimeLength) << value.second.dependency_wait_time << "," <<
+        std::setw(kCallsLength) << value.second.serialization_count <<
+        std::endl;
+    }
+
+    PTI_ASSERT(correlator_ != nullptr);
+    correlator_->Log(stream.str());
+  }
+
  private: // Implementation Details
   ClKernelCollector(
       cl_device_id device,
@@ -291,6 +379,7 @@ class ClKernelCollector {
       : device_(device),
         correlator_(correlator),
         options_(options),
+        metadata_cache_(options.demangle),
         callback_(callback),
         callback_data_(callback_data),
         kernel_id_(1) {
@@ -377,6 +466,8 @@ class ClKernelCollector {
         CL_FUNCTION_clFinish);
     set = set && tracer->SetTracingFunction(
         CL_FUNCTION_clReleaseCommandQueue);
+    set = set && tracer->SetTracingFunction(
+        CL_FUNCTION_clReleaseKernel);
     set = set && tracer->SetTracingFunction(
         CL_FUNCTION_clReleaseEvent);
     set = set && tracer->SetTracingFunction(
@@ -387,10 +478,36 @@ class ClKernelCollector {
     PTI_ASSERT(enabled);
   }
 
+  // Waits on events of traced commands only, e.g., user events are skipped
+  void GetWaitKernelIds(
+      cl_uint num_events, const cl_event* event_list,
+      std::vector<uint64_t>& kernel_ids) {
+    if (event_list == nullptr) {
+      return;
+    }
+
+    const std::lock_guard<std::mutex> lock(lock_);
+    for (cl_uint i = 0; i < num_events; ++i) {
+      auto it = event_kernel_map_.find(event_list[i]);
+      if (it != event_kernel_map_.end()) {
+        kernel_ids.push_back(it->second);
+      }
+    }
+  }
+
+  // Last reference to the event is released, its handle may be reused
+  void RemoveEventKernelId(cl_event event) {
+    const std::lock_guard<std::mutex> lock(lock_);
+    event_kernel_map_.erase(event);
+  }
+
   void AddKernelInstance(ClKernelInstance* instance) {
     PTI_ASSERT(instance != nullptr);
     const std::lock_guard<std::mutex> lock(lock_);
     kernel_instance_list_.push_back(instance);
+    if (options_.dependency_analysis) {
+      event_kernel_map_[instance->event] = instance->kernel_id;
+    }
   }
 
   static void ComputeHostTimestamps(
@@ -451,7 +568,7 @@ class ClKernelCollector {
       PTI_ASSERT(device != nullptr);
       AddKernelInterval(instance, device, started, ended);
 #else // PTI_KERNEL_INTERVALS
-      std::string name = instance->props.name;
+      std::string name = instance->props.metadata->name;
       PTI_ASSERT(!name.empty());
 
       if (options_.verbose) {
@@ -472,10 +589,17 @@ class ClKernelCollector {
         host_started - host_submitted,
         host_ended - host_started);
 
-      if (callback_ != nullptr) {
-        std::stringstream stream;
-        stream << std::hex << queue;
+      if (options_.dependency_analysis) {
+        dependency_record_list_.push_back(ClDependencyRecord{
+            instance->kernel_id, instance->props, queue,
+            instance->out_of_order, host_queued, host_started, host_ended,
+            instance->wait_kernel_ids});
+      }
+
+      std::stringstream stream;
+      stream << std::hex << queue;
 
+      if (callback_ != nullptr) {
         callback_(
             callback_data_, stream.str(),
             std::to_string(instance->kernel_id), name,
@@ -485,6 +609,10 @@ class ClKernelCollector {
 #endif // PTI_KERNEL_INTERVALS
     }
 
+    if (options_.dependency_analysis && !instance->user_event) {
+      event_kernel_map_.erase(event);
+    }
+
     cl_int status = clReleaseEvent(event);
     PTI_ASSERT(status == CL_SUCCESS);
 
@@ -531,18 +659,20 @@ class ClKernelCollector {
     }
   }
 
-  std::string GetVerboseName(const ClKernelProps* props) {
+  static std::string GetVerboseName(const ClKernelProps* props) {
     PTI_ASSERT(props != nullptr);
-    PTI_ASSERT(!props->name.empty());
+    PTI_ASSERT(props->metadata != nullptr);
+    const ClKernelMetadata* metadata = props->metadata.get();
+    PTI_ASSERT(!metadata->name.empty());
 
     std::stringstream sstream;
-    sstream << props->name;
-    if (props->simd_width > 0) {
+    sstream << metadata->name;
+    if (metadata->simd_width > 0) {
       sstream << "[SIMD";
-      if (props->simd_width == 1) {
+      if (metadata->simd_width == 1) {
         sstream << "_ANY";
       } else {
-        sstream << props->simd_width;
+        sstream << metadata->simd_width;
       }
       sstream << " {" <<
         props->global_size[0] << "; " <<
@@ -552,7 +682,7 @@ class ClKernelCollector {
         props->local_size[1] << "; " <<
         props->local_size[2] << "}]";
     } else if (props->bytes_transferred > 0) {
-      sstream << props->name << "[" <<
+      sstream << metadata->name << "[" <<
         std::to_string(props->bytes_transferred) << " bytes]";
     }
 
@@ -653,7 +783,7 @@ class ClKernelCollector {
         host_started, host_ended);
 #endif /* 0 */
 
-    std::string name = instance->props.name;
+    std::string name = instance->props.metadata->name;
     PTI_ASSERT(!name.empty());
 
     if (options_.verbose) {
@@ -816,6 +946,14 @@ class ClKernelCollector {
       *(params->event) = &(enqueue_data->event);
     }
 
+    if (collector->options_.dependency_analysis) {
+      enqueue_data->out_of_order =
+        collector->metadata_cache_.IsQueueOutOfOrder(*(params->commandQueue));
+      collector->GetWaitKernelIds(
+          *(params->numEventsInWaitList), *(params->eventWaitList),
+          enqueue_data->wait_kernel_ids);
+    }
+
     data->correlationData[0] = reinterpret_cast<cl_ulong>(enqueue_data);
   }
 
@@ -845,18 +983,9 @@ class ClKernelCollector {
       instance->event = **(params->event);
 
       cl_kernel kernel = *(params->kernel);
-      instance->props.name = utils::cl::GetKernelName(
-          kernel, collector->options_.demangle);
-
       cl_command_queue queue = *(params->commandQueue);
       PTI_ASSERT(queue != nullptr);
-      cl_device_id device = utils::cl::GetDevice(queue);
-      PTI_ASSERT(device != nullptr);
-
-      size_t simd_width = utils::cl::GetKernelSimdWidth(device, kernel);
-      PTI_ASSERT(simd_width > 0);
-
-      instance->props.simd_width = simd_width;
+      instance->props.metadata = collector->metadata_cache_.GetKernelMetadata(kernel, queue);
       instance->props.bytes_transferred = 0;
 
       collector->CalculateKernelGlobalSize(params, &instance->props);
@@ -875,6 +1004,9 @@ class ClKernelCollector {
       PTI_ASSERT(enqueue_data != nullptr);
       instance->device_sync = enqueue_data->device_sync;
       instance->host_sync = enqueue_data->host_sync;
+      instance->user_event = (*(params->event) != &(enqueue_data->event));
+      instance->out_of_order = enqueue_data->out_of_order;
+      instance->wait_kernel_ids = std::move(enqueue_data->wait_kernel_ids);
 
       collector->AddKernelInstance(instance);
 
@@ -883,7 +1015,7 @@ class ClKernelCollector {
   }
 
   static void OnExitEnqueueTransfer(
-      std::string name, size_t bytes_transferred, cl_event* event,
+      const char* name, size_t bytes_transferred, cl_event* event,
       cl_callback_data* data, ClKernelCollector* collector) {
     PTI_ASSERT(event != nullptr);
     PTI_ASSERT(data != nullptr);
@@ -897,9 +1029,7 @@ class ClKernelCollector {
     ClKernelInstance* instance = new ClKernelInstance;
     PTI_ASSERT(instance != nullptr);
     instance->event = *event;
-    instance->props.name = name;
-
-    instance->props.simd_width = 0;
+    instance->props.metadata = collector->metadata_cache_.GetTransferMetadata(name);
     instance->props.bytes_transferred = bytes_transferred;
 
     instance->kernel_id =
@@ -915,6 +1045,9 @@ class ClKernelCollector {
     PTI_ASSERT(enqueue_data != nullptr);
     instance->device_sync = enqueue_data->device_sync;
     instance->host_sync = enqueue_data->host_sync;
+    instance->user_event = (event != &(enqueue_data->event));
+    instance->out_of_order = enqueue_data->out_of_order;
+    instance->wait_kernel_ids = std::move(enqueue_data->wait_kernel_ids);
 
     collector->AddKernelInstance(instance);
 
@@ -1258,9 +1391,59 @@ class ClKernelCollector {
     collector->ProcessKernelInstances();
   }
 
-  static void OnExitReleaseCommandQueue(ClKernelCollector* collector) {
+  // Metadata is dropped with the last reference only, the handle stays
+  // valid for the other holders
+  static void OnEnterReleaseCommandQueue(cl_callback_data* data) {
+    PTI_ASSERT(data != nullptr);
+
+    const cl_params_clReleaseCommandQueue* params =
+      reinterpret_cast<const cl_params_clReleaseCommandQueue*>(
+          data->functionParams);
+    PTI_ASSERT(params != nullptr);
+    data->correlationData[0] =
+      ClKernelMetadataCache::IsLastReference(*(params->commandQueue));
+  }
+
+  static void OnExitReleaseCommandQueue(
+      cl_callback_data* data, ClKernelCollector* collector) {
+    PTI_ASSERT(data != nullptr);
     PTI_ASSERT(collector != nullptr);
     collector->ProcessKernelInstances();
+
+    const cl_params_clReleaseCommandQueue* params =
+      reinterpret_cast<const cl_params_clReleaseCommandQueue*>(
+          data->functionParams);
+    PTI_ASSERT(params != nullptr);
+    cl_int* return_value =
+      reinterpret_cast<cl_int*>(data->functionReturnValue);
+    collector->metadata_cache_.OnQueueReleased(
+        *(params->commandQueue), data->correlationData[0] != 0, *return_value);
+  }
+
+  static void OnEnterReleaseKernel(cl_callback_data* data) {
+    PTI_ASSERT(data != nullptr);
+
+    const cl_params_clReleaseKernel* params =
+      reinterpret_cast<const cl_params_clReleaseKernel*>(
+          data->functionParams);
+    PTI_ASSERT(params != nullptr);
+    data->correlationData[0] =
+      ClKernelMetadataCache::IsLastReference(*(params->kernel));
+  }
+
+  static void OnExitReleaseKernel(
+      cl_callback_data* data, ClKernelCollector* collector) {
+    PTI_ASSERT(data != nullptr);
+    PTI_ASSERT(collector != nullptr);
+
+    const cl_params_clReleaseKernel* params =
+      reinterpret_cast<const cl_params_clReleaseKernel*>(
+          data->functionParams);
+    PTI_ASSERT(params != nullptr);
+    cl_int* return_value =
+      reinterpret_cast<cl_int*>(data->functionReturnValue);
+    collector->metadata_cache_.OnKernelReleased(
+        *(params->kernel), data->correlationData[0] != 0, *return_value);
   }
 
   static void OnEnterReleaseEvent(
@@ -1275,6 +1458,13 @@ class ClKernelCollector {
 
     if (*(params->event) != nullptr) {
       collector->ProcessKernelInstance(*(params->event));
+      // commands enqueued later may still wait on the event while the
+      // application holds other references, the reference of the
+      // instance is released by now
+      if (collector->options_.dependency_analysis &&
+          utils::cl::GetReferenceCount(*(params->event)) == 1) {
+        collector->RemoveEventKernelId(*(params->event));
+      }
     }
   }
 
@@ -1432,8 +1622,16 @@ class ClKernelCollector {
         OnExitFinish(collector);
       }
     } else if (function == CL_FUNCTION_clReleaseCommandQueue) {
-      if (callback_data->site == CL_CALLBACK_SITE_EXIT) {
-        OnExitReleaseCommandQueue(collector);
+      if (callback_data->site == CL_CALLBACK_SITE_ENTER) {
+        OnEnterReleaseCommandQueue(callback_data);
+      } else {
+        OnExitReleaseCommandQueue(callback_data, collector);
+      }
+    } else if (function == CL_FUNCTION_clReleaseKernel) {
+      if (callback_data->site == CL_CALLBACK_SITE_ENTER) {
+        OnEnterReleaseKernel(callback_data);
+      } else {
+        OnExitReleaseKernel(callback_data, collector);
       }
     } else if (function == CL_FUNCTION_clReleaseEvent) {
       if (callback_data->site == CL_CALLBACK_SITE_ENTER) {
@@ -1451,6 +1649,7 @@ class ClKernelCollector {
   Correlator* correlator_ = nullptr;
 
   KernelCollectorOptions options_;
+  ClKernelMetadataCache metadata_cache_;
 
   std::atomic<uint64_t> kernel_id_;
   cl_device_id device_ = nullptr;
@@ -1461,6 +1660,9 @@ class ClKernelCollector {
   std::mutex lock_;
   ClKernelInfoMap kernel_info_map_;
   ClKernelInstanceList kernel_instance_list_;
+  std::map<cl_event, uint64_t> event_kernel_map_;  // traced command of event
+  std::vector<ClDependencyRecord> dependency_record_list_;
+
 
 #ifdef PTI_KERNEL_INTERVALS
   ze_device_handle_t ze_device_;
@@ -0,0 +1,135 @@
+//==============================================================
+// Copyright (C) Intel Corporation
+//
+// SPDX-License-Identifier: MIT
+// =============================================================
+
+#ifndef PTI_TOOLS_CL_TRACER_CL_KERNEL_METADATA_H_
+#define PTI_TOOLS_CL_TRACER_CL_KERNEL_METADATA_H_
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+#include <CL/cl.h>
+
+#include "cl_dependencies.h"
+#include "cl_utils.h"
+#include "pti_assert.h"
+
+// Metadata of kernels per device and properties of queues, queried from the runtime on the
+// first enqueue only and kept until the last release of the kernel or the queue
+class ClKernelMetadataCache {
+ public:
+  explicit ClKernelMetadataCache(bool demangle) : demangle_(demangle) {}
+
+  ClKernelMetadataCache(const ClKernelMetadataCache& copy) = delete;
+  ClKernelMetadataCache& operator=(const ClKernelMetadataCache& copy) = delete;
+
+  // Name and SIMD width are queried on the first enqueue of the kernel
+  // to the device only, until the kernel or the queue is released
+  std::shared_ptr<const ClKernelMetadata> GetKernelMetadata(
+      cl_kernel kernel, cl_command_queue queue) {
+    PTI_ASSERT(kernel != nullptr);
+    PTI_ASSERT(queue != nullptr);
+    const std::lock_guard<std::mutex> lock(lock_);
+
+    cl_device_id device = nullptr;
+    auto queue_it = queue_device_map_.find(queue);
+    if (queue_it == queue_device_map_.end()) {
+      device = utils::cl::GetDevice(queue);
+      PTI_ASSERT(device != nullptr);
+      queue_device_map_[queue] = device;
+    } else {
+      device = queue_it->second;
+    }
+
+    std::shared_ptr<const ClKernelMetadata>& metadata =
+      kernel_metadata_map_[std::make_pair(kernel, device)];
+    if (metadata == nullptr) {
+      size_t simd_width = utils::cl::GetKernelSimdWidth(device, kernel);
+      PTI_ASSERT(simd_width > 0);
+      metadata = std::make_shared<const ClKernelMetadata>(ClKernelMetadata{
+          utils::cl::GetKernelName(kernel, demangle_), simd_width});
+    }
+    return metadata;
+  }
+
+  // Names of transfers are string literals, one entry per call site
+  std::shared_ptr<const ClKernelMetadata> GetTransferMetadata(
+      const char* name) {
+    PTI_ASSERT(name != nullptr);
+    const std::lock_guard<std::mutex> lock(lock_);
+
+    std::shared_ptr<const ClKernelMetadata>& metadata =
+      transfer_metadata_map_[name];
+    if (metadata == nullptr) {
+      metadata = std::make_shared<const ClKernelMetadata>(
+          ClKernelMetadata{name, 0});
+    }
+    return metadata;
+  }
+
+  bool IsQueueOutOfOrder(cl_command_queue queue) {
+    PTI_ASSERT(queue != nullptr);
+    const std::lock_guard<std::mutex> lock(lock_);
+
+    auto it = queue_order_map_.find(queue);
+    if (it != queue_order_map_.end()) {
+      return it->second;
+    }
+    bool out_of_order = utils::cl::IsQueueOutOfOrder(queue);
+    queue_order_map_[queue] = out_of_order;
+    return out_of_order;
+  }
+
+  // Metadata is dropped with the last reference only, the handle stays
+  // valid for the other holders. The reference count is read on enter to
+  // clReleaseKernel/clReleaseCommandQueue, as the object may be gone on exit
+  static bool IsLastReference(cl_kernel kernel) {
+    return utils::cl::GetReferenceCount(kernel) == 1;
+  }
+
+  static bool IsLastReference(cl_command_queue queue) {
+    return utils::cl::GetReferenceCount(queue) == 1;
+  }
+
+  // On exit of clReleaseKernel: instances in flight keep their metadata,
+  // a handle reused by a new kernel gets queried again
+  void OnKernelReleased(cl_kernel kernel, bool last_reference, cl_int result) {
+    if (result != CL_SUCCESS || !last_reference) {
+      return;
+    }
+    const std::lock_guard<std::mutex> lock(lock_);
+    auto it = kernel_metadata_map_.lower_bound(
+        std::make_pair(kernel, static_cast<cl_device_id>(nullptr)));
+    while (it != kernel_metadata_map_.end() && it->first.first == kernel) {
+      it = kernel_metadata_map_.erase(it);
+    }
+  }
+
+  // On exit of clReleaseCommandQueue, a handle reused by a new queue gets
+  // queried again
+  void OnQueueReleased(cl_command_queue queue, bool last_reference, cl_int result) {
+    if (result != CL_SUCCESS || !last_reference) {
+      return;
+    }
+    const std::lock_guard<std::mutex> lock(lock_);
+    queue_device_map_.erase(queue);
+    queue_order_map_.erase(queue);
+  }
+
+ private:
+  bool demangle_;
+
+  std::mutex lock_;
+  std::map<std::pair<cl_kernel, cl_device_id>,
+           std::shared_ptr<const ClKernelMetadata> > kernel_metadata_map_;
+  std::map<cl_command_queue, cl_device_id> queue_device_map_;
+  std::map<cl_command_queue, bool> queue_order_map_;
+  std::map<const char*, std::shared_ptr<const ClKernelMetadata> >
+    transfer_metadata_map_;
+};
+
+#endif // PTI_TOOLS_CL_TRACER_CL_KERNEL_METADATA_H_
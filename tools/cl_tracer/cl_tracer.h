@@ -14,6 +14,7 @@
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <vector>
 #include <algorithm>
 
 #include "cl_ext_collector.h"
@@ -39,7 +40,8 @@ class ClTracer {
     ClTracer* tracer = new ClTracer(options);
     PTI_ASSERT(tracer != nullptr);
 
-    if (tracer->CheckOption(TRACE_DEVICE_TIMING) ||
+    if (tracer->dependency_analysis_ ||
+        tracer->CheckOption(TRACE_DEVICE_TIMING) ||
         tracer->CheckOption(TRACE_KERNEL_SUBMITTING) ||
         tracer->CheckOption(TRACE_DEVICE_TIMELINE) ||
         tracer->CheckOption(TRACE_CHROME_DEVICE_TIMELINE) ||
@@ -84,6 +86,7 @@ class ClTracer {
       KernelCollectorOptions kernel_options;
       kernel_options.verbose = tracer->CheckOption(TRACE_VERBOSE);
       kernel_options.demangle = tracer->CheckOption(TRACE_DEMANGLE);
+      kernel_options.dependency_analysis = tracer->dependency_analysis_;
 
       if (cpu_device != nullptr) {
         cpu_kernel_collector = ClKernelCollector::Create(
@@ -187,6 +190,10 @@ class ClTracer {
 
     Report();
 
+    if (dependency_analysis_ && chrome_logger_ != nullptr) {
+      LogDependencyFlows();
+    }
+
     if (cpu_api_collector_ != nullptr) {
       delete cpu_api_collector_;
     }
@@ -226,7 +233,9 @@ class ClTracer {
   ClTracer(const TraceOptions& options)
       : options_(options),
         correlator_(options.GetLogFileName(),
-          CheckOption(TRACE_CONDITIONAL_COLLECTION)) {
+          CheckOption(TRACE_CONDITIONAL_COLLECTION)),
+        dependency_analysis_(
+          utils::GetEnv("CLT_DependencyAnalysis") == "1") {
 #if !defined(_WIN32)
     uint64_t monotonic_time = utils::GetTime(CLOCK_MONOTONIC);
     uint64_t real_time = utils::GetTime(CLOCK_REALTIME);
@@ -463,9 +472,102 @@ class ClTracer {
       ReportKernelSubmission(
           cpu_kernel_collector_, gpu_kernel_collector_, "Device");
     }
+    if (dependency_analysis_) {
+      ReportDependencies(cpu_kernel_collector_, gpu_kernel_collector_);
+    }
+    correlator_.Log("\n");
+  }
+
+  void PrintDependencyTable(
+      const ClKernelCollector* collector, const char* device_type) {
+    PTI_ASSERT(collector != nullptr);
+    PTI_ASSERT(device_type != nullptr);
+
+    if (!collector->GetDependencyRecords().empty()) {
+      std::stringstream stream;
+      stream << std::endl;
+      stream << "== " << device_type << " Backend: ==" << std::endl;
+      stream << std::endl;
+      correlator_.Log(stream.str());
+      collector->PrintDependencyTable();
+    }
+  }
+
+  void ReportDependencies(
+      const ClKernelCollector* cpu_collector,
+      const ClKernelCollector* gpu_collector) {
+    PTI_ASSERT (cpu_collector != nullptr || gpu_collector != nullptr);
+
+    std::stringstream stream;
+    stream << std::endl;
+    stream << "=== Dependency Analysis Results: ===" << std::endl;
+    correlator_.Log(stream.str());
+
+    if (cpu_collector != nullptr) {
+      PrintDependencyTable(cpu_collector, "CPU");
+    }
+    if (gpu_collector != nullptr) {
+      PrintDependencyTable(gpu_collector, "GPU");
+    }
+
     correlator_.Log("\n");
   }
 
+  // Track of the command in the device timeline
+  std::string GetDependencyFlowTrack(
+      const ClKernelCollector* collector, const ClDependencyRecord& record) {
+    if (CheckOption(TRACE_CHROME_KERNEL_TIMELINE)) {
+      return collector->GetName(record.props);
+    }
+    std::stringstream queue;
+    queue << std::hex << record.queue;
+    if (CheckOption(TRACE_CHROME_DEVICE_STAGES)) {
+      return std::to_string(record.kernel_id) + "." + queue.str();
+    }
+    return queue.str();
+  }
+
+  // Flow arrows from the commands waited on to the commands waiting,
+  // bound to the execution slices of the device timeline
+  void LogDependencyFlows() {
+    PTI_ASSERT(chrome_logger_ != nullptr);
+    if (!CheckOption(TRACE_CHROME_DEVICE_TIMELINE) &&
+        !CheckOption(TRACE_CHROME_KERNEL_TIMELINE) &&
+        !CheckOption(TRACE_CHROME_DEVICE_STAGES)) {
+      return;
+    }
+
+    uint64_t flow_id = 0;
+    for (const ClKernelCollector* collector :
+         {cpu_kernel_collector_, gpu_kernel_collector_}) {
+      if (collector == nullptr) {
+        continue;
+      }
+
+      const std::vector<ClDependencyRecord>& records =
+        collector->GetDependencyRecords();
+      std::stringstream stream;
+      for (auto& edge : GetDependencyEdges(records)) {
+        const ClDependencyRecord& producer = records[edge.first];
+        const ClDependencyRecord& consumer = records[edge.second];
+        ++flow_id;
+        stream << "{\"ph\":\"s\", \"id\":" << flow_id <<
+          ", \"pid\":\"" << utils::GetPid() <<
+          "\", \"tid\":\"" << GetDependencyFlowTrack(collector, producer) <<
+          "\", \"name\":\"dependency\", \"cat\":\"dependency\"" <<
+          ", \"ts\": " << producer.started / NSEC_IN_USEC <<
+          "}," << std::endl;
+        stream << "{\"ph\":\"f\", \"bp\":\"e\", \"id\":" << flow_id <<
+          ", \"pid\":\"" << utils::GetPid() <<
+          "\", \"tid\":\"" << GetDependencyFlowTrack(collector, consumer) <<
+          "\", \"name\":\"dependency\", \"cat\":\"dependency\"" <<
+          ", \"ts\": " << consumer.started / NSEC_IN_USEC <<
+          "}," << std::endl;
+      }
+      chrome_logger_->Log(stream.str());
+    }
+  }
+
   static void DeviceTimelineCallback(
       void* data,
       const std::string& queue,
@@ -726,6 +828,7 @@ class ClTracer {
 
   Correlator correlator_;
   uint64_t total_execution_time_ = 0;
+  bool dependency_analysis_ = false;
 
   ClApiCollector* cpu_api_collector_ = nullptr;
   ClApiCollector* gpu_api_collector_ = nullptr;
@@ -0,0 +1,115 @@
+//==============================================================
+// Copyright (C) Intel Corporation
+//
+// SPDX-License-Identifier: MIT
+// =============================================================
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "cl_dependencies.h"
+
+// records of completed commands are built by hand, no OpenCL runtime is called
+
+static cl_command_queue out_of_order_queue = reinterpret_cast<cl_command_queue>(0x10);
+static cl_command_queue in_order_queue = reinterpret_cast<cl_command_queue>(0x20);
+
+class ClDependenciesTest : public ::testing::Test {
+ protected:
+  void AddRecord(uint64_t kernel_id, const std::string& name, cl_command_queue queue,
+                 uint64_t queued, uint64_t started, uint64_t ended,
+                 std::vector<uint64_t> wait_kernel_ids = {}) {
+    ClKernelProps props{};
+    props.metadata = std::make_shared<const ClKernelMetadata>(ClKernelMetadata{name, 0});
+    records_.push_back(ClDependencyRecord{
+        kernel_id, props, queue, queue == out_of_order_queue,
+        queued, started, ended, wait_kernel_ids});
+  }
+
+  void Analyze() {
+    AnalyzeDependencies(records_, queue_stats_, kernel_stats_,
+                        [](const ClDependencyRecord& record) {
+                          return record.props.metadata->name;
+                        });
+  }
+
+  // A and B run concurrently on the out-of-order queue, C waits on A there,
+  // D waits on C on the in-order queue
+  void AddGraph() {
+    AddRecord(1, "a_b", out_of_order_queue, 0, 10, 100);
+    AddRecord(2, "a_b", out_of_order_queue, 5, 20, 60);
+    AddRecord(3, "c", out_of_order_queue, 30, 110, 150, {1});
+    AddRecord(4, "d", in_order_queue, 0, 160, 200, {3, 99});
+  }
+
+  std::vector<ClDependencyRecord> records_;
+  ClQueueDependencyStatsMap queue_stats_;
+  ClKernelDependencyStatsMap kernel_stats_;
+};
+
+TEST_F(ClDependenciesTest, EdgesToTracedCommandsOnly) {
+  AddGraph();
+  ClDependencyEdgeList edges = GetDependencyEdges(records_);
+  // the wait on the untraced command 99 has no edge
+  ASSERT_EQ(edges.size(), 2);
+  EXPECT_EQ(edges[0], std::make_pair(size_t(0), size_t(2)));
+  EXPECT_EQ(edges[1], std::make_pair(size_t(2), size_t(3)));
+}
+
+TEST_F(ClDependenciesTest, OutOfOrderQueueConcurrencyAndSerialization) {
+  AddGraph();
+  Analyze();
+
+  ASSERT_EQ(queue_stats_.count(out_of_order_queue), 1);
+  const ClQueueDependencyStats& stats = queue_stats_[out_of_order_queue];
+  EXPECT_TRUE(stats.out_of_order);
+  EXPECT_EQ(stats.command_count, 3);
+  EXPECT_EQ(stats.busy_time, 130);
+  EXPECT_EQ(stats.execute_time, 170);
+  EXPECT_EQ(stats.max_concurrency, 2);
+  // C is queued while A runs and starts after all earlier commands end
+  EXPECT_EQ(stats.serialization_count, 1);
+  // the queue executes A while C waits on it
+  EXPECT_EQ(stats.dependency_idle_time, 0);
+}
+
+TEST_F(ClDependenciesTest, InOrderQueueIdleWhileWaitingOnOtherQueue) {
+  AddGraph();
+  Analyze();
+
+  ASSERT_EQ(queue_stats_.count(in_order_queue), 1);
+  const ClQueueDependencyStats& stats = queue_stats_[in_order_queue];
+  EXPECT_FALSE(stats.out_of_order);
+  EXPECT_EQ(stats.command_count, 1);
+  EXPECT_EQ(stats.busy_time, 40);
+  EXPECT_EQ(stats.max_concurrency, 1);
+  EXPECT_EQ(stats.serialization_count, 0);
+  EXPECT_EQ(stats.dependency_idle_time, 150);
+}
+
+TEST_F(ClDependenciesTest, KernelStatsByName) {
+  AddGraph();
+  Analyze();
+
+  ASSERT_EQ(kernel_stats_.size(), 3);
+  EXPECT_EQ(kernel_stats_["a_b"].call_count, 2);
+  EXPECT_EQ(kernel_stats_["a_b"].dependency_wait_time, 0);
+  EXPECT_EQ(kernel_stats_["c"].call_count, 1);
+  EXPECT_EQ(kernel_stats_["c"].dependency_wait_time, 70);
+  EXPECT_EQ(kernel_stats_["c"].serialization_count, 1);
+  EXPECT_EQ(kernel_stats_["d"].dependency_wait_time, 150);
+}
+
+TEST_F(ClDependenciesTest, DependencyEndingAfterStartIsCutAtStart) {
+  // started before the command it waits on ended, e.g., the wait is not honored
+  AddRecord(1, "producer", in_order_queue, 0, 10, 100);
+  AddRecord(2, "consumer", out_of_order_queue, 20, 50, 80, {1});
+  Analyze();
+
+  EXPECT_EQ(kernel_stats_["consumer"].dependency_wait_time, 30);
+  EXPECT_EQ(queue_stats_[out_of_order_queue].dependency_idle_time, 30);
+}
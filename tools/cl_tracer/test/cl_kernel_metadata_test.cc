@@ -0,0 +1,269 @@
+//==============================================================
+// Copyright (C) Intel Corporation
+//
+// SPDX-License-Identifier: MIT
+// =============================================================
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "cl_kernel_metadata.h"
+
+// the OpenCL queries the cache makes are stubbed below over a fake runtime, which counts them
+// and keeps the reference counts of kernels and queues the application retains and releases
+
+namespace {
+
+const cl_platform_id kPlatform = reinterpret_cast<cl_platform_id>(0x10);
+const cl_device_id kDevice0 = reinterpret_cast<cl_device_id>(0x20);
+const cl_device_id kDevice1 = reinterpret_cast<cl_device_id>(0x21);
+const cl_command_queue kQueue0 = reinterpret_cast<cl_command_queue>(0x30);
+const cl_command_queue kQueue1 = reinterpret_cast<cl_command_queue>(0x31);
+const cl_kernel kKernel = reinterpret_cast<cl_kernel>(0x40);
+
+constexpr size_t kSimdWidth = 16;
+constexpr char kExtensions[] = "cl_khr_fp64 cl_intel_subgroups";
+
+struct FakeRuntime {
+  std::map<cl_kernel, std::string> kernel_names;
+  std::map<cl_kernel, cl_uint> kernel_references;
+  std::map<cl_command_queue, cl_device_id> queue_devices;
+  std::map<cl_command_queue, cl_uint> queue_references;
+  uint32_t kernel_name_queries = 0;
+  uint32_t simd_width_queries = 0;
+  uint32_t queue_device_queries = 0;
+  uint32_t queue_properties_queries = 0;
+};
+
+FakeRuntime runtime;
+
+cl_int CL_API_CALL GetKernelSubGroupInfo(cl_kernel /*kernel*/, cl_device_id /*device*/,
+                                         cl_kernel_sub_group_info /*param_name*/,
+                                         size_t /*input_value_size*/, const void* /*input_value*/,
+                                         size_t param_value_size, void* param_value,
+                                         size_t* /*param_value_size_ret*/) {
+  EXPECT_EQ(param_value_size, sizeof(size_t));
+  runtime.simd_width_queries++;
+  *static_cast<size_t*>(param_value) = kSimdWidth;
+  return CL_SUCCESS;
+}
+
+template <typename T>
+cl_int ReturnValue(const T& value, size_t param_value_size, void* param_value) {
+  if (param_value_size < sizeof(T)) {
+    return CL_INVALID_VALUE;
+  }
+  std::memcpy(param_value, &value, sizeof(T));
+  return CL_SUCCESS;
+}
+
+}  // namespace
+
+cl_int CL_API_CALL clGetKernelInfo(cl_kernel kernel, cl_kernel_info param_name,
+                                   size_t param_value_size, void* param_value,
+                                   size_t* /*param_value_size_ret*/) {
+  auto references = runtime.kernel_references.find(kernel);
+  if (references == runtime.kernel_references.end()) {
+    return CL_INVALID_KERNEL;
+  }
+  if (param_name == CL_KERNEL_REFERENCE_COUNT) {
+    return ReturnValue(references->second, param_value_size, param_value);
+  }
+  if (param_name == CL_KERNEL_FUNCTION_NAME) {
+    runtime.kernel_name_queries++;
+    const std::string& name = runtime.kernel_names[kernel];
+    if (param_value_size <= name.size()) {
+      return CL_INVALID_VALUE;
+    }
+    std::memcpy(param_value, name.c_str(), name.size() + 1);
+    return CL_SUCCESS;
+  }
+  return CL_INVALID_VALUE;
+}
+
+cl_int CL_API_CALL clGetCommandQueueInfo(cl_command_queue queue, cl_command_queue_info param_name,
+                                         size_t param_value_size, void* param_value,
+                                         size_t* /*param_value_size_ret*/) {
+  auto references = runtime.queue_references.find(queue);
+  if (references == runtime.queue_references.end()) {
+    return CL_INVALID_COMMAND_QUEUE;
+  }
+  if (param_name == CL_QUEUE_REFERENCE_COUNT) {
+    return ReturnValue(references->second, param_value_size, param_value);
+  }
+  if (param_name == CL_QUEUE_DEVICE) {
+    runtime.queue_device_queries++;
+    return ReturnValue(runtime.queue_devices[queue], param_value_size, param_value);
+  }
+  if (param_name == CL_QUEUE_PROPERTIES) {
+    runtime.queue_properties_queries++;
+    cl_command_queue_properties properties = CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE;
+    return ReturnValue(properties, param_value_size, param_value);
+  }
+  return CL_INVALID_VALUE;
+}
+
+cl_int CL_API_CALL clGetDeviceInfo(cl_device_id /*device*/, cl_device_info param_name,
+                                   size_t param_value_size, void* param_value,
+                                   size_t* param_value_size_ret) {
+  if (param_name == CL_DEVICE_EXTENSIONS) {
+    if (param_value_size_ret != nullptr) {
+      *param_value_size_ret = sizeof(kExtensions);
+    }
+    if (param_value != nullptr) {
+      std::memcpy(param_value, kExtensions, std::min(param_value_size, sizeof(kExtensions)));
+    }
+    return CL_SUCCESS;
+  }
+  if (param_name == CL_DEVICE_PLATFORM) {
+    return ReturnValue(kPlatform, param_value_size, param_value);
+  }
+  return CL_INVALID_VALUE;
+}
+
+void* CL_API_CALL clGetExtensionFunctionAddressForPlatform(cl_platform_id platform,
+                                                           const char* func_name) {
+  EXPECT_EQ(platform, kPlatform);
+  EXPECT_STREQ(func_name, "clGetKernelSubGroupInfoKHR");
+  return reinterpret_cast<void*>(&GetKernelSubGroupInfo);
+}
+
+class ClKernelMetadataCacheTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    runtime = FakeRuntime();
+    CreateKernel(kKernel, "gemm");
+    CreateQueue(kQueue0, kDevice0);
+    CreateQueue(kQueue1, kDevice1);
+  }
+
+  static void CreateKernel(cl_kernel kernel, const std::string& name) {
+    runtime.kernel_names[kernel] = name;
+    runtime.kernel_references[kernel] = 1;
+  }
+
+  static void CreateQueue(cl_command_queue queue, cl_device_id device) {
+    runtime.queue_devices[queue] = device;
+    runtime.queue_references[queue] = 1;
+  }
+
+  // clReleaseKernel as the collector sees it: the reference count is read on enter, the
+  // kernel is gone on exit of the last release
+  void ReleaseKernel(cl_kernel kernel, cl_int result = CL_SUCCESS) {
+    bool last_reference = ClKernelMetadataCache::IsLastReference(kernel);
+    if (result == CL_SUCCESS && --runtime.kernel_references[kernel] == 0) {
+      runtime.kernel_references.erase(kernel);
+      runtime.kernel_names.erase(kernel);
+    }
+    cache_.OnKernelReleased(kernel, last_reference, result);
+  }
+
+  void ReleaseQueue(cl_command_queue queue) {
+    bool last_reference = ClKernelMetadataCache::IsLastReference(queue);
+    if (--runtime.queue_references[queue] == 0) {
+      runtime.queue_references.erase(queue);
+      runtime.queue_devices.erase(queue);
+    }
+    cache_.OnQueueReleased(queue, last_reference, CL_SUCCESS);
+  }
+
+  ClKernelMetadataCache cache_{false};
+};
+
+TEST_F(ClKernelMetadataCacheTest, QueriedOncePerKernelAndDevice) {
+  auto metadata = cache_.GetKernelMetadata(kKernel, kQueue0);
+  ASSERT_NE(metadata, nullptr);
+  EXPECT_EQ(metadata->name, "gemm");
+  EXPECT_EQ(metadata->simd_width, kSimdWidth);
+
+  for (int i = 0; i < 10; i++) {
+    EXPECT_EQ(cache_.GetKernelMetadata(kKernel, kQueue0), metadata);
+  }
+  EXPECT_EQ(runtime.kernel_name_queries, 1u);
+  EXPECT_EQ(runtime.simd_width_queries, 1u);
+  EXPECT_EQ(runtime.queue_device_queries, 1u);
+
+  // another queue of the same device shares the entry
+  const cl_command_queue queue = reinterpret_cast<cl_command_queue>(0x32);
+  CreateQueue(queue, kDevice0);
+  EXPECT_EQ(cache_.GetKernelMetadata(kKernel, queue), metadata);
+  EXPECT_EQ(runtime.kernel_name_queries, 1u);
+  EXPECT_EQ(runtime.queue_device_queries, 2u);
+
+  // SIMD width is per device
+  auto metadata1 = cache_.GetKernelMetadata(kKernel, kQueue1);
+  EXPECT_NE(metadata1, metadata);
+  EXPECT_EQ(cache_.GetKernelMetadata(kKernel, kQueue1), metadata1);
+  EXPECT_EQ(runtime.kernel_name_queries, 2u);
+  EXPECT_EQ(runtime.simd_width_queries, 2u);
+}
+
+TEST_F(ClKernelMetadataCacheTest, RetainReleasePairKeepsEntry) {
+  auto metadata = cache_.GetKernelMetadata(kKernel, kQueue0);
+
+  runtime.kernel_references[kKernel]++;  // clRetainKernel
+  ReleaseKernel(kKernel);
+
+  EXPECT_EQ(cache_.GetKernelMetadata(kKernel, kQueue0), metadata);
+  EXPECT_EQ(runtime.kernel_name_queries, 1u);
+}
+
+TEST_F(ClKernelMetadataCacheTest, FailedReleaseKeepsEntry) {
+  auto metadata = cache_.GetKernelMetadata(kKernel, kQueue0);
+
+  ReleaseKernel(kKernel, CL_INVALID_KERNEL);
+
+  EXPECT_EQ(cache_.GetKernelMetadata(kKernel, kQueue0), metadata);
+  EXPECT_EQ(runtime.kernel_name_queries, 1u);
+}
+
+TEST_F(ClKernelMetadataCacheTest, LastReleaseDropsEntriesOfAllDevices) {
+  auto metadata = cache_.GetKernelMetadata(kKernel, kQueue0);
+  cache_.GetKernelMetadata(kKernel, kQueue1);
+
+  ReleaseKernel(kKernel);
+
+  // instances in flight keep theirs
+  EXPECT_EQ(metadata->name, "gemm");
+
+  // the handle is reused by a new kernel, queried again on both devices
+  CreateKernel(kKernel, "relu");
+  EXPECT_EQ(cache_.GetKernelMetadata(kKernel, kQueue0)->name, "relu");
+  EXPECT_EQ(cache_.GetKernelMetadata(kKernel, kQueue1)->name, "relu");
+  EXPECT_EQ(runtime.kernel_name_queries, 4u);
+}
+
+TEST_F(ClKernelMetadataCacheTest, ReusedQueueHandleQueriedAgain) {
+  cache_.GetKernelMetadata(kKernel, kQueue0);
+  EXPECT_TRUE(cache_.IsQueueOutOfOrder(kQueue0));
+  EXPECT_TRUE(cache_.IsQueueOutOfOrder(kQueue0));
+  EXPECT_EQ(runtime.queue_properties_queries, 1u);
+
+  runtime.queue_references[kQueue0]++;  // clRetainCommandQueue
+  ReleaseQueue(kQueue0);
+  cache_.GetKernelMetadata(kKernel, kQueue0);
+  EXPECT_EQ(runtime.queue_device_queries, 1u);
+
+  // the handle is reused by a queue of the other device
+  ReleaseQueue(kQueue0);
+  CreateQueue(kQueue0, kDevice1);
+  cache_.GetKernelMetadata(kKernel, kQueue0);
+  EXPECT_EQ(runtime.queue_device_queries, 2u);
+  EXPECT_EQ(runtime.kernel_name_queries, 2u);
+  EXPECT_TRUE(cache_.IsQueueOutOfOrder(kQueue0));
+  EXPECT_EQ(runtime.queue_properties_queries, 2u);
+}
+
+TEST_F(ClKernelMetadataCacheTest, TransferMetadataPerCallSite) {
+  static const char kCopy[] = "clEnqueueCopyBuffer";
+  auto metadata = cache_.GetTransferMetadata(kCopy);
+  EXPECT_EQ(metadata->name, kCopy);
+  EXPECT_EQ(metadata->simd_width, 0u);
+  EXPECT_EQ(cache_.GetTransferMetadata(kCopy), metadata);
+}
@@ -53,6 +53,10 @@ void Usage() {
     "--chrome-device-stages         " <<
     "Dump device activities by stages to JSON file" <<
     std::endl;
+  std::cout <<
+    "--dependency-analysis          " <<
+    "Report per-queue concurrency, serialization points and dependency idle time" <<
+    std::endl;
   std::cout <<
     "--verbose [-v]                 " <<
     "Enable verbose mode to show more kernel information" <<
@@ -119,6 +123,9 @@ int ParseArgs(int argc, char* argv[]) {
     } else if (strcmp(argv[i], "--chrome-device-stages") == 0) {
       utils::SetEnv("CLT_ChromeDeviceStages", "1");
       ++app_index;
+    } else if (strcmp(argv[i], "--dependency-analysis") == 0) {
+      utils::SetEnv("CLT_DependencyAnalysis", "1");
+      ++app_index;
     } else if (strcmp(argv[i], "--verbose") == 0 ||
                strcmp(argv[i], "-v") == 0) {
       utils::SetEnv("CLT_Verbose", "1");
@@ -52,6 +52,10 @@ void Usage() {
     "--chrome-device-stages         " <<
     "Dump device activities by stages to JSON file" <<
     std::endl;
+  std::cout <<
+    "--perfetto-output              " <<
+    "Dump timeline to Perfetto protobuf file instead of JSON file" <<
+    std::endl;
   std::cout <<
     "--verbose [-v]                 " <<
     "Enable verbose mode to show more kernel information" <<
@@ -122,6 +126,9 @@ int ParseArgs(int argc, char* argv[]) {
     } else if (strcmp(argv[i], "--chrome-device-stages") == 0) {
       utils::SetEnv("ONETRACE_ChromeDeviceStages", "1");
       ++app_index;
+    } else if (strcmp(argv[i], "--perfetto-output") == 0) {
+      utils::SetEnv("ONETRACE_PerfettoOutput", "1");
+      ++app_index;
     } else if (strcmp(argv[i], "--verbose") == 0 ||
                strcmp(argv[i], "-v") == 0) {
       utils::SetEnv("ONETRACE_Verbose", "1");
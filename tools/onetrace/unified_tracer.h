@@ -20,6 +20,7 @@
 #include "cl_api_collector.h"
 #include "cl_api_callbacks.h"
 #include "cl_kernel_collector.h"
+#include "perfetto_writer.h"
 #include "trace_options.h"
 #include "utils.h"
 #include "ze_api_collector.h"
@@ -272,6 +273,12 @@ class UnifiedTracer {
       std::cerr << "[INFO] Timeline was stored to " <<
         chrome_trace_file_name_ << std::endl;
     }
+
+    if (perfetto_writer_ != nullptr) {
+      delete perfetto_writer_;
+      std::cerr << "[INFO] Timeline was stored to " <<
+        chrome_trace_file_name_ << std::endl;
+    }
   }
 
   bool CheckOption(uint32_t option) {
@@ -295,33 +302,57 @@ class UnifiedTracer {
         CheckOption(TRACE_CHROME_DEVICE_TIMELINE) ||
         CheckOption(TRACE_CHROME_KERNEL_TIMELINE) ||
         CheckOption(TRACE_CHROME_DEVICE_STAGES)) {
-      chrome_trace_file_name_ =
-        TraceOptions::GetChromeTraceFileName(kChromeTraceFileName);
-      chrome_logger_ = new Logger(chrome_trace_file_name_.c_str());
-      PTI_ASSERT(chrome_logger_ != nullptr);
-
-      std::stringstream stream;
-      stream << "[" << std::endl;
-      stream << "{\"ph\":\"M\", \"name\":\"process_name\", \"pid\":\"" <<
-        utils::GetPid() << "\", \"args\":{\"name\":\"" <<
-        utils::GetExecutableName() << "\"}}," << std::endl;
-
-      stream << "{\"ph\":\"M\", \"name\":\"start_time\", \"pid\":\"" <<
-        utils::GetPid() << "\", \"args\":{";
+      if (utils::GetEnv("ONETRACE_PerfettoOutput") == "1") {
+        chrome_trace_file_name_ = TraceOptions::GetChromeTraceFileName(
+            kChromeTraceFileName, kPerfettoTraceFileExt);
+        // timestamps are written on the clock of the start point, i.e.,
+        // CLOCK_MONOTONIC_RAW, QueryPerformanceCounter has no Perfetto clock
+        perfetto_writer_ = new PerfettoWriter(chrome_trace_file_name_,
 #if defined(_WIN32)
-      stream << "\"QueryPerformanceCounter\":\"" <<
-        correlator_.GetStartPoint() << "\"";
+            perfetto_proto::kBuiltinClockMonotonic);
 #else
-      stream << "\"CLOCK_MONOTONIC_RAW\":\"" <<
-        correlator_.GetStartPoint() << "\", ";
-      stream << "\"CLOCK_MONOTONIC\":\"" <<
-        monotonic_time << "\", ";
-      stream << "\"CLOCK_REALTIME\":\"" <<
-        real_time << "\"";
+            perfetto_proto::kBuiltinClockMonotonicRaw);
 #endif
-      stream << "}}," << std::endl;
+        PTI_ASSERT(perfetto_writer_ != nullptr);
+        perfetto_process_track_ = perfetto_writer_->AddProcessTrack(
+            utils::GetPid(), utils::GetExecutableName());
+#if !defined(_WIN32)
+        // start time anchors of the JSON trace
+        perfetto_writer_->AddClockSnapshot({
+            {perfetto_proto::kBuiltinClockMonotonicRaw,
+             correlator_.GetStartPoint()},
+            {perfetto_proto::kBuiltinClockMonotonic, monotonic_time},
+            {perfetto_proto::kBuiltinClockRealtime, real_time}});
+#endif
+      } else {
+        chrome_trace_file_name_ =
+          TraceOptions::GetChromeTraceFileName(kChromeTraceFileName);
+        chrome_logger_ = new Logger(chrome_trace_file_name_.c_str());
+        PTI_ASSERT(chrome_logger_ != nullptr);
+
+        std::stringstream stream;
+        stream << "[" << std::endl;
+        stream << "{\"ph\":\"M\", \"name\":\"process_name\", \"pid\":\"" <<
+          utils::GetPid() << "\", \"args\":{\"name\":\"" <<
+          utils::GetExecutableName() << "\"}}," << std::endl;
+
+        stream << "{\"ph\":\"M\", \"name\":\"start_time\", \"pid\":\"" <<
+          utils::GetPid() << "\", \"args\":{";
+#if defined(_WIN32)
+        stream << "\"QueryPerformanceCounter\":\"" <<
+          correlator_.GetStartPoint() << "\"";
+#else
+        stream << "\"CLOCK_MONOTONIC_RAW\":\"" <<
+          correlator_.GetStartPoint() << "\", ";
+        stream << "\"CLOCK_MONOTONIC\":\"" <<
+          monotonic_time << "\", ";
+        stream << "\"CLOCK_REALTIME\":\"" <<
+          real_time << "\"";
+#endif
+        stream << "}}," << std::endl;
 
-      chrome_logger_->Log(stream.str());
+        chrome_logger_->Log(stream.str());
+      }
     }
     if (CheckOption(TRACE_DEVICE_TIMELINE)) {
       std::stringstream stream;
@@ -726,6 +757,11 @@ class UnifiedTracer {
     UnifiedTracer* tracer = reinterpret_cast<UnifiedTracer*>(data);
     PTI_ASSERT(tracer != nullptr);
 
+    if (tracer->perfetto_writer_ != nullptr) {
+      tracer->LogPerfettoSlice(queue, name, id, started, ended);
+      return;
+    }
+
     std::stringstream stream;
     stream << "{\"ph\":\"X\", \"pid\":\"" << utils::GetPid() <<
       "\", \"tid\":\"" << queue <<
@@ -751,6 +787,11 @@ class UnifiedTracer {
     UnifiedTracer* tracer = reinterpret_cast<UnifiedTracer*>(data);
     PTI_ASSERT(tracer != nullptr);
 
+    if (tracer->perfetto_writer_ != nullptr) {
+      tracer->LogPerfettoSlice(queue, name, id, started, ended);
+      return;
+    }
+
     std::stringstream stream;
     stream << "{\"ph\":\"X\", \"pid\":\"" << utils::GetPid() <<
       "\", \"tid\":\"" << queue <<
@@ -776,6 +817,11 @@ class UnifiedTracer {
     UnifiedTracer* tracer = reinterpret_cast<UnifiedTracer*>(data);
     PTI_ASSERT(tracer != nullptr);
 
+    if (tracer->perfetto_writer_ != nullptr) {
+      tracer->LogPerfettoSlice(name, name, id, started, ended);
+      return;
+    }
+
     std::stringstream stream;
     stream << "{\"ph\":\"X\", \"pid\":\"" << utils::GetPid() <<
       "\", \"tid\":\"" << name <<
@@ -801,6 +847,11 @@ class UnifiedTracer {
     UnifiedTracer* tracer = reinterpret_cast<UnifiedTracer*>(data);
     PTI_ASSERT(tracer != nullptr);
 
+    if (tracer->perfetto_writer_ != nullptr) {
+      tracer->LogPerfettoSlice(name, name, id, started, ended);
+      return;
+    }
+
     std::stringstream stream;
     stream << "{\"ph\":\"X\", \"pid\":\"" << utils::GetPid() <<
       "\", \"tid\":\"" << name <<
@@ -825,11 +876,19 @@ class UnifiedTracer {
       uint64_t ended) {
     UnifiedTracer* tracer = reinterpret_cast<UnifiedTracer*>(data);
     PTI_ASSERT(tracer != nullptr);
-    PTI_ASSERT(tracer->chrome_logger_ != nullptr);
-    std::stringstream stream;
 
     std::string tid = id + "." + queue;
 
+    if (tracer->perfetto_writer_ != nullptr) {
+      tracer->LogPerfettoSlice(tid, name + " (Appended)", id, appended, submitted);
+      tracer->LogPerfettoSlice(tid, name + " (Submitted)", id, submitted, started);
+      tracer->LogPerfettoSlice(tid, name + " (Executed)", id, started, ended);
+      return;
+    }
+
+    PTI_ASSERT(tracer->chrome_logger_ != nullptr);
+    std::stringstream stream;
+
     PTI_ASSERT(submitted >= appended);
     stream << "{\"ph\":\"X\", \"pid\":\"" << utils::GetPid() <<
       "\", \"tid\":\"" << tid <<
@@ -877,11 +936,19 @@ class UnifiedTracer {
       uint64_t ended) {
     UnifiedTracer* tracer = reinterpret_cast<UnifiedTracer*>(data);
     PTI_ASSERT(tracer != nullptr);
-    PTI_ASSERT(tracer->chrome_logger_ != nullptr);
-    std::stringstream stream;
 
     std::string tid = id + "." + queue;
 
+    if (tracer->perfetto_writer_ != nullptr) {
+      tracer->LogPerfettoSlice(tid, name + " (Queued)", id, queued, submitted);
+      tracer->LogPerfettoSlice(tid, name + " (Submitted)", id, submitted, started);
+      tracer->LogPerfettoSlice(tid, name + " (Executed)", id, started, ended);
+      return;
+    }
+
+    PTI_ASSERT(tracer->chrome_logger_ != nullptr);
+    std::stringstream stream;
+
     PTI_ASSERT(submitted > queued);
     stream << "{\"ph\":\"X\", \"pid\":\"" << utils::GetPid() <<
       "\", \"tid\":\"" << tid <<
@@ -929,6 +996,14 @@ class UnifiedTracer {
       uint64_t ended) {
     UnifiedTracer* tracer = reinterpret_cast<UnifiedTracer*>(data);
     PTI_ASSERT(tracer != nullptr);
+
+    if (tracer->perfetto_writer_ != nullptr) {
+      tracer->LogPerfettoSlice(name, name + " (Appended)", id, appended, submitted);
+      tracer->LogPerfettoSlice(name, name + " (Submitted)", id, submitted, started);
+      tracer->LogPerfettoSlice(name, name + " (Executed)", id, started, ended);
+      return;
+    }
+
     PTI_ASSERT(tracer->chrome_logger_ != nullptr);
     std::stringstream stream;
 
@@ -979,6 +1054,14 @@ class UnifiedTracer {
       uint64_t ended) {
     UnifiedTracer* tracer = reinterpret_cast<UnifiedTracer*>(data);
     PTI_ASSERT(tracer != nullptr);
+
+    if (tracer->perfetto_writer_ != nullptr) {
+      tracer->LogPerfettoSlice(name, name + " (Queued)", id, queued, submitted);
+      tracer->LogPerfettoSlice(name, name + " (Submitted)", id, submitted, started);
+      tracer->LogPerfettoSlice(name, name + " (Executed)", id, started, ended);
+      return;
+    }
+
     PTI_ASSERT(tracer->chrome_logger_ != nullptr);
     std::stringstream stream;
 
@@ -1144,6 +1227,11 @@ class UnifiedTracer {
     UnifiedTracer* tracer = reinterpret_cast<UnifiedTracer*>(data);
     PTI_ASSERT(tracer != nullptr);
 
+    if (tracer->perfetto_writer_ != nullptr) {
+      tracer->LogPerfettoHostSlice(name, id, started, ended);
+      return;
+    }
+
     std::stringstream stream;
     stream << "{\"ph\":\"X\", \"pid\":\"" <<
       utils::GetPid() << "\", \"tid\":\"" << utils::GetTid() <<
@@ -1163,6 +1251,11 @@ class UnifiedTracer {
     UnifiedTracer* tracer = reinterpret_cast<UnifiedTracer*>(data);
     PTI_ASSERT(tracer != nullptr);
 
+    if (tracer->perfetto_writer_ != nullptr) {
+      tracer->LogPerfettoHostSlice(name, std::to_string(id), started, ended);
+      return;
+    }
+
     std::stringstream stream;
     stream << "{\"ph\":\"X\", \"pid\":\"" <<
       utils::GetPid() << "\", \"tid\":\"" << utils::GetTid() <<
@@ -1176,6 +1269,33 @@ class UnifiedTracer {
     tracer->chrome_logger_->Log(stream.str());
   }
 
+  // Device activities are on tracks of the process named as threads in JSON,
+  // i.e., after the queue, the kernel or the kernel instance. Timestamps are
+  // from the start point as in JSON, the trace has them absolute
+  void LogPerfettoSlice(
+      const std::string& track_name, const std::string& name,
+      const std::string& id, uint64_t started, uint64_t ended) {
+    PTI_ASSERT(perfetto_writer_ != nullptr);
+    uint64_t track = perfetto_writer_->AddTrack(
+        track_name, perfetto_process_track_);
+    uint64_t start_point = correlator_.GetStartPoint();
+    perfetto_writer_->AddSlice(
+        track, std::string(), name, start_point + started,
+        start_point + ended, {{"id", id}});
+  }
+
+  void LogPerfettoHostSlice(
+      const std::string& name, const std::string& id,
+      uint64_t started, uint64_t ended) {
+    PTI_ASSERT(perfetto_writer_ != nullptr);
+    uint64_t track = perfetto_writer_->AddThreadTrack(
+        utils::GetPid(), utils::GetTid());
+    uint64_t start_point = correlator_.GetStartPoint();
+    perfetto_writer_->AddSlice(
+        track, std::string(), name, start_point + started,
+        start_point + ended, {{"id", id}});
+  }
+
  private:
   TraceOptions options_;
 
@@ -1192,6 +1312,8 @@ class UnifiedTracer {
 
   std::string chrome_trace_file_name_;
   Logger* chrome_logger_ = nullptr;
+  PerfettoWriter* perfetto_writer_ = nullptr;
+  uint64_t perfetto_process_track_ = 0;
 };
 
 #endif // PTI_TOOLS_ONETRACE_UNIFIED_TRACER_H_
\ No newline at end of file
@@ -244,7 +244,7 @@ def get_enum_map(include_path):
 
 # Generate Callbacks ##########################################################
 
-def gen_api(f, func_list, kfunc_list, group_map):
+def gen_api(f, func_list, kfunc_list, mfunc_list, group_map):
   f.write("void EnableTracing(zel_tracer_handle_t tracer) {\n")
   f.write("  zet_core_callbacks_t prologue = {};\n")
   f.write("  zet_core_callbacks_t epilogue = {};\n")
@@ -262,8 +262,10 @@ def gen_api(f, func_list, kfunc_list, group_map):
     callback_cond = callback[1]
     if callback_cond:
       f.write("#if " + callback_cond + "\n")
-    f.write("    prologue." + group_name + "." + callback_name + " = " + func + "OnEnter;\n")
-    f.write("    epilogue." + group_name + "." + callback_name + " = " + func + "OnExit;\n")
+    f.write("    if (" + get_api_filter_condition(func, kfunc_list) + ") {\n")
+    f.write("      prologue." + group_name + "." + callback_name + " = " + func + "OnEnter;\n")
+    f.write("      epilogue." + group_name + "." + callback_name + " = " + func + "OnExit;\n")
+    f.write("    }\n")
     if callback_cond:
       f.write("#endif //" + callback_cond + "\n")
   f.write("  }\n")
@@ -286,6 +288,25 @@ def gen_api(f, func_list, kfunc_list, group_map):
       f.write("#endif //" + callback_cond + "\n")
   f.write("  }\n")
   f.write("\n")
+  f.write("  if (options_.memory_tracking) {\n")
+  for func in mfunc_list:
+    if not func in group_map:
+      continue
+
+    group, callback = group_map[func]
+    group_name = group[0]
+    group_cond = group[1]
+    assert not group_cond
+    callback_name = callback[0]
+    callback_cond = callback[1]
+    if callback_cond:
+      f.write("#if " + callback_cond + "\n")
+    f.write("    prologue." + group_name + "." + callback_name + " = " + func + "OnEnter;\n")
+    f.write("    epilogue." + group_name + "." + callback_name + " = " + func + "OnExit;\n")
+    if callback_cond:
+      f.write("#endif //" + callback_cond + "\n")
+  f.write("  }\n")
+  f.write("\n")
   f.write("  ze_result_t status = ZE_RESULT_SUCCESS;\n")
   f.write("  status = zelTracerSetPrologues(tracer, &prologue);\n")
   f.write("  PTI_ASSERT(status == ZE_RESULT_SUCCESS);\n")
@@ -355,7 +376,19 @@ def get_kernel_tracing_callback(func):
     fp.close()
     return cb
 
-def gen_enter_callback(f, func, command_list_func_list, command_queue_func_list, synchronize_func_list, params, enum_map):
+def get_tracing_callback_condition(func, memory_func_list):
+  if (func in memory_func_list):
+    return "collector->options_.memory_tracking"
+  return "collector->options_.kernel_tracing"
+
+# APIs excluded by --include-apis/--exclude-apis are not registered unless
+# they are needed for kernel tracing
+def get_api_filter_condition(func, kfunc_list):
+  if (func in kfunc_list):
+    return "options_.kernel_tracing || UniController::IsApiEnabled(" + func[2:] + "TracingId)"
+  return "UniController::IsApiEnabled(" + func[2:] + "TracingId)"
+
+def gen_enter_callback(f, func, command_list_func_list, command_queue_func_list, synchronize_func_list, memory_func_list, params, enum_map):
   f.write("  ZeCollector* collector =\n")
   f.write("    reinterpret_cast<ZeCollector*>(global_user_data);\n")
 
@@ -365,7 +398,7 @@ def gen_enter_callback(f, func, command_list_func_list, command_queue_func_list,
   f.write("\n")
   cb = get_kernel_tracing_callback('OnEnter' + func[2:])
   if (cb != ""):
-    f.write("  if (collector->options_.kernel_tracing) { \n")
+    f.write("  if (" + get_tracing_callback_condition(func, memory_func_list) + ") { \n")
     if (func in synchronize_func_list):
       f.write("    " + cb + "(params, global_user_data, instance_user_data, &kids); \n")
       f.write("    if (kids.size() != 0) {\n")
@@ -378,6 +411,11 @@ def gen_enter_callback(f, func, command_list_func_list, command_queue_func_list,
       f.write("    " + cb + "(params, global_user_data, instance_user_data); \n")
     f.write("  }\n")
     f.write("\n")
+  f.write("  if (!UniController::IsApiEnabled(" + func[2:] + "TracingId)) {\n")
+  f.write("    ze_instance_data.start_time_host = 0; \n")
+  f.write("    return;\n")
+  f.write("  }\n")
+  f.write("\n")
   f.write("  PTI_ASSERT(collector->correlator_ != nullptr);\n")
   f.write("\n")
   f.write("  if (!UniController::IsCollectionEnabled()) {\n")
@@ -660,13 +698,15 @@ def gen_enter_callback(f, func, command_list_func_list, command_queue_func_list,
 
   f.write("  ze_instance_data.start_time_host = start_time_host;\n")
 
-def gen_exit_callback(f, func, submission_func_list, synchronize_func_list_on_enter, synchronize_func_list_on_exit, params, enum_map):
+def gen_exit_callback(f, func, submission_func_list, synchronize_func_list_on_enter, synchronize_func_list_on_exit, memory_func_list, params, enum_map):
   f.write("  ZeCollector* collector =\n")
   f.write("    reinterpret_cast<ZeCollector*>(global_user_data);\n")
 
   f.write("  uint64_t end_time_host = 0;\n")
 
-  f.write("  end_time_host = UniTimer::GetHostTimestamp();\n")
+  f.write("  if (UniController::IsApiEnabled(" + func[2:] + "TracingId)) {\n")
+  f.write("    end_time_host = UniTimer::GetHostTimestamp();\n")
+  f.write("  }\n")
 
   cb = get_kernel_tracing_callback('OnExit' + func[2:])
 
@@ -679,7 +719,7 @@ def gen_exit_callback(f, func, submission_func_list, synchronize_func_list_on_en
     f.write("  }\n")
 
   if (cb != ""):
-    f.write("  if (collector->options_.kernel_tracing) { \n")
+    f.write("  if (" + get_tracing_callback_condition(func, memory_func_list) + ") { \n")
     if ((func in submission_func_list) or (func in synchronize_func_list_on_exit)):
       f.write("    " + cb + "(params, result, global_user_data, instance_user_data, &kids); \n")
     else:
@@ -688,6 +728,10 @@ def gen_exit_callback(f, func, submission_func_list, synchronize_func_list_on_en
 
     f.write("\n")
 
+  f.write("  if (!UniController::IsApiEnabled(" + func[2:] + "TracingId)) {\n")
+  f.write("    return;\n")
+  f.write("  }\n")
+  f.write("\n")
   f.write("  PTI_ASSERT(collector->correlator_ != nullptr);\n")
   f.write("\n")
   f.write("  if (!UniController::IsCollectionEnabled()) {\n")
@@ -828,7 +872,7 @@ def gen_exit_callback(f, func, submission_func_list, synchronize_func_list_on_en
     f.write("          start_time_host, end_time_host);\n")
   f.write("  }\n")
 
-def gen_callbacks(f, func_list, command_list_func_list, command_queue_func_list, submission_func_list, synchronize_func_list_on_enter, synchronize_func_list_on_exit, group_map, param_map, enum_map):
+def gen_callbacks(f, func_list, command_list_func_list, command_queue_func_list, submission_func_list, synchronize_func_list_on_enter, synchronize_func_list_on_exit, memory_func_list, group_map, param_map, enum_map):
   for func in func_list:
     if not func in group_map:
       continue
@@ -844,7 +888,7 @@ def gen_callbacks(f, func_list, command_list_func_list, command_queue_func_list,
     f.write("    ze_result_t result,\n")
     f.write("    void* global_user_data,\n")
     f.write("    void** instance_user_data) {\n")
-    gen_enter_callback(f, func, command_list_func_list, command_queue_func_list, synchronize_func_list_on_enter, param_map[func], enum_map)
+    gen_enter_callback(f, func, command_list_func_list, command_queue_func_list, synchronize_func_list_on_enter, memory_func_list, param_map[func], enum_map)
     f.write("}\n")
     f.write("\n")
     f.write("static void " + func + "OnExit(\n")
@@ -852,7 +896,7 @@ def gen_callbacks(f, func_list, command_list_func_list, command_queue_func_list,
     f.write("    ze_result_t result,\n")
     f.write("    void* global_user_data,\n")
     f.write("    void** instance_user_data) {\n")
-    gen_exit_callback(f, func, submission_func_list, synchronize_func_list_on_enter, synchronize_func_list_on_exit, param_map[func], enum_map)
+    gen_exit_callback(f, func, submission_func_list, synchronize_func_list_on_enter, synchronize_func_list_on_exit, memory_func_list, param_map[func], enum_map)
     f.write("}\n")
     if callback_cond:
       f.write("#endif //" + callback_cond + "\n")
@@ -951,14 +995,20 @@ def main():
       "zeFenceHostSynchronize",
       "zeCommandQueueSynchronize"]
 
+  memory_func_list = [
+      "zeMemAllocDevice",
+      "zeMemAllocHost",
+      "zeMemAllocShared",
+      "zeMemFree"]
+
   group_map = get_callback_group_map(l0_file)
   param_map = get_param_map(l0_file)
   enum_map = get_enum_map(l0_path)
 
   gen_result_converter(dst_file, enum_map)
   gen_structure_type_converter(dst_file, enum_map)
-  gen_callbacks(dst_file, func_list, command_list_func_list, command_queue_func_list, submission_func_list, synchronize_func_list_on_enter, synchronize_func_list_on_exit, group_map, param_map, enum_map)
-  gen_api(dst_file, func_list, kfunc_list, group_map)
+  gen_callbacks(dst_file, func_list, command_list_func_list, command_queue_func_list, submission_func_list, synchronize_func_list_on_enter, synchronize_func_list_on_exit, memory_func_list, group_map, param_map, enum_map)
+  gen_api(dst_file, func_list, kfunc_list, memory_func_list, group_map)
 
   l0_file.close()
   dst_file.close()
@@ -88,6 +88,15 @@ def gen_enums(out_file, l0_func_list, ocl_func_list):
   #itt api id
   out_file.write("  IttTracingId,\n");
 
+  #memory usage counter id
+  out_file.write("  MemTracingId,\n");
+
+  #cpu sample id
+  out_file.write("  CpuSampleTracingId,\n");
+
+  #number of ids, used to size the API enable bitset
+  out_file.write("  EndTracingId,\n");
+
   #footer
   out_file.write("} API_TRACING_ID;")
 
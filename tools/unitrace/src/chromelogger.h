@@ -18,10 +18,12 @@
 #include <thread>
 #include <tuple>
 #include "trace_options.h"
+#include "perfetto_writer.h"
 #include "unitimer.h"
 #include "unikernel.h"
 #include "unievent.h"
 #include "unimemory.h"
+#include "trace_event_slices.h"
 
 #include "opencl/cl_ext_collector.h"
 
@@ -46,6 +48,7 @@ ze_pci_ext_properties_t *GetZeDevicePciPropertiesAndId(ze_device_handle_t device
 std::string GetClKernelCommandName(uint64_t id);
 
 static Logger* logger_ = nullptr;
+static PerfettoWriter* perfetto_writer_ = nullptr;	// timeline is written in Perfetto format instead of JSON if set
 
 constexpr unsigned char cpu_op = 0;
 constexpr unsigned char gpu_op = 1;
@@ -70,9 +73,64 @@ typedef struct TraceDataPacket_ {
   std::string cname;
   uint64_t ts;
   uint64_t dur;
+  uint64_t start_ns;	// Perfetto output keeps the ns precision lost in ts and dur
+  uint64_t end_ns;	// set for complete events only
   std::string args;
   API_TRACING_ID api_id;
 
+  /*
+   * ResolveName(): replaces API ids with API names and demangles OpenCL kernel names
+   */
+  void ResolveName() {
+    if (api_id == ClKernelTracingId) {
+      name = utils::Demangle(name.data());
+    }
+    else {
+      if ((cl_ext_api_id)api_id > clExtApiIdStartTraceId && (cl_ext_api_id)api_id < clExtApiIdEndTraceId) {
+        name = cl_ext_api_id_name[api_id - clExtApiIdStartTraceId - 1];
+      } else if ((api_id != OpenClTracingId) && (api_id != XptiTracingId) && (api_id != IttTracingId) && (api_id != MemTracingId) && (api_id != CpuSampleTracingId) && (api_id != ZeKernelTracingId)) {
+        // L0 kernel names are already demanged/
+        name = get_symbol(api_id);
+      }
+    }
+  }
+
+  /*
+   * GetCategoryName(): category without flow id, nullptr if unknown
+   */
+  const char *GetCategoryName() const {
+    switch (cat) {
+      case cpu_op:
+        return "cpu_op";
+      case gpu_op:
+        return "gpu_op";
+      case data_flow:
+        return "Flow_H2D";
+      case data_flow_sync:
+        return "Flow_D2H";
+      case cl_data_flow:
+        return "CL_Flow_H2D";
+      case cl_data_flow_sync:
+        return "CL_Flow_D2H";
+      default:
+        return nullptr;
+    }
+  }
+
+  /*
+   * GetCategory(): category with flow id and rank for flow events, empty if unknown
+   */
+  std::string GetCategory() const {
+    const char *category = GetCategoryName();
+    if (category == nullptr) {
+      return std::string();
+    }
+    if ((cat == cpu_op) || (cat == gpu_op)) {
+      return category;
+    }
+    return std::string(category) + "_" + std::to_string(id) + "_" + std::to_string(rank);
+  }
+
   /*
    * Stringify(): creates json format of string from the traceDataPacket
    */
@@ -86,17 +144,7 @@ typedef struct TraceDataPacket_ {
     str += ", \"tid\": " + std::to_string(tid);
     str += ", \"pid\": " + std::to_string(pid);
 
-    if (api_id == ClKernelTracingId) {
-      name = utils::Demangle(name.data());
-    }
-    else {
-      if ((cl_ext_api_id)api_id > clExtApiIdStartTraceId && (cl_ext_api_id)api_id < clExtApiIdEndTraceId) {
-        name = cl_ext_api_id_name[api_id - clExtApiIdStartTraceId - 1];
-      } else if ((api_id != OpenClTracingId) && (api_id != XptiTracingId) && (api_id != IttTracingId) && (api_id != ZeKernelTracingId)) {
-        // L0 kernel names are already demanged/
-        name = get_symbol(api_id);
-      }
-    }
+    ResolveName();
     if (!name.empty()) {
       if (name[0] == '\"') {
         // name is already quoted
@@ -116,23 +164,9 @@ typedef struct TraceDataPacket_ {
       }
     }
 
-    if (cat == cpu_op) {
-      str += ", \"cat\": \"cpu_op\"";
-    }
-    else if (cat == gpu_op) {
-      str += ", \"cat\": \"gpu_op\"";
-    }
-    else if (cat == data_flow) {
-      str += ", \"cat\": \"Flow_H2D_" + std::to_string(id) + "_" + std::to_string(rank) + "\"";
-    }
-    else if (cat == data_flow_sync) {
-      str += ", \"cat\": \"Flow_D2H_" + std::to_string(id) + "_" + std::to_string(rank) + "\"";
-    }
-    else if (cat == cl_data_flow) {
-      str += ", \"cat\": \"CL_Flow_H2D_" + std::to_string(id) + "_" + std::to_string(rank) + "\"";
-    }
-    else if (cat == cl_data_flow_sync) {
-      str += ", \"cat\": \"CL_Flow_D2H_" + std::to_string(id) + "_" + std::to_string(rank) + "\"";
+    std::string category = GetCategory();
+    if (!category.empty()) {
+      str += ", \"cat\": \"" + category + "\"";
     }
 
     // It is always present
@@ -194,6 +228,52 @@ struct ZeDeviceTidKeyCompare {
 
 static std::map<ZeDeviceTidKey, std::tuple<uint32_t, uint32_t, uint64_t>, ZeDeviceTidKeyCompare> device_tid_map_;
 
+// Perfetto tracks of device engines or queues by device pid and tid
+static std::map<std::tuple<uint32_t, uint32_t>, uint64_t> perfetto_device_tracks_;
+
+static std::string GetHostProcessName(void) {
+  if (rank.empty()) {
+    return "HOST<" + pmi_hostname + ">";
+  }
+  return "RANK " + std::to_string(mpi_rank) + " HOST<" + pmi_hostname + ">";
+}
+
+static std::string GetDeviceProcessName(uint32_t domain, uint32_t bus, uint32_t device, uint32_t function) {
+  std::string name;
+  if (rank.empty()) {
+    name = "DEVICE<" + pmi_hostname + ">";
+  }
+  else {
+    name = "RANK " + std::to_string(mpi_rank) + " DEVICE<" + pmi_hostname + ">";
+  }
+
+  char str[128];
+  snprintf(str, sizeof(str), "%x:%x:%x:%x", domain, bus, device, function);
+  return name + str;
+}
+
+static std::string GetZeDeviceProcessName(const ZeDevicePidKey& key) {
+  std::string name = GetDeviceProcessName(key.pci_addr_.domain, key.pci_addr_.bus, key.pci_addr_.device, key.pci_addr_.function);
+  if (key.parent_device_id_ >= 0) {
+    name += " #" + std::to_string(key.parent_device_id_) + "." + std::to_string(key.subdevice_id_);
+  }
+  else {
+    name += " #" + std::to_string(key.device_id_);
+  }
+  return name;
+}
+
+static std::string GetZeDeviceThreadName(const ZeDeviceTidKey& key) {
+  std::string name = "L0";
+  if (!device_logging_no_engine_) {
+    name += " Engine<" + std::to_string(key.engine_ordinal_) + "," + std::to_string(key.engine_index_) + ">";
+  }
+  if (device_logging_no_thread_) {
+    return name;
+  }
+  return "Thread " + std::to_string(key.host_tid_) + " " + name;
+}
+
 static uint32_t next_device_pid_ = (uint32_t)(~0) - (mpi_rank * (1 << 13));	// each rank has no more than (1 << 13) threads
 static uint32_t next_device_tid_ = (uint32_t)(~0) - (mpi_rank * (1 << 13));    // each rank has no more than (1 << 13) threads
 
@@ -256,6 +336,11 @@ static std::tuple<uint32_t, uint32_t> GetDevicePidTid(ze_device_handle_t device,
     device_tid = next_device_tid_--;
     auto start_time = UniTimer::GetEpochTimeInUs(UniTimer::GetHostTimestamp());
     device_tid_map_.insert({tid_key, std::make_tuple(device_pid, device_tid,start_time)});
+
+    if (perfetto_writer_ != nullptr) {
+      uint64_t device_track = perfetto_writer_->AddTrack(GetZeDeviceProcessName(pid_key));
+      perfetto_device_tracks_[std::make_tuple(device_pid, device_tid)] = perfetto_writer_->AddTrack(GetZeDeviceThreadName(tid_key), device_track);
+    }
   }
 
   return std::tuple<uint32_t, uint32_t>(device_pid, device_tid);
@@ -289,6 +374,24 @@ struct ClDeviceTidKeyCompare {
 
 static std::map<ClDeviceTidKey, std::tuple<uint32_t, uint32_t, uint64_t>, ClDeviceTidKeyCompare> cl_device_tid_map_;
 
+static std::string GetClDeviceProcessName(const ClDevicePidKey& key) {
+  return GetDeviceProcessName(key.pci_addr_.pci_domain, key.pci_addr_.pci_bus, key.pci_addr_.pci_device, key.pci_addr_.pci_function);
+}
+
+static std::string GetClDeviceThreadName(const ClDeviceTidKey& key) {
+  std::string name = "CL";
+  if (!device_logging_no_engine_) {
+    char str[128];
+
+    snprintf(str, sizeof(str), "%p", key.queue_);
+    name += " Queue<" + std::string(str) + ">";
+  }
+  if (device_logging_no_thread_) {
+    return name;
+  }
+  return "Thread " + std::to_string(key.host_tid_) + " " + name;
+}
+
 static std::tuple<uint32_t, uint32_t> ClGetDevicePidTid(cl_device_pci_bus_info_khr& pci, cl_device_id device, cl_command_queue queue, int host_pid, int host_tid) {
   if (device_logging_no_thread_) {
     // map all threads to the process
@@ -333,46 +436,140 @@ static std::tuple<uint32_t, uint32_t> ClGetDevicePidTid(cl_device_pci_bus_info_k
     device_tid = next_device_tid_--;
     auto start_time = UniTimer::GetEpochTimeInUs(UniTimer::GetHostTimestamp());
     cl_device_tid_map_.insert({tid_key, std::make_tuple(device_pid, device_tid, start_time)});
+
+    if (perfetto_writer_ != nullptr) {
+      uint64_t device_track = perfetto_writer_->AddTrack(GetClDeviceProcessName(pid_key));
+      perfetto_device_tracks_[std::make_tuple(device_pid, device_tid)] = perfetto_writer_->AddTrack(GetClDeviceThreadName(tid_key), device_track);
+    }
   }
 
   return std::tuple<uint32_t, uint32_t>(device_pid, device_tid);
 }
 
+// Arguments of a packet, e.g., "id": "1", as Perfetto debug annotations
+static PerfettoArgs GetPerfettoArgs(const std::string& args) {
+  PerfettoArgs result;
+  size_t pos = 0;
+  while ((pos = args.find('\"', pos)) != std::string::npos) {
+    size_t end = args.find('\"', pos + 1);
+    if (end == std::string::npos) {
+      break;
+    }
+    std::string key = args.substr(pos + 1, end - pos - 1);
+    pos = args.find(':', end);
+    if (pos == std::string::npos) {
+      break;
+    }
+    pos = args.find_first_not_of(' ', pos + 1);
+    if (pos == std::string::npos) {
+      break;
+    }
+
+    std::string value;
+    if (args[pos] == '\"') {
+      end = args.find('\"', pos + 1);
+      if (end == std::string::npos) {
+        end = args.size();
+      }
+      value = args.substr(pos + 1, end - pos - 1);
+      pos = end + 1;
+    }
+    else {
+      end = args.find(',', pos);
+      if (end == std::string::npos) {
+        end = args.size();
+      }
+      value = args.substr(pos, end - pos);
+      pos = end;
+    }
+    result.emplace_back(std::move(key), std::move(value));
+  }
+  return result;
+}
+
+static void LogPerfettoEvent(TraceDataPacket& pkt) {
+  uint64_t track = 0;
+  {
+    const std::lock_guard<std::mutex> lock(device_pid_tid_map_lock_);
+    auto it = perfetto_device_tracks_.find(std::make_tuple(pkt.pid, pkt.tid));
+    if (it != perfetto_device_tracks_.cend()) {
+      track = it->second;
+    }
+  }
+  if (track == 0) {
+    // host thread
+    track = perfetto_writer_->AddThreadTrack(pkt.pid, pkt.tid);
+  }
+
+  pkt.ResolveName();
+  std::string name = pkt.name;
+  if ((name.size() >= 2) && (name[0] == '\"')) {
+    // name is already quoted
+    name = name.substr(1, name.size() - 2);
+  }
+  const char *category_name = pkt.GetCategoryName();
+  std::string category = (category_name == nullptr) ? std::string() : std::string(category_name);
+  uint64_t ts = pkt.start_ns;
+
+  switch (pkt.ph) {
+    case 'X':
+      perfetto_writer_->AddSlice(track, category, name, ts, pkt.end_ns, GetPerfettoArgs(pkt.args));
+      break;
+    case 'B':
+      perfetto_writer_->BeginSlice(track, category, name, ts, GetPerfettoArgs(pkt.args));
+      break;
+    case 'E':
+      perfetto_writer_->EndSlice(track, ts);
+      break;
+    case 's':
+    case 't': {
+      // both ends of a flow have the same category with flow id and rank
+      uint64_t flow_id = std::hash<std::string>()(pkt.GetCategory());
+      perfetto_writer_->AddFlow(track, category, ts, (flow_id == 0) ? 1 : flow_id, (pkt.ph == 't'));
+      break;
+    }
+    case 'C': {
+      uint64_t process_track = perfetto_writer_->AddProcessTrack(pkt.pid, GetHostProcessName());
+      perfetto_writer_->AddCounterValue(perfetto_writer_->AddCounterTrack(name, process_track), ts, static_cast<int64_t>(pkt.id));
+      break;
+    }
+    default:
+      // marks and samples
+      perfetto_writer_->AddInstant(track, category, name, ts, GetPerfettoArgs(pkt.args));
+      break;
+  }
+}
+
+static void LogTraceDataPacket(TraceDataPacket& pkt) {
+  if (perfetto_writer_ != nullptr) {
+    LogPerfettoEvent(pkt);
+  }
+  else if (logger_ != nullptr) {
+    logger_->Log(pkt.Stringify());
+  }
+}
+
 class TraceBuffer;
 std::set<TraceBuffer *> *trace_buffers_ = nullptr;
 
 #define BUFFER_SLICE_SIZE_DEFAULT	(0x1 << 20)
 
+// events per buffer, -1 means buffers grow by slices of BUFFER_SLICE_SIZE_DEFAULT events
+static int32_t GetChromeEventBufferCapacity(void) {
+  std::string szstr = utils::GetEnv("UNITRACE_ChromeEventBufferSize");
+  if (szstr.empty() || (szstr == "-1")) {
+    return -1;
+  }
+  return std::stoi(szstr);
+}
+
 class TraceBuffer {
   public:
-    TraceBuffer() {
-      std::string szstr = utils::GetEnv("UNITRACE_ChromeEventBufferSize");
-      if (szstr.empty() || (szstr == "-1")) {
-        buffer_capacity_ = -1;
-        slice_capacity_ = BUFFER_SLICE_SIZE_DEFAULT;
-      }
-      else {
-        buffer_capacity_ = std::stoi(szstr);
-        slice_capacity_ = buffer_capacity_;
-      }
-      ZeKernelCommandExecutionRecord *der = (ZeKernelCommandExecutionRecord *)(malloc(sizeof(ZeKernelCommandExecutionRecord) * slice_capacity_));
-      UniMemory::ExitIfOutOfMemory((void *)(der));
-      
-      device_event_buffer_.push_back(der); 
-
-      HostEventRecord *her = (HostEventRecord *)(malloc(sizeof(HostEventRecord) * slice_capacity_));
-      UniMemory::ExitIfOutOfMemory((void *)(her));
-
-      host_event_buffer_.push_back(her); 
+    TraceBuffer() : buffer_capacity_(GetChromeEventBufferCapacity()),
+      slice_capacity_((buffer_capacity_ == -1) ? BUFFER_SLICE_SIZE_DEFAULT : buffer_capacity_),
+      device_events_(slice_capacity_), host_events_(slice_capacity_) {
       tid_= utils::GetTid();
       pid_= utils::GetPid();
-
-      current_device_event_buffer_slice_ = 0;
-      current_host_event_buffer_slice_ = 0;
-      next_device_event_index_ = 0;
-      next_host_event_index_ = 0;
-      device_event_buffer_flushed_ = false;
-      host_event_buffer_flushed_ = false;
       finalized_.store(false, std::memory_order_release);
 
       std::lock_guard<std::recursive_mutex> lock(logger_lock_);	// use this lock to protect trace_buffers_
@@ -388,38 +585,8 @@ class TraceBuffer {
       std::lock_guard<std::recursive_mutex> lock(logger_lock_);
       if (!finalized_.exchange(true)) {
         // finalize if not finalized
-        if (!device_event_buffer_flushed_) {
-          for (int i = 0; i < current_device_event_buffer_slice_; i++) {
-            for (int j = 0; j < slice_capacity_; j++) {
-              FlushDeviceEvent(device_event_buffer_[i][j]);
-            }
-          }  
-          for (int j = 0; j < next_device_event_index_; j++) {
-            FlushDeviceEvent(device_event_buffer_[current_device_event_buffer_slice_][j]);
-          }
-          device_event_buffer_flushed_ = true;
-        }
-        if (!host_event_buffer_flushed_) {
-          for (int i = 0; i < current_host_event_buffer_slice_; i++) {
-            for (int j = 0; j < slice_capacity_; j++) {
-              FlushHostEvent(host_event_buffer_[i][j]);
-            }
-          }  
-          for (int j = 0; j < next_host_event_index_; j++) {
-            FlushHostEvent(host_event_buffer_[current_host_event_buffer_slice_][j]);
-          }
-          host_event_buffer_flushed_ = true;
-        }
-
-        for (auto& slice : device_event_buffer_) {
-          free(slice);
-        }
-        device_event_buffer_.clear();
-
-        for (auto& slice : host_event_buffer_) {
-          free(slice);
-        }
-        host_event_buffer_.clear();
+        FlushDeviceBuffer();
+        FlushHostBuffer();
 
         trace_buffers_->erase(this);
       }
@@ -429,47 +596,55 @@ class TraceBuffer {
     TraceBuffer& operator=(const TraceBuffer& that) = delete;
 
     ZeKernelCommandExecutionRecord *GetDeviceEvent(void) {
-      if (next_device_event_index_ ==  slice_capacity_) {
+      if (device_events_.IsFull()) {
         if (buffer_capacity_ == -1) {
-          ZeKernelCommandExecutionRecord *der = (ZeKernelCommandExecutionRecord *)(malloc(sizeof(ZeKernelCommandExecutionRecord) * slice_capacity_));
-          UniMemory::ExitIfOutOfMemory((void *)(der));
-      
-          device_event_buffer_.push_back(der);
-          current_device_event_buffer_slice_++;
-          next_device_event_index_ = 0;
+          NextDeviceEventSlice();
         }
         else {
           FlushDeviceBuffer();
         }
       }
-      return &(device_event_buffer_[current_device_event_buffer_slice_][next_device_event_index_]);
+      if (device_events_.IsFull()) {
+        // no room left, the event will be dropped
+        return &dropped_device_event_;
+      }
+      return device_events_.GetEvent();
     }
 
     HostEventRecord *GetHostEvent(void) {
-      if (next_host_event_index_ ==  slice_capacity_) {
+      if (host_events_.IsFull()) {
         if (buffer_capacity_ == -1) {
-          HostEventRecord *her = (HostEventRecord *)(malloc(sizeof(HostEventRecord) * slice_capacity_));
-          UniMemory::ExitIfOutOfMemory((void *)(her));
-
-          host_event_buffer_.push_back(her);
-          current_host_event_buffer_slice_++;
-          next_host_event_index_ = 0;
+          NextHostEventSlice();
         }
         else {
           FlushHostBuffer();
         }
       }
-      return &(host_event_buffer_[current_host_event_buffer_slice_][next_host_event_index_]);
+      if (host_events_.IsFull()) {
+        // no room left, the event will be dropped
+        return &dropped_host_event_;
+      }
+      return host_events_.GetEvent();
     }
 
     void BufferHostEvent(void) {
-      next_host_event_index_++;
-      host_event_buffer_flushed_ = false;
+      if (!host_events_.BufferEvent()) {
+        UniMemory::TraceMemory::CountDropped(1);
+      }
     }
 
     void BufferDeviceEvent(void) {
-      next_device_event_index_++;
-      device_event_buffer_flushed_ = false;
+      if (!device_events_.BufferEvent()) {
+        UniMemory::TraceMemory::CountDropped(1);
+      }
+    }
+
+    void NextDeviceEventSlice(void) {
+      device_events_.NextSlice([this](ZeKernelCommandExecutionRecord& rec) { FlushDeviceEvent(rec); });
+    }
+
+    void NextHostEventSlice(void) {
+      host_events_.NextSlice([this](HostEventRecord& rec) { FlushHostEvent(rec); });
     }
 
     uint32_t GetTid() { return tid_; }
@@ -491,11 +666,13 @@ class TraceBuffer {
         }
         pkt.api_id = ZeKernelTracingId;
         pkt.ts = UniTimer::GetEpochTimeInUs(rec.start_time_);
+        pkt.start_ns = UniTimer::GetEpochTime(rec.start_time_);
         //pkt.dur = UniTimer::GetEpochTimeInUs(rec.end_time_) - UniTimer::GetEpochTimeInUs(rec.start_time_);
         pkt.dur = UniTimer::GetTimeInUs(rec.end_time_ - rec.start_time_);
+        pkt.end_ns = UniTimer::GetEpochTime(rec.end_time_);
         pkt.cat = gpu_op;
         pkt.args = "\"id\": \"" + std::to_string(rec.kid_) + "\"";
-        logger_->Log(pkt.Stringify());
+        LogTraceDataPacket(pkt);
       }
 
       if (!rec.implicit_scaling_) {
@@ -507,10 +684,11 @@ class TraceBuffer {
           pkt.api_id = DepTracingId;
           pkt.id = rec.kid_;
           pkt.ts = UniTimer::GetEpochTimeInUs(rec.start_time_);
+          pkt.start_ns = UniTimer::GetEpochTime(rec.start_time_);
           pkt.dur = (uint64_t)(-1);
           pkt.cat = data_flow;
           pkt.rank = mpi_rank;
-          logger_->Log(pkt.Stringify());
+          LogTraceDataPacket(pkt);
         }
 
         {
@@ -521,32 +699,18 @@ class TraceBuffer {
           pkt.api_id = DepTracingId;
           pkt.id = rec.kid_;
           pkt.ts = UniTimer::GetEpochTimeInUs(rec.start_time_);
+          pkt.start_ns = UniTimer::GetEpochTime(rec.start_time_);
           pkt.dur = (uint64_t)(-1);
           pkt.cat = data_flow_sync;
           pkt.rank = mpi_rank;
-          logger_->Log(pkt.Stringify());
+          LogTraceDataPacket(pkt);
         }
       }
     }
 
     void FlushDeviceBuffer() {
       std::lock_guard<std::recursive_mutex> lock(logger_lock_);
-      if (device_event_buffer_flushed_) {
-        return;
-      }
-
-      for (int i = 0; i < current_device_event_buffer_slice_; i++) {
-        for (int j = 0; j < slice_capacity_; j++) {
-          FlushDeviceEvent(device_event_buffer_[i][j]);
-        }
-      }  
-      for (int j = 0; j < next_device_event_index_; j++) {
-        FlushDeviceEvent(device_event_buffer_[current_device_event_buffer_slice_][j]);
-      }
-         
-      current_device_event_buffer_slice_ = 0;
-      next_device_event_index_ = 0;
-      device_event_buffer_flushed_ = true;
+      device_events_.Flush([this](ZeKernelCommandExecutionRecord& rec) { FlushDeviceEvent(rec); });
     }
 
     void FlushHostEvent(HostEventRecord& rec) {
@@ -555,6 +719,7 @@ class TraceBuffer {
       if (rec.type_ == EVENT_COMPLETE) {
         pkt.ph = 'X';
         pkt.dur = UniTimer::GetTimeInUs(rec.end_time_ - rec.start_time_);
+        pkt.end_ns = UniTimer::GetEpochTime(rec.end_time_);
 
 /*
         std::string str_kids = "";
@@ -625,6 +790,13 @@ class TraceBuffer {
         pkt.dur = (uint64_t)(-1);
         pkt.cat = cpu_op;
       }
+      else if (rec.type_ == EVENT_COUNTER) {
+        pkt.ph = 'C';
+        pkt.dur = (uint64_t)(-1);
+        pkt.cat = cpu_op;
+        pkt.args = "\"bytes\": " + std::to_string(rec.id_);	// counter value
+        pkt.id = rec.id_;
+      }
       else {
         // should never get here
       }
@@ -633,30 +805,17 @@ class TraceBuffer {
       pkt.pid = GetPid();
       pkt.api_id = rec.api_id_;
       pkt.ts = UniTimer::GetEpochTimeInUs(rec.start_time_);
+      pkt.start_ns = UniTimer::GetEpochTime(rec.start_time_);
       //pkt.dur = UniTimer::GetEpochTimeInUs(ended) - UniTimer::GetEpochTimeInUs(started);
       pkt.rank = mpi_rank;
       pkt.name = rec.name_;
 
-      logger_->Log(pkt.Stringify());
+      LogTraceDataPacket(pkt);
     }
 
     void FlushHostBuffer() {
       std::lock_guard<std::recursive_mutex> lock(logger_lock_);
-      if (host_event_buffer_flushed_) {
-        return;
-      }
-
-      for (int i = 0; i < current_host_event_buffer_slice_; i++) {
-        for (int j = 0; j < slice_capacity_; j++) {
-          FlushHostEvent(host_event_buffer_[i][j]);
-        }
-      }  
-      for (int j = 0; j < next_host_event_index_; j++) {
-        FlushHostEvent(host_event_buffer_[current_host_event_buffer_slice_][j]);
-      }
-      current_host_event_buffer_slice_ = 0;
-      next_host_event_index_ = 0;   
-      host_event_buffer_flushed_ = true;
+      host_events_.Flush([this](HostEventRecord& rec) { FlushHostEvent(rec); });
     }
     
     
@@ -664,28 +823,8 @@ class TraceBuffer {
       
       std::lock_guard<std::recursive_mutex> lock(logger_lock_);
       if (!finalized_.exchange(true)) {
-        if (!device_event_buffer_flushed_) {
-          for (int i = 0; i < current_device_event_buffer_slice_; i++) {
-            for (int j = 0; j < slice_capacity_; j++) {
-              FlushDeviceEvent(device_event_buffer_[i][j]);
-            }
-          }  
-          for (int j = 0; j < next_device_event_index_; j++) {
-            FlushDeviceEvent(device_event_buffer_[current_device_event_buffer_slice_][j]);
-          }
-          device_event_buffer_flushed_ = true;
-        }
-        if (!host_event_buffer_flushed_) {
-          for (int i = 0; i < current_host_event_buffer_slice_; i++) {
-            for (int j = 0; j < slice_capacity_; j++) {
-              FlushHostEvent(host_event_buffer_[i][j]);
-            }
-          }  
-          for (int j = 0; j < next_host_event_index_; j++) {
-            FlushHostEvent(host_event_buffer_[current_host_event_buffer_slice_][j]);
-          }
-          host_event_buffer_flushed_ = true;
-        }
+        FlushDeviceBuffer();
+        FlushHostBuffer();
       }
     }
     
@@ -696,16 +835,12 @@ class TraceBuffer {
   private:
     int32_t buffer_capacity_;
     int32_t slice_capacity_;	// each buffer can have multiple slices
-    int32_t current_device_event_buffer_slice_;	// device slice in use
-    int32_t current_host_event_buffer_slice_;	// host slice in use
-    int32_t next_device_event_index_;	// next free device event in in-use slice
-    int32_t next_host_event_index_;	// next free host event in in-use slice
     uint32_t tid_;
     uint32_t pid_;
-    std::vector<ZeKernelCommandExecutionRecord *> device_event_buffer_;
-    std::vector<HostEventRecord *> host_event_buffer_;
-    bool host_event_buffer_flushed_;
-    bool device_event_buffer_flushed_;
+    TraceEventSlices<ZeKernelCommandExecutionRecord> device_events_;
+    TraceEventSlices<HostEventRecord> host_events_;
+    ZeKernelCommandExecutionRecord dropped_device_event_;	// placeholder for events that do not fit
+    HostEventRecord dropped_host_event_;	// placeholder for events that do not fit
     std::atomic<bool> finalized_;
 };
 
@@ -716,34 +851,11 @@ class ClTraceBuffer;
 std::set<ClTraceBuffer *> *cl_trace_buffers_ = nullptr;
 class ClTraceBuffer {
   public:
-    ClTraceBuffer() {
-      std::string szstr = utils::GetEnv("UNITRACE_ChromeEventBufferSize");
-      if (szstr.empty() || (szstr == "-1")) {
-        buffer_capacity_ = -1;
-        slice_capacity_ = BUFFER_SLICE_SIZE_DEFAULT;
-      }
-      else {
-        buffer_capacity_ = std::stoi(szstr);
-        slice_capacity_ = buffer_capacity_;
-      }
-      ClKernelCommandExecutionRecord *der = (ClKernelCommandExecutionRecord *)(malloc(sizeof(ClKernelCommandExecutionRecord) * slice_capacity_));
-      UniMemory::ExitIfOutOfMemory((void *)(der));
-      
-      device_event_buffer_.push_back(der); 
-
-      HostEventRecord *her = (HostEventRecord *)(malloc(sizeof(HostEventRecord) * slice_capacity_));
-      UniMemory::ExitIfOutOfMemory((void *)(her));
-
-      host_event_buffer_.push_back(her); 
+    ClTraceBuffer() : buffer_capacity_(GetChromeEventBufferCapacity()),
+      slice_capacity_((buffer_capacity_ == -1) ? BUFFER_SLICE_SIZE_DEFAULT : buffer_capacity_),
+      device_events_(slice_capacity_), host_events_(slice_capacity_) {
       tid_= utils::GetTid();
       pid_= utils::GetPid();
-
-      current_device_event_buffer_slice_ = 0;
-      current_host_event_buffer_slice_ = 0;
-      next_device_event_index_ = 0;
-      next_host_event_index_ = 0;
-      device_event_buffer_flushed_ = false;
-      host_event_buffer_flushed_ = false;
       finalized_.store(false, std::memory_order_release);
 
       std::lock_guard<std::recursive_mutex> lock(logger_lock_);	// use this lock to protect trace_buffers_
@@ -759,38 +871,8 @@ class ClTraceBuffer {
       std::lock_guard<std::recursive_mutex> lock(logger_lock_);
       if (!finalized_.exchange(true)) {
         // finalize if not finalized
-        if (!device_event_buffer_flushed_) {
-          for (int i = 0; i < current_device_event_buffer_slice_; i++) {
-            for (int j = 0; j < slice_capacity_; j++) {
-              FlushDeviceEvent(device_event_buffer_[i][j]);
-            }
-          }  
-          for (int j = 0; j < next_device_event_index_; j++) {
-            FlushDeviceEvent(device_event_buffer_[current_device_event_buffer_slice_][j]);
-          }
-          device_event_buffer_flushed_ = true;
-        }
-        if (!host_event_buffer_flushed_) {
-          for (int i = 0; i < current_host_event_buffer_slice_; i++) {
-            for (int j = 0; j < slice_capacity_; j++) {
-              FlushHostEvent(host_event_buffer_[i][j]);
-            }
-          }  
-          for (int j = 0; j < next_host_event_index_; j++) {
-            FlushHostEvent(host_event_buffer_[current_host_event_buffer_slice_][j]);
-          }
-          host_event_buffer_flushed_ = true;
-        }
-
-        for (auto& slice : device_event_buffer_) {
-          free(slice);
-        }
-        device_event_buffer_.clear();
-
-        for (auto& slice : host_event_buffer_) {
-          free(slice);
-        }
-        host_event_buffer_.clear();
+        FlushDeviceBuffer();
+        FlushHostBuffer();
 
         cl_trace_buffers_->erase(this);
       }
@@ -800,47 +882,55 @@ class ClTraceBuffer {
     ClTraceBuffer& operator=(const ClTraceBuffer& that) = delete;
 
     ClKernelCommandExecutionRecord *GetDeviceEvent(void) {
-      if (next_device_event_index_ ==  slice_capacity_) {
+      if (device_events_.IsFull()) {
         if (buffer_capacity_ == -1) {
-          ClKernelCommandExecutionRecord *der = (ClKernelCommandExecutionRecord *)(malloc(sizeof(ClKernelCommandExecutionRecord) * slice_capacity_));
-          UniMemory::ExitIfOutOfMemory((void *)(der));
-      
-          device_event_buffer_.push_back(der);
-          current_device_event_buffer_slice_++;
-          next_device_event_index_ = 0;
+          NextDeviceEventSlice();
         }
         else {
           FlushDeviceBuffer();
         }
       }
-      return &(device_event_buffer_[current_device_event_buffer_slice_][next_device_event_index_]);
+      if (device_events_.IsFull()) {
+        // no room left, the event will be dropped
+        return &dropped_device_event_;
+      }
+      return device_events_.GetEvent();
     }
 
     HostEventRecord *GetHostEvent(void) {
-      if (next_host_event_index_ ==  slice_capacity_) {
+      if (host_events_.IsFull()) {
         if (buffer_capacity_ == -1) {
-          HostEventRecord *her = (HostEventRecord *)(malloc(sizeof(HostEventRecord) * slice_capacity_));
-          UniMemory::ExitIfOutOfMemory((void *)(her));
-
-          host_event_buffer_.push_back(her);
-          current_host_event_buffer_slice_++;
-          next_host_event_index_ = 0;
+          NextHostEventSlice();
         }
         else {
           FlushHostBuffer();
         }
       }
-      return &(host_event_buffer_[current_host_event_buffer_slice_][next_host_event_index_]);
+      if (host_events_.IsFull()) {
+        // no room left, the event will be dropped
+        return &dropped_host_event_;
+      }
+      return host_events_.GetEvent();
     }
 
     void BufferHostEvent(void) {
-      next_host_event_index_++;
-      host_event_buffer_flushed_ = false;
+      if (!host_events_.BufferEvent()) {
+        UniMemory::TraceMemory::CountDropped(1);
+      }
     }
 
     void BufferDeviceEvent(void) {
-      next_device_event_index_++;
-      device_event_buffer_flushed_ = false;
+      if (!device_events_.BufferEvent()) {
+        UniMemory::TraceMemory::CountDropped(1);
+      }
+    }
+
+    void NextDeviceEventSlice(void) {
+      device_events_.NextSlice([this](ClKernelCommandExecutionRecord& rec) { FlushDeviceEvent(rec); });
+    }
+
+    void NextHostEventSlice(void) {
+      host_events_.NextSlice([this](HostEventRecord& rec) { FlushHostEvent(rec); });
     }
 
     uint32_t GetTid() { return tid_; }
@@ -864,10 +954,12 @@ class ClTraceBuffer {
         }
         pkt.api_id = ClKernelTracingId;
         pkt.ts = UniTimer::GetEpochTimeInUs(rec.start_time_);
+        pkt.start_ns = UniTimer::GetEpochTime(rec.start_time_);
         pkt.dur = UniTimer::GetTimeInUs(rec.end_time_ - rec.start_time_);
+        pkt.end_ns = UniTimer::GetEpochTime(rec.end_time_);
         pkt.cat = gpu_op;
         pkt.args = "\"id\": \"" + std::to_string(rec.kid_) + "\"";
-        logger_->Log(pkt.Stringify());
+        LogTraceDataPacket(pkt);
       }
 
       if (!rec.implicit_scaling_) {
@@ -879,10 +971,11 @@ class ClTraceBuffer {
           pkt.api_id = DepTracingId;
           pkt.id = rec.kid_;
           pkt.ts = UniTimer::GetEpochTimeInUs(rec.start_time_);
+          pkt.start_ns = UniTimer::GetEpochTime(rec.start_time_);
           pkt.dur = (uint64_t)(-1);
           pkt.cat = data_flow;
           pkt.rank = mpi_rank;
-          logger_->Log(pkt.Stringify());
+          LogTraceDataPacket(pkt);
         }
 
         {
@@ -893,32 +986,18 @@ class ClTraceBuffer {
           pkt.api_id = DepTracingId;
           pkt.id = rec.kid_;
           pkt.ts = UniTimer::GetEpochTimeInUs(rec.start_time_);
+          pkt.start_ns = UniTimer::GetEpochTime(rec.start_time_);
           pkt.dur = (uint64_t)(-1);
           pkt.cat = data_flow_sync;
           pkt.rank = mpi_rank;
-          logger_->Log(pkt.Stringify());
+          LogTraceDataPacket(pkt);
         }
       }
     }
 
     void FlushDeviceBuffer() {
       std::lock_guard<std::recursive_mutex> lock(logger_lock_);
-      if (device_event_buffer_flushed_) {
-        return;
-      }
-
-      for (int i = 0; i < current_device_event_buffer_slice_; i++) {
-        for (int j = 0; j < slice_capacity_; j++) {
-          FlushDeviceEvent(device_event_buffer_[i][j]);
-        }
-      }  
-      for (int j = 0; j < next_device_event_index_; j++) {
-        FlushDeviceEvent(device_event_buffer_[current_device_event_buffer_slice_][j]);
-      }
-         
-      current_device_event_buffer_slice_ = 0;
-      next_device_event_index_ = 0;
-      device_event_buffer_flushed_ = true;
+      device_events_.Flush([this](ClKernelCommandExecutionRecord& rec) { FlushDeviceEvent(rec); });
     }
     
     void FlushHostEvent(HostEventRecord& rec) {
@@ -927,6 +1006,7 @@ class ClTraceBuffer {
       if (rec.type_ == EVENT_COMPLETE) {
         pkt.ph = 'X';
         pkt.dur = UniTimer::GetTimeInUs(rec.end_time_ - rec.start_time_);
+        pkt.end_ns = UniTimer::GetEpochTime(rec.end_time_);
 
 /*
         std::string str_kids = "";
@@ -982,30 +1062,17 @@ class ClTraceBuffer {
       pkt.pid = GetPid();
       pkt.api_id = rec.api_id_;
       pkt.ts = UniTimer::GetEpochTimeInUs(rec.start_time_);
+      pkt.start_ns = UniTimer::GetEpochTime(rec.start_time_);
       //pkt.dur = UniTimer::GetEpochTimeInUs(ended) - UniTimer::GetEpochTimeInUs(started);
       pkt.rank = mpi_rank;
       pkt.name = rec.name_;
 
-      logger_->Log(pkt.Stringify());
+      LogTraceDataPacket(pkt);
     }
 
     void FlushHostBuffer() {
       std::lock_guard<std::recursive_mutex> lock(logger_lock_);
-      if (host_event_buffer_flushed_) {
-        return;
-      }
-
-      for (int i = 0; i < current_host_event_buffer_slice_; i++) {
-        for (int j = 0; j < slice_capacity_; j++) {
-          FlushHostEvent(host_event_buffer_[i][j]);
-        }
-      }  
-      for (int j = 0; j < next_host_event_index_; j++) {
-        FlushHostEvent(host_event_buffer_[current_host_event_buffer_slice_][j]);
-      }
-      current_host_event_buffer_slice_ = 0;
-      next_host_event_index_ = 0;   
-      host_event_buffer_flushed_ = true;
+      host_events_.Flush([this](HostEventRecord& rec) { FlushHostEvent(rec); });
     }
     
     
@@ -1013,28 +1080,8 @@ class ClTraceBuffer {
       
       std::lock_guard<std::recursive_mutex> lock(logger_lock_);
       if (!finalized_.exchange(true)) {
-        if (!device_event_buffer_flushed_) {
-          for (int i = 0; i < current_device_event_buffer_slice_; i++) {
-            for (int j = 0; j < slice_capacity_; j++) {
-              FlushDeviceEvent(device_event_buffer_[i][j]);
-            }
-          }  
-          for (int j = 0; j < next_device_event_index_; j++) {
-            FlushDeviceEvent(device_event_buffer_[current_device_event_buffer_slice_][j]);
-          }
-          device_event_buffer_flushed_ = true;
-        }
-        if (!host_event_buffer_flushed_) {
-          for (int i = 0; i < current_host_event_buffer_slice_; i++) {
-            for (int j = 0; j < slice_capacity_; j++) {
-              FlushHostEvent(host_event_buffer_[i][j]);
-            }
-          }  
-          for (int j = 0; j < next_host_event_index_; j++) {
-            FlushHostEvent(host_event_buffer_[current_host_event_buffer_slice_][j]);
-          }
-          host_event_buffer_flushed_ = true;
-        }
+        FlushDeviceBuffer();
+        FlushHostBuffer();
       }
     }
     
@@ -1052,16 +1099,12 @@ class ClTraceBuffer {
 
     int32_t buffer_capacity_;
     int32_t slice_capacity_;	// each buffer can have multiple slices
-    int32_t current_device_event_buffer_slice_;	// device slice in use
-    int32_t current_host_event_buffer_slice_;	// host slice in use
-    int32_t next_device_event_index_;	// next free device event in in-use slice
-    int32_t next_host_event_index_;	// next free host event in in-use slice
     uint32_t tid_;
     uint32_t pid_;
-    std::vector<ClKernelCommandExecutionRecord *> device_event_buffer_;
-    std::vector<HostEventRecord *> host_event_buffer_;
-    bool host_event_buffer_flushed_;
-    bool device_event_buffer_flushed_;
+    TraceEventSlices<ClKernelCommandExecutionRecord> device_events_;
+    TraceEventSlices<HostEventRecord> host_events_;
+    ClKernelCommandExecutionRecord dropped_device_event_;	// placeholder for events that do not fit
+    HostEventRecord dropped_host_event_;	// placeholder for events that do not fit
     std::atomic<bool> finalized_;
 };
 
@@ -1077,7 +1120,8 @@ class ChromeLogger {
     Correlator* correlator_ = nullptr;
     ChromeLogger(const TraceOptions& options, Correlator* correlator, const char* filename) : options_(options) {
       correlator_ = correlator;
-      chrome_trace_file_name_ = TraceOptions::GetChromeTraceFileName(filename);
+      bool perfetto_output = (utils::GetEnv("UNITRACE_PerfettoOutput") == "1");
+      chrome_trace_file_name_ = TraceOptions::GetChromeTraceFileName(filename, perfetto_output ? kPerfettoTraceFileExt : kChromeTraceFileExt);
       if (this->CheckOption(TRACE_OUTPUT_DIR_PATH)) {
           std::string dir = utils::GetEnv("UNITRACE_TraceOutputDir");
           chrome_trace_file_name_ = (dir + '/' + chrome_trace_file_name_);
@@ -1100,6 +1144,15 @@ class ChromeLogger {
           filtering_on_ = false;
 	  filter_strings_set_.insert("ALL");
       }
+      if (perfetto_output) {
+        // timestamps are CLOCK_MONOTONIC_RAW with --system-time, otherwise the epoch time UniTimer derives from it
+        uint32_t clock_id = (utils::GetEnv("UNITRACE_SystemTime") == "1") ? perfetto_proto::kBuiltinClockMonotonicRaw : perfetto_proto::kBuiltinClockRealtime;
+        perfetto_writer_ = new PerfettoWriter(chrome_trace_file_name_, clock_id);
+        UniMemory::ExitIfOutOfMemory((void *)(perfetto_writer_));
+        perfetto_writer_->AddProcessTrack(utils::GetPid(), GetHostProcessName());
+        return;
+      }
+
       logger_ = new Logger(chrome_trace_file_name_.c_str(), true, true);
       UniMemory::ExitIfOutOfMemory((void *)(logger_));
 
@@ -1111,7 +1164,7 @@ class ChromeLogger {
     ChromeLogger& operator=(const ChromeLogger& that) = delete;
 
     ~ChromeLogger() {
-      if (logger_ != nullptr) {
+      if ((logger_ != nullptr) || (perfetto_writer_ != nullptr)) {
         logger_lock_.lock();
         if (trace_buffers_) {
           for (auto it = trace_buffers_->begin(); it != trace_buffers_->end();) {
@@ -1129,124 +1182,47 @@ class ChromeLogger {
 
         logger_lock_.unlock();
 
-        std::string str("{\"ph\": \"M\", \"name\": \"process_name\", \"pid\": ");
+        if (perfetto_writer_ != nullptr) {
+          // tracks are named when they are created
+          delete perfetto_writer_;
+          perfetto_writer_ = nullptr;
+          std::cerr << "[INFO] Timeline is stored in " << chrome_trace_file_name_ << std::endl;
+          return;
+        }
 
-        str += std::to_string(utils::GetPid()) + ", \"ts\": " + process_start_time + ", \"args\": {\"name\": \"";
+        std::string str("{\"ph\": \"M\", \"name\": \"process_name\", \"pid\": ");
 
-        if (rank.empty()) {
-          str += "HOST<" + pmi_hostname + ">\"}}";
-        }
-        else {
-          str += "RANK " + std::to_string(mpi_rank) + " HOST<" + pmi_hostname + ">\"}}";
-        }
+        str += std::to_string(utils::GetPid()) + ", \"ts\": " + process_start_time + ", \"args\": {\"name\": \"" + GetHostProcessName() + "\"}}";
             
         const std::lock_guard<std::mutex> lock(device_pid_tid_map_lock_);
 
         for (auto it = device_pid_map_.cbegin(); it != device_pid_map_.cend(); it++) {
           uint32_t device_pid = std::get<0>(it->second);
           str += ",\n{\"ph\": \"M\", \"name\": \"process_name\", \"pid\": " + std::to_string(device_pid) +
-                 ", \"ts\": " + std::to_string(std::get<1>(it->second)) + ", \"args\": {\"name\": \"";
-          if (rank.empty()) {
-            str += "DEVICE<" + pmi_hostname + ">";
-          }
-          else {
-            str += "RANK " + std::to_string(mpi_rank) + " DEVICE<" + pmi_hostname + ">";
-          }
-
-          char str2[128];
-          snprintf(str2, sizeof(str2), "%x", it->first.pci_addr_.domain);
-          str += std::string(str2) + ":";
-          snprintf(str2, sizeof(str2), "%x", it->first.pci_addr_.bus);
-          str += std::string(str2) + ":";
-          snprintf(str2, sizeof(str2), "%x", it->first.pci_addr_.device);
-          str += std::string(str2) + ":";
-          snprintf(str2, sizeof(str2), "%x", it->first.pci_addr_.function);
-          str += std::string(str2);
-
-          if (it->first.parent_device_id_ >= 0) {
-            str += " #" + std::to_string(it->first.parent_device_id_) + "." + std::to_string(it->first.subdevice_id_);
-          }
-          else {
-            str += " #" + std::to_string(it->first.device_id_);
-          }
-
-          str += "\"}}"; 
+                 ", \"ts\": " + std::to_string(std::get<1>(it->second)) + ", \"args\": {\"name\": \"" +
+                 GetZeDeviceProcessName(it->first) + "\"}}";
         }
         for (auto it = device_tid_map_.cbegin(); it != device_tid_map_.cend(); it++) {
           uint32_t device_pid = std::get<0>(it->second);
           uint32_t device_tid = std::get<1>(it->second);
           str += ",\n{\"ph\": \"M\", \"name\": \"thread_name\", \"pid\": " + std::to_string(device_pid) + ", \"tid\": " +
-                 std::to_string(device_tid) + ", \"ts\": " + std::to_string(std::get<2>(it->second)) + ", \"args\": {\"name\": \"";
-          if (device_logging_no_thread_) {
-            if (device_logging_no_engine_) {
-              str += "L0\"}}";
-            }
-            else {
-              str += "L0 Engine<" + std::to_string(it->first.engine_ordinal_) + "," + std::to_string(it->first.engine_index_) + ">\"}}"; 
-            }
-          }
-          else {
-            if (device_logging_no_engine_) {
-              str += "Thread " + std::to_string(it->first.host_tid_) + " L0\"}}"; 
-            }
-            else {
-              str += "Thread " + std::to_string(it->first.host_tid_) + " L0 Engine<" + std::to_string(it->first.engine_ordinal_) +
-                     "," + std::to_string(it->first.engine_index_) + ">\"}}"; 
-            }
-          }
+                 std::to_string(device_tid) + ", \"ts\": " + std::to_string(std::get<2>(it->second)) + ", \"args\": {\"name\": \"" +
+                 GetZeDeviceThreadName(it->first) + "\"}}";
         }
     
         for (auto it = cl_device_pid_map_.cbegin(); it != cl_device_pid_map_.cend(); it++) {
           uint32_t device_pid = std::get<0>(it->second);
           str += ",\n{\"ph\": \"M\", \"name\": \"process_name\", \"pid\": " + std::to_string(device_pid) +
-                 ", \"ts\": " + std::to_string(std::get<1>(it->second)) + ", \"args\": {\"name\": \"";
-          if (rank.empty()) {
-            str += "DEVICE<" + pmi_hostname + ">";
-          }
-          else {
-            str += "RANK " + std::to_string(mpi_rank) + " DEVICE<" + pmi_hostname + ">";
-          }
-
-          char str2[128];
-          snprintf(str2, sizeof(str2), "%x", it->first.pci_addr_.pci_domain);
-          str += std::string(str2) + ":";
-          snprintf(str2, sizeof(str2), "%x", it->first.pci_addr_.pci_bus);
-          str += std::string(str2) + ":";
-          snprintf(str2, sizeof(str2), "%x", it->first.pci_addr_.pci_device);
-          str += std::string(str2) + ":";
-          snprintf(str2, sizeof(str2), "%x", it->first.pci_addr_.pci_function);
-          str += std::string(str2);
-
-          str += "\"}}"; 
+                 ", \"ts\": " + std::to_string(std::get<1>(it->second)) + ", \"args\": {\"name\": \"" +
+                 GetClDeviceProcessName(it->first) + "\"}}";
         }
         for (auto it = cl_device_tid_map_.cbegin(); it != cl_device_tid_map_.cend(); it++) {
           uint32_t device_pid = std::get<0>(it->second);
           uint32_t device_tid = std::get<1>(it->second);
           str += ",\n{\"ph\": \"M\", \"name\": \"thread_name\", \"pid\": " + std::to_string(device_pid) +
                  ", \"tid\": " + std::to_string(device_tid) +
-                 ", \"ts\": " + std::to_string(std::get<2>(it->second)) + ", \"args\": {\"name\": \"";
-          if (device_logging_no_thread_) {
-            if (device_logging_no_engine_) {
-              str += "CL\"}}";
-            }
-            else {
-              char str2[128];
-
-              snprintf(str2, sizeof(str2), "%p", it->first.queue_);
-              str += "CL Queue<" + std::string(str2) + ">\"}}"; 
-            }
-          }
-          else {
-            if (device_logging_no_engine_) {
-              str += "Thread " + std::to_string(it->first.host_tid_) + " CL\"}}"; 
-            }
-            else {
-              char str2[128];
-
-              snprintf(str2, sizeof(str2), "%p", it->first.queue_);
-              str += "Thread " + std::to_string(it->first.host_tid_) + " CL Queue<" + std::string(str2) + ">\"}}"; 
-            }
-          }
+                 ", \"ts\": " + std::to_string(std::get<2>(it->second)) + ", \"args\": {\"name\": \"" +
+                 GetClDeviceThreadName(it->first) + "\"}}";
         }
     
         str += "\n]\n}\n";
@@ -1343,6 +1319,66 @@ class ChromeLogger {
 
     }
 
+    static void ZeChromeMemoryLoggingCallback(ze_device_handle_t device, ze_memory_type_t type, uint64_t live_bytes, uint64_t timestamp) {
+      if (thread_local_buffer_.IsFinalized()) {
+        return;
+      }
+
+      // one counter track per device and memory type
+      std::string name = "Live Memory";
+      if (device != nullptr) {
+        int32_t parent_device_id = -1;
+        int32_t device_id = -1;
+        int32_t subdevice_id = -1;
+        if (GetZeDevicePciPropertiesAndId(device, &parent_device_id, &device_id, &subdevice_id) != nullptr) {
+          if (parent_device_id >= 0) {
+            name += " Device #" + std::to_string(parent_device_id) + "." + std::to_string(subdevice_id);
+          }
+          else {
+            name += " Device #" + std::to_string(device_id);
+          }
+        }
+      }
+      if (type == ZE_MEMORY_TYPE_DEVICE) {
+        name += " (Device)";
+      }
+      else if (type == ZE_MEMORY_TYPE_SHARED) {
+        name += " (Shared)";
+      }
+      else {
+        name += " (Host)";
+      }
+
+      HostEventRecord *rec = thread_local_buffer_.GetHostEvent();
+
+      rec->type_ = EVENT_COUNTER;
+      rec->name_ = std::move(name);
+      rec->api_id_ = MemTracingId;
+      rec->start_time_ = timestamp;
+      rec->id_ = live_bytes;
+      thread_local_buffer_.BufferHostEvent();
+    }
+
+    static void CpuSampleLoggingCallback(uint32_t tid, uint64_t timestamp, const std::string& function, const std::string& stack) {
+      // samples of all threads are delivered at exit, so they are logged directly instead of through thread local buffers
+      TraceDataPacket pkt{};
+
+      pkt.ph = 'i';
+      pkt.cat = cpu_op;
+      pkt.tid = tid;
+      pkt.pid = utils::GetPid();
+      pkt.api_id = CpuSampleTracingId;
+      pkt.ts = UniTimer::GetEpochTimeInUs(timestamp);
+      pkt.start_ns = UniTimer::GetEpochTime(timestamp);
+      pkt.dur = (uint64_t)(-1);
+      pkt.rank = mpi_rank;
+      pkt.name = function;
+      pkt.args = "\"stack\": \"" + stack + "\"";
+
+      std::lock_guard<std::recursive_mutex> lock(logger_lock_);
+      LogTraceDataPacket(pkt);
+    }
+
     // OnenCL tracer callbacks.
     // TODO: remove TraceDataPacket for performance
     static void ClChromeKernelLoggingCallback(
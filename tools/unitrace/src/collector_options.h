@@ -23,6 +23,8 @@ struct CollectorOptions {
   bool metric_query = false;
   bool metric_stream = false;
   bool stall_sampling = false;
+  bool memory_tracking = false;
+  bool dependency_analysis = false;
 };
 
 #endif //PTI_TOOLS_UNITRACE_COLLECTOR_OPTIONS_
@@ -0,0 +1,387 @@
+//==============================================================
+// Copyright (C) Intel Corporation
+//
+// SPDX-License-Identifier: MIT
+// =============================================================
+
+#ifndef PTI_TOOLS_UNITRACE_CPU_COLLECTOR_H_
+#define PTI_TOOLS_UNITRACE_CPU_COLLECTOR_H_
+
+#include <dirent.h>
+#include <dlfcn.h>
+#include <linux/perf_event.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "demangle.h"
+#include "unimemory.h"
+#include "utils.h"
+
+typedef void (*OnCpuSampleLoggingCallback)(uint32_t tid, uint64_t timestamp, const std::string& function, const std::string& stack);
+
+struct CpuSample {
+  uint64_t timestamp_;	// host timestamp in ns
+  uint32_t tid_;
+  uint32_t nframes_;	// number of frames, innermost first
+  size_t first_frame_;	// index of the innermost frame in frames_
+};
+
+struct CpuSampledThread {
+  int fd_;	// perf event
+  void *ring_;	// perf ring buffer: one metadata page followed by data pages
+};
+
+// Samples host threads of the process with perf_event_open() timers and frame pointer stacks.
+// Samples are timestamped with the same clock as the rest of the trace. Symbols are resolved
+// only when the collector is destroyed.
+class CpuCollector {
+ public:
+  static CpuCollector *Create(OnCpuSampleLoggingCallback callback = nullptr) {
+    uint64_t interval = 1000;	// in us
+    std::string value = utils::GetEnv("UNITRACE_CpuSamplingInterval");
+    if (!value.empty()) {
+      interval = std::stoull(value);
+    }
+
+    CpuCollector *collector = new CpuCollector(interval * 1000, callback);
+    UniMemory::ExitIfOutOfMemory((void *)(collector));
+
+    if (!collector->Start()) {
+      std::cerr << "[WARNING] Unable to create CPU sampler, please make sure /proc/sys/kernel/perf_event_paranoid is set to 2 or less" << std::endl;
+      delete collector;
+      return nullptr;
+    }
+
+    return collector;
+  }
+
+  ~CpuCollector() {
+    Stop();
+
+    if (callback_ != nullptr) {
+      for (auto& sample : samples_) {
+        if (sample.nframes_ == 0) {
+          continue;
+        }
+        std::string stack;
+        for (uint32_t i = 0; i < sample.nframes_; i++) {
+          if (i != 0) {
+            stack += " <- ";
+          }
+          stack += Symbolize(frames_[sample.first_frame_ + i], (i != 0));
+        }
+        callback_(sample.tid_, sample.timestamp_, Symbolize(frames_[sample.first_frame_], false), stack);
+      }
+    }
+
+    UniMemory::TraceMemory::Release(samples_.size() * sizeof(CpuSample) + frames_.size() * sizeof(uint64_t));
+  }
+
+  void Stop() {
+    if (!stop_.exchange(true)) {
+      if (sampler_.joinable()) {
+        sampler_.join();
+      }
+      for (auto& it : threads_) {
+        ReadSamples(it.second);
+        CloseThread(it.second);
+      }
+      threads_.clear();
+    }
+  }
+
+  // hottest functions by the number of samples they are the innermost frame of
+  std::string Report() {
+    std::map<std::string, uint64_t> functions;
+    for (auto& sample : samples_) {
+      if (sample.nframes_ != 0) {
+        functions[Symbolize(frames_[sample.first_frame_], false)]++;
+      }
+    }
+
+    std::vector<std::pair<std::string, uint64_t>> sorted(functions.begin(), functions.end());
+    std::sort(sorted.begin(), sorted.end(),
+      [](const std::pair<std::string, uint64_t>& lhs, const std::pair<std::string, uint64_t>& rhs) {
+        return (lhs.second > rhs.second);
+      });
+    if (sorted.size() > kMaxReportedFunctions) {
+      sorted.resize(kMaxReportedFunctions);
+    }
+
+    size_t max_name_size = sizeof("Function") - 1;
+    for (auto& it : sorted) {
+      max_name_size = std::max(max_name_size, it.first.length());
+    }
+
+    std::string str("\n=== CPU Sampling Summary ===\n\n");
+    str += "Sampling Interval (us): " + std::to_string(period_ / 1000) + "\n";
+    str += "Samples: " + std::to_string(samples_.size()) + "\n";
+    str += "Samples Lost: " + std::to_string(lost_) + "\n\n";
+
+    if (!sorted.empty()) {
+      str += std::string(max_name_size - (sizeof("Function") - 1), ' ') + "Function, " +
+        std::string(kCountLength - (sizeof("Samples") - 1), ' ') + "Samples, " +
+        std::string(kPercentLength - (sizeof("Samples (%)") - 1), ' ') + "Samples (%)\n";
+      for (auto& it : sorted) {
+        std::string count = std::to_string(it.second);
+        std::string percent = std::to_string(100.0 * it.second / samples_.size());
+        str += std::string(max_name_size - it.first.length(), ' ') + it.first + ", " +
+          std::string(std::max(int(kCountLength - count.length()), 0), ' ') + count + ", " +
+          std::string(std::max(int(kPercentLength - percent.length()), 0), ' ') + percent + "\n";
+      }
+    }
+
+    return str;
+  }
+
+  CpuCollector(const CpuCollector& that) = delete;
+  CpuCollector& operator=(const CpuCollector& that) = delete;
+
+ private:
+  CpuCollector(uint64_t period, OnCpuSampleLoggingCallback callback)
+    : period_(period), callback_(callback) {
+    page_size_ = sysconf(_SC_PAGESIZE);
+  }
+
+  bool Start() {
+    // fail early if the kernel does not allow sampling this process
+    CpuSampledThread thread;
+    if (!OpenThread(utils::GetTid(), thread)) {
+      return false;
+    }
+    threads_.insert({utils::GetTid(), thread});
+
+    stop_.store(false);
+    sampler_ = std::thread([this]() {
+      sampler_tid_ = utils::GetTid();
+      while (!stop_.load()) {
+        ScanThreads();
+        for (auto& it : threads_) {
+          ReadSamples(it.second);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(kPollInterval));
+      }
+    });
+
+    return true;
+  }
+
+  bool OpenThread(uint32_t tid, CpuSampledThread& thread) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_SOFTWARE;
+    attr.config = PERF_COUNT_SW_TASK_CLOCK;	// CPU time of the thread
+    attr.sample_period = period_;
+    attr.sample_type = PERF_SAMPLE_TID | PERF_SAMPLE_TIME | PERF_SAMPLE_CALLCHAIN;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.exclude_callchain_kernel = 1;
+    attr.sample_max_stack = kMaxFrames;
+    attr.use_clockid = 1;
+    attr.clockid = CLOCK_MONOTONIC_RAW;	// same as UniTimer::GetHostTimestamp()
+
+    int fd = syscall(SYS_perf_event_open, &attr, tid, -1, -1, PERF_FLAG_FD_CLOEXEC);
+    if (fd < 0) {
+      return false;
+    }
+
+    void *ring = mmap(nullptr, (kNumDataPages + 1) * page_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (ring == MAP_FAILED) {
+      close(fd);
+      return false;
+    }
+
+    thread.fd_ = fd;
+    thread.ring_ = ring;
+    return true;
+  }
+
+  void CloseThread(CpuSampledThread& thread) {
+    munmap(thread.ring_, (kNumDataPages + 1) * page_size_);
+    close(thread.fd_);
+  }
+
+  // threads are discovered from /proc, so threads that never call any traced API are sampled too
+  void ScanThreads() {
+    std::set<uint32_t> tids;
+    DIR *dir = opendir("/proc/self/task");
+    if (dir == nullptr) {
+      return;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != nullptr) {
+      if (entry->d_name[0] != '.') {
+        tids.insert(std::stoul(entry->d_name));
+      }
+    }
+    closedir(dir);
+
+    for (auto tid : tids) {
+      if ((tid != sampler_tid_) && (threads_.find(tid) == threads_.end())) {
+        CpuSampledThread thread;
+        if (OpenThread(tid, thread)) {
+          threads_.insert({tid, thread});
+        }
+      }
+    }
+
+    for (auto it = threads_.begin(); it != threads_.end();) {
+      if (tids.find(it->first) == tids.end()) {
+        // thread exited
+        ReadSamples(it->second);
+        CloseThread(it->second);
+        it = threads_.erase(it);
+      }
+      else {
+        it++;
+      }
+    }
+  }
+
+  void ReadSamples(CpuSampledThread& thread) {
+    perf_event_mmap_page *meta = reinterpret_cast<perf_event_mmap_page *>(thread.ring_);
+    const uint8_t *data = reinterpret_cast<const uint8_t *>(thread.ring_) + page_size_;
+    const uint64_t size = kNumDataPages * page_size_;
+
+    uint64_t head = __atomic_load_n(&(meta->data_head), __ATOMIC_ACQUIRE);
+    uint64_t tail = meta->data_tail;
+
+    while (tail < head) {
+      perf_event_header header;
+      CopyFromRing(data, size, tail, &header, sizeof(header));
+      if (header.size < sizeof(header)) {
+        break;	// should never get here
+      }
+      if (header.size > sizeof(record_)) {
+        tail += header.size;
+        continue;
+      }
+      CopyFromRing(data, size, tail, record_, header.size);
+
+      if (header.type == PERF_RECORD_SAMPLE) {
+        // u32 pid, tid; u64 time; u64 nr; u64 ips[nr]
+        const uint8_t *p = record_ + sizeof(header);
+        uint32_t tid = *reinterpret_cast<const uint32_t *>(p + sizeof(uint32_t));
+        uint64_t time = *reinterpret_cast<const uint64_t *>(p + 2 * sizeof(uint32_t));
+        uint64_t nr = *reinterpret_cast<const uint64_t *>(p + 2 * sizeof(uint32_t) + sizeof(uint64_t));
+        const uint64_t *ips = reinterpret_cast<const uint64_t *>(p + 2 * sizeof(uint32_t) + 2 * sizeof(uint64_t));
+        AddSample(tid, time, ips, nr);
+      }
+      else if (header.type == PERF_RECORD_LOST) {
+        // u64 id; u64 lost
+        lost_ += *reinterpret_cast<const uint64_t *>(record_ + sizeof(header) + sizeof(uint64_t));
+      }
+      tail += header.size;
+    }
+
+    __atomic_store_n(&(meta->data_tail), tail, __ATOMIC_RELEASE);
+  }
+
+  static void CopyFromRing(const uint8_t *data, uint64_t size, uint64_t offset, void *dst, size_t count) {
+    uint64_t start = offset % size;
+    size_t first = std::min(size_t(size - start), count);
+    std::memcpy(dst, data + start, first);
+    if (first < count) {
+      std::memcpy(reinterpret_cast<uint8_t *>(dst) + first, data, count - first);
+    }
+  }
+
+  void AddSample(uint32_t tid, uint64_t timestamp, const uint64_t *ips, uint64_t nr) {
+    CpuSample sample;
+    sample.timestamp_ = timestamp;
+    sample.tid_ = tid;
+    sample.nframes_ = 0;
+    sample.first_frame_ = frames_.size();
+
+    size_t nframes = 0;
+    for (uint64_t i = 0; i < nr; i++) {
+      if (ips[i] < PERF_CONTEXT_MAX) {	// skip context markers
+        nframes++;
+      }
+    }
+    if (!UniMemory::TraceMemory::Reserve(sizeof(CpuSample) + nframes * sizeof(uint64_t))) {
+      UniMemory::TraceMemory::CountDropped(1);
+      return;
+    }
+
+    for (uint64_t i = 0; i < nr; i++) {
+      if (ips[i] < PERF_CONTEXT_MAX) {
+        frames_.push_back(ips[i]);
+        sample.nframes_++;
+      }
+    }
+    samples_.push_back(sample);
+  }
+
+  const std::string& Symbolize(uint64_t ip, bool return_address) {
+    auto it = symbols_.find(ip);
+    if (it != symbols_.end()) {
+      return it->second;
+    }
+
+    // return addresses point past the call instruction and may belong to the next function
+    void *addr = reinterpret_cast<void *>(return_address ? (ip - 1) : ip);
+    std::string name;
+    Dl_info info;
+    if (dladdr(addr, &info) != 0) {
+      if (info.dli_sname != nullptr) {
+        name = utils::Demangle(info.dli_sname);
+      }
+      else if (info.dli_fname != nullptr) {
+        const char *file = std::strrchr(info.dli_fname, '/');
+        std::stringstream stream;
+        stream << ((file != nullptr) ? (file + 1) : info.dli_fname) << "+0x" << std::hex << (ip - reinterpret_cast<uint64_t>(info.dli_fbase));
+        name = stream.str();
+      }
+    }
+    if (name.empty()) {
+      std::stringstream stream;
+      stream << "0x" << std::hex << ip;
+      name = stream.str();
+    }
+
+    // names end up in JSON strings
+    std::replace(name.begin(), name.end(), '"', '\'');
+    std::replace(name.begin(), name.end(), '\\', '/');
+
+    return symbols_.insert({ip, std::move(name)}).first->second;
+  }
+
+  constexpr static uint32_t kMaxFrames = 64;
+  constexpr static uint32_t kNumDataPages = 16;	// must be power of 2
+  constexpr static uint32_t kPollInterval = 10;	// in ms
+  constexpr static size_t kMaxReportedFunctions = 20;
+  constexpr static size_t kCountLength = 12;
+  constexpr static size_t kPercentLength = 12;
+
+  uint64_t period_;	// in ns of thread CPU time
+  OnCpuSampleLoggingCallback callback_ = nullptr;
+  size_t page_size_;
+
+  std::thread sampler_;
+  std::atomic<bool> stop_{true};
+  uint32_t sampler_tid_ = 0;
+  std::map<uint32_t, CpuSampledThread> threads_;	// accessed by the sampler thread only until Stop()
+
+  uint8_t record_[sizeof(perf_event_header) + 2 * sizeof(uint32_t) + (kMaxFrames + 2 + 16) * sizeof(uint64_t)];
+  std::vector<CpuSample> samples_;
+  std::vector<uint64_t> frames_;
+  uint64_t lost_ = 0;
+  std::map<uint64_t, std::string> symbols_;
+};
+
+#endif // PTI_TOOLS_UNITRACE_CPU_COLLECTOR_H_
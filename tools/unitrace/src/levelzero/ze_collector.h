@@ -18,16 +18,27 @@
 #include <set>
 #include <sstream>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include <cmath>
+#include <random>
+#include <algorithm>
+#include <cstring>
 #include <dlfcn.h>
+#include <execinfo.h>
 
 #include <level_zero/ze_api.h>
 #include <level_zero/layers/zel_tracing_api.h>
 
 #include "correlator.h"
 #include "utils.h"
+#include "ze_command_list_timing.h"
+#include "ze_dependencies.h"
 #include "ze_event_cache.h"
+#include "ze_kernel_filter.h"
+#include "ze_memory_tracker.h"
+#include "ze_metric_query_cache.h"
+#include "ze_metric_stats.h"
 #include "ze_utils.h"
 #include "collector_options.h"
 #include "unikernel.h"
@@ -37,154 +48,14 @@
 
 #include "common_header.gen"
 
-struct ZeMetricQueryPoolKey {
-  ze_context_handle_t context_;
-  ze_device_handle_t device_;
-  zet_metric_group_handle_t group_;
-};
-
-struct ZeMetricQueryPoolKeyCompare {
-  bool operator()(const ZeMetricQueryPoolKey& lhs, const ZeMetricQueryPoolKey& rhs) const {
-    if (lhs.context_ < rhs.context_) {
-      return true;
-    }
-    if (lhs.context_ == rhs.context_) {
-      if (lhs.device_ < rhs.device_) {
-        return true;
-      }
-      if (lhs.device_ == rhs.device_) {
-        return (lhs.group_ < rhs.group_);
-      }
-    }
-    return false;
-  }
-};
- 
-struct ZeMetricQueryPools {
-  constexpr static uint32_t pool_size_ = 128;
-  std::mutex query_pool_mutex_;
-  std::map<zet_metric_query_handle_t, ZeMetricQueryPoolKey> query_pool_map_;
-  std::map<ZeMetricQueryPoolKey, std::vector<zet_metric_query_handle_t>, ZeMetricQueryPoolKeyCompare> free_pool_;
-  std::vector<zet_metric_query_pool_handle_t> pools_;
-
-  ZeMetricQueryPools() {}
-  
-  ZeMetricQueryPools(const struct ZeMetricQueryPools& that) = delete;
-
-  ZeMetricQueryPools& operator=(const struct ZeMetricQueryPools& that) = delete;
-
-  ~ZeMetricQueryPools() {
-    ze_result_t status;
-
-    const std::lock_guard<std::mutex> lock(query_pool_mutex_);
-    for (auto it = query_pool_map_.begin(); it != query_pool_map_.end(); it++) {
-      status = zetMetricQueryDestroy(it->first);
-      PTI_ASSERT(status == ZE_RESULT_SUCCESS);
-    }
-    query_pool_map_.clear();
-
-    for (auto it = pools_.begin(); it != pools_.end(); it++) {
-      status = zetMetricQueryPoolDestroy(*it);
-      PTI_ASSERT(status == ZE_RESULT_SUCCESS);
-    }
-    
-    pools_.clear();
-
-    free_pool_.clear();
-  }
-
-  zet_metric_query_handle_t
-  GetQuery(ze_context_handle_t context, ze_device_handle_t device, zet_metric_group_handle_t group) {
-    ze_result_t status;
-    zet_metric_query_handle_t query;
-
-    const std::lock_guard<std::mutex> lock(query_pool_mutex_);
-    auto it = free_pool_.find({context, device, group});
-    if (it == free_pool_.end()) {
-      // no pools created
-
-      zet_metric_query_pool_desc_t desc = {ZET_STRUCTURE_TYPE_METRIC_QUERY_POOL_DESC, nullptr, ZET_METRIC_QUERY_POOL_TYPE_PERFORMANCE, pool_size_};
-      zet_metric_query_pool_handle_t pool;
-
-      status = zetMetricQueryPoolCreate(context, device, group, &desc, &pool);
-      PTI_ASSERT(status == ZE_RESULT_SUCCESS);
-      pools_.push_back(pool);
-
-      std::vector<zet_metric_query_handle_t> queries;
-      for (int i = 0; i < pool_size_ - 1; i++) {
-        status = zetMetricQueryCreate(pool, i, &query);
-        PTI_ASSERT(status == ZE_RESULT_SUCCESS);
-        queries.push_back(query);
-        query_pool_map_.insert({query, {context, device, group}});
-      }
-      status = zetMetricQueryCreate(pool, pool_size_ - 1, &query);
-      PTI_ASSERT(status == ZE_RESULT_SUCCESS);
-      query_pool_map_.insert({query, {context, device, group}});
-      
-      free_pool_.insert({{context, device, group}, std::move(queries)});
-    }
-    else {
-      if (it->second.size() == 0) {
-        // no free queries, create a new pool
-
-        zet_metric_query_pool_desc_t desc = {ZET_STRUCTURE_TYPE_METRIC_QUERY_POOL_DESC, nullptr, ZET_METRIC_QUERY_POOL_TYPE_PERFORMANCE, pool_size_};
-        zet_metric_query_pool_handle_t pool;
-
-        status = zetMetricQueryPoolCreate(context, device, group, &desc, &pool);
-        PTI_ASSERT(status == ZE_RESULT_SUCCESS);
-        pools_.push_back(pool);
-
-        for (int i = 0; i < pool_size_ - 1; i++) {
-          status = zetMetricQueryCreate(pool, i, &query);
-          PTI_ASSERT(status == ZE_RESULT_SUCCESS);
-          it->second.push_back(query);
-          query_pool_map_.insert({query, {context, device, group}});
-        }
-        status = zetMetricQueryCreate(pool, pool_size_ - 1, &query);
-        PTI_ASSERT(status == ZE_RESULT_SUCCESS);
-        query_pool_map_.insert({query, {context, device, group}});
-      }
-      else {
-        query = it->second.back();
-        it->second.pop_back();
-      }
-    }
-
-    return query;
-  }
-    
-  void
-  PutQuery(zet_metric_query_handle_t query) {
-    if (query == nullptr) {
-      return;
-    }
-
-    const std::lock_guard<std::mutex> lock(query_pool_mutex_);
-    auto it = query_pool_map_.find(query);
-    if (it == query_pool_map_.end()) {
-      return;
-    }
-    auto it2 = free_pool_.find(it->second);
-    PTI_ASSERT(it2 != free_pool_.end());
-    it2->second.push_back(query);
-  }
-
-  void
-  ResetQuery(zet_metric_query_handle_t query) {
-    const std::lock_guard<std::mutex> lock(query_pool_mutex_);
-    if (query_pool_map_.find(query) == query_pool_map_.end()) {
-      return;
-    }
-    ze_result_t status = zetMetricQueryReset(query);
-    PTI_ASSERT(status == ZE_RESULT_SUCCESS);
-  }
-};
- 
 struct ZeInstanceData {
   uint64_t start_time_host;	// in ns
   uint64_t timestamp_host;	// in ns
   uint64_t timestamp_device;	// in ticks
   uint64_t kid;	// passing kid from enter callback to exit callback
+  bool kernel_skipped;	// passing kernel filter decision from enter callback to exit callback
+  uint64_t mem_free_id;	// passing id of the allocation being freed from enter callback to exit callback
+  ZeCommandDependencies dependencies;	// passing events waited on from enter callback to exit callback
 };
 
 thread_local ZeInstanceData ze_instance_data;
@@ -573,6 +444,9 @@ struct ZeKernelProfileTimestamps {
   int32_t subdevice_id;
 };
 
+// raw metric report, its storage is accounted against the tracing memory budget
+using ZeMetricReport = std::vector<uint8_t, UniMemory::TraceMemoryAllocator<uint8_t>>;
+
 struct ZeKernelProfileRecord {
   ze_device_handle_t device_ = nullptr;
   std::vector<ZeKernelProfileTimestamps> timestamps_;
@@ -580,7 +454,7 @@ struct ZeKernelProfileRecord {
   uint64_t instance_id_;
   ze_group_count_t group_count_;
   size_t mem_size_;
-  std::vector<uint8_t> *metrics_ = nullptr;
+  ZeMetricReport *metrics_ = nullptr;
 };
 
 using ZeKernelProfiles = std::map<uint64_t, ZeKernelProfileRecord>;
@@ -588,11 +462,41 @@ using ZeKernelProfiles = std::map<uint64_t, ZeKernelProfileRecord>;
 static std::mutex global_kernel_profiles_mutex_;
 static ZeKernelProfiles global_kernel_profiles_;
 
+static ZeDependencyRecordStore global_dependency_records_;
+
+void SweepDependencyRecords(std::vector<ZeDependencyRecord>& records) {
+  global_dependency_records_.Sweep(records);
+}
+
 void SweepKernelProfiles(ZeKernelProfiles& profiles) {
   const std::lock_guard<std::mutex> lock(global_kernel_profiles_mutex_);
   global_kernel_profiles_.insert(profiles.begin(), profiles.end());
 }
 
+// kernel metric statistics by device, then by kernel command name and sub-device
+using ZeKernelMetricStatsMap = std::map<ZeKernelCommandNameKey, ZeKernelMetricStats, ZeKernelCommandNameKeyCompare>;
+using ZeDeviceKernelMetricStats = std::map<ze_device_handle_t, ZeKernelMetricStatsMap>;
+
+static std::mutex global_kernel_metric_stats_mutex_;
+static ZeDeviceKernelMetricStats *global_kernel_metric_stats_ = nullptr;
+
+void SweepKernelMetricStats(ZeDeviceKernelMetricStats& stats) {
+  static std::minstd_rand rng;	// guarded by global_kernel_metric_stats_mutex_
+
+  const std::lock_guard<std::mutex> lock(global_kernel_metric_stats_mutex_);
+  if (global_kernel_metric_stats_ == nullptr) {
+    global_kernel_metric_stats_ = new ZeDeviceKernelMetricStats;
+    UniMemory::ExitIfOutOfMemory((void *)(global_kernel_metric_stats_));
+  }
+  for (auto& dstats : stats) {
+    auto& gstats = (*global_kernel_metric_stats_)[dstats.first];
+    for (auto& kstats : dstats.second) {
+      MergeKernelMetricStats(gstats[kstats.first], kstats.second, rng);
+    }
+  }
+  stats.clear();
+}
+
 static std::mutex global_device_time_stats_mutex_;
 static std::map<ZeKernelCommandNameKey, ZeKernelCommandTime, ZeKernelCommandNameKeyCompare> *global_device_time_stats_;
 
@@ -665,7 +569,7 @@ void SweepHostFunctionTimeStats(std::map<uint32_t, ZeFunctionTime>& stats) {
 
 struct ZeCommandMetricQuery {
   uint64_t instance_id_ = 0;	//unique kernel or command instance identifier
-  zet_metric_query_handle_t metric_query_ = nullptr;
+  ZeMetricQuery *metric_query_ = nullptr;
   ze_event_handle_t metric_query_event_ = nullptr;
   ze_device_handle_t device_ = nullptr;
   ZeKernelCommandType type_;
@@ -704,6 +608,19 @@ struct ZeCommand {
   int *redirected_kernel_timestamp_slot_;
   bool implicit_scaling_;
   bool immediate_;
+  ZeCommandDependencies dependencies_;
+
+  // command records are accounted against the tracing memory budget, but never refused
+  // as a command in flight has to be tracked to completion
+  static void *operator new(size_t size) {
+    void *ptr = UniMemory::TraceMemory::Allocate(size, true);
+    UniMemory::ExitIfOutOfMemory(ptr);
+    return ptr;
+  }
+
+  static void operator delete(void *ptr, size_t size) {
+    UniMemory::TraceMemory::Free(ptr, size);
+  }
 };
 
 
@@ -721,6 +638,14 @@ struct ZeDeviceSubmissions {
   std::map<ZeKernelCommandNameKey, ZeKernelCommandTime, ZeKernelCommandNameKeyCompare> device_time_stats_;
   std::map<uint32_t, ZeFunctionTime> host_time_stats_;
   ZeKernelProfiles kernel_profiles_;
+  ZeDeviceKernelMetricStats kernel_metric_stats_;
+  std::vector<ZeDependencyRecord> dependency_records_;
+  std::vector<ZeMetricReport *> metric_reports_free_pool_;	// used as a stack
+  std::vector<uint32_t> metric_samples_;	// scratch buffers for metric calculation
+  std::vector<zet_typed_value_t> metric_values_;
+  std::vector<double> metric_sample_values_;
+  std::minstd_rand metric_rng_;
+  ZeMetricQueryCache metric_query_cache_;
   std::atomic<bool> finalized_;
 
   ZeDeviceSubmissions() {
@@ -748,9 +673,15 @@ struct ZeDeviceSubmissions {
       SweepKernelCommandTimeStats(device_time_stats_);
       SweepHostFunctionTimeStats(host_time_stats_);
       SweepKernelProfiles(kernel_profiles_);
+      SweepKernelMetricStats(kernel_metric_stats_);
+      SweepDependencyRecords(dependency_records_);
+      metric_query_cache_.Flush();
       global_device_submissions_->erase(this);
     }
     global_device_submissions_mutex_.unlock();
+    for (auto report : metric_reports_free_pool_) {
+      delete report;
+    }
   }
   
   ZeDeviceSubmissions(const struct ZeDeviceSubmissions& that) = delete;
@@ -905,6 +836,47 @@ struct ZeDeviceSubmissions {
     }
   }
 
+  // nullptr if memory runs out, the caller drops the report
+  inline ZeMetricReport *GetMetricReport(size_t size) {
+    ZeMetricReport *report;
+
+    if (metric_reports_free_pool_.empty()) {
+      report = new (std::nothrow) ZeMetricReport;
+      if (report == nullptr) {
+        return nullptr;
+      }
+    }
+    else {
+      report = metric_reports_free_pool_.back();
+      metric_reports_free_pool_.pop_back();
+    }
+    try {
+      report->resize(size);	// capacity is retained when the report is recycled
+    }
+    catch (const std::bad_alloc&) {
+      delete report;
+      return nullptr;
+    }
+
+    return report;
+  }
+
+  inline void PutMetricReport(ZeMetricReport *report) {
+    if (UniMemory::TraceMemory::IsOverBudget()) {
+      // give the memory back instead of holding it in the pool
+      delete report;
+    }
+    else {
+      metric_reports_free_pool_.push_back(report);
+    }
+  }
+
+  inline ZeKernelMetricStats& CollectKernelMetricStats(ze_device_handle_t device, const ZeKernelCommandNameKey& key, const std::vector<double>& values) {
+    ZeKernelMetricStats& stats = kernel_metric_stats_[device][key];
+    AddKernelMetricSample(stats, values, metric_rng_);
+    return stats;
+  }
+
   inline bool IsFinalized(void) {
     return finalized_.load(std::memory_order_acquire);
   }
@@ -915,6 +887,9 @@ struct ZeDeviceSubmissions {
     SweepKernelCommandTimeStats(device_time_stats_);
     SweepHostFunctionTimeStats(host_time_stats_);
     SweepKernelProfiles(kernel_profiles_);
+    SweepKernelMetricStats(kernel_metric_stats_);
+    SweepDependencyRecords(dependency_records_);
+    metric_query_cache_.Flush();
   }
 };
 
@@ -936,6 +911,7 @@ struct ZeKernelCommandProperties {
   ZeKernelCommandType type_;
   uint32_t regsize_;	// GRF size per thread
   bool aot_;		// AOT or JIT
+  bool traced_ = true;	// kernel passes --include-kernels/--exclude-kernels
   std::string name_;	// kernel or command name
 };
 
@@ -1012,12 +988,15 @@ struct ZeCommandList {
   volatile uint64_t device_global_timestamps_[max_num_commands_in_command_list_ * 2];
   int next_free_device_global_timestamps_slot_;
   ze_event_handle_t timestamp_event_to_signal_;
+  ZeCommandListTimingState list_timing_;	// command list timing mode
 };
 
 typedef void (*OnZeFunctionFinishCallback)(std::vector<uint64_t> *kids, FLOW_DIR flow_dir, API_TRACING_ID api_id, uint64_t started, uint64_t ended);
 
 typedef void (*OnZeKernelFinishCallback)(uint64_t kid, uint64_t tid, uint64_t start, uint64_t end, uint32_t ordinal, uint32_t index, int32_t tile, const ze_device_handle_t device, const uint64_t kernel_command_id, bool implicit_scaling, const ze_group_count_t& group_count, size_t mem_size);
 
+typedef void (*OnZeMemoryUsageCallback)(ze_device_handle_t device, ze_memory_type_t type, uint64_t live_bytes, uint64_t timestamp);
+
 ze_result_t (*zexKernelGetBaseAddress)(ze_kernel_handle_t hKernel, uint64_t *baseAddress) = nullptr;
 
 inline std::string GetZeKernelCommandName(uint64_t id, const ze_group_count_t& group_count, size_t size, bool detailed = true) {
@@ -1169,6 +1148,18 @@ class ZeCollector {
     }
 
     DumpKernelProfiles();
+
+    if (options_.dependency_analysis) {
+      DumpDependencies();
+    }
+
+    if (options_.memory_tracking) {
+      DumpMemoryUsage();
+    }
+  }
+
+  void SetMemoryCallback(OnZeMemoryUsageCallback callback) {
+    mcallback_ = callback;
   }
 
   uint64_t CalculateTotalKernelTime() const {
@@ -1586,6 +1577,7 @@ class ZeCollector {
         callback_data_(callback_data),
         event_cache_(ZE_EVENT_POOL_FLAG_KERNEL_TIMESTAMP) {
     data_dir_name_ = data_dir_name;
+    metric_query_raw_samples_ = ParseMetricQueryRawSamples(utils::GetEnv("UNITRACE_MetricQueryRawSamples"));
     EnumerateAndSetupDevices();
     InitializeKernelCommandProperties();
   }
@@ -1848,6 +1840,86 @@ class ZeCollector {
     return names;
   }
 
+  static double TypedValueToDouble(const zet_typed_value_t& typed_value) {
+    switch (typed_value.type) {
+      case ZET_VALUE_TYPE_UINT32:
+        return static_cast<double>(typed_value.value.ui32);
+      case ZET_VALUE_TYPE_UINT64:
+        return static_cast<double>(typed_value.value.ui64);
+      case ZET_VALUE_TYPE_FLOAT32:
+        return static_cast<double>(typed_value.value.fp32);
+      case ZET_VALUE_TYPE_FLOAT64:
+        return typed_value.value.fp64;
+      case ZET_VALUE_TYPE_BOOL8:
+        return static_cast<double>(typed_value.value.b8);
+      default:
+        PTI_ASSERT(0);
+        break;
+    }
+    return 0.0;
+  }
+
+  // calculates metrics in the report and folds them into per-kernel statistics of the submissions
+  // returns true if the raw report is to be kept as a sample
+  bool AggregateKernelCommandMetrics(ZeDeviceSubmissions& submissions, const ZeKernelProfileRecord& record, const ZeMetricReport& report) {
+    zet_metric_group_handle_t group = nullptr;
+    devices_mutex_.lock_shared();
+    auto dit = devices_->find(record.device_);
+    if (dit != devices_->end()) {
+      group = dit->second.metric_group_;
+    }
+    devices_mutex_.unlock_shared();
+    if (group == nullptr) {
+      return false;
+    }
+
+    uint32_t num_samples = 0;
+    uint32_t num_metrics = 0;
+    ze_result_t status = zetMetricGroupCalculateMultipleMetricValuesExp(
+      group, ZET_METRIC_GROUP_CALCULATION_TYPE_METRIC_VALUES,
+      report.size(), report.data(), &num_samples, &num_metrics, nullptr, nullptr);
+    if ((status != ZE_RESULT_SUCCESS) || (num_samples == 0) || (num_metrics == 0)) {
+      std::cerr << "[WARNING] Not able to calculate metrics" << std::endl;
+      return false;
+    }
+
+    // scratch buffers only grow, so no allocation once the largest report is seen
+    if (submissions.metric_samples_.size() < num_samples) {
+      submissions.metric_samples_.resize(num_samples);
+    }
+    if (submissions.metric_values_.size() < num_metrics) {
+      submissions.metric_values_.resize(num_metrics);
+    }
+    status = zetMetricGroupCalculateMultipleMetricValuesExp(
+      group, ZET_METRIC_GROUP_CALCULATION_TYPE_METRIC_VALUES,
+      report.size(), report.data(), &num_samples, &num_metrics,
+      submissions.metric_samples_.data(), submissions.metric_values_.data());
+    if (status != ZE_RESULT_SUCCESS) {
+      std::cerr << "[WARNING] Not able to calculate metrics" << std::endl;
+      return false;
+    }
+
+    bool keep = false;
+    std::vector<double>& values = submissions.metric_sample_values_;
+    const zet_typed_value_t *value = submissions.metric_values_.data();
+    for (uint32_t i = 0; i < num_samples; ++i) {
+      uint32_t size = submissions.metric_samples_[i];
+      values.resize(size);
+      for (uint32_t j = 0; j < size; ++j) {
+        values[j] = TypedValueToDouble(value[j]);
+      }
+      value += size;
+
+      ZeKernelCommandNameKey key{record.kernel_command_id_, record.mem_size_, static_cast<int>(i), record.group_count_};
+      ZeKernelMetricStats& stats = submissions.CollectKernelMetricStats(record.device_, key, values);
+      if (i == 0) {
+        keep = TakeKernelMetricRawSample(stats, metric_query_raw_samples_);
+      }
+    }
+
+    return keep;
+  }
+
   bool QueryKernelCommandMetrics(ZeDeviceSubmissions& submissions, ZeCommandMetricQuery *command_metric_query) {
 
     ze_result_t status;
@@ -1855,27 +1927,45 @@ class ZeCollector {
 
       auto it = submissions.kernel_profiles_.find(command_metric_query->instance_id_);
       if (it != submissions.kernel_profiles_.end()) {
+        bool keep = false;
         size_t size = 0;
-        status = zetMetricQueryGetData(command_metric_query->metric_query_, &size, nullptr);
+        status = zetMetricQueryGetData(command_metric_query->metric_query_->query_, &size, nullptr);
         if ((status == ZE_RESULT_SUCCESS) && (size > 0)) {
 
-          std::vector<uint8_t> *kmetrics = new std::vector<uint8_t>(size);
-          UniMemory::ExitIfOutOfMemory((void *)(kmetrics));
-          size_t size2 = size;
-          status = zetMetricQueryGetData(command_metric_query->metric_query_, &size2, kmetrics->data());
-          if (size2 == size) {
-            it->second.metrics_ = kmetrics;
+          ZeMetricReport *kmetrics = submissions.GetMetricReport(size);
+          if (kmetrics == nullptr) {
+            // out of memory, the metrics of the instance are lost
+            UniMemory::TraceMemory::CountDropped(1);
           }
           else {
-            delete kmetrics;
+            size_t size2 = size;
+            status = zetMetricQueryGetData(command_metric_query->metric_query_->query_, &size2, kmetrics->data());
+            if ((status == ZE_RESULT_SUCCESS) && (size2 == size)) {
+              keep = AggregateKernelCommandMetrics(submissions, it->second, *kmetrics);
+            }
+            if (keep && UniMemory::TraceMemory::IsOverBudget()) {
+              // over tracing memory budget, the instance is still in the aggregated metrics
+              UniMemory::TraceMemory::CountDropped(1);
+              keep = false;
+            }
+            if (keep) {
+              it->second.metrics_ = kmetrics;
+            }
+            else {
+              submissions.PutMetricReport(kmetrics);
+            }
           }
         }
+        if (!keep && !options_.metric_stream) {
+          // metrics are aggregated already, no need to hold on to the instance
+          submissions.kernel_profiles_.erase(it);
+        }
       }
       event_cache_.ResetEvent(command_metric_query->metric_query_event_);
-      query_pools_.ResetQuery(command_metric_query->metric_query_);
+      ZeMetricQueryPools::ResetQuery(command_metric_query->metric_query_);
       if (command_metric_query->immediate_) {
         event_cache_.ReleaseEvent(command_metric_query->metric_query_event_);
-        query_pools_.PutQuery(command_metric_query->metric_query_);
+        submissions.metric_query_cache_.PutQuery(command_metric_query->metric_query_);
       }
       command_metric_query->metric_query_event_ = nullptr;
       command_metric_query->metric_query_ = nullptr;
@@ -1955,11 +2045,11 @@ class ZeCollector {
     }
     
     const std::lock_guard<std::mutex> lock(global_kernel_profiles_mutex_);
-    if (global_kernel_profiles_.size() == 0) {
-      return;
-    }
-    
     if (options_.metric_stream) {
+      if (global_kernel_profiles_.size() == 0) {
+        return;
+      }
+
       devices_mutex_.lock_shared();
       std::map<int32_t, std::vector<ZeKernelProfileRecord *>> device_kprofiles; // kernel profiles by device;
       for (auto it = global_kernel_profiles_.begin(); it != global_kernel_profiles_.end(); it++) {
@@ -2009,12 +2099,29 @@ class ZeCollector {
     }
 
     // metric query
-    correlator_->Log("\n== Kernel Metrics ==\n\n");
+    DumpKernelMetricStats();
 
+    bool raw_header_logged = false;
+    // raw reports kept per kernel, threads may keep more than needed in total
+    std::map<ze_device_handle_t, std::map<ZeKernelCommandNameKey, int64_t, ZeKernelCommandNameKeyCompare>> raw_samples;
     for (auto it = global_kernel_profiles_.begin(); it != global_kernel_profiles_.end(); it++) {
-      if ((it->second.metrics_ == nullptr) || it->second.metrics_->empty()) {
+      if (it->second.metrics_ == nullptr) {
+        continue;
+      }
+      if (it->second.metrics_->empty()) {
+        delete it->second.metrics_;
+        it->second.metrics_ = nullptr;
+        continue;
+      }
+
+      ZeKernelCommandNameKey key{it->second.kernel_command_id_, it->second.mem_size_, -1, it->second.group_count_};
+      int64_t& count = raw_samples[it->second.device_][key];
+      if ((metric_query_raw_samples_ >= 0) && (count >= metric_query_raw_samples_)) {
+        delete it->second.metrics_;
+        it->second.metrics_ = nullptr;
         continue;
       }
+      count++;
 
       std::string kname = GetZeKernelCommandName(it->second.kernel_command_id_, it->second.group_count_, it->second.mem_size_);
 
@@ -2033,6 +2140,11 @@ class ZeCollector {
         PTI_ASSERT(!metric_names.empty());
       }
 
+      if (!raw_header_logged) {
+        correlator_->Log("\n== Kernel Metrics (Sampled Instances) ==\n\n");
+        raw_header_logged = true;
+      }
+
       uint32_t num_samples = 0;
       uint32_t num_metrics = 0;
       ze_result_t status = zetMetricGroupCalculateMultipleMetricValuesExp(
@@ -2058,19 +2170,20 @@ class ZeCollector {
           correlator_->Log(header);
     
           std::string str;
+          const zet_typed_value_t *value = metrics.data();
           for (uint32_t i = 0; i < num_samples; ++i) {
-            str = kname + ",";
+            str += kname + ",";
             str += std::to_string(did) + ",";
             str += std::to_string(i) + ",";
     
             uint32_t size = samples[i];
             PTI_ASSERT(size == metric_names.size());
     
-            const zet_typed_value_t *value = metrics.data() + i * size;
             for (int j = 0; j < size; ++j) {
               str += PrintTypedValue(value[j]);
               str += ",";
             }
+            value += size;
             str += "\n";
           }
     
@@ -2083,11 +2196,229 @@ class ZeCollector {
       else {
         std::cerr << "[WARNING] Not able to calculate metrics" << std::endl;
       }
+      delete it->second.metrics_;
+      it->second.metrics_ = nullptr;
     }
 
     global_kernel_profiles_.clear();
   }
 
+  void DumpKernelMetricStats(void) {
+    const std::lock_guard<std::mutex> lock(global_kernel_metric_stats_mutex_);
+    if ((global_kernel_metric_stats_ == nullptr) || global_kernel_metric_stats_->empty()) {
+      return;
+    }
+
+    correlator_->Log("\n== Kernel Metrics ==\n\n");
+
+    const uint32_t percentiles[] = {50, 90, 99};
+    for (auto& dstats : *global_kernel_metric_stats_) {
+      int32_t did = -1;
+      zet_metric_group_handle_t group = nullptr;
+      devices_mutex_.lock_shared();
+      auto dit = devices_->find(dstats.first);
+      if (dit != devices_->end()) {
+        did = dit->second.id_;
+        group = dit->second.metric_group_;
+      }
+      devices_mutex_.unlock_shared();
+      if (group == nullptr) {
+        continue;
+      }
+
+      std::vector<std::string> metric_names = GetMetricNames(group);
+      PTI_ASSERT(!metric_names.empty());
+
+      std::string header("\nKernel,Device,SubDeviceId,Calls,Statistic,");
+      for (auto& metric : metric_names) {
+        header += metric + ",";
+      }
+      header += "\n";
+      correlator_->Log(header);
+
+      for (auto& kstats : dstats.second) {
+        const ZeKernelMetricStats& stats = kstats.second;
+        if ((stats.call_count_ == 0) || (stats.sum_.size() != metric_names.size())) {
+          continue;
+        }
+
+        std::string prefix = GetZeKernelCommandName(kstats.first.kernel_command_id_, kstats.first.group_count_, kstats.first.mem_size_) + ",";
+        prefix += std::to_string(did) + ",";
+        prefix += std::to_string(kstats.first.tile_) + ",";
+        prefix += std::to_string(stats.call_count_) + ",";
+
+        std::string str;
+        str += prefix + "Sum,";
+        for (auto v : stats.sum_) {
+          str += std::to_string(v) + ",";
+        }
+        str += "\n" + prefix + "Average,";
+        for (auto v : stats.sum_) {
+          str += std::to_string(v / stats.call_count_) + ",";
+        }
+        str += "\n" + prefix + "Min,";
+        for (auto v : stats.min_) {
+          str += std::to_string(v) + ",";
+        }
+        str += "\n" + prefix + "Max,";
+        for (auto v : stats.max_) {
+          str += std::to_string(v) + ",";
+        }
+        str += "\n";
+
+        if (!stats.reservoir_.empty()) {
+          // percentiles are estimated from up to kMetricReservoirSize sampled instances
+          std::vector<std::vector<double>> columns(metric_names.size());
+          for (auto& row : stats.reservoir_) {
+            for (size_t i = 0; i < row.size() && i < columns.size(); i++) {
+              columns[i].push_back(row[i]);
+            }
+          }
+          for (auto p : percentiles) {
+            str += prefix + "P" + std::to_string(p) + ",";
+            for (auto& column : columns) {
+              str += (column.empty() ? std::string("") : std::to_string(GetMetricPercentile(column, p))) + ",";
+            }
+            str += "\n";
+          }
+        }
+        correlator_->Log(str);
+      }
+    }
+
+    global_kernel_metric_stats_->clear();
+  }
+
+  static std::string GetMemoryDeviceName(ze_device_handle_t device) {
+    if (device == nullptr) {
+      return "-";
+    }
+
+    int32_t parent_id = -1;
+    int32_t did = -1;
+    int32_t sub_id = -1;
+    if (GetZeDevicePciPropertiesAndId(device, &parent_id, &did, &sub_id) == nullptr) {
+      return "-";
+    }
+    if (parent_id >= 0) {
+      return std::to_string(parent_id) + "." + std::to_string(sub_id);
+    }
+    return std::to_string(did);
+  }
+
+  static const char *GetMemoryTypeName(ze_memory_type_t type) {
+    switch (type) {
+      case ZE_MEMORY_TYPE_HOST:
+        return "Host";
+      case ZE_MEMORY_TYPE_DEVICE:
+        return "Device";
+      case ZE_MEMORY_TYPE_SHARED:
+        return "Shared";
+      default:
+        return "Unknown";
+    }
+  }
+
+  void DumpDependencies(void) {
+    ZeDependencyStatsMap stats = global_dependency_records_.Analyze();
+    if (stats.empty()) {
+      return;
+    }
+
+    std::vector<std::pair<uint64_t, const ZeDependencyStats *>> sorted;
+    for (auto& s : stats) {
+      sorted.push_back({s.first, &s.second});
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) { return (a.second->gap_time_ > b.second->gap_time_); });
+
+    ze_group_count_t group_count = {0, 0, 0};
+    correlator_->Log("\n== Kernel Dependencies ==\n\n");
+    correlator_->Log("Kernel,Calls,Pre-Start Gap (ns),Dependency Wait (ns),Host Submit Delay (ns),Engine Busy (ns)\n");
+    for (auto& s : sorted) {
+      std::string str = GetZeKernelCommandName(s.first, group_count, 0, false) + ",";
+      str += std::to_string(s.second->count_) + ",";
+      str += std::to_string(s.second->gap_time_) + ",";
+      str += std::to_string(s.second->dependency_wait_time_) + ",";
+      str += std::to_string(s.second->host_submit_delay_time_) + ",";
+      str += std::to_string(s.second->engine_busy_time_) + "\n";
+      correlator_->Log(str);
+    }
+    uint64_t dropped = global_dependency_records_.GetDroppedCount();
+    if (dropped > 0) {
+      correlator_->Log("\nTruncated: " + std::to_string(dropped) + " instances after the first " +
+          std::to_string(global_dependency_records_.GetMaxRecords()) + " are not analyzed\n");
+    }
+
+    constexpr size_t kMaxBlockingEdges = 3;	// per kernel
+    std::string edges;
+    for (auto& s : sorted) {
+      std::vector<std::pair<uint64_t, ZeBlockingEdge>> top(s.second->blocking_edges_.begin(), s.second->blocking_edges_.end());
+      std::sort(top.begin(), top.end(), [](const auto& a, const auto& b) { return (a.second.wait_time_ > b.second.wait_time_); });
+      if (top.size() > kMaxBlockingEdges) {
+        top.resize(kMaxBlockingEdges);
+      }
+      for (auto& edge : top) {
+        edges += GetZeKernelCommandName(s.first, group_count, 0, false) + ",";
+        edges += GetZeKernelCommandName(edge.first, group_count, 0, false) + ",";
+        edges += std::to_string(edge.second.count_) + ",";
+        edges += std::to_string(edge.second.wait_time_) + "\n";
+      }
+    }
+    if (edges.empty()) {
+      return;
+    }
+
+    correlator_->Log("\n== Blocking Edges ==\n\n");
+    correlator_->Log("Kernel,Blocked By,Count,Dependency Wait (ns)\n");
+    correlator_->Log(edges);
+  }
+
+  void DumpMemoryUsage(void) {
+    std::string str;
+    memory_tracker_.ForEachUsage([&str](const ZeMemoryUsageKey& key, const ZeMemoryUsage& usage) {
+      str += GetMemoryDeviceName(key.device_) + ",";
+      str += std::string(GetMemoryTypeName(key.type_)) + ",";
+      str += std::to_string(usage.alloc_count_.load(std::memory_order_relaxed)) + ",";
+      str += std::to_string(usage.free_count_.load(std::memory_order_relaxed)) + ",";
+      str += std::to_string(usage.total_.load(std::memory_order_relaxed)) + ",";
+      str += std::to_string(usage.peak_.load(std::memory_order_relaxed)) + ",";
+      str += std::to_string(usage.live_.load(std::memory_order_relaxed)) + "\n";
+    });
+    if (str.empty()) {
+      return;
+    }
+
+    correlator_->Log("\n== Memory Usage ==\n\n");
+    correlator_->Log("Device,Type,Allocations,Frees,Total (bytes),Peak (bytes),Live At Exit (bytes)\n");
+    correlator_->Log(str);
+
+    std::vector<std::pair<const void *, ZeMemoryAllocation>> leaks;
+    memory_tracker_.ForEachAllocation([&leaks](const void *ptr, const ZeMemoryAllocation& alloc) {
+      leaks.push_back({ptr, alloc});
+    });
+    if (leaks.empty()) {
+      return;
+    }
+
+    std::sort(leaks.begin(), leaks.end(), [](const auto& a, const auto& b) { return (a.second.alloc_time_ < b.second.alloc_time_); });
+
+    correlator_->Log("\n== Memory Leaks ==\n\n");
+    correlator_->Log("Address,Size (bytes),Device,Type,API,Call Site,Thread,Allocated At (ns)\n");
+    for (auto& leak : leaks) {
+      char addr[32];
+      snprintf(addr, sizeof(addr), "%p", leak.first);
+      str = std::string(addr) + ",";
+      str += std::to_string(leak.second.size_) + ",";
+      str += GetMemoryDeviceName(leak.second.device_) + ",";
+      str += std::string(GetMemoryTypeName(leak.second.type_)) + ",";
+      str += get_symbol(leak.second.api_id_) + ",";
+      str += GetCallSiteName(GetApplicationCallSite(leak.second)) + ",";
+      str += std::to_string(leak.second.tid_) + ",";
+      str += std::to_string(leak.second.alloc_time_) + "\n";
+      correlator_->Log(str);
+    }
+  }
+
   void ProcessCommandsSubmittedOnSignaledEvent(ze_event_handle_t event, std::vector<uint64_t> *kids) {
     if (local_device_submissions_.IsFinalized()) {
       return;
@@ -2264,6 +2595,16 @@ class ZeCollector {
       PrintCommandCompleted(command, kernel_start, kernel_end);
     }
 
+    if (options_.dependency_analysis && (tile <= 0)) {
+      // records are held until the dependencies are dumped at the end, instances the store has no
+      // room for are left out of the dependency analysis
+      if (global_dependency_records_.Reserve()) {
+        local_device_submissions_.dependency_records_.push_back({command->instance_id_, command->kernel_command_id_,
+            command->device_, command->engine_ordinal_, command->engine_index_, command->submit_time_,
+            kernel_start, kernel_end, command->dependencies_});
+      }
+    }
+
     if (kcallback_) {
 
       bool implicit_scaling = ((tile >= 0) && command->implicit_scaling_);
@@ -2447,6 +2788,8 @@ class ZeCollector {
       UniMemory::ExitIfOutOfMemory((void *)(desc));
     }
     desc->next_free_timestamp_slot_ = 0;
+    desc->next_free_device_global_timestamps_slot_ = 0;
+    desc->list_timing_.Reset();
     command_lists_mutex_.unlock();
 
     desc->cmdlist_ = command_list;
@@ -2548,6 +2891,7 @@ class ZeCollector {
         it->second->event_timestamp_slots_.clear();
         it->second->next_free_timestamp_slot_ = 0;
         it->second->next_free_device_global_timestamps_slot_ = 0;
+        it->second->list_timing_.Reset();
         for (int i = 0; i < max_num_commands_in_command_list_; i++) {
           it->second->timestamp_redirected_slots_[i] = -1;
         }
@@ -2819,7 +3163,114 @@ class ZeCollector {
     }
   }
 
-  static zet_metric_query_handle_t PrepareToAppendKernelCommand(
+  // return address of the Level Zero call that made the allocation: the first frame outside of the loader,
+  // the tracing layer and this library, nullptr if it is not in the frames kept
+  static const void *GetApplicationCallSite(const ZeMemoryAllocation& alloc) {
+    Dl_info self;
+    if (dladdr(reinterpret_cast<void *>(&GetCallSiteName), &self) == 0) {
+      return nullptr;
+    }
+    for (int i = 0; i < alloc.call_stack_size_; i++) {
+      Dl_info info;
+      if ((dladdr(alloc.call_stack_[i], &info) == 0) || (info.dli_fbase == self.dli_fbase)) {
+        continue;
+      }
+      if ((info.dli_fname != nullptr) &&
+          ((strstr(info.dli_fname, "libze_loader") != nullptr) || (strstr(info.dli_fname, "libze_tracing_layer") != nullptr))) {
+        continue;
+      }
+      return alloc.call_stack_[i];
+    }
+    return nullptr;
+  }
+
+  // module and offset in the module, so it can be resolved with addr2line
+  static std::string GetCallSiteName(const void *call_site) {
+    Dl_info info;
+    if ((call_site == nullptr) || (dladdr(call_site, &info) == 0) || (info.dli_fname == nullptr)) {
+      return "unknown";
+    }
+    const char *module = strrchr(info.dli_fname, '/');
+    module = (module == nullptr) ? info.dli_fname : (module + 1);
+    std::stringstream stream;
+    stream << module << "+0x" << std::hex << (reinterpret_cast<uintptr_t>(call_site) - reinterpret_cast<uintptr_t>(info.dli_fbase));
+    return stream.str();
+  }
+
+  void TrackMemoryAllocation(const void *ptr, size_t size, ze_device_handle_t device, ze_memory_type_t type, API_TRACING_ID api_id) {
+    ZeMemoryAllocation alloc;
+    alloc.size_ = size;
+    alloc.alloc_time_ = UniTimer::GetHostTimestamp();
+    alloc.device_ = device;
+    alloc.type_ = type;
+    alloc.api_id_ = api_id;
+    alloc.tid_ = utils::GetTid();
+    // raw return addresses only, they are resolved at exit for the allocations leaked
+    alloc.call_stack_size_ = backtrace(alloc.call_stack_, kMemoryCallStackDepth);
+
+    uint64_t live = memory_tracker_.Allocate(ptr, alloc);
+    if (mcallback_) {
+      mcallback_(device, type, live, alloc.alloc_time_);
+    }
+  }
+
+  void TrackMemoryFree(const void *ptr, uint64_t id) {
+    ZeMemoryAllocation alloc;
+    uint64_t live = 0;
+    if (memory_tracker_.Free(ptr, id, alloc, live) && mcallback_) {
+      mcallback_(alloc.device_, alloc.type_, live, UniTimer::GetHostTimestamp());
+    }
+  }
+
+  static void OnExitMemAllocDevice(
+      ze_mem_alloc_device_params_t *params, ze_result_t result,
+      void *global_data, void **instance_data) {
+    if ((result == ZE_RESULT_SUCCESS) && (**(params->ppptr) != nullptr)) {
+      ZeCollector* collector = reinterpret_cast<ZeCollector*>(global_data);
+      collector->TrackMemoryAllocation(**(params->ppptr), *(params->psize), *(params->phDevice), ZE_MEMORY_TYPE_DEVICE, MemAllocDeviceTracingId);
+    }
+  }
+
+  static void OnExitMemAllocHost(
+      ze_mem_alloc_host_params_t *params, ze_result_t result,
+      void *global_data, void **instance_data) {
+    if ((result == ZE_RESULT_SUCCESS) && (**(params->ppptr) != nullptr)) {
+      ZeCollector* collector = reinterpret_cast<ZeCollector*>(global_data);
+      collector->TrackMemoryAllocation(**(params->ppptr), *(params->psize), nullptr, ZE_MEMORY_TYPE_HOST, MemAllocHostTracingId);
+    }
+  }
+
+  static void OnExitMemAllocShared(
+      ze_mem_alloc_shared_params_t *params, ze_result_t result,
+      void *global_data, void **instance_data) {
+    if ((result == ZE_RESULT_SUCCESS) && (**(params->ppptr) != nullptr)) {
+      ZeCollector* collector = reinterpret_cast<ZeCollector*>(global_data);
+      // device is optional for shared allocations
+      collector->TrackMemoryAllocation(**(params->ppptr), *(params->psize), *(params->phDevice), ZE_MEMORY_TYPE_SHARED, MemAllocSharedTracingId);
+    }
+  }
+
+  static void OnEnterMemFree(
+      ze_mem_free_params_t *params, void *global_data, void **instance_data) {
+    // once the driver frees the memory, it can hand the same address out to another thread
+    // before the exit callback, so the allocation to untrack is identified here
+    ze_instance_data.mem_free_id = 0;
+    if (*(params->pptr) != nullptr) {
+      ZeCollector* collector = reinterpret_cast<ZeCollector*>(global_data);
+      ze_instance_data.mem_free_id = collector->memory_tracker_.GetId(*(params->pptr));
+    }
+  }
+
+  static void OnExitMemFree(
+      ze_mem_free_params_t *params, ze_result_t result,
+      void *global_data, void **instance_data) {
+    if ((result == ZE_RESULT_SUCCESS) && (*(params->pptr) != nullptr) && (ze_instance_data.mem_free_id != 0)) {
+      ZeCollector* collector = reinterpret_cast<ZeCollector*>(global_data);
+      collector->TrackMemoryFree(*(params->pptr), ze_instance_data.mem_free_id);
+    }
+  }
+
+  static ZeMetricQuery *PrepareToAppendKernelCommand(
     ZeCollector* collector,
     ze_event_handle_t& signal_event,
     ze_command_list_handle_t command_list,
@@ -2850,18 +3301,18 @@ class ZeCollector {
     } 
    
     ze_result_t status;
-    zet_metric_query_handle_t query = nullptr;
+    ZeMetricQuery *query = nullptr;
     if (collector->options_.metric_query && iskernel) {
       devices_mutex_.lock_shared();
 
       auto it2 = devices_->find(device);
 
       PTI_ASSERT(it2 != devices_->end());
-      query = collector->query_pools_.GetQuery(context, device, it2->second.metric_group_);
+      query = local_device_submissions_.metric_query_cache_.GetQuery(collector->query_pools_, context, device, it2->second.metric_group_);
 
       devices_mutex_.unlock_shared();
 
-      status = zetCommandListAppendMetricQueryBegin(command_list, query);
+      status = zetCommandListAppendMetricQueryBegin(command_list, query->query_);
       PTI_ASSERT(status == ZE_RESULT_SUCCESS);
     }
 
@@ -2877,6 +3328,35 @@ class ZeCollector {
     return query;
   }
 
+  // events waited on are kept until the command is appended
+  void StageDependencies(uint32_t num_wait_events, ze_event_handle_t *wait_events) {
+    if (!options_.dependency_analysis) {
+      return;
+    }
+
+    ZeCommandDependencies& dependencies = ze_instance_data.dependencies;
+    dependencies.num_wait_events_ = (wait_events == nullptr) ? 0 : num_wait_events;
+    uint32_t count = std::min(dependencies.num_wait_events_, static_cast<uint32_t>(MAX_NUM_WAIT_EVENTS_TRACKED));
+    for (uint32_t i = 0; i < count; i++) {
+      dependencies.wait_event_ids_[i] = event_ids_.GetId(wait_events[i]);
+    }
+  }
+
+  void SetCommandDependencies(ZeCommand *desc) {
+    if (!options_.dependency_analysis) {
+      return;
+    }
+
+    desc->dependencies_ = ze_instance_data.dependencies;
+    desc->dependencies_.signal_event_id_ = event_ids_.GetId(desc->event_);
+  }
+
+  // on exit of every append staging dependencies, whether the command is appended, failed or
+  // filtered out, so that the events of one command are never taken for those of the next
+  void ClearStagedDependencies(void) {
+    ze_instance_data.dependencies.num_wait_events_ = 0;
+  }
+
   static void PrepareToAppendKernelCommand(ZeCollector* collector, ZeCommandList *cl) {
     ze_result_t status;
     uint64_t host_timestamp;
@@ -2889,12 +3369,135 @@ class ZeCollector {
     ze_instance_data.timestamp_device = device_timestamp;
   }
 
+  // launches of kernels filtered out are left uninstrumented
+  bool IsKernelLaunchTraced(ze_kernel_handle_t kernel) {
+    if (!kernel_filter_.IsActive()) {
+      return true;
+    }
+
+    bool traced = true;
+    kernel_command_properties_mutex_.lock_shared();
+    auto it = active_kernel_properties_->find(kernel);
+    if (it != active_kernel_properties_->end()) {
+      traced = it->second.traced_;
+    }
+    kernel_command_properties_mutex_.unlock_shared();
+
+    return (traced && kernel_filter_.IsLaunchTraced());
+  }
+
+  // in command list timing mode, kernels appended to a regular command list are counted and
+  // the list is timed as a whole. returns true if the launch is traced and needs timestamps of its own
+  bool IsKernelLaunchTimed(ze_command_list_handle_t command_list, ze_kernel_handle_t kernel, bool traced) {
+    if (!command_list_timing_.IsEnabled() || !traced) {
+      return traced;
+    }
+
+    uint64_t kernel_id;
+    bool found = false;
+
+    kernel_command_properties_mutex_.lock_shared();
+    auto kit = active_kernel_properties_->find(kernel);
+    if (kit != active_kernel_properties_->end()) {
+      kernel_id = kit->second.id_;
+      found = true;
+    }
+    kernel_command_properties_mutex_.unlock_shared();
+
+    if (!found) {
+      return true;
+    }
+
+    bool timed = true;
+
+    command_lists_mutex_.lock();
+    auto it = command_lists_.find(command_list);
+    if ((it != command_lists_.end()) && !it->second->immediate_) {
+      ZeCommandList *cl = it->second;
+      timed = command_list_timing_.OnKernelAppended(command_list, cl->list_timing_, cl->device_global_timestamps_,
+          cl->next_free_device_global_timestamps_slot_, max_num_commands_in_command_list_ * 2, kernel_id, traced);
+    }
+    command_lists_mutex_.unlock();
+
+    return timed;
+  }
+
+  // command list timed as a whole is recorded as one command named after the kernels in it,
+  // e.g. "CommandList[3000 kernels: gemm x1000; relu x2000]"
+  // locks kernel_command_properties_mutex_ exclusively, so caller must not hold command_lists_mutex_
+  uint64_t GetCommandListCommandId(const ZeCommandListTimingState& list_timing, ze_device_handle_t device) {
+    uint64_t command_id;
+
+    kernel_command_properties_mutex_.lock();
+    std::string name = ZeCommandListTiming::GetListName(list_timing, [this](uint64_t kernel_id) {
+      auto kit = kernel_command_properties_->find(kernel_id);
+      return ((kit == kernel_command_properties_->end()) ? std::string() : utils::Demangle(kit->second.name_.c_str()));
+    });
+
+    auto iit = command_list_ids_.find(name);
+    if (iit != command_list_ids_.end()) {
+      command_id = iit->second;
+    }
+    else {
+      ZeKernelCommandProperties desc;
+
+      desc.name_ = name;
+      desc.id_ = UniKernelId::GetKernelId();
+      desc.type_ = KERNEL_COMMAND_TYPE_COMMAND;
+      desc.device_ = device;
+      command_id = desc.id_;
+      command_list_ids_.insert({name, command_id});
+      kernel_command_properties_->insert({command_id, std::move(desc)});
+    }
+    kernel_command_properties_mutex_.unlock();
+
+    return command_id;
+  }
+
+  // caller must hold command_lists_mutex_
+  void AppendCommandListCommand(ZeCommandList *cl, uint64_t command_id) {
+    if (local_device_submissions_.IsFinalized()) {
+      return;
+    }
+
+    ZeCommand *desc = local_device_submissions_.GetKernelCommand();
+
+    desc->type_ = KERNEL_COMMAND_TYPE_COMMAND;
+    desc->kernel_command_id_ = command_id;
+    desc->engine_ordinal_ = cl->engine_ordinal_;
+    desc->engine_index_ = cl->engine_index_;
+    desc->host_time_origin_ = cl->host_time_origin_;	// in ns
+    desc->device_timer_frequency_ = cl->device_timer_frequency_;
+    desc->device_timer_mask_ = cl->device_timer_mask_;
+    desc->metric_timer_frequency_ = cl->metric_timer_frequency_;
+    desc->metric_timer_mask_ = cl->metric_timer_mask_;
+    desc->device_ = cl->device_;
+
+    desc->group_count_ = {0, 0, 0};
+    desc->mem_size_ = 0;
+    desc->event_ = nullptr;
+    desc->dependencies_ = ZeCommandDependencies();
+    desc->command_list_ = cl->cmdlist_;
+    desc->queue_ = nullptr;
+    desc->tid_ = utils::GetTid();
+    desc->kernel_timestamp_ = nullptr;
+    desc->redirected_kernel_timestamp_ = nullptr;
+    desc->kernel_timestamp_slot_ = -1;
+    desc->redirected_kernel_timestamp_slot_ = nullptr;
+    desc->device_global_timestamps_ = &(cl->device_global_timestamps_[cl->list_timing_.list_timestamps_slot_]);
+    desc->timestamp_event_ = cl->timestamp_event_to_signal_;
+    desc->append_time_ = ze_instance_data.timestamp_host;
+    desc->immediate_ = false;
+    desc->command_metric_query_ = nullptr;
+    cl->commands_.push_back(desc);
+  }
+
   void AppendLaunchKernel(
     ZeCollector *collector, 
     ze_kernel_handle_t kernel,
     const ze_group_count_t *group_count,
     ze_event_handle_t& event_to_signal,
-    zet_metric_query_handle_t& query,
+    ZeMetricQuery *&query,
     ze_command_list_handle_t command_list,
     std::vector<uint64_t> *kids) {
 
@@ -2949,6 +3552,7 @@ class ZeCollector {
 
       desc->mem_size_ = 0;
       desc->event_ = event_to_signal;
+      SetCommandDependencies(desc);
       desc->command_list_ = command_list;
       desc->queue_ = nullptr;
       desc->tid_ = utils::GetTid();
@@ -2958,7 +3562,7 @@ class ZeCollector {
         desc_query = local_device_submissions_.GetCommandMetricQuery();
 
         ze_event_handle_t metric_query_event = collector->event_cache_.GetEvent(context);
-        ze_result_t status = zetCommandListAppendMetricQueryEnd(command_list, query, metric_query_event, 0, nullptr);
+        ze_result_t status = zetCommandListAppendMetricQueryEnd(command_list, query->query_, metric_query_event, 0, nullptr);
         PTI_ASSERT(status == ZE_RESULT_SUCCESS);
         desc_query->metric_query_event_ = metric_query_event;
         desc_query->metric_query_ = query;
@@ -3028,7 +3632,7 @@ class ZeCollector {
     const void* src,
     const void* dst,
     ze_event_handle_t& event_to_signal,
-    zet_metric_query_handle_t& query,
+    ZeMetricQuery *&query,
     ze_command_list_handle_t command_list,
     std::vector<uint64_t> *kids) {
 
@@ -3075,6 +3679,7 @@ class ZeCollector {
       desc->metric_timer_frequency_ = it->second->metric_timer_frequency_;
       desc->metric_timer_mask_ = it->second->metric_timer_mask_;
       desc->event_ = event_to_signal;
+      SetCommandDependencies(desc);
       desc->device_ = it->second->device_;
       ze_context_handle_t context = it->second->context_;
       command_lists_mutex_.unlock_shared();
@@ -3096,7 +3701,7 @@ class ZeCollector {
         desc_query = local_device_submissions_.GetCommandMetricQuery();
 
         ze_event_handle_t metric_query_event = collector->event_cache_.GetEvent(context);
-        ze_result_t status = zetCommandListAppendMetricQueryEnd(command_list, query, metric_query_event, 0, nullptr);
+        ze_result_t status = zetCommandListAppendMetricQueryEnd(command_list, query->query_, metric_query_event, 0, nullptr);
         PTI_ASSERT(status == ZE_RESULT_SUCCESS);
         desc_query->metric_query_event_ = metric_query_event;
         desc_query->metric_query_ = query;
@@ -3152,7 +3757,7 @@ class ZeCollector {
       ze_context_handle_t dst_context,
       const void* dst,
       ze_event_handle_t& event_to_signal,
-      zet_metric_query_handle_t& query,
+      ZeMetricQuery *&query,
       ze_command_list_handle_t command_list,
       std::vector<uint64_t> *kids) {
 
@@ -3195,6 +3800,7 @@ class ZeCollector {
       desc->metric_timer_frequency_ = it->second->metric_timer_frequency_;
       desc->metric_timer_mask_ = it->second->metric_timer_mask_;
       desc->event_ = event_to_signal;
+      SetCommandDependencies(desc);
       desc->device_ = it->second->device_;
       ze_context_handle_t context = it->second->context_;
       command_lists_mutex_.unlock_shared();
@@ -3215,7 +3821,7 @@ class ZeCollector {
         desc_query = local_device_submissions_.GetCommandMetricQuery();
 
         ze_event_handle_t metric_query_event = collector->event_cache_.GetEvent(context);
-        ze_result_t status = zetCommandListAppendMetricQueryEnd(command_list, query, metric_query_event, 0, nullptr);
+        ze_result_t status = zetCommandListAppendMetricQueryEnd(command_list, query->query_, metric_query_event, 0, nullptr);
         PTI_ASSERT(status == ZE_RESULT_SUCCESS);
         desc_query->metric_query_ = query;
         desc_query->metric_query_event_ = metric_query_event;
@@ -3267,7 +3873,7 @@ class ZeCollector {
     const void* src,
     const void* dst,
     ze_event_handle_t& event_to_signal,
-    zet_metric_query_handle_t& query,
+    ZeMetricQuery *&query,
     ze_command_list_handle_t command_list,
     std::vector<uint64_t> *kids) {
 
@@ -3321,6 +3927,7 @@ class ZeCollector {
 
       desc->group_count_ = {0, 0, 0};
       desc->event_ = event_to_signal;
+      SetCommandDependencies(desc);
       desc->command_list_ = command_list;
       desc->mem_size_ = size;
       desc->queue_ = nullptr;
@@ -3336,7 +3943,7 @@ class ZeCollector {
         desc_query = local_device_submissions_.GetCommandMetricQuery();
 
         ze_event_handle_t metric_query_event = collector->event_cache_.GetEvent(context);
-        ze_result_t status = zetCommandListAppendMetricQueryEnd(command_list, query, metric_query_event, 0, nullptr);
+        ze_result_t status = zetCommandListAppendMetricQueryEnd(command_list, query->query_, metric_query_event, 0, nullptr);
         PTI_ASSERT(status == ZE_RESULT_SUCCESS);
         desc_query->metric_query_ = query;
         desc_query->metric_query_event_ = metric_query_event;
@@ -3385,7 +3992,7 @@ class ZeCollector {
       ZeCollector *collector, 
       ZeDeviceCommandHandle handle,
       ze_event_handle_t& event_to_signal,
-      zet_metric_query_handle_t& query,
+      ZeMetricQuery *&query,
       ze_command_list_handle_t command_list,
       std::vector<uint64_t> *kids) {
 
@@ -3429,6 +4036,7 @@ class ZeCollector {
       desc->group_count_ = {0, 0, 0};
       desc->mem_size_ = 0;
       desc->event_ = event_to_signal;
+      SetCommandDependencies(desc);
       desc->command_list_ = command_list;
       desc->queue_ = nullptr;
       desc->tid_ = utils::GetTid();
@@ -3440,7 +4048,7 @@ class ZeCollector {
 
         ze_event_handle_t metric_query_event = collector->event_cache_.GetEvent(context);
         desc_query->metric_query_ = query;
-        ze_result_t status = zetCommandListAppendMetricQueryEnd(command_list, query, metric_query_event, 0, nullptr);
+        ze_result_t status = zetCommandListAppendMetricQueryEnd(command_list, query->query_, metric_query_event, 0, nullptr);
         PTI_ASSERT(status == ZE_RESULT_SUCCESS);
       }
 
@@ -3537,6 +4145,7 @@ class ZeCollector {
       desc->group_count_ = {0, 0, 0};
       desc->mem_size_ = 0;
       desc->event_ = nullptr;
+      desc->dependencies_ = ZeCommandDependencies();
       desc->command_list_ = cl->cmdlist_;
       desc->queue_ = nullptr;
       desc->tid_ = utils::GetTid();
@@ -3579,9 +4188,15 @@ class ZeCollector {
   static void OnEnterCommandListAppendLaunchKernel(
       ze_command_list_append_launch_kernel_params_t* params,
       void* global_data, void** instance_data) {
-    if (UniController::IsCollectionEnabled()) {
-      ZeCollector* collector = reinterpret_cast<ZeCollector*>(global_data);
-      zet_metric_query_handle_t query = PrepareToAppendKernelCommand(collector, *(params->phSignalEvent), *(params->phCommandList), true);
+    ZeCollector* collector = reinterpret_cast<ZeCollector*>(global_data);
+    bool collecting = UniController::IsCollectionEnabled();
+    // launches are numbered for --kernel-launch-range only while collection is enabled,
+    // and only launches of the kernels selected are counted in the command list
+    ze_instance_data.kernel_skipped = collecting && !collector->IsKernelLaunchTimed(*(params->phCommandList), *(params->phKernel),
+        collector->IsKernelLaunchTraced(*(params->phKernel)));
+    if (!ze_instance_data.kernel_skipped && collecting) {
+      ZeMetricQuery *query = PrepareToAppendKernelCommand(collector, *(params->phSignalEvent), *(params->phCommandList), true);
+      collector->StageDependencies(*(params->pnumWaitEvents), *(params->pphWaitEvents));
       *instance_data = reinterpret_cast<void*>(query);
     }
     else {
@@ -3593,8 +4208,13 @@ class ZeCollector {
     ze_command_list_append_launch_kernel_params_t* params,
     ze_result_t result, void* global_data, void** instance_data, std::vector<uint64_t> *kids) {
 
-    zet_metric_query_handle_t query = reinterpret_cast<zet_metric_query_handle_t>(*instance_data);
     ZeCollector* collector = reinterpret_cast<ZeCollector*>(global_data);
+    if (ze_instance_data.kernel_skipped) {
+      collector->ClearStagedDependencies();
+      return;
+    }
+
+    ZeMetricQuery *query = reinterpret_cast<ZeMetricQuery *>(*instance_data);
     if ((result == ZE_RESULT_SUCCESS) && (UniController::IsCollectionEnabled())) {
       collector->AppendLaunchKernel(
         collector,
@@ -3606,17 +4226,24 @@ class ZeCollector {
         kids);
     }
     else {
-      collector->query_pools_.PutQuery(query);
+      local_device_submissions_.metric_query_cache_.PutQuery(query);
       collector->event_cache_.ReleaseEvent(*(params->phSignalEvent));
     }
+    collector->ClearStagedDependencies();
   }
 
   static void OnEnterCommandListAppendLaunchCooperativeKernel(
       ze_command_list_append_launch_cooperative_kernel_params_t* params,
       void* global_data, void** instance_data) {
-    if (UniController::IsCollectionEnabled()) {
-      ZeCollector* collector = reinterpret_cast<ZeCollector*>(global_data);
-      zet_metric_query_handle_t query = PrepareToAppendKernelCommand(collector, *(params->phSignalEvent), *(params->phCommandList), true);
+    ZeCollector* collector = reinterpret_cast<ZeCollector*>(global_data);
+    bool collecting = UniController::IsCollectionEnabled();
+    // launches are numbered for --kernel-launch-range only while collection is enabled,
+    // and only launches of the kernels selected are counted in the command list
+    ze_instance_data.kernel_skipped = collecting && !collector->IsKernelLaunchTimed(*(params->phCommandList), *(params->phKernel),
+        collector->IsKernelLaunchTraced(*(params->phKernel)));
+    if (!ze_instance_data.kernel_skipped && collecting) {
+      ZeMetricQuery *query = PrepareToAppendKernelCommand(collector, *(params->phSignalEvent), *(params->phCommandList), true);
+      collector->StageDependencies(*(params->pnumWaitEvents), *(params->pphWaitEvents));
       *instance_data = reinterpret_cast<void*>(query);
     }
     else {
@@ -3627,8 +4254,13 @@ class ZeCollector {
   static void OnExitCommandListAppendLaunchCooperativeKernel(
       ze_command_list_append_launch_cooperative_kernel_params_t* params,
       ze_result_t result, void* global_data, void** instance_data, std::vector<uint64_t> *kids) {
-    zet_metric_query_handle_t query = reinterpret_cast<zet_metric_query_handle_t>(*instance_data);
     ZeCollector* collector = reinterpret_cast<ZeCollector*>(global_data);
+    if (ze_instance_data.kernel_skipped) {
+      collector->ClearStagedDependencies();
+      return;
+    }
+
+    ZeMetricQuery *query = reinterpret_cast<ZeMetricQuery *>(*instance_data);
     if ((result == ZE_RESULT_SUCCESS) && (UniController::IsCollectionEnabled())) {
         collector->AppendLaunchKernel(
           collector,
@@ -3640,17 +4272,24 @@ class ZeCollector {
           kids);
     }
     else {
-      collector->query_pools_.PutQuery(query);
+      local_device_submissions_.metric_query_cache_.PutQuery(query);
       collector->event_cache_.ReleaseEvent(*(params->phSignalEvent));
     }
+    collector->ClearStagedDependencies();
   }
 
   static void OnEnterCommandListAppendLaunchKernelIndirect(
       ze_command_list_append_launch_kernel_indirect_params_t* params,
       void* global_data, void** instance_data) {
-    if (UniController::IsCollectionEnabled()) {
-      ZeCollector* collector = reinterpret_cast<ZeCollector*>(global_data);
-      zet_metric_query_handle_t query = PrepareToAppendKernelCommand(collector, *(params->phSignalEvent), *(params->phCommandList), true);
+    ZeCollector* collector = reinterpret_cast<ZeCollector*>(global_data);
+    bool collecting = UniController::IsCollectionEnabled();
+    // launches are numbered for --kernel-launch-range only while collection is enabled,
+    // and only launches of the kernels selected are counted in the command list
+    ze_instance_data.kernel_skipped = collecting && !collector->IsKernelLaunchTimed(*(params->phCommandList), *(params->phKernel),
+        collector->IsKernelLaunchTraced(*(params->phKernel)));
+    if (!ze_instance_data.kernel_skipped && collecting) {
+      ZeMetricQuery *query = PrepareToAppendKernelCommand(collector, *(params->phSignalEvent), *(params->phCommandList), true);
+      collector->StageDependencies(*(params->pnumWaitEvents), *(params->pphWaitEvents));
       *instance_data = reinterpret_cast<void*>(query);
     }
     else {
@@ -3661,8 +4300,13 @@ class ZeCollector {
   static void OnExitCommandListAppendLaunchKernelIndirect(
       ze_command_list_append_launch_kernel_indirect_params_t* params,
       ze_result_t result, void* global_data, void** instance_data, std::vector<uint64_t> *kids) {
-    zet_metric_query_handle_t query = reinterpret_cast<zet_metric_query_handle_t>(*instance_data);
     ZeCollector* collector = reinterpret_cast<ZeCollector*>(global_data);
+    if (ze_instance_data.kernel_skipped) {
+      collector->ClearStagedDependencies();
+      return;
+    }
+
+    ZeMetricQuery *query = reinterpret_cast<ZeMetricQuery *>(*instance_data);
     if ((result == ZE_RESULT_SUCCESS) && (UniController::IsCollectionEnabled())) {
         collector->AppendLaunchKernel(
           collector,
@@ -3674,9 +4318,10 @@ class ZeCollector {
           kids);
     }
     else {
-      collector->query_pools_.PutQuery(query);
+      local_device_submissions_.metric_query_cache_.PutQuery(query);
       collector->event_cache_.ReleaseEvent(*(params->phSignalEvent));
     }
+    collector->ClearStagedDependencies();
   }
 
   int GetMemoryTransferType(ze_context_handle_t src_context, const void *src) {
@@ -3772,7 +4417,8 @@ class ZeCollector {
       void* global_data, void** instance_data) {
     if (UniController::IsCollectionEnabled()) {
       ZeCollector* collector = reinterpret_cast<ZeCollector*>(global_data);
-      zet_metric_query_handle_t query = PrepareToAppendKernelCommand(collector, *(params->phSignalEvent), *(params->phCommandList), false);
+      ZeMetricQuery *query = PrepareToAppendKernelCommand(collector, *(params->phSignalEvent), *(params->phCommandList), false);
+      collector->StageDependencies(*(params->pnumWaitEvents), *(params->pphWaitEvents));
       *instance_data = reinterpret_cast<void*>(query);
     }
     else {
@@ -3783,7 +4429,7 @@ class ZeCollector {
   static void OnExitCommandListAppendMemoryCopy(
       ze_command_list_append_memory_copy_params_t* params,
       ze_result_t result, void* global_data, void** instance_data, std::vector<uint64_t> *kids) {
-    zet_metric_query_handle_t query = reinterpret_cast<zet_metric_query_handle_t>(*instance_data);
+    ZeMetricQuery *query = reinterpret_cast<ZeMetricQuery *>(*instance_data);
     ZeCollector* collector = reinterpret_cast<ZeCollector*>(global_data);
     if ((result == ZE_RESULT_SUCCESS) && (UniController::IsCollectionEnabled())) {
       collector->AppendMemoryCommand(collector, MemoryCopy, *(params->psize),
@@ -3791,9 +4437,10 @@ class ZeCollector {
           *(params->phCommandList), kids);
     }
     else {
-      collector->query_pools_.PutQuery(query);
+      local_device_submissions_.metric_query_cache_.PutQuery(query);
       collector->event_cache_.ReleaseEvent(*(params->phSignalEvent));
     }
+    collector->ClearStagedDependencies();
   }
 
   static void OnEnterCommandListAppendMemoryFill(
@@ -3801,7 +4448,8 @@ class ZeCollector {
       void* global_data, void** instance_data) {
     if (UniController::IsCollectionEnabled()) {
       ZeCollector* collector = reinterpret_cast<ZeCollector*>(global_data);
-      zet_metric_query_handle_t query = PrepareToAppendKernelCommand(collector, *(params->phSignalEvent), *(params->phCommandList), false);
+      ZeMetricQuery *query = PrepareToAppendKernelCommand(collector, *(params->phSignalEvent), *(params->phCommandList), false);
+      collector->StageDependencies(*(params->pnumWaitEvents), *(params->pphWaitEvents));
       *instance_data = reinterpret_cast<void*>(query);
     }
     else {
@@ -3812,7 +4460,7 @@ class ZeCollector {
   static void OnExitCommandListAppendMemoryFill(
       ze_command_list_append_memory_fill_params_t* params,
       ze_result_t result, void* global_data, void** instance_data, std::vector<uint64_t> *kids) {
-    zet_metric_query_handle_t query = reinterpret_cast<zet_metric_query_handle_t>(*instance_data);
+    ZeMetricQuery *query = reinterpret_cast<ZeMetricQuery *>(*instance_data);
     ZeCollector* collector = reinterpret_cast<ZeCollector*>(global_data);
     if ((result == ZE_RESULT_SUCCESS) && (UniController::IsCollectionEnabled())) {
       collector->AppendMemoryCommand(collector, MemoryFill, *(params->psize),
@@ -3820,9 +4468,10 @@ class ZeCollector {
           *(params->phCommandList), kids);
     }
     else {
-      collector->query_pools_.PutQuery(query);
+      local_device_submissions_.metric_query_cache_.PutQuery(query);
       collector->event_cache_.ReleaseEvent(*(params->phSignalEvent));
     }
+    collector->ClearStagedDependencies();
   }
 
   static void OnEnterCommandListAppendBarrier(
@@ -3830,7 +4479,8 @@ class ZeCollector {
       void* global_data, void** instance_data) {
     if (UniController::IsCollectionEnabled()) {
       ZeCollector* collector = reinterpret_cast<ZeCollector*>(global_data);
-      zet_metric_query_handle_t query = PrepareToAppendKernelCommand(collector, *(params->phSignalEvent), *(params->phCommandList), false);
+      ZeMetricQuery *query = PrepareToAppendKernelCommand(collector, *(params->phSignalEvent), *(params->phCommandList), false);
+      collector->StageDependencies(*(params->pnumWaitEvents), *(params->pphWaitEvents));
       *instance_data = reinterpret_cast<void*>(query);
     }
     else {
@@ -3841,16 +4491,17 @@ class ZeCollector {
   static void OnExitCommandListAppendBarrier(
       ze_command_list_append_barrier_params_t* params,
       ze_result_t result, void* global_data, void** instance_data, std::vector<uint64_t> *kids) {
-    zet_metric_query_handle_t query = reinterpret_cast<zet_metric_query_handle_t>(*instance_data);
+    ZeMetricQuery *query = reinterpret_cast<ZeMetricQuery *>(*instance_data);
     ZeCollector* collector = reinterpret_cast<ZeCollector*>(global_data);
     if ((result == ZE_RESULT_SUCCESS) && (UniController::IsCollectionEnabled())) {
       collector->AppendCommand(collector, Barrier, *(params->phSignalEvent), query,
           *(params->phCommandList), kids);
     }
     else {
-      collector->query_pools_.PutQuery(query);
+      local_device_submissions_.metric_query_cache_.PutQuery(query);
       collector->event_cache_.ReleaseEvent(*(params->phSignalEvent));
     }
+    collector->ClearStagedDependencies();
   }
 
   static void OnEnterCommandListAppendMemoryRangesBarrier(
@@ -3858,7 +4509,8 @@ class ZeCollector {
       void* global_data, void** instance_data) {
     if (UniController::IsCollectionEnabled()) {
       ZeCollector* collector = reinterpret_cast<ZeCollector*>(global_data);
-      zet_metric_query_handle_t query = PrepareToAppendKernelCommand(collector, *(params->phSignalEvent), *(params->phCommandList), false);
+      ZeMetricQuery *query = PrepareToAppendKernelCommand(collector, *(params->phSignalEvent), *(params->phCommandList), false);
+      collector->StageDependencies(*(params->pnumWaitEvents), *(params->pphWaitEvents));
       *instance_data = reinterpret_cast<void*>(query);
     }
     else {
@@ -3869,16 +4521,17 @@ class ZeCollector {
   static void OnExitCommandListAppendMemoryRangesBarrier(
       ze_command_list_append_memory_ranges_barrier_params_t* params,
       ze_result_t result, void* global_data, void** instance_data, std::vector<uint64_t> *kids) {
-    zet_metric_query_handle_t query = reinterpret_cast<zet_metric_query_handle_t>(*instance_data);
+    ZeMetricQuery *query = reinterpret_cast<ZeMetricQuery *>(*instance_data);
     ZeCollector* collector = reinterpret_cast<ZeCollector*>(global_data);
     if ((result == ZE_RESULT_SUCCESS) && (UniController::IsCollectionEnabled())) {
       collector->AppendCommand(collector, MemoryRangesBarrier, *(params->phSignalEvent), query,
           *(params->phCommandList), kids);
     }
     else {
-      collector->query_pools_.PutQuery(query);
+      local_device_submissions_.metric_query_cache_.PutQuery(query);
       collector->event_cache_.ReleaseEvent(*(params->phSignalEvent));
     }
+    collector->ClearStagedDependencies();
   }
 
   static void OnEnterCommandListAppendMemoryCopyRegion(
@@ -3886,7 +4539,8 @@ class ZeCollector {
       void* global_data, void** instance_data) {
     if (UniController::IsCollectionEnabled()) {
       ZeCollector* collector = reinterpret_cast<ZeCollector*>(global_data);
-      zet_metric_query_handle_t query = PrepareToAppendKernelCommand(collector, *(params->phSignalEvent), *(params->phCommandList), false);
+      ZeMetricQuery *query = PrepareToAppendKernelCommand(collector, *(params->phSignalEvent), *(params->phCommandList), false);
+      collector->StageDependencies(*(params->pnumWaitEvents), *(params->pphWaitEvents));
       *instance_data = reinterpret_cast<void*>(query);
     }
     else {
@@ -3897,7 +4551,7 @@ class ZeCollector {
   static void OnExitCommandListAppendMemoryCopyRegion(
       ze_command_list_append_memory_copy_region_params_t* params,
       ze_result_t result, void* global_data, void** instance_data, std::vector<uint64_t> *kids) {
-    zet_metric_query_handle_t query = reinterpret_cast<zet_metric_query_handle_t>(*instance_data);
+    ZeMetricQuery *query = reinterpret_cast<ZeMetricQuery *>(*instance_data);
     ZeCollector* collector = reinterpret_cast<ZeCollector*>(global_data);
     if ((result == ZE_RESULT_SUCCESS) && (UniController::IsCollectionEnabled())) {
       size_t bytes_transferred = 0;
@@ -3915,9 +4569,10 @@ class ZeCollector {
          *(params->phCommandList), kids);
     }
     else {
-      collector->query_pools_.PutQuery(query);
+      local_device_submissions_.metric_query_cache_.PutQuery(query);
       collector->event_cache_.ReleaseEvent(*(params->phSignalEvent));
     }
+    collector->ClearStagedDependencies();
   }
 
   static void OnEnterCommandListAppendMemoryCopyFromContext(
@@ -3925,7 +4580,8 @@ class ZeCollector {
       void* global_data, void** instance_data) {
     if (UniController::IsCollectionEnabled()) {
       ZeCollector* collector = reinterpret_cast<ZeCollector*>(global_data);
-      zet_metric_query_handle_t query = PrepareToAppendKernelCommand(collector, *(params->phSignalEvent), *(params->phCommandList), false);
+      ZeMetricQuery *query = PrepareToAppendKernelCommand(collector, *(params->phSignalEvent), *(params->phCommandList), false);
+      collector->StageDependencies(*(params->pnumWaitEvents), *(params->pphWaitEvents));
       *instance_data = reinterpret_cast<void*>(query);
     }
     else {
@@ -3936,7 +4592,7 @@ class ZeCollector {
   static void OnExitCommandListAppendMemoryCopyFromContext(
       ze_command_list_append_memory_copy_from_context_params_t* params,
       ze_result_t result, void* global_data, void** instance_data, std::vector<uint64_t> *kids) {
-    zet_metric_query_handle_t query = reinterpret_cast<zet_metric_query_handle_t>(*instance_data);
+    ZeMetricQuery *query = reinterpret_cast<ZeMetricQuery *>(*instance_data);
     ZeCollector* collector = reinterpret_cast<ZeCollector*>(global_data);
     if ((result == ZE_RESULT_SUCCESS) && (UniController::IsCollectionEnabled())) {
       ze_context_handle_t src_context = *(params->phContextSrc);
@@ -3946,9 +4602,10 @@ class ZeCollector {
         *(params->phCommandList), kids);
     }
     else {
-      collector->query_pools_.PutQuery(query);
+      local_device_submissions_.metric_query_cache_.PutQuery(query);
       collector->event_cache_.ReleaseEvent(*(params->phSignalEvent));
     }
+    collector->ClearStagedDependencies();
   }
 
   static void OnEnterCommandListAppendImageCopy(
@@ -3956,7 +4613,8 @@ class ZeCollector {
       void* global_data, void** instance_data) {
     if (UniController::IsCollectionEnabled()) {
       ZeCollector* collector = reinterpret_cast<ZeCollector*>(global_data);
-      zet_metric_query_handle_t query = PrepareToAppendKernelCommand(collector, *(params->phSignalEvent), *(params->phCommandList), false);
+      ZeMetricQuery *query = PrepareToAppendKernelCommand(collector, *(params->phSignalEvent), *(params->phCommandList), false);
+      collector->StageDependencies(*(params->pnumWaitEvents), *(params->pphWaitEvents));
       *instance_data = reinterpret_cast<void*>(query);
     }
     else {
@@ -3967,7 +4625,7 @@ class ZeCollector {
   static void OnExitCommandListAppendImageCopy(
       ze_command_list_append_image_copy_params_t* params,
       ze_result_t result, void* global_data, void** instance_data, std::vector<uint64_t> *kids) {
-    zet_metric_query_handle_t query = reinterpret_cast<zet_metric_query_handle_t>(*instance_data);
+    ZeMetricQuery *query = reinterpret_cast<ZeMetricQuery *>(*instance_data);
     ZeCollector* collector = reinterpret_cast<ZeCollector*>(global_data);
     if ((result == ZE_RESULT_SUCCESS) && (UniController::IsCollectionEnabled())) {
       collector->AppendImageMemoryCopyCommand(collector, ImageCopy, *(params->phSrcImage),
@@ -3975,9 +4633,10 @@ class ZeCollector {
         *(params->phCommandList), kids);
     }
     else {
-      collector->query_pools_.PutQuery(query);
+      local_device_submissions_.metric_query_cache_.PutQuery(query);
       collector->event_cache_.ReleaseEvent(*(params->phSignalEvent));
     }
+    collector->ClearStagedDependencies();
   }
 
   static void OnEnterCommandListAppendImageCopyRegion(
@@ -3985,7 +4644,8 @@ class ZeCollector {
       void* global_data, void** instance_data) {
     if (UniController::IsCollectionEnabled()) {
       ZeCollector* collector = reinterpret_cast<ZeCollector*>(global_data);
-      zet_metric_query_handle_t query = PrepareToAppendKernelCommand(collector, *(params->phSignalEvent), *(params->phCommandList), false);
+      ZeMetricQuery *query = PrepareToAppendKernelCommand(collector, *(params->phSignalEvent), *(params->phCommandList), false);
+      collector->StageDependencies(*(params->pnumWaitEvents), *(params->pphWaitEvents));
       *instance_data = reinterpret_cast<void*>(query);
     }
     else {
@@ -3996,7 +4656,7 @@ class ZeCollector {
   static void OnExitCommandListAppendImageCopyRegion(
       ze_command_list_append_image_copy_region_params_t* params,
       ze_result_t result, void* global_data, void** instance_data, std::vector<uint64_t> *kids) {
-    zet_metric_query_handle_t query = reinterpret_cast<zet_metric_query_handle_t>(*instance_data);
+    ZeMetricQuery *query = reinterpret_cast<ZeMetricQuery *>(*instance_data);
     ZeCollector* collector = reinterpret_cast<ZeCollector*>(global_data);
     if ((result == ZE_RESULT_SUCCESS) && (UniController::IsCollectionEnabled())) {
       collector->AppendImageMemoryCopyCommand(collector, ImageCopyRegion, *(params->phSrcImage),
@@ -4004,9 +4664,10 @@ class ZeCollector {
         *(params->phCommandList), kids);
     }
     else {
-      collector->query_pools_.PutQuery(query);
+      local_device_submissions_.metric_query_cache_.PutQuery(query);
       collector->event_cache_.ReleaseEvent(*(params->phSignalEvent));
     }
+    collector->ClearStagedDependencies();
   }
 
   static void OnEnterCommandListAppendImageCopyToMemory(
@@ -4014,7 +4675,8 @@ class ZeCollector {
       void* global_data, void** instance_data) {
     if (UniController::IsCollectionEnabled()) {
       ZeCollector* collector = reinterpret_cast<ZeCollector*>(global_data);
-      zet_metric_query_handle_t query = PrepareToAppendKernelCommand(collector, *(params->phSignalEvent), *(params->phCommandList), false);
+      ZeMetricQuery *query = PrepareToAppendKernelCommand(collector, *(params->phSignalEvent), *(params->phCommandList), false);
+      collector->StageDependencies(*(params->pnumWaitEvents), *(params->pphWaitEvents));
       *instance_data = reinterpret_cast<void*>(query);
     }
     else {
@@ -4025,7 +4687,7 @@ class ZeCollector {
   static void OnExitCommandListAppendImageCopyToMemory(
       ze_command_list_append_image_copy_to_memory_params_t* params,
       ze_result_t result, void* global_data, void** instance_data, std::vector<uint64_t> *kids) {
-    zet_metric_query_handle_t query = reinterpret_cast<zet_metric_query_handle_t>(*instance_data);
+    ZeMetricQuery *query = reinterpret_cast<ZeMetricQuery *>(*instance_data);
     ZeCollector* collector = reinterpret_cast<ZeCollector*>(global_data);
     if ((result == ZE_RESULT_SUCCESS) && (UniController::IsCollectionEnabled())) {
       collector->AppendImageMemoryCopyCommand(collector, ImageCopyToMemory, *(params->phSrcImage),
@@ -4033,9 +4695,10 @@ class ZeCollector {
         *(params->phCommandList), kids);
     }
     else {
-      collector->query_pools_.PutQuery(query);
+      local_device_submissions_.metric_query_cache_.PutQuery(query);
       collector->event_cache_.ReleaseEvent(*(params->phSignalEvent));
     }
+    collector->ClearStagedDependencies();
   }
 
   static void OnEnterCommandListAppendImageCopyFromMemory(
@@ -4043,7 +4706,8 @@ class ZeCollector {
       void* global_data, void** instance_data) {
     if (UniController::IsCollectionEnabled()) {
       ZeCollector* collector = reinterpret_cast<ZeCollector*>(global_data);
-      zet_metric_query_handle_t query = PrepareToAppendKernelCommand(collector, *(params->phSignalEvent), *(params->phCommandList), false);
+      ZeMetricQuery *query = PrepareToAppendKernelCommand(collector, *(params->phSignalEvent), *(params->phCommandList), false);
+      collector->StageDependencies(*(params->pnumWaitEvents), *(params->pphWaitEvents));
       *instance_data = reinterpret_cast<void*>(query);
     }
     else {
@@ -4054,7 +4718,7 @@ class ZeCollector {
   static void OnExitCommandListAppendImageCopyFromMemory(
       ze_command_list_append_image_copy_from_memory_params_t* params,
       ze_result_t result, void* global_data, void** instance_data, std::vector<uint64_t> *kids) {
-    zet_metric_query_handle_t query = reinterpret_cast<zet_metric_query_handle_t>(*instance_data);
+    ZeMetricQuery *query = reinterpret_cast<ZeMetricQuery *>(*instance_data);
     ZeCollector* collector = reinterpret_cast<ZeCollector*>(global_data);
     if ((result == ZE_RESULT_SUCCESS) && (UniController::IsCollectionEnabled())) {
       size_t bytes_transferred = 0;
@@ -4072,9 +4736,10 @@ class ZeCollector {
         *(params->phCommandList), kids);
     }
     else {
-      collector->query_pools_.PutQuery(query);
+      local_device_submissions_.metric_query_cache_.PutQuery(query);
       collector->event_cache_.ReleaseEvent(*(params->phSignalEvent));
     }
+    collector->ClearStagedDependencies();
   }
 
   static void OnEnterCommandListAppendEventReset(ze_command_list_append_event_reset_params_t* params, void* global_data, void** instance_data) {
@@ -4192,9 +4857,32 @@ class ZeCollector {
   static void OnEnterCommandListClose (ze_command_list_close_params_t* params, void* global_data, void** instance_data) {
     ZeCollector* collector = reinterpret_cast<ZeCollector*>(global_data);
 
+    uint64_t list_command_id = 0;
+    if (collector->command_list_timing_.IsEnabled()) {
+      ZeCommandListTimingState list_timing;
+      ze_device_handle_t device = nullptr;
+      collector->command_lists_mutex_.lock_shared();
+      auto it = collector->command_lists_.find(*(params->phCommandList));
+      if ((it != collector->command_lists_.end()) && (it->second->list_timing_.list_timestamps_slot_ != -1)) {
+        list_timing = it->second->list_timing_;
+        device = it->second->device_;
+      }
+      collector->command_lists_mutex_.unlock_shared();
+      if (list_timing.num_kernels_ > 0) {
+        list_command_id = collector->GetCommandListCommandId(list_timing, device);
+      }
+    }
+
     collector->command_lists_mutex_.lock();
     auto it = collector->command_lists_.find(*(params->phCommandList));
     if (it != collector->command_lists_.end()) {
+      // end of the command list timed as a whole
+      if ((list_command_id != 0) &&
+          collector->command_list_timing_.OnListClosed(*(params->phCommandList), it->second->list_timing_, it->second->device_global_timestamps_)) {
+        PrepareToAppendKernelCommand(collector, it->second);
+        collector->AppendCommandListCommand(it->second, list_command_id);
+      }
+
       int num_events = it->second->event_timestamp_slots_.size();
       if (num_events) {
         ze_event_handle_t events[num_events];
@@ -4427,6 +5115,7 @@ typedef struct _zex_kernel_register_file_size_exp_t {
           desc.name_ = "UnknownKernel";
         }
       }
+      desc.traced_ = collector->kernel_filter_.IsKernelTraced(desc.name_);
 
       desc.device_id_ = did;
       desc.device_ = device;
@@ -4596,6 +5285,18 @@ typedef struct _zex_kernel_register_file_size_exp_t {
 
   std::vector<ze_context_handle_t> metric_contexts_;
 
+  // number of raw metric reports kept and reported per kernel in query mode, -1 keeps all
+  int64_t metric_query_raw_samples_ = kDefaultMetricQueryRawSamples;
+
+  ZeMemoryTracker memory_tracker_;
+  OnZeMemoryUsageCallback mcallback_ = nullptr;
+
+  ZeKernelFilter kernel_filter_;
+
+  ZeEventIds event_ids_;	// ids of events in dependency edges
+  ZeCommandListTiming command_list_timing_;	// time regular command lists as a whole instead of every kernel
+  std::map<std::string, uint64_t> command_list_ids_;	// command list composition to pseudo kernel id
+
   constexpr static size_t kCallsLength = 12;
   constexpr static size_t kTimeLength = 20;
 
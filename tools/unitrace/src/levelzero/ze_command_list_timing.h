@@ -0,0 +1,125 @@
+//==============================================================
+// Copyright (C) Intel Corporation
+//
+// SPDX-License-Identifier: MIT
+// =============================================================
+
+#ifndef PTI_TOOLS_UNITRACE_LEVEL_ZERO_COMMAND_LIST_TIMING_H_
+#define PTI_TOOLS_UNITRACE_LEVEL_ZERO_COMMAND_LIST_TIMING_H_
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <string>
+
+#include <level_zero/ze_api.h>
+
+#include "utils.h"
+
+// command list timing state of a regular command list, protected by the lock of the list
+struct ZeCommandListTimingState {
+  int list_timestamps_slot_ = -1;	// slot of list begin/end timestamps, -1 if not started
+  uint32_t num_kernels_ = 0;	// number of kernels appended
+  std::map<uint64_t, uint32_t> kernel_counts_;	// kernel id to number of launches
+
+  void Reset(void) {
+    list_timestamps_slot_ = -1;
+    num_kernels_ = 0;
+    kernel_counts_.clear();
+  }
+};
+
+// In command list timing mode, kernels appended to a regular command list are counted and the
+// list is timed as a whole with device global timestamps written before the first kernel and
+// at close. Immediate command lists have no close to end the list at, so their kernels are timed
+// one by one.
+class ZeCommandListTiming {
+ public:
+  ZeCommandListTiming() {
+    enabled_ = (utils::GetEnv("UNITRACE_CommandListTiming") == "1");
+    std::string kernel_sampling = utils::GetEnv("UNITRACE_CommandListKernelSampling");
+    if (!kernel_sampling.empty()) {
+      kernel_sampling_ = std::stoul(kernel_sampling);
+    }
+  }
+
+  ZeCommandListTiming(bool enabled, uint32_t kernel_sampling)
+    : enabled_(enabled), kernel_sampling_(kernel_sampling) {}
+
+  bool IsEnabled(void) const {
+    return enabled_;
+  }
+
+  // counts a launch appended to a regular command list, the first launch counted writes the list
+  // begin timestamp and takes two of the timestamp slots of the list, for begin and end.
+  // launches of kernels not traced are not counted. returns true if the launch is traced and
+  // needs timestamps of its own
+  bool OnKernelAppended(ze_command_list_handle_t command_list, ZeCommandListTimingState& state,
+                        volatile uint64_t *timestamps, int& next_free_slot, int num_slots,
+                        uint64_t kernel_id, bool traced) {
+    if (!traced) {
+      return false;
+    }
+    if (!enabled_) {
+      return true;
+    }
+
+    if (state.list_timestamps_slot_ == -1) {
+      if (next_free_slot + 2 > num_slots) {
+        std::cerr << "[ERROR] No more device timstamp slots for command list are available" << std::endl;
+        exit(-1);
+      }
+      auto status = zeCommandListAppendWriteGlobalTimestamp(command_list, (uint64_t *)&(timestamps[next_free_slot]), nullptr, 0, nullptr);
+      if (status != ZE_RESULT_SUCCESS) {
+        std::cerr << "[ERROR] Failed to get device global timestamps (" << status << ")" << std::endl;
+        exit(-1);
+      }
+      state.list_timestamps_slot_ = next_free_slot;
+      next_free_slot += 2;	// start timestamp and end timestamp
+    }
+    bool timed = ((kernel_sampling_ > 0) && ((state.num_kernels_ % kernel_sampling_) == 0));
+    state.num_kernels_++;
+    state.kernel_counts_[kernel_id]++;
+
+    return timed;
+  }
+
+  // writes the list end timestamp when the list is closed, returns false if the list is not timed
+  // as a whole or the timestamp cannot be written
+  bool OnListClosed(ze_command_list_handle_t command_list, const ZeCommandListTimingState& state,
+                    volatile uint64_t *timestamps) {
+    if (!enabled_ || (state.list_timestamps_slot_ == -1) || (state.num_kernels_ == 0)) {
+      return false;
+    }
+    auto status = zeCommandListAppendWriteGlobalTimestamp(command_list, (uint64_t *)&(timestamps[state.list_timestamps_slot_ + 1]), nullptr, 0, nullptr);
+    if (status != ZE_RESULT_SUCCESS) {
+      std::cerr << "[ERROR] Failed to get device global timestamps (" << status << ")" << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  // name of the command the list is recorded as, e.g. "CommandList[3000 kernels: gemm x1000; relu x2000]",
+  // get_name returns the name of a kernel id, empty if the kernel is unknown
+  template <typename F>
+  static std::string GetListName(const ZeCommandListTimingState& state, F get_name) {
+    std::string name = "CommandList[" + std::to_string(state.num_kernels_) + " kernels:";
+    bool first = true;
+    for (auto& kc : state.kernel_counts_) {
+      std::string kernel_name = get_name(kc.first);
+      if (!kernel_name.empty()) {
+        name += (first ? " " : "; ") + kernel_name + " x" + std::to_string(kc.second);
+        first = false;
+      }
+    }
+    name += "]";
+    return name;
+  }
+
+ private:
+  bool enabled_ = false;
+  uint32_t kernel_sampling_ = 0;	// time every Nth kernel of a list as well, 0 for none
+};
+
+#endif // PTI_TOOLS_UNITRACE_LEVEL_ZERO_COMMAND_LIST_TIMING_H_
@@ -0,0 +1,260 @@
+//==============================================================
+// Copyright (C) Intel Corporation
+//
+// SPDX-License-Identifier: MIT
+// =============================================================
+
+#ifndef PTI_TOOLS_UNITRACE_LEVEL_ZERO_DEPENDENCIES_H_
+#define PTI_TOOLS_UNITRACE_LEVEL_ZERO_DEPENDENCIES_H_
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <shared_mutex>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include <level_zero/ze_api.h>
+
+#include "unimemory.h"
+
+#define MAX_NUM_WAIT_EVENTS_TRACKED 8
+
+// event edges of a command, events are compact ids rather than handles
+struct ZeCommandDependencies {
+  uint32_t signal_event_id_ = 0;	// 0 if none
+  uint32_t num_wait_events_ = 0;	// all the events waited on, only the first MAX_NUM_WAIT_EVENTS_TRACKED are kept
+  uint32_t wait_event_ids_[MAX_NUM_WAIT_EVENTS_TRACKED];
+};
+
+// compact ids of event handles, ids start at 1
+class ZeEventIds {
+ public:
+  ZeEventIds() = default;
+
+  ZeEventIds(const ZeEventIds& that) = delete;
+
+  ZeEventIds& operator=(const ZeEventIds& that) = delete;
+
+  uint32_t GetId(ze_event_handle_t event) {
+    if (event == nullptr) {
+      return 0;
+    }
+
+    lock_.lock_shared();
+    auto it = ids_.find(event);
+    if (it != ids_.end()) {
+      uint32_t id = it->second;
+      lock_.unlock_shared();
+      return id;
+    }
+    lock_.unlock_shared();
+
+    lock_.lock();
+    auto ret = ids_.insert({event, static_cast<uint32_t>(ids_.size() + 1)});
+    uint32_t id = ret.first->second;
+    lock_.unlock();
+
+    return id;
+  }
+
+ private:
+  std::shared_mutex lock_;
+  std::unordered_map<ze_event_handle_t, uint32_t> ids_;
+};
+
+// completed command instance, times in ns
+struct ZeDependencyRecord {
+  uint64_t instance_id_;
+  uint64_t kernel_command_id_;
+  ze_device_handle_t device_;
+  uint32_t engine_ordinal_;
+  uint32_t engine_index_;
+  uint64_t submit_time_;
+  uint64_t start_;
+  uint64_t end_;
+  ZeCommandDependencies dependencies_;
+};
+
+struct ZeBlockingEdge {
+  uint64_t wait_time_ = 0;	// dependency wait attributed to the edge
+  uint64_t count_ = 0;
+};
+
+// pre-start gaps of the instances of a kernel or command
+struct ZeDependencyStats {
+  uint64_t count_ = 0;
+  uint64_t gap_time_ = 0;
+  uint64_t dependency_wait_time_ = 0;
+  uint64_t host_submit_delay_time_ = 0;
+  uint64_t engine_busy_time_ = 0;
+  std::map<uint64_t, ZeBlockingEdge> blocking_edges_;	// by kernel or command id of the signaling command
+};
+
+using ZeDependencyStatsMap = std::map<uint64_t, ZeDependencyStats>;
+
+// The pre-start gap of a command runs from its submission or from the end of the previous command on
+// its engine, whichever is earlier, to its start. Every instant of the gap is classified as
+//   host-submit-delay: the command is not submitted yet, or it is ready and the engine is idle (launch latency)
+//   dependency-wait: the command is submitted and an event it waits on is not signaled yet
+//   engine-busy: the command is ready and the engine still executes earlier commands
+// The dependency wait is attributed to the edge from the command that signaled last.
+inline ZeDependencyStatsMap AnalyzeDependencies(std::vector<ZeDependencyRecord>& records) {
+  ZeDependencyStatsMap stats;
+
+  auto submit_order = [](const ZeDependencyRecord *r) {
+    return std::make_tuple(r->submit_time_, r->instance_id_);
+  };
+
+  // signaling commands of every event in submission order
+  std::unordered_map<uint32_t, std::vector<const ZeDependencyRecord *>> signals;
+  for (auto& r : records) {
+    if (r.dependencies_.signal_event_id_ != 0) {
+      signals[r.dependencies_.signal_event_id_].push_back(&r);
+    }
+  }
+  for (auto& s : signals) {
+    std::sort(s.second.begin(), s.second.end(), [&submit_order](const ZeDependencyRecord *a, const ZeDependencyRecord *b) {
+      return (submit_order(a) < submit_order(b));
+    });
+  }
+
+  // commands of every engine in start order
+  std::map<std::tuple<ze_device_handle_t, uint32_t, uint32_t>, std::vector<const ZeDependencyRecord *>> engines;
+  for (auto& r : records) {
+    engines[std::make_tuple(r.device_, r.engine_ordinal_, r.engine_index_)].push_back(&r);
+  }
+
+  for (auto& engine : engines) {
+    auto& commands = engine.second;
+    std::sort(commands.begin(), commands.end(), [](const ZeDependencyRecord *a, const ZeDependencyRecord *b) {
+      return ((a->start_ < b->start_) || ((a->start_ == b->start_) && (a->instance_id_ < b->instance_id_)));
+    });
+
+    uint64_t engine_end = 0;	// end of the commands started so far on the engine
+    for (auto r : commands) {
+      uint64_t start = r->start_;
+      uint64_t submitted = r->submit_time_;
+      uint64_t busy_until = (engine_end > 0) ? engine_end : submitted;
+
+      // the dependency is satisfied when the last event waited on is signaled
+      uint64_t ready = 0;
+      const ZeDependencyRecord *blocker = nullptr;
+      uint32_t count = std::min(r->dependencies_.num_wait_events_, static_cast<uint32_t>(MAX_NUM_WAIT_EVENTS_TRACKED));
+      for (uint32_t i = 0; i < count; i++) {
+        auto sit = signals.find(r->dependencies_.wait_event_ids_[i]);
+        if (sit == signals.end()) {
+          continue;
+        }
+        // the signal submitted last before the command is the one waited on
+        auto& signalers = sit->second;
+        auto it = std::lower_bound(signalers.begin(), signalers.end(), r, [&submit_order](const ZeDependencyRecord *a, const ZeDependencyRecord *b) {
+          return (submit_order(a) < submit_order(b));
+        });
+        if (it == signalers.begin()) {
+          continue;
+        }
+        --it;
+        if ((*it)->end_ > ready) {
+          ready = (*it)->end_;
+          blocker = *it;
+        }
+      }
+
+      auto span = [start](uint64_t from, uint64_t to) -> uint64_t {
+        to = std::min(to, start);
+        return (to > from) ? (to - from) : 0;
+      };
+
+      uint64_t gap_start = std::min(submitted, busy_until);
+      uint64_t dependency_wait = span(submitted, ready);
+      uint64_t after_dependency = std::max(submitted, ready);
+      uint64_t engine_busy = span(after_dependency, busy_until);
+      uint64_t host_submit_delay = span(gap_start, submitted) + span(std::max(after_dependency, busy_until), start);
+
+      ZeDependencyStats& s = stats[r->kernel_command_id_];
+      s.count_++;
+      s.gap_time_ += span(gap_start, start);
+      s.dependency_wait_time_ += dependency_wait;
+      s.engine_busy_time_ += engine_busy;
+      s.host_submit_delay_time_ += host_submit_delay;
+      if ((blocker != nullptr) && (dependency_wait > 0)) {
+        ZeBlockingEdge& edge = s.blocking_edges_[blocker->kernel_command_id_];
+        edge.wait_time_ += dependency_wait;
+        edge.count_++;
+      }
+
+      engine_end = std::max(engine_end, r->end_);
+    }
+  }
+
+  return stats;
+}
+
+constexpr static uint64_t kMaxDependencyRecords = 1 << 20;	// about 100 MB of records
+
+// completed instances of all threads, held until the dependencies are analyzed at the end. Instances
+// beyond kMaxDependencyRecords or over the tracing memory budget are left out of the analysis
+class ZeDependencyRecordStore {
+ public:
+  explicit ZeDependencyRecordStore(uint64_t max_records = kMaxDependencyRecords) : max_records_(max_records) {}
+
+  ZeDependencyRecordStore(const ZeDependencyRecordStore& that) = delete;
+
+  ZeDependencyRecordStore& operator=(const ZeDependencyRecordStore& that) = delete;
+
+  // room for the record of an instance, taken before the record is kept by the thread
+  bool Reserve(void) {
+    uint64_t reserved = reserved_.load(std::memory_order_relaxed);
+    do {
+      if (reserved >= max_records_) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      }
+    } while (!reserved_.compare_exchange_weak(reserved, reserved + 1, std::memory_order_relaxed));
+
+    if (!UniMemory::TraceMemory::Reserve(sizeof(ZeDependencyRecord))) {
+      reserved_.fetch_sub(1, std::memory_order_relaxed);
+      UniMemory::TraceMemory::CountDropped(1);
+      return false;
+    }
+    return true;
+  }
+
+  // records kept by a thread, swept when the thread exits or its submissions are finalized
+  void Sweep(std::vector<ZeDependencyRecord>& records) {
+    const std::lock_guard<std::mutex> lock(lock_);
+    records_.insert(records_.end(), records.begin(), records.end());
+    records.clear();
+  }
+
+  // analyzes the records swept so far and releases them
+  ZeDependencyStatsMap Analyze(void) {
+    const std::lock_guard<std::mutex> lock(lock_);
+    ZeDependencyStatsMap stats = AnalyzeDependencies(records_);
+    UniMemory::TraceMemory::Release(sizeof(ZeDependencyRecord) * records_.size());
+    reserved_.fetch_sub(records_.size(), std::memory_order_relaxed);
+    std::vector<ZeDependencyRecord>().swap(records_);
+    return stats;
+  }
+
+  // instances left out as the store was full
+  uint64_t GetDroppedCount(void) const {
+    return dropped_.load(std::memory_order_relaxed);
+  }
+
+  uint64_t GetMaxRecords(void) const {
+    return max_records_;
+  }
+
+ private:
+  const uint64_t max_records_;
+  std::atomic<uint64_t> reserved_{0};
+  std::atomic<uint64_t> dropped_{0};
+  std::mutex lock_;
+  std::vector<ZeDependencyRecord> records_;
+};
+
+#endif // PTI_TOOLS_UNITRACE_LEVEL_ZERO_DEPENDENCIES_H_
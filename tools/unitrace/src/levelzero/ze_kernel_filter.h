@@ -0,0 +1,98 @@
+//==============================================================
+// Copyright (C) Intel Corporation
+//
+// SPDX-License-Identifier: MIT
+// =============================================================
+
+#ifndef PTI_TOOLS_UNITRACE_LEVEL_ZERO_KERNEL_FILTER_H_
+#define PTI_TOOLS_UNITRACE_LEVEL_ZERO_KERNEL_FILTER_H_
+
+#include <atomic>
+#include <mutex>
+#include <regex>
+#include <string>
+#include <unordered_map>
+
+#include "demangle.h"
+#include "utils.h"
+
+// Decides which kernel launches are instrumented with timestamp events
+class ZeKernelFilter {
+ public:
+  ZeKernelFilter() {
+    std::string include = utils::GetEnv("UNITRACE_IncludeKernels");
+    if (!include.empty()) {
+      include_ = std::regex(include);
+      include_set_ = true;
+    }
+    std::string exclude = utils::GetEnv("UNITRACE_ExcludeKernels");
+    if (!exclude.empty()) {
+      exclude_ = std::regex(exclude);
+      exclude_set_ = true;
+    }
+    std::string range = utils::GetEnv("UNITRACE_KernelLaunchRange");
+    if (!range.empty()) {
+      // <first>:<last>, either end can be omitted
+      size_t pos = range.find(':');
+      std::string first = range.substr(0, pos);
+      if (!first.empty()) {
+        first_launch_ = std::stoull(first);
+      }
+      if ((pos != std::string::npos) && (pos + 1 < range.size())) {
+        last_launch_ = std::stoull(range.substr(pos + 1));
+      }
+      range_set_ = true;
+    }
+  }
+
+  bool IsActive(void) const {
+    return include_set_ || exclude_set_ || range_set_;
+  }
+
+  // called once per kernel creation, the result is cached per kernel name
+  bool IsKernelTraced(const std::string& name) {
+    if (!include_set_ && !exclude_set_) {
+      return true;
+    }
+
+    const std::lock_guard<std::mutex> lock(lock_);
+    auto it = traced_kernels_.find(name);
+    if (it != traced_kernels_.end()) {
+      return it->second;
+    }
+
+    std::string demangled = utils::Demangle(name.c_str());
+    bool traced = true;
+    if (include_set_ && !std::regex_search(demangled, include_)) {
+      traced = false;
+    }
+    if (exclude_set_ && std::regex_search(demangled, exclude_)) {
+      traced = false;
+    }
+    traced_kernels_.insert({name, traced});
+    return traced;
+  }
+
+  // launches of kernels passing the name filters are numbered from 0
+  bool IsLaunchTraced(void) {
+    if (!range_set_) {
+      return true;
+    }
+    uint64_t launch = launch_count_.fetch_add(1, std::memory_order_relaxed);
+    return ((launch >= first_launch_) && (launch <= last_launch_));
+  }
+
+ private:
+  std::regex include_;
+  std::regex exclude_;
+  bool include_set_ = false;
+  bool exclude_set_ = false;
+  bool range_set_ = false;
+  uint64_t first_launch_ = 0;
+  uint64_t last_launch_ = (uint64_t)(-1);
+  std::atomic<uint64_t> launch_count_ = 0;
+  std::mutex lock_;
+  std::unordered_map<std::string, bool> traced_kernels_;
+};
+
+#endif // PTI_TOOLS_UNITRACE_LEVEL_ZERO_KERNEL_FILTER_H_
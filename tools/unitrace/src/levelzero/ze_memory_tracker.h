@@ -0,0 +1,212 @@
+//==============================================================
+// Copyright (C) Intel Corporation
+//
+// SPDX-License-Identifier: MIT
+// =============================================================
+
+#ifndef PTI_TOOLS_UNITRACE_LEVEL_ZERO_MEMORY_TRACKER_H_
+#define PTI_TOOLS_UNITRACE_LEVEL_ZERO_MEMORY_TRACKER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <new>
+#include <shared_mutex>
+#include <unordered_map>
+
+#include <level_zero/ze_api.h>
+
+#include "unimemory.h"
+
+#include "common_header.gen"
+
+// the allocating call of the application is this many frames at most above the allocation callback,
+// the generated callback, the tracing layer and the loader are in between
+constexpr static int kMemoryCallStackDepth = 8;
+
+struct ZeMemoryAllocation {
+  size_t size_;
+  uint64_t alloc_time_;	// host timestamp in ns
+  ze_device_handle_t device_;	// nullptr for host allocations
+  ze_memory_type_t type_;
+  API_TRACING_ID api_id_;	// allocating API
+  uint32_t tid_;
+  void *call_stack_[kMemoryCallStackDepth];	// innermost return addresses, resolved in the leak report only
+  int call_stack_size_;
+  uint64_t id_;	// unique, assigned by the tracker
+};
+
+struct ZeMemoryUsageKey {
+  ze_device_handle_t device_;
+  ze_memory_type_t type_;
+  bool operator<(const ZeMemoryUsageKey& other) const {
+    if (device_ != other.device_) {
+      return (device_ < other.device_);
+    }
+    return (type_ < other.type_);
+  }
+};
+
+struct ZeMemoryUsage {
+  std::atomic<uint64_t> live_{0};	// in bytes
+  std::atomic<uint64_t> peak_{0};	// in bytes
+  std::atomic<uint64_t> total_{0};	// in bytes
+  std::atomic<uint64_t> alloc_count_{0};
+  std::atomic<uint64_t> free_count_{0};
+};
+
+constexpr static uint32_t kMemoryTrackerShards = 64;	// power of 2
+
+// Live allocations are kept in an address map split into shards each with its own lock,
+// so threads allocating or freeing at the same time seldom contend
+class ZeMemoryTracker {
+ public:
+  ZeMemoryTracker() = default;
+
+  ZeMemoryTracker(const ZeMemoryTracker& that) = delete;
+
+  ZeMemoryTracker& operator=(const ZeMemoryTracker& that) = delete;
+
+  ~ZeMemoryTracker() {
+    for (auto& it : usages_) {
+      delete it.second;
+    }
+    usages_.clear();
+  }
+
+  // returns live bytes of the same memory type on the same device after the allocation
+  uint64_t Allocate(const void *ptr, ZeMemoryAllocation alloc) {
+    ZeMemoryAllocation stale;
+    bool replaced = false;
+    alloc.id_ = next_id_.fetch_add(1, std::memory_order_relaxed);
+    ZeMemoryShard& shard = GetShard(ptr);
+    shard.lock_.lock();
+    try {
+      auto ret = shard.allocations_.insert({ptr, alloc});
+      if (!ret.second) {
+        // freed behind our back, e.g. memory of a destroyed context, and reused
+        stale = ret.first->second;
+        ret.first->second = alloc;
+        replaced = true;
+      }
+    }
+    catch (const std::bad_alloc&) {
+      shard.lock_.unlock();
+      // out of memory, the allocation is not tracked
+      UniMemory::TraceMemory::CountDropped(1);
+      return GetUsage(alloc.device_, alloc.type_)->live_.load(std::memory_order_relaxed);
+    }
+    shard.lock_.unlock();
+
+    if (replaced) {
+      ZeMemoryUsage *usage = GetUsage(stale.device_, stale.type_);
+      usage->live_.fetch_sub(stale.size_, std::memory_order_relaxed);
+      usage->free_count_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    ZeMemoryUsage *usage = GetUsage(alloc.device_, alloc.type_);
+    uint64_t live = usage->live_.fetch_add(alloc.size_, std::memory_order_relaxed) + alloc.size_;
+    uint64_t peak = usage->peak_.load(std::memory_order_relaxed);
+    while ((live > peak) && !usage->peak_.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+    }
+    usage->total_.fetch_add(alloc.size_, std::memory_order_relaxed);
+    usage->alloc_count_.fetch_add(1, std::memory_order_relaxed);
+
+    return live;
+  }
+
+  // returns 0 if the memory is not tracked, e.g. allocated before tracing started
+  uint64_t GetId(const void *ptr) {
+    ZeMemoryShard& shard = GetShard(ptr);
+    const std::lock_guard<std::mutex> lock(shard.lock_);
+    auto it = shard.allocations_.find(ptr);
+    return (it == shard.allocations_.end()) ? 0 : it->second.id_;
+  }
+
+  // returns false if the memory is not tracked as allocation id, e.g. the address is already
+  // reused by another allocation, which untracked this one when it was made
+  bool Free(const void *ptr, uint64_t id, ZeMemoryAllocation& alloc, uint64_t& live) {
+    ZeMemoryShard& shard = GetShard(ptr);
+    shard.lock_.lock();
+    auto it = shard.allocations_.find(ptr);
+    if ((it == shard.allocations_.end()) || (it->second.id_ != id)) {
+      shard.lock_.unlock();
+      return false;
+    }
+    alloc = it->second;
+    shard.allocations_.erase(it);
+    shard.lock_.unlock();
+
+    ZeMemoryUsage *usage = GetUsage(alloc.device_, alloc.type_);
+    live = usage->live_.fetch_sub(alloc.size_, std::memory_order_relaxed) - alloc.size_;
+    usage->free_count_.fetch_add(1, std::memory_order_relaxed);
+
+    return true;
+  }
+
+  template <typename F>
+  void ForEachUsage(F func) {
+    std::shared_lock lock(usages_lock_);
+    for (auto& it : usages_) {
+      func(it.first, *(it.second));
+    }
+  }
+
+  template <typename F>
+  void ForEachAllocation(F func) {
+    for (auto& shard : shards_) {
+      const std::lock_guard<std::mutex> lock(shard.lock_);
+      for (auto& it : shard.allocations_) {
+        func(it.first, it.second);
+      }
+    }
+  }
+
+ private:
+  // live allocations are accounted as tracing memory
+  using ZeMemoryAllocations = std::unordered_map<const void *, ZeMemoryAllocation, std::hash<const void *>,
+      std::equal_to<const void *>, UniMemory::TraceMemoryAllocator<std::pair<const void * const, ZeMemoryAllocation>>>;
+
+  struct ZeMemoryShard {
+    std::mutex lock_;
+    ZeMemoryAllocations allocations_;
+  };
+
+  std::atomic<uint64_t> next_id_{1};
+
+  ZeMemoryShard& GetShard(const void *ptr) {
+    // allocations are at least cache line aligned, so low bits carry no entropy
+    uint64_t addr = reinterpret_cast<uint64_t>(ptr) >> 6;
+    addr ^= (addr >> 17);
+    return shards_[addr & (kMemoryTrackerShards - 1)];
+  }
+
+  ZeMemoryUsage *GetUsage(ze_device_handle_t device, ze_memory_type_t type) {
+    ZeMemoryUsageKey key{device, type};
+    {
+      std::shared_lock lock(usages_lock_);
+      auto it = usages_.find(key);
+      if (it != usages_.end()) {
+        return it->second;
+      }
+    }
+
+    std::unique_lock lock(usages_lock_);
+    auto it = usages_.find(key);
+    if (it != usages_.end()) {
+      return it->second;
+    }
+    ZeMemoryUsage *usage = new ZeMemoryUsage;
+    UniMemory::ExitIfOutOfMemory((void *)(usage));
+    usages_.insert({key, usage});
+    return usage;
+  }
+
+  ZeMemoryShard shards_[kMemoryTrackerShards];
+  std::shared_mutex usages_lock_;
+  std::map<ZeMemoryUsageKey, ZeMemoryUsage *> usages_;	// usage entries are never removed
+};
+
+#endif // PTI_TOOLS_UNITRACE_LEVEL_ZERO_MEMORY_TRACKER_H_
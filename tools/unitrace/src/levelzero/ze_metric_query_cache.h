@@ -0,0 +1,197 @@
+//==============================================================
+// Copyright (C) Intel Corporation
+//
+// SPDX-License-Identifier: MIT
+// =============================================================
+
+#ifndef PTI_TOOLS_UNITRACE_LEVEL_ZERO_METRIC_QUERY_CACHE_H_
+#define PTI_TOOLS_UNITRACE_LEVEL_ZERO_METRIC_QUERY_CACHE_H_
+
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include <level_zero/zet_api.h>
+
+#include "pti_assert.h"
+#include "unimemory.h"
+
+struct ZeMetricQueryPoolKey {
+  ze_context_handle_t context_;
+  ze_device_handle_t device_;
+  zet_metric_group_handle_t group_;
+};
+
+struct ZeMetricQueryPoolKeyCompare {
+  bool operator()(const ZeMetricQueryPoolKey& lhs, const ZeMetricQueryPoolKey& rhs) const {
+    if (lhs.context_ < rhs.context_) {
+      return true;
+    }
+    if (lhs.context_ == rhs.context_) {
+      if (lhs.device_ < rhs.device_) {
+        return true;
+      }
+      if (lhs.device_ == rhs.device_) {
+        return (lhs.group_ < rhs.group_);
+      }
+    }
+    return false;
+  }
+};
+ 
+struct ZeMetricQueryPools;
+
+struct ZeMetricQuery {
+  zet_metric_query_handle_t query_ = nullptr;
+  ZeMetricQueryPoolKey key_;	// (context, device, group) the query is created for
+  ZeMetricQueryPools *pools_ = nullptr;	// pools the query belongs to
+};
+
+struct ZeMetricQueryPools {
+  constexpr static uint32_t pool_size_ = 128;
+  std::mutex query_pool_mutex_;
+  std::map<ZeMetricQueryPoolKey, std::vector<ZeMetricQuery *>, ZeMetricQueryPoolKeyCompare> free_pool_;
+  std::vector<zet_metric_query_pool_handle_t> pools_;
+  std::vector<ZeMetricQuery *> queries_;
+
+  ZeMetricQueryPools() {}
+  
+  ZeMetricQueryPools(const struct ZeMetricQueryPools& that) = delete;
+
+  ZeMetricQueryPools& operator=(const struct ZeMetricQueryPools& that) = delete;
+
+  ~ZeMetricQueryPools() {
+    ze_result_t status;
+
+    const std::lock_guard<std::mutex> lock(query_pool_mutex_);
+    for (auto query : queries_) {
+      status = zetMetricQueryDestroy(query->query_);
+      PTI_ASSERT(status == ZE_RESULT_SUCCESS);
+      delete query;
+    }
+    queries_.clear();
+
+    for (auto it = pools_.begin(); it != pools_.end(); it++) {
+      status = zetMetricQueryPoolDestroy(*it);
+      PTI_ASSERT(status == ZE_RESULT_SUCCESS);
+    }
+    
+    pools_.clear();
+
+    free_pool_.clear();
+  }
+
+  // moves up to count free queries to the caller, creating a new pool if none is free
+  void
+  GetQueries(const ZeMetricQueryPoolKey& key, std::vector<ZeMetricQuery *>& queries, uint32_t count) {
+    const std::lock_guard<std::mutex> lock(query_pool_mutex_);
+    auto& free_queries = free_pool_[key];
+    if (free_queries.empty()) {
+      zet_metric_query_pool_desc_t desc = {ZET_STRUCTURE_TYPE_METRIC_QUERY_POOL_DESC, nullptr, ZET_METRIC_QUERY_POOL_TYPE_PERFORMANCE, pool_size_};
+      zet_metric_query_pool_handle_t pool;
+
+      ze_result_t status = zetMetricQueryPoolCreate(key.context_, key.device_, key.group_, &desc, &pool);
+      PTI_ASSERT(status == ZE_RESULT_SUCCESS);
+      pools_.push_back(pool);
+
+      for (uint32_t i = 0; i < pool_size_; i++) {
+        ZeMetricQuery *query = new ZeMetricQuery;
+        UniMemory::ExitIfOutOfMemory((void *)(query));
+        status = zetMetricQueryCreate(pool, i, &(query->query_));
+        PTI_ASSERT(status == ZE_RESULT_SUCCESS);
+        query->key_ = key;
+        query->pools_ = this;
+        queries_.push_back(query);
+        free_queries.push_back(query);
+      }
+    }
+
+    while ((count > 0) && !free_queries.empty()) {
+      queries.push_back(free_queries.back());
+      free_queries.pop_back();
+      count--;
+    }
+  }
+
+  // takes back the last count queries of the caller
+  void
+  PutQueries(const ZeMetricQueryPoolKey& key, std::vector<ZeMetricQuery *>& queries, size_t count) {
+    const std::lock_guard<std::mutex> lock(query_pool_mutex_);
+    auto& free_queries = free_pool_[key];
+    for (; (count > 0) && !queries.empty(); count--) {
+      free_queries.push_back(queries.back());
+      queries.pop_back();
+    }
+  }
+
+  static void
+  ResetQuery(ZeMetricQuery *query) {
+    if (query == nullptr) {
+      return;
+    }
+    ze_result_t status = zetMetricQueryReset(query->query_);
+    PTI_ASSERT(status == ZE_RESULT_SUCCESS);
+  }
+};
+
+// per-thread cache of free metric queries, refilled from and drained to ZeMetricQueryPools in batches
+struct ZeMetricQueryCache {
+  constexpr static uint32_t batch_size_ = 32;
+
+  struct ZeMetricQueryCacheEntry {
+    ZeMetricQueryPoolKey key_;
+    ZeMetricQueryPools *pools_;
+    std::vector<ZeMetricQuery *> free_queries_;
+  };
+
+  // a thread uses very few (context, device, group) combinations, so a linear search is the fastest
+  std::vector<ZeMetricQueryCacheEntry> entries_;
+
+  ZeMetricQueryCache() {}
+
+  ZeMetricQueryCache(const struct ZeMetricQueryCache& that) = delete;
+
+  ZeMetricQueryCache& operator=(const struct ZeMetricQueryCache& that) = delete;
+
+  inline ZeMetricQueryCacheEntry& GetEntry(ZeMetricQueryPools *pools, const ZeMetricQueryPoolKey& key) {
+    for (auto& entry : entries_) {
+      if ((entry.key_.context_ == key.context_) && (entry.key_.device_ == key.device_) && (entry.key_.group_ == key.group_) && (entry.pools_ == pools)) {
+        return entry;
+      }
+    }
+    entries_.push_back({key, pools, {}});
+    entries_.back().free_queries_.reserve(2 * batch_size_);
+    return entries_.back();
+  }
+
+  inline ZeMetricQuery *GetQuery(ZeMetricQueryPools& pools, ze_context_handle_t context, ze_device_handle_t device, zet_metric_group_handle_t group) {
+    ZeMetricQueryCacheEntry& entry = GetEntry(&pools, {context, device, group});
+    if (entry.free_queries_.empty()) {
+      pools.GetQueries(entry.key_, entry.free_queries_, batch_size_);
+    }
+    ZeMetricQuery *query = entry.free_queries_.back();
+    entry.free_queries_.pop_back();
+    return query;
+  }
+
+  inline void PutQuery(ZeMetricQuery *query) {
+    if (query == nullptr) {
+      return;
+    }
+    ZeMetricQueryCacheEntry& entry = GetEntry(query->pools_, query->key_);
+    entry.free_queries_.push_back(query);
+    if (entry.free_queries_.size() >= 2 * batch_size_) {
+      // keep one batch locally and give the rest back so other threads can use them
+      entry.pools_->PutQueries(entry.key_, entry.free_queries_, batch_size_);
+    }
+  }
+
+  inline void Flush(void) {
+    for (auto& entry : entries_) {
+      entry.pools_->PutQueries(entry.key_, entry.free_queries_, entry.free_queries_.size());
+    }
+    entries_.clear();
+  }
+};
+
+#endif // PTI_TOOLS_UNITRACE_LEVEL_ZERO_METRIC_QUERY_CACHE_H_
@@ -0,0 +1,164 @@
+//==============================================================
+// Copyright (C) Intel Corporation
+//
+// SPDX-License-Identifier: MIT
+// =============================================================
+
+#ifndef PTI_TOOLS_UNITRACE_LEVEL_ZERO_METRIC_STATS_H_
+#define PTI_TOOLS_UNITRACE_LEVEL_ZERO_METRIC_STATS_H_
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "pti_assert.h"
+
+// maximal number of kernel instances whose metric values are kept for percentiles
+constexpr static size_t kMetricReservoirSize = 256;
+
+// number of raw reports kept for each kernel unless set with --metric-query-raw-samples
+constexpr static int64_t kDefaultMetricQueryRawSamples = 1;
+
+struct ZeKernelMetricStats {
+  uint64_t call_count_ = 0;
+  uint64_t raw_samples_ = 0;	// number of raw reports kept for this kernel
+  std::vector<double> sum_;	// per metric
+  std::vector<double> min_;	// per metric
+  std::vector<double> max_;	// per metric
+  std::vector<std::vector<double>> reservoir_;	// uniformly sampled kernel instances, each row has all metrics
+};
+
+// -1 keeps raw reports of all instances, a malformed value falls back to the default
+inline int64_t ParseMetricQueryRawSamples(const std::string& str) {
+  if (str.empty()) {
+    return kDefaultMetricQueryRawSamples;
+  }
+
+  char *end = nullptr;
+  errno = 0;
+  long long value = std::strtoll(str.c_str(), &end, 10);
+  if ((errno != 0) || (end == str.c_str()) || (*end != '\0') || (value < -1)) {
+    std::cerr << "[WARNING] Invalid number of raw metric samples " << str << ", using " << kDefaultMetricQueryRawSamples << std::endl;
+    return kDefaultMetricQueryRawSamples;
+  }
+
+  return value;
+}
+
+// folds metric values of one kernel instance into the statistics
+inline void AddKernelMetricSample(ZeKernelMetricStats& stats, const std::vector<double>& values, std::minstd_rand& rng) {
+  if (stats.call_count_ == 0) {
+    stats.sum_ = values;
+    stats.min_ = values;
+    stats.max_ = values;
+  }
+  else {
+    PTI_ASSERT(stats.sum_.size() == values.size());
+    for (size_t i = 0; i < values.size(); i++) {
+      stats.sum_[i] += values[i];
+      if (values[i] < stats.min_[i]) {
+        stats.min_[i] = values[i];
+      }
+      if (values[i] > stats.max_[i]) {
+        stats.max_[i] = values[i];
+      }
+    }
+  }
+  stats.call_count_++;
+
+  // reservoir sampling keeps a uniform sample of instances for percentiles in bounded memory
+  if (stats.reservoir_.size() < kMetricReservoirSize) {
+    stats.reservoir_.push_back(values);
+  }
+  else {
+    uint64_t slot = std::uniform_int_distribution<uint64_t>(0, stats.call_count_ - 1)(rng);
+    if (slot < kMetricReservoirSize) {
+      stats.reservoir_[slot] = values;
+    }
+  }
+}
+
+// returns true if the raw report of the instance just added is to be kept, limit -1 keeps all
+inline bool TakeKernelMetricRawSample(ZeKernelMetricStats& stats, int64_t limit) {
+  if ((limit >= 0) && (stats.raw_samples_ >= static_cast<uint64_t>(limit))) {
+    return false;
+  }
+  stats.raw_samples_++;
+  return true;
+}
+
+// merges statistics of one thread into the global statistics, from is left in a moved-from state
+// returns false and leaves both unchanged if they are not of the same metrics
+inline bool MergeKernelMetricStats(ZeKernelMetricStats& to, ZeKernelMetricStats& from, std::minstd_rand& rng) {
+  if (from.call_count_ == 0) {
+    return true;
+  }
+  if (to.call_count_ == 0) {
+    to = std::move(from);
+    return true;
+  }
+  if (to.sum_.size() != from.sum_.size()) {
+    // the metric group of a device does not change during the run
+    std::cerr << "[WARNING] Metrics of " << from.call_count_ << " kernel instance(s) not merged: " << from.sum_.size()
+              << " metrics instead of " << to.sum_.size() << std::endl;
+    return false;
+  }
+
+  for (size_t i = 0; i < to.sum_.size(); i++) {
+    to.sum_[i] += from.sum_[i];
+    if (from.min_[i] < to.min_[i]) {
+      to.min_[i] = from.min_[i];
+    }
+    if (from.max_[i] > to.max_[i]) {
+      to.max_[i] = from.max_[i];
+    }
+  }
+
+  if (to.reservoir_.size() + from.reservoir_.size() <= kMetricReservoirSize) {
+    for (auto& row : from.reservoir_) {
+      to.reservoir_.push_back(std::move(row));
+    }
+  }
+  else {
+    // draw from each reservoir in proportion to the number of instances it represents
+    std::shuffle(to.reservoir_.begin(), to.reservoir_.end(), rng);
+    std::shuffle(from.reservoir_.begin(), from.reservoir_.end(), rng);
+    std::vector<std::vector<double>> merged;
+    merged.reserve(kMetricReservoirSize);
+    std::uniform_int_distribution<uint64_t> dist(0, to.call_count_ + from.call_count_ - 1);
+    size_t i = 0;
+    size_t j = 0;
+    while (merged.size() < kMetricReservoirSize) {
+      bool pick_to = (dist(rng) < to.call_count_);
+      if ((pick_to && (i < to.reservoir_.size())) || (j >= from.reservoir_.size())) {
+        merged.push_back(std::move(to.reservoir_[i++]));
+      }
+      else {
+        merged.push_back(std::move(from.reservoir_[j++]));
+      }
+    }
+    to.reservoir_ = std::move(merged);
+  }
+
+  to.call_count_ += from.call_count_;
+  to.raw_samples_ += from.raw_samples_;
+  return true;
+}
+
+// nearest-rank percentile, values are sorted in place
+inline double GetMetricPercentile(std::vector<double>& values, uint32_t percentile) {
+  PTI_ASSERT(!values.empty());
+  std::sort(values.begin(), values.end());
+  size_t rank = (percentile * values.size() + 99) / 100;
+  if (rank == 0) {
+    rank = 1;
+  }
+  return values[rank - 1];
+}
+
+#endif // PTI_TOOLS_UNITRACE_LEVEL_ZERO_METRIC_STATS_H_
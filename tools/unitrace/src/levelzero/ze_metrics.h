@@ -1064,12 +1064,24 @@ class ZeMetricProfiler {
       if (size == 0) {
         if (!desc->metric_data_.empty()) {
           desc->metric_file_stream_.write(reinterpret_cast<char*>(desc->metric_data_.data()), desc->metric_data_.size());
+          UniMemory::TraceMemory::Release(desc->metric_data_.size());
           desc->metric_data_.clear();
         }
         continue;
       }
+      if (!UniMemory::TraceMemory::Reserve(size)) {
+        // over tracing memory budget, metric data is always spilled to the data file
+        if (!desc->metric_data_.empty()) {
+          desc->metric_file_stream_.write(reinterpret_cast<char*>(desc->metric_data_.data()), desc->metric_data_.size());
+          UniMemory::TraceMemory::Release(desc->metric_data_.size());
+          desc->metric_data_.clear();
+        }
+        desc->metric_file_stream_.write(reinterpret_cast<char*>(raw_metrics), size);
+        continue;
+      }
       desc->metric_data_.insert(desc->metric_data_.end(), raw_metrics, raw_metrics + size);
     }
+    UniMemory::TraceMemory::Release(desc->metric_data_.size());
     auto size = ReadMetrics(event, streamer, raw_metrics, (MAX_METRIC_BUFFER + 512));
     desc->metric_data_.insert(desc->metric_data_.end(), raw_metrics, raw_metrics + size);
     if (!desc->metric_data_.empty()) {
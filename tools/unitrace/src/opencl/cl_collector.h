@@ -694,7 +694,12 @@ class ClCollector {
     PTI_ASSERT(tracer != nullptr);
 
     for (int id = 0; id < CL_FUNCTION_COUNT; ++id) {
-      if (options_.api_tracing || (kernel_tracing_points_enabled[id] && options_.kernel_tracing)) {
+      // extension function addresses are always traced to install the extension wrappers
+      bool api_enabled = options_.api_tracing &&
+        (UniController::IsApiEnabled(static_cast<API_TRACING_ID>(OCLStartTracingId + id)) ||
+         (id == CL_FUNCTION_clGetExtensionFunctionAddress) ||
+         (id == CL_FUNCTION_clGetExtensionFunctionAddressForPlatform));
+      if (api_enabled || (kernel_tracing_points_enabled[id] && options_.kernel_tracing)) {
         bool set = tracer->SetTracingFunction(static_cast<cl_function_id>(id));
         PTI_ASSERT(set);
       }
@@ -1820,8 +1825,9 @@ class ClCollector {
     PTI_ASSERT(callback_data != nullptr);
     PTI_ASSERT(callback_data->correlationData != nullptr);
     
+    bool api_enabled = UniController::IsApiEnabled(static_cast<API_TRACING_ID>(OCLStartTracingId + function));
     uint64_t end_time;
-    if (callback_data->site == CL_CALLBACK_SITE_EXIT) {
+    if (api_enabled && (callback_data->site == CL_CALLBACK_SITE_EXIT)) {
       // take end timestamp first to avoid tool overhead
       end_time = collector->GetTimestamp();
     }
@@ -1831,7 +1837,9 @@ class ClCollector {
     }
 
     TraceGuard guard;
-    if (callback_data->site == CL_CALLBACK_SITE_ENTER) {
+    if (!api_enabled) {
+      // excluded by --include-apis/--exclude-apis, only extension functions are still set up below
+    } else if (callback_data->site == CL_CALLBACK_SITE_ENTER) {
       PTI_ASSERT(collector->correlator_ != nullptr);
       if (!UniController::IsCollectionEnabled()) {
         //*reinterpret_cast<uint64_t*>(callback_data->correlationData) = 0;
@@ -0,0 +1,129 @@
+//==============================================================
+// Copyright (C) Intel Corporation
+//
+// SPDX-License-Identifier: MIT
+// =============================================================
+
+#ifndef PTI_TOOLS_UNITRACE_TRACE_EVENT_SLICES_H
+#define PTI_TOOLS_UNITRACE_TRACE_EVENT_SLICES_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "unimemory.h"
+
+// Buffer of trace events of one kind, made of slices of slice_capacity events.
+// The first slice is always allocated, the tracing memory budget is only enforced when the buffer
+// grows. When the budget is used up, the policy decides whether buffered events are spilled to the
+// trace, the oldest slice is recycled, or new events are dropped.
+template <typename T>
+class TraceEventSlices {
+  public:
+    TraceEventSlices(int32_t slice_capacity, UniMemory::TraceMemoryPolicy policy = UniMemory::TraceMemory::GetPolicy())
+      : slice_capacity_(slice_capacity), policy_(policy) {
+      T *slice = static_cast<T *>(UniMemory::TraceMemory::Allocate(sizeof(T) * slice_capacity_, true));
+      UniMemory::ExitIfOutOfMemory((void *)(slice));
+      slices_.push_back(slice);
+    }
+
+    ~TraceEventSlices() {
+      for (auto& slice : slices_) {
+        UniMemory::TraceMemory::Free(slice, sizeof(T) * slice_capacity_);
+      }
+    }
+
+    TraceEventSlices(const TraceEventSlices& that) = delete;
+    TraceEventSlices& operator=(const TraceEventSlices& that) = delete;
+
+    bool IsFull(void) const {
+      return (next_index_ == slice_capacity_);
+    }
+
+    bool IsFlushed(void) const {
+      return flushed_;
+    }
+
+    int32_t GetSliceCount(void) const {
+      return int32_t(slices_.size());
+    }
+
+    // next free event, valid only if the buffer is not full
+    T *GetEvent(void) {
+      return &(slices_[current_slice_][next_index_]);
+    }
+
+    // keeps the event returned by GetEvent(), false if there is no room for it
+    bool BufferEvent(void) {
+      if (IsFull()) {
+        return false;
+      }
+      next_index_++;
+      flushed_ = false;
+      return true;
+    }
+
+    // makes room for new events after the in-use slice is full
+    template <typename F>
+    void NextSlice(F flush_event) {
+      if (current_slice_ + 1 < int32_t(slices_.size())) {
+        // slices are left over from spilling
+        current_slice_++;
+        next_index_ = 0;
+        return;
+      }
+
+      T *slice = static_cast<T *>(UniMemory::TraceMemory::Allocate(sizeof(T) * slice_capacity_));
+      if (slice != nullptr) {
+        slices_.push_back(slice);
+        current_slice_++;
+        next_index_ = 0;
+        return;
+      }
+
+      switch (policy_) {
+        case UniMemory::TRACE_MEMORY_POLICY_SPILL:
+          UniMemory::TraceMemory::CountSpilled(uint64_t(current_slice_) * slice_capacity_ + next_index_);
+          Flush(flush_event);
+          break;
+        case UniMemory::TRACE_MEMORY_POLICY_DROP_OLDEST:
+          // recycle the oldest slice as the newest one
+          UniMemory::TraceMemory::CountDropped(slice_capacity_);
+          std::rotate(slices_.begin(), slices_.begin() + 1, slices_.end());
+          next_index_ = 0;
+          break;
+        default:
+          // keep what is buffered and drop new events
+          break;
+      }
+    }
+
+    // passes buffered events to flush_event() oldest first, the slices are kept for reuse
+    template <typename F>
+    void Flush(F flush_event) {
+      if (flushed_) {
+        return;
+      }
+      for (int32_t i = 0; i < current_slice_; i++) {
+        for (int32_t j = 0; j < slice_capacity_; j++) {
+          flush_event(slices_[i][j]);
+        }
+      }
+      for (int32_t j = 0; j < next_index_; j++) {
+        flush_event(slices_[current_slice_][j]);
+      }
+      current_slice_ = 0;
+      next_index_ = 0;
+      flushed_ = true;
+    }
+
+  private:
+    int32_t slice_capacity_;
+    UniMemory::TraceMemoryPolicy policy_;
+    std::vector<T *> slices_;
+    int32_t current_slice_ = 0;	// slice in use
+    int32_t next_index_ = 0;	// next free event in in-use slice
+    bool flushed_ = false;
+};
+
+#endif // PTI_TOOLS_UNITRACE_TRACE_EVENT_SLICES_H
@@ -24,6 +24,7 @@
 #include "cl_api_callbacks.h"
 #include "xpti_collector.h"
 #include "itt_collector.h"
+#include "cpu_collector.h"
 #include "chromelogger.h"
 #include "unimemory.h"
 
@@ -160,7 +161,16 @@ class UniTracer {
       }
     }
 
-    if (collector_options.kernel_tracing || collector_options.api_tracing) {
+    if (utils::GetEnv("UNITRACE_MemoryTracking") == "1") {
+      collector_options.memory_tracking = true;
+    }
+
+    if (utils::GetEnv("UNITRACE_DependencyAnalysis") == "1") {
+      collector_options.dependency_analysis = true;
+      collector_options.kernel_tracing = true;
+    }
+
+    if (collector_options.kernel_tracing || collector_options.api_tracing || collector_options.memory_tracking) {
       if (tracer->CheckOption(TRACE_OPENCL)) {
         if (cl_cpu_device != nullptr) {
           cl_cpu_collector = ClCollector::Create(
@@ -204,15 +214,26 @@ class UniTracer {
           "[WARNING] Unable to create kernel collector for L0 backend" <<
           std::endl;
       }
+      else if (collector_options.memory_tracking && (tracer->chrome_logger_ != nullptr)) {
+        ze_collector->SetMemoryCallback(ChromeLogger::ZeChromeMemoryLoggingCallback);
+      }
       tracer->ze_collector_ = ze_collector;
     }
 
+    if (utils::GetEnv("UNITRACE_CpuSampling") == "1") {
+      tracer->cpu_collector_ = CpuCollector::Create((tracer->chrome_logger_ != nullptr) ? ChromeLogger::CpuSampleLoggingCallback : nullptr);
+    }
+
     return tracer;
   }
 
   ~UniTracer() {
     total_execution_time_ = correlator_.GetTimestamp();
 
+    if (cpu_collector_ != nullptr) {
+      cpu_collector_->Stop();
+    }
+
     if (ze_collector_ != nullptr) {
       ze_collector_->DisableTracing();
       delete ze_collector_;
@@ -245,6 +266,11 @@ class UniTracer {
         options_.GetLogFileName() << std::endl;
     }
 
+    if (cpu_collector_ != nullptr) {
+      // samples are logged to the Chrome trace before it is closed
+      delete cpu_collector_;
+    }
+
     if (chrome_logger_) {
       delete chrome_logger_;
     }
@@ -587,6 +613,12 @@ class UniTracer {
           cl_gpu_collector_,
           "Device");
     }
+    if (cpu_collector_ != nullptr) {
+      correlator_.Log(cpu_collector_->Report());
+    }
+    if (UniMemory::TraceMemory::IsDegraded()) {
+      correlator_.Log(UniMemory::TraceMemory::GetSummary());
+    }
     correlator_.Log("\n");
   }
 
@@ -601,6 +633,8 @@ class UniTracer {
   ClCollector* cl_cpu_collector_ = nullptr;
   ClCollector* cl_gpu_collector_ = nullptr;
 
+  CpuCollector* cpu_collector_ = nullptr;
+
   std::string chrome_trace_file_name_;
   ChromeLogger* chrome_logger_ = nullptr;
 };
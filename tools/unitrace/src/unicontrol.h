@@ -9,7 +9,13 @@
 #define PTI_TOOLS_UNITRACE_UNICONTROL_H
 
 #include "utils.h"
+#include <bitset>
+#include <fnmatch.h>
 #include <iostream>
+#include <sstream>
+#include <string>
+
+#include "common_header.gen"
 
 extern char **environ;
 
@@ -52,9 +58,53 @@ class UniController{
       itt_paused_ = false;
       utils::SetEnv("PTI_ENABLE_COLLECTION", "1");
     }
+    static bool IsApiEnabled(API_TRACING_ID id) {
+      return api_enabled_[id];
+    }
+    // Bit of an API id is set if the API is traced with the given --include-apis/--exclude-apis patterns
+    static std::bitset<EndTracingId> BuildApiFilter(const std::string& include, const std::string& exclude) {
+      std::bitset<EndTracingId> enabled;
+      enabled.set();
+
+      if (include.empty() && exclude.empty()) {
+        return enabled;
+      }
+
+      // only Level Zero and OpenCL APIs are filtered
+      auto filter = [&](int id) {
+        std::string name = get_symbol(static_cast<API_TRACING_ID>(id));
+        if ((!include.empty() && !MatchApi(include, name)) || (!exclude.empty() && MatchApi(exclude, name))) {
+          enabled.reset(id);
+        }
+      };
+      for (int id = L0StartTracingId + 1; id < L0EndTracingId; id++) {
+        filter(id);
+      }
+      for (int id = OCLStartTracingId; id < OCLEndTracingId; id++) {
+        filter(id);
+      }
+      return enabled;
+    }
   private:
+    // Patterns are comma separated globs, e.g. "zeEvent*,clFinish"
+    static bool MatchApi(const std::string& patterns, const std::string& name) {
+      std::stringstream stream(patterns);
+      std::string pattern;
+      while (std::getline(stream, pattern, ',')) {
+        if (!pattern.empty() && (fnmatch(pattern.c_str(), name.c_str(), 0) == 0)) {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    static std::bitset<EndTracingId> InitApiFilter(void) {
+      return BuildApiFilter(utils::GetEnv("UNITRACE_IncludeApis"), utils::GetEnv("UNITRACE_ExcludeApis"));
+    }
+
     inline static bool conditional_collection_ = (utils::GetEnv("UNITRACE_ConditionalCollection") == "1") ? true : false;
     inline static bool itt_paused_ = false;
+    inline static std::bitset<EndTracingId> api_enabled_ = InitApiFilter();
 };
     
 #endif // PTI_TOOLS_UNITRACE_UNICONTROL_H
@@ -16,6 +16,7 @@ enum EVENT_TYPE {
   EVENT_FLOW_SINK,
   EVENT_COMPLETE,
   EVENT_MARK,
+  EVENT_COUNTER,
 };
 
 enum API_TYPE {
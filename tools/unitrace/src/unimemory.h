@@ -8,8 +8,12 @@
 #ifndef PTI_TOOLS_UNITRACE_UNIMEMORY_H
 #define PTI_TOOLS_UNITRACE_UNIMEMORY_H
 
+#include <atomic>
 #include <iostream>
 #include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
 
 namespace UniMemory {
   void
@@ -27,6 +31,199 @@ namespace UniMemory {
       std::_Exit(-1);
     }
   }
+
+  // What to do with trace data when the tracing memory budget (--max-trace-memory) is used up
+  enum TraceMemoryPolicy {
+    TRACE_MEMORY_POLICY_SPILL = 0,	// write buffered data out to the trace files and reuse the buffers
+    TRACE_MEMORY_POLICY_DROP_OLDEST,	// discard the oldest buffered data and reuse the buffers
+    TRACE_MEMORY_POLICY_DROP_DETAIL,	// drop new trace data, but keep aggregated statistics
+  };
+
+  inline uint64_t GetTraceMemoryLimit(void) {
+    // in bytes, with optional K/M/G suffix, 0 means unlimited
+    const char *value = std::getenv("UNITRACE_MaxTraceMemory");
+    if ((value == nullptr) || (*value == 0)) {
+      return 0;
+    }
+    char *suffix = nullptr;
+    uint64_t limit = std::strtoull(value, &suffix, 10);
+    if ((suffix != nullptr) && (*suffix != 0)) {
+      switch (*suffix) {
+        case 'G':
+        case 'g':
+          limit <<= 10;
+          [[fallthrough]];
+        case 'M':
+        case 'm':
+          limit <<= 10;
+          [[fallthrough]];
+        case 'K':
+        case 'k':
+          limit <<= 10;
+          break;
+        default:
+          std::cerr << "[WARNING] Invalid tracing memory limit " << value << ", tracing memory is not limited" << std::endl;
+          return 0;
+      }
+    }
+    return limit;
+  }
+
+  inline TraceMemoryPolicy GetTraceMemoryPolicy(void) {
+    const char *value = std::getenv("UNITRACE_TraceMemoryPolicy");
+    if ((value == nullptr) || (*value == 0) || (std::strcmp(value, "spill") == 0)) {
+      return TRACE_MEMORY_POLICY_SPILL;
+    }
+    if (std::strcmp(value, "drop-oldest") == 0) {
+      return TRACE_MEMORY_POLICY_DROP_OLDEST;
+    }
+    if (std::strcmp(value, "drop-detail") == 0) {
+      return TRACE_MEMORY_POLICY_DROP_DETAIL;
+    }
+    std::cerr << "[WARNING] Unknown tracing memory policy " << value << ", spill is used" << std::endl;
+    return TRACE_MEMORY_POLICY_SPILL;
+  }
+
+  // Accounts memory held by trace buffers against the tracing memory budget.
+  // Allocations that do not fit in the budget, or that fail, return nullptr instead of terminating
+  // the process, and the caller degrades according to the policy.
+  class TraceMemory {
+    public:
+      static bool Reserve(size_t size) {
+        uint64_t used = used_.fetch_add(size, std::memory_order_relaxed) + size;
+        if ((limit_ != 0) && (used > limit_)) {
+          used_.fetch_sub(size, std::memory_order_relaxed);
+          return false;
+        }
+        UpdatePeak(used);
+        return true;
+      }
+
+      static void Release(size_t size) {
+        used_.fetch_sub(size, std::memory_order_relaxed);
+      }
+
+      // forced allocations are accounted, but never refused because of the budget
+      static void *Allocate(size_t size, bool forced = false) {
+        if (forced) {
+          UpdatePeak(used_.fetch_add(size, std::memory_order_relaxed) + size);
+        }
+        else if (!Reserve(size)) {
+          return nullptr;
+        }
+        void *ptr = malloc(size);
+        if (ptr == nullptr) {
+          Release(size);
+          if (!out_of_memory_.exchange(true)) {
+            std::cerr << "[WARNING] Out of memory for trace data, trace data will be degraded" << std::endl;
+          }
+        }
+        return ptr;
+      }
+
+      static void Free(void *ptr, size_t size) {
+        if (ptr != nullptr) {
+          free(ptr);
+          Release(size);
+        }
+      }
+
+      static bool IsOverBudget(void) {
+        return ((limit_ != 0) && (used_.load(std::memory_order_relaxed) > limit_));
+      }
+
+      static TraceMemoryPolicy GetPolicy(void) {
+        return policy_;
+      }
+
+      static void CountSpilled(uint64_t count) {
+        spilled_.fetch_add(count, std::memory_order_relaxed);
+      }
+
+      static void CountDropped(uint64_t count) {
+        dropped_.fetch_add(count, std::memory_order_relaxed);
+      }
+
+      static uint64_t GetUsed(void) {
+        return used_.load(std::memory_order_relaxed);
+      }
+
+      static uint64_t GetSpilled(void) {
+        return spilled_.load(std::memory_order_relaxed);
+      }
+
+      static uint64_t GetDropped(void) {
+        return dropped_.load(std::memory_order_relaxed);
+      }
+
+      // true if trace data were spilled or dropped, or memory ran out, setting a limit alone does not degrade the trace
+      static bool IsDegraded(void) {
+        return (out_of_memory_.load(std::memory_order_relaxed) || (GetSpilled() != 0) || (GetDropped() != 0));
+      }
+
+      static std::string GetSummary(void) {
+        static const char *policy_names[] = {"spill", "drop-oldest", "drop-detail"};
+        std::string str("\n=== Tracing Memory Summary ===\n\n");
+        str += "Limit (bytes): " + ((limit_ == 0) ? std::string("unlimited") : std::to_string(limit_)) + "\n";
+        str += "Policy: " + std::string(policy_names[policy_]) + "\n";
+        str += "Peak (bytes): " + std::to_string(peak_.load(std::memory_order_relaxed)) + "\n";
+        str += "In Use (bytes): " + std::to_string(used_.load(std::memory_order_relaxed)) + "\n";
+        str += "Records Spilled: " + std::to_string(spilled_.load(std::memory_order_relaxed)) + "\n";
+        str += "Records Dropped: " + std::to_string(dropped_.load(std::memory_order_relaxed)) + "\n";
+        return str;
+      }
+
+    private:
+      static void UpdatePeak(uint64_t used) {
+        uint64_t peak = peak_.load(std::memory_order_relaxed);
+        while ((used > peak) && !peak_.compare_exchange_weak(peak, used, std::memory_order_relaxed)) {
+        }
+      }
+
+      inline static const uint64_t limit_ = GetTraceMemoryLimit();
+      inline static const TraceMemoryPolicy policy_ = GetTraceMemoryPolicy();
+      inline static std::atomic<uint64_t> used_ = 0;
+      inline static std::atomic<uint64_t> peak_ = 0;
+      inline static std::atomic<uint64_t> spilled_ = 0;
+      inline static std::atomic<uint64_t> dropped_ = 0;
+      inline static std::atomic<bool> out_of_memory_ = false;
+  };
+
+  // Allocator of containers holding trace data, so their storage is accounted against the budget.
+  // Allocations are forced, the caller checks IsOverBudget() to decide whether to keep the data.
+  // std::bad_alloc is thrown when memory runs out, so the caller can drop the data instead of
+  // terminating the application.
+  template <typename T>
+  struct TraceMemoryAllocator {
+    using value_type = T;
+
+    TraceMemoryAllocator() = default;
+
+    template <typename U>
+    TraceMemoryAllocator(const TraceMemoryAllocator<U>& /* that */) {}
+
+    T *allocate(size_t n) {
+      void *ptr = TraceMemory::Allocate(n * sizeof(T), true);
+      if (ptr == nullptr) {
+        throw std::bad_alloc();
+      }
+      return static_cast<T *>(ptr);
+    }
+
+    void deallocate(T *ptr, size_t n) {
+      TraceMemory::Free(ptr, n * sizeof(T));
+    }
+  };
+
+  template <typename T, typename U>
+  bool operator==(const TraceMemoryAllocator<T>& /* a */, const TraceMemoryAllocator<U>& /* b */) {
+    return true;
+  }
+
+  template <typename T, typename U>
+  bool operator!=(const TraceMemoryAllocator<T>& /* a */, const TraceMemoryAllocator<U>& /* b */) {
+    return false;
+  }
 }
 
 #endif // PTI_TOOLS_UNITRACE_UNIMEMORY_H
@@ -40,18 +40,8 @@ public:
     }
         
     static uint64_t GetHostTimestamp() {
-#if defined(_WIN32)
-        LARGE_INTEGER ticks{0};
-        LARGE_INTEGER frequency{0};
-        BOOL status = QueryPerformanceFrequency(&frequency);
-        status = QueryPerformanceCounter(&ticks);
-        PTI_ASSERT(status != 0);
-        return ticks.QuadPart * (NSEC_IN_SEC / frequency.QuadPart);
-#else /* _WIN32 */
-        timespec ts{0};
-        clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
-        return ts.tv_sec * NSEC_IN_SEC + ts.tv_nsec;
-#endif /* _WIN32 */
+        // CLOCK_MONOTONIC_RAW, read from the TSC where it is invariant
+        return utils::GetSystemTime();
     }
 private:
     inline static uint64_t epoch_start_time_ = 0;
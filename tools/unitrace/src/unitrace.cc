@@ -8,6 +8,7 @@
 #include <iostream>
 #include <filesystem>
 #include <csignal>
+#include <regex>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <sys/time.h>
@@ -57,6 +58,28 @@ void Usage(char * progname) {
     "--device-timeline [-t]         " <<
     "Report device timeline" <<
     std::endl;
+  std::cout <<
+    "--include-kernels <regex>      " <<
+    "Profile only kernels whose demangled names match the regular expression" <<
+    std::endl;
+  std::cout <<
+    "--exclude-kernels <regex>      " <<
+    "Do not profile kernels whose demangled names match the regular expression" <<
+    std::endl;
+  std::cout <<
+    "--kernel-launch-range <first:last>" << std::endl <<
+    "                               " <<
+    "Profile only kernel launches numbered from <first> to <last> (inclusive, starting from 0). Either end can be omitted" <<
+    std::endl;
+  std::cout <<
+    "--command-list-timing          " <<
+    "Time regular Level Zero command lists as a whole instead of every kernel in them (kernels in immediate command lists are still timed one by one)" <<
+    std::endl;
+  std::cout <<
+    "--command-list-kernel-sampling <N>" << std::endl <<
+    "                               " <<
+    "In command list timing mode, also time every <N>th kernel in a command list" <<
+    std::endl;
   std::cout <<
     "--opencl                       " <<
     "Trace OpenCL" <<
@@ -87,6 +110,14 @@ void Usage(char * progname) {
     "--chrome-kernel-logging        " <<
     "Trace device and host kernel activities" <<
     std::endl;
+  std::cout <<
+    "--include-apis <patterns>      " <<
+    "Trace only Level Zero and/or OpenCL host calls matching comma separated glob patterns, e.g. \"zeCommandList*,clEnqueue*\"" <<
+    std::endl;
+  std::cout <<
+    "--exclude-apis <patterns>      " <<
+    "Do not trace Level Zero and/or OpenCL host calls matching comma separated glob patterns, e.g. \"zeEventQueryStatus\"" <<
+    std::endl;
   std::cout <<
     "--chrome-device-logging        " <<
     "Trace device activities" <<
@@ -109,6 +140,19 @@ void Usage(char * progname) {
     "--chrome-event-buffer-size <number-of-events>    " <<
     "Size of event buffer on host per host thread(default is -1 or unlimited)" <<
     std::endl;
+  std::cout <<
+    "--perfetto-output              " <<
+    "Store the timeline in Perfetto protobuf format (.pftrace) instead of JSON" <<
+    std::endl;
+  std::cout <<
+    "--max-trace-memory <size>      " <<
+    "Limit of memory used to buffer trace data in bytes, K/M/G suffixes are accepted (default is unlimited)" <<
+    std::endl;
+  std::cout <<
+    "--trace-memory-policy <policy> " <<
+    "What to do when trace data reaches the limit: spill (write buffered data to files, default)," << std::endl <<
+    "                               drop-oldest (discard the oldest buffered data) or drop-detail (keep summaries only)" <<
+    std::endl;
   std::cout <<
     "--chrome-device-timeline       " <<
     "DEPRECATED - use --chrome-kernel-logging instead" <<
@@ -158,10 +202,34 @@ void Usage(char * progname) {
     "--output-dir-path <path>       " <<
     "Output directory path for result files" <<
     std::endl;
+  std::cout <<
+    "--memory-tracking              " <<
+    "Track device, host and shared memory allocations and report peak/live memory per device and leaks at exit" << std::endl <<
+    "                               Live memory is also traced as counters in timeline if Chrome logging is enabled" <<
+    std::endl;
+  std::cout <<
+    "--dependency-analysis          " <<
+    "Break down the gap before each Level Zero kernel or command starts into dependency wait, host submit delay and engine busy time" << std::endl <<
+    "                               and report the events that blocked each kernel the longest" <<
+    std::endl;
+  std::cout <<
+    "--cpu-sampling                 " <<
+    "Sample host threads periodically with call stacks and report the hottest host functions" << std::endl <<
+    "                               Samples are also traced in timeline if Chrome logging is enabled" <<
+    std::endl;
+  std::cout <<
+    "--cpu-sampling-interval <interval>" << std::endl <<
+    "                               " <<
+    "CPU sampling interval in us of thread CPU time (default is 1000 us)" <<
+    std::endl;
   std::cout <<
     "--metric-query [-q]            " <<
     "Query hardware metrics for each kernel instance is enabled for level-zero." <<
     std::endl;
+  std::cout <<
+    "--metric-query-raw-samples <number-of-instances>    " <<
+    "Number of kernel instances per kernel whose raw metrics are reported in query mode (default is 1, -1 for all)" <<
+    std::endl;
   std::cout <<
     "--metric-sampling [-k]         " <<
     "Sample hardware performance metrics for each kernel instance in time-based mode" <<
@@ -234,6 +302,49 @@ int ParseArgs(int argc, char* argv[]) {
     } else if (strcmp(argv[i], "--device-timeline") == 0 || strcmp(argv[i], "-t") == 0) {
       utils::SetEnv("UNITRACE_DeviceTimeline", "1");
       ++app_index;
+    } else if ((strcmp(argv[i], "--include-kernels") == 0) || (strcmp(argv[i], "--exclude-kernels") == 0)) {
+      bool include = (strcmp(argv[i], "--include-kernels") == 0);
+      ++i;
+      if (i >= argc) {
+        std::cout << "[ERROR] Kernel name pattern is not specified" << std::endl;
+        return -1;
+      }
+      try {
+        std::regex pattern(argv[i]);
+      }
+      catch (const std::regex_error& e) {
+        std::cout << "[ERROR] Invalid kernel name pattern " << argv[i] << ": " << e.what() << std::endl;
+        return -1;
+      }
+      utils::SetEnv(include ? "UNITRACE_IncludeKernels" : "UNITRACE_ExcludeKernels", argv[i]);
+      app_index += 2;
+    } else if (strcmp(argv[i], "--kernel-launch-range") == 0) {
+      ++i;
+      if (i >= argc) {
+        std::cout << "[ERROR] Kernel launch range is not specified" << std::endl;
+        return -1;
+      }
+      if (!std::regex_match(argv[i], std::regex("[0-9]*(:[0-9]*)?"))) {
+        std::cout << "[ERROR] Invalid kernel launch range " << argv[i] << ", <first:last> is expected" << std::endl;
+        return -1;
+      }
+      utils::SetEnv("UNITRACE_KernelLaunchRange", argv[i]);
+      app_index += 2;
+    } else if (strcmp(argv[i], "--command-list-timing") == 0) {
+      utils::SetEnv("UNITRACE_CommandListTiming", "1");
+      ++app_index;
+    } else if (strcmp(argv[i], "--command-list-kernel-sampling") == 0) {
+      ++i;
+      if (i >= argc) {
+        std::cout << "[ERROR] Kernel sampling interval is not specified" << std::endl;
+        return -1;
+      }
+      if (!std::regex_match(argv[i], std::regex("[0-9]+"))) {
+        std::cout << "[ERROR] Invalid kernel sampling interval " << argv[i] << std::endl;
+        return -1;
+      }
+      utils::SetEnv("UNITRACE_CommandListKernelSampling", argv[i]);
+      app_index += 2;
     } else if (strcmp(argv[i], "--opencl") == 0) {
       utils::SetEnv("UNITRACE_OpenCLTracing", "1");
       ++app_index;
@@ -261,6 +372,22 @@ int ParseArgs(int argc, char* argv[]) {
     } else if (strcmp(argv[i], "--chrome-kernel-logging") == 0) {
       utils::SetEnv("UNITRACE_ChromeKernelLogging", "1");
       ++app_index;
+    } else if (strcmp(argv[i], "--include-apis") == 0) {
+      ++i;
+      if (i >= argc) {
+        std::cout << "[ERROR] API patterns are not specified" << std::endl;
+        return -1;
+      }
+      utils::SetEnv("UNITRACE_IncludeApis", argv[i]);
+      app_index += 2;
+    } else if (strcmp(argv[i], "--exclude-apis") == 0) {
+      ++i;
+      if (i >= argc) {
+        std::cout << "[ERROR] API patterns are not specified" << std::endl;
+        return -1;
+      }
+      utils::SetEnv("UNITRACE_ExcludeApis", argv[i]);
+      app_index += 2;
     } else if (strcmp(argv[i], "--chrome-device-logging") == 0) {
       utils::SetEnv("UNITRACE_ChromeDeviceLogging", "1");
       ++app_index;
@@ -278,6 +405,29 @@ int ParseArgs(int argc, char* argv[]) {
       }
       utils::SetEnv("UNITRACE_ChromeEventBufferSize", argv[i]);
       app_index += 2;
+    } else if (strcmp(argv[i], "--perfetto-output") == 0) {
+      utils::SetEnv("UNITRACE_PerfettoOutput", "1");
+      ++app_index;
+    } else if (strcmp(argv[i], "--max-trace-memory") == 0) {
+      ++i;
+      if (i >= argc) {
+        std::cout << "[ERROR] Tracing memory limit is not specified" << std::endl;
+        return -1;
+      }
+      utils::SetEnv("UNITRACE_MaxTraceMemory", argv[i]);
+      app_index += 2;
+    } else if (strcmp(argv[i], "--trace-memory-policy") == 0) {
+      ++i;
+      if (i >= argc) {
+        std::cout << "[ERROR] Tracing memory policy is not specified" << std::endl;
+        return -1;
+      }
+      if (strcmp(argv[i], "spill") && strcmp(argv[i], "drop-oldest") && strcmp(argv[i], "drop-detail")) {
+        std::cout << "[ERROR] Invalid tracing memory policy " << argv[i] << std::endl;
+        return -1;
+      }
+      utils::SetEnv("UNITRACE_TraceMemoryPolicy", argv[i]);
+      app_index += 2;
     } else if (strcmp(argv[i], "--chrome-device-timeline") == 0) {
       std::cerr << "Deprecated: --chrome-device-timeline is deprecated, using --chrome-device-logging" << std::endl;
       utils::SetEnv("UNITRACE_ChromeDeviceLogging", "1");
@@ -326,9 +476,42 @@ int ParseArgs(int argc, char* argv[]) {
       utils::SetEnv("UNITRACE_TraceOutputDirPath", "1");
       utils::SetEnv("UNITRACE_TraceOutputDir", argv[i]);
       app_index += 2;
+    } else if (strcmp(argv[i], "--memory-tracking") == 0) {
+      utils::SetEnv("UNITRACE_MemoryTracking", "1");
+      ++app_index;
+    } else if (strcmp(argv[i], "--dependency-analysis") == 0) {
+      utils::SetEnv("UNITRACE_DependencyAnalysis", "1");
+      ++app_index;
+    } else if (strcmp(argv[i], "--cpu-sampling") == 0) {
+      utils::SetEnv("UNITRACE_CpuSampling", "1");
+      ++app_index;
+    } else if (strcmp(argv[i], "--cpu-sampling-interval") == 0) {
+      ++i;
+      if (i >= argc) {
+        std::cout << "[ERROR] CPU sampling interval is not specified" << std::endl;
+        return -1;
+      }
+      if (!std::regex_match(argv[i], std::regex("[1-9][0-9]*"))) {
+        std::cout << "[ERROR] Invalid CPU sampling interval " << argv[i] << std::endl;
+        return -1;
+      }
+      utils::SetEnv("UNITRACE_CpuSamplingInterval", argv[i]);
+      app_index += 2;
     } else if (strcmp(argv[i], "--metric-query") == 0 || strcmp(argv[i], "-q") == 0) {
       utils::SetEnv("UNITRACE_MetricQuery", "1");
       ++app_index;
+    } else if (strcmp(argv[i], "--metric-query-raw-samples") == 0) {
+      ++i;
+      if (i >= argc) {
+        std::cout << "[ERROR] Number of raw metric samples is not specified" << std::endl;
+        return -1;
+      }
+      if (!std::regex_match(argv[i], std::regex("-1|[0-9]+"))) {
+        std::cout << "[ERROR] Invalid number of raw metric samples " << argv[i] << std::endl;
+        return -1;
+      }
+      utils::SetEnv("UNITRACE_MetricQueryRawSamples", argv[i]);
+      app_index += 2;
     } else if (strcmp(argv[i], "--group") == 0 || strcmp(argv[i], "-g") == 0) {
       ++i;
       if (i >= argc) {
@@ -0,0 +1,93 @@
+//==============================================================
+// Copyright (C) Intel Corporation
+//
+// SPDX-License-Identifier: MIT
+// =============================================================
+
+#include <gtest/gtest.h>
+
+#include <bitset>
+#include <set>
+#include <string>
+
+#include "unicontrol.h"
+
+// common_header.gen is generated from the API excerpts in gen_input, so the ids below are the ones
+// the generator emits for them
+
+namespace {
+
+using ApiFilter = std::bitset<EndTracingId>;
+
+// ids of all Level Zero and OpenCL APIs, the ones --include-apis/--exclude-apis apply to
+std::set<int> AllApis() {
+  std::set<int> ids;
+  for (int id = L0StartTracingId + 1; id < L0EndTracingId; id++) {
+    ids.insert(id);
+  }
+  for (int id = OCLStartTracingId; id < OCLEndTracingId; id++) {
+    ids.insert(id);
+  }
+  return ids;
+}
+
+void ExpectEnabledApis(const ApiFilter& filter, const std::set<int>& expected) {
+  for (int id : AllApis()) {
+    EXPECT_EQ(filter[id], expected.count(id) != 0) << get_symbol(static_cast<API_TRACING_ID>(id));
+  }
+}
+
+// ids that are not host APIs are never filtered
+void ExpectOtherIdsEnabled(const ApiFilter& filter) {
+  for (int id : {UnknownTracingId, ZeKernelTracingId, DepTracingId, ClKernelTracingId, OpenClTracingId,
+                 XptiTracingId, IttTracingId, MemTracingId, CpuSampleTracingId}) {
+    EXPECT_TRUE(filter[id]) << id;
+  }
+}
+
+}  // namespace
+
+TEST(ApiFilterTest, GeneratedIdsMapToApiNames) {
+  EXPECT_EQ(AllApis().size(), 9u);
+  EXPECT_EQ(get_symbol(InitTracingId), "zeInit");
+  EXPECT_EQ(get_symbol(CommandListAppendLaunchKernelTracingId), "zeCommandListAppendLaunchKernel");
+  EXPECT_EQ(get_symbol(clBuildProgramTracingId), "clBuildProgram");
+  EXPECT_EQ(get_symbol(clGetEventInfoTracingId), "clGetEventInfo");
+
+  // every API is selected by its own name and by nothing else
+  for (int id : AllApis()) {
+    ExpectEnabledApis(UniController::BuildApiFilter(get_symbol(static_cast<API_TRACING_ID>(id)), ""), {id});
+  }
+}
+
+TEST(ApiFilterTest, NoPatternsEnableAll) {
+  ApiFilter filter = UniController::BuildApiFilter("", "");
+  EXPECT_TRUE(filter.all());
+}
+
+TEST(ApiFilterTest, IncludeKeepsOnlyMatchingApis) {
+  ApiFilter filter = UniController::BuildApiFilter("zeEvent*,clFinish", "");
+  ExpectEnabledApis(filter, {EventCreateTracingId, EventQueryStatusTracingId, EventHostSynchronizeTracingId,
+                             clFinishTracingId});
+  ExpectOtherIdsEnabled(filter);
+}
+
+TEST(ApiFilterTest, ExcludeDropsMatchingApis) {
+  ApiFilter filter = UniController::BuildApiFilter("", "zeEventQueryStatus,clGetEventInfo");
+  ExpectEnabledApis(filter, {InitTracingId, EventCreateTracingId, EventHostSynchronizeTracingId,
+                             CommandListAppendLaunchKernelTracingId, clBuildProgramTracingId,
+                             clEnqueueNDRangeKernelTracingId, clFinishTracingId});
+  ExpectOtherIdsEnabled(filter);
+}
+
+TEST(ApiFilterTest, ExcludeAppliesAfterInclude) {
+  ApiFilter filter = UniController::BuildApiFilter("ze*", "*QueryStatus,zeInit");
+  ExpectEnabledApis(filter, {EventCreateTracingId, EventHostSynchronizeTracingId,
+                             CommandListAppendLaunchKernelTracingId});
+  ExpectOtherIdsEnabled(filter);
+}
+
+TEST(ApiFilterTest, EmptyPatternsInListAreIgnored) {
+  ApiFilter filter = UniController::BuildApiFilter(",clFinish,,", ",");
+  ExpectEnabledApis(filter, {clFinishTracingId});
+}
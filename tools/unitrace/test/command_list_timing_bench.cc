@@ -0,0 +1,108 @@
+//==============================================================
+// Copyright (C) Intel Corporation
+//
+// SPDX-License-Identifier: MIT
+// =============================================================
+
+// Compares kernel timing with command list timing on lists of many kernels: the timestamps
+// written, the launches that need events of their own and the records harvested per list,
+// and the host time the timing bookkeeping spends per append. The timestamp write is mocked, so no
+// device is needed, and the cost of the events saved, appending and harvesting them, is not in the
+// time per append.
+//
+// usage: command_list_timing_bench [kernels per list] [lists] [kernel sampling]
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "ze_command_list_timing.h"
+
+namespace {
+
+uint64_t timestamp_writes = 0;
+
+struct BenchResult {
+  uint64_t timestamp_writes_ = 0;
+  uint64_t kernel_events_ = 0;	// launches timed with events of their own
+  uint64_t records_ = 0;	// kernel and list records harvested
+  double append_ns_ = 0;
+};
+
+BenchResult Run(ZeCommandListTiming& timing, int num_kernels, int num_lists) {
+  const ze_command_list_handle_t command_list = reinterpret_cast<ze_command_list_handle_t>(0x1000);
+  const int num_slots = 2;
+  std::vector<uint64_t> timestamps(num_slots);
+  BenchResult result;
+
+  timestamp_writes = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int l = 0; l < num_lists; l++) {
+    ZeCommandListTimingState state;
+    int next_free_slot = 0;
+    for (int k = 0; k < num_kernels; k++) {
+      // a few kernels alternate in the list, as in a model layer
+      if (timing.OnKernelAppended(command_list, state, timestamps.data(), next_free_slot, num_slots, k % 4, true)) {
+        result.kernel_events_++;
+      }
+    }
+    if (timing.OnListClosed(command_list, state, timestamps.data())) {
+      result.records_++;
+    }
+  }
+  auto end = std::chrono::steady_clock::now();
+
+  result.records_ += result.kernel_events_;
+  result.timestamp_writes_ = timestamp_writes;
+  result.append_ns_ = std::chrono::duration<double, std::nano>(end - start).count() / (double(num_kernels) * num_lists);
+  return result;
+}
+
+void Report(const std::string& mode, const BenchResult& result, int num_lists) {
+  std::cout << std::left << std::setw(24) << mode << std::right
+            << std::setw(18) << double(result.timestamp_writes_) / num_lists
+            << std::setw(16) << double(result.kernel_events_) / num_lists
+            << std::setw(16) << double(result.records_) / num_lists
+            << std::setw(14) << result.append_ns_ << std::endl;
+}
+
+}  // namespace
+
+ze_result_t ZE_APICALL zeCommandListAppendWriteGlobalTimestamp(ze_command_list_handle_t /*command_list*/, uint64_t* /*dstptr*/,
+                                                               ze_event_handle_t /*signal_event*/,
+                                                               uint32_t /*num_wait_events*/,
+                                                               ze_event_handle_t* /*wait_events*/) {
+  timestamp_writes++;
+  return ZE_RESULT_SUCCESS;
+}
+
+int main(int argc, char *argv[]) {
+  int num_kernels = (argc > 1) ? std::atoi(argv[1]) : 3000;
+  int num_lists = (argc > 2) ? std::atoi(argv[2]) : 1000;
+  uint32_t kernel_sampling = (argc > 3) ? std::atoi(argv[3]) : 100;
+  if ((num_kernels <= 0) || (num_lists <= 0)) {
+    std::cerr << "usage: " << argv[0] << " [kernels per list] [lists] [kernel sampling]" << std::endl;
+    return -1;
+  }
+
+  std::cout << std::fixed << std::setprecision(1);
+  std::cout << num_lists << " lists of " << num_kernels << " kernels, per list:" << std::endl;
+  std::cout << std::left << std::setw(24) << "mode" << std::right << std::setw(18) << "timestamp writes"
+            << std::setw(16) << "kernel events" << std::setw(16) << "records" << std::setw(14) << "ns/append"
+            << std::endl;
+
+  ZeCommandListTiming kernel_timing(false, 0);
+  Report("kernel timing", Run(kernel_timing, num_kernels, num_lists), num_lists);
+
+  ZeCommandListTiming list_timing(true, 0);
+  Report("command list timing", Run(list_timing, num_kernels, num_lists), num_lists);
+
+  ZeCommandListTiming sampled_list_timing(true, kernel_sampling);
+  Report("sampling 1/" + std::to_string(kernel_sampling), Run(sampled_list_timing, num_kernels, num_lists), num_lists);
+
+  return 0;
+}
@@ -0,0 +1,152 @@
+//==============================================================
+// Copyright (C) Intel Corporation
+//
+// SPDX-License-Identifier: MIT
+// =============================================================
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "ze_command_list_timing.h"
+
+// mock zeCommandListAppendWriteGlobalTimestamp, the timing calls it directly as the collector does with the loader
+
+namespace {
+
+constexpr int kNumSlots = 8;
+
+std::vector<uint64_t *> timestamp_writes;
+ze_result_t timestamp_write_result = ZE_RESULT_SUCCESS;
+
+const ze_command_list_handle_t kCommandList = reinterpret_cast<ze_command_list_handle_t>(0x1000);
+
+constexpr uint64_t kGemm = 1;
+constexpr uint64_t kRelu = 2;
+constexpr uint64_t kUnknown = 3;
+
+std::string GetKernelName(uint64_t kernel_id) {
+  static const std::map<uint64_t, std::string> names = {{kGemm, "gemm"}, {kRelu, "relu"}};
+  auto it = names.find(kernel_id);
+  return (it == names.end()) ? std::string() : it->second;
+}
+
+class CommandListTimingTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    timestamp_writes.clear();
+    timestamp_write_result = ZE_RESULT_SUCCESS;
+  }
+
+  // launches of kernel_id appended to the list, returns the number of launches timed
+  int Append(ZeCommandListTiming& timing, uint64_t kernel_id, int count, bool traced = true) {
+    int timed = 0;
+    for (int i = 0; i < count; i++) {
+      if (timing.OnKernelAppended(kCommandList, state_, timestamps_, next_free_slot_, kNumSlots, kernel_id, traced)) {
+        timed++;
+      }
+    }
+    return timed;
+  }
+
+  ZeCommandListTimingState state_;
+  volatile uint64_t timestamps_[kNumSlots] = {};
+  int next_free_slot_ = 0;
+};
+
+}  // namespace
+
+ze_result_t ZE_APICALL zeCommandListAppendWriteGlobalTimestamp(ze_command_list_handle_t command_list, uint64_t* dstptr,
+                                                               ze_event_handle_t /*signal_event*/,
+                                                               uint32_t /*num_wait_events*/,
+                                                               ze_event_handle_t* /*wait_events*/) {
+  EXPECT_EQ(command_list, kCommandList);
+  timestamp_writes.push_back(dstptr);
+  return timestamp_write_result;
+}
+
+TEST_F(CommandListTimingTest, DisabledTimesEveryTracedLaunch) {
+  ZeCommandListTiming timing(false, 0);
+  EXPECT_EQ(Append(timing, kGemm, 3), 3);
+  EXPECT_TRUE(timestamp_writes.empty());
+  EXPECT_EQ(state_.num_kernels_, 0u);
+  EXPECT_FALSE(timing.OnListClosed(kCommandList, state_, timestamps_));
+}
+
+TEST_F(CommandListTimingTest, ListTimedWithBeginAndEndSlots) {
+  next_free_slot_ = 2;	// taken by a memory command
+  ZeCommandListTiming timing(true, 0);
+  EXPECT_EQ(Append(timing, kGemm, 3), 0);
+
+  // begin timestamp is written once, in the first free slot, and the end slot is taken too
+  ASSERT_EQ(timestamp_writes.size(), 1u);
+  EXPECT_EQ(timestamp_writes[0], const_cast<uint64_t *>(&timestamps_[2]));
+  EXPECT_EQ(state_.list_timestamps_slot_, 2);
+  EXPECT_EQ(next_free_slot_, 4);
+
+  EXPECT_TRUE(timing.OnListClosed(kCommandList, state_, timestamps_));
+  ASSERT_EQ(timestamp_writes.size(), 2u);
+  EXPECT_EQ(timestamp_writes[1], const_cast<uint64_t *>(&timestamps_[3]));
+}
+
+TEST_F(CommandListTimingTest, ListNamedAfterKernelCounts) {
+  ZeCommandListTiming timing(true, 0);
+  Append(timing, kRelu, 2);
+  Append(timing, kGemm, 1);
+  Append(timing, kUnknown, 4);
+
+  EXPECT_EQ(state_.num_kernels_, 7u);
+  EXPECT_EQ(state_.kernel_counts_, (std::map<uint64_t, uint32_t>{{kGemm, 1}, {kRelu, 2}, {kUnknown, 4}}));
+  // kernels without a name are in the count only
+  EXPECT_EQ(ZeCommandListTiming::GetListName(state_, GetKernelName), "CommandList[7 kernels: gemm x1; relu x2]");
+}
+
+TEST_F(CommandListTimingTest, SamplingTimesEveryNthLaunch) {
+  ZeCommandListTiming timing(true, 3);
+  std::vector<bool> timed;
+  for (int i = 0; i < 7; i++) {
+    timed.push_back(timing.OnKernelAppended(kCommandList, state_, timestamps_, next_free_slot_, kNumSlots, kGemm, true));
+  }
+  EXPECT_EQ(timed, (std::vector<bool>{true, false, false, true, false, false, true}));
+  EXPECT_EQ(state_.num_kernels_, 7u);
+  EXPECT_EQ(timestamp_writes.size(), 1u);
+}
+
+TEST_F(CommandListTimingTest, FilteredLaunchesAreNotCounted) {
+  ZeCommandListTiming timing(true, 2);
+  EXPECT_EQ(Append(timing, kRelu, 5, false), 0);
+
+  // no list timing is started for launches filtered out
+  EXPECT_TRUE(timestamp_writes.empty());
+  EXPECT_EQ(state_.list_timestamps_slot_, -1);
+  EXPECT_EQ(next_free_slot_, 0);
+  EXPECT_FALSE(timing.OnListClosed(kCommandList, state_, timestamps_));
+
+  // sampling counts the launches traced only
+  EXPECT_EQ(Append(timing, kGemm, 3), 2);
+  EXPECT_EQ(state_.num_kernels_, 3u);
+  EXPECT_EQ(state_.kernel_counts_, (std::map<uint64_t, uint32_t>{{kGemm, 3}}));
+  EXPECT_EQ(ZeCommandListTiming::GetListName(state_, GetKernelName), "CommandList[3 kernels: gemm x3]");
+}
+
+TEST_F(CommandListTimingTest, ResetStartsNewTiming) {
+  ZeCommandListTiming timing(true, 0);
+  Append(timing, kGemm, 2);
+  state_.Reset();
+  next_free_slot_ = 0;	// the list is reset with its slots
+
+  Append(timing, kRelu, 1);
+  EXPECT_EQ(timestamp_writes.size(), 2u);
+  EXPECT_EQ(state_.list_timestamps_slot_, 0);
+  EXPECT_EQ(state_.kernel_counts_, (std::map<uint64_t, uint32_t>{{kRelu, 1}}));
+}
+
+TEST_F(CommandListTimingTest, FailedEndTimestampDropsListRecord) {
+  ZeCommandListTiming timing(true, 0);
+  Append(timing, kGemm, 2);
+  timestamp_write_result = ZE_RESULT_ERROR_UNKNOWN;
+  EXPECT_FALSE(timing.OnListClosed(kCommandList, state_, timestamps_));
+}
@@ -0,0 +1,120 @@
+//==============================================================
+// Copyright (C) Intel Corporation
+//
+// SPDX-License-Identifier: MIT
+// =============================================================
+
+#include <gtest/gtest.h>
+
+#include <time.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cpu/cpu_collector.h"
+
+// the workload needs no GPU, the test is skipped where perf_event_open() is not permitted
+
+struct LoggedSample {
+  uint32_t tid;
+  uint64_t timestamp;
+  std::string function;
+  std::string stack;
+};
+
+static std::vector<LoggedSample> logged_samples;
+
+static void OnCpuSample(uint32_t tid, uint64_t timestamp, const std::string& function, const std::string& stack) {
+  logged_samples.push_back({tid, timestamp, function, stack});
+}
+
+static uint64_t GetThreadCpuTime() {
+  timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return uint64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+// exported unmangled, so the frames are symbolized to this name
+extern "C" __attribute__((noinline)) uint64_t SpinCpu(uint64_t duration) {
+  volatile uint64_t sum = 0;
+  uint64_t end = GetThreadCpuTime() + duration;
+  while (GetThreadCpuTime() < end) {
+    for (int i = 0; i < 1000; i++) {
+      sum = sum + i;
+    }
+  }
+  return sum;
+}
+
+class CpuSamplingTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    logged_samples.clear();
+    setenv("UNITRACE_CpuSamplingInterval", "200", 1);
+  }
+
+  void TearDown() override {
+    unsetenv("UNITRACE_CpuSamplingInterval");
+  }
+
+  // 200 ms of CPU time on the calling thread and on a thread the sampler has to discover
+  static uint32_t RunWorkload() {
+    uint32_t worker_tid = 0;
+    std::thread worker([&worker_tid]() {
+      worker_tid = utils::GetTid();
+      SpinCpu(kWorkloadTime);
+    });
+    SpinCpu(kWorkloadTime);
+    worker.join();
+    return worker_tid;
+  }
+
+  constexpr static uint64_t kWorkloadTime = 200000000;	// in ns
+};
+
+TEST_F(CpuSamplingTest, SamplesEveryThreadOnTheTraceClock) {
+  uint64_t start = utils::GetSystemTime();
+  CpuCollector *collector = CpuCollector::Create(OnCpuSample);
+  if (collector == nullptr) {
+    GTEST_SKIP() << "perf_event_open() is not permitted";
+  }
+  uint32_t worker_tid = RunWorkload();
+  collector->Stop();
+  uint64_t end = utils::GetSystemTime();
+  delete collector;	// samples are symbolized and logged here
+
+  std::map<uint32_t, uint32_t> spinning;	// thread id to samples in SpinCpu
+  for (auto& sample : logged_samples) {
+    EXPECT_GE(sample.timestamp, start);
+    EXPECT_LE(sample.timestamp, end);
+    EXPECT_FALSE(sample.function.empty());
+    // the stack starts with the innermost frame
+    EXPECT_EQ(sample.stack.compare(0, sample.function.length(), sample.function), 0);
+    if (sample.stack.find("SpinCpu") != std::string::npos) {
+      spinning[sample.tid]++;
+    }
+  }
+  // about 1000 samples are expected per thread at the 200 us interval
+  EXPECT_GT(spinning[utils::GetTid()], 100);
+  EXPECT_GT(spinning[worker_tid], 100);
+}
+
+TEST_F(CpuSamplingTest, ReportListsHottestFunctions) {
+  CpuCollector *collector = CpuCollector::Create();
+  if (collector == nullptr) {
+    GTEST_SKIP() << "perf_event_open() is not permitted";
+  }
+  RunWorkload();
+  collector->Stop();
+  std::string report = collector->Report();
+  delete collector;
+
+  EXPECT_NE(report.find("Sampling Interval (us): 200\n"), std::string::npos);
+  EXPECT_NE(report.find("SpinCpu, "), std::string::npos);
+  // nothing is logged without a callback
+  EXPECT_TRUE(logged_samples.empty());
+}
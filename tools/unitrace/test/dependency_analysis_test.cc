@@ -0,0 +1,159 @@
+//==============================================================
+// Copyright (C) Intel Corporation
+//
+// SPDX-License-Identifier: MIT
+// =============================================================
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+#include "ze_dependencies.h"
+
+// instances are built by hand, no device is needed
+
+static ze_device_handle_t device = reinterpret_cast<ze_device_handle_t>(0x1000);
+
+class DependencyAnalysisTest : public ::testing::Test {
+ protected:
+  // an instance of kernel or command kernel_command_id on an engine of the device
+  void AddInstance(uint64_t kernel_command_id, uint32_t engine_index, uint64_t submit_time, uint64_t start, uint64_t end,
+                   uint32_t signal_event_id, std::initializer_list<uint32_t> wait_event_ids = {}) {
+    ZeDependencyRecord r{};
+    r.instance_id_ = records_.size() + 1;
+    r.kernel_command_id_ = kernel_command_id;
+    r.device_ = device;
+    r.engine_ordinal_ = 0;
+    r.engine_index_ = engine_index;
+    r.submit_time_ = submit_time;
+    r.start_ = start;
+    r.end_ = end;
+    r.dependencies_.signal_event_id_ = signal_event_id;
+    r.dependencies_.num_wait_events_ = wait_event_ids.size();
+    uint32_t i = 0;
+    for (auto id : wait_event_ids) {
+      r.dependencies_.wait_event_ids_[i++] = id;
+    }
+    records_.push_back(r);
+  }
+
+  std::vector<ZeDependencyRecord> records_;
+};
+
+TEST_F(DependencyAnalysisTest, FirstCommandOnEngineWaitsOnHostOnly) {
+  AddInstance(1, 0, 100, 150, 200, 0);
+
+  ZeDependencyStatsMap stats = AnalyzeDependencies(records_);
+  ASSERT_EQ(stats.count(1), 1);
+  EXPECT_EQ(stats[1].count_, 1);
+  EXPECT_EQ(stats[1].gap_time_, 50);
+  EXPECT_EQ(stats[1].host_submit_delay_time_, 50);
+  EXPECT_EQ(stats[1].engine_busy_time_, 0);
+  EXPECT_EQ(stats[1].dependency_wait_time_, 0);
+  EXPECT_TRUE(stats[1].blocking_edges_.empty());
+}
+
+TEST_F(DependencyAnalysisTest, FirstCommandOnEngineWaitsOnOtherEngine) {
+  AddInstance(1, 1, 100, 110, 300, 7);	// signaler on another engine
+  AddInstance(2, 0, 120, 320, 400, 0, {7});
+
+  ZeDependencyStatsMap stats = AnalyzeDependencies(records_);
+  // from the submission to the signal, then the launch latency
+  EXPECT_EQ(stats[2].gap_time_, 200);
+  EXPECT_EQ(stats[2].dependency_wait_time_, 180);
+  EXPECT_EQ(stats[2].host_submit_delay_time_, 20);
+  EXPECT_EQ(stats[2].engine_busy_time_, 0);
+  ASSERT_EQ(stats[2].blocking_edges_.size(), 1);
+  EXPECT_EQ(stats[2].blocking_edges_[1].wait_time_, 180);
+  EXPECT_EQ(stats[2].blocking_edges_[1].count_, 1);
+}
+
+TEST_F(DependencyAnalysisTest, LastOfOverlappingSignalersBlocks) {
+  // two commands on other engines signal events the waiter waits on, the one ending last blocks it
+  AddInstance(1, 1, 100, 110, 250, 7);
+  AddInstance(2, 2, 105, 115, 280, 8);
+  AddInstance(3, 0, 120, 300, 350, 0, {7, 8});
+
+  ZeDependencyStatsMap stats = AnalyzeDependencies(records_);
+  EXPECT_EQ(stats[3].dependency_wait_time_, 160);
+  EXPECT_EQ(stats[3].host_submit_delay_time_, 20);
+  ASSERT_EQ(stats[3].blocking_edges_.size(), 1);
+  EXPECT_EQ(stats[3].blocking_edges_.count(2), 1);
+}
+
+TEST_F(DependencyAnalysisTest, OverlappingSignalersOfOneEvent) {
+  // both signal the event, the waiter waits on the one submitted last before it even if the
+  // earlier one ends later
+  AddInstance(1, 1, 100, 110, 400, 7);
+  AddInstance(2, 2, 105, 115, 200, 7);
+  AddInstance(3, 0, 120, 220, 300, 0, {7});
+
+  ZeDependencyStatsMap stats = AnalyzeDependencies(records_);
+  EXPECT_EQ(stats[3].dependency_wait_time_, 80);
+  ASSERT_EQ(stats[3].blocking_edges_.size(), 1);
+  EXPECT_EQ(stats[3].blocking_edges_.count(2), 1);
+}
+
+TEST_F(DependencyAnalysisTest, ReusedEventOrderedBySubmitTime) {
+  // the event is signaled, waited on, reset and signaled again, records come out of order
+  AddInstance(4, 0, 500, 700, 800, 0, {7});	// waits on the second signal
+  AddInstance(2, 0, 300, 310, 350, 0, {7});	// waits on the first signal
+  AddInstance(3, 1, 400, 410, 650, 7);	// second signal
+  AddInstance(1, 1, 100, 110, 250, 7);	// first signal
+
+  ZeDependencyStatsMap stats = AnalyzeDependencies(records_);
+  // signaled before the submission, nothing to wait for
+  EXPECT_EQ(stats[2].dependency_wait_time_, 0);
+  EXPECT_TRUE(stats[2].blocking_edges_.empty());
+  // from the submission to the second signal
+  EXPECT_EQ(stats[4].dependency_wait_time_, 150);
+  ASSERT_EQ(stats[4].blocking_edges_.size(), 1);
+  EXPECT_EQ(stats[4].blocking_edges_.count(3), 1);
+}
+
+TEST_F(DependencyAnalysisTest, SignalerSubmittedAfterWaiterIsIgnored) {
+  AddInstance(1, 0, 100, 150, 200, 0, {7});
+  AddInstance(2, 1, 300, 310, 350, 7);
+
+  ZeDependencyStatsMap stats = AnalyzeDependencies(records_);
+  EXPECT_EQ(stats[1].dependency_wait_time_, 0);
+  EXPECT_EQ(stats[1].host_submit_delay_time_, 50);
+}
+
+TEST_F(DependencyAnalysisTest, EngineBusyWithEarlierCommand) {
+  AddInstance(1, 0, 100, 110, 300, 0);
+  AddInstance(2, 0, 120, 310, 400, 0);
+
+  ZeDependencyStatsMap stats = AnalyzeDependencies(records_);
+  EXPECT_EQ(stats[2].gap_time_, 190);
+  EXPECT_EQ(stats[2].engine_busy_time_, 180);
+  EXPECT_EQ(stats[2].host_submit_delay_time_, 10);
+  EXPECT_EQ(stats[2].dependency_wait_time_, 0);
+}
+
+TEST_F(DependencyAnalysisTest, StoreDropsInstancesOverCap) {
+  ZeDependencyRecordStore store(2);
+  uint64_t used = UniMemory::TraceMemory::GetUsed();
+
+  AddInstance(1, 0, 0, 10, 20, 1);
+  AddInstance(2, 0, 0, 30, 40, 0, {1});
+  EXPECT_TRUE(store.Reserve());
+  EXPECT_TRUE(store.Reserve());
+  EXPECT_FALSE(store.Reserve());
+  EXPECT_EQ(store.GetDroppedCount(), 1u);
+  EXPECT_EQ(UniMemory::TraceMemory::GetUsed(), used + 2 * sizeof(ZeDependencyRecord));
+
+  store.Sweep(records_);
+  EXPECT_TRUE(records_.empty());
+  auto stats = store.Analyze();
+  EXPECT_EQ(stats.size(), 2u);
+  EXPECT_EQ(stats[2].blocking_edges_.size(), 1u);
+
+  // records analyzed are released, the dropped count is kept for the report
+  EXPECT_EQ(UniMemory::TraceMemory::GetUsed(), used);
+  EXPECT_TRUE(store.Reserve());
+  EXPECT_EQ(store.GetDroppedCount(), 1u);
+  EXPECT_TRUE(store.Analyze().empty());
+}
@@ -0,0 +1,11 @@
+/*
+ * Excerpt of the function ids of the OpenCL tracing_types.h, input of the generator in api_filter_test
+ */
+
+typedef enum _cl_function_id {
+    CL_FUNCTION_clBuildProgram = 0,
+    CL_FUNCTION_clEnqueueNDRangeKernel = 1,
+    CL_FUNCTION_clFinish = 2,
+    CL_FUNCTION_clGetEventInfo = 3,
+    CL_FUNCTION_COUNT = 4,
+} cl_function_id;
@@ -0,0 +1,87 @@
+/*
+ * Excerpt of ze_api.h, input of the generators in api_filter_test: the enums the callbacks print,
+ * the parameters, the tracing callback typedefs and the callback tables, in the order of ze_api.h
+ */
+
+typedef enum _ze_result_t
+{
+    ZE_RESULT_SUCCESS = 0,
+    ZE_RESULT_NOT_READY = 1,
+    ZE_RESULT_ERROR_DEVICE_LOST = 0x70000001,
+    ZE_RESULT_FORCE_UINT32 = 0x7fffffff
+} ze_result_t;
+
+typedef enum _ze_structure_type_t
+{
+    ZE_STRUCTURE_TYPE_DRIVER_PROPERTIES = 0x1,
+    ZE_STRUCTURE_TYPE_EVENT_DESC = 0x11,
+    ZE_STRUCTURE_TYPE_FORCE_UINT32 = 0x7fffffff
+} ze_structure_type_t;
+
+typedef struct _ze_init_params_t
+{
+    ze_init_flags_t* pflags;
+} ze_init_params_t;
+
+typedef struct _ze_event_create_params_t
+{
+    ze_event_pool_handle_t* phEventPool;
+    const ze_event_desc_t** pdesc;
+    ze_event_handle_t** pphEvent;
+} ze_event_create_params_t;
+
+typedef struct _ze_event_query_status_params_t
+{
+    ze_event_handle_t* phEvent;
+} ze_event_query_status_params_t;
+
+typedef struct _ze_event_host_synchronize_params_t
+{
+    ze_event_handle_t* phEvent;
+    uint64_t* ptimeout;
+} ze_event_host_synchronize_params_t;
+
+typedef struct _ze_command_list_append_launch_kernel_params_t
+{
+    ze_command_list_handle_t* phCommandList;
+    ze_kernel_handle_t* phKernel;
+    const ze_group_count_t** ppLaunchFuncArgs;
+    ze_event_handle_t* phSignalEvent;
+    uint32_t* pnumWaitEvents;
+    ze_event_handle_t** pphWaitEvents;
+} ze_command_list_append_launch_kernel_params_t;
+
+typedef void (ZE_APICALL *ze_pfnInitCb_t)(
+    ze_init_params_t* params, ze_result_t result, void* pTracerUserData, void** ppTracerInstanceUserData);
+typedef void (ZE_APICALL *ze_pfnEventCreateCb_t)(
+    ze_event_create_params_t* params, ze_result_t result, void* pTracerUserData, void** ppTracerInstanceUserData);
+typedef void (ZE_APICALL *ze_pfnEventQueryStatusCb_t)(
+    ze_event_query_status_params_t* params, ze_result_t result, void* pTracerUserData, void** ppTracerInstanceUserData);
+typedef void (ZE_APICALL *ze_pfnEventHostSynchronizeCb_t)(
+    ze_event_host_synchronize_params_t* params, ze_result_t result, void* pTracerUserData, void** ppTracerInstanceUserData);
+typedef void (ZE_APICALL *ze_pfnCommandListAppendLaunchKernelCb_t)(
+    ze_command_list_append_launch_kernel_params_t* params, ze_result_t result, void* pTracerUserData, void** ppTracerInstanceUserData);
+
+typedef struct _ze_global_callbacks_t
+{
+    ze_pfnInitCb_t                                                  pfnInitCb;
+} ze_global_callbacks_t;
+
+typedef struct _ze_event_callbacks_t
+{
+    ze_pfnEventCreateCb_t                                           pfnCreateCb;
+    ze_pfnEventHostSynchronizeCb_t                                  pfnHostSynchronizeCb;
+    ze_pfnEventQueryStatusCb_t                                      pfnQueryStatusCb;
+} ze_event_callbacks_t;
+
+typedef struct _ze_command_list_callbacks_t
+{
+    ze_pfnCommandListAppendLaunchKernelCb_t                         pfnAppendLaunchKernelCb;
+} ze_command_list_callbacks_t;
+
+typedef struct _ze_callbacks_t
+{
+    ze_global_callbacks_t               Global;
+    ze_event_callbacks_t                Event;
+    ze_command_list_callbacks_t         CommandList;
+} ze_callbacks_t;
@@ -0,0 +1,102 @@
+//==============================================================
+// Copyright (C) Intel Corporation
+//
+// SPDX-License-Identifier: MIT
+// =============================================================
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+#include "ze_kernel_filter.h"
+
+// the filter reads the options from the environment the launcher sets, when it is constructed
+
+namespace {
+
+// demangles to "vector_add(float*, float*)"
+constexpr const char* kVectorAdd = "_Z10vector_addPfS_";
+// demangles to "matmul(float const*, float*)"
+constexpr const char* kMatmul = "_Z6matmulPKfPf";
+
+std::vector<bool> TraceLaunches(ZeKernelFilter& filter, int count) {
+  std::vector<bool> traced;
+  for (int i = 0; i < count; i++) {
+    traced.push_back(filter.IsLaunchTraced());
+  }
+  return traced;
+}
+
+}  // namespace
+
+class KernelFilterTest : public ::testing::Test {
+ protected:
+  void TearDown() override {
+    unsetenv("UNITRACE_IncludeKernels");
+    unsetenv("UNITRACE_ExcludeKernels");
+    unsetenv("UNITRACE_KernelLaunchRange");
+  }
+};
+
+TEST_F(KernelFilterTest, InactiveWithoutOptions) {
+  ZeKernelFilter filter;
+  EXPECT_FALSE(filter.IsActive());
+  EXPECT_TRUE(filter.IsKernelTraced(kVectorAdd));
+  EXPECT_EQ(TraceLaunches(filter, 3), std::vector<bool>({true, true, true}));
+}
+
+TEST_F(KernelFilterTest, IncludeMatchesDemangledName) {
+  setenv("UNITRACE_IncludeKernels", "^vector_add", 1);
+  ZeKernelFilter filter;
+  EXPECT_TRUE(filter.IsActive());
+  EXPECT_TRUE(filter.IsKernelTraced(kVectorAdd));
+  EXPECT_FALSE(filter.IsKernelTraced(kMatmul));
+  // names that are not mangled are matched as they are
+  EXPECT_TRUE(filter.IsKernelTraced("vector_add"));
+  // the result is cached per name
+  EXPECT_TRUE(filter.IsKernelTraced(kVectorAdd));
+  EXPECT_FALSE(filter.IsKernelTraced(kMatmul));
+}
+
+TEST_F(KernelFilterTest, ExcludeAppliesAfterInclude) {
+  setenv("UNITRACE_IncludeKernels", "float", 1);
+  setenv("UNITRACE_ExcludeKernels", "const", 1);
+  ZeKernelFilter filter;
+  EXPECT_TRUE(filter.IsKernelTraced(kVectorAdd));
+  EXPECT_FALSE(filter.IsKernelTraced(kMatmul));
+  EXPECT_FALSE(filter.IsKernelTraced("copy_kernel"));
+}
+
+TEST_F(KernelFilterTest, LaunchRangeIsInclusive) {
+  setenv("UNITRACE_KernelLaunchRange", "2:4", 1);
+  ZeKernelFilter filter;
+  EXPECT_TRUE(filter.IsActive());
+  // the name filters are not set, so every kernel is selected by name
+  EXPECT_TRUE(filter.IsKernelTraced(kMatmul));
+  EXPECT_EQ(TraceLaunches(filter, 7), std::vector<bool>({false, false, true, true, true, false, false}));
+}
+
+TEST_F(KernelFilterTest, LaunchRangeWithOpenEnds) {
+  setenv("UNITRACE_KernelLaunchRange", "3:", 1);
+  ZeKernelFilter from;
+  EXPECT_EQ(TraceLaunches(from, 5), std::vector<bool>({false, false, false, true, true}));
+
+  setenv("UNITRACE_KernelLaunchRange", ":1", 1);
+  ZeKernelFilter to;
+  EXPECT_EQ(TraceLaunches(to, 4), std::vector<bool>({true, true, false, false}));
+}
+
+// launches are numbered by the calls to IsLaunchTraced only, the collector makes the call for
+// launches of selected kernels while collection is enabled
+TEST_F(KernelFilterTest, LaunchesNumberedOnlyWhenCounted) {
+  setenv("UNITRACE_IncludeKernels", "vector_add", 1);
+  setenv("UNITRACE_KernelLaunchRange", "1:1", 1);
+  ZeKernelFilter filter;
+  std::vector<bool> traced;
+  for (const char* name : {kMatmul, kVectorAdd, kMatmul, kVectorAdd, kVectorAdd}) {
+    traced.push_back(filter.IsKernelTraced(name) && filter.IsLaunchTraced());
+  }
+  EXPECT_EQ(traced, std::vector<bool>({false, false, false, true, false}));
+}
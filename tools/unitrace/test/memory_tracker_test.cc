@@ -0,0 +1,168 @@
+//==============================================================
+// Copyright (C) Intel Corporation
+//
+// SPDX-License-Identifier: MIT
+// =============================================================
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <map>
+
+#include "ze_memory_tracker.h"
+
+// addresses and devices are made up, the tracker never dereferences them
+
+namespace {
+
+const ze_device_handle_t kDevice0 = reinterpret_cast<ze_device_handle_t>(0x1000);
+const ze_device_handle_t kDevice1 = reinterpret_cast<ze_device_handle_t>(0x2000);
+
+const void* Address(uint64_t addr) {
+  return reinterpret_cast<const void*>(addr);
+}
+
+ZeMemoryAllocation MakeAllocation(size_t size, ze_device_handle_t device = kDevice0,
+                                  ze_memory_type_t type = ZE_MEMORY_TYPE_DEVICE) {
+  ZeMemoryAllocation alloc{};
+  alloc.size_ = size;
+  alloc.device_ = device;
+  alloc.type_ = type;
+  alloc.api_id_ = InitTracingId;
+  return alloc;
+}
+
+struct UsageCounts {
+  uint64_t live;
+  uint64_t peak;
+  uint64_t total;
+  uint64_t alloc_count;
+  uint64_t free_count;
+};
+
+UsageCounts GetUsage(ZeMemoryTracker& tracker, ze_device_handle_t device, ze_memory_type_t type) {
+  UsageCounts counts{};
+  tracker.ForEachUsage([&](const ZeMemoryUsageKey& key, const ZeMemoryUsage& usage) {
+    if ((key.device_ == device) && (key.type_ == type)) {
+      counts = {usage.live_.load(), usage.peak_.load(), usage.total_.load(),
+                usage.alloc_count_.load(), usage.free_count_.load()};
+    }
+  });
+  return counts;
+}
+
+std::map<const void*, size_t> GetAllocations(ZeMemoryTracker& tracker) {
+  std::map<const void*, size_t> allocations;
+  tracker.ForEachAllocation([&allocations](const void* ptr, const ZeMemoryAllocation& alloc) {
+    allocations[ptr] = alloc.size_;
+  });
+  return allocations;
+}
+
+}  // namespace
+
+TEST(MemoryTrackerTest, AllocAndFreeAccounting) {
+  ZeMemoryTracker tracker;
+  EXPECT_EQ(tracker.Allocate(Address(0x10000), MakeAllocation(100)), 100u);
+  EXPECT_EQ(tracker.Allocate(Address(0x20000), MakeAllocation(50)), 150u);
+
+  uint64_t id = tracker.GetId(Address(0x10000));
+  ASSERT_NE(id, 0u);
+  ZeMemoryAllocation freed{};
+  uint64_t live = 0;
+  ASSERT_TRUE(tracker.Free(Address(0x10000), id, freed, live));
+  EXPECT_EQ(freed.size_, 100u);
+  EXPECT_EQ(live, 50u);
+
+  UsageCounts usage = GetUsage(tracker, kDevice0, ZE_MEMORY_TYPE_DEVICE);
+  EXPECT_EQ(usage.live, 50u);
+  EXPECT_EQ(usage.total, 150u);
+  EXPECT_EQ(usage.alloc_count, 2u);
+  EXPECT_EQ(usage.free_count, 1u);
+  EXPECT_EQ(GetAllocations(tracker), (std::map<const void*, size_t>{{Address(0x20000), 50}}));
+  // freed memory is not tracked anymore
+  EXPECT_EQ(tracker.GetId(Address(0x10000)), 0u);
+}
+
+TEST(MemoryTrackerTest, PeakIsHighestLiveBytes) {
+  ZeMemoryTracker tracker;
+  tracker.Allocate(Address(0x10000), MakeAllocation(300));
+  tracker.Allocate(Address(0x20000), MakeAllocation(200));
+  ZeMemoryAllocation freed{};
+  uint64_t live = 0;
+  ASSERT_TRUE(tracker.Free(Address(0x10000), tracker.GetId(Address(0x10000)), freed, live));
+  tracker.Allocate(Address(0x30000), MakeAllocation(100));
+
+  UsageCounts usage = GetUsage(tracker, kDevice0, ZE_MEMORY_TYPE_DEVICE);
+  EXPECT_EQ(usage.live, 300u);
+  EXPECT_EQ(usage.peak, 500u);
+}
+
+TEST(MemoryTrackerTest, FailedFreeKeepsAllocation) {
+  ZeMemoryTracker tracker;
+  tracker.Allocate(Address(0x10000), MakeAllocation(100));
+  uint64_t id = tracker.GetId(Address(0x10000));
+
+  ZeMemoryAllocation freed{};
+  uint64_t live = 0;
+  // wrong id, then memory that is not tracked
+  EXPECT_FALSE(tracker.Free(Address(0x10000), id + 1, freed, live));
+  EXPECT_FALSE(tracker.Free(Address(0x20000), id, freed, live));
+
+  UsageCounts usage = GetUsage(tracker, kDevice0, ZE_MEMORY_TYPE_DEVICE);
+  EXPECT_EQ(usage.live, 100u);
+  EXPECT_EQ(usage.free_count, 0u);
+  EXPECT_EQ(tracker.GetId(Address(0x10000)), id);
+  EXPECT_EQ(GetAllocations(tracker).size(), 1u);
+}
+
+// the id of the allocation is taken when zeMemFree is entered, the driver can hand the address
+// out again before the exit callback
+TEST(MemoryTrackerTest, ReusedAddressSupersedesStaleId) {
+  ZeMemoryTracker tracker;
+  tracker.Allocate(Address(0x10000), MakeAllocation(100));
+  uint64_t stale_id = tracker.GetId(Address(0x10000));
+  EXPECT_EQ(tracker.Allocate(Address(0x10000), MakeAllocation(40)), 40u);
+  uint64_t id = tracker.GetId(Address(0x10000));
+  EXPECT_NE(id, stale_id);
+
+  // the allocation superseded is accounted as freed
+  UsageCounts usage = GetUsage(tracker, kDevice0, ZE_MEMORY_TYPE_DEVICE);
+  EXPECT_EQ(usage.live, 40u);
+  EXPECT_EQ(usage.free_count, 1u);
+
+  ZeMemoryAllocation freed{};
+  uint64_t live = 0;
+  EXPECT_FALSE(tracker.Free(Address(0x10000), stale_id, freed, live));
+  EXPECT_EQ(GetUsage(tracker, kDevice0, ZE_MEMORY_TYPE_DEVICE).live, 40u);
+  ASSERT_TRUE(tracker.Free(Address(0x10000), id, freed, live));
+  EXPECT_EQ(freed.size_, 40u);
+  EXPECT_EQ(live, 0u);
+}
+
+TEST(MemoryTrackerTest, LiveBytesPerDeviceAndType) {
+  ZeMemoryTracker tracker;
+  EXPECT_EQ(tracker.Allocate(Address(0x10000), MakeAllocation(100, kDevice0, ZE_MEMORY_TYPE_DEVICE)), 100u);
+  EXPECT_EQ(tracker.Allocate(Address(0x20000), MakeAllocation(200, kDevice0, ZE_MEMORY_TYPE_SHARED)), 200u);
+  EXPECT_EQ(tracker.Allocate(Address(0x30000), MakeAllocation(300, kDevice1, ZE_MEMORY_TYPE_DEVICE)), 300u);
+  EXPECT_EQ(tracker.Allocate(Address(0x40000), MakeAllocation(400, nullptr, ZE_MEMORY_TYPE_HOST)), 400u);
+  EXPECT_EQ(tracker.Allocate(Address(0x50000), MakeAllocation(10, kDevice0, ZE_MEMORY_TYPE_DEVICE)), 110u);
+
+  EXPECT_EQ(GetUsage(tracker, kDevice0, ZE_MEMORY_TYPE_DEVICE).live, 110u);
+  EXPECT_EQ(GetUsage(tracker, kDevice0, ZE_MEMORY_TYPE_SHARED).live, 200u);
+  EXPECT_EQ(GetUsage(tracker, kDevice1, ZE_MEMORY_TYPE_DEVICE).live, 300u);
+  EXPECT_EQ(GetUsage(tracker, nullptr, ZE_MEMORY_TYPE_HOST).live, 400u);
+  EXPECT_EQ(GetAllocations(tracker).size(), 5u);
+}
+
+TEST(MemoryTrackerTest, LiveAllocationsAreTraceMemory) {
+  uint64_t used = UniMemory::TraceMemory::GetUsed();
+  {
+    ZeMemoryTracker tracker;
+    for (uint64_t i = 1; i <= 100; i++) {
+      tracker.Allocate(Address(i << 12), MakeAllocation(100));
+    }
+    EXPECT_GE(UniMemory::TraceMemory::GetUsed(), used + 100 * sizeof(ZeMemoryAllocation));
+  }
+  EXPECT_EQ(UniMemory::TraceMemory::GetUsed(), used);
+}
@@ -0,0 +1,249 @@
+//==============================================================
+// Copyright (C) Intel Corporation
+//
+// SPDX-License-Identifier: MIT
+// =============================================================
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "ze_metric_query_cache.h"
+
+// mock zet metric query functions, the cache calls them directly as the collector does with the loader
+
+namespace {
+
+constexpr uint32_t kMaxQueries = 1 << 16;
+
+std::atomic<uint32_t> pool_create_calls{0};
+std::atomic<uint32_t> pool_destroy_calls{0};
+std::atomic<uint32_t> query_create_calls{0};
+std::atomic<uint32_t> query_destroy_calls{0};
+std::atomic<bool> query_in_use[kMaxQueries];
+
+uint32_t QueryIndex(zet_metric_query_handle_t query) {
+  return static_cast<uint32_t>(reinterpret_cast<uintptr_t>(query));
+}
+
+void ResetMockCounters() {
+  pool_create_calls = 0;
+  pool_destroy_calls = 0;
+  query_create_calls = 0;
+  query_destroy_calls = 0;
+  for (auto& in_use : query_in_use) {
+    in_use = false;
+  }
+}
+
+}  // namespace
+
+ze_result_t ZE_APICALL zetMetricQueryPoolCreate(ze_context_handle_t /*context*/, ze_device_handle_t /*device*/,
+                                                zet_metric_group_handle_t /*group*/,
+                                                const zet_metric_query_pool_desc_t* desc,
+                                                zet_metric_query_pool_handle_t* pool) {
+  EXPECT_EQ(desc->count, ZeMetricQueryPools::pool_size_);
+  *pool = reinterpret_cast<zet_metric_query_pool_handle_t>(static_cast<uintptr_t>(++pool_create_calls));
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t ZE_APICALL zetMetricQueryPoolDestroy(zet_metric_query_pool_handle_t /*pool*/) {
+  ++pool_destroy_calls;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t ZE_APICALL zetMetricQueryCreate(zet_metric_query_pool_handle_t /*pool*/, uint32_t /*index*/,
+                                            zet_metric_query_handle_t* query) {
+  uint32_t index = ++query_create_calls;
+  if (index >= kMaxQueries) {
+    return ZE_RESULT_ERROR_UNKNOWN;
+  }
+  *query = reinterpret_cast<zet_metric_query_handle_t>(static_cast<uintptr_t>(index));
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t ZE_APICALL zetMetricQueryDestroy(zet_metric_query_handle_t /*query*/) {
+  ++query_destroy_calls;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t ZE_APICALL zetMetricQueryReset(zet_metric_query_handle_t /*query*/) {
+  return ZE_RESULT_SUCCESS;
+}
+
+namespace {
+
+const auto kContext = reinterpret_cast<ze_context_handle_t>(0x10);
+const auto kDevice = reinterpret_cast<ze_device_handle_t>(0x20);
+const auto kGroup = reinterpret_cast<zet_metric_group_handle_t>(0x30);
+
+// every thread keeps up to in_flight queries outstanding, as a thread appending kernels
+// faster than they complete does, and checks that no query is handed out twice
+template <typename GetQuery, typename PutQuery>
+double RunThreads(uint32_t num_threads, uint32_t iterations, uint32_t in_flight,
+                  GetQuery&& get_query, PutQuery&& put_query, bool& unique) {
+  std::atomic<bool> start{false};
+  std::atomic<bool> duplicate{false};
+  std::vector<std::thread> threads;
+  for (uint32_t t = 0; t < num_threads; t++) {
+    threads.emplace_back([&]() {
+      ZeMetricQueryCache cache;
+      std::vector<ZeMetricQuery*> outstanding;
+      outstanding.reserve(in_flight);
+      while (!start.load(std::memory_order_acquire)) {
+      }
+      for (uint32_t i = 0; i < iterations; i++) {
+        ZeMetricQuery* query = get_query(cache);
+        if (query_in_use[QueryIndex(query->query_)].exchange(true)) {
+          duplicate = true;
+        }
+        outstanding.push_back(query);
+        if (outstanding.size() == in_flight) {
+          for (auto q : outstanding) {
+            query_in_use[QueryIndex(q->query_)] = false;
+            ZeMetricQueryPools::ResetQuery(q);
+            put_query(cache, q);
+          }
+          outstanding.clear();
+        }
+      }
+      for (auto q : outstanding) {
+        query_in_use[QueryIndex(q->query_)] = false;
+        put_query(cache, q);
+      }
+      cache.Flush();
+    });
+  }
+
+  auto begin = std::chrono::steady_clock::now();
+  start.store(true, std::memory_order_release);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  auto end = std::chrono::steady_clock::now();
+
+  unique = !duplicate;
+  return std::chrono::duration<double, std::nano>(end - begin).count() /
+         (static_cast<double>(num_threads) * iterations);
+}
+
+}  // namespace
+
+class MetricQueryCacheTest : public ::testing::Test {
+ protected:
+  void SetUp() override { ResetMockCounters(); }
+};
+
+TEST_F(MetricQueryCacheTest, ReusesQueriesWithinThread) {
+  {
+    ZeMetricQueryPools pools;
+    ZeMetricQueryCache cache;
+    for (int i = 0; i < 10000; i++) {
+      ZeMetricQuery* query = cache.GetQuery(pools, kContext, kDevice, kGroup);
+      ASSERT_NE(query, nullptr);
+      EXPECT_EQ(query->pools_, &pools);
+      cache.PutQuery(query);
+    }
+    EXPECT_EQ(pool_create_calls, 1u);
+    EXPECT_EQ(query_create_calls, ZeMetricQueryPools::pool_size_);
+    cache.Flush();
+  }
+  EXPECT_EQ(pool_destroy_calls, 1u);
+  EXPECT_EQ(query_destroy_calls, ZeMetricQueryPools::pool_size_);
+}
+
+TEST_F(MetricQueryCacheTest, ReturnsSurplusToSharedPools) {
+  ZeMetricQueryPools pools;
+  ZeMetricQueryCache producer;
+  ZeMetricQueryCache consumer;
+
+  // queries taken on one thread and completed on another end up in the other thread's cache
+  std::vector<ZeMetricQuery*> queries;
+  for (uint32_t i = 0; i < ZeMetricQueryPools::pool_size_; i++) {
+    queries.push_back(producer.GetQuery(pools, kContext, kDevice, kGroup));
+  }
+  for (auto query : queries) {
+    consumer.PutQuery(query);
+  }
+
+  // the consumer keeps at most 2 batches, so the producer gets the rest without a new pool
+  for (uint32_t i = 0; i < ZeMetricQueryCache::batch_size_; i++) {
+    producer.PutQuery(producer.GetQuery(pools, kContext, kDevice, kGroup));
+  }
+  EXPECT_EQ(pool_create_calls, 1u);
+
+  producer.Flush();
+  consumer.Flush();
+}
+
+TEST_F(MetricQueryCacheTest, ConcurrentThreadsShareQueriesSafely) {
+  constexpr uint32_t kThreads = 8;
+  constexpr uint32_t kIterations = 20000;
+  constexpr uint32_t kInFlight = 48;
+
+  ZeMetricQueryPools pools;
+  bool unique = false;
+  RunThreads(
+      kThreads, kIterations, kInFlight,
+      [&](ZeMetricQueryCache& cache) { return cache.GetQuery(pools, kContext, kDevice, kGroup); },
+      [&](ZeMetricQueryCache& cache, ZeMetricQuery* query) { cache.PutQuery(query); }, unique);
+  EXPECT_TRUE(unique);
+
+  // each thread holds at most kInFlight queries plus 2 cached batches
+  uint32_t bound = kThreads * (kInFlight + 2 * ZeMetricQueryCache::batch_size_);
+  EXPECT_LE(query_create_calls, bound + ZeMetricQueryPools::pool_size_);
+
+  // all queries are back in the shared pools after the threads flush their caches
+  std::vector<ZeMetricQuery*> all;
+  pools.GetQueries({kContext, kDevice, kGroup}, all, kMaxQueries);
+  EXPECT_EQ(all.size(), query_create_calls.load());
+  pools.PutQueries({kContext, kDevice, kGroup}, all, all.size());
+}
+
+// not a pass/fail check on timing, prints the per-query cost of taking the shared pool lock
+// for every query against the per-thread cache
+TEST_F(MetricQueryCacheTest, MicroBenchmark) {
+  constexpr uint32_t kIterations = 200000;
+  constexpr uint32_t kInFlight = 16;
+  const ZeMetricQueryPoolKey key = {kContext, kDevice, kGroup};
+
+  for (uint32_t num_threads : {1u, 2u, 4u, 8u}) {
+    ZeMetricQueryPools pools;
+    bool unique = false;
+
+    double shared = RunThreads(
+        num_threads, kIterations, kInFlight,
+        [&](ZeMetricQueryCache& /*cache*/) {
+          thread_local std::vector<ZeMetricQuery*> one;
+          pools.GetQueries(key, one, 1);
+          ZeMetricQuery* query = one.back();
+          one.pop_back();
+          return query;
+        },
+        [&](ZeMetricQueryCache& /*cache*/, ZeMetricQuery* query) {
+          thread_local std::vector<ZeMetricQuery*> one;
+          one.push_back(query);
+          pools.PutQueries(key, one, 1);
+        },
+        unique);
+    EXPECT_TRUE(unique);
+
+    double cached = RunThreads(
+        num_threads, kIterations, kInFlight,
+        [&](ZeMetricQueryCache& cache) { return cache.GetQuery(pools, kContext, kDevice, kGroup); },
+        [&](ZeMetricQueryCache& cache, ZeMetricQuery* query) { cache.PutQuery(query); }, unique);
+    EXPECT_TRUE(unique);
+
+    std::cout << "[ INFO     ] " << num_threads << " thread(s): shared pool " << shared
+              << " ns/query, per-thread cache " << cached << " ns/query" << std::endl;
+    RecordProperty("threads_" + std::to_string(num_threads) + "_shared_ns",
+                   std::to_string(shared));
+    RecordProperty("threads_" + std::to_string(num_threads) + "_cached_ns",
+                   std::to_string(cached));
+  }
+}
@@ -0,0 +1,134 @@
+//==============================================================
+// Copyright (C) Intel Corporation
+//
+// SPDX-License-Identifier: MIT
+// =============================================================
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+#include "ze_metric_stats.h"
+
+TEST(MetricQueryRawSamplesTest, ParsesValidNumbers) {
+  EXPECT_EQ(ParseMetricQueryRawSamples("0"), 0);
+  EXPECT_EQ(ParseMetricQueryRawSamples("16"), 16);
+  EXPECT_EQ(ParseMetricQueryRawSamples("-1"), -1);
+}
+
+TEST(MetricQueryRawSamplesTest, FallsBackToDefaultOnBadInput) {
+  EXPECT_EQ(ParseMetricQueryRawSamples(""), kDefaultMetricQueryRawSamples);
+  EXPECT_EQ(ParseMetricQueryRawSamples("all"), kDefaultMetricQueryRawSamples);
+  EXPECT_EQ(ParseMetricQueryRawSamples("12x"), kDefaultMetricQueryRawSamples);
+  EXPECT_EQ(ParseMetricQueryRawSamples("-2"), kDefaultMetricQueryRawSamples);
+  EXPECT_EQ(ParseMetricQueryRawSamples("99999999999999999999999"), kDefaultMetricQueryRawSamples);
+}
+
+TEST(MetricQueryRawSamplesTest, KeepsOnlyFirstInstancesByDefault) {
+  ZeKernelMetricStats stats;
+  EXPECT_TRUE(TakeKernelMetricRawSample(stats, kDefaultMetricQueryRawSamples));
+  EXPECT_FALSE(TakeKernelMetricRawSample(stats, kDefaultMetricQueryRawSamples));
+  EXPECT_EQ(stats.raw_samples_, 1u);
+
+  ZeKernelMetricStats none;
+  EXPECT_FALSE(TakeKernelMetricRawSample(none, 0));
+
+  ZeKernelMetricStats all;
+  for (int i = 0; i < 1000; i++) {
+    EXPECT_TRUE(TakeKernelMetricRawSample(all, -1));
+  }
+  EXPECT_EQ(all.raw_samples_, 1000u);
+}
+
+TEST(KernelMetricStatsTest, TracksSumMinMax) {
+  std::minstd_rand rng;
+  ZeKernelMetricStats stats;
+  AddKernelMetricSample(stats, {1.0, 10.0}, rng);
+  AddKernelMetricSample(stats, {3.0, 5.0}, rng);
+  AddKernelMetricSample(stats, {2.0, 20.0}, rng);
+
+  EXPECT_EQ(stats.call_count_, 3u);
+  EXPECT_EQ(stats.sum_, (std::vector<double>{6.0, 35.0}));
+  EXPECT_EQ(stats.min_, (std::vector<double>{1.0, 5.0}));
+  EXPECT_EQ(stats.max_, (std::vector<double>{3.0, 20.0}));
+  EXPECT_EQ(stats.reservoir_.size(), 3u);
+}
+
+TEST(KernelMetricStatsTest, ReservoirIsBounded) {
+  std::minstd_rand rng;
+  ZeKernelMetricStats stats;
+  for (int i = 0; i < 10000; i++) {
+    AddKernelMetricSample(stats, {static_cast<double>(i)}, rng);
+  }
+
+  EXPECT_EQ(stats.call_count_, 10000u);
+  EXPECT_EQ(stats.reservoir_.size(), kMetricReservoirSize);
+  EXPECT_EQ(stats.min_[0], 0.0);
+  EXPECT_EQ(stats.max_[0], 9999.0);
+}
+
+TEST(KernelMetricStatsTest, MergeCombinesThreadStats) {
+  std::minstd_rand rng;
+  ZeKernelMetricStats a;
+  ZeKernelMetricStats b;
+  for (int i = 0; i < 1000; i++) {
+    AddKernelMetricSample(a, {1.0}, rng);
+    AddKernelMetricSample(b, {3.0}, rng);
+  }
+  a.raw_samples_ = 1;
+  b.raw_samples_ = 1;
+  // b ran three times as many instances, so it should own about three quarters of the reservoir
+  for (int i = 0; i < 2000; i++) {
+    AddKernelMetricSample(b, {3.0}, rng);
+  }
+
+  ZeKernelMetricStats merged;
+  MergeKernelMetricStats(merged, a, rng);
+  MergeKernelMetricStats(merged, b, rng);
+
+  EXPECT_EQ(merged.call_count_, 4000u);
+  EXPECT_EQ(merged.raw_samples_, 2u);
+  EXPECT_EQ(merged.sum_[0], 1000.0 + 9000.0);
+  EXPECT_EQ(merged.min_[0], 1.0);
+  EXPECT_EQ(merged.max_[0], 3.0);
+  ASSERT_EQ(merged.reservoir_.size(), kMetricReservoirSize);
+
+  size_t from_b = 0;
+  for (const auto& row : merged.reservoir_) {
+    if (row[0] == 3.0) {
+      from_b++;
+    }
+  }
+  EXPECT_GT(from_b, kMetricReservoirSize / 2);
+  EXPECT_LT(from_b, kMetricReservoirSize);
+}
+
+TEST(KernelMetricStatsTest, MergeKeepsStatsOfOtherMetrics) {
+  std::minstd_rand rng;
+  ZeKernelMetricStats merged;
+  ZeKernelMetricStats other;
+  AddKernelMetricSample(merged, {1.0, 2.0}, rng);
+  AddKernelMetricSample(other, {5.0}, rng);
+  AddKernelMetricSample(other, {7.0}, rng);
+
+  EXPECT_FALSE(MergeKernelMetricStats(merged, other, rng));
+  EXPECT_EQ(merged.call_count_, 1u);
+  EXPECT_EQ(merged.sum_, (std::vector<double>{1.0, 2.0}));
+  EXPECT_EQ(other.call_count_, 2u);
+  EXPECT_EQ(other.sum_, (std::vector<double>{12.0}));
+}
+
+TEST(KernelMetricStatsTest, NearestRankPercentile) {
+  std::vector<double> values;
+  for (int i = 100; i >= 1; i--) {
+    values.push_back(static_cast<double>(i));
+  }
+  EXPECT_EQ(GetMetricPercentile(values, 50), 50.0);
+  EXPECT_EQ(GetMetricPercentile(values, 90), 90.0);
+  EXPECT_EQ(GetMetricPercentile(values, 99), 99.0);
+
+  std::vector<double> single = {7.0};
+  EXPECT_EQ(GetMetricPercentile(single, 0), 7.0);
+  EXPECT_EQ(GetMetricPercentile(single, 99), 7.0);
+}
@@ -0,0 +1,180 @@
+//==============================================================
+// Copyright (C) Intel Corporation
+//
+// SPDX-License-Identifier: MIT
+// =============================================================
+
+#include <gtest/gtest.h>
+
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+
+#include "perfetto_writer.h"
+
+// the trace is decoded with protoc and the subset of the Perfetto trace protos in perfetto_protos,
+// the test is skipped where protoc is not found
+
+namespace {
+
+class PerfettoWriterTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+#ifndef PROTOC_EXECUTABLE
+    GTEST_SKIP() << "protoc not found";
+#endif
+    trace_file_ = "perfetto_writer_test." + std::to_string(getpid()) + ".pftrace";
+  }
+
+  void TearDown() override {
+    if (!trace_file_.empty()) {
+      std::remove(trace_file_.c_str());
+    }
+  }
+
+  // text format of the trace, empty if protoc fails to decode it
+  std::string Decode() {
+    std::string text;
+#ifdef PROTOC_EXECUTABLE
+    std::string command = std::string(PROTOC_EXECUTABLE) + " --proto_path=" + PERFETTO_PROTO_PATH +
+                          " --decode=perfetto.protos.Trace trace_subset.proto < " + trace_file_;
+    FILE* pipe = popen(command.c_str(), "r");
+    if (pipe == nullptr) {
+      return text;
+    }
+    char buffer[4096];
+    size_t size = 0;
+    while ((size = fread(buffer, 1, sizeof(buffer), pipe)) > 0) {
+      text.append(buffer, size);
+    }
+    if (pclose(pipe) != 0) {
+      text.clear();
+    }
+#endif
+    return text;
+  }
+
+  // protoc prints fields missing from the protos by number
+  static bool HasUnknownFields(const std::string& text) {
+    std::istringstream lines(text);
+    std::string line;
+    while (std::getline(lines, line)) {
+      size_t pos = line.find_first_not_of(' ');
+      if (pos != std::string::npos && std::isdigit(static_cast<unsigned char>(line[pos]))) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  static bool Contains(const std::string& text, const std::string& value) {
+    return text.find(value) != std::string::npos;
+  }
+
+  // text of the first packet with the value, packets are closed at the start of a line
+  static std::string GetPacket(const std::string& text, const std::string& value) {
+    size_t pos = text.find(value);
+    if (pos == std::string::npos) {
+      return std::string();
+    }
+    size_t start = text.rfind("packet {", pos);
+    size_t end = text.find("\n}", pos);
+    return text.substr(start, end - start);
+  }
+
+  std::string trace_file_;
+};
+
+}  // namespace
+
+TEST_F(PerfettoWriterTest, DecodesWithTraceProtos) {
+  {
+    PerfettoWriter writer(trace_file_, perfetto_proto::kBuiltinClockRealtime);
+    uint64_t process = writer.AddProcessTrack(100, "HOST<app>");
+    uint64_t thread = writer.AddThreadTrack(100, 101);
+    uint64_t device = writer.AddTrack("DEVICE<0>");
+    uint64_t engine = writer.AddTrack("L0 Engine<0,0>", device);
+    uint64_t counter = writer.AddCounterTrack("Live Memory", process);
+
+    writer.AddSlice(thread, "cpu_op", "zeCommandListAppendLaunchKernel", 1000, 2000, {{"id", "7"}});
+    writer.AddFlow(thread, "Flow_H2D", 1000, 42, false);
+    writer.BeginSlice(thread, "cpu_op", "region", 2100);
+    writer.EndSlice(thread, 2200);
+    writer.AddSlice(engine, "gpu_op", "kernel", 2500, 3000);
+    writer.AddFlow(engine, "Flow_H2D", 2500, 42, true);
+    writer.AddCounterValue(counter, 1500, 4096);
+    writer.AddCounterValue(counter, 1600, -5);
+    writer.AddInstant(thread, "cpu_op", "sample", 1700, {{"stack", "main;work"}});
+  }
+
+  std::string text = Decode();
+  ASSERT_FALSE(text.empty());
+  EXPECT_FALSE(HasUnknownFields(text));
+  EXPECT_TRUE(Contains(text, "process_name: \"HOST<app>\""));
+  EXPECT_TRUE(Contains(text, "name: \"L0 Engine<0,0>\""));
+  EXPECT_TRUE(Contains(text, "name: \"zeCommandListAppendLaunchKernel\""));
+  EXPECT_TRUE(Contains(text, "terminating_flow_ids: 42"));
+  EXPECT_TRUE(Contains(text, "counter_value: -5"));
+}
+
+TEST_F(PerfettoWriterTest, EventsOnClockOfTheTool) {
+  {
+    PerfettoWriter writer(trace_file_, perfetto_proto::kBuiltinClockMonotonicRaw);
+    writer.AddSlice(writer.AddThreadTrack(100, 101), "cpu_op", "api", 1000, 2000);
+  }
+
+  std::string text = Decode();
+  ASSERT_FALSE(text.empty());
+  EXPECT_TRUE(Contains(text, "clock_id: 4\n"));
+  EXPECT_TRUE(Contains(text, "primary_trace_clock: 4\n"));
+  // BOOTTIME
+  EXPECT_FALSE(Contains(text, "clock_id: 6\n"));
+}
+
+TEST_F(PerfettoWriterTest, TimestampsKeepNsPrecision) {
+  {
+    PerfettoWriter writer(trace_file_, perfetto_proto::kBuiltinClockRealtime);
+    writer.AddSlice(writer.AddThreadTrack(100, 101), "cpu_op", "api", 1700000000000000123ULL,
+                    1700000000000000456ULL);
+  }
+
+  std::string text = Decode();
+  ASSERT_FALSE(text.empty());
+  // the incremental clock starts at the slice begin, the end is a delta from it
+  EXPECT_TRUE(Contains(text, "timestamp: 1700000000000000123\n"));
+  EXPECT_TRUE(Contains(text, "timestamp: 0\n"));
+  EXPECT_TRUE(Contains(text, "timestamp: 333\n"));
+}
+
+TEST_F(PerfettoWriterTest, EarlierEventHasAbsoluteTimestamp) {
+  {
+    PerfettoWriter writer(trace_file_, perfetto_proto::kBuiltinClockMonotonicRaw);
+    uint64_t thread = writer.AddThreadTrack(100, 101);
+    writer.AddInstant(thread, "cpu_op", "later", 5000);
+    writer.AddInstant(thread, "cpu_op", "earlier", 4000);
+  }
+
+  std::string text = Decode();
+  ASSERT_FALSE(text.empty());
+  EXPECT_FALSE(Contains(GetPacket(text, "name: \"later\""), "timestamp_clock_id"));
+  EXPECT_TRUE(Contains(GetPacket(text, "name: \"earlier\""), "timestamp_clock_id: 4"));
+}
+
+TEST_F(PerfettoWriterTest, ClockSnapshotAnchorsClocks) {
+  {
+    PerfettoWriter writer(trace_file_, perfetto_proto::kBuiltinClockMonotonicRaw);
+    writer.AddClockSnapshot({{perfetto_proto::kBuiltinClockMonotonicRaw, 1000},
+                             {perfetto_proto::kBuiltinClockMonotonic, 2000},
+                             {perfetto_proto::kBuiltinClockRealtime, 3000}});
+  }
+
+  std::string text = Decode();
+  ASSERT_FALSE(text.empty());
+  EXPECT_TRUE(Contains(text, "clock_id: 4\n      timestamp: 1000\n"));
+  EXPECT_TRUE(Contains(text, "clock_id: 3\n      timestamp: 2000\n"));
+  EXPECT_TRUE(Contains(text, "clock_id: 1\n      timestamp: 3000\n"));
+  EXPECT_TRUE(Contains(text, "primary_trace_clock: 4\n"));
+}
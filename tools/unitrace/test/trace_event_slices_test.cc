@@ -0,0 +1,143 @@
+//==============================================================
+// Copyright (C) Intel Corporation
+//
+// SPDX-License-Identifier: MIT
+// =============================================================
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "trace_event_slices.h"
+
+// the test runs with UNITRACE_MaxTraceMemory=4K, so buffers of kSliceCapacity events of 64 bytes
+// are refused a slice after kMaxSlices slices
+
+namespace {
+
+struct TestEvent {
+  uint64_t value_;
+  uint64_t padding_[7];
+};
+
+constexpr int32_t kSliceCapacity = 16;	// 1K per slice
+constexpr int32_t kMaxSlices = 4;
+
+// buffers events with consecutive values from next_value, making room by policy when full
+void BufferEvents(TraceEventSlices<TestEvent>& events, uint64_t& next_value, uint64_t count,
+                  std::vector<uint64_t>& flushed) {
+  for (uint64_t i = 0; i < count; i++) {
+    if (events.IsFull()) {
+      events.NextSlice([&flushed](TestEvent& event) { flushed.push_back(event.value_); });
+    }
+    if (!events.IsFull()) {
+      events.GetEvent()->value_ = next_value;
+    }
+    events.BufferEvent();
+    next_value++;
+  }
+}
+
+std::vector<uint64_t> FlushEvents(TraceEventSlices<TestEvent>& events) {
+  std::vector<uint64_t> flushed;
+  events.Flush([&flushed](TestEvent& event) { flushed.push_back(event.value_); });
+  return flushed;
+}
+
+std::vector<uint64_t> Values(uint64_t first, uint64_t count) {
+  std::vector<uint64_t> values;
+  for (uint64_t i = 0; i < count; i++) {
+    values.push_back(first + i);
+  }
+  return values;
+}
+
+class TraceEventSlicesTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_EQ(UniMemory::TraceMemory::GetUsed(), 0u);
+    spilled_ = UniMemory::TraceMemory::GetSpilled();
+    dropped_ = UniMemory::TraceMemory::GetDropped();
+  }
+
+  void TearDown() override {
+    // slices are given back to the budget
+    EXPECT_EQ(UniMemory::TraceMemory::GetUsed(), 0u);
+  }
+
+  uint64_t Spilled() { return UniMemory::TraceMemory::GetSpilled() - spilled_; }
+  uint64_t Dropped() { return UniMemory::TraceMemory::GetDropped() - dropped_; }
+
+  uint64_t spilled_ = 0;
+  uint64_t dropped_ = 0;
+};
+
+}  // namespace
+
+TEST_F(TraceEventSlicesTest, GrowsWithinBudget) {
+  TraceEventSlices<TestEvent> events(kSliceCapacity, UniMemory::TRACE_MEMORY_POLICY_SPILL);
+  uint64_t next_value = 0;
+  std::vector<uint64_t> flushed;
+  BufferEvents(events, next_value, kSliceCapacity * kMaxSlices, flushed);
+
+  EXPECT_TRUE(flushed.empty());
+  EXPECT_EQ(events.GetSliceCount(), kMaxSlices);
+  EXPECT_EQ(UniMemory::TraceMemory::GetUsed(), sizeof(TestEvent) * kSliceCapacity * kMaxSlices);
+  EXPECT_FALSE(UniMemory::TraceMemory::IsDegraded());
+  EXPECT_EQ(FlushEvents(events), Values(0, kSliceCapacity * kMaxSlices));
+}
+
+TEST_F(TraceEventSlicesTest, SpillFlushesAndReusesSlices) {
+  TraceEventSlices<TestEvent> events(kSliceCapacity, UniMemory::TRACE_MEMORY_POLICY_SPILL);
+  uint64_t next_value = 0;
+  std::vector<uint64_t> flushed;
+  BufferEvents(events, next_value, kSliceCapacity * kMaxSlices + 1, flushed);
+
+  // everything buffered is written out before the first event not fitting
+  EXPECT_EQ(flushed, Values(0, kSliceCapacity * kMaxSlices));
+  EXPECT_EQ(Spilled(), uint64_t(kSliceCapacity * kMaxSlices));
+  EXPECT_EQ(Dropped(), 0u);
+
+  // slices are reused and no more are allocated
+  flushed.clear();
+  BufferEvents(events, next_value, kSliceCapacity * kMaxSlices - 1, flushed);
+  EXPECT_TRUE(flushed.empty());
+  EXPECT_EQ(events.GetSliceCount(), kMaxSlices);
+  EXPECT_EQ(FlushEvents(events), Values(kSliceCapacity * kMaxSlices, kSliceCapacity * kMaxSlices));
+}
+
+TEST_F(TraceEventSlicesTest, DropOldestRecyclesOldestSlice) {
+  TraceEventSlices<TestEvent> events(kSliceCapacity, UniMemory::TRACE_MEMORY_POLICY_DROP_OLDEST);
+  uint64_t next_value = 0;
+  std::vector<uint64_t> flushed;
+  BufferEvents(events, next_value, kSliceCapacity * (kMaxSlices + 1) + 1, flushed);
+
+  EXPECT_TRUE(flushed.empty());
+  EXPECT_EQ(Dropped(), uint64_t(2 * kSliceCapacity));
+  EXPECT_EQ(Spilled(), 0u);
+  EXPECT_EQ(events.GetSliceCount(), kMaxSlices);
+  // the newest events are kept, oldest first
+  EXPECT_EQ(FlushEvents(events), Values(2 * kSliceCapacity, kSliceCapacity * (kMaxSlices - 1) + 1));
+}
+
+TEST_F(TraceEventSlicesTest, DropDetailKeepsBufferedEvents) {
+  TraceEventSlices<TestEvent> events(kSliceCapacity, UniMemory::TRACE_MEMORY_POLICY_DROP_DETAIL);
+  uint64_t next_value = 0;
+  std::vector<uint64_t> flushed;
+  BufferEvents(events, next_value, kSliceCapacity * kMaxSlices + 10, flushed);
+
+  EXPECT_TRUE(flushed.empty());
+  EXPECT_TRUE(events.IsFull());
+  EXPECT_EQ(Dropped(), 0u);	// counted by the trace buffer, which drops the event
+  EXPECT_EQ(Spilled(), 0u);
+  EXPECT_EQ(events.GetSliceCount(), kMaxSlices);
+  EXPECT_EQ(FlushEvents(events), Values(0, kSliceCapacity * kMaxSlices));
+}
+
+TEST_F(TraceEventSlicesTest, FirstSliceIsNotRefused) {
+  // over the budget by itself
+  TraceEventSlices<TestEvent> events(kSliceCapacity * (kMaxSlices + 1), UniMemory::TRACE_MEMORY_POLICY_DROP_DETAIL);
+  EXPECT_FALSE(events.IsFull());
+  EXPECT_TRUE(UniMemory::TraceMemory::IsOverBudget());
+}
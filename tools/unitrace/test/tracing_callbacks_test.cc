@@ -0,0 +1,253 @@
+//==============================================================
+// Copyright (C) Intel Corporation
+//
+// SPDX-License-Identifier: MIT
+// =============================================================
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "unicontrol.h"
+#include "unitimer.h"
+
+// tracing.gen is generated from the API excerpts in gen_input and compiled into a stub of the
+// collector, the test runs with UNITRACE_IncludeApis=zeInit,zeEventCreate
+
+#define ZE_APICALL
+
+typedef enum _ze_init_flags_t { ZE_INIT_FLAG_GPU_ONLY = 1 } ze_init_flags_t;
+typedef struct _ze_event_pool_handle_t *ze_event_pool_handle_t;
+typedef struct _ze_event_handle_t *ze_event_handle_t;
+typedef struct _ze_command_list_handle_t *ze_command_list_handle_t;
+typedef struct _ze_kernel_handle_t *ze_kernel_handle_t;
+typedef struct _zel_tracer_handle_t *zel_tracer_handle_t;
+
+struct ze_group_count_t {
+  uint32_t groupCountX;
+  uint32_t groupCountY;
+  uint32_t groupCountZ;
+};
+
+struct ze_event_desc_t {
+  uint32_t stype;
+  const void *pNext;
+  uint32_t index;
+  uint32_t signal;
+  uint32_t wait;
+};
+
+#include "gen_input/level_zero/ze_api.h"
+
+typedef ze_callbacks_t zet_core_callbacks_t;
+
+namespace {
+
+zet_core_callbacks_t prologues;
+zet_core_callbacks_t epilogues;
+
+}  // namespace
+
+ze_result_t zelTracerSetPrologues(zel_tracer_handle_t /* tracer */, zet_core_callbacks_t *callbacks) {
+  prologues = *callbacks;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t zelTracerSetEpilogues(zel_tracer_handle_t /* tracer */, zet_core_callbacks_t *callbacks) {
+  epilogues = *callbacks;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t zelTracerSetEnabled(zel_tracer_handle_t /* tracer */, bool /* enable */) {
+  return ZE_RESULT_SUCCESS;
+}
+
+namespace utils {
+namespace ze {
+std::string GetKernelName(ze_kernel_handle_t /* kernel */, bool /* demangle */) {
+  return "kernel";
+}
+}  // namespace ze
+}  // namespace utils
+
+enum FLOW_DIR {
+  FLOW_NUL = 0,
+  FLOW_D2H = 1,
+  FLOW_H2D = 2,
+};
+
+struct ZeInstanceData {
+  uint64_t start_time_host;
+  uint64_t kid;
+};
+
+thread_local ZeInstanceData ze_instance_data;
+
+struct ZeCollectorOptions {
+  bool api_tracing = false;
+  bool kernel_tracing = false;
+  bool memory_tracking = false;
+  bool call_logging = false;
+  bool host_timing = false;
+  bool need_pid = false;
+  bool need_tid = false;
+  bool demangle = false;
+};
+
+class Correlator {
+ public:
+  void Log(const std::string& str) { log_ += str; }
+  std::string log_;
+};
+
+// the members of the collector the generated callbacks use
+class ZeCollector {
+ public:
+  ZeCollectorOptions options_;
+  Correlator *correlator_ = &correlator;
+  Correlator correlator;
+  std::vector<API_TRACING_ID> host_timed_;
+  std::vector<std::string> kernel_callbacks_;
+  void (*fcallback_)(std::vector<uint64_t> *kids, FLOW_DIR flow_dir, API_TRACING_ID api_id, uint64_t started,
+                     uint64_t ended) = nullptr;
+
+  void CollectHostFunctionTimeStats(API_TRACING_ID id, uint64_t /* time */) { host_timed_.push_back(id); }
+
+  // kernel tracing callbacks, whichever of them the generator finds in ze_collector.h are called
+  static void Record(void *global_data, const char *name) {
+    reinterpret_cast<ZeCollector *>(global_data)->kernel_callbacks_.push_back(name);
+  }
+#define KERNEL_TRACING_CALLBACKS(params_t, name)                                                       \
+  static void OnEnter##name(params_t * /* params */, void *global_data, void ** /* instance_data */) { \
+    Record(global_data, "OnEnter" #name);                                                              \
+  }                                                                                                    \
+  static void OnEnter##name(params_t * /* params */, void *global_data, void ** /* instance_data */,   \
+                            std::vector<uint64_t> * /* kids */) {                                      \
+    Record(global_data, "OnEnter" #name);                                                              \
+  }                                                                                                    \
+  static void OnExit##name(params_t * /* params */, ze_result_t /* result */, void *global_data,       \
+                           void ** /* instance_data */) {                                              \
+    Record(global_data, "OnExit" #name);                                                               \
+  }                                                                                                    \
+  static void OnExit##name(params_t * /* params */, ze_result_t /* result */, void *global_data,       \
+                           void ** /* instance_data */, std::vector<uint64_t> * /* kids */) {          \
+    Record(global_data, "OnExit" #name);                                                               \
+  }
+  KERNEL_TRACING_CALLBACKS(ze_init_params_t, Init)
+  KERNEL_TRACING_CALLBACKS(ze_event_create_params_t, EventCreate)
+  KERNEL_TRACING_CALLBACKS(ze_event_query_status_params_t, EventQueryStatus)
+  KERNEL_TRACING_CALLBACKS(ze_event_host_synchronize_params_t, EventHostSynchronize)
+  KERNEL_TRACING_CALLBACKS(ze_command_list_append_launch_kernel_params_t, CommandListAppendLaunchKernel)
+#undef KERNEL_TRACING_CALLBACKS
+
+#include "tracing.gen"
+};
+
+namespace {
+
+class TracingCallbacksTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    prologues = {};
+    epilogues = {};
+    ze_instance_data = {};
+    ASSERT_TRUE(UniController::IsApiEnabled(InitTracingId));
+    ASSERT_TRUE(UniController::IsApiEnabled(EventCreateTracingId));
+    ASSERT_FALSE(UniController::IsApiEnabled(EventQueryStatusTracingId));
+    ASSERT_FALSE(UniController::IsApiEnabled(EventHostSynchronizeTracingId));
+    ASSERT_FALSE(UniController::IsApiEnabled(CommandListAppendLaunchKernelTracingId));
+  }
+
+  void EnableTracing(bool api_tracing, bool kernel_tracing) {
+    collector_.options_.api_tracing = api_tracing;
+    collector_.options_.kernel_tracing = kernel_tracing;
+    collector_.EnableTracing(nullptr);
+  }
+
+  void *GlobalData() { return &collector_; }
+
+  ZeCollector collector_;
+};
+
+}  // namespace
+
+TEST_F(TracingCallbacksTest, FilteredOutApisAreNotRegistered) {
+  EnableTracing(true, false);
+
+  EXPECT_NE(prologues.Global.pfnInitCb, nullptr);
+  EXPECT_NE(epilogues.Global.pfnInitCb, nullptr);
+  EXPECT_NE(prologues.Event.pfnCreateCb, nullptr);
+  EXPECT_NE(epilogues.Event.pfnCreateCb, nullptr);
+  EXPECT_EQ(prologues.Event.pfnQueryStatusCb, nullptr);
+  EXPECT_EQ(epilogues.Event.pfnHostSynchronizeCb, nullptr);
+  EXPECT_EQ(prologues.CommandList.pfnAppendLaunchKernelCb, nullptr);
+  EXPECT_EQ(epilogues.CommandList.pfnAppendLaunchKernelCb, nullptr);
+}
+
+TEST_F(TracingCallbacksTest, KernelTracingApisAreRegisteredWhenFilteredOut) {
+  EnableTracing(true, true);
+
+  EXPECT_NE(prologues.Global.pfnInitCb, nullptr);
+  EXPECT_NE(prologues.Event.pfnCreateCb, nullptr);
+  EXPECT_NE(prologues.Event.pfnQueryStatusCb, nullptr);
+  EXPECT_NE(epilogues.Event.pfnHostSynchronizeCb, nullptr);
+  EXPECT_NE(prologues.CommandList.pfnAppendLaunchKernelCb, nullptr);
+  EXPECT_NE(epilogues.CommandList.pfnAppendLaunchKernelCb, nullptr);
+}
+
+TEST_F(TracingCallbacksTest, KernelTracingOnlyRegistersKernelTracingApis) {
+  EnableTracing(false, true);
+
+  EXPECT_EQ(prologues.Global.pfnInitCb, nullptr);
+  EXPECT_EQ(prologues.Event.pfnCreateCb, nullptr);
+  EXPECT_NE(prologues.Event.pfnQueryStatusCb, nullptr);
+  EXPECT_NE(epilogues.Event.pfnHostSynchronizeCb, nullptr);
+  EXPECT_NE(prologues.CommandList.pfnAppendLaunchKernelCb, nullptr);
+}
+
+TEST_F(TracingCallbacksTest, FilteredOutApiRunsKernelTracingOnly) {
+  collector_.options_.kernel_tracing = true;
+  collector_.options_.call_logging = true;
+  collector_.options_.host_timing = true;
+
+  ze_command_list_handle_t command_list = nullptr;
+  ze_kernel_handle_t kernel = nullptr;
+  const ze_group_count_t *group_count = nullptr;
+  ze_event_handle_t signal_event = nullptr;
+  uint32_t num_wait_events = 0;
+  ze_event_handle_t *wait_events = nullptr;
+  ze_command_list_append_launch_kernel_params_t params = {&command_list, &kernel, &group_count, &signal_event,
+                                                          &num_wait_events, &wait_events};
+  void *instance_data = nullptr;
+
+  ze_instance_data.start_time_host = 1;
+  ZeCollector::zeCommandListAppendLaunchKernelOnEnter(&params, ZE_RESULT_SUCCESS, GlobalData(), &instance_data);
+  EXPECT_EQ(ze_instance_data.start_time_host, 0u);
+  ZeCollector::zeCommandListAppendLaunchKernelOnExit(&params, ZE_RESULT_SUCCESS, GlobalData(), &instance_data);
+
+  EXPECT_EQ(collector_.kernel_callbacks_, (std::vector<std::string>{"OnEnterCommandListAppendLaunchKernel",
+                                                                    "OnExitCommandListAppendLaunchKernel"}));
+  EXPECT_TRUE(collector_.correlator.log_.empty());
+  EXPECT_TRUE(collector_.host_timed_.empty());
+}
+
+TEST_F(TracingCallbacksTest, EnabledApiIsTimedAndLogged) {
+  collector_.options_.call_logging = true;
+  collector_.options_.host_timing = true;
+
+  ze_init_flags_t flags = ZE_INIT_FLAG_GPU_ONLY;
+  ze_init_params_t params = {&flags};
+  void *instance_data = nullptr;
+
+  ZeCollector::zeInitOnEnter(&params, ZE_RESULT_SUCCESS, GlobalData(), &instance_data);
+  EXPECT_NE(ze_instance_data.start_time_host, 0u);
+  ZeCollector::zeInitOnExit(&params, ZE_RESULT_SUCCESS, GlobalData(), &instance_data);
+
+  EXPECT_EQ(collector_.host_timed_, (std::vector<API_TRACING_ID>{InitTracingId}));
+  EXPECT_NE(collector_.correlator.log_.find(">>>> "), std::string::npos);
+  EXPECT_NE(collector_.correlator.log_.find("<<<< "), std::string::npos);
+  EXPECT_NE(collector_.correlator.log_.find("zeInit"), std::string::npos);
+}
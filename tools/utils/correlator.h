@@ -29,6 +29,7 @@ struct KernelCollectorOptions {
   bool verbose = false;
   bool demangle = false;
   bool kernels_per_tile = false;
+  bool dependency_analysis = false;
 };
 
 class Correlator {
@@ -0,0 +1,515 @@
+//==============================================================
+// Copyright (C) Intel Corporation
+//
+// SPDX-License-Identifier: MIT
+// =============================================================
+
+#ifndef PTI_TOOLS_UTILS_PERFETTO_WRITER_H_
+#define PTI_TOOLS_UTILS_PERFETTO_WRITER_H_
+
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "pti_assert.h"
+
+// Field numbers of the Perfetto trace protos (protos/perfetto/trace)
+namespace perfetto_proto {
+
+constexpr uint32_t kTracePacket = 1;
+
+constexpr uint32_t kPacketClockSnapshot = 6;
+constexpr uint32_t kPacketTimestamp = 8;
+constexpr uint32_t kPacketTrustedPacketSequenceId = 10;
+constexpr uint32_t kPacketTrackEvent = 11;
+constexpr uint32_t kPacketInternedData = 12;
+constexpr uint32_t kPacketSequenceFlags = 13;
+constexpr uint32_t kPacketTimestampClockId = 58;
+constexpr uint32_t kPacketTracePacketDefaults = 59;
+constexpr uint32_t kPacketTrackDescriptor = 60;
+
+constexpr uint32_t kSequenceIncrementalStateCleared = 1;
+constexpr uint32_t kSequenceNeedsIncrementalState = 2;
+
+constexpr uint32_t kDefaultsTimestampClockId = 58;
+
+constexpr uint32_t kClockSnapshotClocks = 1;
+constexpr uint32_t kClockSnapshotPrimaryTraceClock = 2;
+constexpr uint32_t kClockId = 1;
+constexpr uint32_t kClockTimestamp = 2;
+constexpr uint32_t kClockIsIncremental = 3;
+
+constexpr uint32_t kBuiltinClockRealtime = 1;
+constexpr uint32_t kBuiltinClockMonotonic = 3;
+constexpr uint32_t kBuiltinClockMonotonicRaw = 4;
+constexpr uint32_t kIncrementalClock = 64;  // sequence-scoped clock ids are 64..127
+
+constexpr uint32_t kTrackDescriptorUuid = 1;
+constexpr uint32_t kTrackDescriptorName = 2;
+constexpr uint32_t kTrackDescriptorProcess = 3;
+constexpr uint32_t kTrackDescriptorThread = 4;
+constexpr uint32_t kTrackDescriptorParentUuid = 5;
+constexpr uint32_t kTrackDescriptorCounter = 8;
+
+constexpr uint32_t kProcessDescriptorPid = 1;
+constexpr uint32_t kProcessDescriptorProcessName = 6;
+
+constexpr uint32_t kThreadDescriptorPid = 1;
+constexpr uint32_t kThreadDescriptorTid = 2;
+constexpr uint32_t kThreadDescriptorThreadName = 5;
+
+constexpr uint32_t kTrackEventCategoryIids = 3;
+constexpr uint32_t kTrackEventDebugAnnotations = 4;
+constexpr uint32_t kTrackEventType = 9;
+constexpr uint32_t kTrackEventNameIid = 10;
+constexpr uint32_t kTrackEventTrackUuid = 11;
+constexpr uint32_t kTrackEventCounterValue = 30;
+constexpr uint32_t kTrackEventFlowIds = 47;
+constexpr uint32_t kTrackEventTerminatingFlowIds = 48;
+
+constexpr uint32_t kTypeSliceBegin = 1;
+constexpr uint32_t kTypeSliceEnd = 2;
+constexpr uint32_t kTypeInstant = 3;
+constexpr uint32_t kTypeCounter = 4;
+
+constexpr uint32_t kDebugAnnotationNameIid = 1;
+constexpr uint32_t kDebugAnnotationStringValue = 6;
+
+constexpr uint32_t kInternedEventCategories = 1;
+constexpr uint32_t kInternedEventNames = 2;
+constexpr uint32_t kInternedDebugAnnotationNames = 3;
+
+constexpr uint32_t kInternedIid = 1;
+constexpr uint32_t kInternedName = 2;
+
+} // namespace perfetto_proto
+
+// Protobuf message encoder, fields are serialized in the order they are added
+class ProtoMessage {
+ public:
+  void AddVarInt(uint32_t field, uint64_t value) {
+    AddTag(field, kWireVarInt);
+    AddRawVarInt(value);
+  }
+
+  void AddFixed64(uint32_t field, uint64_t value) {
+    AddTag(field, kWireFixed64);
+    for (int i = 0; i < 8; ++i) {
+      data_.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+  }
+
+  void AddString(uint32_t field, const std::string& value) {
+    AddTag(field, kWireLengthDelimited);
+    AddRawVarInt(value.size());
+    data_.append(value);
+  }
+
+  void AddMessage(uint32_t field, const ProtoMessage& message) {
+    AddString(field, message.data_);
+  }
+
+  bool IsEmpty() const {
+    return data_.empty();
+  }
+
+  const std::string& GetData() const {
+    return data_;
+  }
+
+ private:
+  enum WireType : uint32_t {
+    kWireVarInt = 0,
+    kWireFixed64 = 1,
+    kWireLengthDelimited = 2
+  };
+
+  void AddTag(uint32_t field, WireType type) {
+    AddRawVarInt((static_cast<uint64_t>(field) << 3) | type);
+  }
+
+  void AddRawVarInt(uint64_t value) {
+    while (value >= 0x80) {
+      data_.push_back(static_cast<char>((value & 0x7F) | 0x80));
+      value >>= 7;
+    }
+    data_.push_back(static_cast<char>(value));
+  }
+
+  std::string data_;
+};
+
+// Debug annotations of an event, names and string values
+using PerfettoArgs = std::vector<std::pair<std::string, std::string> >;
+
+// Streams a Perfetto trace (TrackEvent protos) into a file packet by packet.
+// Every track has its own packet sequence, so event names, categories and
+// argument names are interned per track and timestamps are deltas from the
+// previous event of the track. An event earlier than the previous one keeps
+// an absolute timestamp. Timestamps are in ns of one builtin clock for all
+// tracks, the clock the tool reads its timestamps from.
+class PerfettoWriter {
+ public:
+  PerfettoWriter(const std::string& filename, uint32_t clock_id)
+      : clock_id_(clock_id) {
+    file_.open(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+    PTI_ASSERT(file_.is_open());
+  }
+
+  ~PerfettoWriter() {
+    if (file_.is_open()) {
+      file_ << std::flush;
+      file_.close();
+    }
+  }
+
+  PerfettoWriter(const PerfettoWriter& that) = delete;
+  PerfettoWriter& operator=(const PerfettoWriter& that) = delete;
+
+  // Tracks are created on the first call, later calls return the same uuid
+
+  uint64_t AddProcessTrack(uint32_t pid, const std::string& name) {
+    const std::lock_guard<std::mutex> lock(lock_);
+    uint64_t uuid = GetUuid(kProcessTrack, pid, 0, std::string());
+    if (tracks_.count(uuid) == 0) {
+      ProtoMessage process;
+      process.AddVarInt(perfetto_proto::kProcessDescriptorPid, pid);
+      if (!name.empty()) {
+        process.AddString(perfetto_proto::kProcessDescriptorProcessName, name);
+      }
+
+      ProtoMessage track;
+      track.AddVarInt(perfetto_proto::kTrackDescriptorUuid, uuid);
+      track.AddMessage(perfetto_proto::kTrackDescriptorProcess, process);
+      CreateTrack(uuid, track);
+    }
+    return uuid;
+  }
+
+  // Thread track is nested in the process track if the process track exists
+  uint64_t AddThreadTrack(
+      uint32_t pid, uint32_t tid, const std::string& name = std::string()) {
+    const std::lock_guard<std::mutex> lock(lock_);
+    uint64_t uuid = GetUuid(kThreadTrack, pid, tid, std::string());
+    if (tracks_.count(uuid) == 0) {
+      ProtoMessage thread;
+      thread.AddVarInt(perfetto_proto::kThreadDescriptorPid, pid);
+      thread.AddVarInt(perfetto_proto::kThreadDescriptorTid, tid);
+      if (!name.empty()) {
+        thread.AddString(perfetto_proto::kThreadDescriptorThreadName, name);
+      }
+
+      ProtoMessage track;
+      track.AddVarInt(perfetto_proto::kTrackDescriptorUuid, uuid);
+      uint64_t process_uuid = GetUuid(kProcessTrack, pid, 0, std::string());
+      if (tracks_.count(process_uuid) != 0) {
+        track.AddVarInt(perfetto_proto::kTrackDescriptorParentUuid, process_uuid);
+      }
+      track.AddMessage(perfetto_proto::kTrackDescriptorThread, thread);
+      CreateTrack(uuid, track);
+    }
+    return uuid;
+  }
+
+  // Named track, e.g., of a device, an engine or a queue, top level if
+  // parent_uuid is 0
+  uint64_t AddTrack(const std::string& name, uint64_t parent_uuid = 0) {
+    return AddNamedTrack(kNamedTrack, name, parent_uuid);
+  }
+
+  uint64_t AddCounterTrack(const std::string& name, uint64_t parent_uuid = 0) {
+    return AddNamedTrack(kCounterTrack, name, parent_uuid);
+  }
+
+  void AddSlice(
+      uint64_t track_uuid, const std::string& category,
+      const std::string& name, uint64_t start, uint64_t end,
+      const PerfettoArgs& args = PerfettoArgs()) {
+    const std::lock_guard<std::mutex> lock(lock_);
+    WriteEvent(track_uuid, perfetto_proto::kTypeSliceBegin,
+               start, &category, &name, args, 0, false);
+    WriteEvent(track_uuid, perfetto_proto::kTypeSliceEnd,
+               (end > start) ? end : start, nullptr, nullptr,
+               PerfettoArgs(), 0, false);
+  }
+
+  void BeginSlice(
+      uint64_t track_uuid, const std::string& category,
+      const std::string& name, uint64_t timestamp,
+      const PerfettoArgs& args = PerfettoArgs()) {
+    const std::lock_guard<std::mutex> lock(lock_);
+    WriteEvent(track_uuid, perfetto_proto::kTypeSliceBegin,
+               timestamp, &category, &name, args, 0, false);
+  }
+
+  void EndSlice(uint64_t track_uuid, uint64_t timestamp) {
+    const std::lock_guard<std::mutex> lock(lock_);
+    WriteEvent(track_uuid, perfetto_proto::kTypeSliceEnd,
+               timestamp, nullptr, nullptr, PerfettoArgs(), 0, false);
+  }
+
+  void AddInstant(
+      uint64_t track_uuid, const std::string& category,
+      const std::string& name, uint64_t timestamp,
+      const PerfettoArgs& args = PerfettoArgs()) {
+    const std::lock_guard<std::mutex> lock(lock_);
+    WriteEvent(track_uuid, perfetto_proto::kTypeInstant,
+               timestamp, &category, &name, args, 0, false);
+  }
+
+  // Flow is drawn from the instant of the first call with the flow_id to the
+  // instant of the call with terminating set
+  void AddFlow(
+      uint64_t track_uuid, const std::string& category, uint64_t timestamp,
+      uint64_t flow_id, bool terminating) {
+    const std::lock_guard<std::mutex> lock(lock_);
+    WriteEvent(track_uuid, perfetto_proto::kTypeInstant,
+               timestamp, &category, &category, PerfettoArgs(),
+               flow_id, terminating);
+  }
+
+  void AddCounterValue(uint64_t track_uuid, uint64_t timestamp, int64_t value) {
+    const std::lock_guard<std::mutex> lock(lock_);
+    Track& track = GetTrack(track_uuid);
+    ProtoMessage event;
+    event.AddVarInt(perfetto_proto::kTrackEventType, perfetto_proto::kTypeCounter);
+    event.AddVarInt(perfetto_proto::kTrackEventTrackUuid, track_uuid);
+    event.AddVarInt(
+        perfetto_proto::kTrackEventCounterValue, static_cast<uint64_t>(value));
+    WritePacket(track, timestamp, ProtoMessage(), event);
+  }
+
+  // Values of builtin clocks read at the same time, e.g., at the start of
+  // tracing, so the trace can be aligned with traces on the other clocks
+  void AddClockSnapshot(const std::vector<std::pair<uint32_t, uint64_t> >& clocks) {
+    const std::lock_guard<std::mutex> lock(lock_);
+    ProtoMessage snapshot;
+    for (auto& clock : clocks) {
+      ProtoMessage value;
+      value.AddVarInt(perfetto_proto::kClockId, clock.first);
+      value.AddVarInt(perfetto_proto::kClockTimestamp, clock.second);
+      snapshot.AddMessage(perfetto_proto::kClockSnapshotClocks, value);
+    }
+    snapshot.AddVarInt(perfetto_proto::kClockSnapshotPrimaryTraceClock, clock_id_);
+
+    ProtoMessage packet;
+    packet.AddMessage(perfetto_proto::kPacketClockSnapshot, snapshot);
+    Write(packet);
+  }
+
+  void Flush() {
+    const std::lock_guard<std::mutex> lock(lock_);
+    file_ << std::flush;
+  }
+
+ private:
+  enum TrackKind : uint32_t {
+    kProcessTrack = 1,
+    kThreadTrack = 2,
+    kNamedTrack = 3,
+    kCounterTrack = 4
+  };
+
+  // Packet sequence of a track
+  struct Track {
+    uint32_t sequence_id = 0;
+    bool clock_set = false;
+    uint64_t timestamp = 0;	// last value of the incremental clock
+    std::unordered_map<std::string, uint64_t> categories;
+    std::unordered_map<std::string, uint64_t> names;
+    std::unordered_map<std::string, uint64_t> arg_names;
+  };
+
+  // FNV-1a, uuid 0 means no parent track
+  static uint64_t GetUuid(
+      TrackKind kind, uint64_t id0, uint64_t id1, const std::string& name) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    auto mix = [&hash](uint64_t value) {
+      for (int i = 0; i < 8; ++i) {
+        hash = (hash ^ ((value >> (8 * i)) & 0xFF)) * 0x100000001b3ULL;
+      }
+    };
+    mix(kind);
+    mix(id0);
+    mix(id1);
+    for (char c : name) {
+      hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001b3ULL;
+    }
+    return (hash == 0) ? 1 : hash;
+  }
+
+  uint64_t AddNamedTrack(
+      TrackKind kind, const std::string& name, uint64_t parent_uuid) {
+    const std::lock_guard<std::mutex> lock(lock_);
+    uint64_t uuid = GetUuid(kind, parent_uuid, 0, name);
+    if (tracks_.count(uuid) == 0) {
+      ProtoMessage track;
+      track.AddVarInt(perfetto_proto::kTrackDescriptorUuid, uuid);
+      track.AddString(perfetto_proto::kTrackDescriptorName, name);
+      if (parent_uuid != 0) {
+        track.AddVarInt(perfetto_proto::kTrackDescriptorParentUuid, parent_uuid);
+      }
+      if (kind == kCounterTrack) {
+        track.AddMessage(perfetto_proto::kTrackDescriptorCounter, ProtoMessage());
+      }
+      CreateTrack(uuid, track);
+    }
+    return uuid;
+  }
+
+  void CreateTrack(uint64_t uuid, const ProtoMessage& descriptor) {
+    Track& track = tracks_[uuid];
+    track.sequence_id = static_cast<uint32_t>(tracks_.size());
+
+    ProtoMessage packet;
+    packet.AddVarInt(
+        perfetto_proto::kPacketTrustedPacketSequenceId, track.sequence_id);
+    packet.AddMessage(perfetto_proto::kPacketTrackDescriptor, descriptor);
+    Write(packet);
+  }
+
+  // Events of a track that was not added go to a top level track of its own
+  Track& GetTrack(uint64_t uuid) {
+    auto it = tracks_.find(uuid);
+    if (it != tracks_.end()) {
+      return it->second;
+    }
+    ProtoMessage descriptor;
+    descriptor.AddVarInt(perfetto_proto::kTrackDescriptorUuid, uuid);
+    CreateTrack(uuid, descriptor);
+    return tracks_[uuid];
+  }
+
+  static uint64_t Intern(
+      std::unordered_map<std::string, uint64_t>& table, ProtoMessage& interned,
+      uint32_t field, const std::string& value) {
+    auto it = table.find(value);
+    if (it != table.end()) {
+      return it->second;
+    }
+    uint64_t iid = table.size() + 1;
+    table[value] = iid;
+
+    ProtoMessage entry;
+    entry.AddVarInt(perfetto_proto::kInternedIid, iid);
+    entry.AddString(perfetto_proto::kInternedName, value);
+    interned.AddMessage(field, entry);
+    return iid;
+  }
+
+  void WriteEvent(
+      uint64_t track_uuid, uint32_t type, uint64_t timestamp,
+      const std::string* category, const std::string* name,
+      const PerfettoArgs& args, uint64_t flow_id, bool terminating) {
+    Track& track = GetTrack(track_uuid);
+    ProtoMessage interned;
+    ProtoMessage event;
+    event.AddVarInt(perfetto_proto::kTrackEventType, type);
+    event.AddVarInt(perfetto_proto::kTrackEventTrackUuid, track_uuid);
+    if (category != nullptr && !category->empty()) {
+      event.AddVarInt(perfetto_proto::kTrackEventCategoryIids,
+                      Intern(track.categories, interned,
+                             perfetto_proto::kInternedEventCategories,
+                             *category));
+    }
+    if (name != nullptr) {
+      event.AddVarInt(perfetto_proto::kTrackEventNameIid,
+                      Intern(track.names, interned,
+                             perfetto_proto::kInternedEventNames, *name));
+    }
+    for (auto& arg : args) {
+      ProtoMessage annotation;
+      annotation.AddVarInt(perfetto_proto::kDebugAnnotationNameIid,
+                           Intern(track.arg_names, interned,
+                                  perfetto_proto::kInternedDebugAnnotationNames,
+                                  arg.first));
+      annotation.AddString(
+          perfetto_proto::kDebugAnnotationStringValue, arg.second);
+      event.AddMessage(perfetto_proto::kTrackEventDebugAnnotations, annotation);
+    }
+    if (flow_id != 0) {
+      event.AddFixed64(terminating ?
+                       perfetto_proto::kTrackEventTerminatingFlowIds :
+                       perfetto_proto::kTrackEventFlowIds, flow_id);
+    }
+    WritePacket(track, timestamp, interned, event);
+  }
+
+  void WritePacket(
+      Track& track, uint64_t timestamp,
+      const ProtoMessage& interned, const ProtoMessage& event) {
+    if (!track.clock_set) {
+      // the incremental clock of the sequence starts at the first event
+      ProtoMessage clock;
+      clock.AddVarInt(perfetto_proto::kClockId, clock_id_);
+      clock.AddVarInt(perfetto_proto::kClockTimestamp, timestamp);
+
+      ProtoMessage incremental;
+      incremental.AddVarInt(
+          perfetto_proto::kClockId, perfetto_proto::kIncrementalClock);
+      incremental.AddVarInt(perfetto_proto::kClockTimestamp, timestamp);
+      incremental.AddVarInt(perfetto_proto::kClockIsIncremental, 1);
+
+      ProtoMessage snapshot;
+      snapshot.AddMessage(perfetto_proto::kClockSnapshotClocks, clock);
+      snapshot.AddMessage(perfetto_proto::kClockSnapshotClocks, incremental);
+      // timestamps are shown on the clock of the events, not on BOOTTIME
+      snapshot.AddVarInt(
+          perfetto_proto::kClockSnapshotPrimaryTraceClock, clock_id_);
+
+      ProtoMessage defaults;
+      defaults.AddVarInt(perfetto_proto::kDefaultsTimestampClockId,
+                         perfetto_proto::kIncrementalClock);
+
+      ProtoMessage packet;
+      packet.AddVarInt(
+          perfetto_proto::kPacketTrustedPacketSequenceId, track.sequence_id);
+      packet.AddVarInt(perfetto_proto::kPacketSequenceFlags,
+                       perfetto_proto::kSequenceIncrementalStateCleared);
+      packet.AddMessage(perfetto_proto::kPacketClockSnapshot, snapshot);
+      packet.AddMessage(perfetto_proto::kPacketTracePacketDefaults, defaults);
+      Write(packet);
+
+      track.clock_set = true;
+      track.timestamp = timestamp;
+    }
+
+    ProtoMessage packet;
+    if (timestamp >= track.timestamp) {
+      packet.AddVarInt(
+          perfetto_proto::kPacketTimestamp, timestamp - track.timestamp);
+      track.timestamp = timestamp;
+    } else {
+      packet.AddVarInt(perfetto_proto::kPacketTimestamp, timestamp);
+      packet.AddVarInt(perfetto_proto::kPacketTimestampClockId, clock_id_);
+    }
+    packet.AddVarInt(
+        perfetto_proto::kPacketTrustedPacketSequenceId, track.sequence_id);
+    packet.AddVarInt(perfetto_proto::kPacketSequenceFlags,
+                     perfetto_proto::kSequenceNeedsIncrementalState);
+    if (!interned.IsEmpty()) {
+      packet.AddMessage(perfetto_proto::kPacketInternedData, interned);
+    }
+    packet.AddMessage(perfetto_proto::kPacketTrackEvent, event);
+    Write(packet);
+  }
+
+  // Every packet is a field of the Trace message, so the file is a valid
+  // trace after every packet
+  void Write(const ProtoMessage& packet) {
+    ProtoMessage trace;
+    trace.AddMessage(perfetto_proto::kTracePacket, packet);
+    file_ << trace.GetData();
+  }
+
+  uint32_t clock_id_;
+  std::mutex lock_;
+  std::ofstream file_;
+  std::unordered_map<uint64_t, Track> tracks_;
+};
+
+#endif // PTI_TOOLS_UTILS_PERFETTO_WRITER_H_
@@ -47,6 +47,7 @@
 #define TRACE_CHROME_MPI_LOGGING     31
 
 const char* kChromeTraceFileExt = "json";
+const char* kPerfettoTraceFileExt = "pftrace";
 
 class TraceOptions {
  public:
@@ -95,19 +96,20 @@ class TraceOptions {
     return result.str();
   }
 
-  static std::string GetChromeTraceFileName(const char* filename) {
+  static std::string GetChromeTraceFileName(
+      const char* filename, const char* ext = kChromeTraceFileExt) {
     std::string rank = (utils::GetEnv("PMI_RANK").empty()) ? utils::GetEnv("PMIX_RANK") : utils::GetEnv("PMI_RANK");
     if (!rank.empty()) {
       return
         std::string(filename) +
         "." + std::to_string(utils::GetPid()) +
         "." + rank +
-        "." + kChromeTraceFileExt;
+        "." + ext;
     }
     return
         std::string(filename) +
         "." + std::to_string(utils::GetPid()) +
-        "." + kChromeTraceFileExt;
+        "." + ext;
   }
 
  private:
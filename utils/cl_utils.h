@@ -342,6 +342,43 @@ inline cl_device_id GetDevice(cl_command_queue queue) {
   return device;
 }
 
+// 0 if the queue is not valid
+inline cl_uint GetReferenceCount(cl_command_queue queue) {
+  cl_uint count = 0;
+  cl_int status = clGetCommandQueueInfo(queue, CL_QUEUE_REFERENCE_COUNT,
+                                        sizeof(cl_uint), &count, nullptr);
+  return (status == CL_SUCCESS) ? count : 0;
+}
+
+// 0 if the kernel is not valid
+inline cl_uint GetReferenceCount(cl_kernel kernel) {
+  cl_uint count = 0;
+  cl_int status = clGetKernelInfo(kernel, CL_KERNEL_REFERENCE_COUNT,
+                                  sizeof(cl_uint), &count, nullptr);
+  return (status == CL_SUCCESS) ? count : 0;
+}
+
+// 0 if the event is not valid
+inline cl_uint GetReferenceCount(cl_event event) {
+  cl_uint count = 0;
+  cl_int status = clGetEventInfo(event, CL_EVENT_REFERENCE_COUNT,
+                                 sizeof(cl_uint), &count, nullptr);
+  return (status == CL_SUCCESS) ? count : 0;
+}
+
+inline bool IsQueueOutOfOrder(cl_command_queue queue) {
+  PTI_ASSERT(queue != nullptr);
+
+  cl_int status = CL_SUCCESS;
+  cl_command_queue_properties properties = 0;
+  status = clGetCommandQueueInfo(queue, CL_QUEUE_PROPERTIES,
+                                 sizeof(cl_command_queue_properties),
+                                 &properties, nullptr);
+  PTI_ASSERT(status == CL_SUCCESS);
+
+  return (properties & CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE) != 0;
+}
+
 inline cl_ulong GetEventTimestamp(cl_event event, cl_profiling_info info) {
   PTI_ASSERT(event != nullptr);
 
@@ -0,0 +1,266 @@
+//==============================================================
+// Copyright (C) Intel Corporation
+//
+// SPDX-License-Identifier: MIT
+// =============================================================
+
+#ifndef PTI_UTILS_TSC_CLOCK_H_
+#define PTI_UTILS_TSC_CLOCK_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <mutex>
+
+#if defined(__gnu_linux__)
+#include <pthread.h>
+#include <time.h>
+#if defined(__x86_64__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#define PTI_TSC_CLOCK_SUPPORTED
+#endif
+#endif
+
+namespace utils {
+
+/**
+ * Host clock in ns of CLOCK_MONOTONIC_RAW, read from the invariant TSC.
+ *
+ * The rate of the TSC is measured against CLOCK_MONOTONIC_RAW since the clock
+ * was created and the clock is re-anchored to CLOCK_MONOTONIC_RAW as it goes,
+ * at most every 100 ms of TSC, so the two do not drift apart. Readings never
+ * go below the last one returned by any thread, also across a re-anchor. A
+ * reading costs a few ns instead of a clock_gettime call. Without an invariant
+ * TSC, e.g., on other architectures or under hypervisors that do not report
+ * it, readings are taken from CLOCK_MONOTONIC_RAW.
+ */
+class TscClock {
+ public:
+  static TscClock& Instance() {
+    static TscClock clock;
+    return clock;
+  }
+
+  TscClock(const TscClock&) = delete;
+  TscClock& operator=(const TscClock&) = delete;
+
+  bool IsTscUsed() const { return tsc_used_; }
+
+  uint64_t GetTime() {
+#ifdef PTI_TSC_CLOCK_SUPPORTED
+    if (tsc_used_) {
+      for (;;) {
+        Anchor anchor = ReadAnchor();
+        uint64_t tsc = __rdtsc();
+        if (tsc > anchor.tsc && tsc - anchor.tsc >= anchor.window && Refresh(anchor)) {
+          continue;
+        }
+        return Clamp(Convert(anchor, tsc));
+      }
+    }
+#endif
+    return GetRawTime();
+  }
+
+  static uint64_t GetRawTime() {
+#if defined(__gnu_linux__)
+    timespec ts{0, 0};
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+#else
+    return 0;
+#endif
+  }
+
+ private:
+#ifdef PTI_TSC_CLOCK_SUPPORTED
+  struct Anchor {
+    uint64_t tsc;
+    uint64_t ns;
+    uint64_t mult;    // ns per tick, fixed point with kShift fraction bits
+    uint64_t window;  // ticks until the next refresh
+    uint32_t sequence;
+  };
+
+  static constexpr uint32_t kShift = 32;
+  static constexpr uint64_t kCalibrationNs = 1000000;   // 1 ms
+  static constexpr uint64_t kMaxWindowNs = 100000000;  // 100 ms
+
+  TscClock() {
+    tsc_used_ = IsTscInvariant();
+    if (!tsc_used_) {
+      return;
+    }
+
+    ReadPair(start_tsc_, start_ns_);
+    uint64_t tsc = 0;
+    uint64_t ns = 0;
+    do {
+      ReadPair(tsc, ns);
+    } while (ns - start_ns_ < kCalibrationNs);
+    if (tsc <= start_tsc_) {
+      tsc_used_ = false;
+      return;
+    }
+
+    uint64_t mult = GetMult(tsc, ns);
+    min_window_ = tsc - start_tsc_;
+    max_window_ = static_cast<uint64_t>(
+        (static_cast<unsigned __int128>(kMaxWindowNs) << kShift) / mult);
+    Publish(tsc, ns, mult, min_window_);
+
+    // a refresh in another thread never finishes in the child, the lock is
+    // held over fork so the anchor is not torn and is released in the child
+    pthread_atfork([]() { GetRefreshLock().lock(); }, []() { GetRefreshLock().unlock(); },
+                   []() { GetRefreshLock().unlock(); });
+  }
+
+  static bool IsTscInvariant() {
+    unsigned int eax = 0;
+    unsigned int ebx = 0;
+    unsigned int ecx = 0;
+    unsigned int edx = 0;
+    if (__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) == 0 || eax < 0x80000007) {
+      return false;
+    }
+    if (__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) == 0) {
+      return false;
+    }
+    return (edx & (1U << 8)) != 0;  // Invariant TSC
+  }
+
+  // TSC value taken at the middle of the shortest of a few clock_gettime calls
+  static void ReadPair(uint64_t& tsc, uint64_t& ns) {
+    constexpr int kAttempts = 5;
+    uint64_t best = UINT64_MAX;
+    for (int i = 0; i < kAttempts; ++i) {
+      unsigned int aux = 0;
+      uint64_t before = __rdtscp(&aux);
+      uint64_t raw = GetRawTime();
+      uint64_t after = __rdtscp(&aux);
+      if (after - before < best) {
+        best = after - before;
+        tsc = before + best / 2;
+        ns = raw;
+      }
+    }
+  }
+
+  // Rate over the whole time since the clock was created
+  uint64_t GetMult(uint64_t tsc, uint64_t ns) const {
+    return static_cast<uint64_t>((static_cast<unsigned __int128>(ns - start_ns_) << kShift) /
+                                 (tsc - start_tsc_));
+  }
+
+  static uint64_t Convert(const Anchor& anchor, uint64_t tsc) {
+    if (tsc >= anchor.tsc) {
+      return anchor.ns + static_cast<uint64_t>(
+                             (static_cast<unsigned __int128>(tsc - anchor.tsc) * anchor.mult) >>
+                             kShift);
+    }
+    // read before a refresh by another thread
+    return anchor.ns - static_cast<uint64_t>(
+                           (static_cast<unsigned __int128>(anchor.tsc - tsc) * anchor.mult) >>
+                           kShift);
+  }
+
+  // constant initialized, the fork handlers do not wait for the construction
+  // of the clock
+  static std::mutex& GetRefreshLock() {
+    static std::mutex refresh_lock;
+    return refresh_lock;
+  }
+
+  // a thread holding an anchor replaced meanwhile extrapolates with the rate
+  // before the refresh and may get ahead of the readings of the new anchor
+  uint64_t Clamp(uint64_t ns) {
+    uint64_t last = last_ns_.load(std::memory_order_relaxed);
+    while (ns > last) {
+      if (last_ns_.compare_exchange_weak(last, ns, std::memory_order_relaxed)) {
+        return ns;
+      }
+    }
+    return last;
+  }
+
+  Anchor ReadAnchor() const {
+    Anchor anchor{};
+    for (;;) {
+      anchor.sequence = sequence_.load(std::memory_order_acquire);
+      anchor.tsc = anchor_tsc_.load(std::memory_order_relaxed);
+      anchor.ns = anchor_ns_.load(std::memory_order_relaxed);
+      anchor.mult = mult_.load(std::memory_order_relaxed);
+      anchor.window = window_.load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if ((anchor.sequence & 1) == 0 &&
+          sequence_.load(std::memory_order_relaxed) == anchor.sequence) {
+        return anchor;
+      }
+    }
+  }
+
+  // false if another thread refreshes the anchor, the current one is still used then
+  bool Refresh(const Anchor& anchor) {
+    std::unique_lock<std::mutex> lock(GetRefreshLock(), std::try_to_lock);
+    if (!lock.owns_lock()) {
+      return false;
+    }
+    if (sequence_.load(std::memory_order_relaxed) != anchor.sequence) {
+      return true;
+    }
+
+    uint64_t tsc = 0;
+    uint64_t ns = 0;
+    ReadPair(tsc, ns);
+    if (tsc <= anchor.tsc) {
+      return false;
+    }
+    // the clock never goes back on refresh
+    uint64_t expected_ns = Convert(anchor, tsc);
+    if (ns < expected_ns) {
+      ns = expected_ns;
+    }
+    // a window of 1/16 of the run keeps the error of the rate within the window small
+    uint64_t window = (tsc - start_tsc_) / 16;
+    if (window < min_window_) {
+      window = min_window_;
+    } else if (window > max_window_) {
+      window = max_window_;
+    }
+    Publish(tsc, ns, GetMult(tsc, ns), window);
+    return true;
+  }
+
+  void Publish(uint64_t tsc, uint64_t ns, uint64_t mult, uint64_t window) {
+    uint32_t sequence = sequence_.load(std::memory_order_relaxed);
+    sequence_.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    anchor_tsc_.store(tsc, std::memory_order_relaxed);
+    anchor_ns_.store(ns, std::memory_order_relaxed);
+    mult_.store(mult, std::memory_order_relaxed);
+    window_.store(window, std::memory_order_relaxed);
+    sequence_.store(sequence + 2, std::memory_order_release);
+  }
+
+  uint64_t start_tsc_ = 0;
+  uint64_t start_ns_ = 0;
+  uint64_t min_window_ = 0;
+  uint64_t max_window_ = 0;
+
+  std::atomic<uint32_t> sequence_{0};  // odd while the anchor is written
+  std::atomic<uint64_t> anchor_tsc_{0};
+  std::atomic<uint64_t> anchor_ns_{0};
+  std::atomic<uint64_t> mult_{0};
+  std::atomic<uint64_t> window_{0};
+  std::atomic<uint64_t> last_ns_{0};  // the latest reading returned
+#else
+  TscClock() = default;
+#endif
+
+  bool tsc_used_ = false;
+};
+
+}  // namespace utils
+
+#endif  // PTI_UTILS_TSC_CLOCK_H_
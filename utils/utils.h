@@ -10,6 +10,7 @@
 #if defined(_WIN32)
 #include <windows.h>
 #else
+#include <pthread.h>
 #include <unistd.h>
 #include <sys/syscall.h>
 #endif
@@ -21,6 +22,7 @@
 #include <vector>
 
 #include "pti_assert.h"
+#include "tsc_clock.h"
 
 #ifdef _WIN32
 #define PTI_EXPORT __declspec(dllexport)
@@ -194,12 +196,28 @@ inline uint32_t GetPid() {
 #endif
 }
 
+#if !defined(_WIN32)
+// 0 until the thread asks for its id
+inline uint32_t& GetCachedTid() {
+  static thread_local uint32_t tid = 0;
+  return tid;
+}
+#endif
+
 inline uint32_t GetTid() {
 #if defined(_WIN32)
   return GetCurrentThreadId();
 #else
 #ifdef SYS_gettid
-  return (uint32_t)syscall(SYS_gettid);
+  uint32_t& tid = GetCachedTid();
+  if (tid == 0) {
+    // the forking thread is the only thread of the child, its id changes
+    static const int registered =
+        pthread_atfork(nullptr, nullptr, []() { GetCachedTid() = 0; });
+    (void)registered;
+    tid = (uint32_t)syscall(SYS_gettid);
+  }
+  return tid;
 #else
   #error "SYS_gettid is unavailable on this system"
 #endif
@@ -216,7 +234,7 @@ inline uint64_t GetSystemTime() {
   PTI_ASSERT(status != 0);
   return ticks.QuadPart * (NSEC_IN_SEC / frequency.QuadPart);
 #else
-  return GetTime(CLOCK_MONOTONIC_RAW);
+  return TscClock::Instance().GetTime();
 #endif
 }
 